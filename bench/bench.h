@@ -0,0 +1,19 @@
+#pragma once
+
+#include <chrono>
+
+// Timing for the benchmarks of the modules that don't depend on D3D. Every benchmark is its own executable, which
+// prints its results. They aren't run by ctest, since their sizes are picked to be measurable rather than quick.
+
+inline double BenchGetMilliseconds()
+{
+    return std::chrono::duration<double, std::milli>(std::chrono::steady_clock::now().time_since_epoch()).count();
+}
+
+// Keeps a result alive, so the work that computed it can't be optimized away.
+template<class T>
+void BenchKeep(const T& value)
+{
+    volatile T sink = value;
+    (void)sink;
+}
\ No newline at end of file
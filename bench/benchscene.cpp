@@ -0,0 +1,271 @@
+#include "benchscene.h"
+
+#include "tiny_obj_loader.h"
+#include "stb_image.h"
+
+#include <algorithm>
+#include <cfloat>
+#include <cmath>
+#include <map>
+#include <string>
+
+using namespace DirectX;
+
+// The same size the app gives the voxelizer
+static const int kBenchSceneTextureSize = 64;
+
+static void BenchSceneAddTriangle(BenchScene* pScene, const XMFLOAT3& p0, const XMFLOAT3& p1, const XMFLOAT3& p2, const XMFLOAT3& albedo)
+{
+    VoxelizerTriangle triangle;
+    triangle.Positions[0] = p0;
+    triangle.Positions[1] = p1;
+    triangle.Positions[2] = p2;
+    for (XMFLOAT2& texCoord : triangle.TexCoords)
+    {
+        texCoord = XMFLOAT2(0.0f, 0.0f);
+    }
+    triangle.Albedo = albedo;
+    triangle.pAlbedoTexture = NULL;
+    pScene->Triangles.push_back(triangle);
+}
+
+static void BenchSceneAddQuad(BenchScene* pScene, const XMFLOAT3 corners[4], const XMFLOAT3& albedo)
+{
+    BenchSceneAddTriangle(pScene, corners[0], corners[1], corners[2], albedo);
+    BenchSceneAddTriangle(pScene, corners[0], corners[2], corners[3], albedo);
+}
+
+static void BenchSceneAddBox(BenchScene* pScene, const XMFLOAT3& boxMin, const XMFLOAT3& boxMax, const XMFLOAT3& albedo)
+{
+    float x[2] = { boxMin.x, boxMax.x };
+    float y[2] = { boxMin.y, boxMax.y };
+    float z[2] = { boxMin.z, boxMax.z };
+
+    for (int axis = 0; axis < 3; axis++)
+    {
+        for (int side = 0; side < 2; side++)
+        {
+            XMFLOAT3 corners[4];
+            for (int i = 0; i < 4; i++)
+            {
+                int u = (i == 1 || i == 2) ? 1 : 0;
+                int v = i >= 2 ? 1 : 0;
+                if (axis == 0)
+                    corners[i] = XMFLOAT3(x[side], y[u], z[v]);
+                else if (axis == 1)
+                    corners[i] = XMFLOAT3(x[u], y[side], z[v]);
+                else
+                    corners[i] = XMFLOAT3(x[u], y[v], z[side]);
+            }
+            BenchSceneAddQuad(pScene, corners, albedo);
+        }
+    }
+}
+
+static void BenchSceneAddColumn(BenchScene* pScene, float centerX, float baseY, float centerZ, float radius, float height, const XMFLOAT3& albedo)
+{
+    const int numSides = 16;
+    for (int side = 0; side < numSides; side++)
+    {
+        float a0 = side * 2.0f * 3.14159265f / numSides;
+        float a1 = (side + 1) * 2.0f * 3.14159265f / numSides;
+        XMFLOAT3 corners[4] = {
+            XMFLOAT3(centerX + radius * std::cos(a0), baseY, centerZ + radius * std::sin(a0)),
+            XMFLOAT3(centerX + radius * std::cos(a1), baseY, centerZ + radius * std::sin(a1)),
+            XMFLOAT3(centerX + radius * std::cos(a1), baseY + height, centerZ + radius * std::sin(a1)),
+            XMFLOAT3(centerX + radius * std::cos(a0), baseY + height, centerZ + radius * std::sin(a0))
+        };
+        BenchSceneAddQuad(pScene, corners, albedo);
+    }
+
+    // the capital and the base
+    BenchSceneAddBox(pScene, XMFLOAT3(centerX - radius * 1.4f, baseY, centerZ - radius * 1.4f), XMFLOAT3(centerX + radius * 1.4f, baseY + radius, centerZ + radius * 1.4f), albedo);
+    BenchSceneAddBox(pScene, XMFLOAT3(centerX - radius * 1.4f, baseY + height - radius, centerZ - radius * 1.4f), XMFLOAT3(centerX + radius * 1.4f, baseY + height, centerZ + radius * 1.4f), albedo);
+}
+
+// An arch between two columns, as a half ring of boxes.
+static void BenchSceneAddArch(BenchScene* pScene, float x0, float x1, float z, float baseY, float depth, const XMFLOAT3& albedo)
+{
+    const int numSegments = 12;
+    float radius = (x1 - x0) * 0.5f;
+    float centerX = (x0 + x1) * 0.5f;
+    for (int segment = 0; segment < numSegments; segment++)
+    {
+        float a = (segment + 0.5f) * 3.14159265f / numSegments;
+        float px = centerX - radius * std::cos(a);
+        float py = baseY + radius * std::sin(a);
+        float half = radius * 3.14159265f / numSegments * 0.5f;
+        BenchSceneAddBox(pScene, XMFLOAT3(px - half, py - half, z - depth), XMFLOAT3(px + half, py + half, z + depth), albedo);
+    }
+}
+
+static void BenchSceneBuildCourtyard(BenchScene* pScene)
+{
+    const XMFLOAT3 stone(0.6f, 0.55f, 0.45f);
+    const XMFLOAT3 floor(0.35f, 0.3f, 0.25f);
+    const XMFLOAT3 cloth(0.6f, 0.1f, 0.1f);
+
+    const float width = 3000.0f, depth = 1300.0f, height = 1200.0f;
+
+    XMFLOAT3 floorCorners[4] = {
+        XMFLOAT3(-width * 0.5f, 0.0f, -depth * 0.5f), XMFLOAT3(width * 0.5f, 0.0f, -depth * 0.5f),
+        XMFLOAT3(width * 0.5f, 0.0f, depth * 0.5f), XMFLOAT3(-width * 0.5f, 0.0f, depth * 0.5f)
+    };
+    BenchSceneAddQuad(pScene, floorCorners, floor);
+
+    // the outer walls
+    BenchSceneAddBox(pScene, XMFLOAT3(-width * 0.5f, 0.0f, -depth * 0.5f - 20.0f), XMFLOAT3(width * 0.5f, height, -depth * 0.5f), stone);
+    BenchSceneAddBox(pScene, XMFLOAT3(-width * 0.5f, 0.0f, depth * 0.5f), XMFLOAT3(width * 0.5f, height, depth * 0.5f + 20.0f), stone);
+    BenchSceneAddBox(pScene, XMFLOAT3(-width * 0.5f - 20.0f, 0.0f, -depth * 0.5f), XMFLOAT3(-width * 0.5f, height, depth * 0.5f), stone);
+    BenchSceneAddBox(pScene, XMFLOAT3(width * 0.5f, 0.0f, -depth * 0.5f), XMFLOAT3(width * 0.5f + 20.0f, height, depth * 0.5f), stone);
+
+    // two stories of colonnades along both long walls, with arches between the columns and a gallery floor on each
+    const int numColumns = 12;
+    for (int story = 0; story < 2; story++)
+    {
+        float baseY = story * 500.0f;
+        for (int side = 0; side < 2; side++)
+        {
+            float z = (side == 0 ? -1.0f : 1.0f) * depth * 0.3f;
+            for (int column = 0; column < numColumns; column++)
+            {
+                float x = -width * 0.45f + column * (width * 0.9f / (numColumns - 1));
+                BenchSceneAddColumn(pScene, x, baseY, z, 25.0f, 380.0f, stone);
+
+                if (column + 1 < numColumns)
+                {
+                    float nextX = x + width * 0.9f / (numColumns - 1);
+                    BenchSceneAddArch(pScene, x, nextX, z, baseY + 380.0f, 25.0f, stone);
+                }
+            }
+
+            BenchSceneAddBox(pScene,
+                XMFLOAT3(-width * 0.5f, baseY + 480.0f, side == 0 ? -depth * 0.5f : z - 30.0f),
+                XMFLOAT3(width * 0.5f, baseY + 500.0f, side == 0 ? z + 30.0f : depth * 0.5f), stone);
+        }
+    }
+
+    // hanging curtains between the lower columns
+    for (int column = 0; column + 1 < numColumns; column += 2)
+    {
+        float x0 = -width * 0.45f + column * (width * 0.9f / (numColumns - 1)) + 40.0f;
+        float x1 = x0 + width * 0.9f / (numColumns - 1) - 80.0f;
+        XMFLOAT3 corners[4] = {
+            XMFLOAT3(x0, 100.0f, -depth * 0.3f), XMFLOAT3(x1, 100.0f, -depth * 0.3f + 30.0f),
+            XMFLOAT3(x1, 450.0f, -depth * 0.3f + 30.0f), XMFLOAT3(x0, 450.0f, -depth * 0.3f)
+        };
+        BenchSceneAddQuad(pScene, corners, cloth);
+    }
+}
+
+static bool BenchSceneLoadObj(const char* objPath, BenchScene* pScene)
+{
+    std::string basePath = objPath;
+    size_t slash = basePath.find_last_of("/\\");
+    basePath = slash == std::string::npos ? std::string() : basePath.substr(0, slash + 1);
+
+    std::vector<tinyobj::shape_t> shapes;
+    std::vector<tinyobj::material_t> materials;
+    std::string err;
+    if (!tinyobj::LoadObj(shapes, materials, err, objPath, basePath.c_str()))
+        return false;
+
+    // every texture is loaded before any triangle points at one
+    std::map<std::string, int> textureIDs;
+    std::vector<int> materialTextureIDs(materials.size(), -1);
+    for (size_t materialID = 0; materialID < materials.size(); materialID++)
+    {
+        std::string name = materials[materialID].diffuse_texname;
+        if (name.empty())
+            continue;
+        std::replace(name.begin(), name.end(), '\\', '/');
+
+        auto found = textureIDs.find(name);
+        if (found != textureIDs.end())
+        {
+            materialTextureIDs[materialID] = found->second;
+            continue;
+        }
+
+        int width, height, comp;
+        stbi_uc* pTexels = stbi_load((basePath + name).c_str(), &width, &height, &comp, 4);
+        if (!pTexels)
+            continue;
+
+        VoxelizerTexture texture;
+        VoxelizerCreateTexture(pTexels, width, height, kBenchSceneTextureSize, &texture);
+        stbi_image_free(pTexels);
+
+        textureIDs[name] = (int)pScene->Textures.size();
+        materialTextureIDs[materialID] = (int)pScene->Textures.size();
+        pScene->Textures.push_back(std::move(texture));
+    }
+
+    for (const tinyobj::shape_t& shape : shapes)
+    {
+        const tinyobj::mesh_t& mesh = shape.mesh;
+        for (size_t face = 0; face < mesh.indices.size() / 3; face++)
+        {
+            int materialID = face < mesh.material_ids.size() ? mesh.material_ids[face] : -1;
+
+            VoxelizerTriangle triangle;
+            triangle.Albedo = XMFLOAT3(1.0f, 1.0f, 1.0f);
+            triangle.pAlbedoTexture = NULL;
+            if (materialID >= 0 && materialID < (int)materials.size())
+            {
+                triangle.Albedo = XMFLOAT3(materials[materialID].diffuse[0], materials[materialID].diffuse[1], materials[materialID].diffuse[2]);
+                if (materialTextureIDs[materialID] != -1 && !mesh.texcoords.empty())
+                    triangle.pAlbedoTexture = &pScene->Textures[materialTextureIDs[materialID]];
+            }
+
+            for (int v = 0; v < 3; v++)
+            {
+                unsigned int index = mesh.indices[face * 3 + v];
+                triangle.Positions[v] = XMFLOAT3(mesh.positions[index * 3 + 0], mesh.positions[index * 3 + 1], mesh.positions[index * 3 + 2]);
+                triangle.TexCoords[v] = mesh.texcoords.empty() ? XMFLOAT2(0.0f, 0.0f) : XMFLOAT2(mesh.texcoords[index * 2 + 0], mesh.texcoords[index * 2 + 1]);
+            }
+
+            pScene->Triangles.push_back(triangle);
+        }
+    }
+
+    return true;
+}
+
+bool BenchSceneLoad(const char* objPath, BenchScene* pScene)
+{
+    pScene->Triangles.clear();
+    pScene->Textures.clear();
+
+    if (!objPath)
+    {
+        BenchSceneBuildCourtyard(pScene);
+        return true;
+    }
+
+    return BenchSceneLoadObj(objPath, pScene);
+}
+
+void BenchSceneGetGrid(const BenchScene& scene, int gridSize, VoxelGridDesc* pGrid)
+{
+    float sceneMin[3] = { FLT_MAX, FLT_MAX, FLT_MAX };
+    float sceneMax[3] = { -FLT_MAX, -FLT_MAX, -FLT_MAX };
+    for (const VoxelizerTriangle& triangle : scene.Triangles)
+    {
+        for (const XMFLOAT3& position : triangle.Positions)
+        {
+            const float* p = &position.x;
+            for (int axis = 0; axis < 3; axis++)
+            {
+                sceneMin[axis] = std::min(sceneMin[axis], p[axis]);
+                sceneMax[axis] = std::max(sceneMax[axis], p[axis]);
+            }
+        }
+    }
+
+    float extent = std::max(sceneMax[0] - sceneMin[0], std::max(sceneMax[1] - sceneMin[1], sceneMax[2] - sceneMin[2])) * 1.001f;
+
+    pGrid->Origin = XMFLOAT3(sceneMin[0], sceneMin[1], sceneMin[2]);
+    pGrid->VoxelSize = extent / gridSize;
+    pGrid->Size = gridSize;
+}
\ No newline at end of file
@@ -0,0 +1,21 @@
+#pragma once
+
+#include "voxelizer.h"
+
+#include <vector>
+
+// The scene voxelized by the voxel benchmarks, fit into a cubic grid the way the app fits its scene.
+// An obj file is loaded with its diffuse colors and textures, which is how Sponza is measured. Without one, a
+// courtyard of walls, arches and columns is built, which has the same kind of repeated geometry.
+
+struct BenchScene
+{
+    std::vector<VoxelizerTriangle> Triangles;
+    std::vector<VoxelizerTexture> Textures; // referenced by the triangles, so they are never resized after loading
+};
+
+// Returns false if the obj file couldn't be loaded. objPath can be NULL for the courtyard.
+bool BenchSceneLoad(const char* objPath, BenchScene* pScene);
+
+// Padded a bit so nothing lies exactly on the far boundary, like the app's grid.
+void BenchSceneGetGrid(const BenchScene& scene, int gridSize, VoxelGridDesc* pGrid);
\ No newline at end of file
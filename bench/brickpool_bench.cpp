@@ -0,0 +1,114 @@
+// Memory of the sparse brick pools against the dense volumes at every grid size, and the cost of a point and a
+// trilinear lookup into the finest pool.
+//
+//   brickpool_bench [scene.obj] [lookup grid size]
+
+#include "bench.h"
+#include "benchscene.h"
+
+#include "brickpool.h"
+
+#include <random>
+#include <cstdio>
+#include <cstdlib>
+
+using namespace DirectX;
+
+static const int kNumBrickPoolBenchLookups = 1 << 20;
+
+static void BrickPoolBenchBuildMips(const BenchScene& scene, int gridSize, std::vector<BrickPool>* pPools)
+{
+    VoxelGridDesc grid;
+    BenchSceneGetGrid(scene, gridSize, &grid);
+
+    pPools->clear();
+    pPools->emplace_back();
+    BrickPoolBuild(scene.Triangles, grid, &pPools->back());
+
+    while (pPools->back().Size > 1)
+    {
+        BrickPool mip;
+        BrickPoolBuildMip(pPools->back(), &mip);
+        pPools->push_back(std::move(mip));
+    }
+}
+
+static void BrickPoolBenchMemory(const BenchScene& scene)
+{
+    printf("grid  dense MB  sparse MB  bricks\n");
+    for (int gridSize = 64; gridSize <= 512; gridSize *= 2)
+    {
+        std::vector<BrickPool> pools;
+        BrickPoolBenchBuildMips(scene, gridSize, &pools);
+
+        uint64_t sparseBytes = 0;
+        int numBricks = 0;
+        for (const BrickPool& pool : pools)
+        {
+            sparseBytes += BrickPoolGetMemorySize(pool);
+            numBricks += (int)(pool.Bricks.size() / kBrickPoolVoxelsPerBrick);
+        }
+
+        printf("%4d  %8.1f  %9.1f  %6d\n", gridSize,
+            BrickPoolGetDenseMemorySize(gridSize) / (1024.0 * 1024.0),
+            sparseBytes / (1024.0 * 1024.0),
+            numBricks);
+    }
+}
+
+static void BrickPoolBenchLookups(const BenchScene& scene, int gridSize)
+{
+    VoxelGridDesc grid;
+    BenchSceneGetGrid(scene, gridSize, &grid);
+
+    BrickPool pool;
+    BrickPoolBuild(scene.Triangles, grid, &pool);
+
+    // Generate the sample positions up front so only the lookups are timed
+    std::mt19937 rng(1234);
+    std::uniform_real_distribution<float> unorm(0.0f, 1.0f);
+    std::vector<XMFLOAT3> samples(kNumBrickPoolBenchLookups);
+    for (XMFLOAT3& sample : samples)
+    {
+        sample = XMFLOAT3(unorm(rng), unorm(rng), unorm(rng));
+    }
+
+    // accumulate the results so the lookups can't be optimized away
+    uint32_t pointChecksum = 0;
+    double start = BenchGetMilliseconds();
+    for (const XMFLOAT3& sample : samples)
+    {
+        pointChecksum += BrickPoolLoad(pool, (int)(sample.x * pool.Size), (int)(sample.y * pool.Size), (int)(sample.z * pool.Size));
+    }
+    double pointNanoseconds = (BenchGetMilliseconds() - start) * 1e6 / samples.size();
+
+    float trilinearChecksum = 0.0f;
+    start = BenchGetMilliseconds();
+    for (const XMFLOAT3& sample : samples)
+    {
+        trilinearChecksum += BrickPoolSampleTrilinear(pool, sample).w;
+    }
+    double trilinearNanoseconds = (BenchGetMilliseconds() - start) * 1e6 / samples.size();
+
+    BenchKeep((float)pointChecksum + trilinearChecksum);
+
+    printf("%d^3 lookups: point %.1f ns, trilinear %.1f ns\n", gridSize, pointNanoseconds, trilinearNanoseconds);
+}
+
+int main(int argc, char** argv)
+{
+    const char* objPath = argc >= 2 ? argv[1] : NULL;
+    int lookupGridSize = argc >= 3 ? atoi(argv[2]) : 256;
+
+    BenchScene scene;
+    if (!BenchSceneLoad(objPath, &scene))
+    {
+        fprintf(stderr, "Couldn't load %s\n", objPath);
+        return 1;
+    }
+    printf("%d triangles\n", (int)scene.Triangles.size());
+
+    BrickPoolBenchMemory(scene);
+    BrickPoolBenchLookups(scene, lookupGridSize);
+    return 0;
+}
\ No newline at end of file
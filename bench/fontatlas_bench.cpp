@@ -0,0 +1,120 @@
+// Startup time and memory of the ImGui font atlas, baked and rasterized on demand, with Latin glyph ranges and Latin text,
+// and with the full Chinese ranges and CJK text as well. Startup is building the atlas and drawing a first frame of the
+// text, and memory is ImGui's heap at its peak. That is mostly the atlas pixels, and the font's lookup tables, which
+// are as long as the highest codepoint it has a glyph for.
+//
+//   fontatlas_bench [ttf file] [pixel size]
+//
+// The embedded default font has no CJK glyphs, so the CJK numbers only mean something with a CJK font like Noto Sans CJK.
+
+#include "bench.h"
+
+#include "imgui.h"
+
+#include <cstdio>
+#include <cstdlib>
+#include <cstring>
+
+// The app's page size
+static const int kFontAtlasBenchOnDemandPageWidth = 256;
+
+static const char* const kFontAtlasBenchLatinText = "The quick brown fox jumps over the lazy dog. 0123456789 (%.3f ms) [+/-]";
+static const char* const kFontAtlasBenchCJKText = u8"你好，世界。字体图集按需光栅化。こんにちは、テキスト。";
+
+// ImGui's heap, with the size of each allocation in front of it
+static size_t g_FontAtlasBenchHeapBytes;
+static size_t g_FontAtlasBenchPeakHeapBytes;
+
+static void* FontAtlasBenchAlloc(size_t size)
+{
+    size_t* pBlock = (size_t*)malloc(size + 16);
+    pBlock[0] = size;
+    g_FontAtlasBenchHeapBytes += size;
+    if (g_FontAtlasBenchHeapBytes > g_FontAtlasBenchPeakHeapBytes)
+        g_FontAtlasBenchPeakHeapBytes = g_FontAtlasBenchHeapBytes;
+    return (char*)pBlock + 16;
+}
+
+static void FontAtlasBenchFree(void* p)
+{
+    if (!p)
+        return;
+
+    size_t* pBlock = (size_t*)((char*)p - 16);
+    g_FontAtlasBenchHeapBytes -= pBlock[0];
+    free(pBlock);
+}
+
+static void FontAtlasBenchRun(const char* label, const char* ttfPath, float pixelSize, const ImWchar* glyphRanges, bool onDemand, bool cjk)
+{
+    ImGuiIO& io = ImGui::GetIO();
+    size_t heapBytesBefore = g_FontAtlasBenchHeapBytes;
+    g_FontAtlasBenchPeakHeapBytes = heapBytesBefore;
+
+    double start = BenchGetMilliseconds();
+
+    // everything the atlas holds is allocated through ImGui
+    ImFontAtlas atlas;
+    ImFontAtlas* pAtlas = &atlas;
+    pAtlas->RasterizeOnDemand = onDemand;
+    pAtlas->TexDesiredWidth = onDemand ? kFontAtlasBenchOnDemandPageWidth : 0;
+
+    ImFontConfig fontConfig;
+    fontConfig.GlyphRanges = glyphRanges;
+    if (ttfPath)
+        pAtlas->AddFontFromFileTTF(ttfPath, pixelSize, &fontConfig);
+    else
+        pAtlas->AddFontDefault(&fontConfig);
+
+    unsigned char* pixels;
+    int width, height;
+    pAtlas->GetTexDataAsAlpha8(&pixels, &width, &height);
+    pAtlas->TexID = (ImTextureID)1;
+    double buildMilliseconds = BenchGetMilliseconds() - start;
+
+    ImFontAtlas* pPreviousAtlas = io.Fonts;
+    io.Fonts = pAtlas;
+
+    ImGui::NewFrame();
+    ImGui::SetNextWindowPos(ImVec2(0.0f, 0.0f), ImGuiSetCond_Always);
+    ImGui::SetNextWindowSize(ImVec2(1000.0f, 200.0f), ImGuiSetCond_Always);
+    ImGui::Begin("Text", NULL, ImGuiWindowFlags_NoSavedSettings);
+    ImGui::TextUnformatted(kFontAtlasBenchLatinText);
+    if (cjk)
+        ImGui::TextUnformatted(kFontAtlasBenchCJKText);
+    ImGui::End();
+    ImGui::Render();
+    double startupMilliseconds = BenchGetMilliseconds() - start;
+
+    printf("%-24s %8.2f ms build, %8.2f ms to the first frame, %6d glyphs, %5dx%-5d atlas, %8.1f KB peak heap\n",
+        label, buildMilliseconds, startupMilliseconds, pAtlas->Fonts[0]->Glyphs.Size, width, height,
+        (g_FontAtlasBenchPeakHeapBytes - heapBytesBefore) / 1024.0);
+
+    io.Fonts = pPreviousAtlas;
+}
+
+int main(int argc, char** argv)
+{
+    const char* ttfPath = argc >= 2 ? argv[1] : NULL;
+    float pixelSize = argc >= 3 ? (float)atof(argv[2]) : 16.0f;
+
+    ImGuiIO& io = ImGui::GetIO();
+    io.MemAllocFn = FontAtlasBenchAlloc;
+    io.MemFreeFn = FontAtlasBenchFree;
+    io.DisplaySize = ImVec2(1280.0f, 720.0f);
+    io.DeltaTime = 1.0f / 60.0f;
+    io.IniFilename = NULL;
+
+    printf("%s\n", ttfPath ? ttfPath : "default font");
+
+    // a first frame, so the window and draw lists that the runs share are already allocated
+    FontAtlasBenchRun("warm up", ttfPath, pixelSize, io.Fonts->GetGlyphRangesDefault(), true, false);
+
+    FontAtlasBenchRun("Latin, baked", ttfPath, pixelSize, io.Fonts->GetGlyphRangesDefault(), false, false);
+    FontAtlasBenchRun("Latin, on demand", ttfPath, pixelSize, io.Fonts->GetGlyphRangesDefault(), true, false);
+    FontAtlasBenchRun("CJK, baked", ttfPath, pixelSize, io.Fonts->GetGlyphRangesChinese(), false, true);
+    FontAtlasBenchRun("CJK, on demand", ttfPath, pixelSize, io.Fonts->GetGlyphRangesChinese(), true, true);
+
+    ImGui::Shutdown();
+    return 0;
+}
\ No newline at end of file
@@ -0,0 +1,86 @@
+// Anti-aliased tessellation of a 10k-point plot line, thin and thick, of a closed line and of convex fills, per call.
+// imguidraw_scalar_bench is the same benchmark with ImGui built with IMGUI_DISABLE_SSE, for comparison.
+//
+//   imguidraw_bench [points] [calls]
+
+#include "bench.h"
+
+#include "imgui.h"
+
+#include <cmath>
+#include <vector>
+#include <cstdio>
+#include <cstdlib>
+
+template<class DrawFunc>
+static void ImGuiDrawBenchRun(const char* label, int numCalls, const DrawFunc& draw)
+{
+    ImDrawList drawList;
+
+    // the first call grows the buffers, which the others reuse like the draw lists of later frames
+    double bestMicroseconds = 1e30;
+    for (int call = 0; call <= numCalls; call++)
+    {
+        drawList.Clear();
+        drawList.PushClipRectFullScreen();
+        drawList.PushTextureID(NULL);
+
+        double start = BenchGetMilliseconds();
+        draw(&drawList);
+        double microseconds = (BenchGetMilliseconds() - start) * 1e3;
+        if (call > 0 && microseconds < bestMicroseconds)
+            bestMicroseconds = microseconds;
+    }
+
+    printf("%-16s %8.1f us, %7d vertices, %7d indices\n", label, bestMicroseconds, drawList.VtxBuffer.Size, drawList.IdxBuffer.Size);
+}
+
+int main(int argc, char** argv)
+{
+    int numPoints = argc >= 2 ? atoi(argv[1]) : 10000;
+    int numCalls = argc >= 3 ? atoi(argv[2]) : 200;
+
+    // a noisy plot across a 1000 pixel wide graph
+    std::vector<ImVec2> plot(numPoints);
+    for (int i = 0; i < numPoints; i++)
+    {
+        float x = 10.0f + 1000.0f * i / numPoints;
+        plot[i] = ImVec2(x, 300.0f + 100.0f * std::sin(i * 0.01f) + 20.0f * std::sin(i * 0.37f));
+    }
+
+    // convex polygons with many points, like circles
+    const int kNumCirclePoints = 2000;
+    std::vector<ImVec2> circle(kNumCirclePoints);
+    for (int i = 0; i < kNumCirclePoints; i++)
+    {
+        float angle = 2.0f * 3.14159265f * i / kNumCirclePoints;
+        circle[i] = ImVec2(500.0f + 200.0f * std::cos(angle), 400.0f + 200.0f * std::sin(angle));
+    }
+
+    printf("%d points, best of %d calls\n", numPoints, numCalls);
+
+    ImGuiDrawBenchRun("thin polyline", numCalls, [&](ImDrawList* pDrawList)
+    {
+        pDrawList->AddPolyline(plot.data(), numPoints, 0xFFFFFFFF, false, 1.0f, true);
+    });
+
+    ImGuiDrawBenchRun("thick polyline", numCalls, [&](ImDrawList* pDrawList)
+    {
+        pDrawList->AddPolyline(plot.data(), numPoints, 0xFFFFFFFF, false, 3.0f, true);
+    });
+
+    ImGuiDrawBenchRun("2k closed line", numCalls, [&](ImDrawList* pDrawList)
+    {
+        pDrawList->AddPolyline(circle.data(), kNumCirclePoints, 0xFFFFFFFF, true, 1.0f, true);
+    });
+
+    ImGuiDrawBenchRun("5x2k convex fill", numCalls, [&](ImDrawList* pDrawList)
+    {
+        for (int i = 0; i < 5; i++)
+        {
+            pDrawList->AddConvexPolyFilled(circle.data(), kNumCirclePoints, 0xFFFFFFFF, true);
+        }
+    });
+
+    return 0;
+}
\ No newline at end of file
@@ -0,0 +1,147 @@
+// ImGuiStorage with 100k keys, which is what a large tree of nodes keeps open states in, and 1000 windows, which are
+// looked up by name every time one begins or is set by name.
+//
+//   imguistorage_bench [keys] [windows]
+
+#include "bench.h"
+
+#include "imgui.h"
+
+#include <random>
+#include <string>
+#include <vector>
+#include <cstdio>
+#include <cstdlib>
+
+static void ImGuiStorageBenchKeys(int numKeys)
+{
+    // IDs are hashes, so they are spread over the whole range
+    std::mt19937 rng(1234);
+    std::vector<ImGuiID> keys(numKeys);
+    for (ImGuiID& key : keys)
+    {
+        key = (ImGuiID)rng();
+    }
+
+    ImGuiStorage storage;
+
+    double start = BenchGetMilliseconds();
+    for (int i = 0; i < numKeys; i++)
+    {
+        storage.SetInt(keys[i], i);
+    }
+    double insertMilliseconds = BenchGetMilliseconds() - start;
+
+    const int kNumLookups = 1000000;
+    std::uniform_int_distribution<int> keyIndex(0, numKeys - 1);
+    std::vector<ImGuiID> lookupKeys(kNumLookups);
+    for (ImGuiID& key : lookupKeys)
+    {
+        key = keys[keyIndex(rng)];
+    }
+
+    start = BenchGetMilliseconds();
+    int sum = 0;
+    for (ImGuiID key : lookupKeys)
+    {
+        sum += storage.GetInt(key, -1);
+    }
+    double hitMilliseconds = BenchGetMilliseconds() - start;
+    BenchKeep(sum);
+
+    // almost none of these are in the storage
+    start = BenchGetMilliseconds();
+    sum = 0;
+    for (ImGuiID key : lookupKeys)
+    {
+        sum += storage.GetInt(key ^ 0x5BD1E995u, -1);
+    }
+    double missMilliseconds = BenchGetMilliseconds() - start;
+    BenchKeep(sum);
+
+    start = BenchGetMilliseconds();
+    for (ImGuiID key : lookupKeys)
+    {
+        (*storage.GetIntRef(key))++;
+    }
+    double refMilliseconds = BenchGetMilliseconds() - start;
+
+    start = BenchGetMilliseconds();
+    storage.SetAllInt(0);
+    double setAllMilliseconds = BenchGetMilliseconds() - start;
+
+    printf("%d keys: inserted in %.2f ms\n", numKeys, insertMilliseconds);
+    printf("%d lookups: %.2f ms hits, %.2f ms misses, %.2f ms through refs\n", kNumLookups, hitMilliseconds, missMilliseconds, refMilliseconds);
+    printf("SetAllInt: %.3f ms\n", setAllMilliseconds);
+}
+
+static void ImGuiStorageBenchFrame(int numWindows, const std::vector<std::string>& names)
+{
+    ImGui::NewFrame();
+    for (int window = 0; window < numWindows; window++)
+    {
+        ImGui::SetNextWindowPos(ImVec2((float)(window % 40) * 30.0f, (float)(window / 40) * 25.0f), ImGuiSetCond_FirstUseEver);
+        ImGui::SetNextWindowSize(ImVec2(120.0f, 60.0f), ImGuiSetCond_FirstUseEver);
+        ImGui::Begin(names[window].c_str(), NULL, ImGuiWindowFlags_NoSavedSettings);
+        ImGui::Text("%d", window);
+        ImGui::End();
+    }
+    ImGui::Render();
+}
+
+static void ImGuiStorageBenchWindows(int numWindows)
+{
+    ImGuiIO& io = ImGui::GetIO();
+    io.DisplaySize = ImVec2(1280.0f, 720.0f);
+    io.DeltaTime = 1.0f / 60.0f;
+    io.IniFilename = NULL;
+
+    unsigned char* pixels;
+    int width, height;
+    io.Fonts->GetTexDataAsAlpha8(&pixels, &width, &height);
+    io.Fonts->TexID = (ImTextureID)1;
+
+    std::vector<std::string> names(numWindows);
+    for (int window = 0; window < numWindows; window++)
+    {
+        names[window] = "Window " + std::to_string(window);
+    }
+
+    double start = BenchGetMilliseconds();
+    ImGuiStorageBenchFrame(numWindows, names);
+    double firstFrameMilliseconds = BenchGetMilliseconds() - start;
+
+    const int kNumFrames = 200;
+    start = BenchGetMilliseconds();
+    for (int frame = 0; frame < kNumFrames; frame++)
+    {
+        ImGuiStorageBenchFrame(numWindows, names);
+    }
+    double frameMilliseconds = (BenchGetMilliseconds() - start) / kNumFrames;
+
+    // every call finds the window by its name
+    const int kNumLookups = 100000;
+    ImGui::NewFrame();
+    start = BenchGetMilliseconds();
+    for (int lookup = 0; lookup < kNumLookups; lookup++)
+    {
+        ImGui::SetWindowCollapsed(names[(lookup * 7919) % numWindows].c_str(), false);
+    }
+    double lookupMilliseconds = BenchGetMilliseconds() - start;
+    ImGui::Render();
+
+    printf("%d windows: first frame %.2f ms, steady frame %.3f ms\n", numWindows, firstFrameMilliseconds, frameMilliseconds);
+    printf("%d windows set by name: %.2f ms\n", kNumLookups, lookupMilliseconds);
+
+    ImGui::Shutdown();
+}
+
+int main(int argc, char** argv)
+{
+    int numKeys = argc >= 2 ? atoi(argv[1]) : 100000;
+    int numWindows = argc >= 3 ? atoi(argv[2]) : 1000;
+
+    ImGuiStorageBenchKeys(numKeys);
+    ImGuiStorageBenchWindows(numWindows);
+    return 0;
+}
\ No newline at end of file
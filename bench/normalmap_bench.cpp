@@ -0,0 +1,86 @@
+// Times the height to normal map conversion of the bump textures on a noisy height map, on one thread and on every
+// thread, against evaluating the formula that the shader used per pixel, and measures how far the quantized normals
+// are from that formula.
+//
+//   normalmap_bench [size]
+
+#include "bench.h"
+
+#include "normalmap.h"
+#include "parallel.h"
+
+#include <algorithm>
+#include <cmath>
+#include <random>
+#include <cstdio>
+#include <cstdlib>
+
+// The scene's bump scale, which stands in for the shader's 3000 / depth at a depth of 1000.
+static const float kNormalMapBenchScale = 3.0f;
+
+int main(int argc, char** argv)
+{
+    int size = argc >= 2 ? atoi(argv[1]) : 2048;
+
+    std::mt19937 rng(1234);
+    std::uniform_int_distribution<int> noise(-24, 24);
+
+    std::vector<uint8_t> heights((size_t)size * size);
+    for (int y = 0; y < size; y++)
+    {
+        for (int x = 0; x < size; x++)
+        {
+            float wave = std::sin(x * 0.05f) * std::cos(y * 0.03f);
+            heights[(size_t)y * size + x] = (uint8_t)std::min(std::max(128 + (int)(wave * 80.0f) + noise(rng), 0), 255);
+        }
+    }
+
+    double numMegatexels = (double)size * size / 1e6;
+
+    std::vector<float> referenceNormals(heights.size() * 3);
+    double start = BenchGetMilliseconds();
+    for (int y = 0; y < size; y++)
+    {
+        for (int x = 0; x < size; x++)
+        {
+            auto height = [&](int hx, int hy)
+            {
+                return heights[(size_t)((hy + size) % size) * size + (hx + size) % size] / 255.0f;
+            };
+
+            NormalMapFromHeightsReference(
+                height(x - 1, y), height(x + 1, y), height(x, y - 1), height(x, y + 1),
+                kNormalMapBenchScale, &referenceNormals[((size_t)y * size + x) * 3]);
+        }
+    }
+    printf("%dx%d\n", size, size);
+    printf("per pixel formula: %.0f Mtexels/s\n", numMegatexels * 1000.0 / (BenchGetMilliseconds() - start));
+
+    std::vector<int8_t> normals(heights.size() * 2);
+
+    int maxThreads = ParallelGetDefaultNumThreads();
+    for (int numThreads = 1; ; numThreads = maxThreads)
+    {
+        start = BenchGetMilliseconds();
+        NormalMapFromHeightMap(heights.data(), size, size, kNormalMapBenchScale, normals.data(), numThreads);
+        printf("%d threads: %.0f Mtexels/s\n", numThreads, numMegatexels * 1000.0 / (BenchGetMilliseconds() - start));
+
+        if (numThreads == maxThreads)
+            break;
+    }
+
+    float minCosine = 1.0f;
+    for (size_t i = 0; i < heights.size(); i++)
+    {
+        // reconstructed like the shader does
+        float nx = normals[i * 2] / 127.0f;
+        float ny = normals[i * 2 + 1] / 127.0f;
+        float nz = std::sqrt(std::max(0.0f, 1.0f - nx * nx - ny * ny));
+
+        const float* reference = &referenceNormals[i * 3];
+        float cosine = (nx * reference[0] + ny * reference[1] + nz * reference[2]) / std::sqrt(nx * nx + ny * ny + nz * nz);
+        minCosine = std::min(minCosine, cosine);
+    }
+    printf("max error: %.2f degrees\n", std::acos(std::min(minCosine, 1.0f)) * 180.0f / 3.14159265f);
+    return 0;
+}
\ No newline at end of file
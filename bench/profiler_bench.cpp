@@ -0,0 +1,88 @@
+// The cost of a zone: empty zones on one thread, nested zones on every thread at once while the collector drains
+// them like it does once per frame, and the collector's own cost per zone.
+//
+//   profiler_bench [zones per thread]
+
+#include "bench.h"
+
+#include "profiler.h"
+#include "parallel.h"
+
+#include <atomic>
+#include <thread>
+#include <vector>
+#include <cstdio>
+#include <cstdlib>
+
+// How often the collector drains the buffers, like a 60 Hz frame loop.
+static const double kProfilerBenchCollectMilliseconds = 16.0;
+
+int main(int argc, char** argv)
+{
+    int numZones = argc >= 2 ? atoi(argv[1]) : 10000000;
+
+    ProfilerInit();
+
+    printf("empty zone on one thread: %.1f ns\n", ProfilerMeasureZoneOverheadNanoseconds(numZones));
+
+    int maxThreads = ParallelGetDefaultNumThreads();
+    for (int numThreads = 1; ; numThreads = maxThreads)
+    {
+        std::atomic<int> numRunningThreads(numThreads);
+        std::vector<double> threadNanoseconds(numThreads);
+        std::vector<std::thread> threads;
+        for (int threadIndex = 0; threadIndex < numThreads; threadIndex++)
+        {
+            threads.emplace_back([&, threadIndex]
+            {
+                double start = BenchGetMilliseconds();
+                for (int zone = 0; zone < numZones; zone += 3)
+                {
+                    PROFILE_ZONE("Outer");
+                    {
+                        PROFILE_ZONE("Middle");
+                        PROFILE_ZONE("Inner");
+                    }
+                }
+                threadNanoseconds[threadIndex] = (BenchGetMilliseconds() - start) * 1e6 / numZones;
+                numRunningThreads--;
+            });
+        }
+
+        double collectMilliseconds = 0.0;
+        uint64_t numDroppedBefore = ProfilerGetNumDroppedEvents();
+        while (numRunningThreads > 0)
+        {
+            double start = BenchGetMilliseconds();
+            ProfilerCollect(0.0);
+            collectMilliseconds += BenchGetMilliseconds() - start;
+
+            while (numRunningThreads > 0 && BenchGetMilliseconds() - start < kProfilerBenchCollectMilliseconds)
+            {
+                std::this_thread::yield();
+            }
+        }
+
+        for (std::thread& thread : threads)
+        {
+            thread.join();
+        }
+        ProfilerCollect(0.0);
+
+        double averageNanoseconds = 0.0;
+        for (double nanoseconds : threadNanoseconds)
+        {
+            averageNanoseconds += nanoseconds / numThreads;
+        }
+
+        uint64_t numDropped = ProfilerGetNumDroppedEvents() - numDroppedBefore;
+        printf("%d threads, nested zones: %.1f ns per zone, collect %.1f ns per zone, %.1f%% dropped\n",
+            numThreads, averageNanoseconds, collectMilliseconds * 1e6 / ((double)numZones * numThreads),
+            100.0 * numDropped / ((double)numZones * numThreads));
+
+        if (numThreads == maxThreads)
+            break;
+    }
+
+    return 0;
+}
\ No newline at end of file
@@ -0,0 +1,82 @@
+// The CPU cost of a frame of 50 static windows of text, built every frame and retained, from NewFrame to Render.
+//
+//   retainedgui_bench [windows] [frames]
+
+#include "bench.h"
+
+#include "retainedgui.h"
+
+#include <cstdio>
+#include <cstdlib>
+
+static const int kRetainedGUIBenchLinesPerWindow = 20;
+
+// Returns the number of vertices in the frame.
+static int RetainedGUIBenchFrame(int numWindows)
+{
+    ImGui::NewFrame();
+
+    for (int window = 0; window < numWindows; window++)
+    {
+        char name[32];
+        snprintf(name, sizeof(name), "Window %d", window);
+
+        ImGui::SetNextWindowPos(ImVec2((float)(window % 10) * 125.0f, (float)(window / 10) * 140.0f), ImGuiSetCond_Always);
+        ImGui::SetNextWindowSize(ImVec2(120.0f, 135.0f), ImGuiSetCond_Always);
+        ImGui::Begin(name, NULL, ImGuiWindowFlags_NoMove | ImGuiWindowFlags_NoResize | ImGuiWindowFlags_NoSavedSettings);
+        if (RetainedGUIBegin("stats", (ImU32)window))
+        {
+            for (int line = 0; line < kRetainedGUIBenchLinesPerWindow; line++)
+            {
+                ImGui::Text("Counter %d: %d.%03d ms", line, window, line * 37 % 1000);
+            }
+        }
+        RetainedGUIEnd();
+        ImGui::End();
+    }
+
+    ImGui::Render();
+    return ImGui::GetDrawData()->TotalVtxCount;
+}
+
+int main(int argc, char** argv)
+{
+    int numWindows = argc >= 2 ? atoi(argv[1]) : 50;
+    int numFrames = argc >= 3 ? atoi(argv[2]) : 1000;
+
+    ImGuiIO& io = ImGui::GetIO();
+    io.DisplaySize = ImVec2(1280.0f, 720.0f);
+    io.DeltaTime = 1.0f / 60.0f;
+    io.IniFilename = NULL;
+
+    unsigned char* pixels;
+    int width, height;
+    io.Fonts->GetTexDataAsAlpha8(&pixels, &width, &height);
+    io.Fonts->TexID = (ImTextureID)1;
+
+    printf("%d windows of %d lines\n", numWindows, kRetainedGUIBenchLinesPerWindow);
+
+    for (int retained = 0; retained < 2; retained++)
+    {
+        RetainedGUISetEnabled(retained != 0);
+
+        // settles the windows, and captures the regions
+        int numVertices = 0;
+        for (int frame = 0; frame < 3; frame++)
+        {
+            numVertices = RetainedGUIBenchFrame(numWindows);
+        }
+
+        double start = BenchGetMilliseconds();
+        for (int frame = 0; frame < numFrames; frame++)
+        {
+            BenchKeep(RetainedGUIBenchFrame(numWindows));
+        }
+        double frameMilliseconds = (BenchGetMilliseconds() - start) / numFrames;
+
+        printf("%s: %.3f ms per frame, %d vertices\n", retained ? "retained" : "immediate", frameMilliseconds, numVertices);
+    }
+
+    ImGui::Shutdown();
+    return 0;
+}
\ No newline at end of file
@@ -0,0 +1,157 @@
+// Times the shader loading of the app's startup with an empty shader cache and with a full one: the scene's vertex
+// shader and every permutation of its pixel shader, keyed, looked up, and compiled on a miss.
+//
+//   shadercache_bench [shader directory] [iterations]
+//
+// Run it from the repository, or give the directory of scene.hlsl. On Windows misses are compiled with
+// D3DCompileFromFile like the app does. Elsewhere there is no compiler, so a miss inserts a stand-in blob,
+// and the cold time is only the cache's own share of a cold startup.
+
+#include "bench.h"
+
+#include "shadercache.h"
+#include "shaderpermutation.h"
+
+#include <algorithm>
+#include <string>
+#include <vector>
+#include <cstdio>
+#include <cstdlib>
+
+#ifdef _WIN32
+#define NOMINMAX
+#define WIN32_LEAN_AND_MEAN
+#include <Windows.h>
+#include <d3dcompiler.h>
+#pragma comment(lib, "d3dcompiler.lib")
+#endif
+
+// The same shaders as SceneInit, with the flags of a release build.
+static void ShaderCacheBenchGetShaders(const std::string& directory, std::vector<ShaderCacheKeyDesc>* pShaders)
+{
+    ShaderCacheKeyDesc shader;
+    shader.Path = directory + "/scene.hlsl";
+    shader.Flags = 1 << 15; // D3DCOMPILE_OPTIMIZATION_LEVEL3
+
+    shader.EntryPoint = "VSmain";
+    shader.Target = "vs_5_0";
+    pShaders->push_back(shader);
+
+    shader.EntryPoint = "PSmain";
+    shader.Target = "ps_5_0";
+    for (uint32_t permutation = 0; permutation < kNumMaterialPermutations; permutation++)
+    {
+        ShaderPermutationGetDefines(kMaterialFeatureDefines, kNumMaterialFeatures, permutation, &shader.Defines);
+        pShaders->push_back(shader);
+    }
+}
+
+static bool ShaderCacheBenchCompile(const ShaderCacheKeyDesc& desc, std::vector<uint8_t>* pBlob)
+{
+#ifdef _WIN32
+    std::vector<D3D_SHADER_MACRO> macros;
+    for (const ShaderDefine& define : desc.Defines)
+    {
+        D3D_SHADER_MACRO macro = { define.Name.c_str(), define.Value.c_str() };
+        macros.push_back(macro);
+    }
+    D3D_SHADER_MACRO endMacro = { NULL, NULL };
+    macros.push_back(endMacro);
+
+    std::wstring wpath(desc.Path.begin(), desc.Path.end());
+    ID3DBlob* pCode = NULL;
+    ID3DBlob* pErrorMsgs = NULL;
+    HRESULT hr = D3DCompileFromFile(wpath.c_str(), macros.data(), D3D_COMPILE_STANDARD_FILE_INCLUDE, desc.EntryPoint.c_str(), desc.Target.c_str(), desc.Flags, 0, &pCode, &pErrorMsgs);
+    if (pErrorMsgs)
+        pErrorMsgs->Release();
+    if (FAILED(hr))
+        return false;
+
+    const uint8_t* pBytes = (const uint8_t*)pCode->GetBufferPointer();
+    pBlob->assign(pBytes, pBytes + pCode->GetBufferSize());
+    pCode->Release();
+    return true;
+#else
+    // about the size of the compiled scene shaders
+    std::string source;
+    if (!ShaderCacheReadFile(desc.Path, &source))
+        return false;
+    pBlob->assign(source.begin(), source.end());
+    pBlob->resize(std::max(pBlob->size(), (size_t)8192));
+    return true;
+#endif
+}
+
+// One startup: opens the cache, loads every shader through it, and saves it if anything was compiled.
+static double ShaderCacheBenchStartup(const std::string& cachePath, const std::vector<ShaderCacheKeyDesc>& shaders, int* pNumMisses)
+{
+    double start = BenchGetMilliseconds();
+
+    ShaderCache cache;
+    ShaderCacheOpen(cachePath.c_str(), &cache);
+
+    *pNumMisses = 0;
+    std::vector<uint8_t> blob;
+    for (const ShaderCacheKeyDesc& shader : shaders)
+    {
+        uint64_t key = ShaderCacheComputeKey(shader, ShaderCacheReadFile);
+        if (ShaderCacheFind(&cache, key))
+            continue;
+
+        (*pNumMisses)++;
+        if (!ShaderCacheBenchCompile(shader, &blob))
+        {
+            fprintf(stderr, "Couldn't compile %s %s\n", shader.Path.c_str(), shader.EntryPoint.c_str());
+            exit(1);
+        }
+        ShaderCacheInsert(&cache, key, blob.data(), blob.size());
+    }
+
+    if (cache.Dirty && !ShaderCacheSave(&cache))
+    {
+        fprintf(stderr, "Couldn't save %s\n", cachePath.c_str());
+        exit(1);
+    }
+
+    return BenchGetMilliseconds() - start;
+}
+
+int main(int argc, char** argv)
+{
+    std::string directory = argc >= 2 ? argv[1] : "shaders";
+    int numIterations = std::max(argc >= 3 ? atoi(argv[2]) : 10, 1);
+
+    std::vector<ShaderCacheKeyDesc> shaders;
+    ShaderCacheBenchGetShaders(directory, &shaders);
+
+    std::string source;
+    if (!ShaderCacheReadFile(shaders[0].Path, &source))
+    {
+        fprintf(stderr, "Couldn't read %s\n", shaders[0].Path.c_str());
+        return 1;
+    }
+
+    std::string cachePath = "shadercache_bench.bin";
+
+    // the best of the iterations, since anything else running can only make a startup slower
+    double bestColdMilliseconds = 1e30;
+    double bestWarmMilliseconds = 1e30;
+    int numColdMisses = 0, numWarmMisses = 0;
+    for (int iteration = 0; iteration < numIterations; iteration++)
+    {
+        remove(cachePath.c_str());
+        bestColdMilliseconds = std::min(bestColdMilliseconds, ShaderCacheBenchStartup(cachePath, shaders, &numColdMisses));
+        bestWarmMilliseconds = std::min(bestWarmMilliseconds, ShaderCacheBenchStartup(cachePath, shaders, &numWarmMisses));
+    }
+    remove(cachePath.c_str());
+
+#ifdef _WIN32
+    const char* compiler = "D3DCompileFromFile";
+#else
+    const char* compiler = "stand-in blobs, no compiler";
+#endif
+    printf("%d shaders (%s)\n", (int)shaders.size(), compiler);
+    printf("cold: %.2f ms, %d compiled\n", bestColdMilliseconds, numColdMisses);
+    printf("warm: %.2f ms, %d compiled\n", bestWarmMilliseconds, numWarmMisses);
+    return 0;
+}
\ No newline at end of file
@@ -0,0 +1,140 @@
+// Builds the high resolution occupancy DAG once per thread count to measure scaling, then measures its size and
+// the throughput of point queries and raycasts.
+//
+//   voxeldag_bench [scene.obj] [grid size] [output.vdag]
+//
+// The serialized DAG is written to the output file if one is given.
+
+#include "bench.h"
+#include "benchscene.h"
+
+#include "voxeldag.h"
+#include "parallel.h"
+
+#include <algorithm>
+#include <random>
+#include <cstdio>
+#include <cstdlib>
+
+using namespace DirectX;
+
+static const int kNumVoxelDAGBenchPointQueries = 1 << 20;
+static const int kNumVoxelDAGBenchRays = 1 << 18;
+
+static void VoxelDAGBenchBuild(const BenchScene& scene, int gridSize, VoxelDAG* pDAG)
+{
+    VoxelGridDesc grid;
+    BenchSceneGetGrid(scene, gridSize, &grid);
+
+    VoxelDAGStats stats;
+    int maxThreads = ParallelGetDefaultNumThreads();
+    for (int numThreads = 1; ; numThreads = std::min(numThreads * 2, maxThreads))
+    {
+        double start = BenchGetMilliseconds();
+        VoxelDAGBuild(scene.Triangles, grid, numThreads, pDAG, &stats);
+        printf("Built with %d threads in %.0f ms\n", numThreads, BenchGetMilliseconds() - start);
+
+        if (numThreads == maxThreads)
+            break;
+    }
+
+    printf("%d^3: %llu occupied voxels, nodes: %llu octree, %llu DAG, %.1f MB\n", pDAG->Size,
+        (unsigned long long)stats.NumOccupiedVoxels,
+        (unsigned long long)stats.NumOctreeNodes,
+        (unsigned long long)stats.NumDAGNodes,
+        VoxelDAGGetMemorySize(*pDAG) / (1024.0 * 1024.0));
+}
+
+static void VoxelDAGBenchQueries(const VoxelDAG& dag)
+{
+    std::mt19937 rng(1234);
+    std::uniform_int_distribution<int> coordinate(0, dag.Size - 1);
+    std::uniform_real_distribution<float> snorm(-1.0f, 1.0f);
+
+    std::vector<XMINT3> points(kNumVoxelDAGBenchPointQueries);
+    for (XMINT3& point : points)
+    {
+        point = XMINT3(coordinate(rng), coordinate(rng), coordinate(rng));
+    }
+
+    // Rays start anywhere in the volume and go in uniformly distributed directions
+    std::vector<XMFLOAT3> rayOrigins(kNumVoxelDAGBenchRays);
+    std::vector<XMFLOAT3> rayDirections(kNumVoxelDAGBenchRays);
+    for (int i = 0; i < kNumVoxelDAGBenchRays; i++)
+    {
+        rayOrigins[i] = XMFLOAT3((float)coordinate(rng), (float)coordinate(rng), (float)coordinate(rng));
+
+        XMVECTOR direction;
+        do
+        {
+            direction = XMVectorSet(snorm(rng), snorm(rng), snorm(rng), 0.0f);
+        } while (XMVectorGetX(XMVector3LengthSq(direction)) > 1.0f || XMVectorGetX(XMVector3LengthSq(direction)) < 1e-6f);
+        XMStoreFloat3(&rayDirections[i], XMVector3Normalize(direction));
+    }
+
+    int numOccupied = 0;
+    double start = BenchGetMilliseconds();
+    for (const XMINT3& point : points)
+    {
+        numOccupied += VoxelDAGIsOccupied(dag, point.x, point.y, point.z);
+    }
+    double pointMilliseconds = BenchGetMilliseconds() - start;
+
+    int numHits = 0;
+    start = BenchGetMilliseconds();
+    for (int i = 0; i < kNumVoxelDAGBenchRays; i++)
+    {
+        float hitT;
+        numHits += VoxelDAGRaycast(dag, rayOrigins[i], rayDirections[i], (float)dag.Size * 2.0f, &hitT);
+    }
+    double rayMilliseconds = BenchGetMilliseconds() - start;
+
+    BenchKeep(numOccupied + numHits);
+
+    printf("%.1f M points/s, %.2f M rays/s (%.0f%% hit)\n",
+        points.size() / pointMilliseconds / 1e3,
+        kNumVoxelDAGBenchRays / rayMilliseconds / 1e3,
+        numHits * 100.0 / kNumVoxelDAGBenchRays);
+}
+
+static bool VoxelDAGBenchSave(const VoxelDAG& dag, const char* path)
+{
+    std::vector<uint8_t> bytes;
+    VoxelDAGSerialize(dag, &bytes);
+    printf("%.1f MB file\n", bytes.size() / (1024.0 * 1024.0));
+
+    if (!path)
+        return true;
+
+    FILE* fp = fopen(path, "wb");
+    if (!fp)
+        return false;
+
+    bool written = fwrite(bytes.data(), 1, bytes.size(), fp) == bytes.size();
+    return fclose(fp) == 0 && written;
+}
+
+int main(int argc, char** argv)
+{
+    const char* objPath = argc >= 2 ? argv[1] : NULL;
+    int gridSize = argc >= 3 ? atoi(argv[2]) : 2048;
+    const char* outputPath = argc >= 4 ? argv[3] : NULL;
+
+    BenchScene scene;
+    if (!BenchSceneLoad(objPath, &scene))
+    {
+        fprintf(stderr, "Couldn't load %s\n", objPath);
+        return 1;
+    }
+    printf("%d triangles\n", (int)scene.Triangles.size());
+
+    VoxelDAG dag;
+    VoxelDAGBenchBuild(scene, gridSize, &dag);
+    if (!VoxelDAGBenchSave(dag, outputPath))
+    {
+        fprintf(stderr, "Couldn't write %s\n", outputPath);
+        return 1;
+    }
+    VoxelDAGBenchQueries(dag);
+    return 0;
+}
\ No newline at end of file
@@ -0,0 +1,79 @@
+// Voxelization throughput at every grid size from 64^3 to 512^3, with one thread and with every hardware thread. The
+// rows are only counted, so the dense volume is never allocated and the largest grids fit in memory.
+//
+//   voxelizer_bench [scene.obj] [repetitions]
+
+#include "bench.h"
+#include "benchscene.h"
+
+#include "voxelizer.h"
+#include "parallel.h"
+
+#include <algorithm>
+#include <atomic>
+#include <cstdio>
+#include <cstdlib>
+
+// Returns the best of the repetitions in milliseconds, and the number of occupied voxels.
+static double VoxelizerBenchRun(const BenchScene& scene, const VoxelGridDesc& grid, int numThreads, int numRepetitions, uint64_t* pNumOccupied)
+{
+    double bestMilliseconds = 0.0;
+    for (int repetition = 0; repetition < numRepetitions; repetition++)
+    {
+        std::atomic<uint64_t> numOccupied(0);
+        double start = BenchGetMilliseconds();
+        VoxelizeTrianglesByRow(scene.Triangles, grid, [&](int, int, const uint32_t* pRowVoxels)
+        {
+            uint64_t rowOccupied = 0;
+            for (int i = 0; i < kVoxelBrickSize * kVoxelBrickSize * grid.Size; i++)
+            {
+                rowOccupied += pRowVoxels[i] != 0;
+            }
+            numOccupied += rowOccupied;
+        }, numThreads);
+        double milliseconds = BenchGetMilliseconds() - start;
+
+        if (repetition == 0 || milliseconds < bestMilliseconds)
+            bestMilliseconds = milliseconds;
+        *pNumOccupied = numOccupied;
+    }
+    return bestMilliseconds;
+}
+
+int main(int argc, char** argv)
+{
+    const char* objPath = argc >= 2 ? argv[1] : NULL;
+    int numRepetitions = argc >= 3 ? std::max(atoi(argv[2]), 1) : 3;
+
+    BenchScene scene;
+    if (!BenchSceneLoad(objPath, &scene))
+    {
+        fprintf(stderr, "Couldn't load %s\n", objPath);
+        return 1;
+    }
+    printf("%d triangles\n", (int)scene.Triangles.size());
+
+    int maxThreads = ParallelGetDefaultNumThreads();
+    printf("grid  threads        ms  Mtris/s  Mvoxels/s  occupied\n");
+    for (int gridSize = 64; gridSize <= 512; gridSize *= 2)
+    {
+        VoxelGridDesc grid;
+        BenchSceneGetGrid(scene, gridSize, &grid);
+
+        for (int numThreads = 1; ; numThreads = maxThreads)
+        {
+            uint64_t numOccupied = 0;
+            double milliseconds = VoxelizerBenchRun(scene, grid, numThreads, numRepetitions, &numOccupied);
+
+            // voxels of the whole grid per second, occupied or not
+            printf("%4d  %7d  %8.1f  %7.2f  %9.1f  %8llu\n", gridSize, numThreads, milliseconds,
+                scene.Triangles.size() / (milliseconds * 1e3),
+                (double)gridSize * gridSize * gridSize / (milliseconds * 1e3),
+                (unsigned long long)numOccupied);
+
+            if (numThreads == maxThreads)
+                break;
+        }
+    }
+    return 0;
+}
\ No newline at end of file
@@ -0,0 +1,71 @@
+// Times the occupancy and albedo mip chains of the voxelized scene, on one thread and on every thread.
+//
+//   voxelmip_bench [scene.obj] [grid size]
+
+#include "bench.h"
+#include "benchscene.h"
+
+#include "voxelmip.h"
+#include "parallel.h"
+
+#include <cstdio>
+#include <cstdlib>
+
+int main(int argc, char** argv)
+{
+    const char* objPath = argc >= 2 ? argv[1] : NULL;
+    int gridSize = argc >= 3 ? atoi(argv[2]) : 512;
+
+    BenchScene scene;
+    if (!BenchSceneLoad(objPath, &scene))
+    {
+        fprintf(stderr, "Couldn't load %s\n", objPath);
+        return 1;
+    }
+
+    VoxelGridDesc grid;
+    BenchSceneGetGrid(scene, gridSize, &grid);
+
+    int numLevels = VoxelMipGetNumLevels(gridSize);
+    std::vector<std::vector<uint8_t>> occupancyLevels(numLevels);
+    std::vector<std::vector<uint32_t>> albedoLevels(numLevels);
+    for (int level = 0; level < numLevels; level++)
+    {
+        int levelSize = gridSize >> level;
+        occupancyLevels[level].resize((size_t)levelSize * levelSize * levelSize);
+        albedoLevels[level].resize(occupancyLevels[level].size());
+    }
+
+    VoxelizeTriangles(scene.Triangles, grid, albedoLevels[0].data());
+    for (size_t i = 0; i < albedoLevels[0].size(); i++)
+    {
+        occupancyLevels[0][i] = (uint8_t)(albedoLevels[0][i] >> 24);
+    }
+
+    printf("%d triangles at %d^3\n", (int)scene.Triangles.size(), gridSize);
+
+    int maxThreads = ParallelGetDefaultNumThreads();
+    for (int numThreads = 1; ; numThreads = maxThreads)
+    {
+        double start = BenchGetMilliseconds();
+        for (int level = 1; level < numLevels; level++)
+        {
+            VoxelMipDownsampleOccupancy(occupancyLevels[level - 1].data(), gridSize >> (level - 1), occupancyLevels[level].data(), numThreads);
+        }
+        double occupancyMilliseconds = BenchGetMilliseconds() - start;
+
+        start = BenchGetMilliseconds();
+        for (int level = 1; level < numLevels; level++)
+        {
+            VoxelMipDownsampleAlbedo(albedoLevels[level - 1].data(), gridSize >> (level - 1), albedoLevels[level].data(), numThreads);
+        }
+        double albedoMilliseconds = BenchGetMilliseconds() - start;
+
+        printf("%d threads: occupancy %.1f ms, albedo %.1f ms\n", numThreads, occupancyMilliseconds, albedoMilliseconds);
+
+        if (numThreads == maxThreads)
+            break;
+    }
+
+    return 0;
+}
\ No newline at end of file
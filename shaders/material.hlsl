@@ -0,0 +1,34 @@
+#ifndef MATERIAL_HLSL
+#define MATERIAL_HLSL
+
+// One material of the material table, a structured buffer of every material that is uploaded once at load.
+// Colors, shininess and opacity are halves, two to a uint with the first in the low bits. The UV transforms stay floats,
+// since a half can't place a texel centre of a 1024 wide atlas page.
+// C++ includes this with uint defined as a 32-bit unsigned int, and checks the layout against the defines below.
+struct PackedMaterial
+{
+    uint AmbientRG;
+    uint AmbientBOpacity;
+    uint DiffuseRG;
+    uint DiffuseBShininess;
+    uint SpecularRG;
+    uint SpecularB; // the high half is 0
+    uint Flags; // MATERIAL_FLAG_*
+    uint TextureSlices; // MATERIAL_TEXTURE_SLICE_BITS each, diffuse in the low bits, then specular and bump
+    float DiffuseUVTransform[4]; // scale in [0] and [1], offset in [2] and [3]
+    float SpecularUVTransform[4];
+    float BumpUVTransform[4];
+};
+
+#define PACKED_MATERIAL_SIZE 80
+#define PACKED_MATERIAL_FLAGS_OFFSET 24
+#define PACKED_MATERIAL_UVTRANSFORMS_OFFSET 32
+
+#define MATERIAL_FLAG_HAS_DIFFUSE_TEXTURE 1
+#define MATERIAL_FLAG_HAS_SPECULAR_TEXTURE 2
+#define MATERIAL_FLAG_HAS_BUMP_TEXTURE 4
+
+#define MATERIAL_TEXTURE_SLICE_BITS 10
+#define MATERIAL_TEXTURE_SLICE_MASK 0x3FF
+
+#endif // MATERIAL_HLSL
\ No newline at end of file
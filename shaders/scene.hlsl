@@ -1,4 +1,16 @@
 #include "common.hlsl"
+#include "material.hlsl"
+
+// Material permutations. Each is 0 or 1, and defined by the renderer for the pixel shader.
+#ifndef HAS_DIFFUSE_TEXTURE
+#define HAS_DIFFUSE_TEXTURE 0
+#endif
+#ifndef HAS_SPECULAR_TEXTURE
+#define HAS_SPECULAR_TEXTURE 0
+#endif
+#ifndef HAS_BUMP_TEXTURE
+#define HAS_BUMP_TEXTURE 0
+#endif
 
 struct VSIn
 {
@@ -17,6 +29,7 @@ struct VSOut
     float3 WorldNormal : WORLDNORMAL;
     float4 WorldTangent : WORLDTANGENT;
     float3 WorldBitangent : WORLDBITANGENT;
+    nointerpolation uint MaterialID : MATERIALID;
 };
 
 struct PSOut
@@ -29,25 +42,34 @@ cbuffer CameraBuffer : BUFFER_REGISTER(CAMERA_BUFFER_SLOT)
     PerCameraData Camera;
 };
 
-cbuffer MaterialBuffer : BUFFER_REGISTER(MATERIAL_BUFFER_SLOT)
-{
-    PerMaterialData Material;
-};
-
 cbuffer SceneNodeBuffer : BUFFER_REGISTER(SCENENODE_BUFFER_SLOT)
 {
     PerSceneNodeData SceneNode;
 };
 
-Texture2D DiffuseTexture : TEXTURE_REGISTER(DIFFUSE_TEXTURE_SLOT);
+// Each texture is a slice of an array, or a part of an atlas page that is a slice.
+Texture2DArray DiffuseTexture : TEXTURE_REGISTER(DIFFUSE_TEXTURE_SLOT);
 SamplerState DiffuseSampler : SAMPLER_REGISTER(DIFFUSE_SAMPLER_SLOT);
 
-Texture2D SpecularTexture : TEXTURE_REGISTER(SPECULAR_TEXTURE_SLOT);
+Texture2DArray SpecularTexture : TEXTURE_REGISTER(SPECULAR_TEXTURE_SLOT);
 SamplerState SpecularSampler : SAMPLER_REGISTER(SPECULAR_SAMPLER_SLOT);
 
-Texture2D BumpTexture : TEXTURE_REGISTER(BUMP_TEXTURE_SLOT);
+Texture2DArray BumpTexture : TEXTURE_REGISTER(BUMP_TEXTURE_SLOT);
 SamplerState BumpSampler : SAMPLER_REGISTER(BUMP_SAMPLER_SLOT);
 
+StructuredBuffer<PackedMaterial> MaterialTable : TEXTURE_REGISTER(MATERIAL_TABLE_SLOT);
+
+float3 UnpackHalf3(uint rg, uint b)
+{
+    return float3(f16tof32(rg), f16tof32(rg >> 16), f16tof32(b));
+}
+
+float3 ArrayTexCoord(float2 texCoord, float uvTransform[4], uint textureSlices, uint textureIndex)
+{
+    uint slice = (textureSlices >> (MATERIAL_TEXTURE_SLICE_BITS * textureIndex)) & MATERIAL_TEXTURE_SLICE_MASK;
+    return float3(texCoord * float2(uvTransform[0], uvTransform[1]) + float2(uvTransform[2], uvTransform[3]), slice);
+}
+
 VSOut VSmain(VSIn input)
 {
     VSOut output;
@@ -57,57 +79,57 @@ VSOut VSmain(VSIn input)
     output.WorldNormal = normalize(mul(float4(input.Normal, 0), SceneNode.NormalTransform).xyz);
     output.WorldTangent = float4(normalize(mul(float4(input.Tangent.xyz, 0), SceneNode.NormalTransform).xyz), input.Tangent.w);
     output.WorldBitangent = normalize(mul(float4(input.Bitangent, 0), SceneNode.NormalTransform).xyz);
+    output.MaterialID = SceneNode.MaterialID.x;
     return output;
 }
 
 PSOut PSmain(VSOut input)
 {
     PSOut output;
+
+    // texture presence is known from the permutation, so the shader doesn't branch on the material's flags
+    PackedMaterial material = MaterialTable[input.MaterialID];
     
-    float4 diffuseMap;
-    if (Material.HasDiffuse.x)
-        diffuseMap = DiffuseTexture.Sample(DiffuseSampler, input.TexCoord);
-    else
-        diffuseMap = float4(0, 0, 0, 1);
-
-    float specularMap;
-    if (Material.HasSpecular.x)
-        specularMap = SpecularTexture.Sample(SpecularSampler, input.TexCoord).r;
-    else
-        specularMap = 1.0;
+#if HAS_DIFFUSE_TEXTURE
+    float4 diffuseMap = DiffuseTexture.Sample(DiffuseSampler, ArrayTexCoord(input.TexCoord, material.DiffuseUVTransform, material.TextureSlices, 0));
+#else
+    float4 diffuseMap = float4(0, 0, 0, 1);
+#endif
+
+#if HAS_SPECULAR_TEXTURE
+    float specularMap = SpecularTexture.Sample(SpecularSampler, ArrayTexCoord(input.TexCoord, material.SpecularUVTransform, material.TextureSlices, 1)).r;
+#else
+    float specularMap = 1.0;
+#endif
 
     float3 N = normalize(input.WorldNormal);
     float3 P = input.WorldPosition;
     float3 C = Camera.WorldPosition.xyz;
 
-    if (Material.HasBump.x)
+#if HAS_BUMP_TEXTURE
     {
-        int3 boff = int3(-1, 0, 1);
-        float b11 = BumpTexture.Sample(BumpSampler, input.TexCoord).r;
-        float b01 = BumpTexture.Sample(BumpSampler, input.TexCoord, boff.xy).x;
-        float b21 = BumpTexture.Sample(BumpSampler, input.TexCoord, boff.zy).x;
-        float b10 = BumpTexture.Sample(BumpSampler, input.TexCoord, boff.yx).x;
-        float b12 = BumpTexture.Sample(BumpSampler, input.TexCoord, boff.yz).x;
-        float3 va = normalize(float3(2, 0, (b21 - b01) / input.Position.w * 3000));
-        float3 vb = normalize(float3(0, 2, (b12 - b10) / input.Position.w * 3000));
-        float4 bump = float4(cross(va, vb), b11);
+        // tangent-space normal map made from the bump height map at import time
+        float2 bumpXY = BumpTexture.Sample(BumpSampler, ArrayTexCoord(input.TexCoord, material.BumpUVTransform, material.TextureSlices, 2)).xy;
+        float3 bump = float3(bumpXY, sqrt(saturate(1 - dot(bumpXY, bumpXY))));
 
         float3 worldTangent = normalize(input.WorldTangent.xyz) * input.WorldTangent.w;
         float3 worldBitangent = normalize(input.WorldBitangent);
         float3 worldNormal = normalize(input.WorldNormal);
         float3x3 tangentFrame = float3x3(worldTangent, worldBitangent, worldNormal);
-        N = mul(transpose(tangentFrame), bump.xyz);
+        N = mul(transpose(tangentFrame), bump);
     }
+#endif
 
     float3 V = normalize(C - P);
     float3 L = V;
     float G = max(0, dot(N, L));
     float3 R = reflect(-L, N);
-    float S = pow(max(0, dot(R, V)), Material.Shininess.r);
+    float S = pow(max(0, dot(R, V)), f16tof32(material.DiffuseBShininess >> 16));
 
-    float4 ambient = diffuseMap * Material.Ambient;
-    float4 diffuse = diffuseMap * Material.Diffuse * G;
-    float4 specular = specularMap * Material.Specular * S;
+    // material colors are RGB, with an alpha of 0
+    float4 ambient = diffuseMap * float4(UnpackHalf3(material.AmbientRG, material.AmbientBOpacity), 0);
+    float4 diffuse = diffuseMap * float4(UnpackHalf3(material.DiffuseRG, material.DiffuseBShininess), 0) * G;
+    float4 specular = specularMap * float4(UnpackHalf3(material.SpecularRG, material.SpecularB), 0) * S;
     
     output.Color = ambient + diffuse + specular;
 
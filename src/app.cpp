@@ -1,5 +1,6 @@
 #include "app.h"
 #include "renderer.h"
+#include "profiler.h"
 
 #include "dxutil.h"
 
@@ -95,6 +96,9 @@ static void AppExit()
 
 void AppMain()
 {
+    ProfilerInit();
+    ProfilerSetThreadName("Main");
+
     AppInit(1280, 720, "silver-winner");
 
     for (;;)
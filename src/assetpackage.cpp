@@ -0,0 +1,579 @@
+#include "assetpackage.h"
+
+#include "stb_image.h"
+
+#include <fstream>
+#include <algorithm>
+#include <cstring>
+#include <cstdio>
+#include <climits>
+
+#ifdef _WIN32
+#define NOMINMAX
+#define WIN32_LEAN_AND_MEAN
+#include <Windows.h>
+#else
+#include <sys/mman.h>
+#include <sys/stat.h>
+#include <fcntl.h>
+#include <unistd.h>
+#endif
+
+static const uint32_t kAssetPackageMagic = 0x4B505753; // "SWPK"
+static const uint32_t kAssetPackageVersion = 1;
+
+// followed by the table of contents and then the names
+struct AssetPackageFileHeader
+{
+    uint32_t Magic;
+    uint32_t Version;
+    uint32_t NumEntries;
+    uint32_t NamesSize; // of every name with its terminating NUL
+    uint64_t FileSize;
+};
+
+enum AssetPackageEntryFlags
+{
+    ASSETPACKAGE_ENTRY_ZLIB = 1
+};
+
+struct AssetPackageFileEntry
+{
+    uint64_t Offset; // a multiple of kAssetPackageAlignment
+    uint64_t StoredSize;
+    uint64_t Size;
+    uint32_t NameOffset; // into the names
+    uint32_t Flags; // AssetPackageEntryFlags
+};
+
+struct AssetPackage
+{
+    const uint8_t* pMapping;
+    uint64_t MappingSize;
+    const AssetPackageFileEntry* pEntries;
+    int NumEntries;
+    const char* pNames;
+
+#ifdef _WIN32
+    HANDLE hFile;
+    HANDLE hMapping;
+#else
+    int FD;
+#endif
+};
+
+static uint64_t AssetPackageAlignUp(uint64_t offset)
+{
+    return (offset + kAssetPackageAlignment - 1) & ~(kAssetPackageAlignment - 1);
+}
+
+// Zlib compression
+
+struct AssetPackageBitWriter
+{
+    std::vector<uint8_t>* pBytes;
+    uint32_t Bits;
+    int NumBits;
+};
+
+static void AssetPackageWriteBits(AssetPackageBitWriter* pWriter, uint32_t bits, int numBits)
+{
+    pWriter->Bits |= bits << pWriter->NumBits;
+    pWriter->NumBits += numBits;
+    while (pWriter->NumBits >= 8)
+    {
+        pWriter->pBytes->push_back((uint8_t)pWriter->Bits);
+        pWriter->Bits >>= 8;
+        pWriter->NumBits -= 8;
+    }
+}
+
+// Huffman codes are written from their most significant bit
+static void AssetPackageWriteCode(AssetPackageBitWriter* pWriter, uint32_t code, int numBits)
+{
+    uint32_t reversed = 0;
+    for (int bit = 0; bit < numBits; bit++)
+    {
+        reversed = (reversed << 1) | ((code >> bit) & 1);
+    }
+    AssetPackageWriteBits(pWriter, reversed, numBits);
+}
+
+// the fixed literal/length code of RFC 1951 3.2.6
+static void AssetPackageWriteLiteralLength(AssetPackageBitWriter* pWriter, int symbol)
+{
+    if (symbol <= 143)
+        AssetPackageWriteCode(pWriter, 0x30 + symbol, 8);
+    else if (symbol <= 255)
+        AssetPackageWriteCode(pWriter, 0x190 + symbol - 144, 9);
+    else if (symbol <= 279)
+        AssetPackageWriteCode(pWriter, symbol - 256, 7);
+    else
+        AssetPackageWriteCode(pWriter, 0xC0 + symbol - 280, 8);
+}
+
+static const int kAssetPackageLengthBase[] = {
+    3, 4, 5, 6, 7, 8, 9, 10, 11, 13, 15, 17, 19, 23, 27, 31, 35, 43, 51, 59, 67, 83, 99, 115, 131, 163, 195, 227, 258
+};
+static const int kAssetPackageLengthExtraBits[] = {
+    0, 0, 0, 0, 0, 0, 0, 0, 1, 1, 1, 1, 2, 2, 2, 2, 3, 3, 3, 3, 4, 4, 4, 4, 5, 5, 5, 5, 0
+};
+static const int kAssetPackageDistanceBase[] = {
+    1, 2, 3, 4, 5, 7, 9, 13, 17, 25, 33, 49, 65, 97, 129, 193, 257, 385, 513, 769, 1025, 1537, 2049, 3073, 4097, 6145, 8193, 12289, 16385, 24577
+};
+static const int kAssetPackageDistanceExtraBits[] = {
+    0, 0, 0, 0, 1, 1, 2, 2, 3, 3, 4, 4, 5, 5, 6, 6, 7, 7, 8, 8, 9, 9, 10, 10, 11, 11, 12, 12, 13, 13
+};
+
+static const int kAssetPackageWindowSize = 32768;
+static const int kAssetPackageMinMatch = 3;
+static const int kAssetPackageMaxMatch = 258;
+static const int kAssetPackageHashBits = 15;
+static const int kAssetPackageMaxChainLength = 64;
+
+static void AssetPackageWriteMatch(AssetPackageBitWriter* pWriter, int length, int distance)
+{
+    int lengthCode = 28;
+    while (kAssetPackageLengthBase[lengthCode] > length)
+        lengthCode--;
+    AssetPackageWriteLiteralLength(pWriter, 257 + lengthCode);
+    AssetPackageWriteBits(pWriter, length - kAssetPackageLengthBase[lengthCode], kAssetPackageLengthExtraBits[lengthCode]);
+
+    int distanceCode = 29;
+    while (kAssetPackageDistanceBase[distanceCode] > distance)
+        distanceCode--;
+    AssetPackageWriteCode(pWriter, distanceCode, 5);
+    AssetPackageWriteBits(pWriter, distance - kAssetPackageDistanceBase[distanceCode], kAssetPackageDistanceExtraBits[distanceCode]);
+}
+
+static uint32_t AssetPackageHash3(const uint8_t* p)
+{
+    uint32_t v = p[0] | (p[1] << 8) | (p[2] << 16);
+    return (v * 2654435761u) >> (32 - kAssetPackageHashBits);
+}
+
+void AssetPackageZlibCompress(const uint8_t* pData, size_t size, std::vector<uint8_t>* pCompressed)
+{
+    // deflate with a 32K window and no preset dictionary, then the fastest compression level flag
+    pCompressed->push_back(0x78);
+    pCompressed->push_back(0x01);
+
+    AssetPackageBitWriter writer;
+    writer.pBytes = pCompressed;
+    writer.Bits = 0;
+    writer.NumBits = 0;
+
+    // one final block with the fixed codes
+    AssetPackageWriteBits(&writer, 1, 1);
+    AssetPackageWriteBits(&writer, 1, 2);
+
+    // the last position of each hash, and the previous position with the same hash for each position in the window
+    std::vector<int64_t> head((size_t)1 << kAssetPackageHashBits, -1);
+    std::vector<int64_t> prev(kAssetPackageWindowSize, -1);
+
+    size_t pos = 0;
+    while (pos < size)
+    {
+        int bestLength = 0;
+        int bestDistance = 0;
+
+        if (pos + kAssetPackageMinMatch <= size)
+        {
+            uint32_t hash = AssetPackageHash3(&pData[pos]);
+            int maxLength = (int)std::min<size_t>(kAssetPackageMaxMatch, size - pos);
+
+            int64_t candidate = head[hash];
+            for (int chain = 0; chain < kAssetPackageMaxChainLength && candidate >= 0 && pos - candidate <= kAssetPackageWindowSize; chain++)
+            {
+                const uint8_t* a = &pData[candidate];
+                const uint8_t* b = &pData[pos];
+                if (a[bestLength] == b[bestLength])
+                {
+                    int length = 0;
+                    while (length < maxLength && a[length] == b[length])
+                        length++;
+
+                    if (length > bestLength)
+                    {
+                        bestLength = length;
+                        bestDistance = (int)(pos - candidate);
+                        if (length == maxLength)
+                            break;
+                    }
+                }
+                candidate = prev[candidate % kAssetPackageWindowSize];
+            }
+        }
+
+        size_t advance = 1;
+        if (bestLength >= kAssetPackageMinMatch)
+        {
+            AssetPackageWriteMatch(&writer, bestLength, bestDistance);
+            advance = bestLength;
+        }
+        else
+        {
+            AssetPackageWriteLiteralLength(&writer, pData[pos]);
+        }
+
+        for (size_t i = 0; i < advance; i++, pos++)
+        {
+            if (pos + kAssetPackageMinMatch <= size)
+            {
+                uint32_t hash = AssetPackageHash3(&pData[pos]);
+                prev[pos % kAssetPackageWindowSize] = head[hash];
+                head[hash] = (int64_t)pos;
+            }
+        }
+    }
+
+    // end of block, then pad to a byte
+    AssetPackageWriteLiteralLength(&writer, 256);
+    AssetPackageWriteBits(&writer, 0, 7);
+
+    // big-endian Adler-32 of the uncompressed data
+    uint32_t a = 1, b = 0;
+    for (size_t i = 0; i < size; )
+    {
+        // 5552 bytes is the most that can be summed before b can overflow
+        size_t end = std::min(size, i + 5552);
+        for (; i < end; i++)
+        {
+            a += pData[i];
+            b += a;
+        }
+        a %= 65521;
+        b %= 65521;
+    }
+    uint32_t adler = (b << 16) | a;
+    pCompressed->push_back((uint8_t)(adler >> 24));
+    pCompressed->push_back((uint8_t)(adler >> 16));
+    pCompressed->push_back((uint8_t)(adler >> 8));
+    pCompressed->push_back((uint8_t)adler);
+}
+
+// Writing
+
+static bool AssetPackageReadFile(const std::string& path, std::vector<uint8_t>* pBytes)
+{
+    std::ifstream file(path, std::ios::binary);
+    if (!file)
+        return false;
+
+    file.seekg(0, std::ios::end);
+    std::streamoff size = file.tellg();
+    file.seekg(0, std::ios::beg);
+    if (size < 0)
+        return false;
+
+    pBytes->resize((size_t)size);
+    if (size > 0 && !file.read((char*)pBytes->data(), size))
+        return false;
+
+    return true;
+}
+
+static std::string AssetPackageNormalizeName(const char* name)
+{
+    std::string normalized = name;
+    std::replace(normalized.begin(), normalized.end(), '\\', '/');
+    return normalized;
+}
+
+bool AssetPackageWrite(const char* path, const std::vector<AssetPackageInput>& inputs, AssetPackageWriteStats* pStats)
+{
+    // the table of contents is sorted by name, for binary search
+    std::vector<int> order(inputs.size());
+    std::vector<std::string> names(inputs.size());
+    for (size_t inputIndex = 0; inputIndex < inputs.size(); inputIndex++)
+    {
+        order[inputIndex] = (int)inputIndex;
+        names[inputIndex] = AssetPackageNormalizeName(inputs[inputIndex].Name.c_str());
+    }
+    std::sort(order.begin(), order.end(), [&](int a, int b) { return names[a] < names[b]; });
+
+    for (size_t i = 1; i < order.size(); i++)
+    {
+        if (names[order[i - 1]] == names[order[i]])
+            return false;
+    }
+
+    AssetPackageFileHeader header;
+    header.Magic = kAssetPackageMagic;
+    header.Version = kAssetPackageVersion;
+    header.NumEntries = (uint32_t)inputs.size();
+
+    std::vector<char> namesBlob;
+    std::vector<AssetPackageFileEntry> entries(inputs.size());
+    for (size_t i = 0; i < order.size(); i++)
+    {
+        const std::string& name = names[order[i]];
+        entries[i].NameOffset = (uint32_t)namesBlob.size();
+        namesBlob.insert(namesBlob.end(), name.c_str(), name.c_str() + name.size() + 1);
+    }
+    header.NamesSize = (uint32_t)namesBlob.size();
+
+    AssetPackageWriteStats stats;
+    stats.InputBytes = 0;
+    stats.NumCompressed = 0;
+
+    std::string tempPath = std::string(path) + ".tmp";
+    {
+        std::ofstream file(tempPath, std::ios::binary | std::ios::trunc);
+        if (!file)
+            return false;
+
+        // the header and table of contents are rewritten once the entries' offsets and sizes are known
+        uint64_t offset = AssetPackageAlignUp(sizeof(header) + entries.size() * sizeof(AssetPackageFileEntry) + namesBlob.size());
+        std::vector<char> padding(kAssetPackageAlignment, 0);
+        file.write(padding.data(), offset);
+
+        std::vector<uint8_t> bytes;
+        std::vector<uint8_t> compressed;
+        for (size_t i = 0; i < order.size(); i++)
+        {
+            const AssetPackageInput& input = inputs[order[i]];
+            if (!AssetPackageReadFile(input.Path, &bytes))
+                return false;
+
+            // stb_image inflates into an int-sized buffer
+            if (bytes.size() > INT_MAX)
+                return false;
+
+            AssetPackageFileEntry& entry = entries[i];
+            entry.Offset = offset;
+            entry.Size = bytes.size();
+            entry.StoredSize = bytes.size();
+            entry.Flags = 0;
+
+            const uint8_t* pStored = bytes.data();
+            if (input.Compress && !bytes.empty())
+            {
+                compressed.clear();
+                AssetPackageZlibCompress(bytes.data(), bytes.size(), &compressed);
+                if (compressed.size() <= bytes.size() - bytes.size() / 4)
+                {
+                    entry.StoredSize = compressed.size();
+                    entry.Flags |= ASSETPACKAGE_ENTRY_ZLIB;
+                    pStored = compressed.data();
+                    stats.NumCompressed++;
+                }
+            }
+
+            file.write((const char*)pStored, entry.StoredSize);
+
+            uint64_t nextOffset = AssetPackageAlignUp(offset + entry.StoredSize);
+            file.write(padding.data(), nextOffset - (offset + entry.StoredSize));
+            offset = nextOffset;
+
+            stats.InputBytes += entry.Size;
+        }
+
+        header.FileSize = offset;
+        stats.FileBytes = offset;
+
+        file.seekp(0);
+        file.write((const char*)&header, sizeof(header));
+        if (!entries.empty())
+            file.write((const char*)entries.data(), entries.size() * sizeof(entries[0]));
+        if (!namesBlob.empty())
+            file.write(namesBlob.data(), namesBlob.size());
+
+        if (!file.flush())
+            return false;
+    }
+
+#ifdef _WIN32
+    if (!MoveFileExA(tempPath.c_str(), path, MOVEFILE_REPLACE_EXISTING | MOVEFILE_WRITE_THROUGH))
+        return false;
+#else
+    if (std::rename(tempPath.c_str(), path) != 0)
+        return false;
+#endif
+
+    if (pStats)
+        *pStats = stats;
+
+    return true;
+}
+
+// Reading
+
+static void AssetPackageUnmap(AssetPackage* pPackage)
+{
+#ifdef _WIN32
+    if (pPackage->pMapping)
+        UnmapViewOfFile(pPackage->pMapping);
+    if (pPackage->hMapping)
+        CloseHandle(pPackage->hMapping);
+    if (pPackage->hFile != INVALID_HANDLE_VALUE)
+        CloseHandle(pPackage->hFile);
+#else
+    if (pPackage->pMapping)
+        munmap((void*)pPackage->pMapping, pPackage->MappingSize);
+    if (pPackage->FD != -1)
+        close(pPackage->FD);
+#endif
+}
+
+static bool AssetPackageMap(const char* path, AssetPackage* pPackage)
+{
+#ifdef _WIN32
+    pPackage->hFile = CreateFileA(path, GENERIC_READ, FILE_SHARE_READ, NULL, OPEN_EXISTING, FILE_ATTRIBUTE_NORMAL, NULL);
+    if (pPackage->hFile == INVALID_HANDLE_VALUE)
+        return false;
+
+    LARGE_INTEGER fileSize;
+    if (!GetFileSizeEx(pPackage->hFile, &fileSize) || fileSize.QuadPart == 0)
+        return false;
+    pPackage->MappingSize = (uint64_t)fileSize.QuadPart;
+
+    pPackage->hMapping = CreateFileMappingA(pPackage->hFile, NULL, PAGE_READONLY, 0, 0, NULL);
+    if (!pPackage->hMapping)
+        return false;
+
+    pPackage->pMapping = (const uint8_t*)MapViewOfFile(pPackage->hMapping, FILE_MAP_READ, 0, 0, 0);
+    return pPackage->pMapping != NULL;
+#else
+    pPackage->FD = open(path, O_RDONLY);
+    if (pPackage->FD == -1)
+        return false;
+
+    struct stat fileStat;
+    if (fstat(pPackage->FD, &fileStat) != 0 || fileStat.st_size == 0)
+        return false;
+    pPackage->MappingSize = (uint64_t)fileStat.st_size;
+
+    void* pMapping = mmap(NULL, pPackage->MappingSize, PROT_READ, MAP_SHARED, pPackage->FD, 0);
+    if (pMapping == MAP_FAILED)
+        return false;
+
+    pPackage->pMapping = (const uint8_t*)pMapping;
+    return true;
+#endif
+}
+
+// Checks that everything the reader follows stays inside the mapping.
+static bool AssetPackageValidate(AssetPackage* pPackage)
+{
+    if (pPackage->MappingSize < sizeof(AssetPackageFileHeader))
+        return false;
+
+    const AssetPackageFileHeader* pHeader = (const AssetPackageFileHeader*)pPackage->pMapping;
+    if (pHeader->Magic != kAssetPackageMagic || pHeader->Version != kAssetPackageVersion || pHeader->FileSize != pPackage->MappingSize)
+        return false;
+
+    uint64_t tocSize = (uint64_t)pHeader->NumEntries * sizeof(AssetPackageFileEntry);
+    if (sizeof(*pHeader) + tocSize + pHeader->NamesSize > pPackage->MappingSize || pHeader->NumEntries > INT_MAX)
+        return false;
+
+    pPackage->pEntries = (const AssetPackageFileEntry*)(pPackage->pMapping + sizeof(*pHeader));
+    pPackage->NumEntries = (int)pHeader->NumEntries;
+    pPackage->pNames = (const char*)(pPackage->pMapping + sizeof(*pHeader) + tocSize);
+
+    if (pHeader->NamesSize != 0 && pPackage->pNames[pHeader->NamesSize - 1] != '\0')
+        return false;
+
+    for (int entryID = 0; entryID < pPackage->NumEntries; entryID++)
+    {
+        const AssetPackageFileEntry& entry = pPackage->pEntries[entryID];
+        if (entry.NameOffset >= pHeader->NamesSize)
+            return false;
+        if (entry.Offset % kAssetPackageAlignment != 0 || entry.Offset > pPackage->MappingSize || entry.StoredSize > pPackage->MappingSize - entry.Offset)
+            return false;
+        if (entry.Size > INT_MAX || (!(entry.Flags & ASSETPACKAGE_ENTRY_ZLIB) && entry.StoredSize != entry.Size))
+            return false;
+        if (entryID > 0 && strcmp(pPackage->pNames + pPackage->pEntries[entryID - 1].NameOffset, pPackage->pNames + entry.NameOffset) >= 0)
+            return false;
+    }
+
+    return true;
+}
+
+AssetPackage* AssetPackageOpen(const char* path)
+{
+    AssetPackage* pPackage = new AssetPackage();
+    pPackage->pMapping = NULL;
+    pPackage->MappingSize = 0;
+#ifdef _WIN32
+    pPackage->hFile = INVALID_HANDLE_VALUE;
+    pPackage->hMapping = NULL;
+#else
+    pPackage->FD = -1;
+#endif
+
+    if (!AssetPackageMap(path, pPackage) || !AssetPackageValidate(pPackage))
+    {
+        AssetPackageClose(pPackage);
+        return NULL;
+    }
+
+    return pPackage;
+}
+
+void AssetPackageClose(AssetPackage* pPackage)
+{
+    if (!pPackage)
+        return;
+
+    AssetPackageUnmap(pPackage);
+    delete pPackage;
+}
+
+int AssetPackageGetNumEntries(const AssetPackage* pPackage)
+{
+    return pPackage->NumEntries;
+}
+
+int AssetPackageFind(const AssetPackage* pPackage, const char* name)
+{
+    std::string normalized = AssetPackageNormalizeName(name);
+
+    int first = 0;
+    int last = pPackage->NumEntries;
+    while (first < last)
+    {
+        int middle = first + (last - first) / 2;
+        int comparison = strcmp(pPackage->pNames + pPackage->pEntries[middle].NameOffset, normalized.c_str());
+        if (comparison == 0)
+            return middle;
+        if (comparison < 0)
+            first = middle + 1;
+        else
+            last = middle;
+    }
+    return -1;
+}
+
+const char* AssetPackageGetEntryName(const AssetPackage* pPackage, int entryID)
+{
+    return pPackage->pNames + pPackage->pEntries[entryID].NameOffset;
+}
+
+uint64_t AssetPackageGetEntrySize(const AssetPackage* pPackage, int entryID)
+{
+    return pPackage->pEntries[entryID].Size;
+}
+
+bool AssetPackageIsEntryCompressed(const AssetPackage* pPackage, int entryID)
+{
+    return (pPackage->pEntries[entryID].Flags & ASSETPACKAGE_ENTRY_ZLIB) != 0;
+}
+
+const uint8_t* AssetPackageReadEntry(const AssetPackage* pPackage, int entryID, std::vector<uint8_t>* pInflated)
+{
+    const AssetPackageFileEntry& entry = pPackage->pEntries[entryID];
+    const uint8_t* pStored = pPackage->pMapping + entry.Offset;
+    if (!(entry.Flags & ASSETPACKAGE_ENTRY_ZLIB))
+        return pStored;
+
+    // the validation keeps both sizes in an int
+    pInflated->resize((size_t)entry.Size);
+    int inflatedSize = stbi_zlib_decode_buffer(
+        (char*)pInflated->data(), (int)entry.Size,
+        (const char*)pStored, (int)std::min<uint64_t>(entry.StoredSize, INT_MAX));
+    if (inflatedSize != (int)entry.Size)
+        return NULL;
+
+    return pInflated->data();
+}
\ No newline at end of file
@@ -0,0 +1,59 @@
+#pragma once
+
+#include <string>
+#include <vector>
+#include <cstdint>
+
+// A package of asset files in one file, read through a memory mapping, so loading an asset is a lookup instead of
+// opening and reading a loose file.
+// The file starts with a header and a table of contents sorted by name, and the data of every entry starts on a 4KB
+// boundary, so entries are page aligned in the mapping and a stored entry can be parsed where it is mapped.
+// An entry can also be compressed with zlib, which is inflated with the decoder in stb_image.
+// Names are paths with forward slashes, relative to the working directory, like "assets/sponza/sponza.mtl".
+// Nothing here depends on D3D. The mapping uses the Windows or POSIX file mapping calls.
+
+static const uint64_t kAssetPackageAlignment = 4096;
+
+struct AssetPackageInput
+{
+    std::string Name;
+    std::string Path; // of the file that is packed
+    bool Compress; // kept stored if zlib doesn't save a quarter of the entry
+};
+
+struct AssetPackageWriteStats
+{
+    uint64_t FileBytes;
+    uint64_t InputBytes;
+    int NumCompressed;
+};
+
+// Writes a temporary file and renames it over the package, like the shader cache.
+// Returns false if an input couldn't be read, two inputs have the same name, or the package couldn't be written.
+bool AssetPackageWrite(const char* path, const std::vector<AssetPackageInput>& inputs, AssetPackageWriteStats* pStats = NULL);
+
+// A zlib stream (RFC 1950) of the data, with fixed Huffman codes. Appends to pCompressed.
+void AssetPackageZlibCompress(const uint8_t* pData, size_t size, std::vector<uint8_t>* pCompressed);
+
+struct AssetPackage;
+
+// Returns NULL if the file doesn't exist or isn't a valid package.
+AssetPackage* AssetPackageOpen(const char* path);
+
+void AssetPackageClose(AssetPackage* pPackage);
+
+int AssetPackageGetNumEntries(const AssetPackage* pPackage);
+
+// Returns the ID of the entry, or -1 if the package has none with the name. Backslashes in the name match forward slashes.
+int AssetPackageFind(const AssetPackage* pPackage, const char* name);
+
+const char* AssetPackageGetEntryName(const AssetPackage* pPackage, int entryID);
+
+// The size of the entry once it is inflated.
+uint64_t AssetPackageGetEntrySize(const AssetPackage* pPackage, int entryID);
+
+bool AssetPackageIsEntryCompressed(const AssetPackage* pPackage, int entryID);
+
+// The entry's bytes: in the mapping if it is stored, or inflated into pInflated if it is compressed.
+// Returns NULL if a compressed entry couldn't be inflated. Any thread can read entries at the same time.
+const uint8_t* AssetPackageReadEntry(const AssetPackage* pPackage, int entryID, std::vector<uint8_t>* pInflated);
\ No newline at end of file
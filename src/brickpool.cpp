@@ -0,0 +1,291 @@
+#include "brickpool.h"
+
+#include "parallel.h"
+
+#include <algorithm>
+#include <cmath>
+
+using namespace DirectX;
+
+// Same gamma as the voxelizer's albedo encoding
+static const float kBrickPoolGamma = 2.2f;
+
+static const float* BrickPoolGetLinearTable()
+{
+    struct LinearTable
+    {
+        float Values[256];
+
+        LinearTable()
+        {
+            for (int i = 0; i < 256; i++)
+            {
+                Values[i] = std::pow(i / 255.0f, kBrickPoolGamma);
+            }
+        }
+    };
+
+    static const LinearTable table;
+    return table.Values;
+}
+
+static uint32_t BrickPoolEncodeAlbedo(const float rgb[3])
+{
+    uint32_t encoded = 0xFF000000;
+    for (int i = 0; i < 3; i++)
+    {
+        float srgb = std::pow(std::min(std::max(rgb[i], 0.0f), 1.0f), 1.0f / kBrickPoolGamma);
+        encoded |= (uint32_t)(srgb * 255.0f + 0.5f) << (i * 8);
+    }
+
+    return encoded;
+}
+
+static int BrickPoolVoxelIndex(int x, int y, int z)
+{
+    return (z * kVoxelBrickSize + y) * kVoxelBrickSize + x;
+}
+
+// Bricks produced for one row of bricks along x.
+struct BrickPoolRow
+{
+    std::vector<int> BrickX;
+    std::vector<uint32_t> Voxels;
+};
+
+// Allocates the bricks of every row in row order, so the layout doesn't depend on thread timing.
+static void BrickPoolAssemble(int size, const std::vector<BrickPoolRow>& rows, BrickPool* pPool)
+{
+    int numBricksPerAxis = (size + kVoxelBrickSize - 1) / kVoxelBrickSize;
+
+    size_t numBricks = 0;
+    for (const BrickPoolRow& row : rows)
+    {
+        numBricks += row.BrickX.size();
+    }
+
+    pPool->Size = size;
+    pPool->NumBricksPerAxis = numBricksPerAxis;
+    pPool->BrickIndices.assign((size_t)numBricksPerAxis * numBricksPerAxis * numBricksPerAxis, kBrickPoolEmptyBrick);
+    pPool->Bricks.clear();
+    pPool->Bricks.reserve(numBricks * kBrickPoolVoxelsPerBrick);
+
+    for (int rowID = 0; rowID < (int)rows.size(); rowID++)
+    {
+        const BrickPoolRow& row = rows[rowID];
+        uint32_t firstBrickIndex = (uint32_t)(pPool->Bricks.size() / kBrickPoolVoxelsPerBrick);
+        for (int i = 0; i < (int)row.BrickX.size(); i++)
+        {
+            pPool->BrickIndices[(size_t)rowID * numBricksPerAxis + row.BrickX[i]] = firstBrickIndex + i;
+        }
+        pPool->Bricks.insert(pPool->Bricks.end(), row.Voxels.begin(), row.Voxels.end());
+    }
+}
+
+uint64_t BrickPoolBuild(
+    const std::vector<VoxelizerTriangle>& triangles,
+    const VoxelGridDesc& grid,
+    BrickPool* pPool)
+{
+    const int size = grid.Size;
+    const int numBricksPerAxis = size / kVoxelBrickSize;
+
+    std::vector<BrickPoolRow> rows(numBricksPerAxis * numBricksPerAxis);
+    std::atomic<uint64_t> numOccupied(0);
+
+    VoxelizeTrianglesByRow(triangles, grid, [&](int rowY, int rowZ, const uint32_t* pRowVoxels)
+    {
+        BrickPoolRow& row = rows[(rowZ / kVoxelBrickSize) * numBricksPerAxis + rowY / kVoxelBrickSize];
+        uint64_t rowNumOccupied = 0;
+
+        for (int bx = 0; bx < numBricksPerAxis; bx++)
+        {
+            uint32_t brick[kBrickPoolVoxelsPerBrick];
+            int brickNumOccupied = 0;
+
+            for (int z = 0; z < kVoxelBrickSize; z++)
+            {
+                for (int y = 0; y < kVoxelBrickSize; y++)
+                {
+                    const uint32_t* pSrc = &pRowVoxels[(z * kVoxelBrickSize + y) * size + bx * kVoxelBrickSize];
+                    uint32_t* pDst = &brick[BrickPoolVoxelIndex(0, y, z)];
+                    for (int x = 0; x < kVoxelBrickSize; x++)
+                    {
+                        pDst[x] = pSrc[x];
+                        if (pSrc[x] != 0)
+                            brickNumOccupied++;
+                    }
+                }
+            }
+
+            if (brickNumOccupied == 0)
+                continue;
+
+            row.BrickX.push_back(bx);
+            row.Voxels.insert(row.Voxels.end(), brick, brick + kBrickPoolVoxelsPerBrick);
+            rowNumOccupied += brickNumOccupied;
+        }
+
+        numOccupied += rowNumOccupied;
+    });
+
+    BrickPoolAssemble(size, rows, pPool);
+
+    return numOccupied;
+}
+
+static const uint32_t* BrickPoolFindBrick(const BrickPool& pool, int bx, int by, int bz)
+{
+    int n = pool.NumBricksPerAxis;
+    if (bx < 0 || by < 0 || bz < 0 || bx >= n || by >= n || bz >= n)
+        return NULL;
+
+    uint32_t brickIndex = pool.BrickIndices[((size_t)bz * n + by) * n + bx];
+    if (brickIndex == kBrickPoolEmptyBrick)
+        return NULL;
+
+    return &pool.Bricks[(size_t)brickIndex * kBrickPoolVoxelsPerBrick];
+}
+
+void BrickPoolBuildMip(const BrickPool& src, BrickPool* pDst)
+{
+    const float* linear = BrickPoolGetLinearTable();
+
+    const int size = std::max(src.Size / 2, 1);
+    const int numBricksPerAxis = (size + kVoxelBrickSize - 1) / kVoxelBrickSize;
+    const int halfBrickSize = kVoxelBrickSize / 2;
+
+    std::vector<BrickPoolRow> rows(numBricksPerAxis * numBricksPerAxis);
+
+    ParallelFor((int)rows.size(), ParallelGetDefaultNumThreads(), [&](int rowID, int)
+    {
+        int by = rowID % numBricksPerAxis;
+        int bz = rowID / numBricksPerAxis;
+        BrickPoolRow& row = rows[rowID];
+
+        for (int bx = 0; bx < numBricksPerAxis; bx++)
+        {
+            uint32_t brick[kBrickPoolVoxelsPerBrick] = {};
+            bool anyChildBrick = false;
+
+            // Each of the 8 child bricks covers one octant of the parent brick
+            for (int octant = 0; octant < 8; octant++)
+            {
+                int cx = octant & 1, cy = (octant >> 1) & 1, cz = octant >> 2;
+
+                const uint32_t* pChild = BrickPoolFindBrick(src, bx * 2 + cx, by * 2 + cy, bz * 2 + cz);
+                if (!pChild)
+                    continue;
+
+                anyChildBrick = true;
+
+                for (int z = 0; z < halfBrickSize; z++)
+                {
+                    for (int y = 0; y < halfBrickSize; y++)
+                    {
+                        for (int x = 0; x < halfBrickSize; x++)
+                        {
+                            float rgb[3] = { 0.0f, 0.0f, 0.0f };
+                            int count = 0;
+
+                            for (int i = 0; i < 8; i++)
+                            {
+                                uint32_t voxel = pChild[BrickPoolVoxelIndex(x * 2 + (i & 1), y * 2 + ((i >> 1) & 1), z * 2 + (i >> 2))];
+                                if (voxel == 0)
+                                    continue;
+
+                                rgb[0] += linear[voxel & 0xFF];
+                                rgb[1] += linear[(voxel >> 8) & 0xFF];
+                                rgb[2] += linear[(voxel >> 16) & 0xFF];
+                                count++;
+                            }
+
+                            if (count == 0)
+                                continue;
+
+                            float invCount = 1.0f / count;
+                            rgb[0] *= invCount;
+                            rgb[1] *= invCount;
+                            rgb[2] *= invCount;
+
+                            brick[BrickPoolVoxelIndex(cx * halfBrickSize + x, cy * halfBrickSize + y, cz * halfBrickSize + z)] = BrickPoolEncodeAlbedo(rgb);
+                        }
+                    }
+                }
+            }
+
+            // Child bricks are never empty, so any child brick means an occupied parent voxel
+            if (!anyChildBrick)
+                continue;
+
+            row.BrickX.push_back(bx);
+            row.Voxels.insert(row.Voxels.end(), brick, brick + kBrickPoolVoxelsPerBrick);
+        }
+    });
+
+    BrickPoolAssemble(size, rows, pDst);
+}
+
+uint32_t BrickPoolLoad(const BrickPool& pool, int x, int y, int z)
+{
+    if (x < 0 || y < 0 || z < 0 || x >= pool.Size || y >= pool.Size || z >= pool.Size)
+        return 0;
+
+    const uint32_t* pBrick = BrickPoolFindBrick(pool, x / kVoxelBrickSize, y / kVoxelBrickSize, z / kVoxelBrickSize);
+    if (!pBrick)
+        return 0;
+
+    return pBrick[BrickPoolVoxelIndex(x % kVoxelBrickSize, y % kVoxelBrickSize, z % kVoxelBrickSize)];
+}
+
+XMFLOAT4 BrickPoolSampleTrilinear(const BrickPool& pool, const XMFLOAT3& uvw)
+{
+    const float* linear = BrickPoolGetLinearTable();
+
+    float p[3] = { uvw.x * pool.Size - 0.5f, uvw.y * pool.Size - 0.5f, uvw.z * pool.Size - 0.5f };
+    int p0[3];
+    float f[3];
+    for (int axis = 0; axis < 3; axis++)
+    {
+        float fp0 = std::floor(p[axis]);
+        p0[axis] = (int)fp0;
+        f[axis] = p[axis] - fp0;
+    }
+
+    XMFLOAT4 result(0.0f, 0.0f, 0.0f, 0.0f);
+    for (int i = 0; i < 8; i++)
+    {
+        int dx = i & 1, dy = (i >> 1) & 1, dz = i >> 2;
+
+        uint32_t voxel = BrickPoolLoad(pool, p0[0] + dx, p0[1] + dy, p0[2] + dz);
+        if (voxel == 0)
+            continue;
+
+        float weight =
+            (dx ? f[0] : 1.0f - f[0]) *
+            (dy ? f[1] : 1.0f - f[1]) *
+            (dz ? f[2] : 1.0f - f[2]);
+
+        result.x += weight * linear[voxel & 0xFF];
+        result.y += weight * linear[(voxel >> 8) & 0xFF];
+        result.z += weight * linear[(voxel >> 16) & 0xFF];
+        result.w += weight;
+    }
+
+    return result;
+}
+
+uint64_t BrickPoolGetMemorySize(const BrickPool& pool)
+{
+    return (pool.BrickIndices.size() + pool.Bricks.size()) * sizeof(uint32_t);
+}
+
+uint64_t BrickPoolGetDenseMemorySize(int gridSize)
+{
+    uint64_t bytes = 0;
+    for (int mipSize = gridSize; mipSize >= 1; mipSize /= 2)
+    {
+        bytes += (uint64_t)mipSize * mipSize * mipSize * (sizeof(uint8_t) + sizeof(uint32_t));
+    }
+    return bytes;
+}
\ No newline at end of file
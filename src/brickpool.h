@@ -0,0 +1,49 @@
+#pragma once
+
+#include "voxelizer.h"
+
+#include <DirectXMath.h>
+
+#include <vector>
+#include <cstdint>
+
+// Sparse voxel storage.
+// A coarse indirection grid has one entry per kVoxelBrickSize^3 brick of the volume,
+// which is either kBrickPoolEmptyBrick or the index of the brick's voxels in the pool.
+// Only bricks that contain at least one occupied voxel are stored.
+
+static const uint32_t kBrickPoolEmptyBrick = 0xFFFFFFFF;
+static const int kBrickPoolVoxelsPerBrick = kVoxelBrickSize * kVoxelBrickSize * kVoxelBrickSize;
+
+struct BrickPool
+{
+    int Size; // voxels along each axis
+    int NumBricksPerAxis;
+    std::vector<uint32_t> BrickIndices; // NumBricksPerAxis^3 entries in x-major order
+    std::vector<uint32_t> Bricks; // kBrickPoolVoxelsPerBrick RGBA8 voxels per brick in x-major order
+};
+
+// Voxelizes the triangles straight into a brick pool, without ever allocating the dense volume.
+// Voxels have the same encoding as VoxelizeTriangles. Returns the number of occupied voxels.
+uint64_t BrickPoolBuild(
+    const std::vector<VoxelizerTriangle>& triangles,
+    const VoxelGridDesc& grid,
+    BrickPool* pPool);
+
+// Builds the next mip level of src, with half the resolution.
+// A voxel is occupied if any of its 8 children is, and its albedo is the average of the occupied children.
+void BrickPoolBuildMip(const BrickPool& src, BrickPool* pDst);
+
+// Returns the RGBA8 voxel at integer coordinates, or 0 if it is outside the volume or in an empty brick.
+uint32_t BrickPoolLoad(const BrickPool& pool, int x, int y, int z);
+
+// Trilinearly filters the volume at normalized coordinates in [0,1], with voxel centers at (i + 0.5) / Size.
+// Voxels outside the volume count as empty.
+// Returns linear albedo premultiplied by occupancy in xyz, and the occupancy in w.
+DirectX::XMFLOAT4 BrickPoolSampleTrilinear(const BrickPool& pool, const DirectX::XMFLOAT3& uvw);
+
+uint64_t BrickPoolGetMemorySize(const BrickPool& pool);
+
+// Memory of the dense storage that a brick pool replaces: R8 occupancy and RGBA8 albedo volumes of gridSize^3 voxels,
+// both with full mip chains.
+uint64_t BrickPoolGetDenseMemorySize(int gridSize);
\ No newline at end of file
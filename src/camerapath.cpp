@@ -0,0 +1,172 @@
+#include "camerapath.h"
+
+#include <fstream>
+#include <sstream>
+#include <string>
+#include <algorithm>
+#include <cmath>
+#include <cstring>
+#include <cstdint>
+
+static const uint32_t kCameraPathMagic = 0x48544150; // "PATH"
+static const uint32_t kCameraPathVersion = 1;
+
+static const float kCameraPathDefaultLook[3] = { 0.0f, 0.0f, 1.0f };
+
+struct CameraPathFileHeader
+{
+    uint32_t Magic;
+    uint32_t Version;
+    uint32_t NumKeys;
+    uint32_t Reserved;
+};
+
+void CameraPathAddKey(CameraPath* pPath, float seconds, const float position[3], const float look[3])
+{
+    CameraPathKey key;
+    key.Seconds = seconds;
+
+    memcpy(key.Position, position, sizeof(key.Position));
+
+    // a look that can't be normalized keeps the previous key's
+    float lookLength = std::sqrt(look[0] * look[0] + look[1] * look[1] + look[2] * look[2]);
+    if (lookLength < 1e-6f || !std::isfinite(lookLength))
+    {
+        const float* previousLook = pPath->Keys.empty() ? kCameraPathDefaultLook : pPath->Keys.back().Look;
+        memcpy(key.Look, previousLook, sizeof(key.Look));
+    }
+    else
+    {
+        for (int i = 0; i < 3; i++)
+        {
+            key.Look[i] = look[i] / lookLength;
+        }
+    }
+
+    pPath->Keys.push_back(key);
+}
+
+float CameraPathGetDuration(const CameraPath& path)
+{
+    return path.Keys.empty() ? 0.0f : path.Keys.back().Seconds - path.Keys.front().Seconds;
+}
+
+int CameraPathGetNumFrames(const CameraPath& path, float stepSeconds)
+{
+    if (path.Keys.empty())
+        return 0;
+
+    // tolerance so a duration that is a whole number of steps isn't rounded down a frame
+    return (int)std::floor(CameraPathGetDuration(path) / stepSeconds + 1e-3f) + 1;
+}
+
+void CameraPathSample(const CameraPath& path, float seconds, float pPosition[3], float pLook[3])
+{
+    const std::vector<CameraPathKey>& keys = path.Keys;
+    seconds += keys.front().Seconds;
+
+    // the first key after the time, or the last key
+    auto next = std::upper_bound(keys.begin(), keys.end(), seconds,
+        [](float s, const CameraPathKey& key) { return s < key.Seconds; });
+    if (next == keys.begin() || next == keys.end())
+    {
+        const CameraPathKey& end = next == keys.begin() ? keys.front() : keys.back();
+        memcpy(pPosition, end.Position, sizeof(end.Position));
+        memcpy(pLook, end.Look, sizeof(end.Look));
+        return;
+    }
+
+    const CameraPathKey& key0 = *(next - 1);
+    const CameraPathKey& key1 = *next;
+    float t = (seconds - key0.Seconds) / (key1.Seconds - key0.Seconds);
+
+    for (int i = 0; i < 3; i++)
+    {
+        pPosition[i] = key0.Position[i] + (key1.Position[i] - key0.Position[i]) * t;
+        pLook[i] = key0.Look[i] + (key1.Look[i] - key0.Look[i]) * t;
+    }
+
+    // opposite looks cancel out halfway, where the earlier one is kept
+    float lookLength = std::sqrt(pLook[0] * pLook[0] + pLook[1] * pLook[1] + pLook[2] * pLook[2]);
+    if (lookLength < 1e-6f)
+    {
+        memcpy(pLook, key0.Look, sizeof(key0.Look));
+        return;
+    }
+
+    for (int i = 0; i < 3; i++)
+    {
+        pLook[i] /= lookLength;
+    }
+}
+
+// Sampling divides by the look's length and by the time between keys, so neither may be off.
+static bool CameraPathIsValidKey(const CameraPathKey& key)
+{
+    if (!std::isfinite(key.Seconds))
+        return false;
+
+    for (int i = 0; i < 3; i++)
+    {
+        if (!std::isfinite(key.Position[i]) || !std::isfinite(key.Look[i]))
+            return false;
+    }
+
+    return key.Look[0] * key.Look[0] + key.Look[1] * key.Look[1] + key.Look[2] * key.Look[2] > 1e-12f;
+}
+
+bool CameraPathLoad(const char* path, CameraPath* pPath)
+{
+    std::ifstream file(path, std::ios::binary);
+    if (!file)
+        return false;
+
+    std::ostringstream contentsStream;
+    contentsStream << file.rdbuf();
+    std::string contents = contentsStream.str();
+
+    CameraPathFileHeader header;
+    if (contents.size() < sizeof(header))
+        return false;
+
+    memcpy(&header, contents.data(), sizeof(header));
+    if (header.Magic != kCameraPathMagic || header.Version != kCameraPathVersion)
+        return false;
+
+    if (contents.size() != sizeof(header) + (uint64_t)header.NumKeys * sizeof(CameraPathKey))
+        return false;
+
+    std::vector<CameraPathKey> keys(header.NumKeys);
+    if (header.NumKeys != 0)
+        memcpy(keys.data(), contents.data() + sizeof(header), header.NumKeys * sizeof(CameraPathKey));
+
+    for (size_t i = 0; i < keys.size(); i++)
+    {
+        if (!CameraPathIsValidKey(keys[i]))
+            return false;
+
+        if (i > 0 && keys[i].Seconds < keys[i - 1].Seconds)
+            return false;
+    }
+
+    pPath->Keys.swap(keys);
+    return true;
+}
+
+bool CameraPathSave(const char* path, const CameraPath& cameraPath)
+{
+    std::ofstream file(path, std::ios::binary | std::ios::trunc);
+    if (!file)
+        return false;
+
+    CameraPathFileHeader header = {};
+    header.Magic = kCameraPathMagic;
+    header.Version = kCameraPathVersion;
+    header.NumKeys = (uint32_t)cameraPath.Keys.size();
+
+    file.write((const char*)&header, sizeof(header));
+    if (!cameraPath.Keys.empty())
+        file.write((const char*)cameraPath.Keys.data(), cameraPath.Keys.size() * sizeof(CameraPathKey));
+
+    return (bool)file.flush();
+}
\ No newline at end of file
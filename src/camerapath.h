@@ -0,0 +1,37 @@
+#pragma once
+
+#include <vector>
+
+// Camera paths recorded while flying around, for replaying the same views in benchmarks.
+// A path is the camera's position and look direction over time. It is replayed with a fixed timestep by
+// interpolating between the recorded keys, so a replay renders the same frames no matter how fast the recording ran.
+// Nothing here depends on Windows.
+
+struct CameraPathKey
+{
+    float Seconds; // since the start of the recording
+    float Position[3];
+    float Look[3]; // normalized
+};
+
+struct CameraPath
+{
+    std::vector<CameraPathKey> Keys; // ordered by time
+};
+
+// Keys must be added in order of time. A look of zero length keeps the previous key's look, or +z for the first key.
+void CameraPathAddKey(CameraPath* pPath, float seconds, const float position[3], const float look[3]);
+
+float CameraPathGetDuration(const CameraPath& path);
+
+// The frames of a replay with the given timestep, including both ends of the path.
+int CameraPathGetNumFrames(const CameraPath& path, float stepSeconds);
+
+// Interpolates linearly between the keys around the time, then renormalizes the look direction.
+// The time is from the first key, and is clamped to the path. The path must have a key.
+void CameraPathSample(const CameraPath& path, float seconds, float pPosition[3], float pLook[3]);
+
+// Returns false if the file couldn't be read or isn't a camera path, including when its keys aren't in order of time
+// or have values that aren't finite. The path is left as it was then.
+bool CameraPathLoad(const char* path, CameraPath* pPath);
+bool CameraPathSave(const char* path, const CameraPath& cameraPath);
\ No newline at end of file
@@ -19,6 +19,10 @@ std::string MultiByteFromWide(const std::wstring& s);
 
 std::string MultiByteFromHR(HRESULT hr);
 
+// The texels of a format are stored in blocks of blockSize x blockSize, which is 4 for block compressed formats and 1 otherwise.
+// Returns false for formats that don't store a whole number of bytes per block, like R1_UNORM and the video formats.
+bool DXGIFormatGetBlockInfo(DXGI_FORMAT format, int* pBlockSize, int* pBytesPerBlock);
+
 bool detail_CheckHR(HRESULT hr, const char* file, const char* function, int line);
 bool detail_CheckWin32(BOOL okay, const char* file, const char* function, int line);
 
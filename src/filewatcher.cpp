@@ -0,0 +1,286 @@
+#include "filewatcher.h"
+
+#include "shadercache.h"
+
+#include <unordered_map>
+#include <unordered_set>
+#include <memory>
+#include <algorithm>
+#include <cstdio>
+#include <cstdint>
+
+#if defined(_WIN32)
+#include "dxutil.h"
+#elif defined(__linux__)
+#include <sys/inotify.h>
+#include <unistd.h>
+#include <errno.h>
+#endif
+
+#ifdef _WIN32
+static const int kFileWatcherBufferSize = 16 * 1024;
+#endif
+
+struct FileWatcherEntry
+{
+    std::string Path;
+    std::vector<std::string> Files;
+};
+
+struct FileWatcherDirectory
+{
+    std::string Path; // with a trailing slash, or empty for the working directory
+
+#if defined(_WIN32)
+    HANDLE hDirectory;
+    OVERLAPPED Overlapped;
+    DWORD Buffer[kFileWatcherBufferSize / sizeof(DWORD)];
+#elif defined(__linux__)
+    int WatchDescriptor;
+#endif
+};
+
+struct FileWatcher
+{
+    std::vector<FileWatcherEntry> Entries;
+
+    // the entries that depend on each file
+    std::unordered_map<std::string, std::vector<int>> FileEntries;
+
+    // Directories never move, since pending overlapped reads point into them
+    std::vector<std::unique_ptr<FileWatcherDirectory>> Directories;
+
+#ifdef __linux__
+    int InotifyFD;
+#endif
+};
+
+static std::string FileWatcherGetFolder(const std::string& path)
+{
+    size_t slash = path.find_last_of("/\\");
+    return slash == std::string::npos ? std::string() : path.substr(0, slash + 1);
+}
+
+#ifdef _WIN32
+static void FileWatcherIssueRead(FileWatcherDirectory* pDirectory)
+{
+    DWORD notifyFilter = FILE_NOTIFY_CHANGE_LAST_WRITE | FILE_NOTIFY_CHANGE_FILE_NAME | FILE_NOTIFY_CHANGE_SIZE;
+    if (!ReadDirectoryChangesW(pDirectory->hDirectory, pDirectory->Buffer, sizeof(pDirectory->Buffer), FALSE, notifyFilter, NULL, &pDirectory->Overlapped, NULL))
+    {
+        fprintf(stderr, "Failed to watch %s\n", pDirectory->Path.c_str());
+    }
+}
+#endif
+
+static void FileWatcherWatchDirectory(FileWatcher* pWatcher, const std::string& path)
+{
+    for (const std::unique_ptr<FileWatcherDirectory>& pDirectory : pWatcher->Directories)
+    {
+        if (pDirectory->Path == path)
+            return;
+    }
+
+    std::unique_ptr<FileWatcherDirectory> pDirectory(new FileWatcherDirectory());
+    pDirectory->Path = path;
+    std::string osPath = path.empty() ? std::string(".") : path;
+
+#if defined(_WIN32)
+    std::wstring wpath = WideFromMultiByte(osPath);
+    pDirectory->hDirectory = CreateFileW(
+        wpath.c_str(), FILE_LIST_DIRECTORY, FILE_SHARE_READ | FILE_SHARE_WRITE | FILE_SHARE_DELETE, NULL,
+        OPEN_EXISTING, FILE_FLAG_BACKUP_SEMANTICS | FILE_FLAG_OVERLAPPED, NULL);
+    if (pDirectory->hDirectory == INVALID_HANDLE_VALUE)
+    {
+        fprintf(stderr, "Failed to open %s for watching\n", osPath.c_str());
+        return;
+    }
+
+    pDirectory->Overlapped.hEvent = CreateEventW(NULL, TRUE, FALSE, NULL);
+    FileWatcherIssueRead(pDirectory.get());
+#elif defined(__linux__)
+    pDirectory->WatchDescriptor = inotify_add_watch(
+        pWatcher->InotifyFD, osPath.c_str(),
+        IN_CLOSE_WRITE | IN_MODIFY | IN_MOVED_TO | IN_CREATE | IN_DELETE);
+    if (pDirectory->WatchDescriptor == -1)
+    {
+        fprintf(stderr, "Failed to watch %s\n", osPath.c_str());
+        return;
+    }
+#endif
+
+    pWatcher->Directories.push_back(std::move(pDirectory));
+}
+
+static void FileWatcherUpdateEntryFiles(FileWatcher* pWatcher, int entry)
+{
+    FileWatcherEntry& watcherEntry = pWatcher->Entries[entry];
+
+    for (const std::string& file : watcherEntry.Files)
+    {
+        std::vector<int>& fileEntries = pWatcher->FileEntries[file];
+        fileEntries.erase(std::remove(fileEntries.begin(), fileEntries.end(), entry), fileEntries.end());
+    }
+
+    ShaderCacheCollectIncludes(watcherEntry.Path, ShaderCacheReadFile, &watcherEntry.Files);
+
+    for (const std::string& file : watcherEntry.Files)
+    {
+        pWatcher->FileEntries[file].push_back(entry);
+        FileWatcherWatchDirectory(pWatcher, FileWatcherGetFolder(file));
+    }
+}
+
+FileWatcher* FileWatcherCreate()
+{
+    FileWatcher* pWatcher = new FileWatcher();
+
+#ifdef __linux__
+    pWatcher->InotifyFD = inotify_init1(IN_NONBLOCK | IN_CLOEXEC);
+#endif
+
+    return pWatcher;
+}
+
+void FileWatcherDestroy(FileWatcher* pWatcher)
+{
+#ifdef _WIN32
+    for (const std::unique_ptr<FileWatcherDirectory>& pDirectory : pWatcher->Directories)
+    {
+        CancelIo(pDirectory->hDirectory);
+        DWORD numBytes;
+        GetOverlappedResult(pDirectory->hDirectory, &pDirectory->Overlapped, &numBytes, TRUE);
+        CloseHandle(pDirectory->Overlapped.hEvent);
+        CloseHandle(pDirectory->hDirectory);
+    }
+#endif
+
+#ifdef __linux__
+    if (pWatcher->InotifyFD != -1)
+        close(pWatcher->InotifyFD);
+#endif
+
+    delete pWatcher;
+}
+
+int FileWatcherAddEntry(FileWatcher* pWatcher, const std::string& path)
+{
+    FileWatcherEntry entry;
+    entry.Path = path;
+    pWatcher->Entries.push_back(entry);
+
+    int entryIndex = (int)pWatcher->Entries.size() - 1;
+    FileWatcherUpdateEntryFiles(pWatcher, entryIndex);
+    return entryIndex;
+}
+
+static void FileWatcherFileChanged(FileWatcher* pWatcher, const std::string& path, std::unordered_set<int>* pChangedEntries)
+{
+    auto found = pWatcher->FileEntries.find(path);
+    if (found == pWatcher->FileEntries.end())
+        return;
+
+    pChangedEntries->insert(found->second.begin(), found->second.end());
+}
+
+// For when notifications were lost, so anything in the directory might have changed
+static void FileWatcherDirectoryChanged(FileWatcher* pWatcher, const std::string& directory, std::unordered_set<int>* pChangedEntries)
+{
+    for (const auto& fileEntries : pWatcher->FileEntries)
+    {
+        if (FileWatcherGetFolder(fileEntries.first) == directory)
+            pChangedEntries->insert(fileEntries.second.begin(), fileEntries.second.end());
+    }
+}
+
+void FileWatcherPoll(FileWatcher* pWatcher, std::vector<int>* pChangedEntries)
+{
+    std::unordered_set<int> changedEntries;
+
+#if defined(_WIN32)
+    for (const std::unique_ptr<FileWatcherDirectory>& pDirectory : pWatcher->Directories)
+    {
+        DWORD numBytes;
+        if (!GetOverlappedResult(pDirectory->hDirectory, &pDirectory->Overlapped, &numBytes, FALSE))
+        {
+            // ERROR_IO_INCOMPLETE means there's nothing new
+            continue;
+        }
+
+        if (numBytes == 0)
+        {
+            // the buffer overflowed
+            FileWatcherDirectoryChanged(pWatcher, pDirectory->Path, &changedEntries);
+        }
+        else
+        {
+            const uint8_t* pNotification = (const uint8_t*)pDirectory->Buffer;
+            for (;;)
+            {
+                const FILE_NOTIFY_INFORMATION* pInfo = (const FILE_NOTIFY_INFORMATION*)pNotification;
+                std::wstring wname(pInfo->FileName, pInfo->FileNameLength / sizeof(WCHAR));
+                FileWatcherFileChanged(pWatcher, pDirectory->Path + MultiByteFromWide(wname), &changedEntries);
+
+                if (pInfo->NextEntryOffset == 0)
+                    break;
+                pNotification += pInfo->NextEntryOffset;
+            }
+        }
+
+        ResetEvent(pDirectory->Overlapped.hEvent);
+        FileWatcherIssueRead(pDirectory.get());
+    }
+#elif defined(__linux__)
+    alignas(struct inotify_event) char buffer[4096];
+    for (;;)
+    {
+        ssize_t numBytes = read(pWatcher->InotifyFD, buffer, sizeof(buffer));
+        if (numBytes <= 0)
+        {
+            // EAGAIN means there's nothing new
+            break;
+        }
+
+        for (char* pEvent = buffer; pEvent < buffer + numBytes; )
+        {
+            const struct inotify_event* pInfo = (const struct inotify_event*)pEvent;
+            pEvent += sizeof(struct inotify_event) + pInfo->len;
+
+            if (pInfo->mask & IN_Q_OVERFLOW)
+            {
+                for (const std::unique_ptr<FileWatcherDirectory>& pDirectory : pWatcher->Directories)
+                {
+                    FileWatcherDirectoryChanged(pWatcher, pDirectory->Path, &changedEntries);
+                }
+                continue;
+            }
+
+            if (pInfo->len == 0)
+                continue;
+
+            for (const std::unique_ptr<FileWatcherDirectory>& pDirectory : pWatcher->Directories)
+            {
+                if (pDirectory->WatchDescriptor == pInfo->wd)
+                {
+                    FileWatcherFileChanged(pWatcher, pDirectory->Path + pInfo->name, &changedEntries);
+                    break;
+                }
+            }
+        }
+    }
+#endif
+
+    std::vector<int> sortedEntries(changedEntries.begin(), changedEntries.end());
+    std::sort(sortedEntries.begin(), sortedEntries.end());
+
+    for (int entry : sortedEntries)
+    {
+        FileWatcherUpdateEntryFiles(pWatcher, entry);
+    }
+
+    pChangedEntries->insert(pChangedEntries->end(), sortedEntries.begin(), sortedEntries.end());
+}
+
+const std::vector<std::string>& FileWatcherGetEntryFiles(const FileWatcher* pWatcher, int entry)
+{
+    return pWatcher->Entries[entry].Files;
+}
\ No newline at end of file
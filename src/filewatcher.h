@@ -0,0 +1,24 @@
+#pragma once
+
+#include <string>
+#include <vector>
+
+// Event-driven file watching for hot reloading.
+// Every entry is a file along with the files it transitively includes (see ShaderCacheCollectIncludes).
+// The folders of all those files are watched with ReadDirectoryChangesW on Windows and inotify on Linux,
+// and a change to any file is reported for exactly the entries that depend on it.
+
+struct FileWatcher;
+
+FileWatcher* FileWatcherCreate();
+void FileWatcherDestroy(FileWatcher* pWatcher);
+
+// Returns the index of the new entry.
+int FileWatcherAddEntry(FileWatcher* pWatcher, const std::string& path);
+
+// Doesn't block. Appends the entries affected by changes since the last poll, each one at most once.
+// The include graph of the affected entries is scanned again, since the changes can add or remove includes.
+void FileWatcherPoll(FileWatcher* pWatcher, std::vector<int>* pChangedEntries);
+
+// The files an entry currently depends on, itself first.
+const std::vector<std::string>& FileWatcherGetEntryFiles(const FileWatcher* pWatcher, int entry);
\ No newline at end of file
@@ -0,0 +1,302 @@
+#include "fontcache.h"
+
+#include "stb_rect_pack.h"
+
+#include <fstream>
+#include <sstream>
+#include <string>
+#include <vector>
+#include <cstring>
+#include <cstdio>
+
+#ifdef _WIN32
+#define NOMINMAX
+#define WIN32_LEAN_AND_MEAN
+#include <Windows.h>
+#endif
+
+static const uint32_t kFontCacheMagic = 0x43544E46; // "FNTC"
+static const uint32_t kFontCacheVersion = 1;
+
+struct FontCacheFileHeader
+{
+    uint32_t Magic;
+    uint32_t Version;
+    uint64_t Key;
+    uint32_t TexWidth;
+    uint32_t TexHeight;
+    uint32_t CustomRectX; // where the mouse cursors and white pixel were packed
+    uint32_t CustomRectY;
+    uint32_t NumFonts;
+    uint32_t Reserved;
+};
+
+// One per font, in the order of the atlas' inputs that aren't merged into another font, followed by its glyphs.
+struct FontCacheFileFont
+{
+    float FontSize;
+    float Ascent;
+    float Descent;
+    uint32_t NumGlyphs;
+};
+
+struct FontCacheFileGlyph
+{
+    uint32_t Codepoint;
+    float XAdvance;
+    float X0, Y0, X1, Y1;
+    float U0, V0, U1, V1;
+};
+
+static uint64_t FontCacheHash(const void* data, size_t size, uint64_t hash)
+{
+    // FNV-1a
+    const uint8_t* bytes = (const uint8_t*)data;
+    for (size_t i = 0; i < size; i++)
+    {
+        hash ^= bytes[i];
+        hash *= 0x100000001B3ull;
+    }
+    return hash;
+}
+
+template<class T>
+static uint64_t FontCacheHashValue(const T& value, uint64_t hash)
+{
+    return FontCacheHash(&value, sizeof(value), hash);
+}
+
+static int FontCacheGetNumFonts(const ImFontAtlas& atlas)
+{
+    int numFonts = 0;
+    for (const ImFontConfig& cfg : atlas.ConfigData)
+    {
+        if (!cfg.MergeMode)
+            numFonts++;
+    }
+    return numFonts;
+}
+
+uint64_t FontCacheComputeKey(const ImFontAtlas& atlas)
+{
+    uint64_t hash = FontCacheHashValue(kFontCacheVersion, 0xCBF29CE484222325ull);
+    hash = FontCacheHashValue(atlas.TexDesiredWidth, hash);
+    hash = FontCacheHashValue(atlas.ConfigData.Size, hash);
+
+    for (const ImFontConfig& cfg : atlas.ConfigData)
+    {
+        hash = FontCacheHashValue(cfg.FontDataSize, hash);
+        hash = FontCacheHash(cfg.FontData, (size_t)cfg.FontDataSize, hash);
+        hash = FontCacheHashValue(cfg.FontNo, hash);
+        hash = FontCacheHashValue(cfg.SizePixels, hash);
+        hash = FontCacheHashValue(cfg.OversampleH, hash);
+        hash = FontCacheHashValue(cfg.OversampleV, hash);
+        hash = FontCacheHashValue(cfg.PixelSnapH, hash);
+        hash = FontCacheHashValue(cfg.GlyphExtraSpacing.x, hash);
+        hash = FontCacheHashValue(cfg.GlyphExtraSpacing.y, hash);
+        hash = FontCacheHashValue(cfg.MergeMode, hash);
+        hash = FontCacheHashValue(cfg.MergeGlyphCenterV, hash);
+
+        // which font the glyphs go to
+        int fontIndex = 0;
+        while (fontIndex < atlas.Fonts.Size && atlas.Fonts[fontIndex] != cfg.DstFont)
+            fontIndex++;
+        hash = FontCacheHashValue(fontIndex, hash);
+
+        // no ranges means the default ranges, as in Build()
+        const ImWchar* ranges = cfg.GlyphRanges ? cfg.GlyphRanges : ((ImFontAtlas&)atlas).GetGlyphRangesDefault();
+        int numRanges = 0;
+        while (ranges[numRanges * 2] && ranges[numRanges * 2 + 1])
+            numRanges++;
+        hash = FontCacheHashValue(numRanges, hash);
+        hash = FontCacheHash(ranges, numRanges * 2 * sizeof(ImWchar), hash);
+    }
+
+    return hash;
+}
+
+bool FontCacheLoad(const char* path, ImFontAtlas* pAtlas)
+{
+    if (pAtlas->ConfigData.empty())
+        return false;
+
+    std::ifstream file(path, std::ios::binary);
+    if (!file)
+        return false;
+
+    std::ostringstream contentsStream;
+    contentsStream << file.rdbuf();
+    std::string contents = contentsStream.str();
+
+    FontCacheFileHeader header;
+    if (contents.size() < sizeof(header))
+        return false;
+
+    memcpy(&header, contents.data(), sizeof(header));
+    if (header.Magic != kFontCacheMagic || header.Version != kFontCacheVersion || header.Key != FontCacheComputeKey(*pAtlas))
+        return false;
+
+    if (header.NumFonts != (uint32_t)FontCacheGetNumFonts(*pAtlas))
+        return false;
+
+    // validate the whole file before touching the atlas
+    uint64_t offset = sizeof(header);
+    for (uint32_t fontIndex = 0; fontIndex < header.NumFonts; fontIndex++)
+    {
+        FontCacheFileFont font;
+        if (offset + sizeof(font) > contents.size())
+            return false;
+
+        memcpy(&font, contents.data() + offset, sizeof(font));
+        offset += sizeof(font) + (uint64_t)font.NumGlyphs * sizeof(FontCacheFileGlyph);
+    }
+
+    uint64_t pixelsSize = (uint64_t)header.TexWidth * header.TexHeight;
+    if (offset + pixelsSize != contents.size())
+        return false;
+
+    ImFontAtlas& atlas = *pAtlas;
+    atlas.ClearTexData();
+    atlas.TexID = NULL;
+    atlas.TexWidth = (int)header.TexWidth;
+    atlas.TexHeight = (int)header.TexHeight;
+    atlas.TexPixelsAlpha8 = (unsigned char*)ImGui::MemAlloc((size_t)pixelsSize);
+    memcpy(atlas.TexPixelsAlpha8, contents.data() + offset, (size_t)pixelsSize);
+
+    // the same setup as the end of Build(), with the glyphs from the file
+    offset = sizeof(header);
+    for (ImFontConfig& cfg : atlas.ConfigData)
+    {
+        ImFont* dstFont = cfg.DstFont;
+        if (!cfg.MergeMode)
+        {
+            FontCacheFileFont font;
+            memcpy(&font, contents.data() + offset, sizeof(font));
+            offset += sizeof(font);
+
+            dstFont->ContainerAtlas = &atlas;
+            dstFont->ConfigData = &cfg;
+            dstFont->ConfigDataCount = 0;
+            dstFont->FontSize = font.FontSize;
+            dstFont->Ascent = font.Ascent;
+            dstFont->Descent = font.Descent;
+            dstFont->FallbackGlyph = NULL;
+            dstFont->Glyphs.resize((int)font.NumGlyphs);
+            for (uint32_t glyphIndex = 0; glyphIndex < font.NumGlyphs; glyphIndex++)
+            {
+                FontCacheFileGlyph fileGlyph;
+                memcpy(&fileGlyph, contents.data() + offset, sizeof(fileGlyph));
+                offset += sizeof(fileGlyph);
+
+                ImFont::Glyph& glyph = dstFont->Glyphs[glyphIndex];
+                glyph.Codepoint = (ImWchar)fileGlyph.Codepoint;
+                glyph.XAdvance = fileGlyph.XAdvance;
+                glyph.X0 = fileGlyph.X0; glyph.Y0 = fileGlyph.Y0; glyph.X1 = fileGlyph.X1; glyph.Y1 = fileGlyph.Y1;
+                glyph.U0 = fileGlyph.U0; glyph.V0 = fileGlyph.V0; glyph.U1 = fileGlyph.U1; glyph.V1 = fileGlyph.V1;
+            }
+        }
+        dstFont->ConfigDataCount++;
+    }
+
+    // sets up the white pixel and the mouse cursors
+    ImVector<stbrp_rect> extraRects;
+    atlas.RenderCustomTexData(0, &extraRects);
+    extraRects[0].x = (stbrp_coord)header.CustomRectX;
+    extraRects[0].y = (stbrp_coord)header.CustomRectY;
+    atlas.RenderCustomTexData(1, &extraRects);
+
+    for (ImFont* font : atlas.Fonts)
+    {
+        if (font->ContainerAtlas == &atlas)
+            font->BuildLookupTable();
+    }
+
+    return true;
+}
+
+bool FontCacheSave(const char* path, const ImFontAtlas& atlas)
+{
+    if (!atlas.TexPixelsAlpha8 || atlas.RasterizeOnDemand)
+        return false;
+
+    FontCacheFileHeader header = {};
+    header.Magic = kFontCacheMagic;
+    header.Version = kFontCacheVersion;
+    header.Key = FontCacheComputeKey(atlas);
+    header.TexWidth = (uint32_t)atlas.TexWidth;
+    header.TexHeight = (uint32_t)atlas.TexHeight;
+    // the white pixel is the center of the custom rect's first texel
+    header.CustomRectX = (uint32_t)(atlas.TexUvWhitePixel.x * atlas.TexWidth);
+    header.CustomRectY = (uint32_t)(atlas.TexUvWhitePixel.y * atlas.TexHeight);
+    header.NumFonts = (uint32_t)FontCacheGetNumFonts(atlas);
+
+    std::string tempPath = std::string(path) + ".tmp";
+    {
+        std::ofstream file(tempPath, std::ios::binary | std::ios::trunc);
+        if (!file)
+            return false;
+
+        file.write((const char*)&header, sizeof(header));
+
+        std::vector<FontCacheFileGlyph> fileGlyphs;
+        for (const ImFontConfig& cfg : atlas.ConfigData)
+        {
+            if (cfg.MergeMode)
+                continue;
+
+            const ImFont* dstFont = cfg.DstFont;
+            FontCacheFileFont font = {};
+            font.FontSize = dstFont->FontSize;
+            font.Ascent = dstFont->Ascent;
+            font.Descent = dstFont->Descent;
+            font.NumGlyphs = (uint32_t)dstFont->Glyphs.Size;
+            file.write((const char*)&font, sizeof(font));
+
+            fileGlyphs.resize(dstFont->Glyphs.Size);
+            for (int glyphIndex = 0; glyphIndex < dstFont->Glyphs.Size; glyphIndex++)
+            {
+                const ImFont::Glyph& glyph = dstFont->Glyphs[glyphIndex];
+                FontCacheFileGlyph& fileGlyph = fileGlyphs[glyphIndex];
+                fileGlyph.Codepoint = glyph.Codepoint;
+                fileGlyph.XAdvance = glyph.XAdvance;
+                fileGlyph.X0 = glyph.X0; fileGlyph.Y0 = glyph.Y0; fileGlyph.X1 = glyph.X1; fileGlyph.Y1 = glyph.Y1;
+                fileGlyph.U0 = glyph.U0; fileGlyph.V0 = glyph.V0; fileGlyph.U1 = glyph.U1; fileGlyph.V1 = glyph.V1;
+            }
+            if (!fileGlyphs.empty())
+                file.write((const char*)fileGlyphs.data(), fileGlyphs.size() * sizeof(fileGlyphs[0]));
+        }
+
+        file.write((const char*)atlas.TexPixelsAlpha8, (size_t)atlas.TexWidth * atlas.TexHeight);
+
+        if (!file.flush())
+            return false;
+    }
+
+#ifdef _WIN32
+    if (!MoveFileExA(tempPath.c_str(), path, MOVEFILE_REPLACE_EXISTING | MOVEFILE_WRITE_THROUGH))
+        return false;
+#else
+    if (std::rename(tempPath.c_str(), path) != 0)
+        return false;
+#endif
+
+    return true;
+}
+
+bool FontCacheBuild(const char* path, ImFontAtlas* pAtlas)
+{
+    if (pAtlas->ConfigData.empty())
+        pAtlas->AddFontDefault();
+
+    if (pAtlas->RasterizeOnDemand)
+        return pAtlas->Build();
+
+    if (FontCacheLoad(path, pAtlas))
+        return true;
+
+    if (!pAtlas->Build())
+        return false;
+
+    FontCacheSave(path, *pAtlas);
+    return true;
+}
\ No newline at end of file
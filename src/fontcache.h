@@ -0,0 +1,28 @@
+#pragma once
+
+#include "imgui.h"
+
+#include <cstdint>
+
+// Disk cache of a baked ImGui font atlas, so launches after the first skip rasterizing and packing the glyphs.
+// The file holds the atlas' alpha pixels and every font's metrics and glyphs, and is keyed by a hash of everything that
+// affects baking: the TTF data of each font, its pixel size, oversampling, spacing and glyph ranges, and the atlas width.
+// A hit is loaded with one read of the file and no stb_truetype calls.
+// This version of ImGui has no kerning, so there are no kerning pairs to store.
+// Nothing here depends on D3D or on Windows.
+
+// The fonts must be added to the atlas before the key is computed.
+uint64_t FontCacheComputeKey(const ImFontAtlas& atlas);
+
+// Loads the atlas from the file if it was saved from an atlas with the same key.
+// Returns false on a miss, leaving the atlas unbuilt.
+bool FontCacheLoad(const char* path, ImFontAtlas* pAtlas);
+
+// The atlas must be built. Writes a temporary file and renames it over the cache file, like the shader cache.
+// Returns false if the file couldn't be written.
+bool FontCacheSave(const char* path, const ImFontAtlas& atlas);
+
+// Builds the atlas from the cache, or bakes it and saves it on a miss. Adds the default font to an empty atlas, like GetTexData*.
+// Atlases that rasterize on demand have nothing baked to cache, so they are built as usual.
+// Returns false if the atlas couldn't be built. A cache that couldn't be written isn't an error.
+bool FontCacheBuild(const char* path, ImFontAtlas* pAtlas);
\ No newline at end of file
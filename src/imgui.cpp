@@ -1260,112 +1260,104 @@ void* ImLoadFileToMemory(const char* filename, const char* file_open_mode, int*
 void ImGuiStorage::Clear()
 {
     Data.clear();
+    Index.clear();
 }
 
-// std::lower_bound but without the bullshit
-static ImVector<ImGuiStorage::Pair>::iterator LowerBound(ImVector<ImGuiStorage::Pair>& data, ImU32 key)
+static inline int StorageHashSlot(ImGuiID key, int mask)
 {
-    ImVector<ImGuiStorage::Pair>::iterator first = data.begin();
-    ImVector<ImGuiStorage::Pair>::iterator last = data.end();
-    int count = (int)(last - first);
-    while (count > 0)
+    // Keys are already hashed, but nearby keys from the same ID stack shouldn't land in nearby slots
+    ImU32 h = key * 0x9E3779B1u;
+    return (int)((h ^ (h >> 16)) & (ImU32)mask);
+}
+
+// Slot of the key in the index, or the empty slot where it belongs. The index must not be full.
+static int StorageFindSlot(const ImGuiStorage& storage, ImGuiID key)
+{
+    const int mask = storage.Index.Size - 1;
+    for (int slot = StorageHashSlot(key, mask); ; slot = (slot + 1) & mask)
     {
-        int count2 = count / 2;
-        ImVector<ImGuiStorage::Pair>::iterator mid = first + count2;
-        if (mid->key < key)
-        {
-            first = ++mid;
-            count -= count2 + 1;
-        }
-        else
-        {
-            count = count2;
-        }
+        const int i = storage.Index[slot];
+        if (i < 0 || storage.Data[i].key == key)
+            return slot;
+    }
+}
+
+static const ImGuiStorage::Pair* StorageFind(const ImGuiStorage& storage, ImGuiID key)
+{
+    if (storage.Index.empty())
+        return NULL;
+    const int i = storage.Index[StorageFindSlot(storage, key)];
+    return (i >= 0) ? &storage.Data[i] : NULL;
+}
+
+// Find the pair, insert 'pair' if missing
+static ImGuiStorage::Pair* StorageFindOrInsert(ImGuiStorage& storage, const ImGuiStorage::Pair& pair)
+{
+    if ((storage.Data.Size + 1) * 4 > storage.Index.Size * 3)
+    {
+        storage.Index.resize(storage.Index.empty() ? 16 : storage.Index.Size * 2);
+        for (int slot = 0; slot < storage.Index.Size; slot++)
+            storage.Index[slot] = -1;
+        for (int i = 0; i < storage.Data.Size; i++)
+            storage.Index[StorageFindSlot(storage, storage.Data[i].key)] = i;
     }
-    return first;
+
+    const int slot = StorageFindSlot(storage, pair.key);
+    if (storage.Index[slot] < 0)
+    {
+        storage.Index[slot] = storage.Data.Size;
+        storage.Data.push_back(pair);
+    }
+    return &storage.Data[storage.Index[slot]];
 }
 
 int ImGuiStorage::GetInt(ImU32 key, int default_val) const
 {
-    ImVector<Pair>::iterator it = LowerBound(const_cast<ImVector<ImGuiStorage::Pair>&>(Data), key);
-    if (it == Data.end() || it->key != key)
-        return default_val;
-    return it->val_i;
+    const Pair* pair = StorageFind(*this, key);
+    return pair ? pair->val_i : default_val;
 }
 
 float ImGuiStorage::GetFloat(ImU32 key, float default_val) const
 {
-    ImVector<Pair>::iterator it = LowerBound(const_cast<ImVector<ImGuiStorage::Pair>&>(Data), key);
-    if (it == Data.end() || it->key != key)
-        return default_val;
-    return it->val_f;
+    const Pair* pair = StorageFind(*this, key);
+    return pair ? pair->val_f : default_val;
 }
 
 void* ImGuiStorage::GetVoidPtr(ImGuiID key) const
 {
-    ImVector<Pair>::iterator it = LowerBound(const_cast<ImVector<ImGuiStorage::Pair>&>(Data), key);
-    if (it == Data.end() || it->key != key)
-        return NULL;
-    return it->val_p;
+    const Pair* pair = StorageFind(*this, key);
+    return pair ? pair->val_p : NULL;
 }
 
 // References are only valid until a new value is added to the storage. Calling a Set***() function or a Get***Ref() function invalidates the pointer.
 int* ImGuiStorage::GetIntRef(ImGuiID key, int default_val)
 {
-    ImVector<Pair>::iterator it = LowerBound(Data, key);
-    if (it == Data.end() || it->key != key)
-        it = Data.insert(it, Pair(key, default_val));
-    return &it->val_i;
+    return &StorageFindOrInsert(*this, Pair(key, default_val))->val_i;
 }
 
 float* ImGuiStorage::GetFloatRef(ImGuiID key, float default_val)
 {
-    ImVector<Pair>::iterator it = LowerBound(Data, key);
-    if (it == Data.end() || it->key != key)
-        it = Data.insert(it, Pair(key, default_val));
-    return &it->val_f;
+    return &StorageFindOrInsert(*this, Pair(key, default_val))->val_f;
 }
 
 void** ImGuiStorage::GetVoidPtrRef(ImGuiID key, void* default_val)
 {
-    ImVector<Pair>::iterator it = LowerBound(Data, key);
-    if (it == Data.end() || it->key != key)
-        it = Data.insert(it, Pair(key, default_val));
-    return &it->val_p;
+    return &StorageFindOrInsert(*this, Pair(key, default_val))->val_p;
 }
 
-// FIXME-OPT: Need a way to reuse the result of lower_bound when doing GetInt()/SetInt() - not too bad because it only happens on explicit interaction (maximum one a frame)
 void ImGuiStorage::SetInt(ImU32 key, int val)
 {
-    ImVector<Pair>::iterator it = LowerBound(Data, key);
-    if (it == Data.end() || it->key != key)
-    {
-        Data.insert(it, Pair(key, val));
-        return;
-    }
-    it->val_i = val;
+    StorageFindOrInsert(*this, Pair(key, val))->val_i = val;
 }
 
 void ImGuiStorage::SetFloat(ImU32 key, float val)
 {
-    ImVector<Pair>::iterator it = LowerBound(Data, key);
-    if (it == Data.end() || it->key != key)
-    {
-        Data.insert(it, Pair(key, val));
-        return;
-    }
-    it->val_f = val;
+    StorageFindOrInsert(*this, Pair(key, val))->val_f = val;
 }
 
 void ImGuiStorage::SetVoidPtr(ImU32 key, void* val)
 {
-    ImVector<Pair>::iterator it = LowerBound(Data, key);
-    if (it == Data.end() || it->key != key)
-    {
-        Data.insert(it, Pair(key, val));
-        return;
-    }
-    it->val_p = val;
+    StorageFindOrInsert(*this, Pair(key, val))->val_p = val;
 }
 
 void ImGuiStorage::SetAllInt(int v)
@@ -1925,6 +1917,8 @@ void ImGui::NewFrame()
         g.Initialized = true;
     }
 
+    // Make room in the font atlas if glyphs didn't fit last frame
+    g.IO.Fonts->NewFrame();
     SetCurrentFont(g.IO.Fonts->Fonts[0]);
 
     g.Time += g.IO.DeltaTime;
@@ -2128,6 +2122,7 @@ void ImGui::Shutdown()
         ImGui::MemFree(g.Windows[i]);
     }
     g.Windows.clear();
+    g.WindowsById.Clear();
     g.WindowsSortBuffer.clear();
     g.CurrentWindowStack.clear();
     g.FocusedWindow = NULL;
@@ -3496,13 +3491,8 @@ static ImVec2 FindBestPopupWindowPos(const ImVec2& base_pos, const ImVec2& size,
 
 ImGuiWindow* ImGui::FindWindowByName(const char* name)
 {
-    // FIXME-OPT: Store sorted hashes -> pointers so we can do a bissection in a contiguous block
     ImGuiState& g = *GImGui;
-    ImGuiID id = ImHash(name, 0);
-    for (int i = 0; i < g.Windows.Size; i++)
-        if (g.Windows[i]->ID == id)
-            return g.Windows[i];
-    return NULL;
+    return (ImGuiWindow*)g.WindowsById.GetVoidPtr(ImHash(name, 0));
 }
 
 static ImGuiWindow* CreateNewWindow(const char* name, ImVec2 size, ImGuiWindowFlags flags)
@@ -3568,6 +3558,7 @@ static ImGuiWindow* CreateNewWindow(const char* name, ImVec2 size, ImGuiWindowFl
         g.Windows.insert(g.Windows.begin(), window); // Quite slow but rare and only once
     else
         g.Windows.push_back(window);
+    g.WindowsById.SetVoidPtr(window->ID, window);
     return window;
 }
 
@@ -9387,7 +9378,7 @@ void ImGui::ShowMetricsWindow(bool* opened)
                 NodeDrawList(window->DrawList, "DrawList");
                 if (window->RootWindow != window) NodeWindow(window->RootWindow, "RootWindow");
                 if (window->DC.ChildWindows.Size > 0) NodeWindows(window->DC.ChildWindows, "ChildWindows");
-                ImGui::BulletText("Storage: %d bytes", window->StateStorage.Data.Size * (int)sizeof(ImGuiStorage::Pair));
+                ImGui::BulletText("Storage: %d bytes", window->StateStorage.Data.Size * (int)sizeof(ImGuiStorage::Pair) + window->StateStorage.Index.Size * (int)sizeof(int));
                 ImGui::TreePop();
             }
         };
@@ -932,11 +932,12 @@ struct ImGuiStorage
         Pair(ImGuiID _key, float _val_f) { key = _key; val_f = _val_f; }
         Pair(ImGuiID _key, void* _val_p) { key = _key; val_p = _val_p; }
     };
-    ImVector<Pair>      Data;
+    ImVector<Pair>      Data;               // In insertion order
+    ImVector<int>       Index;              // Open addressing hash table of indices into Data, -1 for empty slots. Power of 2 size, at most 3/4 full.
 
-    // - Get***() functions find pair, never add/allocate. Pairs are sorted so a query is O(log N)
+    // - Get***() functions find pair, never add/allocate. Pairs are hashed so a query is O(1)
     // - Set***() functions find pair, insertion on demand if missing.
-    // - Sorted insertion is costly but should amortize. A typical frame shouldn't need to insert any new pair.
+    // - Insertion is O(1) amortized, the index is rebuilt when it doubles.
     IMGUI_API void      Clear();
     IMGUI_API int       GetInt(ImGuiID key, int default_val = 0) const;
     IMGUI_API void      SetInt(ImGuiID key, int val);
@@ -1230,6 +1231,11 @@ struct ImFontConfig
 //  3. Upload the pixels data into a texture within your graphics system.
 //  4. Call SetTexID(my_tex_id); and pass the pointer/identifier to your texture. This value will be passed back to you during rendering to identify the texture.
 //  5. Call ClearTexData() to free textures memory on the heap.
+// Alternatively, set RasterizeOnDemand before step 2 to only rasterize glyphs the first time they are used, instead of every glyph in the ranges.
+// The texture is then a fixed page of TexDesiredWidth x TexDesiredWidth (512 if 0, and at least 256 to fit the mouse cursors), and glyphs that are not in the font use the fallback glyph.
+// When the page is full, glyphs that didn't fit use the fallback glyph until the next NewFrame() evicts the least recently used glyphs,
+// which moves the others and increments TexGeneration. Newly rasterized glyphs extend the TexDirty rectangle, which your renderer must copy
+// to the texture before rendering and then clear with ClearTexDirty(). Don't call ClearTexData() or ClearInputData(), which stop rasterization.
 struct ImFontAtlas
 {
     IMGUI_API ImFontAtlas();
@@ -1273,9 +1279,21 @@ struct ImFontAtlas
     ImVec2                      TexUvWhitePixel;    // Texture coordinates to a white pixel
     ImVector<ImFont*>           Fonts;              // Hold all the fonts returned by AddFont*. Fonts[0] is the default font upon calling ImGui::NewFrame(), use ImGui::PushFont()/PopFont() to change the current font.
 
+    // On-demand rasterization (see above)
+    bool                        RasterizeOnDemand;  // = false
+    int                         TexGeneration;      // Incremented when glyphs are evicted, so UVs cached outside of the fonts can be invalidated
+    bool                        TexDirty;           // Pixels changed since ClearTexDirty(), within TexDirtyX0 <= x < TexDirtyX1, TexDirtyY0 <= y < TexDirtyY1
+    int                         TexDirtyX0, TexDirtyY0, TexDirtyX1, TexDirtyY1;
+    void                        ClearTexDirty()     { TexDirty = false; }
+    IMGUI_API void              NewFrame();         // Evicts glyphs if the page filled up. Called by ImGui::NewFrame().
+
     // Private
     ImVector<ImFontConfig>      ConfigData;         // Internal data
+    void*                       OnDemandData;       // Internal data for RasterizeOnDemand
     IMGUI_API bool              Build();            // Build pixels data. This is automatically for you by the GetTexData*** functions.
+    IMGUI_API bool              BuildOnDemand();
+    IMGUI_API int               FindGlyphOnDemand(ImFont* font, unsigned short c);  // Index of the glyph in font->Glyphs, rasterized first if needed, or -1
+    IMGUI_API void              EvictGlyphsOnDemand();
     IMGUI_API void              RenderCustomTexData(int pass, void* rects);
 };
 
@@ -1306,6 +1324,7 @@ struct ImFont
     float                       FallbackXAdvance;   //
     ImVector<float>             IndexXAdvance;      // Sparse. Glyphs->XAdvance directly indexable (more cache-friendly that reading from Glyphs, for CalcTextSize functions which are often bottleneck in large UI)
     ImVector<int>               IndexLookup;        // Sparse. Index glyphs by Unicode code-point.
+    ImVector<int>               GlyphsLastUsedFrame;// Parallel to Glyphs, for evicting on-demand glyphs
 
     // Methods
     IMGUI_API ImFont();
@@ -1314,7 +1333,8 @@ struct ImFont
     IMGUI_API void              BuildLookupTable();
     IMGUI_API const Glyph*      FindGlyph(unsigned short c) const;
     IMGUI_API void              SetFallbackChar(ImWchar c);
-    float                       GetCharAdvance(unsigned short c) const  { return ((int)c < IndexXAdvance.Size) ? IndexXAdvance[(int)c] : FallbackXAdvance; }
+    float                       GetCharAdvance(unsigned short c) const  { return ((int)c < IndexXAdvance.Size && IndexXAdvance[(int)c] >= 0.0f) ? IndexXAdvance[(int)c] : FindCharAdvance(c); }
+    IMGUI_API float             FindCharAdvance(unsigned short c) const;    // Slow path of GetCharAdvance(), for characters without a glyph yet
     bool                        IsLoaded() const                        { return ContainerAtlas != NULL; }
 
     // 'max_width' stops rendering after a certain width (could be turned into a 2d size). FLT_MAX to disable.
@@ -18,6 +18,8 @@
 #include "imgui_internal.h"
 
 #include <stdio.h>      // vsnprintf, sscanf, printf
+#include <stdlib.h>     // qsort
+#include <limits.h>     // INT_MAX
 #if !defined(alloca) && !defined(__FreeBSD__) && !defined(__DragonFly__)
 #ifdef _WIN32
 #include <malloc.h>     // alloca
@@ -26,6 +28,17 @@
 #endif
 #endif
 
+// SSE2 is available on every x64 target. Define IMGUI_DISABLE_SSE to use the scalar tessellation paths instead.
+#if !defined(IMGUI_DISABLE_SSE) && (defined(__SSE2__) || defined(_M_X64) || (defined(_M_IX86_FP) && _M_IX86_FP >= 2))
+#define IMGUI_ENABLE_SSE2
+#include <emmintrin.h>
+#endif
+
+// Index patterns are written 8 at a time, which needs the default 16-bit ImDrawIdx
+#if defined(IMGUI_ENABLE_SSE2) && !defined(ImDrawIdx)
+#define IMGUI_ENABLE_SSE2_INDICES
+#endif
+
 #ifdef _MSC_VER
 #pragma warning (disable: 4505) // unreferenced local function has been removed (stb stuff)
 #pragma warning (disable: 4996) // 'This function or variable may be unsafe': strcpy, strdup, sprintf, vsnprintf, sscanf, fopen
@@ -389,6 +402,50 @@ void ImDrawList::PrimQuadUV(const ImVec2& a, const ImVec2& b, const ImVec2& c, c
     _IdxWritePtr += 6;
 }
 
+// Unit normal of the edge from each point to the next one, wrapping around to the first point after the last
+static void ImDrawListComputeEdgeNormals(const ImVec2* points, const int points_count, ImVec2* out_normals)
+{
+    int i1 = 0;
+#ifdef IMGUI_ENABLE_SSE2
+    // Two edges per iteration, as x0 y0 x1 y1
+    const __m128 one = _mm_set1_ps(1.0f);
+    const __m128 negate_odd = _mm_castsi128_ps(_mm_set_epi32((int)0x80000000, 0, (int)0x80000000, 0));
+    for (; i1 + 2 < points_count; i1 += 2)
+    {
+        __m128 diff = _mm_sub_ps(_mm_loadu_ps(&points[i1+1].x), _mm_loadu_ps(&points[i1].x));
+        __m128 sq = _mm_mul_ps(diff, diff);
+        __m128 d = _mm_add_ps(sq, _mm_shuffle_ps(sq, sq, _MM_SHUFFLE(2,3,0,1)));
+        __m128 has_length = _mm_cmpgt_ps(d, _mm_setzero_ps());
+        __m128 inv_length = _mm_div_ps(one, _mm_sqrt_ps(d));
+        inv_length = _mm_or_ps(_mm_and_ps(has_length, inv_length), _mm_andnot_ps(has_length, one)); // Same as ImInvLength(diff, 1.0f)
+        diff = _mm_mul_ps(diff, inv_length);
+        _mm_storeu_ps(&out_normals[i1].x, _mm_xor_ps(_mm_shuffle_ps(diff, diff, _MM_SHUFFLE(2,3,0,1)), negate_odd)); // (y, -x)
+    }
+#endif
+    for (; i1 < points_count; i1++)
+    {
+        const int i2 = (i1+1) == points_count ? 0 : i1+1;
+        ImVec2 diff = points[i2] - points[i1];
+        diff *= ImInvLength(diff, 1.0f);
+        out_normals[i1].x = diff.y;
+        out_normals[i1].y = -diff.x;
+    }
+}
+
+// Average of the normals of the two edges of a point, scaled so the offset edges stay parallel to the originals
+static inline ImVec2 ImDrawListAverageNormals(const ImVec2& n0, const ImVec2& n1)
+{
+    ImVec2 dm = (n0 + n1) * 0.5f;
+    float dmr2 = dm.x*dm.x + dm.y*dm.y;
+    if (dmr2 > 0.000001f)
+    {
+        float scale = 1.0f / dmr2;
+        if (scale > 100.0f) scale = 100.0f;
+        dm *= scale;
+    }
+    return dm;
+}
+
 // TODO: Thickness anti-aliased lines cap are missing their AA fringe.
 void ImDrawList::AddPolyline(const ImVec2* points, const int points_count, ImU32 col, bool closed, float thickness, bool anti_aliased)
 {
@@ -415,128 +472,106 @@ void ImDrawList::AddPolyline(const ImVec2* points, const int points_count, ImU32
         PrimReserve(idx_count, vtx_count);
 
         // Temporary buffer
-        ImVec2* temp_normals = (ImVec2*)alloca(points_count * (thick_line ? 5 : 3) * sizeof(ImVec2));
-        ImVec2* temp_points = temp_normals + points_count;
-
-        for (int i1 = 0; i1 < count; i1++)
-        {
-            const int i2 = (i1+1) == points_count ? 0 : i1+1;
-            ImVec2 diff = points[i2] - points[i1];
-            diff *= ImInvLength(diff, 1.0f);
-            temp_normals[i1].x = diff.y;
-            temp_normals[i1].y = -diff.x;
-        }
+        ImVec2* temp_normals = (ImVec2*)alloca(points_count * sizeof(ImVec2));
+        ImDrawListComputeEdgeNormals(points, points_count, temp_normals);
         if (!closed)
             temp_normals[points_count-1] = temp_normals[points_count-2];
 
         if (!thick_line)
         {
-            if (!closed)
-            {
-                temp_points[0] = points[0] + temp_normals[0] * AA_SIZE;
-                temp_points[1] = points[0] - temp_normals[0] * AA_SIZE;
-                temp_points[(points_count-1)*2+0] = points[points_count-1] + temp_normals[points_count-1] * AA_SIZE;
-                temp_points[(points_count-1)*2+1] = points[points_count-1] - temp_normals[points_count-1] * AA_SIZE;
-            }
-
-            // FIXME-OPT: Merge the different loops, possibly remove the temporary buffer.
+#ifdef IMGUI_ENABLE_SSE2_INDICES
+            // Every segment but the closing one has the same indexes relative to idx1, with idx2 = idx1+3
+            __m128i idx_0_7 = _mm_add_epi16(_mm_setr_epi16(3,0,2,2,5,3,4,1), _mm_set1_epi16((short)_VtxCurrentIdx));
+            __m128i idx_8_11 = _mm_add_epi16(_mm_setr_epi16(0,0,3,4,0,0,0,0), _mm_set1_epi16((short)_VtxCurrentIdx));
+            const __m128i idx_step = _mm_set1_epi16(3);
+#endif
             unsigned int idx1 = _VtxCurrentIdx;
-            for (int i1 = 0; i1 < count; i1++)
+            for (int i1 = 0; i1 < points_count; i1++)
             {
-                const int i2 = (i1+1) == points_count ? 0 : i1+1;
-                unsigned int idx2 = (i1+1) == points_count ? _VtxCurrentIdx : idx1+3;
+                // Average normals. The first point of an open line only has one.
+                ImVec2 dm = (i1 == 0 && !closed) ? temp_normals[0] : ImDrawListAverageNormals(temp_normals[i1 == 0 ? points_count-1 : i1-1], temp_normals[i1]);
+                dm *= AA_SIZE;
+
+                // Add vertexes
+                _VtxWritePtr[0].pos = points[i1];      _VtxWritePtr[0].uv = uv; _VtxWritePtr[0].col = col;
+                _VtxWritePtr[1].pos = points[i1] + dm; _VtxWritePtr[1].uv = uv; _VtxWritePtr[1].col = col_trans;
+                _VtxWritePtr[2].pos = points[i1] - dm; _VtxWritePtr[2].uv = uv; _VtxWritePtr[2].col = col_trans;
+                _VtxWritePtr += 3;
 
-                // Average normals
-                ImVec2 dm = (temp_normals[i1] + temp_normals[i2]) * 0.5f;
-                float dmr2 = dm.x*dm.x + dm.y*dm.y;
-                if (dmr2 > 0.000001f)
+                // Add indexes for the segment to the next point
+                if (i1 == count)
+                    break;
+                unsigned int idx2 = (i1+1) == points_count ? _VtxCurrentIdx : idx1+3;
+#ifdef IMGUI_ENABLE_SSE2_INDICES
+                if (i1+1 < points_count)
                 {
-                    float scale = 1.0f / dmr2;
-                    if (scale > 100.0f) scale = 100.0f;
-                    dm *= scale;
+                    _mm_storeu_si128((__m128i*)_IdxWritePtr, idx_0_7);
+                    _mm_storel_epi64((__m128i*)(_IdxWritePtr+8), idx_8_11);
+                    idx_0_7 = _mm_add_epi16(idx_0_7, idx_step);
+                    idx_8_11 = _mm_add_epi16(idx_8_11, idx_step);
+                }
+                else
+#endif
+                {
+                    _IdxWritePtr[0] = (ImDrawIdx)(idx2+0); _IdxWritePtr[1] = (ImDrawIdx)(idx1+0); _IdxWritePtr[2] = (ImDrawIdx)(idx1+2);
+                    _IdxWritePtr[3] = (ImDrawIdx)(idx1+2); _IdxWritePtr[4] = (ImDrawIdx)(idx2+2); _IdxWritePtr[5] = (ImDrawIdx)(idx2+0);
+                    _IdxWritePtr[6] = (ImDrawIdx)(idx2+1); _IdxWritePtr[7] = (ImDrawIdx)(idx1+1); _IdxWritePtr[8] = (ImDrawIdx)(idx1+0);
+                    _IdxWritePtr[9] = (ImDrawIdx)(idx1+0); _IdxWritePtr[10]= (ImDrawIdx)(idx2+0); _IdxWritePtr[11]= (ImDrawIdx)(idx2+1);
                 }
-                dm *= AA_SIZE;
-                temp_points[i2*2+0] = points[i2] + dm;
-                temp_points[i2*2+1] = points[i2] - dm;
-
-                // Add indexes
-                _IdxWritePtr[0] = (ImDrawIdx)(idx2+0); _IdxWritePtr[1] = (ImDrawIdx)(idx1+0); _IdxWritePtr[2] = (ImDrawIdx)(idx1+2);
-                _IdxWritePtr[3] = (ImDrawIdx)(idx1+2); _IdxWritePtr[4] = (ImDrawIdx)(idx2+2); _IdxWritePtr[5] = (ImDrawIdx)(idx2+0);
-                _IdxWritePtr[6] = (ImDrawIdx)(idx2+1); _IdxWritePtr[7] = (ImDrawIdx)(idx1+1); _IdxWritePtr[8] = (ImDrawIdx)(idx1+0);
-                _IdxWritePtr[9] = (ImDrawIdx)(idx1+0); _IdxWritePtr[10]= (ImDrawIdx)(idx2+0); _IdxWritePtr[11]= (ImDrawIdx)(idx2+1);
                 _IdxWritePtr += 12;
-
                 idx1 = idx2;
             }
-
-            // Add vertexes
-            for (int i = 0; i < points_count; i++)
-            {
-                _VtxWritePtr[0].pos = points[i];          _VtxWritePtr[0].uv = uv; _VtxWritePtr[0].col = col;
-                _VtxWritePtr[1].pos = temp_points[i*2+0]; _VtxWritePtr[1].uv = uv; _VtxWritePtr[1].col = col_trans;
-                _VtxWritePtr[2].pos = temp_points[i*2+1]; _VtxWritePtr[2].uv = uv; _VtxWritePtr[2].col = col_trans;
-                _VtxWritePtr += 3;
-            }
         }
         else
         {
             const float half_inner_thickness = (thickness - AA_SIZE) * 0.5f;
-            if (!closed)
-            {
-                temp_points[0] = points[0] + temp_normals[0] * (half_inner_thickness + AA_SIZE);
-                temp_points[1] = points[0] + temp_normals[0] * (half_inner_thickness);
-                temp_points[2] = points[0] - temp_normals[0] * (half_inner_thickness);
-                temp_points[3] = points[0] - temp_normals[0] * (half_inner_thickness + AA_SIZE);
-                temp_points[(points_count-1)*4+0] = points[points_count-1] + temp_normals[points_count-1] * (half_inner_thickness + AA_SIZE);
-                temp_points[(points_count-1)*4+1] = points[points_count-1] + temp_normals[points_count-1] * (half_inner_thickness);
-                temp_points[(points_count-1)*4+2] = points[points_count-1] - temp_normals[points_count-1] * (half_inner_thickness);
-                temp_points[(points_count-1)*4+3] = points[points_count-1] - temp_normals[points_count-1] * (half_inner_thickness + AA_SIZE);
-            }
-
-            // FIXME-OPT: Merge the different loops, possibly remove the temporary buffer.
+#ifdef IMGUI_ENABLE_SSE2_INDICES
+            // Every segment but the closing one has the same indexes relative to idx1, with idx2 = idx1+4
+            __m128i idx_0_7 = _mm_add_epi16(_mm_setr_epi16(5,1,2,2,6,5,5,1), _mm_set1_epi16((short)_VtxCurrentIdx));
+            __m128i idx_8_15 = _mm_add_epi16(_mm_setr_epi16(0,0,4,5,6,2,3,3), _mm_set1_epi16((short)_VtxCurrentIdx));
+            const __m128i idx_step = _mm_set1_epi16(4);
+#endif
             unsigned int idx1 = _VtxCurrentIdx;
-            for (int i1 = 0; i1 < count; i1++)
+            for (int i1 = 0; i1 < points_count; i1++)
             {
-                const int i2 = (i1+1) == points_count ? 0 : i1+1;
-                unsigned int idx2 = (i1+1) == points_count ? _VtxCurrentIdx : idx1+4;
+                // Average normals. The first point of an open line only has one.
+                ImVec2 dm = (i1 == 0 && !closed) ? temp_normals[0] : ImDrawListAverageNormals(temp_normals[i1 == 0 ? points_count-1 : i1-1], temp_normals[i1]);
+                ImVec2 dm_out = dm * (half_inner_thickness + AA_SIZE);
+                ImVec2 dm_in = dm * half_inner_thickness;
+
+                // Add vertexes
+                _VtxWritePtr[0].pos = points[i1] + dm_out; _VtxWritePtr[0].uv = uv; _VtxWritePtr[0].col = col_trans;
+                _VtxWritePtr[1].pos = points[i1] + dm_in;  _VtxWritePtr[1].uv = uv; _VtxWritePtr[1].col = col;
+                _VtxWritePtr[2].pos = points[i1] - dm_in;  _VtxWritePtr[2].uv = uv; _VtxWritePtr[2].col = col;
+                _VtxWritePtr[3].pos = points[i1] - dm_out; _VtxWritePtr[3].uv = uv; _VtxWritePtr[3].col = col_trans;
+                _VtxWritePtr += 4;
 
-                // Average normals
-                ImVec2 dm = (temp_normals[i1] + temp_normals[i2]) * 0.5f;
-                float dmr2 = dm.x*dm.x + dm.y*dm.y;
-                if (dmr2 > 0.000001f)
+                // Add indexes for the segment to the next point
+                if (i1 == count)
+                    break;
+                unsigned int idx2 = (i1+1) == points_count ? _VtxCurrentIdx : idx1+4;
+#ifdef IMGUI_ENABLE_SSE2_INDICES
+                if (i1+1 < points_count)
                 {
-                    float scale = 1.0f / dmr2;
-                    if (scale > 100.0f) scale = 100.0f;
-                    dm *= scale;
+                    _mm_storeu_si128((__m128i*)_IdxWritePtr, idx_0_7);
+                    _mm_storeu_si128((__m128i*)(_IdxWritePtr+8), idx_8_15);
+                    _IdxWritePtr[16] = (ImDrawIdx)(idx2+3); _IdxWritePtr[17] = (ImDrawIdx)(idx2+2);
+                    idx_0_7 = _mm_add_epi16(idx_0_7, idx_step);
+                    idx_8_15 = _mm_add_epi16(idx_8_15, idx_step);
+                }
+                else
+#endif
+                {
+                    _IdxWritePtr[0]  = (ImDrawIdx)(idx2+1); _IdxWritePtr[1]  = (ImDrawIdx)(idx1+1); _IdxWritePtr[2]  = (ImDrawIdx)(idx1+2);
+                    _IdxWritePtr[3]  = (ImDrawIdx)(idx1+2); _IdxWritePtr[4]  = (ImDrawIdx)(idx2+2); _IdxWritePtr[5]  = (ImDrawIdx)(idx2+1);
+                    _IdxWritePtr[6]  = (ImDrawIdx)(idx2+1); _IdxWritePtr[7]  = (ImDrawIdx)(idx1+1); _IdxWritePtr[8]  = (ImDrawIdx)(idx1+0);
+                    _IdxWritePtr[9]  = (ImDrawIdx)(idx1+0); _IdxWritePtr[10] = (ImDrawIdx)(idx2+0); _IdxWritePtr[11] = (ImDrawIdx)(idx2+1);
+                    _IdxWritePtr[12] = (ImDrawIdx)(idx2+2); _IdxWritePtr[13] = (ImDrawIdx)(idx1+2); _IdxWritePtr[14] = (ImDrawIdx)(idx1+3);
+                    _IdxWritePtr[15] = (ImDrawIdx)(idx1+3); _IdxWritePtr[16] = (ImDrawIdx)(idx2+3); _IdxWritePtr[17] = (ImDrawIdx)(idx2+2);
                 }
-                ImVec2 dm_out = dm * (half_inner_thickness + AA_SIZE);
-                ImVec2 dm_in = dm * half_inner_thickness;
-                temp_points[i2*4+0] = points[i2] + dm_out;
-                temp_points[i2*4+1] = points[i2] + dm_in;
-                temp_points[i2*4+2] = points[i2] - dm_in;
-                temp_points[i2*4+3] = points[i2] - dm_out;
-
-                // Add indexes
-                _IdxWritePtr[0]  = (ImDrawIdx)(idx2+1); _IdxWritePtr[1]  = (ImDrawIdx)(idx1+1); _IdxWritePtr[2]  = (ImDrawIdx)(idx1+2);
-                _IdxWritePtr[3]  = (ImDrawIdx)(idx1+2); _IdxWritePtr[4]  = (ImDrawIdx)(idx2+2); _IdxWritePtr[5]  = (ImDrawIdx)(idx2+1);
-                _IdxWritePtr[6]  = (ImDrawIdx)(idx2+1); _IdxWritePtr[7]  = (ImDrawIdx)(idx1+1); _IdxWritePtr[8]  = (ImDrawIdx)(idx1+0);
-                _IdxWritePtr[9]  = (ImDrawIdx)(idx1+0); _IdxWritePtr[10] = (ImDrawIdx)(idx2+0); _IdxWritePtr[11] = (ImDrawIdx)(idx2+1);
-                _IdxWritePtr[12] = (ImDrawIdx)(idx2+2); _IdxWritePtr[13] = (ImDrawIdx)(idx1+2); _IdxWritePtr[14] = (ImDrawIdx)(idx1+3);
-                _IdxWritePtr[15] = (ImDrawIdx)(idx1+3); _IdxWritePtr[16] = (ImDrawIdx)(idx2+3); _IdxWritePtr[17] = (ImDrawIdx)(idx2+2);
                 _IdxWritePtr += 18;
-
                 idx1 = idx2;
             }
-
-            // Add vertexes
-            for (int i = 0; i < points_count; i++)
-            {
-                _VtxWritePtr[0].pos = temp_points[i*4+0]; _VtxWritePtr[0].uv = uv; _VtxWritePtr[0].col = col_trans;
-                _VtxWritePtr[1].pos = temp_points[i*4+1]; _VtxWritePtr[1].uv = uv; _VtxWritePtr[1].col = col;
-                _VtxWritePtr[2].pos = temp_points[i*4+2]; _VtxWritePtr[2].uv = uv; _VtxWritePtr[2].col = col;
-                _VtxWritePtr[3].pos = temp_points[i*4+3]; _VtxWritePtr[3].uv = uv; _VtxWritePtr[3].col = col_trans;
-                _VtxWritePtr += 4;
-            }
         }
         _VtxCurrentIdx += (ImDrawIdx)vtx_count;
     }
@@ -597,30 +632,17 @@ void ImDrawList::AddConvexPolyFilled(const ImVec2* points, const int points_coun
 
         // Compute normals
         ImVec2* temp_normals = (ImVec2*)alloca(points_count * sizeof(ImVec2));
-        for (int i0 = points_count-1, i1 = 0; i1 < points_count; i0 = i1++)
-        {
-            const ImVec2& p0 = points[i0];
-            const ImVec2& p1 = points[i1];
-            ImVec2 diff = p1 - p0;
-            diff *= ImInvLength(diff, 1.0f);
-            temp_normals[i0].x = diff.y;
-            temp_normals[i0].y = -diff.x;
-        }
+        ImDrawListComputeEdgeNormals(points, points_count, temp_normals);
 
+#ifdef IMGUI_ENABLE_SSE2_INDICES
+        // From the second point on, the indexes for fringes are the same relative to the previous point's inner vertex
+        __m128i fringe_idx = _mm_add_epi16(_mm_setr_epi16(2,0,1,1,3,2,4,2), _mm_set1_epi16((short)(vtx_inner_idx-2)));
+        const __m128i fringe_idx_step = _mm_set1_epi16(2);
+#endif
         for (int i0 = points_count-1, i1 = 0; i1 < points_count; i0 = i1++)
         {
             // Average normals
-            const ImVec2& n0 = temp_normals[i0];
-            const ImVec2& n1 = temp_normals[i1];
-            ImVec2 dm = (n0 + n1) * 0.5f;
-            float dmr2 = dm.x*dm.x + dm.y*dm.y;
-            if (dmr2 > 0.000001f)
-            {
-                float scale = 1.0f / dmr2;
-                if (scale > 100.0f) scale = 100.0f;
-                dm *= scale;
-            }
-            dm *= AA_SIZE * 0.5f;
+            ImVec2 dm = ImDrawListAverageNormals(temp_normals[i0], temp_normals[i1]) * (AA_SIZE * 0.5f);
 
             // Add vertices
             _VtxWritePtr[0].pos = (points[i1] - dm); _VtxWritePtr[0].uv = uv; _VtxWritePtr[0].col = col;        // Inner
@@ -628,9 +650,23 @@ void ImDrawList::AddConvexPolyFilled(const ImVec2* points, const int points_coun
             _VtxWritePtr += 2;
 
             // Add indexes for fringes
-            _IdxWritePtr[0] = (ImDrawIdx)(vtx_inner_idx+(i1<<1)); _IdxWritePtr[1] = (ImDrawIdx)(vtx_inner_idx+(i0<<1)); _IdxWritePtr[2] = (ImDrawIdx)(vtx_outer_idx+(i0<<1));
-            _IdxWritePtr[3] = (ImDrawIdx)(vtx_outer_idx+(i0<<1)); _IdxWritePtr[4] = (ImDrawIdx)(vtx_outer_idx+(i1<<1)); _IdxWritePtr[5] = (ImDrawIdx)(vtx_inner_idx+(i1<<1));
-            _IdxWritePtr += 6;
+#ifdef IMGUI_ENABLE_SSE2_INDICES
+            if (i1 > 0 && i1+1 < points_count)
+            {
+                // Also writes the first two indexes of the next point, which overwrites them
+                _mm_storeu_si128((__m128i*)_IdxWritePtr, fringe_idx);
+                _IdxWritePtr += 6;
+            }
+            else
+#endif
+            {
+                _IdxWritePtr[0] = (ImDrawIdx)(vtx_inner_idx+(i1<<1)); _IdxWritePtr[1] = (ImDrawIdx)(vtx_inner_idx+(i0<<1)); _IdxWritePtr[2] = (ImDrawIdx)(vtx_outer_idx+(i0<<1));
+                _IdxWritePtr[3] = (ImDrawIdx)(vtx_outer_idx+(i0<<1)); _IdxWritePtr[4] = (ImDrawIdx)(vtx_outer_idx+(i1<<1)); _IdxWritePtr[5] = (ImDrawIdx)(vtx_inner_idx+(i1<<1));
+                _IdxWritePtr += 6;
+            }
+#ifdef IMGUI_ENABLE_SSE2_INDICES
+            fringe_idx = _mm_add_epi16(fringe_idx, fringe_idx_step);
+#endif
         }
         _VtxCurrentIdx += (ImDrawIdx)vtx_count;
     }
@@ -1005,6 +1041,8 @@ ImFontConfig::ImFontConfig()
     memset(Name, 0, sizeof(Name));
 }
 
+static void ImFontAtlasDestroyOnDemandData(ImFontAtlas* atlas);
+
 ImFontAtlas::ImFontAtlas()
 {
     TexID = NULL;
@@ -1012,6 +1050,11 @@ ImFontAtlas::ImFontAtlas()
     TexPixelsRGBA32 = NULL;
     TexWidth = TexHeight = TexDesiredWidth = 0;
     TexUvWhitePixel = ImVec2(0, 0);
+    RasterizeOnDemand = false;
+    TexGeneration = 0;
+    TexDirty = false;
+    TexDirtyX0 = TexDirtyY0 = TexDirtyX1 = TexDirtyY1 = 0;
+    OnDemandData = NULL;
 }
 
 ImFontAtlas::~ImFontAtlas()
@@ -1021,6 +1064,7 @@ ImFontAtlas::~ImFontAtlas()
 
 void    ImFontAtlas::ClearInputData()
 {
+    ImFontAtlasDestroyOnDemandData(this);
     for (int i = 0; i < ConfigData.Size; i++)
         if (ConfigData[i].FontData && ConfigData[i].FontDataOwnedByAtlas)
         {
@@ -1040,6 +1084,7 @@ void    ImFontAtlas::ClearInputData()
 
 void    ImFontAtlas::ClearTexData()
 {
+    ImFontAtlasDestroyOnDemandData(this);
     if (TexPixelsAlpha8)
         ImGui::MemFree(TexPixelsAlpha8);
     if (TexPixelsRGBA32)
@@ -1220,6 +1265,8 @@ ImFont* ImFontAtlas::AddFontFromMemoryCompressedBase85TTF(const char* compressed
 bool    ImFontAtlas::Build()
 {
     IM_ASSERT(ConfigData.Size > 0);
+    if (RasterizeOnDemand)
+        return BuildOnDemand();
 
     TexID = NULL;
     TexWidth = TexHeight = 0;
@@ -1421,6 +1468,358 @@ bool    ImFontAtlas::Build()
     return true;
 }
 
+//-----------------------------------------------------------------------------
+// ImFontAtlas on-demand rasterization
+//-----------------------------------------------------------------------------
+
+struct ImFontAtlasOnDemandData
+{
+    stbtt_pack_context          PackContext;    // Packs into TexPixelsAlpha8, one glyph at a time
+    ImVector<stbtt_fontinfo>    FontInfos;      // Parallel to ConfigData
+    stbrp_rect                  CustomRect;     // Custom texture data, packed first so it never moves
+    int                         FrameCount;
+    bool                        EvictionWanted;
+};
+
+static void ImFontAtlasDestroyOnDemandData(ImFontAtlas* atlas)
+{
+    ImFontAtlasOnDemandData* data = (ImFontAtlasOnDemandData*)atlas->OnDemandData;
+    if (!data)
+        return;
+    stbtt_PackEnd(&data->PackContext);
+    data->~ImFontAtlasOnDemandData();
+    ImGui::MemFree(data);
+    atlas->OnDemandData = NULL;
+}
+
+// Keeps the RGBA32 copy of the pixels up to date and extends the dirty rectangle
+static void ImFontAtlasMarkDirty(ImFontAtlas* atlas, int x0, int y0, int x1, int y1)
+{
+    if (atlas->TexPixelsRGBA32)
+        for (int y = y0; y < y1; y++)
+            for (int x = x0; x < x1; x++)
+                atlas->TexPixelsRGBA32[y * atlas->TexWidth + x] = ((unsigned int)atlas->TexPixelsAlpha8[y * atlas->TexWidth + x] << 24) | 0x00FFFFFF;
+
+    if (!atlas->TexDirty)
+    {
+        atlas->TexDirty = true;
+        atlas->TexDirtyX0 = x0; atlas->TexDirtyY0 = y0; atlas->TexDirtyX1 = x1; atlas->TexDirtyY1 = y1;
+        return;
+    }
+    atlas->TexDirtyX0 = ImMin(atlas->TexDirtyX0, x0); atlas->TexDirtyY0 = ImMin(atlas->TexDirtyY0, y0);
+    atlas->TexDirtyX1 = ImMax(atlas->TexDirtyX1, x1); atlas->TexDirtyY1 = ImMax(atlas->TexDirtyY1, y1);
+}
+
+bool    ImFontAtlas::BuildOnDemand()
+{
+    IM_ASSERT(ConfigData.Size > 0);
+
+    TexID = NULL;
+    TexWidth = TexHeight = (TexDesiredWidth > 0) ? ImMax(TexDesiredWidth, 256) : 512;
+    TexUvWhitePixel = ImVec2(0, 0);
+    ClearTexData();
+
+    ImFontAtlasOnDemandData* data = (ImFontAtlasOnDemandData*)ImGui::MemAlloc(sizeof(ImFontAtlasOnDemandData));
+    IM_PLACEMENT_NEW(data) ImFontAtlasOnDemandData();
+    data->FontInfos.resize(ConfigData.Size);
+    data->FrameCount = 0;
+    data->EvictionWanted = false;
+    for (int input_i = 0; input_i < ConfigData.Size; input_i++)
+    {
+        ImFontConfig& cfg = ConfigData[input_i];
+        IM_ASSERT(cfg.DstFont && (!cfg.DstFont->IsLoaded() || cfg.DstFont->ContainerAtlas == this));
+        const int font_offset = stbtt_GetFontOffsetForIndex((unsigned char*)cfg.FontData, cfg.FontNo);
+        IM_ASSERT(font_offset >= 0);
+        if (!stbtt_InitFont(&data->FontInfos[input_i], (unsigned char*)cfg.FontData, font_offset))
+        {
+            data->~ImFontAtlasOnDemandData();
+            ImGui::MemFree(data);
+            return false;
+        }
+        if (!cfg.GlyphRanges)
+            cfg.GlyphRanges = GetGlyphRangesDefault();
+    }
+
+    // The whole page is allocated up front, and the custom data goes in its upper-left corner like in Build()
+    TexPixelsAlpha8 = (unsigned char*)ImGui::MemAlloc(TexWidth * TexHeight);
+    stbtt_PackBegin(&data->PackContext, TexPixelsAlpha8, TexWidth, TexHeight, 0, 1, NULL);
+    ImVector<stbrp_rect> extra_rects;
+    RenderCustomTexData(0, &extra_rects);
+    stbrp_pack_rects((stbrp_context*)data->PackContext.pack_info, &extra_rects[0], extra_rects.Size);
+    data->CustomRect = extra_rects[0];
+    RenderCustomTexData(1, &extra_rects);
+    OnDemandData = data;
+
+    // Setup the fonts without any glyphs
+    for (int input_i = 0; input_i < ConfigData.Size; input_i++)
+    {
+        ImFontConfig& cfg = ConfigData[input_i];
+        ImFont* dst_font = cfg.DstFont;
+        if (!cfg.MergeMode)
+        {
+            float font_scale = stbtt_ScaleForPixelHeight(&data->FontInfos[input_i], cfg.SizePixels);
+            int unscaled_ascent, unscaled_descent, unscaled_line_gap;
+            stbtt_GetFontVMetrics(&data->FontInfos[input_i], &unscaled_ascent, &unscaled_descent, &unscaled_line_gap);
+
+            dst_font->ContainerAtlas = this;
+            dst_font->ConfigData = &cfg;
+            dst_font->ConfigDataCount = 0;
+            dst_font->FontSize = cfg.SizePixels;
+            dst_font->Ascent = unscaled_ascent * font_scale;
+            dst_font->Descent = unscaled_descent * font_scale;
+            dst_font->Glyphs.resize(0);
+            dst_font->GlyphsLastUsedFrame.resize(0);
+            dst_font->IndexLookup.resize(0);
+            dst_font->IndexXAdvance.resize(0);
+            dst_font->FallbackGlyph = NULL;
+        }
+        dst_font->ConfigDataCount++;
+    }
+
+    // Every font needs its space (for tabs) and fallback glyphs from the start
+    for (int i = 0; i < Fonts.Size; i++)
+        if (Fonts[i]->ContainerAtlas == this)
+        {
+            FindGlyphOnDemand(Fonts[i], (unsigned short)' ');
+            FindGlyphOnDemand(Fonts[i], (unsigned short)Fonts[i]->FallbackChar);
+            Fonts[i]->BuildLookupTable();
+        }
+
+    ImFontAtlasMarkDirty(this, 0, 0, TexWidth, TexHeight);
+    TexGeneration++;
+    return true;
+}
+
+int     ImFontAtlas::FindGlyphOnDemand(ImFont* font, unsigned short c)
+{
+    ImFontAtlasOnDemandData* data = (ImFontAtlasOnDemandData*)OnDemandData;
+    const int lookup = (c < font->IndexLookup.Size) ? font->IndexLookup[c] : -1;
+    if (lookup >= 0)
+    {
+        font->GlyphsLastUsedFrame[lookup] = data->FrameCount;
+        return lookup;
+    }
+    if (lookup == -2)
+        return -1;
+
+    // The first input of the font that has the glyph wins, as in Build(). Glyphs missing from the font aren't rasterized as boxes.
+    int input_i = 0;
+    for (; input_i < ConfigData.Size; input_i++)
+    {
+        const ImFontConfig& cfg = ConfigData[input_i];
+        if (cfg.DstFont != font)
+            continue;
+        bool in_ranges = false;
+        for (const ImWchar* in_range = cfg.GlyphRanges; in_range[0] && in_range[1] && !in_ranges; in_range += 2)
+            in_ranges = c >= in_range[0] && c <= in_range[1];
+        if (in_ranges && stbtt_FindGlyphIndex(&data->FontInfos[input_i], c) != 0)
+            break;
+    }
+
+    if (c >= font->IndexLookup.Size)
+    {
+        const int old_size = font->IndexLookup.Size;
+        font->IndexLookup.resize(c + 1);
+        font->IndexXAdvance.resize(c + 1);
+        for (int i = old_size; i < c + 1; i++)
+        {
+            font->IndexLookup[i] = -1;
+            font->IndexXAdvance[i] = -1.0f;
+        }
+    }
+
+    if (input_i == ConfigData.Size)
+    {
+        // Remember that it's missing, so the fonts aren't searched again
+        font->IndexLookup[c] = -2;
+        font->IndexXAdvance[c] = font->FallbackXAdvance;
+        return -1;
+    }
+
+    const ImFontConfig& cfg = ConfigData[input_i];
+    stbtt_fontinfo* font_info = &data->FontInfos[input_i];
+    stbtt_pack_context& spc = data->PackContext;
+
+    stbtt_packedchar pc;
+    stbtt_pack_range range;
+    stbrp_rect rect;
+    memset(&pc, 0, sizeof(pc));
+    memset(&range, 0, sizeof(range));
+    memset(&rect, 0, sizeof(rect));
+    range.font_size = cfg.SizePixels;
+    range.first_unicode_codepoint_in_range = c;
+    range.num_chars = 1;
+    range.chardata_for_range = &pc;
+    stbtt_PackSetOversampling(&spc, cfg.OversampleH, cfg.OversampleV);
+    stbtt_PackFontRangesGatherRects(&spc, font_info, &range, 1, &rect);
+    stbrp_pack_rects((stbrp_context*)spc.pack_info, &rect, 1);
+    if (!rect.was_packed)
+    {
+        // The page is full. Use the fallback glyph until NewFrame() makes room.
+        data->EvictionWanted = true;
+        return -1;
+    }
+    stbtt_PackFontRangesRenderIntoRects(&spc, font_info, &range, 1, &rect);
+    ImFontAtlasMarkDirty(this, pc.x0, pc.y0, pc.x1, pc.y1);
+
+    // Same metrics as the third pass of Build()
+    float font_scale = stbtt_ScaleForPixelHeight(font_info, cfg.SizePixels);
+    int unscaled_ascent, unscaled_descent, unscaled_line_gap;
+    stbtt_GetFontVMetrics(font_info, &unscaled_ascent, &unscaled_descent, &unscaled_line_gap);
+    float off_y = (cfg.MergeMode && cfg.MergeGlyphCenterV) ? (unscaled_ascent * font_scale - font->Ascent) * 0.5f : 0.0f;
+
+    stbtt_aligned_quad q;
+    float dummy_x = 0.0f, dummy_y = 0.0f;
+    stbtt_GetPackedQuad(&pc, TexWidth, TexHeight, 0, &dummy_x, &dummy_y, &q, 0);
+
+    font->Glyphs.resize(font->Glyphs.Size + 1);
+    ImFont::Glyph& glyph = font->Glyphs.back();
+    glyph.Codepoint = (ImWchar)c;
+    glyph.X0 = q.x0; glyph.Y0 = q.y0; glyph.X1 = q.x1; glyph.Y1 = q.y1;
+    glyph.U0 = q.s0; glyph.V0 = q.t0; glyph.U1 = q.s1; glyph.V1 = q.t1;
+    glyph.Y0 += (float)(int)(font->Ascent + off_y + 0.5f);
+    glyph.Y1 += (float)(int)(font->Ascent + off_y + 0.5f);
+    glyph.XAdvance = (pc.xadvance + cfg.GlyphExtraSpacing.x);  // Bake spacing into XAdvance
+    if (cfg.PixelSnapH)
+        glyph.XAdvance = (float)(int)(glyph.XAdvance + 0.5f);
+    font->GlyphsLastUsedFrame.push_back(data->FrameCount);
+
+    const int glyph_i = font->Glyphs.Size - 1;
+    font->IndexLookup[c] = glyph_i;
+    font->IndexXAdvance[c] = glyph.XAdvance;
+
+    // Growing Glyphs may have moved the fallback glyph
+    if (font->FallbackGlyph)
+        font->FallbackGlyph = &font->Glyphs[font->IndexLookup[font->FallbackChar]];
+
+    return glyph_i;
+}
+
+struct ImFontAtlasEvictionEntry
+{
+    ImFont*     Font;
+    int         GlyphIndex;
+    int         LastUsedFrame;
+    int         X0, Y0, X1, Y1;  // Pixels of the glyph in the old page
+    bool        Kept;
+};
+
+static int ImFontAtlasEvictionEntryComparer(const void* lhs, const void* rhs)
+{
+    // Most recently used first
+    const int a = ((const ImFontAtlasEvictionEntry*)lhs)->LastUsedFrame;
+    const int b = ((const ImFontAtlasEvictionEntry*)rhs)->LastUsedFrame;
+    return (a > b) ? -1 : (a < b) ? 1 : 0;
+}
+
+// Packs the most recently used glyphs again into a new page, until they fill half of it, and drops the others.
+// The space and fallback glyphs are always kept. Tabs are rebuilt from spaces by BuildLookupTable().
+void    ImFontAtlas::EvictGlyphsOnDemand()
+{
+    ImFontAtlasOnDemandData* data = (ImFontAtlasOnDemandData*)OnDemandData;
+    data->EvictionWanted = false;
+
+    ImVector<ImFontAtlasEvictionEntry> entries;
+    for (int font_i = 0; font_i < Fonts.Size; font_i++)
+    {
+        ImFont* font = Fonts[font_i];
+        if (font->ContainerAtlas != this)
+            continue;
+        for (int glyph_i = 0; glyph_i < font->Glyphs.Size; glyph_i++)
+        {
+            const ImFont::Glyph& glyph = font->Glyphs[glyph_i];
+            if (glyph.Codepoint == '\t')
+                continue;
+            ImFontAtlasEvictionEntry entry;
+            entry.Font = font;
+            entry.GlyphIndex = glyph_i;
+            entry.LastUsedFrame = (glyph.Codepoint == ' ' || glyph.Codepoint == font->FallbackChar) ? INT_MAX : font->GlyphsLastUsedFrame[glyph_i];
+            entry.X0 = (int)(glyph.U0 * TexWidth + 0.5f); entry.Y0 = (int)(glyph.V0 * TexHeight + 0.5f);
+            entry.X1 = (int)(glyph.U1 * TexWidth + 0.5f); entry.Y1 = (int)(glyph.V1 * TexHeight + 0.5f);
+            entry.Kept = false;
+            entries.push_back(entry);
+        }
+    }
+    if (entries.Size > 0)
+        qsort(&entries[0], (size_t)entries.Size, sizeof(ImFontAtlasEvictionEntry), ImFontAtlasEvictionEntryComparer);
+
+    // Start a new page with the custom data in the same place
+    unsigned char* old_pixels = TexPixelsAlpha8;
+    TexPixelsAlpha8 = (unsigned char*)ImGui::MemAlloc(TexWidth * TexHeight);
+    stbtt_pack_context& spc = data->PackContext;
+    stbtt_PackEnd(&spc);
+    stbtt_PackBegin(&spc, TexPixelsAlpha8, TexWidth, TexHeight, 0, 1, NULL);
+    ImVector<stbrp_rect> extra_rects;
+    extra_rects.push_back(data->CustomRect);
+    stbrp_pack_rects((stbrp_context*)spc.pack_info, &extra_rects[0], extra_rects.Size);
+    IM_ASSERT(extra_rects[0].x == data->CustomRect.x && extra_rects[0].y == data->CustomRect.y);
+    RenderCustomTexData(1, &extra_rects);
+
+    const int pad = spc.padding;
+    int budget = TexWidth * TexHeight / 2 - (extra_rects[0].w * extra_rects[0].h);
+    for (int entry_i = 0; entry_i < entries.Size; entry_i++)
+    {
+        ImFontAtlasEvictionEntry& entry = entries[entry_i];
+        stbrp_rect rect;
+        memset(&rect, 0, sizeof(rect));
+        rect.w = (stbrp_coord)(entry.X1 - entry.X0 + pad);
+        rect.h = (stbrp_coord)(entry.Y1 - entry.Y0 + pad);
+        if (entry.LastUsedFrame != INT_MAX && rect.w * rect.h > budget)
+            break;
+        stbrp_pack_rects((stbrp_context*)spc.pack_info, &rect, 1);
+        if (!rect.was_packed)
+            continue;
+        budget -= rect.w * rect.h;
+        entry.Kept = true;
+
+        const int x0 = rect.x + pad, y0 = rect.y + pad;
+        for (int y = 0; y < entry.Y1 - entry.Y0; y++)
+            memcpy(&TexPixelsAlpha8[(y0 + y) * TexWidth + x0], &old_pixels[(entry.Y0 + y) * TexWidth + entry.X0], (size_t)(entry.X1 - entry.X0));
+
+        ImFont::Glyph& glyph = entry.Font->Glyphs[entry.GlyphIndex];
+        const float ipw = 1.0f / TexWidth, iph = 1.0f / TexHeight;
+        glyph.U0 = x0 * ipw; glyph.V0 = y0 * iph;
+        glyph.U1 = (x0 + entry.X1 - entry.X0) * ipw; glyph.V1 = (y0 + entry.Y1 - entry.Y0) * iph;
+    }
+    ImGui::MemFree(old_pixels);
+
+    // Drop the evicted glyphs, keeping the others in order
+    for (int entry_i = 0; entry_i < entries.Size; entry_i++)
+        if (!entries[entry_i].Kept)
+            entries[entry_i].Font->GlyphsLastUsedFrame[entries[entry_i].GlyphIndex] = -1;
+    for (int font_i = 0; font_i < Fonts.Size; font_i++)
+    {
+        ImFont* font = Fonts[font_i];
+        if (font->ContainerAtlas != this)
+            continue;
+        int kept_count = 0;
+        for (int glyph_i = 0; glyph_i < font->Glyphs.Size; glyph_i++)
+            if (font->GlyphsLastUsedFrame[glyph_i] != -1 && font->Glyphs[glyph_i].Codepoint != '\t')
+            {
+                font->Glyphs[kept_count] = font->Glyphs[glyph_i];
+                font->GlyphsLastUsedFrame[kept_count] = font->GlyphsLastUsedFrame[glyph_i];
+                kept_count++;
+            }
+        font->Glyphs.resize(kept_count);
+        font->GlyphsLastUsedFrame.resize(kept_count);
+        font->BuildLookupTable();
+    }
+
+    ImFontAtlasMarkDirty(this, 0, 0, TexWidth, TexHeight);
+    TexGeneration++;
+}
+
+void    ImFontAtlas::NewFrame()
+{
+    ImFontAtlasOnDemandData* data = (ImFontAtlasOnDemandData*)OnDemandData;
+    if (!data)
+        return;
+
+    data->FrameCount++;
+    if (data->EvictionWanted)
+        EvictGlyphsOnDemand();
+}
+
 void ImFontAtlas::RenderCustomTexData(int pass, void* p_rects)
 {
     // A work of art lies ahead! (. = white layer, X = black layer, others are blank)
@@ -1658,6 +2057,7 @@ void    ImFont::Clear()
     Ascent = Descent = 0.0f;
     ContainerAtlas = NULL;
     Glyphs.clear();
+    GlyphsLastUsedFrame.clear();
     FallbackGlyph = NULL;
     FallbackXAdvance = 0.0f;
     IndexXAdvance.clear();
@@ -1703,6 +2103,14 @@ void ImFont::BuildLookupTable()
     FallbackGlyph = NULL;
     FallbackGlyph = FindGlyph(FallbackChar);
     FallbackXAdvance = FallbackGlyph ? FallbackGlyph->XAdvance : 0.0f;
+
+    // On-demand fonts leave missing characters at -1, so GetCharAdvance() rasterizes them
+    if (ContainerAtlas && ContainerAtlas->OnDemandData && ConfigDataCount > 0)
+    {
+        for (int i = GlyphsLastUsedFrame.Size; i < Glyphs.Size; i++)
+            GlyphsLastUsedFrame.push_back(((ImFontAtlasOnDemandData*)ContainerAtlas->OnDemandData)->FrameCount);
+        return;
+    }
     for (int i = 0; i < max_codepoint + 1; i++)
         if (IndexXAdvance[i] < 0.0f)
             IndexXAdvance[i] = FallbackXAdvance;
@@ -1716,6 +2124,13 @@ void ImFont::SetFallbackChar(ImWchar c)
 
 const ImFont::Glyph* ImFont::FindGlyph(unsigned short c) const
 {
+    // Only fonts built from the atlas' inputs rasterize on demand. Others, like InputText()'s password font, keep their baked glyphs.
+    if (ContainerAtlas && ContainerAtlas->OnDemandData && ConfigDataCount > 0)
+    {
+        // May rasterize the glyph, which changes the font's glyphs but not how it draws
+        const int i = ContainerAtlas->FindGlyphOnDemand((ImFont*)this, c);
+        return (i != -1) ? &Glyphs[i] : FallbackGlyph;
+    }
     if (c < IndexLookup.Size)
     {
         const int i = IndexLookup[c];
@@ -1725,6 +2140,12 @@ const ImFont::Glyph* ImFont::FindGlyph(unsigned short c) const
     return FallbackGlyph;
 }
 
+float ImFont::FindCharAdvance(unsigned short c) const
+{
+    const Glyph* glyph = FindGlyph(c);
+    return glyph ? glyph->XAdvance : FallbackXAdvance;
+}
+
 const char* ImFont::CalcWordWrapPositionA(float scale, const char* text, const char* text_end, float wrap_width) const
 {
     // Simple word-wrapping for English, not full-featured. Please submit failing cases!
@@ -1778,7 +2199,7 @@ const char* ImFont::CalcWordWrapPositionA(float scale, const char* text, const c
             }
         }
 
-        const float char_width = ((int)c < IndexXAdvance.Size) ? IndexXAdvance[(int)c] * scale : FallbackXAdvance;
+        const float char_width = GetCharAdvance((unsigned short)c) * scale;
         if (ImCharIsSpace(c))
         {
             if (inside_word)
@@ -1894,7 +2315,7 @@ ImVec2 ImFont::CalcTextSizeA(float size, float max_width, float wrap_width, cons
                 continue;
         }
 
-        const float char_width = ((int)c < IndexXAdvance.Size ? IndexXAdvance[(int)c] : FallbackXAdvance) * scale;
+        const float char_width = GetCharAdvance((unsigned short)c) * scale;
         if (line_width + char_width >= max_width)
         {
             s = prev_s;
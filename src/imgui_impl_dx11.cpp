@@ -8,6 +8,7 @@
 
 #include <imgui.h>
 #include "imgui_impl_dx11.h"
+#include "uploadring.h"
 
 // DirectX
 #include <d3d11.h>
@@ -15,6 +16,8 @@
 #define DIRECTINPUT_VERSION 0x0800
 #include <dinput.h>
 
+#define IM_ARRAYSIZE(_ARR)  ((int)(sizeof(_ARR)/sizeof(*_ARR)))
+
 // Data
 static INT64                    g_Time = 0;
 static INT64                    g_TicksPerSecond = 0;
@@ -35,54 +38,97 @@ static ID3D11ShaderResourceView*g_pFontTextureView = NULL;
 static ID3D11RasterizerState*   g_pRasterizerState = NULL;
 static ID3D11BlendState*        g_pBlendState = NULL;
 static int                      g_VertexBufferSize = 5000, g_IndexBufferSize = 10000;
+static UploadRing               g_VertexRing, g_IndexRing;
+static ID3D11Query*             g_pFrameQueries[8] = {};    // fences of the frames in flight, by frame index
+static UINT64                   g_NumFramesSubmitted = 0, g_NumFramesCompleted = 0;
 
 struct VERTEX_CONSTANT_BUFFER
 {
     float        mvp[4][4];
 };
 
+// Allocates count elements from a ring. If they don't fit in the space that is out of flight, the buffer is replaced by one that is
+// at least twice as big rather than waiting for the GPU. The frames in flight keep the old buffer alive until they're done with it.
+static bool ImGui_ImplDX11_AllocateRing(ID3D11Buffer** buffer, UploadRing* ring, int* buffer_size, UINT element_size, UINT bind_flags, int count, UINT64* offset, D3D11_MAP* map_type)
+{
+    if (*buffer && UploadRingAllocate(ring, count, offset))
+    {
+        *map_type = D3D11_MAP_WRITE_NO_OVERWRITE;
+        return true;
+    }
+
+    if (*buffer)
+    {
+        (*buffer)->Release();
+        *buffer = NULL;
+        *buffer_size = (int)UploadRingGetGrownSize(*buffer_size, count);
+    }
+    else if (*buffer_size < count)
+    {
+        *buffer_size = (int)UploadRingGetGrownSize(*buffer_size, count);
+    }
+
+    D3D11_BUFFER_DESC desc;
+    memset(&desc, 0, sizeof(D3D11_BUFFER_DESC));
+    desc.Usage = D3D11_USAGE_DYNAMIC;
+    desc.ByteWidth = *buffer_size * element_size;
+    desc.BindFlags = bind_flags;
+    desc.CPUAccessFlags = D3D11_CPU_ACCESS_WRITE;
+    desc.MiscFlags = 0;
+    if (g_pd3dDevice->CreateBuffer(&desc, NULL, buffer) < 0)
+        return false;
+
+    UploadRingReset(ring, *buffer_size);
+    UploadRingAllocate(ring, count, offset);
+    *map_type = D3D11_MAP_WRITE_DISCARD;
+    return true;
+}
+
 // This is the main rendering function that you have to implement and provide to ImGui (via setting up 'RenderDrawListsFn' in the ImGuiIO structure)
 // If text or lines are blurry when integrating ImGui in your engine:
 // - in your Render function, try translating your projection matrix by (0.5f,0.5f) or (0.375f,0.375f)
 void ImGui_ImplDX11_RenderDrawLists(ImDrawData* draw_data)
 {
-    // Create and grow vertex/index buffers if needed
-    if (!g_pVB || g_VertexBufferSize < draw_data->TotalVtxCount)
+    // Copy glyphs rasterized on demand since the last frame into the font texture
+    ImFontAtlas* atlas = ImGui::GetIO().Fonts;
+    if (atlas->TexDirty && g_pFontTextureView)
     {
-        if (g_pVB) { g_pVB->Release(); g_pVB = NULL; }
-        g_VertexBufferSize = draw_data->TotalVtxCount + 5000;
-        D3D11_BUFFER_DESC desc;
-        memset(&desc, 0, sizeof(D3D11_BUFFER_DESC));
-        desc.Usage = D3D11_USAGE_DYNAMIC;
-        desc.ByteWidth = g_VertexBufferSize * sizeof(ImDrawVert);
-        desc.BindFlags = D3D11_BIND_VERTEX_BUFFER;
-        desc.CPUAccessFlags = D3D11_CPU_ACCESS_WRITE;
-        desc.MiscFlags = 0;
-        if (g_pd3dDevice->CreateBuffer(&desc, NULL, &g_pVB) < 0)
-            return;
+        ID3D11Resource* pTexture = NULL;
+        g_pFontTextureView->GetResource(&pTexture);
+        D3D11_BOX box = { (UINT)atlas->TexDirtyX0, (UINT)atlas->TexDirtyY0, 0, (UINT)atlas->TexDirtyX1, (UINT)atlas->TexDirtyY1, 1 };
+        const unsigned int* src = atlas->TexPixelsRGBA32 + atlas->TexDirtyY0 * atlas->TexWidth + atlas->TexDirtyX0;
+        g_pd3dDeviceContext->UpdateSubresource(pTexture, 0, &box, src, atlas->TexWidth * 4, 0);
+        pTexture->Release();
+        atlas->ClearTexDirty();
     }
-    if (!g_pIB || g_IndexBufferSize < draw_data->TotalIdxCount)
+
+    // Free the parts of the rings used by frames the GPU has finished
+    while (g_NumFramesCompleted < g_NumFramesSubmitted)
     {
-        if (g_pIB) { g_pIB->Release(); g_pIB = NULL; }
-        g_IndexBufferSize = draw_data->TotalIdxCount + 10000;
-        D3D11_BUFFER_DESC bufferDesc;
-        memset(&bufferDesc, 0, sizeof(D3D11_BUFFER_DESC));
-        bufferDesc.Usage = D3D11_USAGE_DYNAMIC;
-        bufferDesc.ByteWidth = g_IndexBufferSize * sizeof(ImDrawIdx);
-        bufferDesc.BindFlags = D3D11_BIND_INDEX_BUFFER;
-        bufferDesc.CPUAccessFlags = D3D11_CPU_ACCESS_WRITE;
-        if (g_pd3dDevice->CreateBuffer(&bufferDesc, NULL, &g_pIB) < 0)
-            return;
+        ID3D11Query* query = g_pFrameQueries[g_NumFramesCompleted % IM_ARRAYSIZE(g_pFrameQueries)];
+        if (g_pd3dDeviceContext->GetData(query, NULL, 0, D3D11_ASYNC_GETDATA_DONOTFLUSH) != S_OK)
+            break;
+        g_NumFramesCompleted++;
     }
+    UploadRingRetireFrames(&g_VertexRing, g_NumFramesCompleted);
+    UploadRingRetireFrames(&g_IndexRing, g_NumFramesCompleted);
+
+    // Append this frame's vertices/indices to the rings, growing them if needed
+    UINT64 vtx_ring_offset, idx_ring_offset;
+    D3D11_MAP vtx_map_type, idx_map_type;
+    if (!ImGui_ImplDX11_AllocateRing(&g_pVB, &g_VertexRing, &g_VertexBufferSize, sizeof(ImDrawVert), D3D11_BIND_VERTEX_BUFFER, draw_data->TotalVtxCount, &vtx_ring_offset, &vtx_map_type))
+        return;
+    if (!ImGui_ImplDX11_AllocateRing(&g_pIB, &g_IndexRing, &g_IndexBufferSize, sizeof(ImDrawIdx), D3D11_BIND_INDEX_BUFFER, draw_data->TotalIdxCount, &idx_ring_offset, &idx_map_type))
+        return;
 
-    // Copy and convert all vertices into a single contiguous buffer
+    // Copy all vertices/indices into the space allocated for them, in a single pass over the draw lists
     D3D11_MAPPED_SUBRESOURCE vtx_resource, idx_resource;
-    if (g_pd3dDeviceContext->Map(g_pVB, 0, D3D11_MAP_WRITE_DISCARD, 0, &vtx_resource) != S_OK)
+    if (g_pd3dDeviceContext->Map(g_pVB, 0, vtx_map_type, 0, &vtx_resource) != S_OK)
         return;
-    if (g_pd3dDeviceContext->Map(g_pIB, 0, D3D11_MAP_WRITE_DISCARD, 0, &idx_resource) != S_OK)
+    if (g_pd3dDeviceContext->Map(g_pIB, 0, idx_map_type, 0, &idx_resource) != S_OK)
         return;
-    ImDrawVert* vtx_dst = (ImDrawVert*)vtx_resource.pData;
-    ImDrawIdx* idx_dst = (ImDrawIdx*)idx_resource.pData;
+    ImDrawVert* vtx_dst = (ImDrawVert*)vtx_resource.pData + vtx_ring_offset;
+    ImDrawIdx* idx_dst = (ImDrawIdx*)idx_resource.pData + idx_ring_offset;
     for (int n = 0; n < draw_data->CmdListsCount; n++)
     {
         const ImDrawList* cmd_list = draw_data->CmdLists[n];
@@ -187,8 +233,8 @@ void ImGui_ImplDX11_RenderDrawLists(ImDrawData* draw_data)
     g_pd3dDeviceContext->RSSetState(g_pRasterizerState);
 
     // Render command lists
-    int vtx_offset = 0;
-    int idx_offset = 0;
+    int vtx_offset = (int)vtx_ring_offset;
+    int idx_offset = (int)idx_ring_offset;
     for (int n = 0; n < draw_data->CmdListsCount; n++)
     {
         const ImDrawList* cmd_list = draw_data->CmdLists[n];
@@ -237,6 +283,18 @@ void ImGui_ImplDX11_RenderDrawLists(ImDrawData* draw_data)
     g_pd3dDeviceContext->IASetInputLayout(pOldInputLayout);
     if (pOldInputLayout) pOldInputLayout->Release();
     g_pd3dDeviceContext->RSSetViewports(oldNumViewports, oldViewports);
+
+    // Fence the frame. More frames in flight than there are queries only happens if the GPU is far behind, so waiting is fine.
+    if (g_NumFramesSubmitted - g_NumFramesCompleted == IM_ARRAYSIZE(g_pFrameQueries))
+    {
+        while (g_pd3dDeviceContext->GetData(g_pFrameQueries[g_NumFramesCompleted % IM_ARRAYSIZE(g_pFrameQueries)], NULL, 0, 0) != S_OK)
+            ;
+        g_NumFramesCompleted++;
+    }
+    g_pd3dDeviceContext->End(g_pFrameQueries[g_NumFramesSubmitted % IM_ARRAYSIZE(g_pFrameQueries)]);
+    UploadRingEndFrame(&g_VertexRing, g_NumFramesSubmitted);
+    UploadRingEndFrame(&g_IndexRing, g_NumFramesSubmitted);
+    g_NumFramesSubmitted++;
 }
 
 IMGUI_API LRESULT ImGui_ImplDX11_WndProcHandler(HWND, UINT msg, WPARAM wParam, LPARAM lParam)
@@ -328,6 +386,7 @@ static void ImGui_ImplDX11_CreateFontsTexture()
 
     // Store our identifier
     io.Fonts->TexID = (void *)g_pFontTextureView;
+    io.Fonts->ClearTexDirty();
 
     // Create texture sampler
     {
@@ -462,6 +521,16 @@ bool    ImGui_ImplDX11_CreateDeviceObjects()
         g_pd3dDevice->CreateRasterizerState(&desc, &g_pRasterizerState);
     }
 
+    // Create the frame fences
+    {
+        D3D11_QUERY_DESC desc;
+        desc.Query = D3D11_QUERY_EVENT;
+        desc.MiscFlags = 0;
+        for (int i = 0; i < IM_ARRAYSIZE(g_pFrameQueries); i++)
+            if (g_pd3dDevice->CreateQuery(&desc, &g_pFrameQueries[i]) < 0)
+                return false;
+    }
+
     ImGui_ImplDX11_CreateFontsTexture();
 
     return true;
@@ -476,6 +545,11 @@ void    ImGui_ImplDX11_InvalidateDeviceObjects()
     if (g_pFontTextureView) { g_pFontTextureView->Release(); g_pFontTextureView = NULL; ImGui::GetIO().Fonts->TexID = 0; }
     if (g_pIB) { g_pIB->Release(); g_pIB = NULL; }
     if (g_pVB) { g_pVB->Release(); g_pVB = NULL; }
+    for (int i = 0; i < IM_ARRAYSIZE(g_pFrameQueries); i++)
+        if (g_pFrameQueries[i]) { g_pFrameQueries[i]->Release(); g_pFrameQueries[i] = NULL; }
+    UploadRingReset(&g_VertexRing, 0);
+    UploadRingReset(&g_IndexRing, 0);
+    g_NumFramesSubmitted = g_NumFramesCompleted = 0;
 
     if (g_pBlendState) { g_pBlendState->Release(); g_pBlendState = NULL; }
     if (g_pRasterizerState) { g_pRasterizerState->Release(); g_pRasterizerState = NULL; }
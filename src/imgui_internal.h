@@ -363,6 +363,7 @@ struct ImGuiState
     int                     FrameCountEnded;
     int                     FrameCountRendered;
     ImVector<ImGuiWindow*>  Windows;
+    ImGuiStorage            WindowsById;                        // ImGuiWindow* by window ID, for FindWindowByName()
     ImVector<ImGuiWindow*>  WindowsSortBuffer;
     ImGuiWindow*            CurrentWindow;                      // Being drawn into
     ImVector<ImGuiWindow*>  CurrentWindowStack;
@@ -0,0 +1,166 @@
+#include "materialtable.h"
+
+#include <unordered_map>
+#include <string>
+#include <cstring>
+
+static uint32_t MaterialTableFloatBits(float f)
+{
+    uint32_t bits;
+    memcpy(&bits, &f, sizeof(bits));
+    return bits;
+}
+
+static float MaterialTableBitsFloat(uint32_t bits)
+{
+    float f;
+    memcpy(&f, &bits, sizeof(f));
+    return f;
+}
+
+uint16_t MaterialTableFloatToHalf(float f)
+{
+    uint32_t bits = MaterialTableFloatBits(f);
+    uint32_t sign = (bits >> 16) & 0x8000;
+    uint32_t exponent = (bits >> 23) & 0xFF;
+    uint32_t mantissa = bits & 0x7FFFFF;
+
+    // infinity stays infinity, and NaN stays a quiet NaN
+    if (exponent == 0xFF)
+        return (uint16_t)(sign | 0x7C00 | (mantissa ? 0x200 : 0));
+
+    int halfExponent = (int)exponent - 127 + 15;
+    if (halfExponent >= 31)
+        return (uint16_t)(sign | 0x7C00);
+
+    if (halfExponent <= 0)
+    {
+        // a denormal half, or zero if it's too small even for that
+        if (halfExponent < -10)
+            return (uint16_t)sign;
+
+        mantissa |= 0x800000;
+        int shift = 14 - halfExponent;
+        uint32_t halfMantissa = mantissa >> shift;
+        uint32_t remainder = mantissa & ((1u << shift) - 1);
+        uint32_t halfway = 1u << (shift - 1);
+        if (remainder > halfway || (remainder == halfway && (halfMantissa & 1)))
+            halfMantissa++;
+        return (uint16_t)(sign | halfMantissa);
+    }
+
+    uint32_t half = sign | ((uint32_t)halfExponent << 10) | (mantissa >> 13);
+    uint32_t remainder = mantissa & 0x1FFF;
+
+    // a carry out of the mantissa correctly bumps the exponent, up to infinity
+    if (remainder > 0x1000 || (remainder == 0x1000 && (half & 1)))
+        half++;
+    return (uint16_t)half;
+}
+
+float MaterialTableHalfToFloat(uint16_t h)
+{
+    uint32_t sign = (uint32_t)(h & 0x8000) << 16;
+    uint32_t exponent = (h >> 10) & 0x1F;
+    uint32_t mantissa = h & 0x3FF;
+
+    if (exponent == 0x1F)
+        return MaterialTableBitsFloat(sign | 0x7F800000 | (mantissa << 13));
+
+    if (exponent == 0)
+    {
+        // denormals are mantissa * 2^-24
+        float f = mantissa * (1.0f / 16777216.0f);
+        return sign ? -f : f;
+    }
+
+    return MaterialTableBitsFloat(sign | ((exponent - 15 + 127) << 23) | (mantissa << 13));
+}
+
+static uint32_t MaterialTablePackHalves(float low, float high)
+{
+    return MaterialTableFloatToHalf(low) | ((uint32_t)MaterialTableFloatToHalf(high) << 16);
+}
+
+bool MaterialTablePack(const MaterialTableMaterial& material, PackedMaterial* pPacked)
+{
+    PackedMaterial& packed = *pPacked;
+    packed.AmbientRG = MaterialTablePackHalves(material.Ambient[0], material.Ambient[1]);
+    packed.AmbientBOpacity = MaterialTablePackHalves(material.Ambient[2], material.Opacity);
+    packed.DiffuseRG = MaterialTablePackHalves(material.Diffuse[0], material.Diffuse[1]);
+    packed.DiffuseBShininess = MaterialTablePackHalves(material.Diffuse[2], material.Shininess);
+    packed.SpecularRG = MaterialTablePackHalves(material.Specular[0], material.Specular[1]);
+    packed.SpecularB = MaterialTableFloatToHalf(material.Specular[2]);
+
+    float* uvTransforms[kMaterialTableNumTextures] = { packed.DiffuseUVTransform, packed.SpecularUVTransform, packed.BumpUVTransform };
+
+    packed.Flags = 0;
+    packed.TextureSlices = 0;
+    for (int textureIndex = 0; textureIndex < kMaterialTableNumTextures; textureIndex++)
+    {
+        const MaterialTableTexture& texture = material.Textures[textureIndex];
+        memcpy(uvTransforms[textureIndex], texture.UVTransform, sizeof(texture.UVTransform));
+
+        if (!texture.Present)
+            continue;
+
+        if (texture.Slice < 0 || texture.Slice > kMaterialTableMaxTextureSlice)
+            return false;
+
+        packed.Flags |= MATERIAL_FLAG_HAS_DIFFUSE_TEXTURE << textureIndex;
+        packed.TextureSlices |= (uint32_t)texture.Slice << (MATERIAL_TEXTURE_SLICE_BITS * textureIndex);
+    }
+
+    return true;
+}
+
+bool MaterialTableBuild(const std::vector<MaterialTableMaterial>& materials, MaterialTable* pTable)
+{
+    pTable->Entries.clear();
+    pTable->MaterialEntries.clear();
+
+    // PackedMaterial has no padding, so its bytes are the whole entry
+    std::unordered_map<std::string, int> entryBytesToIndex;
+    for (const MaterialTableMaterial& material : materials)
+    {
+        PackedMaterial packed;
+        if (!MaterialTablePack(material, &packed))
+            return false;
+
+        std::string bytes((const char*)&packed, sizeof(packed));
+        auto found = entryBytesToIndex.find(bytes);
+        if (found == entryBytesToIndex.end())
+        {
+            found = entryBytesToIndex.emplace(bytes, (int)pTable->Entries.size()).first;
+            pTable->Entries.push_back(packed);
+        }
+        pTable->MaterialEntries.push_back(found->second);
+    }
+
+    return true;
+}
+
+void MaterialTableUnpack(const PackedMaterial& packed, MaterialTableMaterial* pMaterial)
+{
+    MaterialTableMaterial& material = *pMaterial;
+    material.Ambient[0] = MaterialTableHalfToFloat((uint16_t)packed.AmbientRG);
+    material.Ambient[1] = MaterialTableHalfToFloat((uint16_t)(packed.AmbientRG >> 16));
+    material.Ambient[2] = MaterialTableHalfToFloat((uint16_t)packed.AmbientBOpacity);
+    material.Opacity = MaterialTableHalfToFloat((uint16_t)(packed.AmbientBOpacity >> 16));
+    material.Diffuse[0] = MaterialTableHalfToFloat((uint16_t)packed.DiffuseRG);
+    material.Diffuse[1] = MaterialTableHalfToFloat((uint16_t)(packed.DiffuseRG >> 16));
+    material.Diffuse[2] = MaterialTableHalfToFloat((uint16_t)packed.DiffuseBShininess);
+    material.Shininess = MaterialTableHalfToFloat((uint16_t)(packed.DiffuseBShininess >> 16));
+    material.Specular[0] = MaterialTableHalfToFloat((uint16_t)packed.SpecularRG);
+    material.Specular[1] = MaterialTableHalfToFloat((uint16_t)(packed.SpecularRG >> 16));
+    material.Specular[2] = MaterialTableHalfToFloat((uint16_t)packed.SpecularB);
+
+    const float* uvTransforms[kMaterialTableNumTextures] = { packed.DiffuseUVTransform, packed.SpecularUVTransform, packed.BumpUVTransform };
+    for (int textureIndex = 0; textureIndex < kMaterialTableNumTextures; textureIndex++)
+    {
+        MaterialTableTexture& texture = material.Textures[textureIndex];
+        texture.Present = (packed.Flags & (MATERIAL_FLAG_HAS_DIFFUSE_TEXTURE << textureIndex)) != 0;
+        texture.Slice = (packed.TextureSlices >> (MATERIAL_TEXTURE_SLICE_BITS * textureIndex)) & MATERIAL_TEXTURE_SLICE_MASK;
+        memcpy(texture.UVTransform, uvTransforms[textureIndex], sizeof(texture.UVTransform));
+    }
+}
\ No newline at end of file
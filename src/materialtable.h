@@ -0,0 +1,63 @@
+#pragma once
+
+#include <vector>
+#include <cstdint>
+#include <cstddef>
+
+// to make HLSL compile as C++
+typedef uint32_t uint;
+
+#include "shaders/material.hlsl"
+
+// Packing of materials into the entries of the material table, which the pixel shader indexes with the draw's material.
+// The layout is defined once in shaders/material.hlsl, and the asserts below keep it the same as what HLSL reads.
+// Nothing here depends on D3D or on Windows.
+
+static_assert(sizeof(PackedMaterial) == PACKED_MATERIAL_SIZE, "PackedMaterial doesn't match PACKED_MATERIAL_SIZE");
+static_assert(PACKED_MATERIAL_SIZE % 16 == 0, "Structured buffer elements should be a multiple of 16 bytes");
+static_assert(offsetof(PackedMaterial, Flags) == PACKED_MATERIAL_FLAGS_OFFSET, "PackedMaterial doesn't match PACKED_MATERIAL_FLAGS_OFFSET");
+static_assert(offsetof(PackedMaterial, DiffuseUVTransform) == PACKED_MATERIAL_UVTRANSFORMS_OFFSET, "PackedMaterial doesn't match PACKED_MATERIAL_UVTRANSFORMS_OFFSET");
+static_assert(offsetof(PackedMaterial, BumpUVTransform) + sizeof(PackedMaterial::BumpUVTransform) == PACKED_MATERIAL_SIZE, "PackedMaterial has padding at its end");
+
+static const int kMaterialTableNumTextures = 3; // diffuse, specular and bump, in the order of the flags and slices
+static const int kMaterialTableMaxTextureSlice = MATERIAL_TEXTURE_SLICE_MASK;
+
+struct MaterialTableTexture
+{
+    bool Present;
+    int Slice;
+    float UVTransform[4];
+};
+
+struct MaterialTableMaterial
+{
+    float Ambient[3];
+    float Diffuse[3];
+    float Specular[3];
+    float Shininess;
+    float Opacity;
+    MaterialTableTexture Textures[kMaterialTableNumTextures];
+};
+
+struct MaterialTable
+{
+    std::vector<PackedMaterial> Entries; // what the structured buffer holds
+    std::vector<int> MaterialEntries; // the entry of each material, which is the index the draws pass to the shaders
+};
+
+// Round to nearest even, like f32tof16. Values too big for a half become infinity.
+uint16_t MaterialTableFloatToHalf(float f);
+
+// Like f16tof32.
+float MaterialTableHalfToFloat(uint16_t h);
+
+// Returns false if a texture's slice is past kMaterialTableMaxTextureSlice.
+bool MaterialTablePack(const MaterialTableMaterial& material, PackedMaterial* pPacked);
+
+// Packs the materials in order, and materials that pack to the same bytes share the entry of the first of them, like
+// the copies of a material that every OBJ file loading the same .mtl adds.
+// Returns false if a material can't be packed, which is then the one at MaterialEntries.size().
+bool MaterialTableBuild(const std::vector<MaterialTableMaterial>& materials, MaterialTable* pTable);
+
+// Reads the entry back like the pixel shader does. The textures that aren't present come back with slice 0 and their UV transform.
+void MaterialTableUnpack(const PackedMaterial& packed, MaterialTableMaterial* pMaterial);
\ No newline at end of file
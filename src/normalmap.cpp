@@ -0,0 +1,187 @@
+#include "normalmap.h"
+
+#include "parallel.h"
+
+#include <emmintrin.h>
+
+#include <algorithm>
+#include <cmath>
+#include <cstring>
+
+static const int kNormalMapRowsPerJob = 16;
+
+void NormalMapFromHeightsReference(float h01, float h21, float h10, float h12, float scale, float pNormal[3])
+{
+    // va = normalize(float3(2, 0, (b21 - b01) * scale)), vb = normalize(float3(0, 2, (b12 - b10) * scale))
+    float va[3] = { 2.0f, 0.0f, (h21 - h01) * scale };
+    float vb[3] = { 0.0f, 2.0f, (h12 - h10) * scale };
+
+    float vaLength = std::sqrt(va[0] * va[0] + va[1] * va[1] + va[2] * va[2]);
+    float vbLength = std::sqrt(vb[0] * vb[0] + vb[1] * vb[1] + vb[2] * vb[2]);
+    for (int i = 0; i < 3; i++)
+    {
+        va[i] /= vaLength;
+        vb[i] /= vbLength;
+    }
+
+    // cross(va, vb)
+    pNormal[0] = va[1] * vb[2] - va[2] * vb[1];
+    pNormal[1] = va[2] * vb[0] - va[0] * vb[2];
+    pNormal[2] = va[0] * vb[1] - va[1] * vb[0];
+
+    float length = std::sqrt(pNormal[0] * pNormal[0] + pNormal[1] * pNormal[1] + pNormal[2] * pNormal[2]);
+    for (int i = 0; i < 3; i++)
+    {
+        pNormal[i] /= length;
+    }
+}
+
+// cross(va, vb) simplifies to float3(-dx * k, -dy * k, 1) up to its length, where dx and dy are the height differences
+// in 8 bit units and k = scale / 255 / 2. The vector ops below do exactly the same steps, so both paths agree bit for bit.
+static void NormalMapEncodeTexel(int dx, int dy, float k, int8_t* pTexelXY)
+{
+    float nx = -(float)dx * k;
+    float ny = -(float)dy * k;
+    float invLength = 1.0f / std::sqrt(nx * nx + ny * ny + 1.0f);
+
+    pTexelXY[0] = (int8_t)_mm_cvtss_si32(_mm_set_ss(nx * invLength * 127.0f));
+    pTexelXY[1] = (int8_t)_mm_cvtss_si32(_mm_set_ss(ny * invLength * 127.0f));
+}
+
+static __m128 NormalMapLoadHeights(const uint8_t* pHeights)
+{
+    int packed;
+    memcpy(&packed, pHeights, sizeof(packed));
+    __m128i bytes = _mm_cvtsi32_si128(packed);
+    __m128i zero = _mm_setzero_si128();
+    return _mm_cvtepi32_ps(_mm_unpacklo_epi16(_mm_unpacklo_epi8(bytes, zero), zero));
+}
+
+static void NormalMapComputeRow(const uint8_t* pHeights, int width, int height, int y, float k, int8_t* pRowXY)
+{
+    const uint8_t* pAbove = &pHeights[(size_t)((y + height - 1) % height) * width];
+    const uint8_t* pRow = &pHeights[(size_t)y * width];
+    const uint8_t* pBelow = &pHeights[(size_t)((y + 1) % height) * width];
+
+    auto encodeScalar = [&](int x)
+    {
+        int left = pRow[(x + width - 1) % width];
+        int right = pRow[(x + 1) % width];
+        NormalMapEncodeTexel(right - left, pBelow[x] - pAbove[x], k, &pRowXY[x * 2]);
+    };
+
+    // the first and last texels wrap around, so they take the scalar path
+    encodeScalar(0);
+
+    int x = 1;
+    const __m128 negK = _mm_set1_ps(-k);
+    const __m128 one = _mm_set1_ps(1.0f);
+    const __m128 snormScale = _mm_set1_ps(127.0f);
+    for (; x + 4 <= width - 1; x += 4)
+    {
+        __m128 dx = _mm_sub_ps(NormalMapLoadHeights(&pRow[x + 1]), NormalMapLoadHeights(&pRow[x - 1]));
+        __m128 dy = _mm_sub_ps(NormalMapLoadHeights(&pBelow[x]), NormalMapLoadHeights(&pAbove[x]));
+
+        __m128 nx = _mm_mul_ps(dx, negK);
+        __m128 ny = _mm_mul_ps(dy, negK);
+        __m128 lengthSq = _mm_add_ps(_mm_add_ps(_mm_mul_ps(nx, nx), _mm_mul_ps(ny, ny)), one);
+        __m128 invLength = _mm_div_ps(one, _mm_sqrt_ps(lengthSq));
+
+        __m128i qx = _mm_cvtps_epi32(_mm_mul_ps(_mm_mul_ps(nx, invLength), snormScale));
+        __m128i qy = _mm_cvtps_epi32(_mm_mul_ps(_mm_mul_ps(ny, invLength), snormScale));
+
+        // narrow to 8 bits and interleave into x, y pairs
+        __m128i bx = _mm_packs_epi16(_mm_packs_epi32(qx, qx), _mm_setzero_si128());
+        __m128i by = _mm_packs_epi16(_mm_packs_epi32(qy, qy), _mm_setzero_si128());
+        _mm_storel_epi64((__m128i*)&pRowXY[x * 2], _mm_unpacklo_epi8(bx, by));
+    }
+
+    for (; x < width; x++)
+    {
+        encodeScalar(x);
+    }
+}
+
+void NormalMapFromHeightMap(
+    const uint8_t* pHeights, int width, int height, float scale,
+    int8_t* pNormalsXY,
+    int numThreads)
+{
+    float k = scale / 255.0f * 0.5f;
+
+    int numJobs = (height + kNormalMapRowsPerJob - 1) / kNormalMapRowsPerJob;
+    ParallelFor(numJobs, numThreads, [&](int job, int)
+    {
+        int endY = std::min((job + 1) * kNormalMapRowsPerJob, height);
+        for (int y = job * kNormalMapRowsPerJob; y < endY; y++)
+        {
+            NormalMapComputeRow(pHeights, width, height, y, k, &pNormalsXY[(size_t)y * width * 2]);
+        }
+    });
+}
+
+int NormalMapGetNumLevels(int width, int height)
+{
+    int numLevels = 1;
+    while (width > 1 || height > 1)
+    {
+        width = std::max(width / 2, 1);
+        height = std::max(height / 2, 1);
+        numLevels++;
+    }
+    return numLevels;
+}
+
+// 2x2 box filter, where an odd last row or column is folded into its neighbor.
+static void NormalMapDownsampleHeights(
+    const uint8_t* pSrc, int srcWidth, int srcHeight,
+    uint8_t* pDst, int numThreads)
+{
+    int dstWidth = std::max(srcWidth / 2, 1);
+    int dstHeight = std::max(srcHeight / 2, 1);
+
+    ParallelFor(dstHeight, numThreads, [&](int y, int)
+    {
+        const uint8_t* pRow0 = &pSrc[(size_t)std::min(y * 2, srcHeight - 1) * srcWidth];
+        const uint8_t* pRow1 = &pSrc[(size_t)std::min(y * 2 + 1, srcHeight - 1) * srcWidth];
+        for (int x = 0; x < dstWidth; x++)
+        {
+            int x0 = std::min(x * 2, srcWidth - 1);
+            int x1 = std::min(x * 2 + 1, srcWidth - 1);
+            pDst[(size_t)y * dstWidth + x] = (uint8_t)((pRow0[x0] + pRow0[x1] + pRow1[x0] + pRow1[x1] + 2) / 4);
+        }
+    });
+}
+
+void NormalMapBuildMipChain(
+    const uint8_t* pHeights, int width, int height, float scale,
+    std::vector<NormalMapLevel>* pLevels,
+    int numThreads)
+{
+    int numLevels = NormalMapGetNumLevels(width, height);
+    pLevels->resize(numLevels);
+
+    std::vector<uint8_t> levelHeights;
+    std::vector<uint8_t> nextLevelHeights;
+
+    for (int level = 0; level < numLevels; level++)
+    {
+        const uint8_t* pLevelHeights = level == 0 ? pHeights : levelHeights.data();
+
+        NormalMapLevel& normalMapLevel = (*pLevels)[level];
+        normalMapLevel.Width = width;
+        normalMapLevel.Height = height;
+        normalMapLevel.TexelsXY.resize((size_t)width * height * 2);
+        NormalMapFromHeightMap(pLevelHeights, width, height, scale, normalMapLevel.TexelsXY.data(), numThreads);
+
+        if (level + 1 < numLevels)
+        {
+            nextLevelHeights.resize((size_t)std::max(width / 2, 1) * std::max(height / 2, 1));
+            NormalMapDownsampleHeights(pLevelHeights, width, height, nextLevelHeights.data(), numThreads);
+            levelHeights.swap(nextLevelHeights);
+
+            width = std::max(width / 2, 1);
+            height = std::max(height / 2, 1);
+        }
+    }
+}
\ No newline at end of file
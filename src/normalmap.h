@@ -0,0 +1,36 @@
+#pragma once
+
+#include <vector>
+#include <cstdint>
+
+// Conversion of bump height maps into tangent-space normal maps at import time,
+// so the pixel shader can replace five height taps and a cross product with a single tap.
+// Normals are stored as two SNORM8 channels (x, y), and z is reconstructed as sqrt(1 - x*x - y*y).
+// Heights are 8 bit, addressed with wrapping like the scene's bump sampler.
+
+struct NormalMapLevel
+{
+    int Width;
+    int Height;
+    std::vector<int8_t> TexelsXY; // 2 bytes per texel
+};
+
+// What scene.hlsl used to compute per pixel from the heights (in [0,1]) left, right, above and below a texel,
+// with scale standing in for its 3000 / depth. The result is normalized.
+void NormalMapFromHeightsReference(float h01, float h21, float h10, float h12, float scale, float pNormal[3]);
+
+// A single level from the central differences of the height map, with rows spread across threads.
+void NormalMapFromHeightMap(
+    const uint8_t* pHeights, int width, int height, float scale,
+    int8_t* pNormalsXY,
+    int numThreads = 0); // 0 uses every hardware thread
+
+// The number of levels of a full mip chain, like D3D's.
+int NormalMapGetNumLevels(int width, int height);
+
+// Every level is derived from a box filtered copy of the height map at that resolution,
+// which is what the shader's texel offset taps used to see when sampling lower mips.
+void NormalMapBuildMipChain(
+    const uint8_t* pHeights, int width, int height, float scale,
+    std::vector<NormalMapLevel>* pLevels,
+    int numThreads = 0);
\ No newline at end of file
@@ -0,0 +1,389 @@
+#include "occlusion.h"
+
+#include <emmintrin.h>
+
+#include <vector>
+#include <algorithm>
+#include <cmath>
+#include <cfloat>
+
+using namespace DirectX;
+
+// Vertices closer than this (in clip-space w) are not projected.
+// Triangles touching it are dropped as occluders and boxes touching it are always visible.
+static const float kNearW = 1e-3f;
+
+// How many pyramid levels a box test may descend below its starting level.
+static const int kMaxRefineLevels = 2;
+
+struct HiZLevel
+{
+    int Width;
+    int Height;
+    std::vector<float> MinDepth;
+    std::vector<float> MaxDepth;
+};
+
+struct Occlusion
+{
+    int Width;
+    int Height;
+
+    XMFLOAT4X4 WorldViewProjection;
+
+    // Level 0 is the rasterized depth buffer, so its min and max are the same values.
+    std::vector<float> Depth;
+    std::vector<HiZLevel> Levels;
+};
+
+static Occlusion g_Occlusion;
+
+void OcclusionInit(int width, int height)
+{
+    // rasterization works on rows of 4 pixels
+    width = (width + 3) & ~3;
+
+    g_Occlusion.Width = width;
+    g_Occlusion.Height = height;
+    g_Occlusion.Depth.assign(width * height, 1.0f);
+    g_Occlusion.Levels.clear();
+
+    int levelWidth = width, levelHeight = height;
+    while (levelWidth > 1 || levelHeight > 1)
+    {
+        // round up so the last row and column of odd-sized levels are still covered
+        levelWidth = (levelWidth + 1) / 2;
+        levelHeight = (levelHeight + 1) / 2;
+
+        HiZLevel level;
+        level.Width = levelWidth;
+        level.Height = levelHeight;
+        level.MinDepth.resize(levelWidth * levelHeight);
+        level.MaxDepth.resize(levelWidth * levelHeight);
+        g_Occlusion.Levels.push_back(std::move(level));
+    }
+}
+
+void OcclusionBeginFrame(FXMMATRIX worldViewProjection)
+{
+    XMStoreFloat4x4(&g_Occlusion.WorldViewProjection, worldViewProjection);
+    std::fill(g_Occlusion.Depth.begin(), g_Occlusion.Depth.end(), 1.0f);
+}
+
+static void OcclusionRasterizeTriangle(const XMFLOAT4 clip[3])
+{
+    const int W = g_Occlusion.Width;
+    const int H = g_Occlusion.Height;
+
+    float sx[3], sy[3], sz[3];
+    for (int i = 0; i < 3; i++)
+    {
+        float invW = 1.0f / clip[i].w;
+        sx[i] = (clip[i].x * invW * 0.5f + 0.5f) * W;
+        sy[i] = (clip[i].y * invW * -0.5f + 0.5f) * H;
+        sz[i] = clip[i].z * invW;
+    }
+
+    float area = (sx[1] - sx[0]) * (sy[2] - sy[0]) - (sx[2] - sx[0]) * (sy[1] - sy[0]);
+    if (std::abs(area) < 1e-6f)
+    {
+        return;
+    }
+
+    // Both windings are occluders since the scene is drawn without backface culling
+    if (area < 0.0f)
+    {
+        std::swap(sx[1], sx[2]);
+        std::swap(sy[1], sy[2]);
+        std::swap(sz[1], sz[2]);
+        area = -area;
+    }
+
+    int minX = std::max(0, (int)std::floor(std::min(sx[0], std::min(sx[1], sx[2]))));
+    int maxX = std::min(W - 1, (int)std::ceil(std::max(sx[0], std::max(sx[1], sx[2]))));
+    int minY = std::max(0, (int)std::floor(std::min(sy[0], std::min(sy[1], sy[2]))));
+    int maxY = std::min(H - 1, (int)std::ceil(std::max(sy[0], std::max(sy[1], sy[2]))));
+    if (minX > maxX || minY > maxY)
+    {
+        return;
+    }
+
+    minX &= ~3;
+
+    // Edge functions E(x,y) = A*x + B*y + C, positive on the inside.
+    // Pixel centers on an edge are only written for left and top edges, like the GPU's fill rule,
+    // so occluders never grow and the triangles on either side of a shared edge leave no crack.
+    float edgeA[3], edgeB[3], edgeC[3];
+    __m128 edgeTie[3];
+    for (int i = 0; i < 3; i++)
+    {
+        int j = (i + 1) % 3;
+        edgeA[i] = sy[i] - sy[j];
+        edgeB[i] = sx[j] - sx[i];
+        edgeC[i] = sx[i] * sy[j] - sx[j] * sy[i];
+
+        bool topLeft = edgeA[i] > 0.0f || (edgeA[i] == 0.0f && edgeB[i] > 0.0f);
+        edgeTie[i] = _mm_castsi128_ps(_mm_set1_epi32(topLeft ? -1 : 0));
+    }
+
+    // Depth plane z(x,y) = ZA*x + ZB*y + ZC, from the barycentric weights of vertices 1 and 2
+    float invArea = 1.0f / area;
+    float dz1 = (sz[1] - sz[0]) * invArea;
+    float dz2 = (sz[2] - sz[0]) * invArea;
+    float zA = edgeA[2] * dz1 + edgeA[0] * dz2;
+    float zB = edgeB[2] * dz1 + edgeB[0] * dz2;
+    float zC = sz[0] + edgeC[2] * dz1 + edgeC[0] * dz2;
+
+    const __m128 kLaneOffsets = _mm_setr_ps(0.5f, 1.5f, 2.5f, 3.5f);
+
+    __m128 e0A = _mm_set1_ps(edgeA[0]), e1A = _mm_set1_ps(edgeA[1]), e2A = _mm_set1_ps(edgeA[2]);
+    __m128 vzA = _mm_set1_ps(zA);
+    __m128 zero = _mm_setzero_ps();
+
+    for (int y = minY; y <= maxY; y++)
+    {
+        float py = y + 0.5f;
+        __m128 e0Row = _mm_set1_ps(edgeB[0] * py + edgeC[0]);
+        __m128 e1Row = _mm_set1_ps(edgeB[1] * py + edgeC[1]);
+        __m128 e2Row = _mm_set1_ps(edgeB[2] * py + edgeC[2]);
+        __m128 zRow = _mm_set1_ps(zB * py + zC);
+
+        float* row = &g_Occlusion.Depth[y * W];
+
+        for (int x = minX; x <= maxX; x += 4)
+        {
+            __m128 px = _mm_add_ps(_mm_set1_ps((float)x), kLaneOffsets);
+
+            __m128 e0 = _mm_add_ps(_mm_mul_ps(e0A, px), e0Row);
+            __m128 e1 = _mm_add_ps(_mm_mul_ps(e1A, px), e1Row);
+            __m128 e2 = _mm_add_ps(_mm_mul_ps(e2A, px), e2Row);
+
+            __m128 in0 = _mm_or_ps(_mm_cmpgt_ps(e0, zero), _mm_and_ps(_mm_cmpeq_ps(e0, zero), edgeTie[0]));
+            __m128 in1 = _mm_or_ps(_mm_cmpgt_ps(e1, zero), _mm_and_ps(_mm_cmpeq_ps(e1, zero), edgeTie[1]));
+            __m128 in2 = _mm_or_ps(_mm_cmpgt_ps(e2, zero), _mm_and_ps(_mm_cmpeq_ps(e2, zero), edgeTie[2]));
+            __m128 inside = _mm_and_ps(in0, _mm_and_ps(in1, in2));
+
+            if (_mm_movemask_ps(inside) == 0)
+            {
+                continue;
+            }
+
+            __m128 z = _mm_add_ps(_mm_mul_ps(vzA, px), zRow);
+            __m128 oldZ = _mm_loadu_ps(row + x);
+            __m128 newZ = _mm_min_ps(oldZ, z);
+            _mm_storeu_ps(row + x, _mm_or_ps(_mm_and_ps(inside, newZ), _mm_andnot_ps(inside, oldZ)));
+        }
+    }
+}
+
+void OcclusionRasterizeTriangles(const XMFLOAT3* positions, int numTriangles)
+{
+    XMMATRIX worldViewProjection = XMLoadFloat4x4(&g_Occlusion.WorldViewProjection);
+
+    for (int tri = 0; tri < numTriangles; tri++)
+    {
+        XMFLOAT4 clip[3];
+        int outsideMask = 0x3F;
+        bool nearClipped = false;
+
+        for (int i = 0; i < 3; i++)
+        {
+            XMStoreFloat4(&clip[i], XMVector3Transform(XMLoadFloat3(&positions[tri * 3 + i]), worldViewProjection));
+
+            const XMFLOAT4& c = clip[i];
+            int outside = 0;
+            if (c.x < -c.w) outside |= 0x01;
+            if (c.x > c.w) outside |= 0x02;
+            if (c.y < -c.w) outside |= 0x04;
+            if (c.y > c.w) outside |= 0x08;
+            if (c.z < 0.0f) outside |= 0x10;
+            if (c.z > c.w) outside |= 0x20;
+            outsideMask &= outside;
+
+            // Behind the near plane, where the GPU would clip the triangle away
+            if (c.z < 0.0f || c.w < kNearW)
+                nearClipped = true;
+        }
+
+        // Trivially rejected against one of the frustum planes
+        if (outsideMask != 0)
+        {
+            continue;
+        }
+
+        // Dropping an occluder is always conservative, so don't bother clipping
+        if (nearClipped)
+        {
+            continue;
+        }
+
+        OcclusionRasterizeTriangle(clip);
+    }
+}
+
+void OcclusionEndFrame()
+{
+    const float* srcMin = g_Occlusion.Depth.data();
+    const float* srcMax = g_Occlusion.Depth.data();
+    int srcWidth = g_Occlusion.Width;
+    int srcHeight = g_Occlusion.Height;
+
+    for (HiZLevel& level : g_Occlusion.Levels)
+    {
+        for (int y = 0; y < level.Height; y++)
+        {
+            int y0 = std::min(y * 2, srcHeight - 1);
+            int y1 = std::min(y * 2 + 1, srcHeight - 1);
+
+            for (int x = 0; x < level.Width; x++)
+            {
+                int x0 = std::min(x * 2, srcWidth - 1);
+                int x1 = std::min(x * 2 + 1, srcWidth - 1);
+
+                float minZ = std::min(
+                    std::min(srcMin[y0 * srcWidth + x0], srcMin[y0 * srcWidth + x1]),
+                    std::min(srcMin[y1 * srcWidth + x0], srcMin[y1 * srcWidth + x1]));
+
+                float maxZ = std::max(
+                    std::max(srcMax[y0 * srcWidth + x0], srcMax[y0 * srcWidth + x1]),
+                    std::max(srcMax[y1 * srcWidth + x0], srcMax[y1 * srcWidth + x1]));
+
+                level.MinDepth[y * level.Width + x] = minZ;
+                level.MaxDepth[y * level.Width + x] = maxZ;
+            }
+        }
+
+        srcMin = level.MinDepth.data();
+        srcMax = level.MaxDepth.data();
+        srcWidth = level.Width;
+        srcHeight = level.Height;
+    }
+}
+
+// Tests the level-0 pixel rectangle [x0,x1]x[y0,y1] at the given pyramid level.
+// Texels that can't decide the result are refined at the next finer level.
+static bool OcclusionIsRectVisible(int levelIndex, int x0, int y0, int x1, int y1, float nearestZ, int refineBudget)
+{
+    if (levelIndex == 0)
+    {
+        for (int y = y0; y <= y1; y++)
+        {
+            for (int x = x0; x <= x1; x++)
+            {
+                if (nearestZ <= g_Occlusion.Depth[y * g_Occlusion.Width + x])
+                    return true;
+            }
+        }
+
+        return false;
+    }
+
+    const HiZLevel& level = g_Occlusion.Levels[levelIndex - 1];
+
+    int lx0 = std::min(x0 >> levelIndex, level.Width - 1);
+    int lx1 = std::min(x1 >> levelIndex, level.Width - 1);
+    int ly0 = std::min(y0 >> levelIndex, level.Height - 1);
+    int ly1 = std::min(y1 >> levelIndex, level.Height - 1);
+
+    for (int ly = ly0; ly <= ly1; ly++)
+    {
+        for (int lx = lx0; lx <= lx1; lx++)
+        {
+            int texel = ly * level.Width + lx;
+
+            // Everything under this texel is closer than the box, so it's hidden here
+            if (nearestZ > level.MaxDepth[texel])
+                continue;
+
+            // Something under this texel is farther than the box, so it's visible for sure
+            if (nearestZ <= level.MinDepth[texel] || refineBudget == 0)
+                return true;
+
+            // Inconclusive, look at the part of this texel covered by the rectangle more closely
+            int cx0 = std::max(x0, lx << levelIndex);
+            int cx1 = std::min(x1, ((lx + 1) << levelIndex) - 1);
+            int cy0 = std::max(y0, ly << levelIndex);
+            int cy1 = std::min(y1, ((ly + 1) << levelIndex) - 1);
+            if (OcclusionIsRectVisible(levelIndex - 1, cx0, cy0, cx1, cy1, nearestZ, refineBudget - 1))
+                return true;
+        }
+    }
+
+    return false;
+}
+
+bool OcclusionIsBoxVisible(const XMFLOAT3& boxMin, const XMFLOAT3& boxMax, FXMMATRIX world)
+{
+    XMMATRIX worldViewProjection = XMMatrixMultiply(world, XMLoadFloat4x4(&g_Occlusion.WorldViewProjection));
+
+    XMFLOAT4 clip[8];
+    bool straddlesCamera = false;
+    int numBehindNear = 0;
+
+    for (int corner = 0; corner < 8; corner++)
+    {
+        XMVECTOR p = XMVectorSet(
+            (corner & 1) ? boxMax.x : boxMin.x,
+            (corner & 2) ? boxMax.y : boxMin.y,
+            (corner & 4) ? boxMax.z : boxMin.z,
+            1.0f);
+
+        XMStoreFloat4(&clip[corner], XMVector4Transform(p, worldViewProjection));
+
+        if (clip[corner].z < 0.0f)
+            numBehindNear++;
+
+        if (clip[corner].w < kNearW)
+            straddlesCamera = true;
+    }
+
+    // Entirely behind the near plane
+    if (numBehindNear == 8)
+    {
+        return false;
+    }
+
+    // The box straddles the camera, so its projection is unbounded
+    if (straddlesCamera)
+    {
+        return true;
+    }
+
+    float minX = FLT_MAX, minY = FLT_MAX, minZ = FLT_MAX;
+    float maxX = -FLT_MAX, maxY = -FLT_MAX;
+
+    for (int corner = 0; corner < 8; corner++)
+    {
+        float invW = 1.0f / clip[corner].w;
+        float sx = (clip[corner].x * invW * 0.5f + 0.5f) * g_Occlusion.Width;
+        float sy = (clip[corner].y * invW * -0.5f + 0.5f) * g_Occlusion.Height;
+        float sz = clip[corner].z * invW;
+
+        minX = std::min(minX, sx);
+        maxX = std::max(maxX, sx);
+        minY = std::min(minY, sy);
+        maxY = std::max(maxY, sy);
+        minZ = std::min(minZ, sz);
+    }
+
+    // Outside the view frustum
+    if (maxX < 0.0f || maxY < 0.0f || minX > (float)g_Occlusion.Width || minY > (float)g_Occlusion.Height || minZ > 1.0f)
+    {
+        return false;
+    }
+
+    int x0 = std::max(0, (int)std::floor(minX));
+    int x1 = std::min(g_Occlusion.Width - 1, (int)std::floor(maxX));
+    int y0 = std::max(0, (int)std::floor(minY));
+    int y1 = std::min(g_Occlusion.Height - 1, (int)std::floor(maxY));
+
+    // Start at the finest level where the rectangle covers at most 2x2 texels
+    int levelIndex = 0;
+    while (levelIndex < (int)g_Occlusion.Levels.size() &&
+        ((x1 >> levelIndex) - (x0 >> levelIndex) > 1 || (y1 >> levelIndex) - (y0 >> levelIndex) > 1))
+    {
+        levelIndex++;
+    }
+
+    return OcclusionIsRectVisible(levelIndex, x0, y0, x1, y1, minZ, std::min(levelIndex, kMaxRefineLevels));
+}
\ No newline at end of file
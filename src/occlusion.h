@@ -0,0 +1,22 @@
+#pragma once
+
+#include <DirectXMath.h>
+
+// Software occlusion culling.
+// Occluder triangles are rasterized on the CPU into a small depth buffer,
+// which is reduced into a min/max hierarchical Z pyramid that boxes are tested against.
+
+void OcclusionInit(int width, int height);
+
+void OcclusionBeginFrame(DirectX::FXMMATRIX worldViewProjection);
+
+// Rasterizes a world-space triangle list into the occlusion depth buffer.
+void OcclusionRasterizeTriangles(const DirectX::XMFLOAT3* positions, int numTriangles);
+
+void OcclusionEndFrame();
+
+// Tests a local-space box transformed by world against the hierarchical Z pyramid.
+// Returns false if the box is outside the view or is completely hidden by occluders.
+bool OcclusionIsBoxVisible(
+    const DirectX::XMFLOAT3& boxMin, const DirectX::XMFLOAT3& boxMax,
+    DirectX::FXMMATRIX world);
\ No newline at end of file
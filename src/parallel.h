@@ -0,0 +1,48 @@
+#pragma once
+
+#include <thread>
+#include <atomic>
+#include <vector>
+
+inline int ParallelGetDefaultNumThreads()
+{
+    int numThreads = (int)std::thread::hardware_concurrency();
+    return numThreads > 0 ? numThreads : 1;
+}
+
+// Calls func(index, threadIndex) for every index in [0, count) using numThreads threads.
+// Indices are handed out one at a time, so uneven amounts of work per index still balance out.
+// threadIndex is in [0, numThreads) and can be used to pick per-thread scratch memory.
+template<class Func>
+void ParallelFor(int count, int numThreads, const Func& func)
+{
+    if (numThreads <= 0)
+        numThreads = ParallelGetDefaultNumThreads();
+
+    if (numThreads > count)
+        numThreads = count;
+
+    std::atomic<int> nextIndex(0);
+
+    auto worker = [&](int threadIndex)
+    {
+        for (int index = nextIndex++; index < count; index = nextIndex++)
+        {
+            func(index, threadIndex);
+        }
+    };
+
+    std::vector<std::thread> threads;
+    for (int threadIndex = 1; threadIndex < numThreads; threadIndex++)
+    {
+        threads.emplace_back(worker, threadIndex);
+    }
+
+    // the calling thread works too
+    worker(0);
+
+    for (std::thread& thread : threads)
+    {
+        thread.join();
+    }
+}
\ No newline at end of file
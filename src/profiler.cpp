@@ -0,0 +1,291 @@
+#include "profiler.h"
+
+#include <mutex>
+#include <memory>
+#include <string>
+#include <vector>
+#include <chrono>
+#include <algorithm>
+#include <fstream>
+#include <cstdio>
+
+// How long ProfilerInit measures the tick rate for, until the program has run long enough to measure it better.
+static const double kProfilerCalibrationSeconds = 0.01;
+
+struct ProfilerThreadSlot
+{
+    std::unique_ptr<ProfilerThreadBuffer> pBuffer;
+    std::string Name;
+    bool InUse; // false once the thread exited and its zones were collected
+    std::atomic<bool> Exited; // set by the thread after its last zone
+    uint64_t Tail; // the zones collected so far, only used by the collector
+};
+
+struct ProfilerThreadHistory
+{
+    std::string Name;
+    std::deque<ProfilerEvent> Events;
+};
+
+struct Profiler
+{
+    std::mutex Mutex; // guards Slots, and the names and InUse flags in them
+    std::vector<std::unique_ptr<ProfilerThreadSlot>> Slots;
+
+    // only used by the collector
+    std::vector<ProfilerThreadHistory> Histories;
+    uint64_t NumDroppedEvents;
+
+    uint64_t InitTicks;
+    std::chrono::steady_clock::time_point InitTime;
+    double InitTicksPerSecond;
+};
+
+static Profiler g_Profiler;
+
+thread_local ProfilerThreadBuffer* t_pProfilerBuffer;
+
+// Lets the slot go when its thread exits
+struct ProfilerThreadExit
+{
+    ProfilerThreadSlot* pSlot;
+
+    ~ProfilerThreadExit()
+    {
+        if (pSlot)
+            pSlot->Exited.store(true, std::memory_order_release);
+    }
+};
+
+static thread_local ProfilerThreadExit t_ProfilerThreadExit;
+
+ProfilerThreadBuffer* ProfilerRegisterThread()
+{
+    std::lock_guard<std::mutex> lock(g_Profiler.Mutex);
+
+    size_t slotIndex = 0;
+    while (slotIndex < g_Profiler.Slots.size() && g_Profiler.Slots[slotIndex]->InUse)
+    {
+        slotIndex++;
+    }
+
+    if (slotIndex == g_Profiler.Slots.size())
+    {
+        g_Profiler.Slots.emplace_back(new ProfilerThreadSlot());
+        g_Profiler.Slots.back()->pBuffer.reset(new ProfilerThreadBuffer());
+        g_Profiler.Slots.back()->Tail = 0;
+    }
+
+    // a reused buffer keeps counting from its old head, which the collector has caught up with
+    ProfilerThreadSlot* pSlot = g_Profiler.Slots[slotIndex].get();
+    pSlot->pBuffer->Depth = 0;
+    pSlot->Name = "Thread " + std::to_string(slotIndex);
+    pSlot->InUse = true;
+    pSlot->Exited.store(false, std::memory_order_relaxed);
+
+    t_pProfilerBuffer = pSlot->pBuffer.get();
+    t_ProfilerThreadExit.pSlot = pSlot;
+    return pSlot->pBuffer.get();
+}
+
+void ProfilerInit()
+{
+    g_Profiler.NumDroppedEvents = 0;
+    g_Profiler.InitTicks = ProfilerGetTicks();
+    g_Profiler.InitTime = std::chrono::steady_clock::now();
+
+    std::chrono::steady_clock::time_point now;
+    do
+    {
+        now = std::chrono::steady_clock::now();
+    } while (std::chrono::duration<double>(now - g_Profiler.InitTime).count() < kProfilerCalibrationSeconds);
+
+    g_Profiler.InitTicksPerSecond = (ProfilerGetTicks() - g_Profiler.InitTicks) / std::chrono::duration<double>(now - g_Profiler.InitTime).count();
+}
+
+double ProfilerGetTicksPerSecond()
+{
+    uint64_t ticks = ProfilerGetTicks();
+    double seconds = std::chrono::duration<double>(std::chrono::steady_clock::now() - g_Profiler.InitTime).count();
+    if (seconds < 1.0)
+        return g_Profiler.InitTicksPerSecond;
+
+    return (ticks - g_Profiler.InitTicks) / seconds;
+}
+
+void ProfilerSetThreadName(const char* name)
+{
+    ProfilerGetThreadBuffer();
+
+    std::lock_guard<std::mutex> lock(g_Profiler.Mutex);
+    t_ProfilerThreadExit.pSlot->Name = name;
+}
+
+// Appends the zones written since the last collect, and returns how many were lost.
+static uint64_t ProfilerDrain(ProfilerThreadSlot* pSlot, std::deque<ProfilerEvent>* pEvents)
+{
+    const ProfilerThreadBuffer* pBuffer = pSlot->pBuffer.get();
+    uint64_t numDropped = 0;
+
+    uint64_t head = pBuffer->Head.load(std::memory_order_acquire);
+    uint64_t tail = pSlot->Tail;
+    if (head - tail > kProfilerBufferCapacity)
+    {
+        numDropped += head - tail - kProfilerBufferCapacity;
+        tail = head - kProfilerBufferCapacity;
+    }
+
+    size_t firstNewEvent = pEvents->size();
+    for (uint64_t i = tail; i < head; i++)
+    {
+        pEvents->push_back(pBuffer->Events[i & (kProfilerBufferCapacity - 1)]);
+    }
+
+    // The owner kept writing while the zones were copied. Writing zone i overwrites zone i - capacity,
+    // so every zone up to and including newHead - capacity may have been torn.
+    std::atomic_thread_fence(std::memory_order_acquire);
+    uint64_t newHead = pBuffer->Head.load(std::memory_order_relaxed);
+    if (newHead + 1 > tail + kProfilerBufferCapacity)
+    {
+        uint64_t numTorn = std::min(newHead + 1 - kProfilerBufferCapacity - tail, head - tail);
+        pEvents->erase(pEvents->begin() + firstNewEvent, pEvents->begin() + firstNewEvent + (size_t)numTorn);
+        numDropped += numTorn;
+    }
+
+    pSlot->Tail = head;
+    return numDropped;
+}
+
+void ProfilerCollect(double historySeconds)
+{
+    std::lock_guard<std::mutex> lock(g_Profiler.Mutex);
+
+    g_Profiler.Histories.resize(g_Profiler.Slots.size());
+
+    for (size_t slotIndex = 0; slotIndex < g_Profiler.Slots.size(); slotIndex++)
+    {
+        ProfilerThreadSlot* pSlot = g_Profiler.Slots[slotIndex].get();
+        ProfilerThreadHistory& history = g_Profiler.Histories[slotIndex];
+
+        if (!pSlot->InUse)
+            continue;
+
+        // read before draining, so that an exited thread's last zones are in the drain
+        bool exited = pSlot->Exited.load(std::memory_order_acquire);
+
+        history.Name = pSlot->Name;
+        g_Profiler.NumDroppedEvents += ProfilerDrain(pSlot, &history.Events);
+
+        if (exited)
+            pSlot->InUse = false;
+    }
+
+    uint64_t nowTicks = ProfilerGetTicks();
+    uint64_t historyTicks = (uint64_t)(historySeconds * ProfilerGetTicksPerSecond());
+    uint64_t oldestTicks = nowTicks > historyTicks ? nowTicks - historyTicks : 0;
+    for (ProfilerThreadHistory& history : g_Profiler.Histories)
+    {
+        while (!history.Events.empty() && history.Events.front().EndTicks < oldestTicks)
+        {
+            history.Events.pop_front();
+        }
+    }
+}
+
+int ProfilerGetNumThreads()
+{
+    return (int)g_Profiler.Histories.size();
+}
+
+const char* ProfilerGetThreadName(int threadIndex)
+{
+    return g_Profiler.Histories[threadIndex].Name.c_str();
+}
+
+const std::deque<ProfilerEvent>& ProfilerGetThreadEvents(int threadIndex)
+{
+    return g_Profiler.Histories[threadIndex].Events;
+}
+
+uint64_t ProfilerGetNumDroppedEvents()
+{
+    return g_Profiler.NumDroppedEvents;
+}
+
+static void ProfilerWriteJSONString(std::ostream& stream, const char* s)
+{
+    stream << '"';
+    for (; *s; s++)
+    {
+        if (*s == '"' || *s == '\\')
+        {
+            stream << '\\' << *s;
+        }
+        else if ((unsigned char)*s < 0x20)
+        {
+            char escaped[8];
+            snprintf(escaped, sizeof(escaped), "\\u%04x", *s);
+            stream << escaped;
+        }
+        else
+        {
+            stream << *s;
+        }
+    }
+    stream << '"';
+}
+
+bool ProfilerExportChromeTrace(const char* path)
+{
+    std::ofstream file(path, std::ios::trunc);
+    if (!file)
+        return false;
+
+    double microsecondsPerTick = 1e6 / ProfilerGetTicksPerSecond();
+
+    file << "{\"traceEvents\":[\n";
+
+    for (size_t threadIndex = 0; threadIndex < g_Profiler.Histories.size(); threadIndex++)
+    {
+        const ProfilerThreadHistory& history = g_Profiler.Histories[threadIndex];
+
+        file << (threadIndex == 0 ? "" : ",\n") << "{\"ph\":\"M\",\"name\":\"thread_name\",\"pid\":1,\"tid\":" << threadIndex << ",\"args\":{\"name\":";
+        ProfilerWriteJSONString(file, history.Name.c_str());
+        file << "}}";
+
+        for (const ProfilerEvent& event : history.Events)
+        {
+            char times[64];
+            snprintf(times, sizeof(times), "\"ts\":%.3f,\"dur\":%.3f",
+                (event.BeginTicks - g_Profiler.InitTicks) * microsecondsPerTick,
+                (event.EndTicks - event.BeginTicks) * microsecondsPerTick);
+
+            file << ",\n{\"ph\":\"X\",\"name\":";
+            ProfilerWriteJSONString(file, event.Name);
+            file << ",\"pid\":1,\"tid\":" << threadIndex << "," << times << "}";
+        }
+    }
+
+    file << "\n]}\n";
+
+    return (bool)file.flush();
+}
+
+double ProfilerMeasureZoneOverheadNanoseconds(int numZones)
+{
+    // the zones go to a buffer that the collector doesn't know about
+    std::unique_ptr<ProfilerThreadBuffer> pScratchBuffer(new ProfilerThreadBuffer());
+    ProfilerThreadBuffer* pThreadBuffer = t_pProfilerBuffer;
+    t_pProfilerBuffer = pScratchBuffer.get();
+
+    std::chrono::steady_clock::time_point start = std::chrono::steady_clock::now();
+    for (int i = 0; i < numZones; i++)
+    {
+        PROFILE_ZONE("Overhead");
+    }
+    std::chrono::steady_clock::time_point end = std::chrono::steady_clock::now();
+
+    t_pProfilerBuffer = pThreadBuffer;
+
+    return std::chrono::duration<double, std::nano>(end - start).count() / numZones;
+}
\ No newline at end of file
@@ -0,0 +1,120 @@
+#pragma once
+
+#include <atomic>
+#include <deque>
+#include <cstdint>
+
+#ifdef _MSC_VER
+#include <intrin.h>
+#else
+#include <x86intrin.h>
+#endif
+
+// Scoped CPU zones for profiling, with a timeline of the last few seconds that can be exported to Chrome's trace viewer.
+// Each thread writes its zones into its own ring buffer without locks, and ProfilerCollect merges them
+// from a single thread (normally once per frame). If a thread laps the collector, its oldest zones are dropped and counted.
+// Timestamps are raw TSC ticks, and zone names must be string literals or otherwise outlive the profiler.
+// Nothing here depends on Windows.
+
+static const int kProfilerBufferCapacity = 1 << 14; // zones per thread, a power of two
+
+struct ProfilerEvent
+{
+    const char* Name;
+    uint64_t BeginTicks;
+    uint64_t EndTicks;
+    uint32_t Depth; // how many zones enclose it on its thread
+};
+
+struct ProfilerThreadBuffer
+{
+    std::atomic<uint64_t> Head; // the number of zones ever written, only written by the owning thread
+    uint32_t Depth;
+    ProfilerEvent Events[kProfilerBufferCapacity];
+};
+
+extern thread_local ProfilerThreadBuffer* t_pProfilerBuffer;
+
+// Registers the calling thread, reusing the buffer of a thread that exited if there is one.
+ProfilerThreadBuffer* ProfilerRegisterThread();
+
+inline uint64_t ProfilerGetTicks()
+{
+    return __rdtsc();
+}
+
+inline ProfilerThreadBuffer* ProfilerGetThreadBuffer()
+{
+    ProfilerThreadBuffer* pBuffer = t_pProfilerBuffer;
+    return pBuffer ? pBuffer : ProfilerRegisterThread();
+}
+
+class ProfilerZone
+{
+public:
+    explicit ProfilerZone(const char* name)
+    {
+        m_pBuffer = ProfilerGetThreadBuffer();
+        m_pName = name;
+        m_Depth = m_pBuffer->Depth++;
+        m_BeginTicks = ProfilerGetTicks();
+    }
+
+    ~ProfilerZone()
+    {
+        uint64_t endTicks = ProfilerGetTicks();
+        m_pBuffer->Depth = m_Depth;
+
+        uint64_t head = m_pBuffer->Head.load(std::memory_order_relaxed);
+        ProfilerEvent& event = m_pBuffer->Events[head & (kProfilerBufferCapacity - 1)];
+        event.Name = m_pName;
+        event.BeginTicks = m_BeginTicks;
+        event.EndTicks = endTicks;
+        event.Depth = m_Depth;
+        m_pBuffer->Head.store(head + 1, std::memory_order_release);
+    }
+
+    ProfilerZone(const ProfilerZone&) = delete;
+    ProfilerZone& operator=(const ProfilerZone&) = delete;
+
+private:
+    ProfilerThreadBuffer* m_pBuffer;
+    const char* m_pName;
+    uint64_t m_BeginTicks;
+    uint32_t m_Depth;
+};
+
+#define PROFILER_CONCAT_(a, b) a##b
+#define PROFILER_CONCAT(a, b) PROFILER_CONCAT_(a, b)
+
+// Times the rest of the enclosing scope.
+#define PROFILE_ZONE(name) ProfilerZone PROFILER_CONCAT(profilerZone, __LINE__)(name)
+
+// Records the tick rate against the system clock. Call once at startup, before any zone.
+void ProfilerInit();
+
+// Gets more accurate the longer the program runs, since it compares against the time of ProfilerInit.
+double ProfilerGetTicksPerSecond();
+
+// Names the calling thread in the timeline. The name is copied.
+void ProfilerSetThreadName(const char* name);
+
+// Merges the zones written since the last collect into the history, and forgets zones older than historySeconds.
+void ProfilerCollect(double historySeconds = 2.0);
+
+// Threads that exited leave their index to the next thread that registers.
+int ProfilerGetNumThreads();
+const char* ProfilerGetThreadName(int threadIndex);
+
+// The collected zones of a thread, ordered by end time.
+const std::deque<ProfilerEvent>& ProfilerGetThreadEvents(int threadIndex);
+
+// Zones overwritten before they could be collected.
+uint64_t ProfilerGetNumDroppedEvents();
+
+// Writes the collected zones in the Chrome trace event format, for chrome://tracing or ui.perfetto.dev.
+// Returns false if the file couldn't be written.
+bool ProfilerExportChromeTrace(const char* path);
+
+// Times numZones empty zones on the calling thread, without them reaching the history.
+double ProfilerMeasureZoneOverheadNanoseconds(int numZones);
\ No newline at end of file
@@ -4,6 +4,14 @@
 #include "apputil.h"
 
 #include "scene.h"
+#include "shadercache.h"
+#include "filewatcher.h"
+#include "shadercompilequeue.h"
+#include "profiler.h"
+#include "renderstats.h"
+#include "telemetry.h"
+#include "retainedgui.h"
+#include "fontcache.h"
 
 #include "imgui.h"
 #include "imgui_impl_dx11.h"
@@ -11,22 +19,51 @@
 #include <d3dcompiler.h>
 
 #include <vector>
+#include <mutex>
+#include <algorithm>
 
 static const D3D_FEATURE_LEVEL kMinFeatureLevel = D3D_FEATURE_LEVEL_11_0;
 static const int kSwapChainBufferCount = 3;
 static const DXGI_FORMAT kSwapChainFormat = DXGI_FORMAT_B8G8R8A8_UNORM;
 static const DXGI_FORMAT kSwapChainRTVFormat = DXGI_FORMAT_B8G8R8A8_UNORM_SRGB;
 static const UINT kSwapChainFlags = DXGI_SWAP_CHAIN_FLAG_FRAME_LATENCY_WAITABLE_OBJECT;
+static const char* kShaderCachePath = "shadercache.bin";
+static const char* kFontCachePath = "fontcache.bin";
+static const char* kProfilerTracePath = "trace.json";
+static const int kNumZoneOverheadSamples = 1000000;
+static const float kProfilerWindowWidth = 800.0f;
+static const float kProfilerWindowHeight = 250.0f;
+static const float kProfilerLabelWidth = 120.0f;
+static const char* kRenderStatsCSVPath = "stats.csv";
+static const char* kRenderStatsJSONPath = "stats.json";
+static const float kStatsWindowY = 300.0f;
+static const float kMemoryWindowY = 560.0f;
+static const double kTelemetryIntervalSeconds = 0.5;
+static const char* kTelemetryLogPath = "telemetry.csv";
+
+// Made on a compile worker, and swapped into a Shader by the render thread.
+struct CompiledShader
+{
+    ComPtr<ID3DBlob> Blob;
+    ComPtr<ID3D11DeviceChild> ShaderComPtr;
+
+    ID3D11VertexShader* VS;
+    ID3D11PixelShader* PS;
+    ID3D11GeometryShader* GS;
+    ID3D11HullShader* HS;
+    ID3D11DomainShader* DS;
+    ID3D11ComputeShader* CS;
+};
 
 struct ReloadableShader
 {
     std::string Path;
     std::string EntryPoint;
     std::string Target;
-    uint64_t Timestamp;
+    std::vector<ShaderDefine> Defines;
 
-    ComPtr<ID3DBlob> Blob;
-    ComPtr<ID3D11DeviceChild> ShaderComPtr;
+    // keeps the objects that pShader points to alive
+    std::shared_ptr<CompiledShader> Compiled;
 
     Shader* pShader;
 };
@@ -44,11 +81,26 @@ struct Renderer
     HANDLE hFrameLatencyWaitableObject;
     D3D11_RENDER_TARGET_VIEW_DESC BackBufferRTVDesc;
 
+    // what doesn't change is queried once, and the rest is sampled in the background
+    DXGI_ADAPTER_DESC AdapterDesc;
+    std::string AdapterDescription;
+    Telemetry* pTelemetry;
+
     std::vector<Shader*> Shaders;
-    std::vector<ReloadableShader> ShaderReloaders;
+    std::vector<ReloadableShader> ShaderReloaders; // indexed by their file watcher and compile queue entry
+    ShaderCache ShaderCache; // shared with the compile workers, under g_ShaderCacheMutex
+    ShaderCompileQueue* pShaderCompileQueue;
+    FileWatcher* pShaderWatcher;
+    float ShaderWatchMilliseconds;
+
+    // the last complete frame, shown in the profiler's timeline
+    uint64_t ProfiledFrameBeginTicks;
+    uint64_t ProfiledFrameEndTicks;
+    float ZoneOverheadNanoseconds;
 };
 
 Renderer g_Renderer;
+std::mutex g_ShaderCacheMutex;
 
 void RendererInit(void* pNativeWindowHandle)
 {
@@ -121,17 +173,75 @@ void RendererInit(void* pNativeWindowHandle)
     g_Renderer.hFrameLatencyWaitableObject = hFrameLatencyWaitableObject;
     g_Renderer.IsInit = true;
 
+    // Budget resources to what the OS lets this process use, or else to the adapter's memory
+    DXGI_ADAPTER_DESC adapterDesc;
+    CHECKHR(pDXGIAdapter->GetDesc(&adapterDesc));
+    ResourceMemorySetBudget(adapterDesc.DedicatedVideoMemory);
+
+    ComPtr<IDXGIAdapter3> pDXGIAdapter3;
+    DXGI_QUERY_VIDEO_MEMORY_INFO localMemoryInfo;
+    if (SUCCEEDED(pDXGIAdapter.As(&pDXGIAdapter3)) &&
+        SUCCEEDED(pDXGIAdapter3->QueryVideoMemoryInfo(0, DXGI_MEMORY_SEGMENT_GROUP_LOCAL, &localMemoryInfo)) &&
+        localMemoryInfo.Budget != 0)
+    {
+        ResourceMemorySetBudget(localMemoryInfo.Budget);
+    }
+
+    g_Renderer.AdapterDesc = adapterDesc;
+    g_Renderer.AdapterDescription = MultiByteFromWide(adapterDesc.Description);
+
+    // DXGI can be queried from the telemetry thread
+    g_Renderer.pTelemetry = TelemetryCreate(kTelemetryIntervalSeconds, [pDXGIAdapter3](TelemetrySnapshot* pSnapshot)
+    {
+        if (!pDXGIAdapter3)
+            return;
+
+        DXGI_QUERY_VIDEO_MEMORY_INFO vidmeminfo;
+        if (SUCCEEDED(pDXGIAdapter3->QueryVideoMemoryInfo(0, DXGI_MEMORY_SEGMENT_GROUP_LOCAL, &vidmeminfo)))
+        {
+            pSnapshot->AdapterLocalUsageBytes = vidmeminfo.CurrentUsage;
+            pSnapshot->AdapterLocalBudgetBytes = vidmeminfo.Budget;
+        }
+
+        if (SUCCEEDED(pDXGIAdapter3->QueryVideoMemoryInfo(0, DXGI_MEMORY_SEGMENT_GROUP_NON_LOCAL, &vidmeminfo)))
+            pSnapshot->AdapterNonLocalUsageBytes = vidmeminfo.CurrentUsage;
+    });
+
+    // the GUI only uses the default font, whose baked atlas loads from the cache faster than rasterizing on demand.
+    // fonts with large glyph ranges would set RasterizeOnDemand instead.
+    FontCacheBuild(kFontCachePath, ImGui::GetIO().Fonts);
     ImGui_ImplDX11_Init(pNativeWindowHandle, pDevice.Get(), pDeviceContext.Get());
+    ShaderCacheOpen(kShaderCachePath, &g_Renderer.ShaderCache);
+    g_Renderer.pShaderWatcher = FileWatcherCreate();
+    g_Renderer.pShaderCompileQueue = ShaderCompileQueueCreate();
+    RenderStatsReset();
     SceneInit();
 }
 
 void RendererExit()
 {
+    SceneExit();
+
+    if (g_Renderer.pTelemetry)
+    {
+        TelemetryDestroy(g_Renderer.pTelemetry);
+    }
+
+    if (g_Renderer.pShaderCompileQueue)
+    {
+        ShaderCompileQueueDestroy(g_Renderer.pShaderCompileQueue);
+    }
+
     for (Shader* sh : g_Renderer.Shaders)
     {
         free(sh);
     }
 
+    if (g_Renderer.pShaderWatcher)
+    {
+        FileWatcherDestroy(g_Renderer.pShaderWatcher);
+    }
+
     ImGui_ImplDX11_Shutdown();
     g_Renderer = Renderer();
 }
@@ -141,37 +251,17 @@ bool RendererIsInit()
     return g_Renderer.IsInit;
 }
 
-static void RendererReloadShader(ReloadableShader* shader)
+// Runs on a compile worker. The device is free-threaded, so the shader object is created here too.
+static std::shared_ptr<CompiledShader> RendererCompileShader(
+    const std::string& path, const std::string& entryPoint, const std::string& target,
+    const std::vector<ShaderDefine>& defines)
 {
+    PROFILE_ZONE("RendererCompileShader");
+
     ID3D11Device* dev = g_Renderer.pDevice.Get();
 
-    std::string path = shader->Path;
     std::wstring wpath = WideFromMultiByte(path);
 
-    uint64_t newTimestamp = 0;
-
-    HANDLE hFile = CreateFileW(wpath.c_str(), GENERIC_READ, FILE_SHARE_READ | FILE_SHARE_WRITE, NULL, OPEN_EXISTING, FILE_ATTRIBUTE_NORMAL, NULL);
-    if (hFile != INVALID_HANDLE_VALUE)
-    {
-        FILETIME lastWriteTime;
-        if (GetFileTime(hFile, NULL, NULL, &lastWriteTime))
-        {
-            LARGE_INTEGER largeWriteTime;
-            largeWriteTime.HighPart = lastWriteTime.dwHighDateTime;
-            largeWriteTime.LowPart = lastWriteTime.dwLowDateTime;
-            newTimestamp = largeWriteTime.QuadPart;
-        }
-
-        CloseHandle(hFile);
-    }
-
-    if (newTimestamp == 0 || (shader->Timestamp != 0 && shader->Timestamp >= newTimestamp))
-    {
-        return;
-    }
-
-    shader->Timestamp = newTimestamp;
-
     UINT flags = 0;
 #if _DEBUG
     flags |= D3DCOMPILE_DEBUG;
@@ -179,103 +269,168 @@ static void RendererReloadShader(ReloadableShader* shader)
     flags |= D3DCOMPILE_OPTIMIZATION_LEVEL3;
 #endif
 
-    ComPtr<ID3DBlob> pCode;
-    ComPtr<ID3DBlob> pErrorMsgs;
-    HRESULT hr = D3DCompileFromFile(wpath.c_str(), NULL, D3D_COMPILE_STANDARD_FILE_INCLUDE, shader->EntryPoint.c_str(), shader->Target.c_str(), flags, 0, &pCode, &pErrorMsgs);
-    if (FAILED(hr))
-    {
-        std::string hrs = MultiByteFromHR(hr);
-        fprintf(stderr,
-            "Error (%s):\n%s%s%s\n",
-            path.c_str(),
-            hrs.c_str(),
-            pErrorMsgs ? "\n" : "",
-            pErrorMsgs ? (const char*)pErrorMsgs->GetBufferPointer() : "");
+    ShaderCacheKeyDesc cacheKeyDesc;
+    cacheKeyDesc.Path = path;
+    cacheKeyDesc.EntryPoint = entryPoint;
+    cacheKeyDesc.Target = target;
+    cacheKeyDesc.Defines = defines;
+    cacheKeyDesc.Flags = flags;
+    uint64_t cacheKey = ShaderCacheComputeKey(cacheKeyDesc, ShaderCacheReadFile);
 
-        return;
-    }
+    ComPtr<ID3DBlob> pCode;
 
-    if (pErrorMsgs)
     {
-        printf("Warning (%s): %s\n", path.c_str(), (char*)pErrorMsgs->GetBufferPointer());
+        std::lock_guard<std::mutex> lock(g_ShaderCacheMutex);
+        const std::vector<uint8_t>* pCachedCode = ShaderCacheFind(&g_Renderer.ShaderCache, cacheKey);
+        if (pCachedCode)
+        {
+            CHECKHR(D3DCreateBlob(pCachedCode->size(), &pCode));
+            memcpy(pCode->GetBufferPointer(), pCachedCode->data(), pCachedCode->size());
+        }
     }
-    else
+
+    if (!pCode)
     {
-        printf("%s compiled clean\n", path.c_str());
+        std::vector<D3D_SHADER_MACRO> macros;
+        for (const ShaderDefine& define : defines)
+        {
+            D3D_SHADER_MACRO macro = { define.Name.c_str(), define.Value.c_str() };
+            macros.push_back(macro);
+        }
+        D3D_SHADER_MACRO endMacro = { NULL, NULL };
+        macros.push_back(endMacro);
+
+        ComPtr<ID3DBlob> pErrorMsgs;
+        HRESULT hr = D3DCompileFromFile(wpath.c_str(), macros.data(), D3D_COMPILE_STANDARD_FILE_INCLUDE, entryPoint.c_str(), target.c_str(), flags, 0, &pCode, &pErrorMsgs);
+        if (FAILED(hr))
+        {
+            std::string hrs = MultiByteFromHR(hr);
+            fprintf(stderr,
+                "Error (%s):\n%s%s%s\n",
+                path.c_str(),
+                hrs.c_str(),
+                pErrorMsgs ? "\n" : "",
+                pErrorMsgs ? (const char*)pErrorMsgs->GetBufferPointer() : "");
+
+            return NULL;
+        }
+
+        if (pErrorMsgs)
+        {
+            printf("Warning (%s): %s\n", path.c_str(), (char*)pErrorMsgs->GetBufferPointer());
+        }
+        else
+        {
+            printf("%s compiled clean\n", path.c_str());
+        }
+
+        std::lock_guard<std::mutex> lock(g_ShaderCacheMutex);
+        ShaderCacheInsert(&g_Renderer.ShaderCache, cacheKey, pCode->GetBufferPointer(), pCode->GetBufferSize());
     }
 
-    ComPtr<ID3D11DeviceChild> shaderComPtr;
-    ID3D11VertexShader* VS = 0;
-    ID3D11PixelShader* PS = 0;
-    ID3D11GeometryShader* GS = 0;
-    ID3D11HullShader* HS = 0;
-    ID3D11DomainShader* DS = 0;
-    ID3D11ComputeShader* CS = 0;
+    std::shared_ptr<CompiledShader> compiled = std::make_shared<CompiledShader>();
+    compiled->Blob = pCode;
+    compiled->VS = 0;
+    compiled->PS = 0;
+    compiled->GS = 0;
+    compiled->HS = 0;
+    compiled->DS = 0;
+    compiled->CS = 0;
 
-    std::string target2 = std::string(shader->Target).substr(0, 2);
+    std::string target2 = target.substr(0, 2);
     if (target2 == "vs")
     {
         ComPtr<ID3D11VertexShader> vs;
         CHECKHR(dev->CreateVertexShader(pCode->GetBufferPointer(), pCode->GetBufferSize(), NULL, &vs));
-        shaderComPtr = vs;
-        VS = vs.Get();
+        compiled->ShaderComPtr = vs;
+        compiled->VS = vs.Get();
     }
     else if (target2 == "ps")
     {
         ComPtr<ID3D11PixelShader> ps;
         CHECKHR(dev->CreatePixelShader(pCode->GetBufferPointer(), pCode->GetBufferSize(), NULL, &ps));
-        shaderComPtr = ps;
-        PS = ps.Get();
+        compiled->ShaderComPtr = ps;
+        compiled->PS = ps.Get();
     }
     else if (target2 == "gs")
     {
         ComPtr<ID3D11GeometryShader> gs;
         CHECKHR(dev->CreateGeometryShader(pCode->GetBufferPointer(), pCode->GetBufferSize(), NULL, &gs));
-        shaderComPtr = gs;
-        GS = gs.Get();
+        compiled->ShaderComPtr = gs;
+        compiled->GS = gs.Get();
     }
     else if (target2 == "hs")
     {
         ComPtr<ID3D11HullShader> hs;
         CHECKHR(dev->CreateHullShader(pCode->GetBufferPointer(), pCode->GetBufferSize(), NULL, &hs));
-        shaderComPtr = hs;
-        HS = hs.Get();
+        compiled->ShaderComPtr = hs;
+        compiled->HS = hs.Get();
     }
     else if (target2 == "ds")
     {
         ComPtr<ID3D11DomainShader> ds;
         CHECKHR(dev->CreateDomainShader(pCode->GetBufferPointer(), pCode->GetBufferSize(), NULL, &ds));
-        shaderComPtr = ds;
-        DS = ds.Get();
+        compiled->ShaderComPtr = ds;
+        compiled->DS = ds.Get();
     }
     else if (target2 == "cs")
     {
         ComPtr<ID3D11ComputeShader> cs;
         CHECKHR(dev->CreateComputeShader(pCode->GetBufferPointer(), pCode->GetBufferSize(), NULL, &cs));
-        shaderComPtr = cs;
-        CS = cs.Get();
+        compiled->ShaderComPtr = cs;
+        compiled->CS = cs.Get();
     }
     else
     {
-        SimpleMessageBox_FatalError("Unhandled shader target: %s\n", shader->Target.c_str());
+        SimpleMessageBox_FatalError("Unhandled shader target: %s\n", target.c_str());
     }
 
-    (ID3DBlob*&)shader->pShader->Blob = pCode.Get();
-    (ID3D11VertexShader*&)shader->pShader->VS = VS;
-    (ID3D11PixelShader*&)shader->pShader->PS = PS;
-    (ID3D11GeometryShader*&)shader->pShader->GS = GS;
-    (ID3D11HullShader*&)shader->pShader->HS = HS;
-    (ID3D11DomainShader*&)shader->pShader->DS = DS;
-    (ID3D11ComputeShader*&)shader->pShader->CS = CS;
+    return compiled;
+}
 
-    shader->Blob = pCode;
-    shader->ShaderComPtr = shaderComPtr;
+static void RendererSubmitShaderCompile(int shaderIndex)
+{
+    const ReloadableShader& shader = g_Renderer.ShaderReloaders[shaderIndex];
+
+    // the worker gets its own copies, since ShaderReloaders can grow while it runs
+    std::string path = shader.Path;
+    std::string entryPoint = shader.EntryPoint;
+    std::string target = shader.Target;
+    std::vector<ShaderDefine> defines = shader.Defines;
+
+    ShaderCompileQueueSubmit(g_Renderer.pShaderCompileQueue, shaderIndex, [path, entryPoint, target, defines]
+    {
+        return std::static_pointer_cast<void>(RendererCompileShader(path, entryPoint, target, defines));
+    });
 }
 
-Shader* RendererAddShader(const char* file, const char* entry, const char* target)
+// Swaps finished compiles into their Shader. Only called between frames,
+// so every draw of a frame sees all of a shader's pointers from the same compile.
+static void RendererPublishCompiledShaders()
 {
-    ID3D11Device* dev = g_Renderer.pDevice.Get();
+    std::vector<ShaderCompileResult> results;
+    ShaderCompileQueueCollect(g_Renderer.pShaderCompileQueue, &results);
+
+    for (const ShaderCompileResult& result : results)
+    {
+        ReloadableShader& shader = g_Renderer.ShaderReloaders[result.Entry];
+        std::shared_ptr<CompiledShader> compiled = std::static_pointer_cast<CompiledShader>(result.Shader);
+
+        (ID3DBlob*&)shader.pShader->Blob = compiled->Blob.Get();
+        (ID3D11VertexShader*&)shader.pShader->VS = compiled->VS;
+        (ID3D11PixelShader*&)shader.pShader->PS = compiled->PS;
+        (ID3D11GeometryShader*&)shader.pShader->GS = compiled->GS;
+        (ID3D11HullShader*&)shader.pShader->HS = compiled->HS;
+        (ID3D11DomainShader*&)shader.pShader->DS = compiled->DS;
+        (ID3D11ComputeShader*&)shader.pShader->CS = compiled->CS;
+
+        // releases the previous objects, which the device context still holds on to if they are bound
+        shader.Compiled = compiled;
+    }
+}
 
+Shader* RendererAddShader(const char* file, const char* entry, const char* target, const std::vector<ShaderDefine>& defines)
+{
     std::string path = std::string("shaders/") + file;
 
     Shader* sh = (Shader*)calloc(1, sizeof(Shader));
@@ -284,17 +439,84 @@ Shader* RendererAddShader(const char* file, const char* entry, const char* targe
     rs.Path = path;
     rs.EntryPoint = entry;
     rs.Target = target;
-    rs.Timestamp = 0;
+    rs.Defines = defines;
     rs.pShader = sh;
 
-    RendererReloadShader(&rs);
+    // watch entries are added in the same order as ShaderReloaders
+    FileWatcherAddEntry(g_Renderer.pShaderWatcher, path);
 
     g_Renderer.Shaders.push_back(sh);
     g_Renderer.ShaderReloaders.push_back(std::move(rs));
 
+    RendererSubmitShaderCompile((int)g_Renderer.ShaderReloaders.size() - 1);
+
     return sh;
 }
 
+void RendererWaitForShaders()
+{
+    ShaderCompileQueueWaitIdle(g_Renderer.pShaderCompileQueue);
+    RendererPublishCompiledShaders();
+}
+
+static void RendererTrackMemory(const void* pResource, ResourceCategory category, uint64_t bytes)
+{
+    if (ResourceMemoryTrack(pResource, category, bytes))
+    {
+        fprintf(stderr, "Resource memory budget exceeded: %llu MB of %llu MB\n",
+            (unsigned long long)(ResourceMemoryGetTotalLiveBytes() / 1024 / 1024),
+            (unsigned long long)(ResourceMemoryGetBudget() / 1024 / 1024));
+    }
+}
+
+// Formats without block info are still tracked, but reported, since their bytes are missing from the totals.
+static void RendererTrackTexture(
+    const void* pResource, ResourceCategory category, DXGI_FORMAT format,
+    int width, int height, int depth,
+    int mipLevels, int arraySize, int sampleCount)
+{
+    int blockSize, bytesPerBlock;
+    if (!DXGIFormatGetBlockInfo(format, &blockSize, &bytesPerBlock))
+    {
+        fprintf(stderr, "Resource memory: no block info for DXGI format %d, one of the %s is counted as 0 bytes\n",
+            (int)format, ResourceMemoryGetCategoryName(category));
+        ResourceMemoryTrackUnknownSize(pResource, category);
+        return;
+    }
+
+    uint64_t bytes = ResourceMemoryGetTextureSize(blockSize, bytesPerBlock, width, height, depth, mipLevels, arraySize);
+    RendererTrackMemory(pResource, category, bytes * sampleCount);
+}
+
+void RendererTrackResource(ID3D11Texture2D* pTexture, ResourceCategory category)
+{
+    D3D11_TEXTURE2D_DESC desc;
+    pTexture->GetDesc(&desc);
+
+    RendererTrackTexture(pTexture, category, desc.Format, desc.Width, desc.Height, 1, desc.MipLevels, desc.ArraySize, desc.SampleDesc.Count);
+}
+
+void RendererTrackResource(ID3D11Texture3D* pTexture, ResourceCategory category)
+{
+    D3D11_TEXTURE3D_DESC desc;
+    pTexture->GetDesc(&desc);
+
+    RendererTrackTexture(pTexture, category, desc.Format, desc.Width, desc.Height, desc.Depth, desc.MipLevels, 1, 1);
+}
+
+void RendererTrackResource(ID3D11Buffer* pBuffer, ResourceCategory category)
+{
+    D3D11_BUFFER_DESC desc;
+    pBuffer->GetDesc(&desc);
+
+    RendererTrackMemory(pBuffer, category, desc.ByteWidth);
+}
+
+void RendererUntrackResource(ID3D11Resource* pResource)
+{
+    ResourceMemoryUntrack(pResource);
+}
+
 void RendererResize(
     int windowWidth, int windowHeight,
     int renderWidth, int renderHeight)
@@ -307,6 +529,8 @@ void RendererResize(
         renderWidth, renderHeight,
         kSwapChainFormat, kSwapChainFlags));
 
+    RendererTrackTexture(sc, RESOURCE_CATEGORY_RENDER_TARGET, kSwapChainFormat, renderWidth, renderHeight, 1, 1, kSwapChainBufferCount, 1);
+
     pBackBufferRTVDesc->Format = kSwapChainRTVFormat;
     pBackBufferRTVDesc->ViewDimension = D3D11_RTV_DIMENSION_TEXTURE2D;
 
@@ -316,55 +540,222 @@ void RendererResize(
 static void RendererShowSystemInfoGUI()
 {
     ImGui::SetNextWindowPos(ImVec2(0, 0), ImGuiSetCond_Always);
-    if (ImGui::Begin("Info", NULL, ImGuiWindowFlags_NoMove | ImGuiWindowFlags_NoResize))
+    // sized to fit, since the sampled text changes width
+    if (ImGui::Begin("Info", NULL, ImGuiWindowFlags_NoMove | ImGuiWindowFlags_NoResize | ImGuiWindowFlags_AlwaysAutoResize))
     {
-        char cpuBrandString[0x40];
-        memset(cpuBrandString, 0, sizeof(cpuBrandString));
+        const TelemetrySnapshot* pSnapshot = TelemetryGetSnapshot(g_Renderer.pTelemetry);
 
-        int cpuInfo[4] = { -1 };
-        __cpuid(cpuInfo, 0x80000002);
-        memcpy(cpuBrandString, cpuInfo, sizeof(cpuInfo));
-        __cpuid(cpuInfo, 0x80000003);
-        memcpy(cpuBrandString + 16, cpuInfo, sizeof(cpuInfo));
-        __cpuid(cpuInfo, 0x80000004);
-        memcpy(cpuBrandString + 32, cpuInfo, sizeof(cpuInfo));
+        // only changes when a new snapshot comes in, and the rest of it never does
+        if (RetainedGUIBegin("system", RetainedGUIHash(pSnapshot, sizeof(*pSnapshot))))
+        {
+            ImGui::Text("CPU: %s (%d threads)", pSnapshot->CPUBrand, pSnapshot->NumLogicalCPUs);
+            ImGui::Text("Process: %.0f%% CPU, %llu MB resident", pSnapshot->ProcessCPUPercent, (unsigned long long)(pSnapshot->ProcessResidentBytes / 1024 / 1024));
+            ImGui::Text("%.1f FPS (%.2f ms)", pSnapshot->FramesPerSecond, pSnapshot->AverageFrameMilliseconds);
 
-        ImGui::Text("CPU: %s", cpuBrandString);
+            const DXGI_ADAPTER_DESC& adapterDesc = g_Renderer.AdapterDesc;
+            ImGui::Text("Adapter: %s", g_Renderer.AdapterDescription.c_str());
 
-        DXGI_ADAPTER_DESC adapterDesc;
-        if (SUCCEEDED(g_Renderer.pDXGIAdapter->GetDesc(&adapterDesc)))
-        {
-            std::string description = MultiByteFromWide(adapterDesc.Description);
-            ImGui::Text("Adapter: %s", description.c_str());
-            
             if (adapterDesc.DedicatedVideoMemory != 0)
                 ImGui::Text("Total video memory: %d MB", adapterDesc.DedicatedVideoMemory / 1024 / 1024);
-            
+
             if (adapterDesc.DedicatedSystemMemory != 0)
                 ImGui::Text("Total system memory: %d MB", adapterDesc.DedicatedSystemMemory / 1024 / 1024);
 
-            ComPtr<IDXGIAdapter3> adapter3;
-            if (SUCCEEDED(g_Renderer.pDXGIAdapter.As(&adapter3)))
+            if (pSnapshot->AdapterLocalUsageBytes != 0)
+                ImGui::Text("Local memory usage: %llu MB", (unsigned long long)(pSnapshot->AdapterLocalUsageBytes / 1024 / 1024));
+
+            if (pSnapshot->AdapterNonLocalUsageBytes != 0)
+                ImGui::Text("Non-local memory usage: %llu MB", (unsigned long long)(pSnapshot->AdapterNonLocalUsageBytes / 1024 / 1024));
+
+            D3D_FEATURE_LEVEL featureLevel = g_Renderer.pDevice->GetFeatureLevel();
+            ImGui::Text("Feature level %d.%d", (featureLevel >> 12) & 0x0F, (featureLevel >> 8) & 0x0F);
+        }
+        RetainedGUIEnd();
+
+        ImGui::Text("Shader file watch: %.3f ms", g_Renderer.ShaderWatchMilliseconds);
+        ImGui::Text("Shader compiles pending: %d", ShaderCompileQueueGetNumPending(g_Renderer.pShaderCompileQueue));
+
+        float telemetryInterval = (float)TelemetryGetInterval(g_Renderer.pTelemetry);
+        if (ImGui::SliderFloat("Sample interval (s)", &telemetryInterval, 0.1f, 10.0f, "%.1f"))
+            TelemetrySetInterval(g_Renderer.pTelemetry, telemetryInterval);
+
+        bool logging = TelemetryIsLogging(g_Renderer.pTelemetry);
+        if (ImGui::Checkbox("Log telemetry", &logging))
+        {
+            if (!TelemetrySetLogPath(g_Renderer.pTelemetry, logging ? kTelemetryLogPath : NULL))
+                fprintf(stderr, "Failed to open %s\n", kTelemetryLogPath);
+        }
+
+        bool retainedGUI = RetainedGUIIsEnabled();
+        if (ImGui::Checkbox("Retained GUI", &retainedGUI))
+            RetainedGUISetEnabled(retainedGUI);
+    }
+    ImGui::End();
+}
+
+static void RendererShowStatsGUI()
+{
+    ImGui::SetNextWindowPos(ImVec2(0, kStatsWindowY), ImGuiSetCond_FirstUseEver);
+    if (ImGui::Begin("Stats", NULL, ImGuiWindowFlags_AlwaysAutoResize))
+    {
+        ImGui::Text("Frame time over %d frames: avg %.2f ms", RenderStatsGetNumFrames(), RenderStatsGetAverageFrameMilliseconds());
+        ImGui::Text("p50 %.2f ms, p95 %.2f ms, p99 %.2f ms",
+            RenderStatsGetFrameMillisecondsPercentile(50.0f),
+            RenderStatsGetFrameMillisecondsPercentile(95.0f),
+            RenderStatsGetFrameMillisecondsPercentile(99.0f));
+
+        ImGui::Separator();
+        ImGui::Text("%-24s %12s %12s", "Counter", "Last frame", "Average");
+        for (int counter = 0; counter < kNumRenderCounters; counter++)
+        {
+            ImGui::Text("%-24s %12llu %12.1f",
+                RenderStatsGetCounterName((RenderCounter)counter),
+                (unsigned long long)RenderStatsGetLastFrameCounter((RenderCounter)counter),
+                RenderStatsGetAverageCounter((RenderCounter)counter));
+        }
+
+        if (ImGui::Button("Dump stats"))
+        {
+            if (RenderStatsWriteCSV(kRenderStatsCSVPath) && RenderStatsWriteJSON(kRenderStatsJSONPath))
+                printf("Wrote %s and %s\n", kRenderStatsCSVPath, kRenderStatsJSONPath);
+            else
+                fprintf(stderr, "Failed to write %s or %s\n", kRenderStatsCSVPath, kRenderStatsJSONPath);
+        }
+    }
+    ImGui::End();
+}
+
+static void RendererShowMemoryGUI()
+{
+    ImGui::SetNextWindowPos(ImVec2(0, kMemoryWindowY), ImGuiSetCond_FirstUseEver);
+    if (ImGui::Begin("Memory", NULL, ImGuiWindowFlags_AlwaysAutoResize))
+    {
+        ImGui::Text("%-16s %10s %10s %10s", "Category", "Resources", "Live", "Peak");
+        for (int category = 0; category < kNumResourceCategories; category++)
+        {
+            ImGui::Text("%-16s %10d %7.1f MB %7.1f MB",
+                ResourceMemoryGetCategoryName((ResourceCategory)category),
+                ResourceMemoryGetNumResources((ResourceCategory)category),
+                ResourceMemoryGetLiveBytes((ResourceCategory)category) / 1024.0 / 1024.0,
+                ResourceMemoryGetPeakBytes((ResourceCategory)category) / 1024.0 / 1024.0);
+        }
+        ImGui::Text("%-16s %10s %7.1f MB %7.1f MB", "Total", "",
+            ResourceMemoryGetTotalLiveBytes() / 1024.0 / 1024.0,
+            ResourceMemoryGetTotalPeakBytes() / 1024.0 / 1024.0);
+
+        int budgetMB = (int)(ResourceMemoryGetBudget() / 1024 / 1024);
+        if (ImGui::DragInt("Budget (MB)", &budgetMB, 16.0f, 0, INT_MAX))
+            ResourceMemorySetBudget((uint64_t)budgetMB * 1024 * 1024);
+
+        if (ResourceMemoryGetBudget() != 0 && ResourceMemoryGetTotalLiveBytes() > ResourceMemoryGetBudget())
+            ImGui::TextColored(ImVec4(1.0f, 0.3f, 0.3f, 1.0f), "Over budget by %.1f MB", (ResourceMemoryGetTotalLiveBytes() - ResourceMemoryGetBudget()) / 1024.0 / 1024.0);
+
+        if (ResourceMemoryGetNumUnknownSizeResources() != 0)
+            ImGui::TextColored(ImVec4(1.0f, 0.8f, 0.3f, 1.0f), "%d resources of unknown size not counted", ResourceMemoryGetNumUnknownSizeResources());
+    }
+    ImGui::End();
+}
+
+// Draws every thread's zones during the last complete frame, one row per nesting depth.
+static void RendererShowProfilerGUI()
+{
+    ImGuiIO& io = ImGui::GetIO();
+    ImGui::SetNextWindowPos(ImVec2(0, io.DisplaySize.y - kProfilerWindowHeight), ImGuiSetCond_FirstUseEver);
+    ImGui::SetNextWindowSize(ImVec2(kProfilerWindowWidth, kProfilerWindowHeight), ImGuiSetCond_FirstUseEver);
+    ImGui::SetNextWindowCollapsed(true, ImGuiSetCond_FirstUseEver);
+    if (ImGui::Begin("Profiler"))
+    {
+        if (ImGui::Button("Export trace"))
+        {
+            if (ProfilerExportChromeTrace(kProfilerTracePath))
+                printf("Wrote %s\n", kProfilerTracePath);
+            else
+                fprintf(stderr, "Failed to write %s\n", kProfilerTracePath);
+        }
+        ImGui::SameLine();
+        if (ImGui::Button("Measure zone overhead"))
+        {
+            g_Renderer.ZoneOverheadNanoseconds = (float)ProfilerMeasureZoneOverheadNanoseconds(kNumZoneOverheadSamples);
+        }
+        if (g_Renderer.ZoneOverheadNanoseconds != 0.0f)
+        {
+            ImGui::SameLine();
+            ImGui::Text("%.1f ns per zone", g_Renderer.ZoneOverheadNanoseconds);
+        }
+
+        uint64_t frameBeginTicks = g_Renderer.ProfiledFrameBeginTicks;
+        uint64_t frameEndTicks = g_Renderer.ProfiledFrameEndTicks;
+        float ticksPerMillisecond = (float)(ProfilerGetTicksPerSecond() / 1000.0);
+        ImGui::Text("Frame: %.2f ms, dropped zones: %llu",
+            (frameEndTicks - frameBeginTicks) / ticksPerMillisecond,
+            (unsigned long long)ProfilerGetNumDroppedEvents());
+
+        ImDrawList* pDrawList = ImGui::GetWindowDrawList();
+        float rowHeight = ImGui::GetTextLineHeight() + 2.0f;
+        float timelineWidth = ImGui::GetContentRegionAvailWidth() - kProfilerLabelWidth;
+        float pixelsPerTick = timelineWidth / (float)(frameEndTicks - frameBeginTicks);
+
+        for (int threadIndex = 0; threadIndex < ProfilerGetNumThreads() && frameEndTicks > frameBeginTicks; threadIndex++)
+        {
+            const std::deque<ProfilerEvent>& events = ProfilerGetThreadEvents(threadIndex);
+
+            // events are ordered by end, so the frame's events start at the first one ending inside it
+            auto firstEvent = std::lower_bound(events.begin(), events.end(), frameBeginTicks,
+                [](const ProfilerEvent& event, uint64_t ticks) { return event.EndTicks < ticks; });
+            if (firstEvent == events.end() || firstEvent->BeginTicks > frameEndTicks)
+                continue;
+
+            ImVec2 origin = ImGui::GetCursorScreenPos();
+            ImGui::Text("%s", ProfilerGetThreadName(threadIndex));
+
+            uint32_t maxDepth = 0;
+            for (auto event = firstEvent; event != events.end() && event->BeginTicks <= frameEndTicks; ++event)
             {
-                DXGI_QUERY_VIDEO_MEMORY_INFO vidmeminfo;
-                if (SUCCEEDED(adapter3->QueryVideoMemoryInfo(0, DXGI_MEMORY_SEGMENT_GROUP_LOCAL, &vidmeminfo)))
-                    if (vidmeminfo.CurrentUsage != 0)
-                        ImGui::Text("Local memory usage: %d MB", vidmeminfo.CurrentUsage / 1024 / 1024);
-
-                if (SUCCEEDED(adapter3->QueryVideoMemoryInfo(0, DXGI_MEMORY_SEGMENT_GROUP_NON_LOCAL, &vidmeminfo)))
-                    if (vidmeminfo.CurrentUsage != 0)
-                        ImGui::Text("Non-local memory usage: %d MB", vidmeminfo.CurrentUsage / 1024 / 1024);
+                maxDepth = std::max(maxDepth, event->Depth);
+
+                uint64_t beginTicks = std::max(event->BeginTicks, frameBeginTicks);
+                uint64_t endTicks = std::min(event->EndTicks, frameEndTicks);
+                ImVec2 min(origin.x + kProfilerLabelWidth + (beginTicks - frameBeginTicks) * pixelsPerTick, origin.y + event->Depth * rowHeight);
+                ImVec2 max(origin.x + kProfilerLabelWidth + (endTicks - frameBeginTicks) * pixelsPerTick + 1.0f, min.y + rowHeight - 1.0f);
+
+                // the same zone always gets the same color
+                float hue = (ShaderCacheHash(event->Name, strlen(event->Name)) % 64) / 64.0f;
+                float r, g, b;
+                ImGui::ColorConvertHSVtoRGB(hue, 0.6f, 0.7f, r, g, b);
+                pDrawList->AddRectFilled(min, max, ImGui::ColorConvertFloat4ToU32(ImVec4(r, g, b, 1.0f)));
+
+                pDrawList->PushClipRect(ImVec4(min.x, min.y, max.x, max.y));
+                pDrawList->AddText(ImVec2(min.x + 2.0f, min.y + 1.0f), 0xFFFFFFFF, event->Name);
+                pDrawList->PopClipRect();
+
+                if (ImGui::IsMouseHoveringRect(min, max))
+                {
+                    ImGui::SetTooltip("%s: %.3f ms", event->Name, (event->EndTicks - event->BeginTicks) / ticksPerMillisecond);
+                }
             }
-        }
 
-        D3D_FEATURE_LEVEL featureLevel = g_Renderer.pDevice->GetFeatureLevel();
-        ImGui::Text("Feature level %d.%d", (featureLevel >> 12) & 0x0F, (featureLevel >> 8) & 0x0F);
+            ImGui::SetCursorScreenPos(origin);
+            ImGui::Dummy(ImVec2(kProfilerLabelWidth + timelineWidth, (maxDepth + 1) * rowHeight));
+        }
     }
     ImGui::End();
 }
 
 void RendererPaint()
 {
+    uint64_t frameBeginTicks = ProfilerGetTicks();
+    PROFILE_ZONE("RendererPaint");
+
+    ProfilerCollect();
+
+    // The counters so far belong to the previous frame, which lasted until now
+    if (g_Renderer.ProfiledFrameBeginTicks != 0)
+    {
+        float frameMilliseconds = (float)((frameBeginTicks - g_Renderer.ProfiledFrameBeginTicks) * 1000.0 / ProfilerGetTicksPerSecond());
+        RenderStatsEndFrame(frameMilliseconds);
+        TelemetryAddFrame(g_Renderer.pTelemetry, frameMilliseconds);
+    }
+
     ID3D11Device* dev = g_Renderer.pDevice.Get();
     ID3D11DeviceContext* dc = g_Renderer.pDeviceContext.Get();
     IDXGISwapChain* sc = g_Renderer.pSwapChain.Get();
@@ -372,15 +763,47 @@ void RendererPaint()
     D3D11_RENDER_TARGET_VIEW_DESC* pBackBufferRTVDesc = &g_Renderer.BackBufferRTVDesc;
 
     // Wait until the previous frame is presented before drawing the next frame
-    CHECKWIN32(WaitForSingleObject(hFrameLatencyWaitableObject, INFINITE) == WAIT_OBJECT_0);
+    {
+        PROFILE_ZONE("Wait for swap chain");
+        CHECKWIN32(WaitForSingleObject(hFrameLatencyWaitableObject, INFINITE) == WAIT_OBJECT_0);
+    }
 
-    // Reload all shaders
-    for (ReloadableShader& shader : g_Renderer.ShaderReloaders)
+    // Reload the shaders affected by file changes
+    uint64_t watchStartTicks, watchEndTicks, ticksPerSecond;
+    QueryPerformanceFrequency((LARGE_INTEGER*)&ticksPerSecond);
+    QueryPerformanceCounter((LARGE_INTEGER*)&watchStartTicks);
+
+    std::vector<int> changedShaders;
+    {
+        PROFILE_ZONE("FileWatcherPoll");
+        FileWatcherPoll(g_Renderer.pShaderWatcher, &changedShaders);
+    }
+
+    QueryPerformanceCounter((LARGE_INTEGER*)&watchEndTicks);
+    g_Renderer.ShaderWatchMilliseconds = (watchEndTicks - watchStartTicks) * 1000.0f / ticksPerSecond;
+
+    // The frame keeps using the current shaders until their recompiles are done
+    for (int changedShader : changedShaders)
     {
-        RendererReloadShader(&shader);
+        RendererSubmitShaderCompile(changedShader);
+    }
+
+    RendererPublishCompiledShaders();
+
+    // Persist newly compiled shaders, including the ones compiled during init
+    {
+        std::lock_guard<std::mutex> lock(g_ShaderCacheMutex);
+        if (g_Renderer.ShaderCache.Dirty && !ShaderCacheSave(&g_Renderer.ShaderCache))
+        {
+            fprintf(stderr, "Failed to save shader cache: %s\n", kShaderCachePath);
+            g_Renderer.ShaderCache.Dirty = false;
+        }
     }
 
     RendererShowSystemInfoGUI();
+    RendererShowStatsGUI();
+    RendererShowMemoryGUI();
+    RendererShowProfilerGUI();
 
     // grab the current backbuffer
     ComPtr<ID3D11Texture2D> pBackBufferTex2D;
@@ -394,10 +817,19 @@ void RendererPaint()
     // Render ImGui
     ID3D11RenderTargetView* imguiRTVs[] = { pBackBufferRTV.Get() };
     dc->OMSetRenderTargets(_countof(imguiRTVs), imguiRTVs, NULL);
-    ImGui::Render();
+    {
+        PROFILE_ZONE("ImGui::Render");
+        ImGui::Render();
+    }
     dc->OMSetRenderTargets(0, NULL, NULL);
 
-    CHECKHR(sc->Present(0, 0));
+    {
+        PROFILE_ZONE("Present");
+        CHECKHR(sc->Present(0, 0));
+    }
+
+    g_Renderer.ProfiledFrameBeginTicks = frameBeginTicks;
+    g_Renderer.ProfiledFrameEndTicks = ProfilerGetTicks();
 }
 
 ID3D11Device* RendererGetDevice()
@@ -408,4 +840,4 @@ ID3D11Device* RendererGetDevice()
 ID3D11DeviceContext* RendererGetDeviceContext()
 {
     return g_Renderer.pDeviceContext.Get();
-}
+}
\ No newline at end of file
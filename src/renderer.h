@@ -1,5 +1,8 @@
 #pragma once
 
+#include "shadercache.h"
+#include "resourcememory.h"
+
 #include <d3d11.h>
 
 struct Shader
@@ -22,7 +25,15 @@ void RendererInit(void* pNativeWindowHandle);
 void RendererExit();
 bool RendererIsInit();
 
-Shader* RendererAddShader(const char* file, const char* entry, const char* target);
+// Shaders compile in the background. Their pointers stay NULL until they are ready,
+// and are then swapped at the start of a frame, which also applies to hot reloads.
+// Every set of defines is a separate shader, which is cached and reloaded on its own.
+Shader* RendererAddShader(
+    const char* file, const char* entry, const char* target,
+    const std::vector<ShaderDefine>& defines = std::vector<ShaderDefine>());
+
+// Blocks until every added shader is compiled and swapped in, for shaders that are needed during init.
+void RendererWaitForShaders();
 
 void RendererResize(
     int windowWidth, int windowHeight, 
@@ -30,5 +41,14 @@ void RendererResize(
 
 void RendererPaint();
 
+// Accounts for a resource's memory in its category, computed from its description.
+// Warns when this takes the tracked total over the memory budget.
+void RendererTrackResource(ID3D11Texture2D* pTexture, ResourceCategory category);
+void RendererTrackResource(ID3D11Texture3D* pTexture, ResourceCategory category);
+void RendererTrackResource(ID3D11Buffer* pBuffer, ResourceCategory category);
+
+// Call before the resource is released.
+void RendererUntrackResource(ID3D11Resource* pResource);
+
 ID3D11Device* RendererGetDevice();
 ID3D11DeviceContext* RendererGetDeviceContext();
\ No newline at end of file
@@ -0,0 +1,203 @@
+#include "renderstats.h"
+
+#include <vector>
+#include <algorithm>
+#include <fstream>
+#include <cstdio>
+#include <cmath>
+
+static const char* const kRenderCounterNames[kNumRenderCounters] = {
+    "draws",
+    "indices",
+    "material_switches",
+    "node_constant_updates",
+    "constant_buffer_maps",
+    "texture_binds",
+    "sampler_binds",
+    "bytes_uploaded",
+    "culled_nodes",
+    "culling_microseconds"
+};
+
+struct RenderStatsFrame
+{
+    uint64_t FrameIndex;
+    float Milliseconds;
+    uint64_t Counters[kNumRenderCounters];
+};
+
+struct RenderStats
+{
+    uint64_t Counters[kNumRenderCounters]; // of the frame in progress
+
+    std::vector<RenderStatsFrame> Frames; // a ring of the window's frames
+    int NumFrames;
+    uint64_t NumEndedFrames;
+};
+
+static RenderStats g_RenderStats;
+
+void RenderStatsReset(int numWindowFrames)
+{
+    std::fill(g_RenderStats.Counters, g_RenderStats.Counters + kNumRenderCounters, 0);
+    g_RenderStats.Frames.assign(std::max(numWindowFrames, 1), RenderStatsFrame());
+    g_RenderStats.NumFrames = 0;
+    g_RenderStats.NumEndedFrames = 0;
+}
+
+void RenderStatsAdd(RenderCounter counter, uint64_t amount)
+{
+    g_RenderStats.Counters[counter] += amount;
+}
+
+void RenderStatsEndFrame(float frameMilliseconds)
+{
+    if (g_RenderStats.Frames.empty())
+        RenderStatsReset();
+
+    RenderStatsFrame& frame = g_RenderStats.Frames[g_RenderStats.NumEndedFrames % g_RenderStats.Frames.size()];
+    frame.FrameIndex = g_RenderStats.NumEndedFrames;
+    frame.Milliseconds = frameMilliseconds;
+    std::copy(g_RenderStats.Counters, g_RenderStats.Counters + kNumRenderCounters, frame.Counters);
+
+    std::fill(g_RenderStats.Counters, g_RenderStats.Counters + kNumRenderCounters, 0);
+    g_RenderStats.NumFrames = std::min(g_RenderStats.NumFrames + 1, (int)g_RenderStats.Frames.size());
+    g_RenderStats.NumEndedFrames++;
+}
+
+const char* RenderStatsGetCounterName(RenderCounter counter)
+{
+    return kRenderCounterNames[counter];
+}
+
+int RenderStatsGetNumFrames()
+{
+    return g_RenderStats.NumFrames;
+}
+
+// The i-th oldest frame in the window.
+static const RenderStatsFrame& RenderStatsGetFrame(int i)
+{
+    uint64_t firstFrame = g_RenderStats.NumEndedFrames - g_RenderStats.NumFrames;
+    return g_RenderStats.Frames[(firstFrame + i) % g_RenderStats.Frames.size()];
+}
+
+uint64_t RenderStatsGetLastFrameCounter(RenderCounter counter)
+{
+    if (g_RenderStats.NumFrames == 0)
+        return 0;
+
+    return RenderStatsGetFrame(g_RenderStats.NumFrames - 1).Counters[counter];
+}
+
+double RenderStatsGetAverageCounter(RenderCounter counter)
+{
+    if (g_RenderStats.NumFrames == 0)
+        return 0.0;
+
+    uint64_t sum = 0;
+    for (int i = 0; i < g_RenderStats.NumFrames; i++)
+    {
+        sum += g_RenderStats.Frames[i].Counters[counter];
+    }
+    return (double)sum / g_RenderStats.NumFrames;
+}
+
+float RenderStatsGetAverageFrameMilliseconds()
+{
+    if (g_RenderStats.NumFrames == 0)
+        return 0.0f;
+
+    double sum = 0.0;
+    for (int i = 0; i < g_RenderStats.NumFrames; i++)
+    {
+        sum += g_RenderStats.Frames[i].Milliseconds;
+    }
+    return (float)(sum / g_RenderStats.NumFrames);
+}
+
+float RenderStatsGetFrameMillisecondsPercentile(float percentile)
+{
+    int numFrames = g_RenderStats.NumFrames;
+    if (numFrames == 0)
+        return 0.0f;
+
+    std::vector<float> milliseconds(numFrames);
+    for (int i = 0; i < numFrames; i++)
+    {
+        milliseconds[i] = g_RenderStats.Frames[i].Milliseconds;
+    }
+
+    // nearest rank: the smallest time that at least percentile% of the frames are at or below
+    int rank = (int)std::ceil(std::min(std::max(percentile, 0.0f), 100.0f) / 100.0f * numFrames);
+    int index = std::max(rank, 1) - 1;
+    std::nth_element(milliseconds.begin(), milliseconds.begin() + index, milliseconds.end());
+    return milliseconds[index];
+}
+
+bool RenderStatsWriteCSV(const char* path)
+{
+    std::ofstream file(path, std::ios::trunc);
+    if (!file)
+        return false;
+
+    file << "frame,milliseconds";
+    for (int counter = 0; counter < kNumRenderCounters; counter++)
+    {
+        file << "," << kRenderCounterNames[counter];
+    }
+    file << "\n";
+
+    for (int i = 0; i < g_RenderStats.NumFrames; i++)
+    {
+        const RenderStatsFrame& frame = RenderStatsGetFrame(i);
+
+        char milliseconds[32];
+        snprintf(milliseconds, sizeof(milliseconds), "%.3f", frame.Milliseconds);
+
+        file << frame.FrameIndex << "," << milliseconds;
+        for (int counter = 0; counter < kNumRenderCounters; counter++)
+        {
+            file << "," << frame.Counters[counter];
+        }
+        file << "\n";
+    }
+
+    return (bool)file.flush();
+}
+
+bool RenderStatsWriteJSON(const char* path)
+{
+    std::ofstream file(path, std::ios::trunc);
+    if (!file)
+        return false;
+
+    char frameTimes[256];
+    snprintf(frameTimes, sizeof(frameTimes),
+        "{\"average\":%.3f,\"p50\":%.3f,\"p95\":%.3f,\"p99\":%.3f}",
+        RenderStatsGetAverageFrameMilliseconds(),
+        RenderStatsGetFrameMillisecondsPercentile(50.0f),
+        RenderStatsGetFrameMillisecondsPercentile(95.0f),
+        RenderStatsGetFrameMillisecondsPercentile(99.0f));
+
+    file << "{\n\"frames\":" << g_RenderStats.NumFrames << ",\n";
+    file << "\"milliseconds\":" << frameTimes << ",\n";
+
+    file << "\"last_frame\":{";
+    for (int counter = 0; counter < kNumRenderCounters; counter++)
+    {
+        file << (counter == 0 ? "" : ",") << "\"" << kRenderCounterNames[counter] << "\":" << RenderStatsGetLastFrameCounter((RenderCounter)counter);
+    }
+    file << "},\n";
+
+    file << "\"average\":{";
+    for (int counter = 0; counter < kNumRenderCounters; counter++)
+    {
+        char average[32];
+        snprintf(average, sizeof(average), "%.3f", RenderStatsGetAverageCounter((RenderCounter)counter));
+        file << (counter == 0 ? "" : ",") << "\"" << kRenderCounterNames[counter] << "\":" << average;
+    }
+    file << "}\n}\n";
+
+    return (bool)file.flush();
+}
\ No newline at end of file
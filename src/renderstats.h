@@ -0,0 +1,53 @@
+#pragma once
+
+#include <cstdint>
+
+// Per-frame counters that the draw path increments, and frame time percentiles over a sliding window of frames.
+// Only the render thread may touch them. A frame's counters are kept with its frame time when the frame ends,
+// so the window can be dumped as CSV (one row per frame) or summarized as JSON for automated runs.
+// Nothing here depends on D3D or on Windows.
+
+enum RenderCounter
+{
+    RENDER_COUNTER_DRAWS,
+    RENDER_COUNTER_INDICES,
+    RENDER_COUNTER_MATERIAL_SWITCHES,
+    RENDER_COUNTER_NODE_CONSTANT_UPDATES,
+    RENDER_COUNTER_CONSTANT_BUFFER_MAPS,
+    RENDER_COUNTER_TEXTURE_BINDS,
+    RENDER_COUNTER_SAMPLER_BINDS,
+    RENDER_COUNTER_BYTES_UPLOADED,
+    RENDER_COUNTER_CULLED_NODES,
+    RENDER_COUNTER_CULLING_MICROSECONDS
+};
+
+static const int kNumRenderCounters = 10;
+
+static const int kRenderStatsDefaultWindowFrames = 600;
+
+// Forgets every recorded frame and starts a window of the given size.
+void RenderStatsReset(int numWindowFrames = kRenderStatsDefaultWindowFrames);
+
+void RenderStatsAdd(RenderCounter counter, uint64_t amount = 1);
+
+// Records the counters added since the last call along with how long the frame took, and zeroes them.
+void RenderStatsEndFrame(float frameMilliseconds);
+
+const char* RenderStatsGetCounterName(RenderCounter counter);
+
+// The frames in the window, up to its size.
+int RenderStatsGetNumFrames();
+
+// The last ended frame. Zero before the first frame ends.
+uint64_t RenderStatsGetLastFrameCounter(RenderCounter counter);
+
+// Averages over the window.
+double RenderStatsGetAverageCounter(RenderCounter counter);
+float RenderStatsGetAverageFrameMilliseconds();
+
+// The nearest-rank percentile (in [0,100]) of the frame times in the window. Zero if the window is empty.
+float RenderStatsGetFrameMillisecondsPercentile(float percentile);
+
+// Returns false if the file couldn't be written.
+bool RenderStatsWriteCSV(const char* path);
+bool RenderStatsWriteJSON(const char* path);
\ No newline at end of file
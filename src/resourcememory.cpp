@@ -0,0 +1,145 @@
+#include "resourcememory.h"
+
+#include <unordered_map>
+#include <algorithm>
+
+static const char* const kResourceCategoryNames[kNumResourceCategories] = {
+    "Textures",
+    "Meshes",
+    "Voxels",
+    "Render targets"
+};
+
+struct TrackedResource
+{
+    ResourceCategory Category;
+    uint64_t Bytes;
+    bool UnknownSize;
+};
+
+struct ResourceMemory
+{
+    std::unordered_map<const void*, TrackedResource> Resources;
+
+    int NumResources[kNumResourceCategories];
+    uint64_t LiveBytes[kNumResourceCategories];
+    uint64_t PeakBytes[kNumResourceCategories];
+    uint64_t TotalLiveBytes;
+    uint64_t TotalPeakBytes;
+    int NumUnknownSizeResources;
+
+    uint64_t BudgetBytes;
+};
+
+static ResourceMemory g_ResourceMemory;
+
+const char* ResourceMemoryGetCategoryName(ResourceCategory category)
+{
+    return kResourceCategoryNames[category];
+}
+
+uint64_t ResourceMemoryGetTextureSize(
+    int blockSize, int bytesPerBlock,
+    int width, int height, int depth,
+    int mipLevels, int arraySize)
+{
+    if (mipLevels == 0)
+    {
+        int largest = std::max(width, std::max(height, depth));
+        while (largest >> mipLevels)
+        {
+            mipLevels++;
+        }
+    }
+
+    uint64_t bytesPerSlice = 0;
+    for (int level = 0; level < mipLevels; level++)
+    {
+        uint64_t blocksX = (std::max(width >> level, 1) + blockSize - 1) / blockSize;
+        uint64_t blocksY = (std::max(height >> level, 1) + blockSize - 1) / blockSize;
+        uint64_t levelDepth = std::max(depth >> level, 1);
+        bytesPerSlice += blocksX * blocksY * levelDepth * bytesPerBlock;
+    }
+
+    return bytesPerSlice * arraySize;
+}
+
+bool ResourceMemoryTrack(const void* pResource, ResourceCategory category, uint64_t bytes)
+{
+    // Before untracking, so growing a resource that is already over the budget isn't another crossing
+    bool wasWithinBudget = g_ResourceMemory.BudgetBytes == 0 || g_ResourceMemory.TotalLiveBytes <= g_ResourceMemory.BudgetBytes;
+
+    ResourceMemoryUntrack(pResource);
+
+    g_ResourceMemory.Resources[pResource] = TrackedResource{ category, bytes, false };
+    g_ResourceMemory.NumResources[category]++;
+    g_ResourceMemory.LiveBytes[category] += bytes;
+    g_ResourceMemory.PeakBytes[category] = std::max(g_ResourceMemory.PeakBytes[category], g_ResourceMemory.LiveBytes[category]);
+    g_ResourceMemory.TotalLiveBytes += bytes;
+    g_ResourceMemory.TotalPeakBytes = std::max(g_ResourceMemory.TotalPeakBytes, g_ResourceMemory.TotalLiveBytes);
+
+    return wasWithinBudget && g_ResourceMemory.BudgetBytes != 0 && g_ResourceMemory.TotalLiveBytes > g_ResourceMemory.BudgetBytes;
+}
+
+void ResourceMemoryTrackUnknownSize(const void* pResource, ResourceCategory category)
+{
+    ResourceMemoryTrack(pResource, category, 0);
+    g_ResourceMemory.Resources[pResource].UnknownSize = true;
+    g_ResourceMemory.NumUnknownSizeResources++;
+}
+
+void ResourceMemoryUntrack(const void* pResource)
+{
+    auto found = g_ResourceMemory.Resources.find(pResource);
+    if (found == g_ResourceMemory.Resources.end())
+        return;
+
+    const TrackedResource& resource = found->second;
+    g_ResourceMemory.NumResources[resource.Category]--;
+    g_ResourceMemory.LiveBytes[resource.Category] -= resource.Bytes;
+    g_ResourceMemory.TotalLiveBytes -= resource.Bytes;
+    if (resource.UnknownSize)
+        g_ResourceMemory.NumUnknownSizeResources--;
+
+    g_ResourceMemory.Resources.erase(found);
+}
+
+void ResourceMemorySetBudget(uint64_t bytes)
+{
+    g_ResourceMemory.BudgetBytes = bytes;
+}
+
+uint64_t ResourceMemoryGetBudget()
+{
+    return g_ResourceMemory.BudgetBytes;
+}
+
+int ResourceMemoryGetNumResources(ResourceCategory category)
+{
+    return g_ResourceMemory.NumResources[category];
+}
+
+uint64_t ResourceMemoryGetLiveBytes(ResourceCategory category)
+{
+    return g_ResourceMemory.LiveBytes[category];
+}
+
+uint64_t ResourceMemoryGetPeakBytes(ResourceCategory category)
+{
+    return g_ResourceMemory.PeakBytes[category];
+}
+
+uint64_t ResourceMemoryGetTotalLiveBytes()
+{
+    return g_ResourceMemory.TotalLiveBytes;
+}
+
+uint64_t ResourceMemoryGetTotalPeakBytes()
+{
+    return g_ResourceMemory.TotalPeakBytes;
+}
+
+int ResourceMemoryGetNumUnknownSizeResources()
+{
+    return g_ResourceMemory.NumUnknownSizeResources;
+}
\ No newline at end of file
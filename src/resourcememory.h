@@ -0,0 +1,52 @@
+#pragma once
+
+#include <cstdint>
+
+// Accounting of GPU resource memory by category, with live totals, high-water marks and a budget.
+// Sizes are computed from the resource descriptions, so they are what the resources need before any padding the driver adds.
+// Resources are identified by any pointer that is unique while they live, normally the resource itself.
+// Nothing here depends on D3D or on Windows.
+
+enum ResourceCategory
+{
+    RESOURCE_CATEGORY_TEXTURE,
+    RESOURCE_CATEGORY_MESH,
+    RESOURCE_CATEGORY_VOXEL,
+    RESOURCE_CATEGORY_RENDER_TARGET
+};
+
+static const int kNumResourceCategories = 4;
+
+const char* ResourceMemoryGetCategoryName(ResourceCategory category);
+
+// The bytes of a texture whose texels are stored in blocks of blockSize x blockSize (1 if uncompressed, 4 for BC formats).
+// mipLevels of 0 means the full chain. Every level and array slice is rounded up to whole blocks.
+uint64_t ResourceMemoryGetTextureSize(
+    int blockSize, int bytesPerBlock,
+    int width, int height, int depth,
+    int mipLevels, int arraySize);
+
+// Starts tracking a resource, or replaces the size of one that is already tracked.
+// Returns true if this took the live total over the budget.
+bool ResourceMemoryTrack(const void* pResource, ResourceCategory category, uint64_t bytes);
+
+// Starts tracking a resource whose size couldn't be computed, like a texture of a format without known block info.
+// It counts as a resource of 0 bytes, and ResourceMemoryGetNumUnknownSizeResources reports it so the undercount shows.
+void ResourceMemoryTrackUnknownSize(const void* pResource, ResourceCategory category);
+
+// Does nothing if the resource isn't tracked.
+void ResourceMemoryUntrack(const void* pResource);
+
+// 0 means no budget.
+void ResourceMemorySetBudget(uint64_t bytes);
+uint64_t ResourceMemoryGetBudget();
+
+int ResourceMemoryGetNumResources(ResourceCategory category);
+uint64_t ResourceMemoryGetLiveBytes(ResourceCategory category);
+uint64_t ResourceMemoryGetPeakBytes(ResourceCategory category);
+
+uint64_t ResourceMemoryGetTotalLiveBytes();
+uint64_t ResourceMemoryGetTotalPeakBytes();
+
+// Live resources tracked with ResourceMemoryTrackUnknownSize, which the byte totals leave out.
+int ResourceMemoryGetNumUnknownSizeResources();
\ No newline at end of file
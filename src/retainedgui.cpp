@@ -0,0 +1,269 @@
+#include "retainedgui.h"
+
+#include "imgui_internal.h"
+
+#include <unordered_map>
+#include <vector>
+#include <cstring>
+
+// Everything that decides what a region draws besides its contents.
+// Hashed, so any padding must be zeroed.
+struct RetainedGUIStartState
+{
+    ImVec2 WindowPos;
+    ImVec2 WindowSize;
+    ImRect WindowClipRect;
+    ImVec2 CursorPos;
+    ImVec2 CursorPosPrevLine;
+    ImVec2 CursorMaxPos;
+    float CurrentLineHeight;
+    float CurrentLineTextBaseOffset;
+    float PrevLineHeight;
+    float PrevLineTextBaseOffset;
+    float IndentX;
+    float ColumnsOffsetX;
+    float ItemWidth;
+    float TextWrapPos;
+    ImFont* Font;
+    float FontSize;
+    ImTextureID FontTextureID;
+    int FontTexGeneration; // glyphs move when the atlas evicts glyphs, which always follows a glyph that didn't fit
+    ImVec4 CmdClipRect;
+    ImTextureID CmdTextureID;
+    int CmdIsEmpty;
+    int ClipRectStackSize;
+    int TextureIDStackSize;
+};
+
+// The layout state a region leaves behind
+struct RetainedGUIEndState
+{
+    ImVec2 CursorPos;
+    ImVec2 CursorPosPrevLine;
+    ImVec2 CursorMaxPos;
+    float CurrentLineHeight;
+    float CurrentLineTextBaseOffset;
+    float PrevLineHeight;
+    float PrevLineTextBaseOffset;
+    ImGuiID LastItemID;
+    ImRect LastItemRect;
+};
+
+struct RetainedGUIRegion
+{
+    ImU32 Hash;
+    bool Captured;
+
+    // The first command is the one that was current when the region began, with only the elements the region added to it
+    std::vector<ImDrawVert> Vertices;
+    std::vector<ImDrawIdx> Indices; // relative to the region's first vertex
+    std::vector<ImDrawCmd> Cmds;
+    RetainedGUIEndState EndState;
+};
+
+struct RetainedGUI
+{
+    bool Disabled;
+    std::unordered_map<ImGuiID, RetainedGUIRegion> Regions;
+
+    ImU32 StyleHash;
+    int StyleHashFrame; // the frame count plus one, so zero is never a frame
+
+    // the region being built, or NULL if it was replayed or isn't retained
+    RetainedGUIRegion* pCapturingRegion;
+    int CaptureStartVertex;
+    int CaptureStartIndex;
+    int CaptureStartCmd;
+    unsigned int CaptureStartCmdElemCount;
+    int CaptureClipRectStackSize;
+    int CaptureTextureIDStackSize;
+};
+
+static RetainedGUI g_RetainedGUI;
+
+static ImU32 RetainedGUIHashStartState(ImGuiWindow* window, ImU32 contentHash)
+{
+    ImGuiState& g = *GImGui;
+    ImDrawList* drawList = window->DrawList;
+    const ImDrawCmd& cmd = drawList->CmdBuffer.back();
+
+    // value-initialized, which zeroes the padding as well as the members
+    RetainedGUIStartState state = RetainedGUIStartState();
+    state.WindowPos = window->Pos;
+    state.WindowSize = window->Size;
+    state.WindowClipRect = window->ClipRect;
+    state.CursorPos = window->DC.CursorPos;
+    state.CursorPosPrevLine = window->DC.CursorPosPrevLine;
+    state.CursorMaxPos = window->DC.CursorMaxPos;
+    state.CurrentLineHeight = window->DC.CurrentLineHeight;
+    state.CurrentLineTextBaseOffset = window->DC.CurrentLineTextBaseOffset;
+    state.PrevLineHeight = window->DC.PrevLineHeight;
+    state.PrevLineTextBaseOffset = window->DC.PrevLineTextBaseOffset;
+    state.IndentX = window->DC.IndentX;
+    state.ColumnsOffsetX = window->DC.ColumnsOffsetX;
+    state.ItemWidth = window->DC.ItemWidth;
+    state.TextWrapPos = window->DC.TextWrapPos;
+    state.Font = g.Font;
+    state.FontSize = g.FontSize;
+    state.FontTextureID = g.IO.Fonts->TexID;
+    state.FontTexGeneration = g.IO.Fonts->TexGeneration;
+    state.CmdClipRect = cmd.ClipRect;
+    state.CmdTextureID = cmd.TextureId;
+    state.CmdIsEmpty = cmd.ElemCount == 0;
+    state.ClipRectStackSize = drawList->_ClipRectStack.Size;
+    state.TextureIDStackSize = drawList->_TextureIdStack.Size;
+
+    // the style is hashed once a frame, since it is bigger than everything else put together
+    if (g_RetainedGUI.StyleHashFrame != g.FrameCount + 1)
+    {
+        g_RetainedGUI.StyleHash = ImHash(&g.Style, sizeof(g.Style));
+        g_RetainedGUI.StyleHashFrame = g.FrameCount + 1;
+    }
+
+    return ImHash(&state, sizeof(state), contentHash ^ g_RetainedGUI.StyleHash);
+}
+
+static void RetainedGUIReplay(ImGuiWindow* window, const RetainedGUIRegion& region)
+{
+    ImDrawList* drawList = window->DrawList;
+
+    int firstVertex = drawList->VtxBuffer.Size;
+    int numVertices = (int)region.Vertices.size();
+    drawList->VtxBuffer.resize(firstVertex + numVertices);
+    if (numVertices != 0)
+        memcpy(&drawList->VtxBuffer[firstVertex], region.Vertices.data(), numVertices * sizeof(ImDrawVert));
+
+    int firstIndex = drawList->IdxBuffer.Size;
+    int numIndices = (int)region.Indices.size();
+    drawList->IdxBuffer.resize(firstIndex + numIndices);
+    for (int i = 0; i < numIndices; i++)
+    {
+        drawList->IdxBuffer[firstIndex + i] = (ImDrawIdx)(region.Indices[i] + firstVertex);
+    }
+
+    drawList->_VtxCurrentIdx += numVertices;
+    drawList->_VtxWritePtr = drawList->VtxBuffer.Data + drawList->VtxBuffer.Size;
+    drawList->_IdxWritePtr = drawList->IdxBuffer.Data + drawList->IdxBuffer.Size;
+
+    ImDrawCmd& currentCmd = drawList->CmdBuffer.back();
+    unsigned int currentElemCount = currentCmd.ElemCount;
+    currentCmd = region.Cmds[0];
+    currentCmd.ElemCount += currentElemCount;
+    for (size_t i = 1; i < region.Cmds.size(); i++)
+    {
+        drawList->CmdBuffer.push_back(region.Cmds[i]);
+    }
+
+    const RetainedGUIEndState& endState = region.EndState;
+    window->DC.CursorPos = endState.CursorPos;
+    window->DC.CursorPosPrevLine = endState.CursorPosPrevLine;
+    window->DC.CursorMaxPos = endState.CursorMaxPos;
+    window->DC.CurrentLineHeight = endState.CurrentLineHeight;
+    window->DC.CurrentLineTextBaseOffset = endState.CurrentLineTextBaseOffset;
+    window->DC.PrevLineHeight = endState.PrevLineHeight;
+    window->DC.PrevLineTextBaseOffset = endState.PrevLineTextBaseOffset;
+    window->DC.LastItemID = endState.LastItemID;
+    window->DC.LastItemRect = endState.LastItemRect;
+    window->DC.LastItemHoveredAndUsable = window->DC.LastItemHoveredRect = false;
+}
+
+bool RetainedGUIBegin(const char* strID, ImU32 contentHash)
+{
+    g_RetainedGUI.pCapturingRegion = NULL;
+
+    if (g_RetainedGUI.Disabled)
+        return true;
+
+    ImGuiWindow* window = ImGui::GetCurrentWindow();
+    ImDrawList* drawList = window->DrawList;
+    if (window->SkipItems || drawList->_ChannelsCount != 1)
+        return true;
+
+    ImU32 hash = RetainedGUIHashStartState(window, contentHash);
+    RetainedGUIRegion& region = g_RetainedGUI.Regions[window->GetID(strID)];
+    if (region.Captured && region.Hash == hash)
+    {
+        RetainedGUIReplay(window, region);
+        return false;
+    }
+
+    region.Hash = hash;
+    region.Captured = false;
+    g_RetainedGUI.pCapturingRegion = &region;
+    g_RetainedGUI.CaptureStartVertex = drawList->VtxBuffer.Size;
+    g_RetainedGUI.CaptureStartIndex = drawList->IdxBuffer.Size;
+    g_RetainedGUI.CaptureStartCmd = drawList->CmdBuffer.Size - 1;
+    g_RetainedGUI.CaptureStartCmdElemCount = drawList->CmdBuffer.back().ElemCount;
+    g_RetainedGUI.CaptureClipRectStackSize = drawList->_ClipRectStack.Size;
+    g_RetainedGUI.CaptureTextureIDStackSize = drawList->_TextureIdStack.Size;
+    return true;
+}
+
+void RetainedGUIEnd()
+{
+    RetainedGUIRegion* pRegion = g_RetainedGUI.pCapturingRegion;
+    if (!pRegion)
+        return;
+
+    g_RetainedGUI.pCapturingRegion = NULL;
+
+    ImGuiWindow* window = ImGui::GetCurrentWindow();
+    ImDrawList* drawList = window->DrawList;
+
+    // contents that leave the draw list in a state the replay can't reproduce are built every frame
+    if (drawList->_ChannelsCount != 1 ||
+        drawList->_ClipRectStack.Size != g_RetainedGUI.CaptureClipRectStackSize ||
+        drawList->_TextureIdStack.Size != g_RetainedGUI.CaptureTextureIDStackSize ||
+        drawList->CmdBuffer.Size <= g_RetainedGUI.CaptureStartCmd)
+    {
+        return;
+    }
+
+    for (int i = g_RetainedGUI.CaptureStartCmd; i < drawList->CmdBuffer.Size; i++)
+    {
+        if (drawList->CmdBuffer[i].UserCallback)
+            return;
+    }
+
+    int startVertex = g_RetainedGUI.CaptureStartVertex;
+    pRegion->Vertices.assign(drawList->VtxBuffer.Data + startVertex, drawList->VtxBuffer.Data + drawList->VtxBuffer.Size);
+
+    pRegion->Indices.resize(drawList->IdxBuffer.Size - g_RetainedGUI.CaptureStartIndex);
+    for (size_t i = 0; i < pRegion->Indices.size(); i++)
+    {
+        pRegion->Indices[i] = (ImDrawIdx)(drawList->IdxBuffer[g_RetainedGUI.CaptureStartIndex + (int)i] - startVertex);
+    }
+
+    pRegion->Cmds.assign(drawList->CmdBuffer.Data + g_RetainedGUI.CaptureStartCmd, drawList->CmdBuffer.Data + drawList->CmdBuffer.Size);
+    pRegion->Cmds[0].ElemCount -= g_RetainedGUI.CaptureStartCmdElemCount;
+
+    RetainedGUIEndState& endState = pRegion->EndState;
+    endState.CursorPos = window->DC.CursorPos;
+    endState.CursorPosPrevLine = window->DC.CursorPosPrevLine;
+    endState.CursorMaxPos = window->DC.CursorMaxPos;
+    endState.CurrentLineHeight = window->DC.CurrentLineHeight;
+    endState.CurrentLineTextBaseOffset = window->DC.CurrentLineTextBaseOffset;
+    endState.PrevLineHeight = window->DC.PrevLineHeight;
+    endState.PrevLineTextBaseOffset = window->DC.PrevLineTextBaseOffset;
+    endState.LastItemID = window->DC.LastItemID;
+    endState.LastItemRect = window->DC.LastItemRect;
+
+    pRegion->Captured = true;
+}
+
+void RetainedGUISetEnabled(bool enabled)
+{
+    g_RetainedGUI.Disabled = !enabled;
+    if (!enabled)
+        g_RetainedGUI.Regions.clear();
+}
+
+bool RetainedGUIIsEnabled()
+{
+    return !g_RetainedGUI.Disabled;
+}
+
+ImU32 RetainedGUIHash(const void* data, int dataSize, ImU32 seed)
+{
+    return ImHash(data, dataSize, seed);
+}
\ No newline at end of file
@@ -0,0 +1,26 @@
+#pragma once
+
+#include "imgui.h"
+
+// Retained regions of ImGui windows, for content that draws the same thing frame after frame.
+// A region's geometry is captured the first time it is built. While the caller's hash of its contents and the layout and
+// style it starts with stay the same, the captured vertices, indices and draw commands are appended to the window's draw list
+// instead of building the contents again, which skips the text layout and tessellation.
+// Regions don't nest, and must only hold content that doesn't interact with the mouse, since nothing in them is submitted on a hit.
+//
+//     if (RetainedGUIBegin("stats", hash))
+//     {
+//         ImGui::Text(...);
+//     }
+//     RetainedGUIEnd();
+
+// Returns true if the contents must be submitted. RetainedGUIEnd must be called either way.
+bool RetainedGUIBegin(const char* strID, ImU32 contentHash);
+void RetainedGUIEnd();
+
+// Disabled, every region is built as if it were not retained.
+void RetainedGUISetEnabled(bool enabled);
+bool RetainedGUIIsEnabled();
+
+// Hashes the values shown in a region, in the same way as ImGui hashes IDs.
+ImU32 RetainedGUIHash(const void* data, int dataSize, ImU32 seed = 0);
\ No newline at end of file
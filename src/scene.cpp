@@ -4,6 +4,21 @@
 #include "renderer.h"
 #include "app.h"
 #include "flythrough_camera.h"
+#include "occlusion.h"
+#include "voxelizer.h"
+#include "brickpool.h"
+#include "voxelmip.h"
+#include "parallel.h"
+#include "shaderpermutation.h"
+#include "normalmap.h"
+#include "profiler.h"
+#include "renderstats.h"
+#include "camerapath.h"
+#include "retainedgui.h"
+#include "texturestreaming.h"
+#include "texturepacking.h"
+#include "materialtable.h"
+#include "assetpackage.h"
 
 #include "imgui.h"
 #include "tiny_obj_loader.h"
@@ -16,10 +31,98 @@ using namespace DirectX;
 // to make HLSL compile as C++
 using float4 = XMFLOAT4;
 using float4x4 = XMFLOAT4X4;
+using uint4 = XMUINT4;
 
 #include "shaders/common.hlsl"
 
 #include <unordered_map>
+#include <memory>
+#include <algorithm>
+#include <cfloat>
+#include <random>
+#include <streambuf>
+#include <istream>
+
+static const int kOcclusionBufferWidth = 256;
+static const int kOcclusionBufferHeight = 128;
+static const int kMaxOccluderTriangles = 4096;
+static const int kVoxelizerTextureSize = 64;
+static const int kVoxelBrickAtlasBricksPerAxis = 32; // bricks along x and y of the brick atlas
+static const float kBumpNormalScale = 3.0f; // the shader used to scale bumps by 3000 / depth, so this matches a depth of 1000
+static const char* kAssetPackagePath = "assets.pak"; // built by tools/assetpack, and the loose files are read without it
+static const char* kCameraPathPath = "camera.path";
+static const char* kCameraPathReplayCSVPath = "replay.csv";
+static const char* kCameraPathReplayJSONPath = "replay.json";
+static const float kCameraPathReplayStepSeconds = 1.0f / 60.0f;
+static const float kCameraFovYDegrees = 90.0f;
+static const uint64_t kTextureStreamingBudgetBytes = 64ull << 20;
+static const int kTextureStreamingMinResidentSize = 64; // mips up to 64 x 64 are loaded at import and never evicted
+static const int kTextureAtlasSize = 1024;
+static const int kTextureMaxAtlasedSize = 512;
+static const int kTextureAtlasAlignment = 64; // so the atlas pages' always-resident mip has one texel per grid cell
+
+enum VoxelStorage
+{
+    VOXELSTORAGE_DENSE,
+    VOXELSTORAGE_SPARSE
+};
+
+enum TextureType
+{
+    TEXTURETYPE_DIFFUSE,
+    TEXTURETYPE_SPECULAR,
+    TEXTURETYPE_BUMP,
+    TEXTURETYPE_Count
+};
+
+// bump height maps are converted to normal maps by SceneBuildTextureMips
+static const DXGI_FORMAT kTextureTypeToFormat[TEXTURETYPE_Count] = {
+    DXGI_FORMAT_R8G8B8A8_UNORM_SRGB,
+    DXGI_FORMAT_R8_UNORM,
+    DXGI_FORMAT_R8G8_SNORM
+};
+
+static const int kTextureTypeToReqComp[TEXTURETYPE_Count] = {
+    4,
+    1,
+    1
+};
+
+static const int kTextureTypeToBytesPerTexel[TEXTURETYPE_Count] = {
+    4,
+    1,
+    2
+};
+
+static const UINT kTextureTypeToSlot[TEXTURETYPE_Count] = {
+    DIFFUSE_TEXTURE_SLOT,
+    SPECULAR_TEXTURE_SLOT,
+    BUMP_TEXTURE_SLOT
+};
+
+static const UINT kTextureTypeToSamplerSlot[TEXTURETYPE_Count] = {
+    DIFFUSE_SAMPLER_SLOT,
+    SPECULAR_SAMPLER_SLOT,
+    BUMP_SAMPLER_SLOT
+};
+
+enum CameraPathMode
+{
+    CAMERAPATHMODE_FLY,
+    CAMERAPATHMODE_RECORD,
+    CAMERAPATHMODE_REPLAY
+};
+
+struct CameraPathReplayResult
+{
+    int NumFrames;
+    float AverageMilliseconds;
+    float P50Milliseconds;
+    float P95Milliseconds;
+    float P99Milliseconds;
+    float AverageCulledNodes;
+    float AverageCullingMilliseconds;
+};
 
 struct VertexPosition
 {
@@ -46,11 +149,40 @@ struct VertexBitangent
     XMFLOAT3 Bitangent;
 };
 
+// A texture's mips from FirstMip to the coarsest.
+struct TextureMipChain
+{
+    int FirstMip;
+    std::vector<TextureStreamingMip> Mips;
+};
+
+// The texels of a texture are in a slice of a texture array, or in an atlas page that is a slice.
 struct Texture
 {
     std::string Name;
-    ComPtr<ID3D11Resource> Resource;
+    TextureType Type;
+    int Width;
+    int Height;
+    bool CanAtlas; // cleared if a mesh samples it outside of [0,1]
+    TexturePackingPlacement Placement;
+
+    // from the texture's always-resident mip, until SceneBuildTextureArrays copies them into the arrays
+    TextureMipChain ImportMips;
+
+    // only for diffuse textures
+    VoxelizerTexture VoxelizerAlbedo;
+};
+
+// A texture array's ID is also its ID in the scene's TextureStreaming, so its slices are streamed together.
+struct TextureArray
+{
+    TextureType Type;
+    int Width;
+    int Height;
+    std::vector<std::vector<int>> SliceTextureIDs; // of each slice, one texture or the textures of an atlas page
+    ComPtr<ID3D11Texture2D> Resource;
     ComPtr<ID3D11ShaderResourceView> SRV;
+    int FirstMip; // the mip of the full array that is the first mip of Resource
 };
 
 struct Material
@@ -64,6 +196,7 @@ struct Material
     int DiffuseTextureID;
     int SpecularTextureID;
     int BumpTextureID;
+    uint32_t ShaderPermutation; // the MaterialFeature flags of the pixel shader, chosen at import
 };
 
 struct StaticMesh
@@ -78,6 +211,16 @@ struct StaticMesh
     int MaterialID; // the material this mesh was designed for
     UINT IndexCountPerInstance;
     UINT StartIndexLocation;
+
+    // CPU copies of the geometry, shared by all meshes split from the same shape
+    std::shared_ptr<const std::vector<float>> Positions;
+    std::shared_ptr<const std::vector<float>> TexCoords;
+    std::shared_ptr<const std::vector<unsigned int>> Indices;
+
+    XMFLOAT3 BoundsMin;
+    XMFLOAT3 BoundsMax;
+
+    float UVDensity; // UV units per world unit, 0 without texcoords
 };
 
 struct NodeTransform
@@ -113,8 +256,16 @@ struct SceneNode
 
 struct Scene
 {
+    AssetPackage* pAssetPackage; // NULL if there is no package
+
     std::vector<Texture> Textures;
     std::unordered_map<std::string, int> TextureNameToID;
+    std::vector<TextureArray> TextureArrays;
+    int NumTextureAtlasPages;
+
+    TextureStreaming TextureStreaming;
+    TextureStreamingLoader* pTextureStreamingLoader;
+
     std::vector<Material> Materials;
     std::vector<StaticMesh> StaticMeshes;
     std::vector<SceneNode> SceneNodes;
@@ -126,8 +277,19 @@ struct Scene
 
     XMFLOAT3 CameraPos;
     XMFLOAT3 CameraLook;
+
+    CameraPathMode CameraPathMode;
+    CameraPath RecordedCameraPath;
+    float CameraPathRecordSeconds;
+    int CameraPathReplayFrame; // the next frame to draw
+    int CameraPathNumReplayFrames;
+    CameraPathReplayResult CameraPathReplayResult;
+
+    XMFLOAT4X4 WorldViewProjection;
     ComPtr<ID3D11Buffer> pCameraBuffer;
-    ComPtr<ID3D11Buffer> pMaterialBuffer;
+    ComPtr<ID3D11Buffer> pMaterialTable;
+    ComPtr<ID3D11ShaderResourceView> pMaterialTableSRV;
+    std::vector<int> MaterialTableEntries; // the table entry of each material
     ComPtr<ID3D11Buffer> pSceneNodeBuffer;
 
     ComPtr<ID3D11SamplerState> pDiffuseSampler;
@@ -139,12 +301,38 @@ struct Scene
     ComPtr<ID3D11DepthStencilState> pSceneDepthStencilState;
     ComPtr<ID3D11BlendState> pSceneBlendState;
 
+    std::vector<XMFLOAT3> OccluderTriangles;
+    std::vector<bool> SceneNodeVisible;
+    bool OcclusionCullingEnabled;
+    int NumCulledSceneNodes;
+    float OcclusionCullingMilliseconds;
+
     ComPtr<ID3D11Texture3D> pDenseVoxelGrid;
     ComPtr<ID3D11ShaderResourceView> pDenseVoxelGridSRV;
+    ComPtr<ID3D11Texture3D> pDenseVoxelAlbedo;
+    ComPtr<ID3D11ShaderResourceView> pDenseVoxelAlbedoSRV;
+
+    // Sparse storage: per mip level, an R32_UINT texture of brick indices into the shared brick atlas
+    std::vector<BrickPool> VoxelBrickPools;
+    std::vector<ComPtr<ID3D11Texture3D>> pVoxelBrickIndices;
+    std::vector<ComPtr<ID3D11ShaderResourceView>> pVoxelBrickIndicesSRVs;
+    ComPtr<ID3D11Texture3D> pVoxelBrickAtlas;
+    ComPtr<ID3D11ShaderResourceView> pVoxelBrickAtlasSRV;
+
+    int VoxelStorage;
     int VoxelGridSize;
+    VoxelGridDesc VoxelGrid;
+    uint64_t NumOccupiedVoxels;
+    uint64_t VoxelMemoryBytes;
+    float VoxelizeMilliseconds;
+    float VoxelMipMilliseconds;
+
+
+
+    float BumpConversionMilliseconds; // for all bump textures at import
     
     Shader* SceneVS;
-    Shader* ScenePS;
+    Shader* ScenePS[kNumMaterialPermutations]; // NULL for the permutations that no material uses
 
     uint64_t LastTicks;
     int LastMouseX, LastMouseY;
@@ -152,18 +340,307 @@ struct Scene
 
 Scene g_Scene;
 
+// Reads the bytes of an entry in place, so the parsers below read straight from the package's mapping.
+struct SceneMemoryStreamBuf : std::streambuf
+{
+    SceneMemoryStreamBuf(const uint8_t* pBytes, uint64_t size)
+    {
+        char* pBegin = (char*)pBytes;
+        setg(pBegin, pBegin, pBegin + size);
+    }
+};
+
+// Loads the image from the asset package if it has the file, or from the loose file if it doesn't.
+// Can be called from any thread.
+static stbi_uc* SceneLoadImage(const std::string& path, int* pWidth, int* pHeight, int* pComp, int reqComp)
+{
+    int entryID = g_Scene.pAssetPackage ? AssetPackageFind(g_Scene.pAssetPackage, path.c_str()) : -1;
+    if (entryID == -1)
+        return stbi_load(path.c_str(), pWidth, pHeight, pComp, reqComp);
+
+    std::vector<uint8_t> inflated;
+    const uint8_t* pBytes = AssetPackageReadEntry(g_Scene.pAssetPackage, entryID, &inflated);
+    if (!pBytes)
+        return NULL;
+
+    int size = (int)AssetPackageGetEntrySize(g_Scene.pAssetPackage, entryID);
+    return stbi_load_from_memory(pBytes, size, pWidth, pHeight, pComp, reqComp);
+}
+
+// Reads the obj's mtl files from the asset package, like tinyobj::MaterialFileReader does from the loose files.
+class SceneMaterialReader : public tinyobj::MaterialReader
+{
+public:
+    SceneMaterialReader(const std::string& basePath)
+        : m_BasePath(basePath)
+    { }
+
+    virtual bool operator()(
+        const std::string& matId,
+        std::vector<tinyobj::material_t>& materials,
+        std::map<std::string, int>& matMap,
+        std::string& err)
+    {
+        std::string path = m_BasePath + matId;
+        int entryID = g_Scene.pAssetPackage ? AssetPackageFind(g_Scene.pAssetPackage, path.c_str()) : -1;
+        if (entryID == -1)
+        {
+            tinyobj::MaterialFileReader fileReader(m_BasePath);
+            return fileReader(matId, materials, matMap, err);
+        }
+
+        std::vector<uint8_t> inflated;
+        const uint8_t* pBytes = AssetPackageReadEntry(g_Scene.pAssetPackage, entryID, &inflated);
+        if (!pBytes)
+        {
+            err += "WARN: Material file [ " + path + " ] couldn't be inflated from the asset package. Created a default material.";
+            return true;
+        }
+
+        SceneMemoryStreamBuf streamBuf(pBytes, AssetPackageGetEntrySize(g_Scene.pAssetPackage, entryID));
+        std::istream stream(&streamBuf);
+        tinyobj::LoadMtl(matMap, materials, stream);
+        return true;
+    }
+
+private:
+    std::string m_BasePath;
+};
+
+// Loads the obj from the asset package if it has the file, or from the loose file if it doesn't.
+static bool SceneLoadObj(
+    const char* filename, const char* mtlbasepath,
+    std::vector<tinyobj::shape_t>* pShapes, std::vector<tinyobj::material_t>* pMaterials, std::string* pErr)
+{
+    int entryID = g_Scene.pAssetPackage ? AssetPackageFind(g_Scene.pAssetPackage, filename) : -1;
+    if (entryID == -1)
+        return tinyobj::LoadObj(*pShapes, *pMaterials, *pErr, filename, mtlbasepath);
+
+    std::vector<uint8_t> inflated;
+    const uint8_t* pBytes = AssetPackageReadEntry(g_Scene.pAssetPackage, entryID, &inflated);
+    if (!pBytes)
+    {
+        *pErr = "Couldn't inflate the mesh from the asset package";
+        return false;
+    }
+
+    SceneMemoryStreamBuf streamBuf(pBytes, AssetPackageGetEntrySize(g_Scene.pAssetPackage, entryID));
+    std::istream stream(&streamBuf);
+    SceneMaterialReader materialReader(mtlbasepath);
+    return tinyobj::LoadObj(*pShapes, *pMaterials, *pErr, stream, materialReader);
+}
+
+// The mips of a texture from firstMip to the coarsest, in the texture's format.
+// Bump height maps are turned into two channel normal maps, whose every mip is derived from the heights.
+static void SceneBuildTextureMips(
+    const uint8_t* pTexels, int width, int height, TextureType type, int firstMip,
+    std::vector<TextureStreamingMip>* pMips,
+    int numThreads = 0) // for the normal maps, 0 uses every hardware thread
+{
+    if (type != TEXTURETYPE_BUMP)
+    {
+        TextureStreamingBuildMips(pTexels, width, height, kTextureTypeToBytesPerTexel[type], firstMip, pMips);
+        return;
+    }
+
+    std::vector<NormalMapLevel> levels;
+    NormalMapBuildMipChain(pTexels, width, height, kBumpNormalScale, &levels, numThreads);
+
+    pMips->clear();
+    for (int level = firstMip; level < (int)levels.size(); level++)
+    {
+        TextureStreamingMip mip;
+        mip.Width = levels[level].Width;
+        mip.Height = levels[level].Height;
+        const uint8_t* pTexelsXY = (const uint8_t*)levels[level].TexelsXY.data();
+        mip.Texels.assign(pTexelsXY, pTexelsXY + levels[level].TexelsXY.size());
+        pMips->push_back(std::move(mip));
+    }
+}
+
+// The mips of an array from firstMip to the coarsest, with the slices of each mip one after the other and every texel zeroed.
+static void SceneAllocateTextureArrayMips(const TextureArray& array, int firstMip, std::vector<TextureStreamingMip>* pMips)
+{
+    int bytesPerTexel = kTextureTypeToBytesPerTexel[array.Type];
+    int numMips = TextureStreamingGetNumMips(array.Width, array.Height);
+
+    pMips->clear();
+    for (int level = firstMip; level < numMips; level++)
+    {
+        TextureStreamingMip mip;
+        mip.Width = std::max(array.Width >> level, 1);
+        mip.Height = std::max(array.Height >> level, 1);
+        mip.Texels.assign((size_t)mip.Width * mip.Height * bytesPerTexel * array.SliceTextureIDs.size(), 0);
+        pMips->push_back(std::move(mip));
+    }
+}
+
+// The first mip of the texture's chain that is copied into the array's mips from arrayFirstMip on.
+// A texture smaller than its atlas page runs out of mips first, and passes its 1x1 mip for the page's coarser ones.
+static int SceneGetTextureFirstMipInArray(const Texture& texture, int arrayFirstMip)
+{
+    return std::min(arrayFirstMip, TextureStreamingGetNumMips(texture.Width, texture.Height) - 1);
+}
+
+// Copies the texture's mips into its slice of the array's mips, which start at arrayFirstMip.
+static void SceneCopyTextureMipsToArray(
+    const Texture& texture, const TextureMipChain& chain,
+    int arrayFirstMip, std::vector<TextureStreamingMip>* pArrayMips)
+{
+    int bytesPerTexel = kTextureTypeToBytesPerTexel[texture.Type];
+    int numTextureMips = TextureStreamingGetNumMips(texture.Width, texture.Height);
+
+    for (int arrayLevel = 0; arrayLevel < (int)pArrayMips->size(); arrayLevel++)
+    {
+        TextureStreamingMip& arrayMip = (*pArrayMips)[arrayLevel];
+        int level = arrayFirstMip + arrayLevel;
+        const TextureStreamingMip& mip = chain.Mips[std::min(level, numTextureMips - 1) - chain.FirstMip];
+
+        size_t sliceBytes = (size_t)arrayMip.Width * arrayMip.Height * bytesPerTexel;
+        TexturePackingCopyMip(
+            texture.Placement, level,
+            mip.Texels.data(), mip.Width, mip.Height, bytesPerTexel,
+            &arrayMip.Texels[sliceBytes * texture.Placement.Slice], arrayMip.Width, arrayMip.Height);
+    }
+}
+
+// Runs on the texture streaming thread, so it only reads what doesn't change after import.
+// Decodes the textures of the array one at a time, and copies each into its slice before decoding the next.
+static bool SceneLoadTextureMips(int arrayID, int firstMip, std::vector<TextureStreamingMip>* pMips)
+{
+    const TextureArray& array = g_Scene.TextureArrays[arrayID];
+
+    SceneAllocateTextureArrayMips(array, firstMip, pMips);
+
+    for (const std::vector<int>& sliceTextureIDs : array.SliceTextureIDs)
+    {
+        for (int textureID : sliceTextureIDs)
+        {
+            const Texture& texture = g_Scene.Textures[textureID];
+
+            int width, height, comp;
+            stbi_uc* imgbytes = SceneLoadImage(texture.Name, &width, &height, &comp, kTextureTypeToReqComp[texture.Type]);
+            if (imgbytes == NULL)
+                return false;
+
+            // the file could have changed since it was imported
+            bool sameSize = width == texture.Width && height == texture.Height;
+            if (sameSize)
+            {
+                TextureMipChain chain;
+                chain.FirstMip = SceneGetTextureFirstMipInArray(texture, firstMip);
+                SceneBuildTextureMips(imgbytes, width, height, texture.Type, chain.FirstMip, &chain.Mips, 1);
+                SceneCopyTextureMipsToArray(texture, chain, firstMip, pMips);
+            }
+
+            stbi_image_free(imgbytes);
+            if (!sameSize)
+                return false;
+        }
+    }
+
+    return true;
+}
+
+// Replaces the array's resource with the new one, which the caller has tracked, and views all of its mips and slices.
+static void SceneReplaceTextureArrayResource(TextureArray* pArray, const ComPtr<ID3D11Texture2D>& pResource, int firstMip)
+{
+    ID3D11Device* dev = RendererGetDevice();
+
+    if (pArray->Resource)
+        RendererUntrackResource(pArray->Resource.Get());
+
+    pArray->Resource = pResource;
+    pArray->FirstMip = firstMip;
+
+    // a view of a one slice array would otherwise be a Texture2D, which the shader can't sample as an array
+    D3D11_TEXTURE2D_DESC textureDesc;
+    pResource->GetDesc(&textureDesc);
+    CD3D11_SHADER_RESOURCE_VIEW_DESC srvDesc(
+        D3D11_SRV_DIMENSION_TEXTURE2DARRAY, textureDesc.Format,
+        0, textureDesc.MipLevels, 0, textureDesc.ArraySize);
+
+    pArray->SRV.Reset();
+    CHECKHR(dev->CreateShaderResourceView(pArray->Resource.Get(), &srvDesc, &pArray->SRV));
+}
+
+// Replaces the array's resource with an immutable one made of the mips.
+static void SceneSetTextureMips(TextureArray* pArray, int firstMip, const std::vector<TextureStreamingMip>& mips)
+{
+    ID3D11Device* dev = RendererGetDevice();
+
+    UINT arraySize = (UINT)pArray->SliceTextureIDs.size();
+    UINT mipLevels = (UINT)mips.size();
+    int bytesPerTexel = kTextureTypeToBytesPerTexel[pArray->Type];
+
+    std::vector<D3D11_SUBRESOURCE_DATA> initialData(arraySize * mipLevels);
+    for (UINT slice = 0; slice < arraySize; slice++)
+    {
+        for (UINT level = 0; level < mipLevels; level++)
+        {
+            size_t sliceBytes = (size_t)mips[level].Width * mips[level].Height * bytesPerTexel;
+            D3D11_SUBRESOURCE_DATA& data = initialData[D3D11CalcSubresource(level, slice, mipLevels)];
+            data.pSysMem = mips[level].Texels.data() + sliceBytes * slice;
+            data.SysMemPitch = mips[level].Width * bytesPerTexel;
+            data.SysMemSlicePitch = 0;
+        }
+    }
+
+    D3D11_TEXTURE2D_DESC textureDesc = CD3D11_TEXTURE2D_DESC(
+        kTextureTypeToFormat[pArray->Type], mips[0].Width, mips[0].Height, arraySize, mipLevels,
+        D3D11_BIND_SHADER_RESOURCE, D3D11_USAGE_IMMUTABLE);
+
+    ComPtr<ID3D11Texture2D> pResource;
+    CHECKHR(dev->CreateTexture2D(&textureDesc, initialData.data(), &pResource));
+    RendererTrackResource(pResource.Get(), RESOURCE_CATEGORY_TEXTURE);
+
+    SceneReplaceTextureArrayResource(pArray, pResource, firstMip);
+}
+
+// Replaces the array's resource with a copy of its mips from firstMip on.
+static void SceneEvictTextureMips(TextureArray* pArray, int firstMip)
+{
+    ID3D11Device* dev = RendererGetDevice();
+    ID3D11DeviceContext* dc = RendererGetDeviceContext();
+
+    D3D11_TEXTURE2D_DESC oldDesc;
+    pArray->Resource->GetDesc(&oldDesc);
+
+    int numDroppedMips = firstMip - pArray->FirstMip;
+    D3D11_TEXTURE2D_DESC textureDesc = CD3D11_TEXTURE2D_DESC(
+        oldDesc.Format, std::max(oldDesc.Width >> numDroppedMips, 1u), std::max(oldDesc.Height >> numDroppedMips, 1u), oldDesc.ArraySize, oldDesc.MipLevels - numDroppedMips,
+        D3D11_BIND_SHADER_RESOURCE, D3D11_USAGE_DEFAULT);
+
+    ComPtr<ID3D11Texture2D> pResource;
+    CHECKHR(dev->CreateTexture2D(&textureDesc, NULL, &pResource));
+    RendererTrackResource(pResource.Get(), RESOURCE_CATEGORY_TEXTURE);
+
+    for (UINT slice = 0; slice < textureDesc.ArraySize; slice++)
+    {
+        for (UINT level = 0; level < textureDesc.MipLevels; level++)
+        {
+            dc->CopySubresourceRegion(
+                pResource.Get(), D3D11CalcSubresource(level, slice, textureDesc.MipLevels), 0, 0, 0,
+                pArray->Resource.Get(), D3D11CalcSubresource(level + numDroppedMips, slice, oldDesc.MipLevels), NULL);
+        }
+    }
+
+    SceneReplaceTextureArrayResource(pArray, pResource, firstMip);
+}
+
 static void SceneAddObjMesh(
     const char* filename, const char* mtlbasepath,
     std::vector<int>* newStaticMeshIDs = NULL,
     std::vector<int>* newMaterialIDs = NULL)
 {
+    PROFILE_ZONE("SceneAddObjMesh");
+
     ID3D11Device* dev = RendererGetDevice();
-    ID3D11DeviceContext* dc = RendererGetDeviceContext();
 
     std::vector<tinyobj::shape_t> shapes;
     std::vector<tinyobj::material_t> materials;
     std::string err;
-    if (!tinyobj::LoadObj(shapes, materials, err, filename, mtlbasepath))
+    if (!SceneLoadObj(filename, mtlbasepath, &shapes, &materials, &err))
     {
         SimpleMessageBox_FatalError("Failed to load mesh: %s\nReason: %s", filename, err.c_str());
     }
@@ -191,23 +668,15 @@ static void SceneAddObjMesh(
 
         struct TextureToLoad
         {
-            enum TextureToLoadType
-            {
-                TTLTYPE_DIFFUSE,
-                TTLTYPE_SPECULAR,
-                TTLTYPE_BUMP,
-                TTLTYPE_Count
-            };
-
             std::string Name;
-            TextureToLoadType Type;
+            TextureType Type;
             int* pID;
         };
 
         TextureToLoad texturesToLoad[] = {
-            TextureToLoad { material.diffuse_texname, TextureToLoad::TTLTYPE_DIFFUSE, &m.DiffuseTextureID },
-            TextureToLoad { material.specular_texname, TextureToLoad::TTLTYPE_SPECULAR, &m.SpecularTextureID },
-            TextureToLoad { material.bump_texname, TextureToLoad::TTLTYPE_BUMP, &m.BumpTextureID }
+            TextureToLoad { material.diffuse_texname, TEXTURETYPE_DIFFUSE, &m.DiffuseTextureID },
+            TextureToLoad { material.specular_texname, TEXTURETYPE_SPECULAR, &m.SpecularTextureID },
+            TextureToLoad { material.bump_texname, TEXTURETYPE_BUMP, &m.BumpTextureID }
         };
 
         for (TextureToLoad& ttl : texturesToLoad)
@@ -219,69 +688,48 @@ static void SceneAddObjMesh(
             auto foundTexture = g_Scene.TextureNameToID.find(texturePath);
             if (foundTexture == end(g_Scene.TextureNameToID))
             {
-                static const DXGI_FORMAT kTextureTypeToFormat[TextureToLoad::TTLTYPE_Count] = {
-                    DXGI_FORMAT_R8G8B8A8_TYPELESS,
-                    DXGI_FORMAT_R8_TYPELESS,
-                    DXGI_FORMAT_R8_TYPELESS
-                };
-
-                static const DXGI_FORMAT kTextureTypeToSRVFormat[TextureToLoad::TTLTYPE_Count] = {
-                    DXGI_FORMAT_R8G8B8A8_UNORM_SRGB,
-                    DXGI_FORMAT_R8_UNORM,
-                    DXGI_FORMAT_R8_UNORM
-                };
-
-                static const int kTextureTypeToReqComp[TextureToLoad::TTLTYPE_Count] = {
-                    4,
-                    1,
-                    1
-                };
-
                 int width, height, comp;
                 int req_comp = kTextureTypeToReqComp[ttl.Type];
-                stbi_uc* imgbytes = stbi_load(texturePath.c_str(), &width, &height, &comp, req_comp);
+                stbi_uc* imgbytes;
+                {
+                    PROFILE_ZONE("stbi_load");
+                    imgbytes = SceneLoadImage(texturePath, &width, &height, &comp, req_comp);
+                }
                 if (imgbytes == NULL)
                 {
                     SimpleMessageBox_FatalError("stbi_load(%s) failed.\nReason: %s", texturePath.c_str(), stbi_failure_reason());
                 }
 
-                ComPtr<ID3D11Texture2D> pTexture;
+                int textureID = (int)g_Scene.Textures.size();
+
+                Texture texture;
+                texture.Name = texturePath;
+                texture.Type = ttl.Type;
+                texture.Width = width;
+                texture.Height = height;
+                texture.CanAtlas = true;
 
-                D3D11_TEXTURE2D_DESC textureDesc = CD3D11_TEXTURE2D_DESC(kTextureTypeToFormat[ttl.Type], width, height);
-                textureDesc.BindFlags = D3D11_BIND_SHADER_RESOURCE | D3D11_BIND_RENDER_TARGET;
-                textureDesc.MiscFlags = D3D11_RESOURCE_MISC_GENERATE_MIPS;
-                CHECKHR(dev->CreateTexture2D(&textureDesc, NULL, &pTexture));
+                // only the mips that are always resident, and the finer ones are streamed in when they are needed
+                uint64_t startTicks, endTicks, ticksPerSecond;
+                QueryPerformanceFrequency((LARGE_INTEGER*)&ticksPerSecond);
+                QueryPerformanceCounter((LARGE_INTEGER*)&startTicks);
 
-                ComPtr<ID3D11ShaderResourceView> pSRV;
+                texture.ImportMips.FirstMip = TextureStreamingGetMinResidentMip(g_Scene.TextureStreaming, width, height);
+                SceneBuildTextureMips(imgbytes, width, height, ttl.Type, texture.ImportMips.FirstMip, &texture.ImportMips.Mips);
 
-                DXGI_FORMAT srvFormat = kTextureTypeToSRVFormat[ttl.Type];
-                DXGI_FORMAT mipFormat = srvFormat;
-                if (mipFormat == DXGI_FORMAT_R8G8B8A8_UNORM_SRGB)
+                QueryPerformanceCounter((LARGE_INTEGER*)&endTicks);
+                if (ttl.Type == TEXTURETYPE_BUMP)
                 {
-                    // Skylake hack
-                    mipFormat = DXGI_FORMAT_R8G8B8A8_UNORM;
+                    g_Scene.BumpConversionMilliseconds += (endTicks - startTicks) * 1000.0f / ticksPerSecond;
                 }
 
-                CHECKHR(dev->CreateShaderResourceView(
-                    pTexture.Get(),
-                    &CD3D11_SHADER_RESOURCE_VIEW_DESC(D3D11_SRV_DIMENSION_TEXTURE2D, mipFormat),
-                    &pSRV));
-
-                dc->UpdateSubresource(pTexture.Get(), 0, NULL, imgbytes, width * req_comp, width * height * req_comp);
-                dc->GenerateMips(pSRV.Get());
-
-                // Hack for Skylake
-                CHECKHR(dev->CreateShaderResourceView(
-                    pTexture.Get(),
-                    &CD3D11_SHADER_RESOURCE_VIEW_DESC(D3D11_SRV_DIMENSION_TEXTURE2D, srvFormat),
-                    &pSRV));
+                if (ttl.Type == TEXTURETYPE_DIFFUSE)
+                {
+                    VoxelizerCreateTexture(imgbytes, width, height, kVoxelizerTextureSize, &texture.VoxelizerAlbedo);
+                }
 
-                Texture texture;
-                texture.Name = texturePath;
-                texture.Resource = pTexture;
-                texture.SRV = pSRV;
+                stbi_image_free(imgbytes);
 
-                int textureID = (int)g_Scene.Textures.size();
                 g_Scene.Textures.push_back(std::move(texture));
                 g_Scene.TextureNameToID[texturePath] = textureID;
 
@@ -293,6 +741,8 @@ static void SceneAddObjMesh(
             }
         }
 
+        m.ShaderPermutation = ShaderPermutationSelectMaterial(m.DiffuseTextureID, m.SpecularTextureID, m.BumpTextureID);
+
         if (newMaterialIDs)
             newMaterialIDs->push_back((int)g_Scene.Materials.size());
 
@@ -326,6 +776,7 @@ static void SceneAddObjMesh(
                 &CD3D11_BUFFER_DESC(sizeof(VertexPosition) * numVertices, D3D11_BIND_VERTEX_BUFFER, D3D11_USAGE_IMMUTABLE), 
                 &positionVertexBufferData, 
                 &pPositionBuffer));
+            RendererTrackResource(pPositionBuffer.Get(), RESOURCE_CATEGORY_MESH);
         }
 
         if (!mesh.texcoords.empty())
@@ -346,6 +797,7 @@ static void SceneAddObjMesh(
                 &CD3D11_BUFFER_DESC(sizeof(VertexTexCoord) * numVertices,  D3D11_BIND_VERTEX_BUFFER, D3D11_USAGE_IMMUTABLE), 
                 &texcoordVertexBufferData, 
                 &pTexCoordBuffer));
+            RendererTrackResource(pTexCoordBuffer.Get(), RESOURCE_CATEGORY_MESH);
         }
 
         if (!mesh.normals.empty())
@@ -360,6 +812,7 @@ static void SceneAddObjMesh(
                 &CD3D11_BUFFER_DESC(sizeof(VertexNormal) * numVertices, D3D11_BIND_VERTEX_BUFFER, D3D11_USAGE_IMMUTABLE),
                 &normalVertexBufferData, 
                 &pNormalBuffer));
+            RendererTrackResource(pNormalBuffer.Get(), RESOURCE_CATEGORY_MESH);
         }
 
         UINT numIndices = (UINT)mesh.indices.size();
@@ -378,6 +831,7 @@ static void SceneAddObjMesh(
             &CD3D11_BUFFER_DESC(sizeof(UINT32) * numIndices, D3D11_BIND_INDEX_BUFFER, D3D11_USAGE_IMMUTABLE), 
             &indexBufferData, 
             &pIndexBuffer));
+        RendererTrackResource(pIndexBuffer.Get(), RESOURCE_CATEGORY_MESH);
 
         const int numFaces = (int)shape.mesh.indices.size() / 3;
 
@@ -468,6 +922,7 @@ static void SceneAddObjMesh(
                 &CD3D11_BUFFER_DESC(sizeof(VertexTangent) * numVertices, D3D11_BIND_VERTEX_BUFFER, D3D11_USAGE_IMMUTABLE),
                 &tangentVertexBufferData,
                 &pTangentBuffer));
+            RendererTrackResource(pTangentBuffer.Get(), RESOURCE_CATEGORY_MESH);
 
             D3D11_SUBRESOURCE_DATA bitangentVertexBufferData = {};
             bitangentVertexBufferData.pSysMem = bitangents;
@@ -476,11 +931,16 @@ static void SceneAddObjMesh(
                 &CD3D11_BUFFER_DESC(sizeof(VertexBitangent) * numVertices, D3D11_BIND_VERTEX_BUFFER, D3D11_USAGE_IMMUTABLE),
                 &bitangentVertexBufferData,
                 &pBitangentBuffer));
+            RendererTrackResource(pBitangentBuffer.Get(), RESOURCE_CATEGORY_MESH);
 
             delete[] tangents;
             delete[] bitangents;
         }
 
+        auto positions = std::make_shared<std::vector<float>>(std::move(mesh.positions));
+        auto texcoords = std::make_shared<std::vector<float>>(std::move(mesh.texcoords));
+        auto indices = std::make_shared<std::vector<unsigned int>>(std::move(mesh.indices));
+
         int firstFace = 0;
 
         for (int face = 0; face < numFaces; face++)
@@ -508,6 +968,40 @@ static void SceneAddObjMesh(
             sm.MaterialID = firstMaterial + currMTL;
             sm.IndexCountPerInstance = (face + 1 - firstFace) * 3;
             sm.StartIndexLocation = firstFace * 3;
+            sm.Positions = positions;
+            sm.TexCoords = texcoords;
+            sm.Indices = indices;
+
+            XMVECTOR boundsMin = XMVectorReplicate(FLT_MAX);
+            XMVECTOR boundsMax = XMVectorReplicate(-FLT_MAX);
+            for (UINT i = sm.StartIndexLocation; i < sm.StartIndexLocation + sm.IndexCountPerInstance; i++)
+            {
+                XMVECTOR p = XMLoadFloat3((const XMFLOAT3*)&(*positions)[(*indices)[i] * 3]);
+                boundsMin = XMVectorMin(boundsMin, p);
+                boundsMax = XMVectorMax(boundsMax, p);
+            }
+            XMStoreFloat3(&sm.BoundsMin, boundsMin);
+            XMStoreFloat3(&sm.BoundsMax, boundsMax);
+
+            sm.UVDensity = 0.0f;
+            if (!texcoords->empty())
+            {
+                sm.UVDensity = TextureStreamingComputeUVDensity(
+                    positions->data(), texcoords->data(),
+                    indices->data() + sm.StartIndexLocation, (int)sm.IndexCountPerInstance);
+
+                // an atlas page can't wrap the textures in it
+                if (!TexturePackingAreUVsInUnitSquare(texcoords->data(), indices->data() + sm.StartIndexLocation, (int)sm.IndexCountPerInstance))
+                {
+                    const Material& material = g_Scene.Materials[sm.MaterialID];
+                    int textureIDs[] = { material.DiffuseTextureID, material.SpecularTextureID, material.BumpTextureID };
+                    for (int textureID : textureIDs)
+                    {
+                        if (textureID != -1)
+                            g_Scene.Textures[textureID].CanAtlas = false;
+                    }
+                }
+            }
 
             if (newStaticMeshIDs)
                 newStaticMeshIDs->push_back((int)g_Scene.StaticMeshes.size());
@@ -520,6 +1014,139 @@ static void SceneAddObjMesh(
     }
 }
 
+// Packs the imported textures into texture arrays, and uploads the arrays' always-resident mips.
+static void SceneBuildTextureArrays()
+{
+    PROFILE_ZONE("SceneBuildTextureArrays");
+
+    std::vector<TexturePackingInput> inputs;
+    for (const Texture& texture : g_Scene.Textures)
+    {
+        TexturePackingInput input;
+        input.Format = texture.Type;
+        input.Width = texture.Width;
+        input.Height = texture.Height;
+        input.CanAtlas = texture.CanAtlas;
+        inputs.push_back(input);
+    }
+
+    TexturePackingDesc desc;
+    desc.AtlasSize = kTextureAtlasSize;
+    desc.MaxAtlasedSize = kTextureMaxAtlasedSize;
+    desc.Alignment = kTextureAtlasAlignment;
+
+    TexturePacking packing;
+    TexturePackingPack(desc, inputs, &packing);
+
+    for (int textureID = 0; textureID < (int)g_Scene.Textures.size(); textureID++)
+    {
+        g_Scene.Textures[textureID].Placement = packing.Placements[textureID];
+    }
+
+    g_Scene.NumTextureAtlasPages = 0;
+    for (const TexturePackingArray& packedArray : packing.Arrays)
+    {
+        TextureArray array;
+        array.Type = (TextureType)packedArray.Format;
+        array.Width = packedArray.Width;
+        array.Height = packedArray.Height;
+        array.SliceTextureIDs = packedArray.SliceInputs;
+        array.FirstMip = 0;
+
+        int arrayID = TextureStreamingAddTexture(
+            &g_Scene.TextureStreaming,
+            array.Width, array.Height, kTextureTypeToBytesPerTexel[array.Type], (int)array.SliceTextureIDs.size());
+        int firstMip = g_Scene.TextureStreaming.Textures[arrayID].MinResidentMip;
+
+        // the array is at least as big as its textures, so their import mips reach its always-resident mip
+        std::vector<TextureStreamingMip> mips;
+        SceneAllocateTextureArrayMips(array, firstMip, &mips);
+        for (const std::vector<int>& sliceTextureIDs : array.SliceTextureIDs)
+        {
+            for (int textureID : sliceTextureIDs)
+            {
+                const Texture& texture = g_Scene.Textures[textureID];
+                SceneCopyTextureMipsToArray(texture, texture.ImportMips, firstMip, &mips);
+            }
+
+            if (g_Scene.Textures[sliceTextureIDs[0]].Placement.Atlased)
+                g_Scene.NumTextureAtlasPages++;
+        }
+
+        SceneSetTextureMips(&array, firstMip, mips);
+
+        g_Scene.TextureArrays.push_back(std::move(array));
+    }
+
+    for (Texture& texture : g_Scene.Textures)
+    {
+        texture.ImportMips = TextureMipChain();
+    }
+}
+
+// Packs every material into the material table, which is uploaded once. Identical materials share an entry, and the
+// scene nodes index it with MaterialTableEntries.
+static void SceneBuildMaterialTable()
+{
+    ID3D11Device* dev = RendererGetDevice();
+
+    std::vector<MaterialTableMaterial> tableMaterials(g_Scene.Materials.size());
+    for (int materialID = 0; materialID < (int)g_Scene.Materials.size(); materialID++)
+    {
+        const Material& material = g_Scene.Materials[materialID];
+
+        MaterialTableMaterial& tableMaterial = tableMaterials[materialID];
+        memcpy(tableMaterial.Ambient, &material.Ambient, sizeof(tableMaterial.Ambient));
+        memcpy(tableMaterial.Diffuse, &material.Diffuse, sizeof(tableMaterial.Diffuse));
+        memcpy(tableMaterial.Specular, &material.Specular, sizeof(tableMaterial.Specular));
+        tableMaterial.Shininess = material.Shininess;
+        tableMaterial.Opacity = material.Opacity;
+
+        int textureIDs[TEXTURETYPE_Count] = { material.DiffuseTextureID, material.SpecularTextureID, material.BumpTextureID };
+        for (int type = 0; type < TEXTURETYPE_Count; type++)
+        {
+            MaterialTableTexture& tableTexture = tableMaterial.Textures[type];
+            tableTexture.Present = textureIDs[type] != -1;
+            tableTexture.Slice = 0;
+            tableTexture.UVTransform[0] = 1.0f;
+            tableTexture.UVTransform[1] = 1.0f;
+            tableTexture.UVTransform[2] = 0.0f;
+            tableTexture.UVTransform[3] = 0.0f;
+            if (!tableTexture.Present)
+                continue;
+
+            const TexturePackingPlacement& placement = g_Scene.Textures[textureIDs[type]].Placement;
+            tableTexture.Slice = placement.Slice;
+            memcpy(tableTexture.UVTransform, placement.UVTransform, sizeof(tableTexture.UVTransform));
+        }
+    }
+
+    MaterialTable table;
+    if (!MaterialTableBuild(tableMaterials, &table))
+    {
+        const Material& material = g_Scene.Materials[table.MaterialEntries.size()];
+        SimpleMessageBox_FatalError("Material %s uses a texture array slice past %d", material.Name.c_str(), kMaterialTableMaxTextureSlice);
+    }
+    g_Scene.MaterialTableEntries = table.MaterialEntries;
+
+    const std::vector<PackedMaterial>& packedMaterials = table.Entries;
+
+    D3D11_SUBRESOURCE_DATA initialData = {};
+    initialData.pSysMem = packedMaterials.data();
+
+    CHECKHR(dev->CreateBuffer(
+        &CD3D11_BUFFER_DESC(
+            (UINT)(packedMaterials.size() * sizeof(PackedMaterial)), D3D11_BIND_SHADER_RESOURCE, D3D11_USAGE_IMMUTABLE,
+            0, D3D11_RESOURCE_MISC_BUFFER_STRUCTURED, sizeof(PackedMaterial)),
+        &initialData,
+        &g_Scene.pMaterialTable));
+
+    CHECKHR(dev->CreateShaderResourceView(
+        g_Scene.pMaterialTable.Get(),
+        &CD3D11_SHADER_RESOURCE_VIEW_DESC(g_Scene.pMaterialTable.Get(), DXGI_FORMAT_UNKNOWN, 0, (UINT)packedMaterials.size()),
+        &g_Scene.pMaterialTableSRV));
+}
+
 static int SceneAddStaticMeshSceneNode(int staticMeshID)
 {
     const StaticMesh& staticMesh = g_Scene.StaticMeshes[staticMeshID];
@@ -536,25 +1163,487 @@ static int SceneAddStaticMeshSceneNode(int staticMeshID)
     return (int)g_Scene.SceneNodes.size() - 1;
 }
 
+static XMMATRIX SceneNodeWorldMatrix(const SceneNode& sceneNode)
+{
+    XMMATRIX worldMatrix = XMMatrixIdentity();
+    worldMatrix = XMMatrixMultiply(worldMatrix, XMMatrixScalingFromVector(sceneNode.Transform.Scale));
+    worldMatrix = XMMatrixMultiply(worldMatrix, XMMatrixRotationQuaternion(sceneNode.Transform.Quaternion));
+    worldMatrix = XMMatrixMultiply(worldMatrix, XMMatrixTranslationFromVector(sceneNode.Transform.Translation));
+    return worldMatrix;
+}
+
+// Clears the visibility of the scene nodes that are outside the view or hidden by the occluders.
+// Returns the number of nodes that were culled.
+static int SceneCullSceneNodes(FXMMATRIX worldViewProjection, std::vector<bool>* pSceneNodeVisible)
+{
+    OcclusionBeginFrame(worldViewProjection);
+    OcclusionRasterizeTriangles(g_Scene.OccluderTriangles.data(), (int)g_Scene.OccluderTriangles.size() / 3);
+    OcclusionEndFrame();
+
+    int numCulled = 0;
+    for (int sceneNodeID = 0; sceneNodeID < (int)g_Scene.SceneNodes.size(); sceneNodeID++)
+    {
+        const SceneNode& sceneNode = g_Scene.SceneNodes[sceneNodeID];
+        if (sceneNode.Type != SCENENODETYPE_STATICMESH)
+            continue;
+
+        const StaticMesh& staticMesh = g_Scene.StaticMeshes[sceneNode.AsStaticMesh.StaticMeshID];
+        if (!OcclusionIsBoxVisible(staticMesh.BoundsMin, staticMesh.BoundsMax, SceneNodeWorldMatrix(sceneNode)))
+        {
+            (*pSceneNodeVisible)[sceneNodeID] = false;
+            numCulled++;
+        }
+    }
+
+    return numCulled;
+}
+
+// How many pixels a world unit covers one unit in front of the camera.
+static float SceneGetPixelsPerUnitAtUnitDistance()
+{
+    return g_Scene.SceneViewport.Height / (2.0f * std::tan(XMConvertToRadians(kCameraFovYDegrees) * 0.5f));
+}
+
+// Requests the mips that the textures of the visible scene nodes need at their distance to the camera, from their arrays.
+static void SceneRequestTextureMips(
+    TextureStreaming* pStreaming,
+    FXMVECTOR cameraPos, float pixelsPerUnitAtUnitDistance,
+    const std::vector<bool>& sceneNodeVisible)
+{
+    for (int sceneNodeID = 0; sceneNodeID < (int)g_Scene.SceneNodes.size(); sceneNodeID++)
+    {
+        const SceneNode& sceneNode = g_Scene.SceneNodes[sceneNodeID];
+        if (!sceneNodeVisible[sceneNodeID] || sceneNode.Type != SCENENODETYPE_STATICMESH)
+            continue;
+
+        const StaticMesh& staticMesh = g_Scene.StaticMeshes[sceneNode.AsStaticMesh.StaticMeshID];
+
+        // the distance to the closest point of the world-space bounds, which is 0 from inside them
+        XMMATRIX worldMatrix = SceneNodeWorldMatrix(sceneNode);
+        XMVECTOR worldMin = XMVectorReplicate(FLT_MAX);
+        XMVECTOR worldMax = XMVectorReplicate(-FLT_MAX);
+        for (int corner = 0; corner < 8; corner++)
+        {
+            XMVECTOR p = XMVectorSet(
+                (corner & 1) ? staticMesh.BoundsMax.x : staticMesh.BoundsMin.x,
+                (corner & 2) ? staticMesh.BoundsMax.y : staticMesh.BoundsMin.y,
+                (corner & 4) ? staticMesh.BoundsMax.z : staticMesh.BoundsMin.z,
+                1.0f);
+            p = XMVector3TransformCoord(p, worldMatrix);
+            worldMin = XMVectorMin(worldMin, p);
+            worldMax = XMVectorMax(worldMax, p);
+        }
+        XMVECTOR outside = XMVectorMax(XMVectorSubtract(worldMin, cameraPos), XMVectorSubtract(cameraPos, worldMax));
+        float distance = XMVectorGetX(XMVector3Length(XMVectorMax(outside, XMVectorZero())));
+
+        // scaling a node up spreads its UVs over more world units
+        XMFLOAT3 scale;
+        XMStoreFloat3(&scale, XMVectorAbs(sceneNode.Transform.Scale));
+        float uvDensity = staticMesh.UVDensity / std::max(std::max(scale.x, scale.y), scale.z);
+
+        const Material& material = g_Scene.Materials[sceneNode.MaterialID];
+        int textureIDs[] = { material.DiffuseTextureID, material.SpecularTextureID, material.BumpTextureID };
+        for (int textureID : textureIDs)
+        {
+            if (textureID == -1)
+                continue;
+
+            const Texture& texture = g_Scene.Textures[textureID];
+            int arrayID = texture.Placement.ArrayID;
+            const TextureArray& array = g_Scene.TextureArrays[arrayID];
+
+            // a texture in an atlas page only covers part of the page's UVs
+            float arrayUVDensity = uvDensity * std::max(texture.Width, texture.Height) / std::max(array.Width, array.Height);
+
+            int mip = TextureStreamingEstimateMip(pStreaming->Textures[arrayID], arrayUVDensity, distance, pixelsPerUnitAtUnitDistance);
+            TextureStreamingRequestMip(pStreaming, arrayID, mip);
+        }
+    }
+}
+
+// Swaps in the finished loads, then evicts and loads mips for what the visible scene nodes need.
+static void SceneUpdateTextureStreaming()
+{
+    PROFILE_ZONE("Texture streaming");
+
+    std::vector<TextureStreamingLoadResult> loadResults;
+    TextureStreamingLoaderCollect(g_Scene.pTextureStreamingLoader, &loadResults);
+    for (const TextureStreamingLoadResult& result : loadResults)
+    {
+        if (result.Succeeded)
+        {
+            SceneSetTextureMips(&g_Scene.TextureArrays[result.TextureID], result.FirstMip, result.Mips);
+
+            for (const TextureStreamingMip& mip : result.Mips)
+            {
+                RenderStatsAdd(RENDER_COUNTER_BYTES_UPLOADED, mip.Texels.size());
+            }
+        }
+
+        TextureStreamingFinishLoad(&g_Scene.TextureStreaming, result.TextureID, result.Succeeded);
+    }
+
+    TextureStreamingBeginFrame(&g_Scene.TextureStreaming);
+    SceneRequestTextureMips(&g_Scene.TextureStreaming, XMLoadFloat3(&g_Scene.CameraPos), SceneGetPixelsPerUnitAtUnitDistance(), g_Scene.SceneNodeVisible);
+
+    std::vector<TextureStreamingMipChange> evictions;
+    std::vector<TextureStreamingMipChange> loads;
+    TextureStreamingUpdate(&g_Scene.TextureStreaming, &evictions, &loads);
+
+    for (const TextureStreamingMipChange& eviction : evictions)
+    {
+        SceneEvictTextureMips(&g_Scene.TextureArrays[eviction.TextureID], eviction.Mip);
+    }
+
+    for (const TextureStreamingMipChange& load : loads)
+    {
+        TextureStreamingLoaderSubmit(g_Scene.pTextureStreamingLoader, load.TextureID, load.Mip);
+    }
+}
+
+// Picks the largest world-space triangles of the scene as occluders.
+// Scene nodes don't move after init, so they're transformed once up front.
+static void SceneBuildOccluders()
+{
+    struct OccluderCandidate
+    {
+        XMFLOAT3 Positions[3];
+        float Area;
+    };
+
+    std::vector<OccluderCandidate> candidates;
+
+    for (const SceneNode& sceneNode : g_Scene.SceneNodes)
+    {
+        if (sceneNode.Type != SCENENODETYPE_STATICMESH)
+            continue;
+
+        const StaticMesh& staticMesh = g_Scene.StaticMeshes[sceneNode.AsStaticMesh.StaticMeshID];
+        const std::vector<float>& positions = *staticMesh.Positions;
+        const std::vector<unsigned int>& indices = *staticMesh.Indices;
+
+        XMMATRIX worldMatrix = SceneNodeWorldMatrix(sceneNode);
+
+        for (UINT i = staticMesh.StartIndexLocation; i < staticMesh.StartIndexLocation + staticMesh.IndexCountPerInstance; i += 3)
+        {
+            XMVECTOR v0 = XMVector3Transform(XMLoadFloat3((const XMFLOAT3*)&positions[indices[i + 0] * 3]), worldMatrix);
+            XMVECTOR v1 = XMVector3Transform(XMLoadFloat3((const XMFLOAT3*)&positions[indices[i + 1] * 3]), worldMatrix);
+            XMVECTOR v2 = XMVector3Transform(XMLoadFloat3((const XMFLOAT3*)&positions[indices[i + 2] * 3]), worldMatrix);
+
+            OccluderCandidate candidate;
+            XMStoreFloat3(&candidate.Positions[0], v0);
+            XMStoreFloat3(&candidate.Positions[1], v1);
+            XMStoreFloat3(&candidate.Positions[2], v2);
+            candidate.Area = 0.5f * XMVectorGetX(XMVector3Length(XMVector3Cross(v1 - v0, v2 - v0)));
+            candidates.push_back(candidate);
+        }
+    }
+
+    size_t numOccluders = std::min(candidates.size(), (size_t)kMaxOccluderTriangles);
+    std::partial_sort(candidates.begin(), candidates.begin() + numOccluders, candidates.end(),
+        [](const OccluderCandidate& a, const OccluderCandidate& b) { return a.Area > b.Area; });
+
+    g_Scene.OccluderTriangles.clear();
+    for (size_t i = 0; i < numOccluders; i++)
+    {
+        g_Scene.OccluderTriangles.push_back(candidates[i].Positions[0]);
+        g_Scene.OccluderTriangles.push_back(candidates[i].Positions[1]);
+        g_Scene.OccluderTriangles.push_back(candidates[i].Positions[2]);
+    }
+}
+
+static void SceneBuildVoxelizerTriangles(int gridSize, std::vector<VoxelizerTriangle>* pTriangles, VoxelGridDesc* pGrid)
+{
+    std::vector<VoxelizerTriangle>& triangles = *pTriangles;
+    triangles.clear();
+
+    XMVECTOR sceneMin = XMVectorReplicate(FLT_MAX);
+    XMVECTOR sceneMax = XMVectorReplicate(-FLT_MAX);
+
+    for (const SceneNode& sceneNode : g_Scene.SceneNodes)
+    {
+        if (sceneNode.Type != SCENENODETYPE_STATICMESH)
+            continue;
+
+        const StaticMesh& staticMesh = g_Scene.StaticMeshes[sceneNode.AsStaticMesh.StaticMeshID];
+        const Material& material = g_Scene.Materials[sceneNode.MaterialID];
+        const std::vector<float>& positions = *staticMesh.Positions;
+        const std::vector<float>& texcoords = *staticMesh.TexCoords;
+        const std::vector<unsigned int>& indices = *staticMesh.Indices;
+
+        XMMATRIX worldMatrix = SceneNodeWorldMatrix(sceneNode);
+
+        VoxelizerTriangle triangle;
+        triangle.Albedo = material.Diffuse;
+        triangle.pAlbedoTexture = NULL;
+        if (material.DiffuseTextureID != -1 && !texcoords.empty())
+            triangle.pAlbedoTexture = &g_Scene.Textures[material.DiffuseTextureID].VoxelizerAlbedo;
+
+        for (UINT i = staticMesh.StartIndexLocation; i < staticMesh.StartIndexLocation + staticMesh.IndexCountPerInstance; i += 3)
+        {
+            for (int v = 0; v < 3; v++)
+            {
+                unsigned int index = indices[i + v];
+                XMVECTOR p = XMVector3Transform(XMLoadFloat3((const XMFLOAT3*)&positions[index * 3]), worldMatrix);
+                XMStoreFloat3(&triangle.Positions[v], p);
+                triangle.TexCoords[v] = texcoords.empty() ? XMFLOAT2(0.0f, 0.0f) : XMFLOAT2(texcoords[index * 2 + 0], texcoords[index * 2 + 1]);
+
+                sceneMin = XMVectorMin(sceneMin, p);
+                sceneMax = XMVectorMax(sceneMax, p);
+            }
+
+            triangles.push_back(triangle);
+        }
+    }
+
+    // Fit a cube around the scene, padded a bit so nothing lies exactly on the far boundary
+    XMFLOAT3 sceneExtent;
+    XMStoreFloat3(&sceneExtent, XMVectorSubtract(sceneMax, sceneMin));
+    float gridExtent = std::max(sceneExtent.x, std::max(sceneExtent.y, sceneExtent.z)) * 1.001f;
+
+    XMStoreFloat3(&pGrid->Origin, sceneMin);
+    pGrid->VoxelSize = gridExtent / gridSize;
+    pGrid->Size = gridSize;
+}
+
+static void SceneBuildVoxelBrickPools(
+    const std::vector<VoxelizerTriangle>& triangles, const VoxelGridDesc& grid,
+    std::vector<BrickPool>* pPools, uint64_t* pNumOccupiedVoxels)
+{
+    pPools->clear();
+    pPools->emplace_back();
+    *pNumOccupiedVoxels = BrickPoolBuild(triangles, grid, &pPools->back());
+
+    while (pPools->back().Size > 1)
+    {
+        BrickPool mip;
+        BrickPoolBuildMip(pPools->back(), &mip);
+        pPools->push_back(std::move(mip));
+    }
+}
+
+static void SceneUploadVoxelBrickPools()
+{
+    ID3D11Device* dev = RendererGetDevice();
+    ID3D11DeviceContext* dc = RendererGetDeviceContext();
+
+    const std::vector<BrickPool>& pools = g_Scene.VoxelBrickPools;
+
+    // All mip levels share one atlas, so brick indices are offset by the bricks of the finer levels
+    int numBricks = 0;
+    std::vector<int> firstBricks;
+    for (const BrickPool& pool : pools)
+    {
+        firstBricks.push_back(numBricks);
+        numBricks += (int)(pool.Bricks.size() / kBrickPoolVoxelsPerBrick);
+    }
+
+    const int bricksPerSlice = kVoxelBrickAtlasBricksPerAxis * kVoxelBrickAtlasBricksPerAxis;
+    const int atlasWidth = kVoxelBrickAtlasBricksPerAxis * kVoxelBrickSize;
+    int numAtlasSlices = std::max((numBricks + bricksPerSlice - 1) / bricksPerSlice, 1);
+    if (numAtlasSlices * kVoxelBrickSize > D3D11_REQ_TEXTURE3D_U_V_OR_W_DIMENSION)
+    {
+        SimpleMessageBox_FatalError("Too many voxel bricks for the brick atlas: %d", numBricks);
+    }
+
+    CHECKHR(dev->CreateTexture3D(
+        &CD3D11_TEXTURE3D_DESC(DXGI_FORMAT_R8G8B8A8_UNORM_SRGB, atlasWidth, atlasWidth, numAtlasSlices * kVoxelBrickSize, 1),
+        NULL,
+        &g_Scene.pVoxelBrickAtlas));
+    RendererTrackResource(g_Scene.pVoxelBrickAtlas.Get(), RESOURCE_CATEGORY_VOXEL);
+
+    CHECKHR(dev->CreateShaderResourceView(
+        g_Scene.pVoxelBrickAtlas.Get(),
+        &CD3D11_SHADER_RESOURCE_VIEW_DESC(D3D11_SRV_DIMENSION_TEXTURE3D, DXGI_FORMAT_R8G8B8A8_UNORM_SRGB),
+        &g_Scene.pVoxelBrickAtlasSRV));
+
+    g_Scene.pVoxelBrickIndices.resize(pools.size());
+    g_Scene.pVoxelBrickIndicesSRVs.resize(pools.size());
+    g_Scene.VoxelMemoryBytes = (uint64_t)atlasWidth * atlasWidth * numAtlasSlices * kVoxelBrickSize * sizeof(uint32_t);
+
+    for (int level = 0; level < (int)pools.size(); level++)
+    {
+        const BrickPool& pool = pools[level];
+        int n = pool.NumBricksPerAxis;
+
+        std::vector<uint32_t> brickIndices(pool.BrickIndices);
+        for (uint32_t& brickIndex : brickIndices)
+        {
+            if (brickIndex != kBrickPoolEmptyBrick)
+                brickIndex += firstBricks[level];
+        }
+
+        D3D11_SUBRESOURCE_DATA brickIndicesData = {};
+        brickIndicesData.pSysMem = brickIndices.data();
+        brickIndicesData.SysMemPitch = n * sizeof(uint32_t);
+        brickIndicesData.SysMemSlicePitch = n * n * sizeof(uint32_t);
+
+        CHECKHR(dev->CreateTexture3D(
+            &CD3D11_TEXTURE3D_DESC(DXGI_FORMAT_R32_UINT, n, n, n, 1, D3D11_BIND_SHADER_RESOURCE, D3D11_USAGE_IMMUTABLE),
+            &brickIndicesData,
+            &g_Scene.pVoxelBrickIndices[level]));
+        RendererTrackResource(g_Scene.pVoxelBrickIndices[level].Get(), RESOURCE_CATEGORY_VOXEL);
+
+        CHECKHR(dev->CreateShaderResourceView(
+            g_Scene.pVoxelBrickIndices[level].Get(),
+            &CD3D11_SHADER_RESOURCE_VIEW_DESC(D3D11_SRV_DIMENSION_TEXTURE3D, DXGI_FORMAT_R32_UINT),
+            &g_Scene.pVoxelBrickIndicesSRVs[level]));
+
+        g_Scene.VoxelMemoryBytes += brickIndices.size() * sizeof(uint32_t);
+
+        // Bricks are stored x-major, which matches one 8x8x8 box of the atlas
+        for (int localBrickIndex = 0; localBrickIndex < (int)(pool.Bricks.size() / kBrickPoolVoxelsPerBrick); localBrickIndex++)
+        {
+            int brickIndex = firstBricks[level] + localBrickIndex;
+            UINT x = (brickIndex % kVoxelBrickAtlasBricksPerAxis) * kVoxelBrickSize;
+            UINT y = (brickIndex / kVoxelBrickAtlasBricksPerAxis % kVoxelBrickAtlasBricksPerAxis) * kVoxelBrickSize;
+            UINT z = (brickIndex / bricksPerSlice) * kVoxelBrickSize;
+            D3D11_BOX brickBox = { x, y, z, x + kVoxelBrickSize, y + kVoxelBrickSize, z + kVoxelBrickSize };
+
+            dc->UpdateSubresource(
+                g_Scene.pVoxelBrickAtlas.Get(), 0, &brickBox,
+                &pool.Bricks[(size_t)localBrickIndex * kBrickPoolVoxelsPerBrick],
+                kVoxelBrickSize * sizeof(uint32_t), kVoxelBrickSize * kVoxelBrickSize * sizeof(uint32_t));
+        }
+    }
+}
+
+static void SceneVoxelize()
+{
+    PROFILE_ZONE("SceneVoxelize");
+
+    ID3D11DeviceContext* dc = RendererGetDeviceContext();
+
+    std::vector<VoxelizerTriangle> triangles;
+    VoxelGridDesc grid;
+    SceneBuildVoxelizerTriangles(g_Scene.VoxelGridSize, &triangles, &grid);
+    g_Scene.VoxelGrid = grid;
+
+    uint64_t startTicks, endTicks, ticksPerSecond;
+    QueryPerformanceFrequency((LARGE_INTEGER*)&ticksPerSecond);
+    QueryPerformanceCounter((LARGE_INTEGER*)&startTicks);
+
+    if (g_Scene.VoxelStorage == VOXELSTORAGE_SPARSE)
+    {
+        SceneBuildVoxelBrickPools(triangles, grid, &g_Scene.VoxelBrickPools, &g_Scene.NumOccupiedVoxels);
+
+        QueryPerformanceCounter((LARGE_INTEGER*)&endTicks);
+        g_Scene.VoxelizeMilliseconds = (endTicks - startTicks) * 1000.0f / ticksPerSecond;
+
+        SceneUploadVoxelBrickPools();
+        return;
+    }
+
+    int size = grid.Size;
+    std::vector<uint32_t> voxels((size_t)size * size * size);
+    g_Scene.NumOccupiedVoxels = VoxelizeTriangles(triangles, grid, voxels.data());
+
+    QueryPerformanceCounter((LARGE_INTEGER*)&endTicks);
+    g_Scene.VoxelizeMilliseconds = (endTicks - startTicks) * 1000.0f / ticksPerSecond;
+
+    std::vector<uint8_t> occupancy(voxels.size());
+    for (size_t i = 0; i < voxels.size(); i++)
+    {
+        occupancy[i] = (uint8_t)(voxels[i] >> 24);
+    }
+
+    // Build and upload one mip level at a time, only keeping the level the next one is built from
+    float mipMilliseconds = 0.0f;
+    int numLevels = VoxelMipGetNumLevels(size);
+    for (int level = 0; level < numLevels; level++)
+    {
+        int levelSize = size >> level;
+
+        if (level > 0)
+        {
+            std::vector<uint8_t> levelOccupancy((size_t)levelSize * levelSize * levelSize);
+            std::vector<uint32_t> levelVoxels(levelOccupancy.size());
+
+            QueryPerformanceCounter((LARGE_INTEGER*)&startTicks);
+            VoxelMipDownsampleOccupancy(occupancy.data(), levelSize * 2, levelOccupancy.data());
+            VoxelMipDownsampleAlbedo(voxels.data(), levelSize * 2, levelVoxels.data());
+            QueryPerformanceCounter((LARGE_INTEGER*)&endTicks);
+            mipMilliseconds += (endTicks - startTicks) * 1000.0f / ticksPerSecond;
+
+            occupancy.swap(levelOccupancy);
+            voxels.swap(levelVoxels);
+        }
+
+        // Upload a slice at a time, since the driver stages every update
+        for (int z = 0; z < levelSize; z++)
+        {
+            size_t sliceOffset = (size_t)z * levelSize * levelSize;
+            D3D11_BOX sliceBox = { 0, 0, (UINT)z, (UINT)levelSize, (UINT)levelSize, (UINT)z + 1 };
+            dc->UpdateSubresource(g_Scene.pDenseVoxelGrid.Get(), level, &sliceBox, &occupancy[sliceOffset], levelSize * sizeof(uint8_t), levelSize * levelSize * sizeof(uint8_t));
+            dc->UpdateSubresource(g_Scene.pDenseVoxelAlbedo.Get(), level, &sliceBox, &voxels[sliceOffset], levelSize * sizeof(uint32_t), levelSize * levelSize * sizeof(uint32_t));
+        }
+    }
+
+    g_Scene.VoxelMipMilliseconds = mipMilliseconds;
+}
+
 static void SceneResizeVoxelGrid(int newSize)
 {
     ID3D11Device* dev = RendererGetDevice();
 
     g_Scene.VoxelGridSize = newSize;
 
-    D3D11_TEXTURE3D_DESC textureDesc = CD3D11_TEXTURE3D_DESC(DXGI_FORMAT_R32_TYPELESS, newSize, newSize, newSize);
-    textureDesc.BindFlags = D3D11_BIND_SHADER_RESOURCE | D3D11_BIND_RENDER_TARGET | D3D11_BIND_UNORDERED_ACCESS;
-    textureDesc.MiscFlags = D3D11_RESOURCE_MISC_GENERATE_MIPS;
-    CHECKHR(dev->CreateTexture3D(&textureDesc, NULL, &g_Scene.pDenseVoxelGrid));
+    RendererUntrackResource(g_Scene.pDenseVoxelGrid.Get());
+    RendererUntrackResource(g_Scene.pDenseVoxelAlbedo.Get());
+    RendererUntrackResource(g_Scene.pVoxelBrickAtlas.Get());
+    for (const ComPtr<ID3D11Texture3D>& pBrickIndices : g_Scene.pVoxelBrickIndices)
+    {
+        RendererUntrackResource(pBrickIndices.Get());
+    }
+
+    g_Scene.pDenseVoxelGrid.Reset();
+    g_Scene.pDenseVoxelGridSRV.Reset();
+    g_Scene.pDenseVoxelAlbedo.Reset();
+    g_Scene.pDenseVoxelAlbedoSRV.Reset();
+    g_Scene.VoxelBrickPools.clear();
+    g_Scene.pVoxelBrickIndices.clear();
+    g_Scene.pVoxelBrickIndicesSRVs.clear();
+    g_Scene.pVoxelBrickAtlas.Reset();
+    g_Scene.pVoxelBrickAtlasSRV.Reset();
+
+    if (g_Scene.VoxelStorage == VOXELSTORAGE_SPARSE)
+    {
+        SceneVoxelize();
+        return;
+    }
+
+    g_Scene.VoxelMemoryBytes = BrickPoolGetDenseMemorySize(newSize);
+
+    // Mips are built on the CPU by SceneVoxelize
+    CHECKHR(dev->CreateTexture3D(
+        &CD3D11_TEXTURE3D_DESC(DXGI_FORMAT_R8_UNORM, newSize, newSize, newSize),
+        NULL,
+        &g_Scene.pDenseVoxelGrid));
+    RendererTrackResource(g_Scene.pDenseVoxelGrid.Get(), RESOURCE_CATEGORY_VOXEL);
 
     CHECKHR(dev->CreateShaderResourceView(
         g_Scene.pDenseVoxelGrid.Get(),
-        &CD3D11_SHADER_RESOURCE_VIEW_DESC(D3D11_SRV_DIMENSION_TEXTURE3D, DXGI_FORMAT_R32_FLOAT),
+        &CD3D11_SHADER_RESOURCE_VIEW_DESC(D3D11_SRV_DIMENSION_TEXTURE3D, DXGI_FORMAT_R8_UNORM),
         &g_Scene.pDenseVoxelGridSRV));
+
+    CHECKHR(dev->CreateTexture3D(
+        &CD3D11_TEXTURE3D_DESC(DXGI_FORMAT_R8G8B8A8_UNORM_SRGB, newSize, newSize, newSize),
+        NULL,
+        &g_Scene.pDenseVoxelAlbedo));
+    RendererTrackResource(g_Scene.pDenseVoxelAlbedo.Get(), RESOURCE_CATEGORY_VOXEL);
+
+    CHECKHR(dev->CreateShaderResourceView(
+        g_Scene.pDenseVoxelAlbedo.Get(),
+        &CD3D11_SHADER_RESOURCE_VIEW_DESC(D3D11_SRV_DIMENSION_TEXTURE3D, DXGI_FORMAT_R8G8B8A8_UNORM_SRGB),
+        &g_Scene.pDenseVoxelAlbedoSRV));
+
+    SceneVoxelize();
 }
 
 void SceneInit()
 {
+    PROFILE_ZONE("SceneInit");
+
     ID3D11Device* dev = RendererGetDevice();
 
     std::vector<std::string> meshesToLoad = {
@@ -562,6 +1651,11 @@ void SceneInit()
         "cube"
     };
 
+    TextureStreamingInit(&g_Scene.TextureStreaming, kTextureStreamingBudgetBytes, kTextureStreamingMinResidentSize);
+
+    // the texture streaming thread reads from the package too, so it stays open until SceneExit
+    g_Scene.pAssetPackage = AssetPackageOpen(kAssetPackagePath);
+
     std::vector<int> newStaticMeshIDs;
     for (const std::string& meshToLoad : meshesToLoad)
     {
@@ -588,8 +1682,36 @@ void SceneInit()
         g_Scene.SceneNodes[cubeSceneNodeID].Transform.Translation = XMVectorSet(200.0f, 50.0f, 0.0f, 1.0f);
     }
 
+    SceneBuildTextureArrays();
+    SceneBuildMaterialTable();
+
+    // the loader reads the textures' names and the arrays, so it starts once every array is built
+    g_Scene.pTextureStreamingLoader = TextureStreamingLoaderCreate(SceneLoadTextureMips);
+
+    SceneBuildOccluders();
+    OcclusionInit(kOcclusionBufferWidth, kOcclusionBufferHeight);
+    g_Scene.OcclusionCullingEnabled = true;
+
     g_Scene.SceneVS = RendererAddShader("scene.hlsl", "VSmain", "vs_5_0");
-    g_Scene.ScenePS = RendererAddShader("scene.hlsl", "PSmain", "ps_5_0");
+
+    // only compile the pixel shader permutations that the loaded materials use
+    std::vector<uint32_t> materialPermutations;
+    for (const Material& material : g_Scene.Materials)
+    {
+        materialPermutations.push_back(material.ShaderPermutation);
+    }
+
+    std::vector<uint32_t> usedPermutations;
+    ShaderPermutationCollectUsed(materialPermutations, &usedPermutations);
+
+    for (uint32_t permutation : usedPermutations)
+    {
+        std::vector<ShaderDefine> defines;
+        ShaderPermutationGetDefines(kMaterialFeatureDefines, kNumMaterialFeatures, permutation, &defines);
+        g_Scene.ScenePS[permutation] = RendererAddShader("scene.hlsl", "PSmain", "ps_5_0", defines);
+    }
+
+    RendererWaitForShaders(); // the input layout needs the VS blob
 
     XMStoreFloat3(&g_Scene.CameraPos, XMVectorSet(0.0f, 200.0f, 0.0f, 1.0f));
     XMStoreFloat3(&g_Scene.CameraLook, XMVectorSet(1.0f, 0.0f, 0.0f, 0.0f));
@@ -599,11 +1721,6 @@ void SceneInit()
         NULL,
         &g_Scene.pCameraBuffer));
 
-    CHECKHR(dev->CreateBuffer(
-        &CD3D11_BUFFER_DESC(sizeof(PerMaterialData), D3D11_BIND_CONSTANT_BUFFER, D3D11_USAGE_DYNAMIC, D3D11_CPU_ACCESS_WRITE),
-        NULL, 
-        &g_Scene.pMaterialBuffer));
-
     CHECKHR(dev->CreateBuffer(
         &CD3D11_BUFFER_DESC(sizeof(PerSceneNodeData), D3D11_BIND_CONSTANT_BUFFER, D3D11_USAGE_DYNAMIC, D3D11_CPU_ACCESS_WRITE), 
         NULL, 
@@ -652,22 +1769,39 @@ void SceneInit()
     D3D11_BLEND_DESC sceneBlendDesc = CD3D11_BLEND_DESC(D3D11_DEFAULT);
     CHECKHR(dev->CreateBlendState(&sceneBlendDesc, &g_Scene.pSceneBlendState));
 
+    g_Scene.VoxelStorage = VOXELSTORAGE_SPARSE;
     SceneResizeVoxelGrid(512);
 
     g_Scene.LastMouseX = INT_MIN;
     g_Scene.LastMouseY = INT_MIN;
 }
 
+void SceneExit()
+{
+    if (g_Scene.pTextureStreamingLoader)
+    {
+        TextureStreamingLoaderDestroy(g_Scene.pTextureStreamingLoader);
+        g_Scene.pTextureStreamingLoader = NULL;
+    }
+
+    // after the loader, whose thread could still be reading from the package
+    AssetPackageClose(g_Scene.pAssetPackage);
+    g_Scene.pAssetPackage = NULL;
+}
+
 void SceneResize(
     int windowWidth, int windowHeight,
     int renderWidth, int renderHeight)
 {
     ID3D11Device* dev = RendererGetDevice();
 
+    RendererUntrackResource(g_Scene.pSceneDepthTex2D.Get());
+
     CHECKHR(dev->CreateTexture2D(
         &CD3D11_TEXTURE2D_DESC(DXGI_FORMAT_R32_TYPELESS, renderWidth, renderHeight, 1, 1, D3D11_BIND_DEPTH_STENCIL), 
         NULL, 
         &g_Scene.pSceneDepthTex2D));
+    RendererTrackResource(g_Scene.pSceneDepthTex2D.Get(), RESOURCE_CATEGORY_RENDER_TARGET);
 
     CHECKHR(dev->CreateDepthStencilView(
         g_Scene.pSceneDepthTex2D.Get(), 
@@ -677,13 +1811,48 @@ void SceneResize(
     g_Scene.SceneViewport = CD3D11_VIEWPORT(0.0f, 0.0f, (FLOAT)renderWidth, (FLOAT)renderHeight);
 }
 
+static void SceneStartCameraPathReplay()
+{
+    if (!CameraPathLoad(kCameraPathPath, &g_Scene.RecordedCameraPath) || g_Scene.RecordedCameraPath.Keys.empty())
+    {
+        fprintf(stderr, "Failed to load camera path: %s\n", kCameraPathPath);
+        return;
+    }
+
+    g_Scene.CameraPathMode = CAMERAPATHMODE_REPLAY;
+    g_Scene.CameraPathReplayFrame = 0;
+    g_Scene.CameraPathNumReplayFrames = CameraPathGetNumFrames(g_Scene.RecordedCameraPath, kCameraPathReplayStepSeconds);
+}
+
+// RendererPaint ends a frame's stats when the next one begins, so this runs the frame after the last replayed one.
+static void SceneFinishCameraPathReplay()
+{
+    CameraPathReplayResult& result = g_Scene.CameraPathReplayResult;
+    result.NumFrames = RenderStatsGetNumFrames();
+    result.AverageMilliseconds = RenderStatsGetAverageFrameMilliseconds();
+    result.P50Milliseconds = RenderStatsGetFrameMillisecondsPercentile(50.0f);
+    result.P95Milliseconds = RenderStatsGetFrameMillisecondsPercentile(95.0f);
+    result.P99Milliseconds = RenderStatsGetFrameMillisecondsPercentile(99.0f);
+    result.AverageCulledNodes = RenderStatsGetAverageCounter(RENDER_COUNTER_CULLED_NODES);
+    result.AverageCullingMilliseconds = RenderStatsGetAverageCounter(RENDER_COUNTER_CULLING_MICROSECONDS) / 1000.0f;
+
+    printf("Replayed %d frames: avg %.2f ms, p50 %.2f ms, p95 %.2f ms, p99 %.2f ms\n",
+        result.NumFrames, result.AverageMilliseconds, result.P50Milliseconds, result.P95Milliseconds, result.P99Milliseconds);
+    printf("Occlusion culling: avg %.1f nodes culled in %.3f ms\n", result.AverageCulledNodes, result.AverageCullingMilliseconds);
+
+    if (!RenderStatsWriteCSV(kCameraPathReplayCSVPath) || !RenderStatsWriteJSON(kCameraPathReplayJSONPath))
+        fprintf(stderr, "Failed to write %s or %s\n", kCameraPathReplayCSVPath, kCameraPathReplayJSONPath);
+
+    g_Scene.CameraPathMode = CAMERAPATHMODE_FLY;
+}
+
 static void SceneShowToolboxGUI()
 {
     ImGuiIO& io = ImGui::GetIO();
     int w = int(io.DisplaySize.x / io.DisplayFramebufferScale.x);
     int h = int(io.DisplaySize.y / io.DisplayFramebufferScale.y);
 
-    int toolboxW = 300, toolboxH = 300;
+    int toolboxW = 300, toolboxH = 800;
 
     ImGui::SetNextWindowSize(ImVec2((float)toolboxW, (float)toolboxH), ImGuiSetCond_Always);
     ImGui::SetNextWindowPos(ImVec2((float)w - toolboxW, 0), ImGuiSetCond_Always);
@@ -696,18 +1865,107 @@ static void SceneShowToolboxGUI()
         ImGui::RadioButton("128 x 128", &g_Scene.VoxelGridSize, 128);
         ImGui::RadioButton("256 x 256", &g_Scene.VoxelGridSize, 256);
         ImGui::RadioButton("512 x 512", &g_Scene.VoxelGridSize, 512);
-        if (g_Scene.VoxelGridSize != oldGridSize)
+        int oldStorage = g_Scene.VoxelStorage;
+        ImGui::RadioButton("Dense", &g_Scene.VoxelStorage, VOXELSTORAGE_DENSE); ImGui::SameLine();
+        ImGui::RadioButton("Sparse bricks", &g_Scene.VoxelStorage, VOXELSTORAGE_SPARSE);
+        if (g_Scene.VoxelGridSize != oldGridSize || g_Scene.VoxelStorage != oldStorage)
         {
             SceneResizeVoxelGrid(g_Scene.VoxelGridSize);
         }
+        // only changes when the grid is rebuilt
+        ImU32 voxelStatsHash = RetainedGUIHash(&g_Scene.VoxelizeMilliseconds, sizeof(g_Scene.VoxelizeMilliseconds));
+        voxelStatsHash = RetainedGUIHash(&g_Scene.NumOccupiedVoxels, sizeof(g_Scene.NumOccupiedVoxels), voxelStatsHash);
+        voxelStatsHash = RetainedGUIHash(&g_Scene.VoxelMemoryBytes, sizeof(g_Scene.VoxelMemoryBytes), voxelStatsHash);
+        voxelStatsHash = RetainedGUIHash(&g_Scene.VoxelMipMilliseconds, sizeof(g_Scene.VoxelMipMilliseconds), voxelStatsHash);
+        voxelStatsHash = RetainedGUIHash(&g_Scene.VoxelStorage, sizeof(g_Scene.VoxelStorage), voxelStatsHash);
+        if (RetainedGUIBegin("voxel stats", voxelStatsHash))
+        {
+            ImGui::Text("Voxelized in %.1f ms", g_Scene.VoxelizeMilliseconds);
+            ImGui::Text("Occupied voxels: %llu", (unsigned long long)g_Scene.NumOccupiedVoxels);
+            ImGui::Text("Voxel memory: %.1f MB", g_Scene.VoxelMemoryBytes / (1024.0f * 1024.0f));
+            if (g_Scene.VoxelStorage == VOXELSTORAGE_DENSE)
+            {
+                ImGui::Text("Mips built in %.1f ms", g_Scene.VoxelMipMilliseconds);
+            }
+        }
+        RetainedGUIEnd();
+
+        ImGui::Text("Bump to normal maps: %.1f ms", g_Scene.BumpConversionMilliseconds);
+        ImGui::Text("Camera path: %.1f s", CameraPathGetDuration(g_Scene.RecordedCameraPath));
+        if (g_Scene.CameraPathMode == CAMERAPATHMODE_RECORD)
+        {
+            if (ImGui::Button("Stop recording"))
+            {
+                g_Scene.CameraPathMode = CAMERAPATHMODE_FLY;
+                if (!CameraPathSave(kCameraPathPath, g_Scene.RecordedCameraPath))
+                    fprintf(stderr, "Failed to save camera path: %s\n", kCameraPathPath);
+            }
+        }
+        else if (g_Scene.CameraPathMode == CAMERAPATHMODE_REPLAY)
+        {
+            ImGui::Text("Replaying frame %d / %d", g_Scene.CameraPathReplayFrame, g_Scene.CameraPathNumReplayFrames);
+        }
+        else
+        {
+            if (ImGui::Button("Record path"))
+            {
+                g_Scene.CameraPathMode = CAMERAPATHMODE_RECORD;
+                g_Scene.RecordedCameraPath.Keys.clear();
+                g_Scene.CameraPathRecordSeconds = 0.0f;
+            }
+            ImGui::SameLine();
+            if (ImGui::Button("Replay path"))
+            {
+                SceneStartCameraPathReplay();
+            }
+        }
+        if (g_Scene.CameraPathReplayResult.NumFrames != 0)
+        {
+            const CameraPathReplayResult& result = g_Scene.CameraPathReplayResult;
+            ImGui::Text("%d frames: avg %.2f ms", result.NumFrames, result.AverageMilliseconds);
+            ImGui::Text("p50 %.2f ms, p95 %.2f ms, p99 %.2f ms", result.P50Milliseconds, result.P95Milliseconds, result.P99Milliseconds);
+            ImGui::Text("Culled %.1f nodes in %.3f ms", result.AverageCulledNodes, result.AverageCullingMilliseconds);
+        }
+
+        ImGui::Text("Textures: %.1f MB resident, %.1f MB with every mip",
+            TextureStreamingGetResidentSize(g_Scene.TextureStreaming) / (1024.0f * 1024.0f),
+            TextureStreamingGetFullSize(g_Scene.TextureStreaming) / (1024.0f * 1024.0f));
+        ImGui::Text("Texture arrays: %d from %d textures, %d atlas pages",
+            (int)g_Scene.TextureArrays.size(), (int)g_Scene.Textures.size(), g_Scene.NumTextureAtlasPages);
+        ImGui::Text("Binds: %llu SRV + %llu sampler, %llu unpacked",
+            (unsigned long long)RenderStatsGetLastFrameCounter(RENDER_COUNTER_TEXTURE_BINDS),
+            (unsigned long long)RenderStatsGetLastFrameCounter(RENDER_COUNTER_SAMPLER_BINDS),
+            (unsigned long long)(RenderStatsGetLastFrameCounter(RENDER_COUNTER_MATERIAL_SWITCHES) * 2 * TEXTURETYPE_Count));
+        ImGui::Text("Streamed: %llu loads, %llu evictions",
+            (unsigned long long)g_Scene.TextureStreaming.NumLoads,
+            (unsigned long long)g_Scene.TextureStreaming.NumEvictions);
+
+        ImGui::Checkbox("Occlusion culling", &g_Scene.OcclusionCullingEnabled);
+        if (g_Scene.OcclusionCullingEnabled)
+        {
+            ImGui::Text("Occluders: %d triangles", (int)g_Scene.OccluderTriangles.size() / 3);
+            ImGui::Text("Culled: %d / %d nodes", g_Scene.NumCulledSceneNodes, (int)g_Scene.SceneNodes.size());
+            ImGui::Text("Culling time: %.3f ms", g_Scene.OcclusionCullingMilliseconds);
+        }
     }
     ImGui::End();
 }
 
 void ScenePaint(ID3D11RenderTargetView* pBackBufferRTV)
 {
+    PROFILE_ZONE("ScenePaint");
+
     SceneShowToolboxGUI();
 
+    // The replay's frames are the only ones in the stats while it runs
+    if (g_Scene.CameraPathMode == CAMERAPATHMODE_REPLAY)
+    {
+        if (g_Scene.CameraPathReplayFrame == 0)
+            RenderStatsReset(g_Scene.CameraPathNumReplayFrames);
+        else if (g_Scene.CameraPathReplayFrame == g_Scene.CameraPathNumReplayFrames)
+            SceneFinishCameraPathReplay();
+    }
+
     uint64_t currTicks;
     QueryPerformanceCounter((LARGE_INTEGER*)&currTicks);
     
@@ -737,34 +1995,79 @@ void ScenePaint(ID3D11RenderTargetView* pBackBufferRTV)
         float activated = GetAsyncKeyState(VK_RBUTTON) ? 1.0f : 0.0f;
         float up[3] = { 0.0f, 1.0f, 0.0f };
         XMFLOAT4X4 worldView;
-        flythrough_camera_update(
-            &g_Scene.CameraPos.x,
-            &g_Scene.CameraLook.x,
-            up,
-            &worldView.m[0][0],
-            deltaTicks / (float)ticksPerSecond,
-            100.0f * (GetAsyncKeyState(VK_LSHIFT) ? 3.0f : 1.0f) * activated,
-            0.5f * activated,
-            80.0f,
-            currMouseX - g_Scene.LastMouseX, currMouseY - g_Scene.LastMouseY,
-            GetAsyncKeyState('W'), GetAsyncKeyState('A'), GetAsyncKeyState('S'), GetAsyncKeyState('D'),
-            GetAsyncKeyState(VK_SPACE), GetAsyncKeyState(VK_LCONTROL),
-            FLYTHROUGH_CAMERA_LEFT_HANDED_BIT);
+        if (g_Scene.CameraPathMode == CAMERAPATHMODE_REPLAY)
+        {
+            // a fixed timestep, so every replay draws the same views
+            CameraPathSample(g_Scene.RecordedCameraPath, g_Scene.CameraPathReplayFrame * kCameraPathReplayStepSeconds, &g_Scene.CameraPos.x, &g_Scene.CameraLook.x);
+            flythrough_camera_look_to(&g_Scene.CameraPos.x, &g_Scene.CameraLook.x, up, &worldView.m[0][0], FLYTHROUGH_CAMERA_LEFT_HANDED_BIT);
+            g_Scene.CameraPathReplayFrame++;
+        }
+        else
+        {
+            flythrough_camera_update(
+                &g_Scene.CameraPos.x,
+                &g_Scene.CameraLook.x,
+                up,
+                &worldView.m[0][0],
+                deltaTicks / (float)ticksPerSecond,
+                100.0f * (GetAsyncKeyState(VK_LSHIFT) ? 3.0f : 1.0f) * activated,
+                0.5f * activated,
+                80.0f,
+                currMouseX - g_Scene.LastMouseX, currMouseY - g_Scene.LastMouseY,
+                GetAsyncKeyState('W'), GetAsyncKeyState('A'), GetAsyncKeyState('S'), GetAsyncKeyState('D'),
+                GetAsyncKeyState(VK_SPACE), GetAsyncKeyState(VK_LCONTROL),
+                FLYTHROUGH_CAMERA_LEFT_HANDED_BIT);
+        }
+
+        if (g_Scene.CameraPathMode == CAMERAPATHMODE_RECORD)
+        {
+            if (!g_Scene.RecordedCameraPath.Keys.empty())
+                g_Scene.CameraPathRecordSeconds += deltaTicks / (float)ticksPerSecond;
+
+            CameraPathAddKey(&g_Scene.RecordedCameraPath, g_Scene.CameraPathRecordSeconds, &g_Scene.CameraPos.x, &g_Scene.CameraLook.x);
+        }
 
         D3D11_MAPPED_SUBRESOURCE mappedCamera;
         CHECKHR(dc->Map(g_Scene.pCameraBuffer.Get(), 0, D3D11_MAP_WRITE_DISCARD, 0, &mappedCamera));
 
         float aspectWbyH = g_Scene.SceneViewport.Width / g_Scene.SceneViewport.Height;
-        XMMATRIX viewProjection = XMMatrixPerspectiveFovLH(XMConvertToRadians(90.0f), aspectWbyH, 1.0f, 5000.0f);
+        XMMATRIX viewProjection = XMMatrixPerspectiveFovLH(XMConvertToRadians(kCameraFovYDegrees), aspectWbyH, 1.0f, 5000.0f);
         XMMATRIX worldViewProjection = XMMatrixMultiply(XMLoadFloat4x4(&worldView), viewProjection);
+        XMStoreFloat4x4(&g_Scene.WorldViewProjection, worldViewProjection);
 
         PerCameraData* camera = (PerCameraData*)mappedCamera.pData;
         XMStoreFloat4x4(&camera->WorldViewProjection, XMMatrixTranspose(worldViewProjection));
         XMStoreFloat4(&camera->WorldPosition, XMVectorSetW(XMLoadFloat3(&g_Scene.CameraPos),1.0f));
 
         dc->Unmap(g_Scene.pCameraBuffer.Get(), 0);
+
+        RenderStatsAdd(RENDER_COUNTER_CONSTANT_BUFFER_MAPS);
+        RenderStatsAdd(RENDER_COUNTER_BYTES_UPLOADED, sizeof(PerCameraData));
     }
 
+    // Occlusion culling
+    g_Scene.SceneNodeVisible.assign(g_Scene.SceneNodes.size(), true);
+    g_Scene.NumCulledSceneNodes = 0;
+    g_Scene.OcclusionCullingMilliseconds = 0.0f;
+    if (g_Scene.OcclusionCullingEnabled)
+    {
+        PROFILE_ZONE("Occlusion culling");
+
+        uint64_t cullingStartTicks;
+        QueryPerformanceCounter((LARGE_INTEGER*)&cullingStartTicks);
+
+        g_Scene.NumCulledSceneNodes = SceneCullSceneNodes(XMLoadFloat4x4(&g_Scene.WorldViewProjection), &g_Scene.SceneNodeVisible);
+
+        uint64_t cullingEndTicks;
+        QueryPerformanceCounter((LARGE_INTEGER*)&cullingEndTicks);
+        g_Scene.OcclusionCullingMilliseconds = (cullingEndTicks - cullingStartTicks) * 1000.0f / ticksPerSecond;
+    }
+
+    RenderStatsAdd(RENDER_COUNTER_CULLED_NODES, g_Scene.NumCulledSceneNodes);
+    RenderStatsAdd(RENDER_COUNTER_CULLING_MICROSECONDS, (uint64_t)(g_Scene.OcclusionCullingMilliseconds * 1000.0f + 0.5f));
+
+    SceneUpdateTextureStreaming();
+
     const float kClearColor[] = {
         std::pow(100.0f / 255.0f, 2.2f),
         std::pow(149.0f / 255.0f, 2.2f),
@@ -779,7 +2082,6 @@ void ScenePaint(ID3D11RenderTargetView* pBackBufferRTV)
     dc->OMSetRenderTargets(_countof(rtvs), rtvs, dsv);
     
     dc->VSSetShader(g_Scene.SceneVS->VS, NULL, 0);
-    dc->PSSetShader(g_Scene.ScenePS->PS, NULL, 0);
     dc->IASetPrimitiveTopology(D3D11_PRIMITIVE_TOPOLOGY_TRIANGLELIST);
     dc->IASetInputLayout(g_Scene.pSceneInputLayout.Get());
     dc->RSSetState(g_Scene.pSceneRasterizerState.Get());
@@ -791,57 +2093,52 @@ void ScenePaint(ID3D11RenderTargetView* pBackBufferRTV)
     dc->VSSetConstantBuffers(CAMERA_BUFFER_SLOT, 1, &cameraCBV);
     dc->PSSetConstantBuffers(CAMERA_BUFFER_SLOT, 1, &cameraCBV);
 
+    // every material samples its textures with the same samplers, so they are bound once
+    ID3D11SamplerState* samplers[TEXTURETYPE_Count] = { g_Scene.pDiffuseSampler.Get(), g_Scene.pSpecularSampler.Get(), g_Scene.pBumpSampler.Get() };
+    for (int type = 0; type < TEXTURETYPE_Count; type++)
+    {
+        dc->PSSetSamplers(kTextureTypeToSamplerSlot[type], 1, &samplers[type]);
+        RenderStatsAdd(RENDER_COUNTER_SAMPLER_BINDS);
+    }
+
+    ID3D11ShaderResourceView* materialTableSRV = g_Scene.pMaterialTableSRV.Get();
+    dc->PSSetShaderResources(MATERIAL_TABLE_SLOT, 1, &materialTableSRV);
+
+    int boundArrayIDs[TEXTURETYPE_Count] = { -1, -1, -1 };
+
     int currMaterialID = -1;
     for (int sceneNodeID = 0; sceneNodeID < (int)g_Scene.SceneNodes.size(); sceneNodeID++)
     {
         SceneNode& sceneNode = g_Scene.SceneNodes[sceneNodeID];
 
-        // Update Material CBV
+        if (!g_Scene.SceneNodeVisible[sceneNodeID])
+        {
+            continue;
+        }
+
+        // Switch material
         if (currMaterialID != sceneNode.MaterialID)
         {
             const Material& material = g_Scene.Materials[sceneNode.MaterialID];
 
-            D3D11_MAPPED_SUBRESOURCE mapped;
-            dc->Map(g_Scene.pMaterialBuffer.Get(), 0, D3D11_MAP_WRITE_DISCARD, 0, &mapped);
-
-            PerMaterialData* materialData = (PerMaterialData*)mapped.pData;
-            XMStoreFloat4(&materialData->Ambient, XMLoadFloat3(&material.Ambient));
-            XMStoreFloat4(&materialData->Diffuse, XMLoadFloat3(&material.Diffuse));
-            XMStoreFloat4(&materialData->Specular, XMLoadFloat3(&material.Specular));
-            XMStoreFloat4(&materialData->Shininess, XMVectorReplicate(material.Shininess));
-            XMStoreFloat4(&materialData->Opacity, XMVectorReplicate(material.Opacity));
-            XMStoreFloat4(&materialData->HasDiffuse, XMVectorReplicate(material.DiffuseTextureID != -1 ? 1.0f : 0.0f));
-            XMStoreFloat4(&materialData->HasSpecular, XMVectorReplicate(material.SpecularTextureID != -1 ? 1.0f : 0.0f));
-            XMStoreFloat4(&materialData->HasBump, XMVectorReplicate(material.BumpTextureID != -1 ? 1.0f : 0.0f));
-
-            dc->Unmap(g_Scene.pMaterialBuffer.Get(), 0);
-            
-            ID3D11Buffer* materialCBV = g_Scene.pMaterialBuffer.Get();
-            dc->PSSetConstantBuffers(MATERIAL_BUFFER_SLOT, 1, &materialCBV);
-
-            ID3D11ShaderResourceView* diffuseSRV = NULL;
-            if (material.DiffuseTextureID != -1)
-                diffuseSRV = g_Scene.Textures[material.DiffuseTextureID].SRV.Get();
-            dc->PSSetShaderResources(DIFFUSE_TEXTURE_SLOT, 1, &diffuseSRV);
+            dc->PSSetShader(g_Scene.ScenePS[material.ShaderPermutation]->PS, NULL, 0);
 
-            ID3D11SamplerState* diffuseSMP = g_Scene.pDiffuseSampler.Get();
-            dc->PSSetSamplers(DIFFUSE_SAMPLER_SLOT, 1, &diffuseSMP);
+            RenderStatsAdd(RENDER_COUNTER_MATERIAL_SWITCHES);
 
-            ID3D11ShaderResourceView* specularSRV = NULL;
-            if (material.SpecularTextureID != -1)
-                specularSRV = g_Scene.Textures[material.SpecularTextureID].SRV.Get();
-            dc->PSSetShaderResources(SPECULAR_TEXTURE_SLOT, 1, &specularSRV);
+            int textureIDs[TEXTURETYPE_Count] = { material.DiffuseTextureID, material.SpecularTextureID, material.BumpTextureID };
 
-            ID3D11SamplerState* specularSMP = g_Scene.pSpecularSampler.Get();
-            dc->PSSetSamplers(SPECULAR_SAMPLER_SLOT, 1, &specularSMP);
+            // the permutations without a texture don't sample its slot, so it keeps whatever array is bound
+            for (int type = 0; type < TEXTURETYPE_Count; type++)
+            {
+                if (textureIDs[type] == -1 || boundArrayIDs[type] == g_Scene.Textures[textureIDs[type]].Placement.ArrayID)
+                    continue;
 
-            ID3D11ShaderResourceView* bumpSRV = NULL;
-            if (material.BumpTextureID != -1)
-                bumpSRV = g_Scene.Textures[material.BumpTextureID].SRV.Get();
-            dc->PSSetShaderResources(BUMP_TEXTURE_SLOT, 1, &bumpSRV);
+                boundArrayIDs[type] = g_Scene.Textures[textureIDs[type]].Placement.ArrayID;
+                ID3D11ShaderResourceView* srv = g_Scene.TextureArrays[boundArrayIDs[type]].SRV.Get();
+                dc->PSSetShaderResources(kTextureTypeToSlot[type], 1, &srv);
 
-            ID3D11SamplerState* bumpSMP = g_Scene.pBumpSampler.Get();
-            dc->PSSetSamplers(BUMP_SAMPLER_SLOT, 1, &bumpSMP);
+                RenderStatsAdd(RENDER_COUNTER_TEXTURE_BINDS);
+            }
 
             currMaterialID = sceneNode.MaterialID;
         }
@@ -853,10 +2150,7 @@ void ScenePaint(ID3D11RenderTargetView* pBackBufferRTV)
 
             PerSceneNodeData* sceneNodeData = (PerSceneNodeData*)mapped.pData;
             
-            XMMATRIX worldMatrix = XMMatrixIdentity();
-            worldMatrix = XMMatrixMultiply(worldMatrix, XMMatrixScalingFromVector(sceneNode.Transform.Scale));
-            worldMatrix = XMMatrixMultiply(worldMatrix, XMMatrixRotationQuaternion(sceneNode.Transform.Quaternion));
-            worldMatrix = XMMatrixMultiply(worldMatrix, XMMatrixTranslationFromVector(sceneNode.Transform.Translation));
+            XMMATRIX worldMatrix = SceneNodeWorldMatrix(sceneNode);
             XMStoreFloat4x4(&sceneNodeData->WorldTransform, XMMatrixTranspose(worldMatrix));
 
             XMMATRIX normalMatrix = XMMatrixIdentity();
@@ -864,8 +2158,14 @@ void ScenePaint(ID3D11RenderTargetView* pBackBufferRTV)
             normalMatrix = XMMatrixMultiply(normalMatrix, XMMatrixRotationQuaternion(sceneNode.Transform.Quaternion));
             XMStoreFloat4x4(&sceneNodeData->NormalTransform, XMMatrixTranspose(normalMatrix));
 
+            sceneNodeData->MaterialID = XMUINT4(g_Scene.MaterialTableEntries[sceneNode.MaterialID], 0, 0, 0);
+
             dc->Unmap(g_Scene.pSceneNodeBuffer.Get(), 0);
 
+            RenderStatsAdd(RENDER_COUNTER_NODE_CONSTANT_UPDATES);
+            RenderStatsAdd(RENDER_COUNTER_CONSTANT_BUFFER_MAPS);
+            RenderStatsAdd(RENDER_COUNTER_BYTES_UPLOADED, sizeof(PerSceneNodeData));
+
             ID3D11Buffer* sceneNodeCBV = g_Scene.pSceneNodeBuffer.Get();
             dc->VSSetConstantBuffers(SCENENODE_BUFFER_SLOT, 1, &sceneNodeCBV);
         }
@@ -895,6 +2195,9 @@ void ScenePaint(ID3D11RenderTargetView* pBackBufferRTV)
             dc->IASetIndexBuffer(staticMesh.pIndexBuffer.Get(), DXGI_FORMAT_R32_UINT, 0);
 
             dc->DrawIndexed(staticMesh.IndexCountPerInstance, staticMesh.StartIndexLocation, 0);
+
+            RenderStatsAdd(RENDER_COUNTER_DRAWS);
+            RenderStatsAdd(RENDER_COUNTER_INDICES, staticMesh.IndexCountPerInstance);
         }
     }
     
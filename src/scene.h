@@ -4,6 +4,9 @@
 
 void SceneInit();
 
+// Stops the texture streaming thread.
+void SceneExit();
+
 void SceneUpdate();
 
 void SceneResize(
@@ -0,0 +1,306 @@
+#include "shadercache.h"
+
+#include <fstream>
+#include <sstream>
+#include <algorithm>
+#include <cstring>
+#include <cstdio>
+
+#ifdef _WIN32
+#define NOMINMAX
+#define WIN32_LEAN_AND_MEAN
+#include <Windows.h>
+#endif
+
+static const uint32_t kShaderCacheMagic = 0x48435344; // "DSCH"
+static const uint32_t kShaderCacheVersion = 1;
+
+struct ShaderCacheFileHeader
+{
+    uint32_t Magic;
+    uint32_t Version;
+    uint32_t NumEntries;
+    uint32_t Reserved;
+};
+
+struct ShaderCacheFileIndexEntry
+{
+    uint64_t Key;
+    uint64_t Offset; // from the start of the file
+    uint64_t Size;
+};
+
+bool ShaderCacheReadFile(const std::string& path, std::string* pContents)
+{
+    std::ifstream file(path, std::ios::binary);
+    if (!file)
+        return false;
+
+    std::ostringstream contents;
+    contents << file.rdbuf();
+    *pContents = contents.str();
+    return true;
+}
+
+static std::string ShaderCacheGetFolder(const std::string& path)
+{
+    size_t slash = path.find_last_of("/\\");
+    return slash == std::string::npos ? std::string() : path.substr(0, slash + 1);
+}
+
+// Finds the quoted file names of the #include directives in the source.
+// Doesn't evaluate #if, so an include that is disabled still counts as a dependency.
+static void ShaderCacheParseIncludes(const std::string& source, std::vector<std::string>* pIncludes)
+{
+    size_t lineStart = 0;
+    while (lineStart < source.size())
+    {
+        size_t lineEnd = source.find('\n', lineStart);
+        if (lineEnd == std::string::npos)
+            lineEnd = source.size();
+
+        size_t i = lineStart;
+        while (i < lineEnd && (source[i] == ' ' || source[i] == '\t'))
+            i++;
+
+        if (i < lineEnd && source[i] == '#')
+        {
+            i++;
+            while (i < lineEnd && (source[i] == ' ' || source[i] == '\t'))
+                i++;
+
+            static const char kInclude[] = "include";
+            if (source.compare(i, sizeof(kInclude) - 1, kInclude) == 0)
+            {
+                size_t open = source.find('"', i);
+                size_t close = open == std::string::npos ? std::string::npos : source.find('"', open + 1);
+                if (close != std::string::npos && close < lineEnd)
+                {
+                    pIncludes->push_back(source.substr(open + 1, close - open - 1));
+                }
+            }
+        }
+
+        lineStart = lineEnd + 1;
+    }
+}
+
+void ShaderCacheCollectIncludes(
+    const std::string& path,
+    const ShaderCacheReadFileFunc& readFile,
+    std::vector<std::string>* pFiles)
+{
+    pFiles->clear();
+    pFiles->push_back(path);
+
+    // pFiles doubles as the work queue
+    for (size_t fileIndex = 0; fileIndex < pFiles->size(); fileIndex++)
+    {
+        std::string file = (*pFiles)[fileIndex];
+
+        std::string source;
+        if (!readFile(file, &source))
+            continue;
+
+        std::vector<std::string> includes;
+        ShaderCacheParseIncludes(source, &includes);
+
+        std::string folder = ShaderCacheGetFolder(file);
+        for (const std::string& include : includes)
+        {
+            std::string includePath = folder + include;
+            if (std::find(pFiles->begin(), pFiles->end(), includePath) == pFiles->end())
+            {
+                pFiles->push_back(includePath);
+            }
+        }
+    }
+}
+
+uint64_t ShaderCacheHash(const void* data, size_t size, uint64_t hash)
+{
+    // FNV-1a
+    const uint8_t* bytes = (const uint8_t*)data;
+    for (size_t i = 0; i < size; i++)
+    {
+        hash = (hash ^ bytes[i]) * 0x100000001B3ull;
+    }
+    return hash;
+}
+
+static uint64_t ShaderCacheHashString(const std::string& s, uint64_t hash)
+{
+    // hash the length too, so that concatenations of different strings can't collide
+    uint64_t length = s.size();
+    hash = ShaderCacheHash(&length, sizeof(length), hash);
+    return ShaderCacheHash(s.data(), s.size(), hash);
+}
+
+uint64_t ShaderCacheComputeKey(
+    const ShaderCacheKeyDesc& desc,
+    const ShaderCacheReadFileFunc& readFile,
+    std::vector<std::string>* pIncludedFiles)
+{
+    // Remember what was read while collecting includes, so every file is only read once
+    std::unordered_map<std::string, std::string> sources;
+    auto readFileOnce = [&](const std::string& path, std::string* pContents)
+    {
+        std::string source;
+        if (!readFile(path, &source))
+            return false;
+
+        *pContents = source;
+        sources[path].swap(source);
+        return true;
+    };
+
+    std::vector<std::string> files;
+    ShaderCacheCollectIncludes(desc.Path, readFileOnce, &files);
+
+    uint64_t hash = ShaderCacheHash(&kShaderCacheVersion, sizeof(kShaderCacheVersion));
+    hash = ShaderCacheHashString(desc.EntryPoint, hash);
+    hash = ShaderCacheHashString(desc.Target, hash);
+    hash = ShaderCacheHash(&desc.Flags, sizeof(desc.Flags), hash);
+
+    uint64_t numDefines = desc.Defines.size();
+    hash = ShaderCacheHash(&numDefines, sizeof(numDefines), hash);
+    for (const ShaderDefine& define : desc.Defines)
+    {
+        hash = ShaderCacheHashString(define.Name, hash);
+        hash = ShaderCacheHashString(define.Value, hash);
+    }
+
+    for (const std::string& file : files)
+    {
+        auto source = sources.find(file);
+        bool found = source != sources.end();
+
+        hash = ShaderCacheHashString(file, hash);
+        hash = ShaderCacheHash(&found, sizeof(found), hash);
+        if (found)
+            hash = ShaderCacheHashString(source->second, hash);
+    }
+
+    if (pIncludedFiles)
+        pIncludedFiles->swap(files);
+
+    return hash;
+}
+
+void ShaderCacheOpen(const char* path, ShaderCache* pCache)
+{
+    pCache->Path = path;
+    pCache->Entries.clear();
+    pCache->Dirty = false;
+
+    std::string contents;
+    if (!ShaderCacheReadFile(path, &contents))
+        return;
+
+    ShaderCacheFileHeader header;
+    if (contents.size() < sizeof(header))
+        return;
+
+    memcpy(&header, contents.data(), sizeof(header));
+    if (header.Magic != kShaderCacheMagic || header.Version != kShaderCacheVersion)
+        return;
+
+    uint64_t indexEnd = sizeof(header) + (uint64_t)header.NumEntries * sizeof(ShaderCacheFileIndexEntry);
+    if (indexEnd > contents.size())
+        return;
+
+    for (uint32_t i = 0; i < header.NumEntries; i++)
+    {
+        ShaderCacheFileIndexEntry indexEntry;
+        memcpy(&indexEntry, contents.data() + sizeof(header) + i * sizeof(indexEntry), sizeof(indexEntry));
+
+        // a truncated file invalidates the whole cache rather than trusting part of it.
+        // The size is checked against what is left after the offset, so a corrupt size can't wrap around.
+        if (indexEntry.Offset < indexEnd || indexEntry.Offset > contents.size() || indexEntry.Size > contents.size() - indexEntry.Offset)
+        {
+            pCache->Entries.clear();
+            return;
+        }
+
+        ShaderCacheEntry& entry = pCache->Entries[indexEntry.Key];
+        const uint8_t* pBlob = (const uint8_t*)contents.data() + indexEntry.Offset;
+        entry.Blob.assign(pBlob, pBlob + indexEntry.Size);
+        entry.Used = false;
+    }
+}
+
+const std::vector<uint8_t>* ShaderCacheFind(ShaderCache* pCache, uint64_t key)
+{
+    auto found = pCache->Entries.find(key);
+    if (found == pCache->Entries.end())
+        return NULL;
+
+    found->second.Used = true;
+    return &found->second.Blob;
+}
+
+void ShaderCacheInsert(ShaderCache* pCache, uint64_t key, const void* blob, size_t size)
+{
+    ShaderCacheEntry& entry = pCache->Entries[key];
+    entry.Blob.assign((const uint8_t*)blob, (const uint8_t*)blob + size);
+    entry.Used = true;
+    pCache->Dirty = true;
+}
+
+bool ShaderCacheSave(ShaderCache* pCache)
+{
+    // sorted for a deterministic file
+    std::vector<uint64_t> keys;
+    for (const auto& keyEntry : pCache->Entries)
+    {
+        if (keyEntry.second.Used)
+            keys.push_back(keyEntry.first);
+    }
+    std::sort(keys.begin(), keys.end());
+
+    ShaderCacheFileHeader header = {};
+    header.Magic = kShaderCacheMagic;
+    header.Version = kShaderCacheVersion;
+    header.NumEntries = (uint32_t)keys.size();
+
+    std::vector<ShaderCacheFileIndexEntry> index(keys.size());
+    uint64_t offset = sizeof(header) + index.size() * sizeof(ShaderCacheFileIndexEntry);
+    for (size_t i = 0; i < keys.size(); i++)
+    {
+        index[i].Key = keys[i];
+        index[i].Offset = offset;
+        index[i].Size = pCache->Entries[keys[i]].Blob.size();
+        offset += index[i].Size;
+    }
+
+    std::string tempPath = pCache->Path + ".tmp";
+    {
+        std::ofstream file(tempPath, std::ios::binary | std::ios::trunc);
+        if (!file)
+            return false;
+
+        file.write((const char*)&header, sizeof(header));
+        if (!index.empty())
+            file.write((const char*)index.data(), index.size() * sizeof(index[0]));
+        for (uint64_t key : keys)
+        {
+            const std::vector<uint8_t>& blob = pCache->Entries[key].Blob;
+            if (!blob.empty())
+                file.write((const char*)blob.data(), blob.size());
+        }
+
+        if (!file.flush())
+            return false;
+    }
+
+#ifdef _WIN32
+    if (!MoveFileExA(tempPath.c_str(), pCache->Path.c_str(), MOVEFILE_REPLACE_EXISTING | MOVEFILE_WRITE_THROUGH))
+        return false;
+#else
+    if (std::rename(tempPath.c_str(), pCache->Path.c_str()) != 0)
+        return false;
+#endif
+
+    pCache->Dirty = false;
+    return true;
+}
\ No newline at end of file
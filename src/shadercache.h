@@ -0,0 +1,77 @@
+#pragma once
+
+#include <string>
+#include <vector>
+#include <unordered_map>
+#include <functional>
+#include <cstdint>
+
+// Persistent cache of compiled shader blobs.
+// Blobs are addressed by a hash of everything that affects compilation: the source of the shader and
+// every file it transitively includes, the entry point, the target and the compile flags.
+// All blobs live in a single indexed file, which is replaced atomically when saved.
+// Nothing here depends on the shader compiler or on Windows.
+
+// Reads a whole file. Returns false if it can't be read.
+typedef std::function<bool(const std::string& path, std::string* pContents)> ShaderCacheReadFileFunc;
+
+bool ShaderCacheReadFile(const std::string& path, std::string* pContents);
+
+// Finds the shader file and every file it transitively includes with #include "file",
+// resolved relative to the including file's folder like D3D_COMPILE_STANDARD_FILE_INCLUDE.
+// The shader itself is first. Files that can't be read are still listed.
+void ShaderCacheCollectIncludes(
+    const std::string& path,
+    const ShaderCacheReadFileFunc& readFile,
+    std::vector<std::string>* pFiles);
+
+// A preprocessor macro passed to the compiler, like D3D_SHADER_MACRO.
+struct ShaderDefine
+{
+    std::string Name;
+    std::string Value;
+};
+
+struct ShaderCacheKeyDesc
+{
+    std::string Path;
+    std::string EntryPoint;
+    std::string Target;
+    std::vector<ShaderDefine> Defines; // in the order they are passed to the compiler
+    uint32_t Flags;
+};
+
+uint64_t ShaderCacheHash(const void* data, size_t size, uint64_t hash = 0xCBF29CE484222325ull);
+
+// Hashes the contents of the shader's include closure along with its compile parameters and defines.
+uint64_t ShaderCacheComputeKey(
+    const ShaderCacheKeyDesc& desc,
+    const ShaderCacheReadFileFunc& readFile,
+    std::vector<std::string>* pIncludedFiles = NULL);
+
+struct ShaderCacheEntry
+{
+    std::vector<uint8_t> Blob;
+    bool Used; // found or inserted since the cache was opened
+};
+
+struct ShaderCache
+{
+    std::string Path;
+    std::unordered_map<uint64_t, ShaderCacheEntry> Entries;
+    bool Dirty;
+};
+
+// Loads the cache file, starting empty if it is missing or invalid.
+void ShaderCacheOpen(const char* path, ShaderCache* pCache);
+
+// Returns NULL on a miss.
+const std::vector<uint8_t>* ShaderCacheFind(ShaderCache* pCache, uint64_t key);
+
+void ShaderCacheInsert(ShaderCache* pCache, uint64_t key, const void* blob, size_t size);
+
+// Writes the cache to a temporary file and renames it over the cache file, so a crash never leaves a torn cache.
+// Entries that weren't used since the cache was opened are dropped, since they belong to stale versions of shaders.
+// Only inserts make the cache dirty, so an unchanged cache isn't rewritten on every launch.
+// Returns false if the file couldn't be written.
+bool ShaderCacheSave(ShaderCache* pCache);
\ No newline at end of file
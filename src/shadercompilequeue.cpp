@@ -0,0 +1,180 @@
+#include "shadercompilequeue.h"
+
+#include "parallel.h"
+#include "profiler.h"
+
+#include <mutex>
+#include <condition_variable>
+#include <unordered_map>
+#include <deque>
+#include <thread>
+#include <cstdint>
+
+struct ShaderCompileJob
+{
+    int Entry;
+    uint64_t Generation;
+    ShaderCompileFunc Compile;
+};
+
+struct ShaderCompileFinishedJob
+{
+    int Entry;
+    uint64_t Generation;
+    std::shared_ptr<void> Shader;
+};
+
+struct ShaderCompileQueue
+{
+    std::mutex Mutex;
+    std::condition_variable JobQueued;
+    std::condition_variable JobFinished;
+
+    std::deque<ShaderCompileJob> Jobs;
+    std::vector<ShaderCompileFinishedJob> FinishedJobs;
+
+    // the generation of the latest submission for each entry
+    std::unordered_map<int, uint64_t> LatestGenerations;
+
+    int NumRunningJobs;
+    bool Quit;
+
+    std::vector<std::thread> Workers;
+};
+
+static bool ShaderCompileQueueIsLatest(const ShaderCompileQueue* pQueue, int entry, uint64_t generation)
+{
+    return pQueue->LatestGenerations.at(entry) == generation;
+}
+
+static void ShaderCompileQueueWorker(ShaderCompileQueue* pQueue)
+{
+    ProfilerSetThreadName("Shader compiler");
+
+    std::unique_lock<std::mutex> lock(pQueue->Mutex);
+
+    for (;;)
+    {
+        pQueue->JobQueued.wait(lock, [pQueue] { return pQueue->Quit || !pQueue->Jobs.empty(); });
+        if (pQueue->Quit)
+            return;
+
+        ShaderCompileJob job = std::move(pQueue->Jobs.front());
+        pQueue->Jobs.pop_front();
+        pQueue->NumRunningJobs++;
+
+        lock.unlock();
+        std::shared_ptr<void> shader = job.Compile();
+        lock.lock();
+
+        pQueue->NumRunningJobs--;
+
+        // failed compiles keep the previous shader, and overtaken ones are replaced by a newer compile
+        if (shader && ShaderCompileQueueIsLatest(pQueue, job.Entry, job.Generation))
+        {
+            ShaderCompileFinishedJob finishedJob;
+            finishedJob.Entry = job.Entry;
+            finishedJob.Generation = job.Generation;
+            finishedJob.Shader = std::move(shader);
+            pQueue->FinishedJobs.push_back(std::move(finishedJob));
+        }
+
+        pQueue->JobFinished.notify_all();
+    }
+}
+
+ShaderCompileQueue* ShaderCompileQueueCreate(int numThreads)
+{
+    if (numThreads <= 0)
+    {
+        numThreads = ParallelGetDefaultNumThreads() - 1;
+        if (numThreads < 1)
+            numThreads = 1;
+    }
+
+    ShaderCompileQueue* pQueue = new ShaderCompileQueue();
+    pQueue->NumRunningJobs = 0;
+    pQueue->Quit = false;
+
+    for (int threadIndex = 0; threadIndex < numThreads; threadIndex++)
+    {
+        pQueue->Workers.emplace_back(ShaderCompileQueueWorker, pQueue);
+    }
+
+    return pQueue;
+}
+
+void ShaderCompileQueueDestroy(ShaderCompileQueue* pQueue)
+{
+    {
+        std::lock_guard<std::mutex> lock(pQueue->Mutex);
+        pQueue->Jobs.clear();
+        pQueue->Quit = true;
+    }
+    pQueue->JobQueued.notify_all();
+
+    for (std::thread& worker : pQueue->Workers)
+    {
+        worker.join();
+    }
+
+    delete pQueue;
+}
+
+void ShaderCompileQueueSubmit(ShaderCompileQueue* pQueue, int entry, const ShaderCompileFunc& compile)
+{
+    {
+        std::lock_guard<std::mutex> lock(pQueue->Mutex);
+
+        uint64_t generation = ++pQueue->LatestGenerations[entry];
+
+        // a compile that hasn't started yet would only be dropped when it finishes, so reuse its place in line
+        for (ShaderCompileJob& job : pQueue->Jobs)
+        {
+            if (job.Entry == entry)
+            {
+                job.Generation = generation;
+                job.Compile = compile;
+                return;
+            }
+        }
+
+        ShaderCompileJob job;
+        job.Entry = entry;
+        job.Generation = generation;
+        job.Compile = compile;
+        pQueue->Jobs.push_back(std::move(job));
+    }
+    pQueue->JobQueued.notify_one();
+}
+
+void ShaderCompileQueueCollect(ShaderCompileQueue* pQueue, std::vector<ShaderCompileResult>* pResults)
+{
+    std::lock_guard<std::mutex> lock(pQueue->Mutex);
+
+    for (ShaderCompileFinishedJob& finishedJob : pQueue->FinishedJobs)
+    {
+        // a result can be overtaken by a submission made after it finished
+        if (!ShaderCompileQueueIsLatest(pQueue, finishedJob.Entry, finishedJob.Generation))
+            continue;
+
+        ShaderCompileResult result;
+        result.Entry = finishedJob.Entry;
+        result.Shader = std::move(finishedJob.Shader);
+        pResults->push_back(std::move(result));
+    }
+
+    pQueue->FinishedJobs.clear();
+}
+
+void ShaderCompileQueueWaitIdle(ShaderCompileQueue* pQueue)
+{
+    std::unique_lock<std::mutex> lock(pQueue->Mutex);
+    pQueue->JobFinished.wait(lock, [pQueue] { return pQueue->Jobs.empty() && pQueue->NumRunningJobs == 0; });
+}
+
+int ShaderCompileQueueGetNumPending(ShaderCompileQueue* pQueue)
+{
+    std::lock_guard<std::mutex> lock(pQueue->Mutex);
+    return (int)pQueue->Jobs.size() + pQueue->NumRunningJobs;
+}
\ No newline at end of file
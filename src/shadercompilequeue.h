@@ -0,0 +1,40 @@
+#pragma once
+
+#include <functional>
+#include <memory>
+#include <vector>
+
+// Runs shader compiles on worker threads so that a hot reload never stalls a frame.
+// Every compile belongs to an entry (a shader), and compiles of different entries run in parallel.
+// Only the latest submission for an entry is published: a submission replaces the queued one for
+// the same entry, and results of submissions that were overtaken while running are dropped.
+// Results wait in the queue until the render thread collects them at a frame boundary and swaps them in,
+// so a frame only ever sees a shader from before or after a reload, never a mix of both.
+// Nothing here depends on the shader compiler or on Windows.
+
+struct ShaderCompileQueue;
+
+// Runs on a worker thread. Returns the compiled shader, or NULL if compilation failed.
+typedef std::function<std::shared_ptr<void>()> ShaderCompileFunc;
+
+struct ShaderCompileResult
+{
+    int Entry;
+    std::shared_ptr<void> Shader;
+};
+
+ShaderCompileQueue* ShaderCompileQueueCreate(int numThreads = 0); // 0 leaves one hardware thread for rendering
+
+// Waits for the running compiles and discards the queued ones.
+void ShaderCompileQueueDestroy(ShaderCompileQueue* pQueue);
+
+void ShaderCompileQueueSubmit(ShaderCompileQueue* pQueue, int entry, const ShaderCompileFunc& compile);
+
+// Doesn't block. Appends the results finished since the last collect, at most one per entry.
+void ShaderCompileQueueCollect(ShaderCompileQueue* pQueue, std::vector<ShaderCompileResult>* pResults);
+
+// Blocks until every submitted compile is finished, for when the shaders are needed right away.
+void ShaderCompileQueueWaitIdle(ShaderCompileQueue* pQueue);
+
+// Compiles that are queued or running.
+int ShaderCompileQueueGetNumPending(ShaderCompileQueue* pQueue);
\ No newline at end of file
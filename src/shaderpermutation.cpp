@@ -0,0 +1,48 @@
+#include "shaderpermutation.h"
+
+#include <algorithm>
+
+const char* const kMaterialFeatureDefines[kNumMaterialFeatures] = {
+    "HAS_DIFFUSE_TEXTURE",
+    "HAS_SPECULAR_TEXTURE",
+    "HAS_BUMP_TEXTURE",
+};
+
+void ShaderPermutationGetDefines(
+    const char* const* featureDefines, int numFeatures,
+    uint32_t permutation,
+    std::vector<ShaderDefine>* pDefines)
+{
+    pDefines->clear();
+
+    for (int feature = 0; feature < numFeatures; feature++)
+    {
+        ShaderDefine define;
+        define.Name = featureDefines[feature];
+        define.Value = (permutation & (1u << feature)) ? "1" : "0";
+        pDefines->push_back(define);
+    }
+}
+
+uint32_t ShaderPermutationSelectMaterial(int diffuseTextureID, int specularTextureID, int bumpTextureID)
+{
+    uint32_t permutation = 0;
+
+    if (diffuseTextureID != -1)
+        permutation |= MATERIAL_FEATURE_DIFFUSE_TEXTURE;
+
+    if (specularTextureID != -1)
+        permutation |= MATERIAL_FEATURE_SPECULAR_TEXTURE;
+
+    if (bumpTextureID != -1)
+        permutation |= MATERIAL_FEATURE_BUMP_TEXTURE;
+
+    return permutation;
+}
+
+void ShaderPermutationCollectUsed(const std::vector<uint32_t>& permutations, std::vector<uint32_t>* pUsed)
+{
+    *pUsed = permutations;
+    std::sort(pUsed->begin(), pUsed->end());
+    pUsed->erase(std::unique(pUsed->begin(), pUsed->end()), pUsed->end());
+}
\ No newline at end of file
@@ -0,0 +1,36 @@
+#pragma once
+
+#include "shadercache.h"
+
+#include <vector>
+#include <cstdint>
+
+// Compile-time shader permutations.
+// A permutation is a bitmask of features. Each feature is a define that is 1 when its bit is set and 0 otherwise,
+// so shaders test features with #if instead of branching on constants at runtime.
+// Nothing here depends on the shader compiler or on Windows.
+
+enum MaterialFeature
+{
+    MATERIAL_FEATURE_DIFFUSE_TEXTURE = 1 << 0,
+    MATERIAL_FEATURE_SPECULAR_TEXTURE = 1 << 1,
+    MATERIAL_FEATURE_BUMP_TEXTURE = 1 << 2,
+};
+
+static const int kNumMaterialFeatures = 3;
+static const int kNumMaterialPermutations = 1 << kNumMaterialFeatures;
+
+// Indexed by the bit of each MaterialFeature.
+extern const char* const kMaterialFeatureDefines[kNumMaterialFeatures];
+
+// Every feature gets a define, so the defines are the same for a permutation no matter how it was built.
+void ShaderPermutationGetDefines(
+    const char* const* featureDefines, int numFeatures,
+    uint32_t permutation,
+    std::vector<ShaderDefine>* pDefines);
+
+// Texture IDs are -1 for textures the material doesn't have.
+uint32_t ShaderPermutationSelectMaterial(int diffuseTextureID, int specularTextureID, int bumpTextureID);
+
+// The distinct permutations in a list, sorted, so only the ones in use get compiled.
+void ShaderPermutationCollectUsed(const std::vector<uint32_t>& permutations, std::vector<uint32_t>* pUsed);
\ No newline at end of file
@@ -0,0 +1,316 @@
+#include "telemetry.h"
+
+#include "profiler.h"
+
+#include <mutex>
+#include <condition_variable>
+#include <atomic>
+#include <thread>
+#include <chrono>
+#include <fstream>
+#include <sstream>
+#include <string>
+#include <iterator>
+#include <cstring>
+#include <cstdio>
+
+#if defined(_WIN32)
+#include "dxutil.h"
+#include <Psapi.h>
+#include <intrin.h>
+#else
+#include <cpuid.h>
+#include <unistd.h>
+#endif
+
+// Set in the shared slot when the sampler put a snapshot there that the reader hasn't taken yet.
+static const int kTelemetryNewSnapshotBit = 4;
+
+struct Telemetry
+{
+    TelemetryAdapterFunc SampleAdapter;
+
+    std::mutex Mutex; // guards the settings, the log and Quit
+    std::condition_variable Wake;
+    double IntervalSeconds;
+    std::ofstream Log;
+    bool Quit;
+
+    std::atomic<uint64_t> NumFrames;
+    std::atomic<uint64_t> FrameMicroseconds;
+
+    TelemetrySnapshot Slots[3];
+    int SamplerSlot; // only used by the sampler
+    int ReaderSlot; // only used by the reader
+    std::atomic<int> SharedSlot;
+
+    std::chrono::steady_clock::time_point CreateTime;
+    std::thread Sampler;
+};
+
+void TelemetryGetCPUBrand(char brand[0x40])
+{
+    memset(brand, 0, 0x40);
+
+    for (unsigned int leaf = 0; leaf < 3; leaf++)
+    {
+        int cpuInfo[4] = { 0 };
+#if defined(_WIN32)
+        __cpuid(cpuInfo, 0x80000002 + leaf);
+#else
+        __get_cpuid(0x80000002 + leaf, (unsigned int*)&cpuInfo[0], (unsigned int*)&cpuInfo[1], (unsigned int*)&cpuInfo[2], (unsigned int*)&cpuInfo[3]);
+#endif
+        memcpy(brand + leaf * 16, cpuInfo, sizeof(cpuInfo));
+    }
+
+    brand[0x3F] = '\0';
+}
+
+bool TelemetryQueryProcess(double* pCPUSeconds, uint64_t* pResidentBytes)
+{
+#if defined(_WIN32)
+    FILETIME creationTime, exitTime, kernelTime, userTime;
+    if (!GetProcessTimes(GetCurrentProcess(), &creationTime, &exitTime, &kernelTime, &userTime))
+        return false;
+
+    // in units of 100 nanoseconds
+    uint64_t kernel = ((uint64_t)kernelTime.dwHighDateTime << 32) | kernelTime.dwLowDateTime;
+    uint64_t user = ((uint64_t)userTime.dwHighDateTime << 32) | userTime.dwLowDateTime;
+    *pCPUSeconds = (kernel + user) * 1e-7;
+
+    PROCESS_MEMORY_COUNTERS memoryCounters = {};
+    memoryCounters.cb = sizeof(memoryCounters);
+    if (!GetProcessMemoryInfo(GetCurrentProcess(), &memoryCounters, sizeof(memoryCounters)))
+        return false;
+
+    *pResidentBytes = memoryCounters.WorkingSetSize;
+    return true;
+#else
+    // The command name in the second field can contain spaces and parentheses, so the fields are counted from after it
+    std::ifstream statFile("/proc/self/stat");
+    std::string stat((std::istreambuf_iterator<char>(statFile)), std::istreambuf_iterator<char>());
+    size_t commandEnd = stat.rfind(')');
+    if (commandEnd == std::string::npos)
+        return false;
+
+    // from the state (the third field) to stime (the fifteenth)
+    std::istringstream fields(stat.substr(commandEnd + 1));
+    std::string field;
+    for (int fieldIndex = 3; fieldIndex <= 13; fieldIndex++)
+    {
+        fields >> field;
+    }
+
+    uint64_t userTicks, systemTicks;
+    if (!(fields >> userTicks >> systemTicks))
+        return false;
+
+    *pCPUSeconds = (double)(userTicks + systemTicks) / sysconf(_SC_CLK_TCK);
+
+    // the total program size, then the resident set, in pages
+    std::ifstream statmFile("/proc/self/statm");
+    uint64_t sizePages, residentPages;
+    if (!(statmFile >> sizePages >> residentPages))
+        return false;
+
+    *pResidentBytes = residentPages * sysconf(_SC_PAGESIZE);
+    return true;
+#endif
+}
+
+static void TelemetryWriteLogHeader(std::ofstream& log)
+{
+    log << "sample,seconds,process_cpu_percent,process_resident_mb,adapter_local_usage_mb,adapter_nonlocal_usage_mb,adapter_local_budget_mb,fps,frame_ms\n";
+}
+
+static void TelemetryWriteLogLine(std::ofstream& log, const TelemetrySnapshot& snapshot)
+{
+    char line[256];
+    snprintf(line, sizeof(line), "%llu,%.3f,%.1f,%.1f,%.1f,%.1f,%.1f,%.1f,%.3f\n",
+        (unsigned long long)snapshot.SampleIndex,
+        snapshot.Seconds,
+        snapshot.ProcessCPUPercent,
+        snapshot.ProcessResidentBytes / 1024.0 / 1024.0,
+        snapshot.AdapterLocalUsageBytes / 1024.0 / 1024.0,
+        snapshot.AdapterNonLocalUsageBytes / 1024.0 / 1024.0,
+        snapshot.AdapterLocalBudgetBytes / 1024.0 / 1024.0,
+        snapshot.FramesPerSecond,
+        snapshot.AverageFrameMilliseconds);
+    log << line;
+    log.flush(); // so a soak run that crashes keeps its log
+}
+
+static void TelemetrySampler(Telemetry* pTelemetry)
+{
+    ProfilerSetThreadName("Telemetry");
+
+    char cpuBrand[0x40];
+    TelemetryGetCPUBrand(cpuBrand);
+    int numLogicalCPUs = (int)std::thread::hardware_concurrency();
+
+    uint64_t sampleIndex = 0;
+    double lastSeconds = 0.0;
+    double lastCPUSeconds = 0.0;
+    uint64_t lastNumFrames = 0;
+    uint64_t lastFrameMicroseconds = 0;
+
+    std::unique_lock<std::mutex> lock(pTelemetry->Mutex);
+
+    for (;;)
+    {
+        lock.unlock();
+
+        TelemetrySnapshot& snapshot = pTelemetry->Slots[pTelemetry->SamplerSlot];
+        {
+            PROFILE_ZONE("TelemetrySample");
+
+            memset(&snapshot, 0, sizeof(snapshot));
+            snapshot.SampleIndex = sampleIndex;
+            snapshot.Seconds = std::chrono::duration<double>(std::chrono::steady_clock::now() - pTelemetry->CreateTime).count();
+            memcpy(snapshot.CPUBrand, cpuBrand, sizeof(cpuBrand));
+            snapshot.NumLogicalCPUs = numLogicalCPUs;
+
+            double cpuSeconds = lastCPUSeconds;
+            TelemetryQueryProcess(&cpuSeconds, &snapshot.ProcessResidentBytes);
+
+            uint64_t numFrames = pTelemetry->NumFrames.load(std::memory_order_relaxed);
+            uint64_t frameMicroseconds = pTelemetry->FrameMicroseconds.load(std::memory_order_relaxed);
+
+            // the first sample has nothing to compare with
+            double elapsedSeconds = snapshot.Seconds - lastSeconds;
+            if (sampleIndex > 0 && elapsedSeconds > 0.0)
+            {
+                snapshot.ProcessCPUPercent = (float)((cpuSeconds - lastCPUSeconds) / elapsedSeconds * 100.0);
+                snapshot.FramesPerSecond = (float)((numFrames - lastNumFrames) / elapsedSeconds);
+            }
+            if (numFrames != lastNumFrames)
+                snapshot.AverageFrameMilliseconds = (float)((frameMicroseconds - lastFrameMicroseconds) / 1000.0 / (numFrames - lastNumFrames));
+
+            if (pTelemetry->SampleAdapter)
+                pTelemetry->SampleAdapter(&snapshot);
+
+            lastSeconds = snapshot.Seconds;
+            lastCPUSeconds = cpuSeconds;
+            lastNumFrames = numFrames;
+            lastFrameMicroseconds = frameMicroseconds;
+            sampleIndex++;
+        }
+
+        lock.lock();
+
+        if (pTelemetry->Log.is_open())
+            TelemetryWriteLogLine(pTelemetry->Log, snapshot);
+
+        // hand the snapshot over and take back whichever slot was shared
+        int previousShared = pTelemetry->SharedSlot.exchange(pTelemetry->SamplerSlot | kTelemetryNewSnapshotBit, std::memory_order_acq_rel);
+        pTelemetry->SamplerSlot = previousShared & ~kTelemetryNewSnapshotBit;
+
+        // the interval can change while waiting
+        for (;;)
+        {
+            if (pTelemetry->Quit)
+                return;
+
+            std::chrono::steady_clock::time_point nextSampleTime = pTelemetry->CreateTime +
+                std::chrono::duration_cast<std::chrono::steady_clock::duration>(std::chrono::duration<double>(lastSeconds + pTelemetry->IntervalSeconds));
+            if (std::chrono::steady_clock::now() >= nextSampleTime)
+                break;
+
+            pTelemetry->Wake.wait_until(lock, nextSampleTime);
+        }
+    }
+}
+
+Telemetry* TelemetryCreate(double intervalSeconds, const TelemetryAdapterFunc& sampleAdapter)
+{
+    Telemetry* pTelemetry = new Telemetry();
+    pTelemetry->SampleAdapter = sampleAdapter;
+    pTelemetry->IntervalSeconds = intervalSeconds;
+    pTelemetry->Quit = false;
+    pTelemetry->NumFrames = 0;
+    pTelemetry->FrameMicroseconds = 0;
+    memset(pTelemetry->Slots, 0, sizeof(pTelemetry->Slots));
+    pTelemetry->SamplerSlot = 0;
+    pTelemetry->SharedSlot = 1;
+    pTelemetry->ReaderSlot = 2;
+    pTelemetry->CreateTime = std::chrono::steady_clock::now();
+    pTelemetry->Sampler = std::thread(TelemetrySampler, pTelemetry);
+    return pTelemetry;
+}
+
+void TelemetryDestroy(Telemetry* pTelemetry)
+{
+    {
+        std::lock_guard<std::mutex> lock(pTelemetry->Mutex);
+        pTelemetry->Quit = true;
+    }
+    pTelemetry->Wake.notify_one();
+
+    pTelemetry->Sampler.join();
+    delete pTelemetry;
+}
+
+void TelemetrySetInterval(Telemetry* pTelemetry, double intervalSeconds)
+{
+    {
+        std::lock_guard<std::mutex> lock(pTelemetry->Mutex);
+        pTelemetry->IntervalSeconds = intervalSeconds;
+    }
+    pTelemetry->Wake.notify_one();
+}
+
+double TelemetryGetInterval(Telemetry* pTelemetry)
+{
+    std::lock_guard<std::mutex> lock(pTelemetry->Mutex);
+    return pTelemetry->IntervalSeconds;
+}
+
+bool TelemetrySetLogPath(Telemetry* pTelemetry, const char* path)
+{
+    std::lock_guard<std::mutex> lock(pTelemetry->Mutex);
+
+    if (pTelemetry->Log.is_open())
+        pTelemetry->Log.close();
+
+    if (!path)
+        return true;
+
+    pTelemetry->Log.clear();
+    pTelemetry->Log.open(path, std::ios::app);
+    if (!pTelemetry->Log)
+    {
+        pTelemetry->Log.close();
+        return false;
+    }
+
+    // a new file gets a header, and an old one is appended to as is
+    pTelemetry->Log.seekp(0, std::ios::end);
+    if (pTelemetry->Log.tellp() == std::streampos(0))
+        TelemetryWriteLogHeader(pTelemetry->Log);
+
+    return true;
+}
+
+bool TelemetryIsLogging(Telemetry* pTelemetry)
+{
+    std::lock_guard<std::mutex> lock(pTelemetry->Mutex);
+    return pTelemetry->Log.is_open();
+}
+
+void TelemetryAddFrame(Telemetry* pTelemetry, float frameMilliseconds)
+{
+    // the sampler may see one of these without the other, which only moves a frame's time into the next sample
+    pTelemetry->FrameMicroseconds.fetch_add((uint64_t)(frameMilliseconds * 1000.0f), std::memory_order_relaxed);
+    pTelemetry->NumFrames.fetch_add(1, std::memory_order_relaxed);
+}
+
+const TelemetrySnapshot* TelemetryGetSnapshot(Telemetry* pTelemetry)
+{
+    if (pTelemetry->SharedSlot.load(std::memory_order_relaxed) & kTelemetryNewSnapshotBit)
+    {
+        int previousShared = pTelemetry->SharedSlot.exchange(pTelemetry->ReaderSlot, std::memory_order_acq_rel);
+        pTelemetry->ReaderSlot = previousShared & ~kTelemetryNewSnapshotBit;
+    }
+
+    return &pTelemetry->Slots[pTelemetry->ReaderSlot];
+}
\ No newline at end of file
@@ -0,0 +1,58 @@
+#pragma once
+
+#include <functional>
+#include <cstdint>
+
+// Samples system telemetry on a background thread at a low rate, so the GUI doesn't query the OS every frame.
+// The sampler publishes each snapshot through a lock-free triple buffer: it fills a slot of its own and swaps it
+// with the shared slot, and the reader swaps the shared slot with its own when a new snapshot is there.
+// Neither side ever waits for the other, and a snapshot is never written while it is read.
+// The CPU and process numbers come from cpuid and GetProcessTimes/GetProcessMemoryInfo on Windows, and cpuid and /proc on Linux.
+// Adapter memory comes from an optional callback, so nothing here depends on DXGI.
+
+struct Telemetry;
+
+struct TelemetrySnapshot
+{
+    uint64_t SampleIndex;
+    double Seconds; // since TelemetryCreate
+
+    char CPUBrand[0x40];
+    int NumLogicalCPUs;
+    float ProcessCPUPercent; // of one logical CPU, so it can go above 100 for a multithreaded process
+    uint64_t ProcessResidentBytes;
+
+    // filled in by the adapter callback, and zero without one
+    uint64_t AdapterLocalUsageBytes;
+    uint64_t AdapterNonLocalUsageBytes;
+    uint64_t AdapterLocalBudgetBytes;
+
+    // over the frames since the previous sample
+    float FramesPerSecond;
+    float AverageFrameMilliseconds;
+};
+
+// Runs on the sampler thread.
+typedef std::function<void(TelemetrySnapshot*)> TelemetryAdapterFunc;
+
+Telemetry* TelemetryCreate(double intervalSeconds, const TelemetryAdapterFunc& sampleAdapter = TelemetryAdapterFunc());
+void TelemetryDestroy(Telemetry* pTelemetry);
+
+void TelemetrySetInterval(Telemetry* pTelemetry, double intervalSeconds);
+double TelemetryGetInterval(Telemetry* pTelemetry);
+
+// Appends every following snapshot to a CSV file, for long soak runs. NULL stops logging.
+// Returns false if the file couldn't be opened.
+bool TelemetrySetLogPath(Telemetry* pTelemetry, const char* path);
+bool TelemetryIsLogging(Telemetry* pTelemetry);
+
+// Called by the render thread once per frame. Doesn't block.
+void TelemetryAddFrame(Telemetry* pTelemetry, float frameMilliseconds);
+
+// The latest snapshot, which stays valid until the next call. Only one thread may read snapshots.
+// All zeroes until the first sample is published.
+const TelemetrySnapshot* TelemetryGetSnapshot(Telemetry* pTelemetry);
+
+// The queries behind the snapshots. Returns false if the process couldn't be queried.
+void TelemetryGetCPUBrand(char brand[0x40]);
+bool TelemetryQueryProcess(double* pCPUSeconds, uint64_t* pResidentBytes);
\ No newline at end of file
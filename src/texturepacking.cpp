@@ -0,0 +1,187 @@
+#include "texturepacking.h"
+
+#define STBRP_STATIC
+#define STB_RECT_PACK_IMPLEMENTATION
+#include "stb_rect_pack.h"
+
+#include <map>
+#include <tuple>
+#include <algorithm>
+#include <cstring>
+
+// Packs the inputs into as many atlas pages as they need, and returns the inputs of each page.
+static void TexturePackingPackAtlasPages(
+    const TexturePackingDesc& desc, const std::vector<TexturePackingInput>& inputs,
+    std::vector<int> remainingInputs,
+    TexturePacking* pPacking, std::vector<std::vector<int>>* pPages)
+{
+    int numCells = desc.AtlasSize / desc.Alignment;
+    std::vector<stbrp_node> nodes(numCells);
+
+    while (!remainingInputs.empty())
+    {
+        std::vector<stbrp_rect> rects(remainingInputs.size());
+        for (size_t i = 0; i < remainingInputs.size(); i++)
+        {
+            const TexturePackingInput& input = inputs[remainingInputs[i]];
+            rects[i].id = remainingInputs[i];
+            rects[i].w = (stbrp_coord)((input.Width + desc.Alignment - 1) / desc.Alignment);
+            rects[i].h = (stbrp_coord)((input.Height + desc.Alignment - 1) / desc.Alignment);
+        }
+
+        stbrp_context context;
+        stbrp_init_target(&context, numCells, numCells, nodes.data(), (int)nodes.size());
+        stbrp_pack_rects(&context, rects.data(), (int)rects.size());
+
+        std::vector<int> page;
+        remainingInputs.clear();
+        for (const stbrp_rect& rect : rects)
+        {
+            if (!rect.was_packed)
+            {
+                remainingInputs.push_back(rect.id);
+                continue;
+            }
+
+            TexturePackingPlacement& placement = pPacking->Placements[rect.id];
+            placement.X = rect.x * desc.Alignment;
+            placement.Y = rect.y * desc.Alignment;
+            page.push_back(rect.id);
+        }
+
+        // every input fits in an empty page, so this only happens if the packer gave up
+        if (page.empty())
+            break;
+
+        pPages->push_back(std::move(page));
+    }
+}
+
+void TexturePackingPack(const TexturePackingDesc& desc, const std::vector<TexturePackingInput>& inputs, TexturePacking* pPacking)
+{
+    pPacking->Arrays.clear();
+    pPacking->Placements.assign(inputs.size(), TexturePackingPlacement());
+
+    // the small textures of each format, in input order
+    std::map<int, std::vector<int>> atlasCandidates;
+    for (int inputIndex = 0; inputIndex < (int)inputs.size(); inputIndex++)
+    {
+        const TexturePackingInput& input = inputs[inputIndex];
+        if (input.CanAtlas && std::max(input.Width, input.Height) <= std::min(desc.MaxAtlasedSize, desc.AtlasSize))
+            atlasCandidates[input.Format].push_back(inputIndex);
+    }
+
+    // each slice of each array, keyed by format and size so the arrays come out sorted
+    std::map<std::tuple<int, int, int>, std::vector<std::vector<int>>> groups;
+    std::vector<bool> atlased(inputs.size(), false);
+    for (const auto& formatCandidates : atlasCandidates)
+    {
+        if (formatCandidates.second.size() < 2)
+            continue;
+
+        std::vector<std::vector<int>> pages;
+        TexturePackingPackAtlasPages(desc, inputs, formatCandidates.second, pPacking, &pages);
+
+        for (std::vector<int>& page : pages)
+        {
+            // a page of one texture would only take more memory than the texture
+            if (page.size() < 2)
+                continue;
+
+            for (int inputIndex : page)
+            {
+                atlased[inputIndex] = true;
+            }
+            groups[std::make_tuple(formatCandidates.first, desc.AtlasSize, desc.AtlasSize)].push_back(std::move(page));
+        }
+    }
+
+    for (int inputIndex = 0; inputIndex < (int)inputs.size(); inputIndex++)
+    {
+        if (atlased[inputIndex])
+            continue;
+
+        const TexturePackingInput& input = inputs[inputIndex];
+        groups[std::make_tuple(input.Format, input.Width, input.Height)].push_back(std::vector<int>(1, inputIndex));
+    }
+
+    for (auto& group : groups)
+    {
+        TexturePackingArray array;
+        array.Format = std::get<0>(group.first);
+        array.Width = std::get<1>(group.first);
+        array.Height = std::get<2>(group.first);
+        array.SliceInputs = std::move(group.second);
+
+        int arrayID = (int)pPacking->Arrays.size();
+        for (int slice = 0; slice < (int)array.SliceInputs.size(); slice++)
+        {
+            for (int inputIndex : array.SliceInputs[slice])
+            {
+                const TexturePackingInput& input = inputs[inputIndex];
+                TexturePackingPlacement& placement = pPacking->Placements[inputIndex];
+                placement.ArrayID = arrayID;
+                placement.Slice = slice;
+                placement.Atlased = atlased[inputIndex];
+
+                if (placement.Atlased)
+                {
+                    // from the centers of the texture's edge texels, so bilinear filtering doesn't reach its neighbours
+                    placement.UVTransform[0] = (input.Width - 1) / (float)array.Width;
+                    placement.UVTransform[1] = (input.Height - 1) / (float)array.Height;
+                    placement.UVTransform[2] = (placement.X + 0.5f) / array.Width;
+                    placement.UVTransform[3] = (placement.Y + 0.5f) / array.Height;
+                }
+                else
+                {
+                    placement.X = 0;
+                    placement.Y = 0;
+                    placement.UVTransform[0] = 1.0f;
+                    placement.UVTransform[1] = 1.0f;
+                    placement.UVTransform[2] = 0.0f;
+                    placement.UVTransform[3] = 0.0f;
+                }
+            }
+        }
+
+        pPacking->Arrays.push_back(std::move(array));
+    }
+}
+
+bool TexturePackingAreUVsInUnitSquare(const float* texcoords, const unsigned int* indices, int numIndices)
+{
+    for (int i = 0; i < numIndices; i++)
+    {
+        const float* uv = &texcoords[indices[i] * 2];
+        if (uv[0] < 0.0f || uv[0] > 1.0f || uv[1] < 0.0f || uv[1] > 1.0f)
+            return false;
+    }
+    return true;
+}
+
+void TexturePackingRemapUV(const TexturePackingPlacement& placement, const float uv[2], float pRemapped[2])
+{
+    pRemapped[0] = uv[0] * placement.UVTransform[0] + placement.UVTransform[2];
+    pRemapped[1] = uv[1] * placement.UVTransform[1] + placement.UVTransform[3];
+}
+
+void TexturePackingCopyMip(
+    const TexturePackingPlacement& placement, int mip,
+    const uint8_t* pTexels, int width, int height, int bytesPerTexel,
+    uint8_t* pSliceTexels, int sliceWidth, int sliceHeight)
+{
+    int x = placement.X >> mip;
+    int y = placement.Y >> mip;
+    int copyWidth = std::min(width, sliceWidth - x);
+    int copyHeight = std::min(height, sliceHeight - y);
+    if (copyWidth <= 0 || copyHeight <= 0)
+        return;
+
+    for (int row = 0; row < copyHeight; row++)
+    {
+        memcpy(
+            &pSliceTexels[((size_t)(y + row) * sliceWidth + x) * bytesPerTexel],
+            &pTexels[(size_t)row * width * bytesPerTexel],
+            (size_t)copyWidth * bytesPerTexel);
+    }
+}
\ No newline at end of file
@@ -0,0 +1,66 @@
+#pragma once
+
+#include <vector>
+#include <cstdint>
+
+// Packing of textures into the slices of texture arrays, so draws pick a slice instead of binding their own textures.
+// Textures are grouped by format and size, and each group becomes one array. Small textures whose UVs stay in [0,1]
+// are first packed into atlas pages with stb_rect_pack, and the pages join the array of their size.
+// A texture in a page is sampled by scaling and offsetting its UVs, and each of its mips is copied into the page's mip
+// of the same level. Textures are placed on a grid of Alignment texels, so the copies line up down to the mip where a
+// grid cell is one texel, and only coarser mips mix neighbouring textures.
+// Nothing here depends on D3D or on Windows.
+
+struct TexturePackingDesc
+{
+    int AtlasSize; // the width and height of the atlas pages
+    int MaxAtlasedSize; // textures whose larger side is bigger get slices of their own
+    int Alignment; // of the positions in the atlas pages
+};
+
+struct TexturePackingInput
+{
+    int Format; // only textures of the same format share an array
+    int Width;
+    int Height;
+    bool CanAtlas; // an atlas can't wrap, so this is only true if every UV that samples the texture is in [0,1]
+};
+
+struct TexturePackingPlacement
+{
+    int ArrayID;
+    int Slice;
+    int X, Y; // the texture's position in its slice, which is 0 unless the slice is an atlas page
+    bool Atlased;
+    float UVTransform[4]; // scale in xy and offset in zw, from the texture's UVs to the slice's
+};
+
+struct TexturePackingArray
+{
+    int Format;
+    int Width;
+    int Height;
+    std::vector<std::vector<int>> SliceInputs; // of each slice, one input or the inputs of an atlas page
+};
+
+struct TexturePacking
+{
+    std::vector<TexturePackingArray> Arrays; // sorted by format, then size
+    std::vector<TexturePackingPlacement> Placements; // one per input
+};
+
+// A format with a single small texture keeps it in a slice of its own, since a page would only take more memory.
+void TexturePackingPack(const TexturePackingDesc& desc, const std::vector<TexturePackingInput>& inputs, TexturePacking* pPacking);
+
+// Returns true if every UV of the triangles is in [0,1].
+bool TexturePackingAreUVsInUnitSquare(const float* texcoords, const unsigned int* indices, int numIndices);
+
+// Like the pixel shader does with the placement's UVTransform.
+void TexturePackingRemapUV(const TexturePackingPlacement& placement, const float uv[2], float pRemapped[2]);
+
+// Copies one mip of a texture into the same mip of its slice, at its position scaled down to the mip.
+// A texture with fewer mips than the slice passes its 1x1 mip for the slice's coarser mips.
+void TexturePackingCopyMip(
+    const TexturePackingPlacement& placement, int mip,
+    const uint8_t* pTexels, int width, int height, int bytesPerTexel,
+    uint8_t* pSliceTexels, int sliceWidth, int sliceHeight);
\ No newline at end of file
@@ -0,0 +1,415 @@
+#include "texturestreaming.h"
+
+#include "resourcememory.h"
+#include "profiler.h"
+
+#include <mutex>
+#include <condition_variable>
+#include <deque>
+#include <thread>
+#include <algorithm>
+#include <cmath>
+
+struct TextureStreamingLoadJob
+{
+    int TextureID;
+    int FirstMip;
+};
+
+struct TextureStreamingLoader
+{
+    TextureStreamingLoadFunc Load;
+
+    std::mutex Mutex;
+    std::condition_variable JobQueued;
+
+    std::deque<TextureStreamingLoadJob> Jobs;
+    std::vector<TextureStreamingLoadResult> FinishedJobs;
+
+    bool Quit;
+
+    std::thread Worker;
+};
+
+void TextureStreamingInit(TextureStreaming* pStreaming, uint64_t budgetBytes, int minResidentSize)
+{
+    pStreaming->BudgetBytes = budgetBytes;
+    pStreaming->MinResidentSize = minResidentSize;
+    pStreaming->Frame = 0;
+    pStreaming->Textures.clear();
+    pStreaming->NumLoads = 0;
+    pStreaming->NumEvictions = 0;
+}
+
+int TextureStreamingGetNumMips(int width, int height)
+{
+    int numMips = 1;
+    while (width > 1 || height > 1)
+    {
+        width = std::max(width / 2, 1);
+        height = std::max(height / 2, 1);
+        numMips++;
+    }
+    return numMips;
+}
+
+int TextureStreamingGetMinResidentMip(const TextureStreaming& streaming, int width, int height)
+{
+    int numMips = TextureStreamingGetNumMips(width, height);
+    int minResidentMip = 0;
+    while (minResidentMip + 1 < numMips && std::max(width >> minResidentMip, height >> minResidentMip) > streaming.MinResidentSize)
+        minResidentMip++;
+    return minResidentMip;
+}
+
+int TextureStreamingAddTexture(TextureStreaming* pStreaming, int width, int height, int bytesPerTexel, int arraySize)
+{
+    TextureStreamingTexture texture;
+    texture.Width = width;
+    texture.Height = height;
+    texture.BytesPerTexel = bytesPerTexel;
+    texture.ArraySize = arraySize;
+    texture.NumMips = TextureStreamingGetNumMips(width, height);
+    texture.MinResidentMip = TextureStreamingGetMinResidentMip(*pStreaming, width, height);
+
+    texture.ResidentMip = texture.MinResidentMip;
+    texture.PendingMip = -1;
+    texture.RequiredMip = texture.NumMips;
+    texture.LastUsedFrame = 0;
+
+    pStreaming->Textures.push_back(texture);
+    return (int)pStreaming->Textures.size() - 1;
+}
+
+uint64_t TextureStreamingGetMipChainSize(const TextureStreamingTexture& texture, int firstMip)
+{
+    return ResourceMemoryGetTextureSize(
+        1, texture.BytesPerTexel,
+        std::max(texture.Width >> firstMip, 1), std::max(texture.Height >> firstMip, 1), 1,
+        texture.NumMips - firstMip, texture.ArraySize);
+}
+
+// the finest mip that takes memory, which includes a load that isn't finished
+static int TextureStreamingGetAllocatedMip(const TextureStreamingTexture& texture)
+{
+    return texture.PendingMip != -1 ? std::min(texture.PendingMip, texture.ResidentMip) : texture.ResidentMip;
+}
+
+uint64_t TextureStreamingGetResidentSize(const TextureStreaming& streaming)
+{
+    uint64_t bytes = 0;
+    for (const TextureStreamingTexture& texture : streaming.Textures)
+    {
+        bytes += TextureStreamingGetMipChainSize(texture, TextureStreamingGetAllocatedMip(texture));
+    }
+    return bytes;
+}
+
+uint64_t TextureStreamingGetFullSize(const TextureStreaming& streaming)
+{
+    uint64_t bytes = 0;
+    for (const TextureStreamingTexture& texture : streaming.Textures)
+    {
+        bytes += TextureStreamingGetMipChainSize(texture, 0);
+    }
+    return bytes;
+}
+
+float TextureStreamingComputeUVDensity(
+    const float* positions, const float* texcoords,
+    const unsigned int* indices, int numIndices)
+{
+    double worldArea = 0.0;
+    double uvArea = 0.0;
+    for (int i = 0; i + 2 < numIndices; i += 3)
+    {
+        const float* p0 = &positions[indices[i + 0] * 3];
+        const float* p1 = &positions[indices[i + 1] * 3];
+        const float* p2 = &positions[indices[i + 2] * 3];
+        float e1[3] = { p1[0] - p0[0], p1[1] - p0[1], p1[2] - p0[2] };
+        float e2[3] = { p2[0] - p0[0], p2[1] - p0[1], p2[2] - p0[2] };
+        float cross[3] = {
+            e1[1] * e2[2] - e1[2] * e2[1],
+            e1[2] * e2[0] - e1[0] * e2[2],
+            e1[0] * e2[1] - e1[1] * e2[0]
+        };
+        worldArea += 0.5 * std::sqrt(cross[0] * cross[0] + cross[1] * cross[1] + cross[2] * cross[2]);
+
+        const float* t0 = &texcoords[indices[i + 0] * 2];
+        const float* t1 = &texcoords[indices[i + 1] * 2];
+        const float* t2 = &texcoords[indices[i + 2] * 2];
+        uvArea += 0.5 * std::abs((t1[0] - t0[0]) * (t2[1] - t0[1]) - (t2[0] - t0[0]) * (t1[1] - t0[1]));
+    }
+
+    if (worldArea <= 0.0 || uvArea <= 0.0)
+        return 0.0f;
+
+    return (float)std::sqrt(uvArea / worldArea);
+}
+
+int TextureStreamingEstimateMip(
+    const TextureStreamingTexture& texture,
+    float uvDensity, float distance, float pixelsPerUnitAtUnitDistance)
+{
+    if (uvDensity <= 0.0f)
+        return texture.NumMips - 1;
+
+    float texelsPerUnit = std::max(texture.Width, texture.Height) * uvDensity;
+    float pixelsPerUnit = pixelsPerUnitAtUnitDistance / std::max(distance, 1e-6f);
+    float texelsPerPixel = texelsPerUnit / pixelsPerUnit;
+    if (texelsPerPixel <= 1.0f)
+        return 0;
+
+    int mip = (int)std::floor(std::log2(texelsPerPixel));
+    return std::min(mip, texture.NumMips - 1);
+}
+
+void TextureStreamingBeginFrame(TextureStreaming* pStreaming)
+{
+    pStreaming->Frame++;
+
+    for (TextureStreamingTexture& texture : pStreaming->Textures)
+    {
+        texture.RequiredMip = texture.NumMips;
+    }
+}
+
+void TextureStreamingRequestMip(TextureStreaming* pStreaming, int textureID, int mip)
+{
+    TextureStreamingTexture& texture = pStreaming->Textures[textureID];
+    texture.RequiredMip = std::min(texture.RequiredMip, mip);
+    texture.LastUsedFrame = pStreaming->Frame;
+}
+
+void TextureStreamingUpdate(
+    TextureStreaming* pStreaming,
+    std::vector<TextureStreamingMipChange>* pEvictions,
+    std::vector<TextureStreamingMipChange>* pLoads)
+{
+    std::vector<TextureStreamingTexture>& textures = pStreaming->Textures;
+
+    // Every texture keeps what it has and gets what it needs, which is then cut down to the budget.
+    // Textures with a pending load keep the mips of the load.
+    std::vector<int> wantedMips(textures.size());
+    std::vector<int> targetMips(textures.size());
+    uint64_t totalBytes = 0;
+    for (size_t textureID = 0; textureID < textures.size(); textureID++)
+    {
+        const TextureStreamingTexture& texture = textures[textureID];
+        wantedMips[textureID] = std::min(texture.RequiredMip, texture.MinResidentMip);
+        targetMips[textureID] = texture.PendingMip != -1 ? TextureStreamingGetAllocatedMip(texture) : std::min(wantedMips[textureID], texture.ResidentMip);
+        totalBytes += TextureStreamingGetMipChainSize(texture, targetMips[textureID]);
+    }
+
+    // First drop the mips that aren't needed, least recently used first
+    if (totalBytes > pStreaming->BudgetBytes)
+    {
+        std::vector<int> leastRecentlyUsed;
+        for (int textureID = 0; textureID < (int)textures.size(); textureID++)
+        {
+            if (textures[textureID].PendingMip == -1 && targetMips[textureID] < wantedMips[textureID])
+                leastRecentlyUsed.push_back(textureID);
+        }
+
+        std::stable_sort(leastRecentlyUsed.begin(), leastRecentlyUsed.end(),
+            [&textures](int a, int b) { return textures[a].LastUsedFrame < textures[b].LastUsedFrame; });
+
+        for (int textureID : leastRecentlyUsed)
+        {
+            if (totalBytes <= pStreaming->BudgetBytes)
+                break;
+
+            const TextureStreamingTexture& texture = textures[textureID];
+            totalBytes -= TextureStreamingGetMipChainSize(texture, targetMips[textureID]);
+            targetMips[textureID] = wantedMips[textureID];
+            totalBytes += TextureStreamingGetMipChainSize(texture, targetMips[textureID]);
+        }
+    }
+
+    // Then coarsen the needed textures a mip at a time, starting with the largest mip
+    while (totalBytes > pStreaming->BudgetBytes)
+    {
+        int largestTextureID = -1;
+        uint64_t largestMipBytes = 0;
+        for (int textureID = 0; textureID < (int)textures.size(); textureID++)
+        {
+            const TextureStreamingTexture& texture = textures[textureID];
+            if (texture.PendingMip != -1 || targetMips[textureID] >= texture.MinResidentMip)
+                continue;
+
+            uint64_t mipBytes = TextureStreamingGetMipChainSize(texture, targetMips[textureID]) - TextureStreamingGetMipChainSize(texture, targetMips[textureID] + 1);
+            if (mipBytes > largestMipBytes)
+            {
+                largestTextureID = textureID;
+                largestMipBytes = mipBytes;
+            }
+        }
+
+        // only the mips that are always resident are left
+        if (largestTextureID == -1)
+            break;
+
+        targetMips[largestTextureID]++;
+        totalBytes -= largestMipBytes;
+    }
+
+    for (int textureID = 0; textureID < (int)textures.size(); textureID++)
+    {
+        TextureStreamingTexture& texture = textures[textureID];
+        if (texture.PendingMip != -1)
+            continue;
+
+        TextureStreamingMipChange change;
+        change.TextureID = textureID;
+        change.Mip = targetMips[textureID];
+
+        if (change.Mip > texture.ResidentMip)
+        {
+            texture.ResidentMip = change.Mip;
+            pEvictions->push_back(change);
+            pStreaming->NumEvictions++;
+        }
+        else if (change.Mip < texture.ResidentMip)
+        {
+            texture.PendingMip = change.Mip;
+            pLoads->push_back(change);
+            pStreaming->NumLoads++;
+        }
+    }
+}
+
+void TextureStreamingFinishLoad(TextureStreaming* pStreaming, int textureID, bool succeeded)
+{
+    TextureStreamingTexture& texture = pStreaming->Textures[textureID];
+    if (succeeded)
+        texture.ResidentMip = texture.PendingMip;
+    texture.PendingMip = -1;
+}
+
+void TextureStreamingBuildMips(
+    const uint8_t* pTexels, int width, int height, int bytesPerTexel, int firstMip,
+    std::vector<TextureStreamingMip>* pMips)
+{
+    pMips->clear();
+
+    TextureStreamingMip mip;
+    mip.Width = width;
+    mip.Height = height;
+    mip.Texels.assign(pTexels, pTexels + (size_t)width * height * bytesPerTexel);
+
+    int numMips = TextureStreamingGetNumMips(width, height);
+    for (int level = 0; level < numMips; level++)
+    {
+        if (level > 0)
+        {
+            const TextureStreamingMip& src = level - 1 >= firstMip ? pMips->back() : mip;
+
+            // an odd side drops its last texel, and a 1 texel side is averaged with itself
+            TextureStreamingMip dst;
+            dst.Width = std::max(src.Width / 2, 1);
+            dst.Height = std::max(src.Height / 2, 1);
+            dst.Texels.resize((size_t)dst.Width * dst.Height * bytesPerTexel);
+            for (int y = 0; y < dst.Height; y++)
+            {
+                int y0 = std::min(y * 2, src.Height - 1);
+                int y1 = std::min(y * 2 + 1, src.Height - 1);
+                for (int x = 0; x < dst.Width; x++)
+                {
+                    int x0 = std::min(x * 2, src.Width - 1);
+                    int x1 = std::min(x * 2 + 1, src.Width - 1);
+                    for (int c = 0; c < bytesPerTexel; c++)
+                    {
+                        int sum =
+                            src.Texels[((size_t)y0 * src.Width + x0) * bytesPerTexel + c] +
+                            src.Texels[((size_t)y0 * src.Width + x1) * bytesPerTexel + c] +
+                            src.Texels[((size_t)y1 * src.Width + x0) * bytesPerTexel + c] +
+                            src.Texels[((size_t)y1 * src.Width + x1) * bytesPerTexel + c];
+                        dst.Texels[((size_t)y * dst.Width + x) * bytesPerTexel + c] = (uint8_t)((sum + 2) / 4);
+                    }
+                }
+            }
+            mip = std::move(dst);
+        }
+
+        if (level >= firstMip)
+            pMips->push_back(std::move(mip));
+    }
+}
+
+static void TextureStreamingLoaderWorker(TextureStreamingLoader* pLoader)
+{
+    ProfilerSetThreadName("Texture streaming");
+
+    std::unique_lock<std::mutex> lock(pLoader->Mutex);
+
+    for (;;)
+    {
+        pLoader->JobQueued.wait(lock, [pLoader] { return pLoader->Quit || !pLoader->Jobs.empty(); });
+        if (pLoader->Quit)
+            return;
+
+        TextureStreamingLoadJob job = pLoader->Jobs.front();
+        pLoader->Jobs.pop_front();
+
+        TextureStreamingLoadResult result;
+        result.TextureID = job.TextureID;
+        result.FirstMip = job.FirstMip;
+
+        lock.unlock();
+        {
+            PROFILE_ZONE("TextureStreamingLoad");
+            result.Succeeded = pLoader->Load(job.TextureID, job.FirstMip, &result.Mips);
+        }
+        lock.lock();
+
+        pLoader->FinishedJobs.push_back(std::move(result));
+    }
+}
+
+TextureStreamingLoader* TextureStreamingLoaderCreate(const TextureStreamingLoadFunc& load)
+{
+    TextureStreamingLoader* pLoader = new TextureStreamingLoader();
+    pLoader->Load = load;
+    pLoader->Quit = false;
+    pLoader->Worker = std::thread(TextureStreamingLoaderWorker, pLoader);
+    return pLoader;
+}
+
+void TextureStreamingLoaderDestroy(TextureStreamingLoader* pLoader)
+{
+    {
+        std::lock_guard<std::mutex> lock(pLoader->Mutex);
+        pLoader->Jobs.clear();
+        pLoader->Quit = true;
+    }
+    pLoader->JobQueued.notify_all();
+
+    pLoader->Worker.join();
+
+    delete pLoader;
+}
+
+void TextureStreamingLoaderSubmit(TextureStreamingLoader* pLoader, int textureID, int firstMip)
+{
+    {
+        std::lock_guard<std::mutex> lock(pLoader->Mutex);
+
+        TextureStreamingLoadJob job;
+        job.TextureID = textureID;
+        job.FirstMip = firstMip;
+        pLoader->Jobs.push_back(job);
+    }
+    pLoader->JobQueued.notify_one();
+}
+
+void TextureStreamingLoaderCollect(TextureStreamingLoader* pLoader, std::vector<TextureStreamingLoadResult>* pResults)
+{
+    std::lock_guard<std::mutex> lock(pLoader->Mutex);
+
+    for (TextureStreamingLoadResult& result : pLoader->FinishedJobs)
+    {
+        pResults->push_back(std::move(result));
+    }
+
+    pLoader->FinishedJobs.clear();
+}
\ No newline at end of file
@@ -0,0 +1,132 @@
+#pragma once
+
+#include <functional>
+#include <vector>
+#include <cstdint>
+
+// Mip residency of streamed textures. Every texture starts with only its small mips resident, and its finer mips are
+// loaded when the meshes that use it need them, under a global memory budget.
+// The estimator picks the mip a mesh needs from the density of its UVs and its distance to the camera. The budget policy
+// evicts the finer mips of the least recently used textures first, then coarsens the visible textures with the largest
+// mips until the textures that are needed fit. Finer mips are loaded from the image files on a worker thread.
+// Nothing here depends on D3D or on Windows.
+
+struct TextureStreamingTexture
+{
+    int Width; // of mip 0
+    int Height;
+    int BytesPerTexel;
+    int ArraySize; // the slices of an array are streamed together, since they share their mips
+    int NumMips;
+    int MinResidentMip; // this mip and the coarser ones are always resident
+    int ResidentMip; // the finest resident mip
+    int PendingMip; // the finest mip of a load that isn't finished, or -1
+    int RequiredMip; // the finest mip needed this frame, or NumMips if the texture isn't used
+    uint64_t LastUsedFrame;
+};
+
+struct TextureStreaming
+{
+    uint64_t BudgetBytes;
+    int MinResidentSize;
+    uint64_t Frame;
+    std::vector<TextureStreamingTexture> Textures;
+
+    // since TextureStreamingInit
+    uint64_t NumLoads;
+    uint64_t NumEvictions;
+};
+
+// A texture that needs its finest resident mip changed.
+struct TextureStreamingMipChange
+{
+    int TextureID;
+    int Mip;
+};
+
+// Mips whose larger side is at most minResidentSize are always resident, so they are never evicted.
+void TextureStreamingInit(TextureStreaming* pStreaming, uint64_t budgetBytes, int minResidentSize);
+
+// Returns the ID of the texture, which starts with only the mips that are always resident.
+int TextureStreamingAddTexture(TextureStreaming* pStreaming, int width, int height, int bytesPerTexel, int arraySize = 1);
+
+// The finest mip that is always resident in a texture of the size.
+int TextureStreamingGetMinResidentMip(const TextureStreaming& streaming, int width, int height);
+
+int TextureStreamingGetNumMips(int width, int height);
+
+// The bytes of the texture's mips from firstMip to the coarsest.
+uint64_t TextureStreamingGetMipChainSize(const TextureStreamingTexture& texture, int firstMip);
+
+// The bytes of every resident mip, including the mips of loads that aren't finished.
+uint64_t TextureStreamingGetResidentSize(const TextureStreaming& streaming);
+
+// The bytes of every mip of every texture, which is what loading the textures without streaming takes.
+uint64_t TextureStreamingGetFullSize(const TextureStreaming& streaming);
+
+// UV units per world unit of a triangle list, from the ratio of its area in UV space to its area in world space.
+// Returns 0 if the triangles have no area.
+float TextureStreamingComputeUVDensity(
+    const float* positions, const float* texcoords,
+    const unsigned int* indices, int numIndices);
+
+// The finest mip that a mesh with the UV density needs at the distance. pixelsPerUnitAtUnitDistance is how many pixels
+// a world unit covers one unit in front of the camera, which is the viewport height / (2 tan(fovY / 2)).
+// The mip has at least one texel per pixel, like the mip that trilinear filtering would sample.
+int TextureStreamingEstimateMip(
+    const TextureStreamingTexture& texture,
+    float uvDensity, float distance, float pixelsPerUnitAtUnitDistance);
+
+// Forgets the mips needed by the previous frame.
+void TextureStreamingBeginFrame(TextureStreaming* pStreaming);
+
+// Marks the texture used this frame and needing the mip.
+void TextureStreamingRequestMip(TextureStreaming* pStreaming, int textureID, int mip);
+
+// The budget policy. The evictions are applied right away and their mips must be released before the loads are started,
+// so that the resident mips never go over the budget. The loads are pending until TextureStreamingFinishLoad.
+// A texture with a pending load gets no other change.
+void TextureStreamingUpdate(
+    TextureStreaming* pStreaming,
+    std::vector<TextureStreamingMipChange>* pEvictions,
+    std::vector<TextureStreamingMipChange>* pLoads);
+
+// A load that failed leaves the resident mips as they were.
+void TextureStreamingFinishLoad(TextureStreaming* pStreaming, int textureID, bool succeeded);
+
+struct TextureStreamingMip
+{
+    int Width;
+    int Height;
+    std::vector<uint8_t> Texels;
+};
+
+// Box filters each mip from the previous one, down to 1x1, and keeps the mips from firstMip on.
+// Like GenerateMips on a UNORM view, sRGB texels are averaged as they are stored.
+void TextureStreamingBuildMips(
+    const uint8_t* pTexels, int width, int height, int bytesPerTexel, int firstMip,
+    std::vector<TextureStreamingMip>* pMips);
+
+struct TextureStreamingLoader;
+
+// Runs on the loader's worker thread. Fills in the mips from firstMip to the coarsest, and returns false if they couldn't be loaded.
+typedef std::function<bool(int textureID, int firstMip, std::vector<TextureStreamingMip>* pMips)> TextureStreamingLoadFunc;
+
+struct TextureStreamingLoadResult
+{
+    int TextureID;
+    int FirstMip;
+    bool Succeeded;
+    std::vector<TextureStreamingMip> Mips;
+};
+
+TextureStreamingLoader* TextureStreamingLoaderCreate(const TextureStreamingLoadFunc& load);
+
+// Waits for the running load and discards the queued ones.
+void TextureStreamingLoaderDestroy(TextureStreamingLoader* pLoader);
+
+// Loads are run in the order they are submitted.
+void TextureStreamingLoaderSubmit(TextureStreamingLoader* pLoader, int textureID, int firstMip);
+
+// Doesn't block. Appends the loads finished since the last collect.
+void TextureStreamingLoaderCollect(TextureStreamingLoader* pLoader, std::vector<TextureStreamingLoadResult>* pResults);
\ No newline at end of file
@@ -0,0 +1,62 @@
+#include "uploadring.h"
+
+void UploadRingReset(UploadRing* pRing, uint64_t size)
+{
+    pRing->Size = size;
+    pRing->Head = 0;
+    pRing->Tail = 0;
+    pRing->Frames.clear();
+}
+
+bool UploadRingAllocate(UploadRing* pRing, uint64_t size, uint64_t* pOffset)
+{
+    if (pRing->Size == 0 || size > pRing->Size)
+        return false;
+
+    uint64_t offset = pRing->Head % pRing->Size;
+    uint64_t padding = 0;
+    if (offset + size > pRing->Size)
+    {
+        padding = pRing->Size - offset;
+        offset = 0;
+    }
+
+    if (pRing->Head + padding + size - pRing->Tail > pRing->Size)
+        return false;
+
+    pRing->Head += padding + size;
+    *pOffset = offset;
+    return true;
+}
+
+void UploadRingEndFrame(UploadRing* pRing, uint64_t frameIndex)
+{
+    UploadRingFrame frame;
+    frame.FrameIndex = frameIndex;
+    frame.End = pRing->Head;
+    pRing->Frames.push_back(frame);
+}
+
+void UploadRingRetireFrames(UploadRing* pRing, uint64_t firstPendingFrameIndex)
+{
+    while (!pRing->Frames.empty() && pRing->Frames.front().FrameIndex < firstPendingFrameIndex)
+    {
+        pRing->Tail = pRing->Frames.front().End;
+        pRing->Frames.pop_front();
+    }
+}
+
+uint64_t UploadRingGetFreeSize(const UploadRing& ring)
+{
+    return ring.Size - (ring.Head - ring.Tail);
+}
+
+uint64_t UploadRingGetGrownSize(uint64_t size, uint64_t requiredSize)
+{
+    uint64_t grownSize = size != 0 ? size * 2 : 1;
+    while (grownSize < requiredSize)
+    {
+        grownSize *= 2;
+    }
+    return grownSize;
+}
\ No newline at end of file
@@ -0,0 +1,41 @@
+#pragma once
+
+#include <deque>
+#include <cstdint>
+
+// A ring allocator for streaming data through a persistent GPU buffer that is only ever appended to.
+// The allocations of a frame are retired once the GPU is done with that frame, which the caller finds out with fences of its own,
+// so the buffer is never written where the GPU may still be reading it and can be mapped without discarding it.
+// Sizes and offsets are in whatever units the caller uses, normally elements. Nothing here depends on D3D or on Windows.
+
+struct UploadRingFrame
+{
+    uint64_t FrameIndex;
+    uint64_t End; // the ring's head when the frame ended
+};
+
+struct UploadRing
+{
+    uint64_t Size;
+    uint64_t Head; // total allocated since the last reset, including the padding skipped at the end of the ring
+    uint64_t Tail; // total retired since the last reset
+    std::deque<UploadRingFrame> Frames; // ended but not retired, oldest first
+};
+
+// Empties the ring, forgetting any frames in flight. Used when the buffer behind it is recreated.
+void UploadRingReset(UploadRing* pRing, uint64_t size);
+
+// Allocations are contiguous, so one that doesn't fit before the end of the ring skips to the start.
+// Returns false if there isn't enough space that is out of flight.
+bool UploadRingAllocate(UploadRing* pRing, uint64_t size, uint64_t* pOffset);
+
+// Marks the end of the allocations of a frame. Frame indices must increase.
+void UploadRingEndFrame(UploadRing* pRing, uint64_t frameIndex);
+
+// Frees the allocations of every frame before the given one.
+void UploadRingRetireFrames(UploadRing* pRing, uint64_t firstPendingFrameIndex);
+
+uint64_t UploadRingGetFreeSize(const UploadRing& ring);
+
+// At least doubles, so a UI that keeps getting bigger only reallocates a logarithmic number of times.
+uint64_t UploadRingGetGrownSize(uint64_t size, uint64_t requiredSize);
\ No newline at end of file
@@ -0,0 +1,529 @@
+#include "voxeldag.h"
+
+#include "parallel.h"
+
+#include <algorithm>
+#include <unordered_map>
+#include <cstring>
+#include <cmath>
+
+using namespace DirectX;
+
+static const uint32_t kVoxelDAGMagic = 0x47414456; // "VDAG"
+static const uint32_t kVoxelDAGVersion = 1;
+
+struct VoxelDAGHeader
+{
+    uint32_t Magic;
+    uint32_t Version;
+    uint32_t Size;
+    uint32_t NumLevels;
+    uint32_t Root;
+    uint32_t NumNodeWords;
+    uint32_t NumLeaves;
+};
+
+// A node of the octree level being merged, identified by the Morton code of its coordinates.
+struct VoxelDAGEntry
+{
+    uint64_t MortonCode;
+    uint64_t Value; // leaf mask for leaves, node or leaf index otherwise
+};
+
+static uint64_t VoxelDAGSpreadBits(uint64_t v)
+{
+    v &= 0x1FFFFF;
+    v = (v | (v << 32)) & 0x001F00000000FFFFull;
+    v = (v | (v << 16)) & 0x001F0000FF0000FFull;
+    v = (v | (v << 8)) & 0x100F00F00F00F00Full;
+    v = (v | (v << 4)) & 0x10C30C30C30C30C3ull;
+    v = (v | (v << 2)) & 0x1249249249249249ull;
+    return v;
+}
+
+static uint64_t VoxelDAGMortonCode(int x, int y, int z)
+{
+    return VoxelDAGSpreadBits(x) | (VoxelDAGSpreadBits(y) << 1) | (VoxelDAGSpreadBits(z) << 2);
+}
+
+static int VoxelDAGPopCount(uint32_t v)
+{
+    v = v - ((v >> 1) & 0x55555555);
+    v = (v & 0x33333333) + ((v >> 2) & 0x33333333);
+    return (int)((((v + (v >> 4)) & 0x0F0F0F0F) * 0x01010101) >> 24);
+}
+
+static int VoxelDAGLeafBit(int x, int y, int z)
+{
+    return (z * kVoxelDAGLeafSize + y) * kVoxelDAGLeafSize + x;
+}
+
+static uint64_t VoxelDAGHashWords(const uint32_t* pWords, int numWords)
+{
+    // FNV-1a
+    uint64_t hash = 0xCBF29CE484222325ull;
+    for (int i = 0; i < numWords; i++)
+    {
+        hash = (hash ^ pWords[i]) * 0x100000001B3ull;
+    }
+    return hash;
+}
+
+void VoxelDAGBuild(
+    const std::vector<VoxelizerTriangle>& triangles,
+    const VoxelGridDesc& grid,
+    int numThreads,
+    VoxelDAG* pDAG,
+    VoxelDAGStats* pStats)
+{
+    const int size = grid.Size;
+    const int numLeavesPerAxis = size / kVoxelDAGLeafSize;
+    const int numRowsPerAxis = size / kVoxelBrickSize;
+    const int numLeavesPerRowAxis = kVoxelBrickSize / kVoxelDAGLeafSize;
+
+    int numLevels = 0;
+    for (int nodeSize = kVoxelDAGLeafSize * 2; nodeSize <= size; nodeSize *= 2)
+    {
+        numLevels++;
+    }
+
+    // Find the non-empty leaves of every row of the voxelized scene
+    std::vector<std::vector<VoxelDAGEntry>> rowLeaves(numRowsPerAxis * numRowsPerAxis);
+    std::atomic<uint64_t> numOccupied(0);
+
+    VoxelizeTrianglesByRow(triangles, grid, [&](int rowY, int rowZ, const uint32_t* pRowVoxels)
+    {
+        std::vector<VoxelDAGEntry>& leaves = rowLeaves[(rowZ / kVoxelBrickSize) * numRowsPerAxis + rowY / kVoxelBrickSize];
+        uint64_t rowNumOccupied = 0;
+
+        for (int lz = 0; lz < numLeavesPerRowAxis; lz++)
+        {
+            for (int ly = 0; ly < numLeavesPerRowAxis; ly++)
+            {
+                for (int lx = 0; lx < numLeavesPerAxis; lx++)
+                {
+                    uint64_t mask = 0;
+                    for (int z = 0; z < kVoxelDAGLeafSize; z++)
+                    {
+                        for (int y = 0; y < kVoxelDAGLeafSize; y++)
+                        {
+                            int line = (lz * kVoxelDAGLeafSize + z) * kVoxelBrickSize + (ly * kVoxelDAGLeafSize + y);
+                            const uint32_t* pLine = &pRowVoxels[line * size + lx * kVoxelDAGLeafSize];
+                            for (int x = 0; x < kVoxelDAGLeafSize; x++)
+                            {
+                                if (pLine[x] != 0)
+                                    mask |= 1ull << VoxelDAGLeafBit(x, y, z);
+                            }
+                        }
+                    }
+
+                    if (mask == 0)
+                        continue;
+
+                    VoxelDAGEntry leaf;
+                    leaf.MortonCode = VoxelDAGMortonCode(
+                        lx,
+                        rowY / kVoxelDAGLeafSize + ly,
+                        rowZ / kVoxelDAGLeafSize + lz);
+                    leaf.Value = mask;
+                    leaves.push_back(leaf);
+
+                    rowNumOccupied += VoxelDAGPopCount((uint32_t)mask) + VoxelDAGPopCount((uint32_t)(mask >> 32));
+                }
+            }
+        }
+
+        numOccupied += rowNumOccupied;
+    }, numThreads);
+
+    std::vector<VoxelDAGEntry> entries;
+    for (std::vector<VoxelDAGEntry>& leaves : rowLeaves)
+    {
+        entries.insert(entries.end(), leaves.begin(), leaves.end());
+        std::vector<VoxelDAGEntry>().swap(leaves);
+    }
+
+    std::sort(entries.begin(), entries.end(),
+        [](const VoxelDAGEntry& a, const VoxelDAGEntry& b) { return a.MortonCode < b.MortonCode; });
+
+    VoxelDAGStats stats = {};
+    stats.NumOccupiedVoxels = numOccupied;
+
+    pDAG->Size = size;
+    pDAG->NumLevels = numLevels;
+    pDAG->Root = kVoxelDAGEmpty;
+    pDAG->Nodes.clear();
+    pDAG->Leaves.clear();
+
+    // Merge identical leaves
+    {
+        std::unordered_map<uint64_t, uint32_t> leafIndices;
+        for (VoxelDAGEntry& entry : entries)
+        {
+            auto found = leafIndices.find(entry.Value);
+            if (found == leafIndices.end())
+            {
+                found = leafIndices.emplace(entry.Value, (uint32_t)pDAG->Leaves.size()).first;
+                pDAG->Leaves.push_back(entry.Value);
+            }
+            entry.Value = found->second;
+        }
+
+        stats.NumOctreeNodes += entries.size();
+    }
+
+    // Build each level from the one below it. Entries are in Morton order, so siblings are adjacent.
+    for (int level = numLevels - 1; level >= 0 && !entries.empty(); level--)
+    {
+        std::unordered_multimap<uint64_t, uint32_t> nodeOffsets;
+        std::vector<VoxelDAGEntry> parents;
+
+        for (size_t first = 0; first < entries.size(); )
+        {
+            uint64_t parentCode = entries[first].MortonCode >> 3;
+
+            uint32_t words[9];
+            words[0] = 0;
+            int numWords = 1;
+
+            size_t last = first;
+            for (; last < entries.size() && (entries[last].MortonCode >> 3) == parentCode; last++)
+            {
+                words[0] |= 1u << (entries[last].MortonCode & 7);
+                words[numWords++] = (uint32_t)entries[last].Value;
+            }
+
+            uint64_t hash = VoxelDAGHashWords(words, numWords);
+
+            uint32_t nodeOffset = kVoxelDAGEmpty;
+            auto range = nodeOffsets.equal_range(hash);
+            for (auto it = range.first; it != range.second; ++it)
+            {
+                if (std::memcmp(&pDAG->Nodes[it->second], words, numWords * sizeof(uint32_t)) == 0)
+                {
+                    nodeOffset = it->second;
+                    break;
+                }
+            }
+
+            if (nodeOffset == kVoxelDAGEmpty)
+            {
+                nodeOffset = (uint32_t)pDAG->Nodes.size();
+                pDAG->Nodes.insert(pDAG->Nodes.end(), words, words + numWords);
+                nodeOffsets.emplace(hash, nodeOffset);
+            }
+
+            VoxelDAGEntry parent;
+            parent.MortonCode = parentCode;
+            parent.Value = nodeOffset;
+            parents.push_back(parent);
+
+            first = last;
+        }
+
+        stats.NumOctreeNodes += parents.size();
+        stats.NumDAGNodes += nodeOffsets.size();
+        entries.swap(parents);
+    }
+
+    if (!entries.empty())
+        pDAG->Root = (uint32_t)entries[0].Value;
+
+    stats.NumDAGNodes += pDAG->Leaves.size();
+
+    if (pStats)
+        *pStats = stats;
+}
+
+static uint32_t VoxelDAGGetChild(const VoxelDAG& dag, uint32_t node, int octant)
+{
+    uint32_t mask = dag.Nodes[node];
+    uint32_t octantBit = 1u << octant;
+    if (!(mask & octantBit))
+        return kVoxelDAGEmpty;
+
+    return dag.Nodes[node + 1 + VoxelDAGPopCount(mask & (octantBit - 1))];
+}
+
+bool VoxelDAGIsOccupied(const VoxelDAG& dag, int x, int y, int z)
+{
+    if (dag.Root == kVoxelDAGEmpty)
+        return false;
+
+    if (x < 0 || y < 0 || z < 0 || x >= dag.Size || y >= dag.Size || z >= dag.Size)
+        return false;
+
+    uint32_t node = dag.Root;
+    for (int level = 0; level < dag.NumLevels; level++)
+    {
+        // the children of the last level are leaves of 4^3 voxels
+        int shift = dag.NumLevels + 1 - level;
+        int octant = ((x >> shift) & 1) | (((y >> shift) & 1) << 1) | (((z >> shift) & 1) << 2);
+
+        node = VoxelDAGGetChild(dag, node, octant);
+        if (node == kVoxelDAGEmpty)
+            return false;
+    }
+
+    uint64_t leaf = dag.Leaves[node];
+    return ((leaf >> VoxelDAGLeafBit(x & 3, y & 3, z & 3)) & 1) != 0;
+}
+
+struct VoxelDAGRay
+{
+    float Origin[3];
+    float InvDirection[3];
+    float MaxT;
+    int MirrorOctant; // visiting children in order (i ^ MirrorOctant) is front to back
+};
+
+// Returns the distance at which the ray enters the box, or a negative value if it misses it.
+static float VoxelDAGIntersectBox(const VoxelDAGRay& ray, const int boxMin[3], int boxSize)
+{
+    float tEnter = 0.0f;
+    float tExit = ray.MaxT;
+    for (int axis = 0; axis < 3; axis++)
+    {
+        float t0 = (boxMin[axis] - ray.Origin[axis]) * ray.InvDirection[axis];
+        float t1 = (boxMin[axis] + boxSize - ray.Origin[axis]) * ray.InvDirection[axis];
+        tEnter = std::max(tEnter, std::min(t0, t1));
+        tExit = std::min(tExit, std::max(t0, t1));
+    }
+
+    return tEnter <= tExit ? tEnter : -1.0f;
+}
+
+static bool VoxelDAGRaycastLeaf(const VoxelDAGRay& ray, uint64_t leaf, const int leafMin[3], float* pHitT)
+{
+    // Two levels of 2x2x2 blocks
+    for (int i = 0; i < 8; i++)
+    {
+        int blockOctant = i ^ ray.MirrorOctant;
+        int blockMin[3] = {
+            leafMin[0] + (blockOctant & 1) * 2,
+            leafMin[1] + ((blockOctant >> 1) & 1) * 2,
+            leafMin[2] + (blockOctant >> 2) * 2
+        };
+
+        if (VoxelDAGIntersectBox(ray, blockMin, 2) < 0.0f)
+            continue;
+
+        for (int j = 0; j < 8; j++)
+        {
+            int voxelOctant = j ^ ray.MirrorOctant;
+            int voxel[3] = {
+                blockMin[0] + (voxelOctant & 1),
+                blockMin[1] + ((voxelOctant >> 1) & 1),
+                blockMin[2] + (voxelOctant >> 2)
+            };
+
+            if (!((leaf >> VoxelDAGLeafBit(voxel[0] - leafMin[0], voxel[1] - leafMin[1], voxel[2] - leafMin[2])) & 1))
+                continue;
+
+            float t = VoxelDAGIntersectBox(ray, voxel, 1);
+            if (t >= 0.0f)
+            {
+                *pHitT = t;
+                return true;
+            }
+        }
+    }
+
+    return false;
+}
+
+static bool VoxelDAGRaycastNode(
+    const VoxelDAG& dag, const VoxelDAGRay& ray,
+    uint32_t node, int level, const int nodeMin[3], int nodeSize,
+    float* pHitT)
+{
+    int childSize = nodeSize / 2;
+
+    for (int i = 0; i < 8; i++)
+    {
+        int octant = i ^ ray.MirrorOctant;
+
+        uint32_t child = VoxelDAGGetChild(dag, node, octant);
+        if (child == kVoxelDAGEmpty)
+            continue;
+
+        int childMin[3] = {
+            nodeMin[0] + (octant & 1) * childSize,
+            nodeMin[1] + ((octant >> 1) & 1) * childSize,
+            nodeMin[2] + (octant >> 2) * childSize
+        };
+
+        if (VoxelDAGIntersectBox(ray, childMin, childSize) < 0.0f)
+            continue;
+
+        if (level + 1 == dag.NumLevels)
+        {
+            if (VoxelDAGRaycastLeaf(ray, dag.Leaves[child], childMin, pHitT))
+                return true;
+        }
+        else if (VoxelDAGRaycastNode(dag, ray, child, level + 1, childMin, childSize, pHitT))
+        {
+            return true;
+        }
+    }
+
+    return false;
+}
+
+bool VoxelDAGRaycast(
+    const VoxelDAG& dag,
+    const XMFLOAT3& origin, const XMFLOAT3& direction, float maxT,
+    float* pHitT)
+{
+    if (dag.Root == kVoxelDAGEmpty)
+        return false;
+
+    VoxelDAGRay ray;
+    const float* pOrigin = &origin.x;
+    const float* pDirection = &direction.x;
+    ray.MirrorOctant = 0;
+    for (int axis = 0; axis < 3; axis++)
+    {
+        // avoid infinities, which turn into NaNs for rays lying on a box's face
+        float d = pDirection[axis];
+        if (std::abs(d) < 1e-20f)
+            d = d < 0.0f ? -1e-20f : 1e-20f;
+
+        ray.Origin[axis] = pOrigin[axis];
+        ray.InvDirection[axis] = 1.0f / d;
+        if (d < 0.0f)
+            ray.MirrorOctant |= 1 << axis;
+    }
+    ray.MaxT = maxT;
+
+    int rootMin[3] = { 0, 0, 0 };
+    if (VoxelDAGIntersectBox(ray, rootMin, dag.Size) < 0.0f)
+        return false;
+
+    return VoxelDAGRaycastNode(dag, ray, dag.Root, 0, rootMin, dag.Size, pHitT);
+}
+
+uint64_t VoxelDAGGetMemorySize(const VoxelDAG& dag)
+{
+    return dag.Nodes.size() * sizeof(uint32_t) + dag.Leaves.size() * sizeof(uint64_t);
+}
+
+void VoxelDAGSerialize(const VoxelDAG& dag, std::vector<uint8_t>* pBytes)
+{
+    VoxelDAGHeader header;
+    header.Magic = kVoxelDAGMagic;
+    header.Version = kVoxelDAGVersion;
+    header.Size = dag.Size;
+    header.NumLevels = dag.NumLevels;
+    header.Root = dag.Root;
+    header.NumNodeWords = (uint32_t)dag.Nodes.size();
+    header.NumLeaves = (uint32_t)dag.Leaves.size();
+
+    size_t nodesBytes = dag.Nodes.size() * sizeof(uint32_t);
+    size_t leavesBytes = dag.Leaves.size() * sizeof(uint64_t);
+
+    pBytes->resize(sizeof(header) + nodesBytes + leavesBytes);
+    uint8_t* pDst = pBytes->data();
+    memcpy(pDst, &header, sizeof(header));
+    if (nodesBytes)
+        memcpy(pDst + sizeof(header), dag.Nodes.data(), nodesBytes);
+    if (leavesBytes)
+        memcpy(pDst + sizeof(header) + nodesBytes, dag.Leaves.data(), leavesBytes);
+}
+
+// Walks every node reachable from the root, checking that its children are in the node or leaf arrays and that no
+// node is reached at two different levels, so lookups and raycasts never read past the arrays.
+static bool VoxelDAGValidateNodes(const std::vector<uint32_t>& nodes, size_t numLeaves, uint32_t root, int numLevels)
+{
+    if (root == kVoxelDAGEmpty)
+        return true;
+
+    std::unordered_map<uint32_t, int> nodeLevels;
+    std::vector<std::pair<uint32_t, int>> stack(1, std::make_pair(root, 0));
+    while (!stack.empty())
+    {
+        uint32_t node = stack.back().first;
+        int level = stack.back().second;
+        stack.pop_back();
+
+        auto inserted = nodeLevels.emplace(node, level);
+        if (!inserted.second)
+        {
+            if (inserted.first->second != level)
+                return false;
+            continue;
+        }
+
+        if (node >= nodes.size())
+            return false;
+
+        uint32_t mask = nodes[node];
+        if (mask == 0 || mask > 0xFF)
+            return false;
+
+        int numChildren = VoxelDAGPopCount(mask);
+        if (node + 1 + (size_t)numChildren > nodes.size())
+            return false;
+
+        for (int i = 0; i < numChildren; i++)
+        {
+            uint32_t child = nodes[node + 1 + i];
+            if (level + 1 == numLevels)
+            {
+                if (child >= numLeaves)
+                    return false;
+            }
+            else
+            {
+                stack.push_back(std::make_pair(child, level + 1));
+            }
+        }
+    }
+
+    return true;
+}
+
+bool VoxelDAGDeserialize(const uint8_t* pBytes, size_t numBytes, VoxelDAG* pDAG)
+{
+    VoxelDAGHeader header;
+    if (numBytes < sizeof(header))
+        return false;
+
+    memcpy(&header, pBytes, sizeof(header));
+    if (header.Magic != kVoxelDAGMagic || header.Version != kVoxelDAGVersion)
+        return false;
+
+    size_t nodesBytes = (size_t)header.NumNodeWords * sizeof(uint32_t);
+    size_t leavesBytes = (size_t)header.NumLeaves * sizeof(uint64_t);
+    if (numBytes != sizeof(header) + nodesBytes + leavesBytes)
+        return false;
+
+    // Size is a power of two of at least a brick, with one level of nodes for every halving down to the leaves
+    if (header.Size < (uint32_t)kVoxelBrickSize || header.Size > (1u << 21) || (header.Size & (header.Size - 1)) != 0)
+        return false;
+
+    uint32_t numLevels = 0;
+    for (uint32_t nodeSize = kVoxelDAGLeafSize * 2; nodeSize <= header.Size; nodeSize *= 2)
+    {
+        numLevels++;
+    }
+    if (header.NumLevels != numLevels)
+        return false;
+
+    std::vector<uint32_t> nodes(header.NumNodeWords);
+    if (nodesBytes)
+        memcpy(nodes.data(), pBytes + sizeof(header), nodesBytes);
+
+    if (!VoxelDAGValidateNodes(nodes, header.NumLeaves, header.Root, (int)header.NumLevels))
+        return false;
+
+    pDAG->Size = header.Size;
+    pDAG->NumLevels = header.NumLevels;
+    pDAG->Root = header.Root;
+    pDAG->Nodes.swap(nodes);
+    pDAG->Leaves.resize(header.NumLeaves);
+    if (leavesBytes)
+        memcpy(pDAG->Leaves.data(), pBytes + sizeof(header) + nodesBytes, leavesBytes);
+
+    return true;
+}
\ No newline at end of file
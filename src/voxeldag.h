@@ -0,0 +1,62 @@
+#pragma once
+
+#include "voxelizer.h"
+
+#include <DirectXMath.h>
+
+#include <vector>
+#include <cstdint>
+
+// Sparse voxel DAG of static occupancy.
+// The voxelized scene is built into a sparse voxel octree bottom-up, merging identical subtrees
+// as it goes, so repeated geometry is stored once.
+//
+// Interior nodes are stored in Nodes as a child mask word followed by one word per existing child.
+// Children of the nodes one level above the leaves are indices into Leaves,
+// and all other children are offsets of nodes in Nodes.
+// Leaves are 4x4x4 occupancy bitmasks with bit (z * 16 + y * 4 + x).
+
+static const uint32_t kVoxelDAGEmpty = 0xFFFFFFFF;
+static const int kVoxelDAGLeafSize = 4;
+
+struct VoxelDAG
+{
+    int Size; // voxels along each axis
+    int NumLevels; // levels of interior nodes, the root being level 0
+    uint32_t Root; // kVoxelDAGEmpty if nothing is occupied
+    std::vector<uint32_t> Nodes;
+    std::vector<uint64_t> Leaves;
+};
+
+struct VoxelDAGStats
+{
+    uint64_t NumOccupiedVoxels;
+    uint64_t NumOctreeNodes; // interior nodes and leaves before merging
+    uint64_t NumDAGNodes; // interior nodes and leaves after merging
+};
+
+// grid.Size must be a power of two of at least kVoxelBrickSize.
+void VoxelDAGBuild(
+    const std::vector<VoxelizerTriangle>& triangles,
+    const VoxelGridDesc& grid,
+    int numThreads, // 0 uses every hardware thread
+    VoxelDAG* pDAG,
+    VoxelDAGStats* pStats = NULL);
+
+bool VoxelDAGIsOccupied(const VoxelDAG& dag, int x, int y, int z);
+
+// Casts a ray in voxel coordinates, where the volume spans [0, Size] on each axis.
+// Returns true and the distance along the ray to the first occupied voxel within [0, maxT].
+bool VoxelDAGRaycast(
+    const VoxelDAG& dag,
+    const DirectX::XMFLOAT3& origin, const DirectX::XMFLOAT3& direction, float maxT,
+    float* pHitT);
+
+uint64_t VoxelDAGGetMemorySize(const VoxelDAG& dag);
+
+// Compact little-endian serialization: a small header followed by the node and leaf arrays as they are in memory.
+void VoxelDAGSerialize(const VoxelDAG& dag, std::vector<uint8_t>* pBytes);
+
+// Returns false if the bytes aren't a valid serialized DAG: a header that doesn't match the arrays' sizes, a number of
+// levels that doesn't fit the size, or a node whose children are past the node or leaf arrays.
+bool VoxelDAGDeserialize(const uint8_t* pBytes, size_t numBytes, VoxelDAG* pDAG);
\ No newline at end of file
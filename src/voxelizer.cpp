@@ -0,0 +1,417 @@
+#include "voxelizer.h"
+
+#include "parallel.h"
+
+#include <emmintrin.h>
+
+#include <algorithm>
+#include <cmath>
+
+using namespace DirectX;
+
+// Separating axes for the triangle/box test (Akenine-Moller):
+// the triangle's normal and the 9 cross products of its edges with the box's axes.
+// The box's own axes are covered by only visiting voxels inside the triangle's bounds.
+static const int kNumSeparatingAxes = 10;
+
+struct VoxelizerTriangleSetup
+{
+    // voxel-space vertices
+    XMFLOAT3 V0;
+    XMFLOAT3 E0; // V1 - V0
+    XMFLOAT3 E1; // V2 - V0
+
+    int MinVoxel[3];
+    int MaxVoxel[3];
+
+    // A voxel with center C overlaps the triangle iff dot(Axis, C) is in [AxisMin, AxisMax] for every axis.
+    // Axis 0 is the triangle's normal.
+    float Axis[kNumSeparatingAxes][3];
+    float AxisMin[kNumSeparatingAxes];
+    float AxisMax[kNumSeparatingAxes];
+
+    // for the barycentric coordinates of voxel centers projected onto the triangle
+    float D00, D01, D11, InvDenom;
+};
+
+static bool VoxelizerSetupTriangle(const VoxelizerTriangle& triangle, const VoxelGridDesc& grid, VoxelizerTriangleSetup* pSetup)
+{
+    XMVECTOR origin = XMLoadFloat3(&grid.Origin);
+    float invVoxelSize = 1.0f / grid.VoxelSize;
+
+    XMVECTOR v[3];
+    for (int i = 0; i < 3; i++)
+    {
+        v[i] = XMVectorScale(XMVectorSubtract(XMLoadFloat3(&triangle.Positions[i]), origin), invVoxelSize);
+    }
+
+    XMVECTOR vmin = XMVectorMin(v[0], XMVectorMin(v[1], v[2]));
+    XMVECTOR vmax = XMVectorMax(v[0], XMVectorMax(v[1], v[2]));
+    XMFLOAT3 fmin, fmax;
+    XMStoreFloat3(&fmin, vmin);
+    XMStoreFloat3(&fmax, vmax);
+
+    const float* pmin = &fmin.x;
+    const float* pmax = &fmax.x;
+    for (int axis = 0; axis < 3; axis++)
+    {
+        if (pmax[axis] < 0.0f || pmin[axis] > (float)grid.Size)
+        {
+            return false;
+        }
+
+        // a vertex exactly on a voxel boundary touches the voxels on both sides
+        pSetup->MinVoxel[axis] = std::max(0, (int)std::ceil(pmin[axis]) - 1);
+        pSetup->MaxVoxel[axis] = std::min(grid.Size - 1, (int)std::floor(pmax[axis]));
+    }
+
+    XMVECTOR e0 = XMVectorSubtract(v[1], v[0]);
+    XMVECTOR e1 = XMVectorSubtract(v[2], v[0]);
+    XMStoreFloat3(&pSetup->V0, v[0]);
+    XMStoreFloat3(&pSetup->E0, e0);
+    XMStoreFloat3(&pSetup->E1, e1);
+
+    XMFLOAT3 edges[3];
+    XMStoreFloat3(&edges[0], e0);
+    XMStoreFloat3(&edges[1], XMVectorSubtract(v[2], v[1]));
+    XMStoreFloat3(&edges[2], XMVectorSubtract(v[0], v[2]));
+
+    XMFLOAT3 axes[kNumSeparatingAxes];
+    XMStoreFloat3(&axes[0], XMVector3Cross(e0, e1));
+    for (int i = 0; i < 3; i++)
+    {
+        const XMFLOAT3& e = edges[i];
+        axes[1 + i * 3 + 0] = XMFLOAT3(0.0f, -e.z, e.y); // cross(X, e)
+        axes[1 + i * 3 + 1] = XMFLOAT3(e.z, 0.0f, -e.x); // cross(Y, e)
+        axes[1 + i * 3 + 2] = XMFLOAT3(-e.y, e.x, 0.0f); // cross(Z, e)
+    }
+
+    XMFLOAT3 fv[3];
+    for (int i = 0; i < 3; i++)
+    {
+        XMStoreFloat3(&fv[i], v[i]);
+    }
+
+    for (int axis = 0; axis < kNumSeparatingAxes; axis++)
+    {
+        const XMFLOAT3& a = axes[axis];
+        float p0 = a.x * fv[0].x + a.y * fv[0].y + a.z * fv[0].z;
+        float p1 = a.x * fv[1].x + a.y * fv[1].y + a.z * fv[1].z;
+        float p2 = a.x * fv[2].x + a.y * fv[2].y + a.z * fv[2].z;
+
+        // projected radius of a voxel, whose half extent is 0.5
+        float r = 0.5f * (std::abs(a.x) + std::abs(a.y) + std::abs(a.z));
+
+        pSetup->Axis[axis][0] = a.x;
+        pSetup->Axis[axis][1] = a.y;
+        pSetup->Axis[axis][2] = a.z;
+        pSetup->AxisMin[axis] = std::min(p0, std::min(p1, p2)) - r;
+        pSetup->AxisMax[axis] = std::max(p0, std::max(p1, p2)) + r;
+    }
+
+    pSetup->D00 = XMVectorGetX(XMVector3Dot(e0, e0));
+    pSetup->D01 = XMVectorGetX(XMVector3Dot(e0, e1));
+    pSetup->D11 = XMVectorGetX(XMVector3Dot(e1, e1));
+    float denom = pSetup->D00 * pSetup->D11 - pSetup->D01 * pSetup->D01;
+    pSetup->InvDenom = denom != 0.0f ? 1.0f / denom : 0.0f;
+
+    return true;
+}
+
+static XMVECTOR VoxelizerSampleAlbedo(const VoxelizerTriangle& triangle, const VoxelizerTriangleSetup& setup, float cx, float cy, float cz)
+{
+    XMVECTOR albedo = XMLoadFloat3(&triangle.Albedo);
+
+    const VoxelizerTexture* pTexture = triangle.pAlbedoTexture;
+    if (!pTexture)
+    {
+        return albedo;
+    }
+
+    // Barycentric coordinates of the voxel center projected onto the triangle, clamped onto the triangle
+    float px = cx - setup.V0.x, py = cy - setup.V0.y, pz = cz - setup.V0.z;
+    float d20 = px * setup.E0.x + py * setup.E0.y + pz * setup.E0.z;
+    float d21 = px * setup.E1.x + py * setup.E1.y + pz * setup.E1.z;
+    float b1 = std::min(std::max((setup.D11 * d20 - setup.D01 * d21) * setup.InvDenom, 0.0f), 1.0f);
+    float b2 = std::min(std::max((setup.D00 * d21 - setup.D01 * d20) * setup.InvDenom, 0.0f), 1.0f);
+    float b0 = std::max(1.0f - b1 - b2, 0.0f);
+    float bsum = b0 + b1 + b2;
+    b0 /= bsum; b1 /= bsum; b2 /= bsum;
+
+    float u = b0 * triangle.TexCoords[0].x + b1 * triangle.TexCoords[1].x + b2 * triangle.TexCoords[2].x;
+    float v = b0 * triangle.TexCoords[0].y + b1 * triangle.TexCoords[1].y + b2 * triangle.TexCoords[2].y;
+
+    // nearest texel, wrapped
+    u -= std::floor(u);
+    v -= std::floor(v);
+    int tx = std::min((int)(u * pTexture->Width), pTexture->Width - 1);
+    int ty = std::min((int)(v * pTexture->Height), pTexture->Height - 1);
+
+    return XMVectorMultiply(albedo, XMLoadFloat3(&pTexture->Texels[ty * pTexture->Width + tx]));
+}
+
+// Accumulates the albedo of one triangle into the voxels of a brick row it overlaps.
+// pAccum holds (R,G,B,count) for the kVoxelBrickSize^2 x Size voxels of the row starting at (0, rowY, rowZ).
+static void VoxelizerRasterizeTriangle(
+    const VoxelizerTriangle& triangle, const VoxelizerTriangleSetup& setup,
+    int gridSize, int rowY, int rowZ, XMFLOAT4* pAccum)
+{
+    const __m128 kLaneOffsets = _mm_setr_ps(0.5f, 1.5f, 2.5f, 3.5f);
+
+    int y0 = std::max(setup.MinVoxel[1], rowY), y1 = std::min(setup.MaxVoxel[1], rowY + kVoxelBrickSize - 1);
+    int z0 = std::max(setup.MinVoxel[2], rowZ), z1 = std::min(setup.MaxVoxel[2], rowZ + kVoxelBrickSize - 1);
+
+    __m128 axisX[kNumSeparatingAxes];
+    for (int axis = 0; axis < kNumSeparatingAxes; axis++)
+    {
+        axisX[axis] = _mm_set1_ps(setup.Axis[axis][0]);
+    }
+
+    for (int z = z0; z <= z1; z++)
+    {
+        float cz = z + 0.5f;
+
+        for (int y = y0; y <= y1; y++)
+        {
+            float cy = y + 0.5f;
+
+            // Bring the parts of the tests that don't depend on x to the other side
+            float rowMin[kNumSeparatingAxes], rowMax[kNumSeparatingAxes];
+            for (int axis = 0; axis < kNumSeparatingAxes; axis++)
+            {
+                float rowDot = setup.Axis[axis][1] * cy + setup.Axis[axis][2] * cz;
+                rowMin[axis] = setup.AxisMin[axis] - rowDot;
+                rowMax[axis] = setup.AxisMax[axis] - rowDot;
+            }
+
+            // The plane test alone bounds the x range of this row, which keeps large slanted triangles cheap
+            int x0 = setup.MinVoxel[0], x1 = setup.MaxVoxel[0];
+            float nx = setup.Axis[0][0];
+            if (std::abs(nx) > 1e-6f)
+            {
+                float t0 = rowMin[0] / nx, t1 = rowMax[0] / nx;
+                float cxMin = std::min(t0, t1), cxMax = std::max(t0, t1);
+                x0 = std::max(x0, (int)std::floor(cxMin - 0.5f) - 1);
+                x1 = std::min(x1, (int)std::ceil(cxMax - 0.5f) + 1);
+            }
+            else if (rowMin[0] > 0.0f || rowMax[0] < 0.0f)
+            {
+                continue;
+            }
+
+            __m128 vRowMin[kNumSeparatingAxes], vRowMax[kNumSeparatingAxes];
+            for (int axis = 0; axis < kNumSeparatingAxes; axis++)
+            {
+                vRowMin[axis] = _mm_set1_ps(rowMin[axis]);
+                vRowMax[axis] = _mm_set1_ps(rowMax[axis]);
+            }
+
+            XMFLOAT4* pRowAccum = &pAccum[((z - rowZ) * kVoxelBrickSize + (y - rowY)) * gridSize];
+
+            for (int x = x0; x <= x1; x += 4)
+            {
+                __m128 cx = _mm_add_ps(_mm_set1_ps((float)x), kLaneOffsets);
+
+                __m128 overlap = _mm_castsi128_ps(_mm_set1_epi32(-1));
+                for (int axis = 0; axis < kNumSeparatingAxes; axis++)
+                {
+                    __m128 d = _mm_mul_ps(axisX[axis], cx);
+                    overlap = _mm_and_ps(overlap, _mm_and_ps(_mm_cmpge_ps(d, vRowMin[axis]), _mm_cmple_ps(d, vRowMax[axis])));
+                }
+
+                int laneMask = _mm_movemask_ps(overlap);
+                while (laneMask != 0)
+                {
+                    int lane = 0;
+                    while (!(laneMask & (1 << lane)))
+                        lane++;
+                    laneMask &= ~(1 << lane);
+
+                    int voxelX = x + lane;
+                    if (voxelX > x1)
+                        break;
+
+                    XMVECTOR albedo = VoxelizerSampleAlbedo(triangle, setup, voxelX + 0.5f, cy, cz);
+                    XMFLOAT4& accum = pRowAccum[voxelX];
+                    accum.x += XMVectorGetX(albedo);
+                    accum.y += XMVectorGetY(albedo);
+                    accum.z += XMVectorGetZ(albedo);
+                    accum.w += 1.0f;
+                }
+            }
+        }
+    }
+}
+
+static uint32_t VoxelizerEncodeAlbedo(const XMFLOAT4& accum)
+{
+    float invCount = 1.0f / accum.w;
+    float rgb[3] = { accum.x * invCount, accum.y * invCount, accum.z * invCount };
+
+    uint32_t encoded = 0xFF000000;
+    for (int i = 0; i < 3; i++)
+    {
+        float srgb = std::pow(std::min(std::max(rgb[i], 0.0f), 1.0f), 1.0f / 2.2f);
+        encoded |= (uint32_t)(srgb * 255.0f + 0.5f) << (i * 8);
+    }
+
+    return encoded;
+}
+
+void VoxelizerCreateTexture(
+    const uint8_t* srgbRGBA, int width, int height,
+    int maxSize, VoxelizerTexture* pTexture)
+{
+    int factor = std::max(1, (std::max(width, height) + maxSize - 1) / maxSize);
+
+    pTexture->Width = (width + factor - 1) / factor;
+    pTexture->Height = (height + factor - 1) / factor;
+    pTexture->Texels.resize(pTexture->Width * pTexture->Height);
+
+    for (int ty = 0; ty < pTexture->Height; ty++)
+    {
+        for (int tx = 0; tx < pTexture->Width; tx++)
+        {
+            float sum[3] = { 0.0f, 0.0f, 0.0f };
+            int count = 0;
+
+            for (int y = ty * factor; y < std::min(height, (ty + 1) * factor); y++)
+            {
+                for (int x = tx * factor; x < std::min(width, (tx + 1) * factor); x++)
+                {
+                    const uint8_t* texel = &srgbRGBA[(y * width + x) * 4];
+                    for (int i = 0; i < 3; i++)
+                    {
+                        sum[i] += std::pow(texel[i] / 255.0f, 2.2f);
+                    }
+                    count++;
+                }
+            }
+
+            pTexture->Texels[ty * pTexture->Width + tx] = XMFLOAT3(sum[0] / count, sum[1] / count, sum[2] / count);
+        }
+    }
+}
+
+void VoxelizeTrianglesByRow(
+    const std::vector<VoxelizerTriangle>& triangles,
+    const VoxelGridDesc& grid,
+    const VoxelizerRowCallback& rowCallback,
+    int numThreads)
+{
+    const int size = grid.Size;
+    const int numRowsPerAxis = size / kVoxelBrickSize;
+
+    // Bin triangles into rows of bricks along x, which are voxelized independently.
+    // Every row owns its voxels, so no two threads ever write the same voxel.
+    std::vector<std::vector<int>> rowTriangles(numRowsPerAxis * numRowsPerAxis);
+    for (int triangleID = 0; triangleID < (int)triangles.size(); triangleID++)
+    {
+        VoxelizerTriangleSetup setup;
+        if (!VoxelizerSetupTriangle(triangles[triangleID], grid, &setup))
+            continue;
+
+        for (int bz = setup.MinVoxel[2] / kVoxelBrickSize; bz <= setup.MaxVoxel[2] / kVoxelBrickSize; bz++)
+        {
+            for (int by = setup.MinVoxel[1] / kVoxelBrickSize; by <= setup.MaxVoxel[1] / kVoxelBrickSize; by++)
+            {
+                rowTriangles[bz * numRowsPerAxis + by].push_back(triangleID);
+            }
+        }
+    }
+
+    if (numThreads <= 0)
+        numThreads = ParallelGetDefaultNumThreads();
+
+    // Per-thread row buffers are kept cleared between rows,
+    // so only the x range touched by a row's triangles has to be cleared again.
+    std::vector<std::vector<XMFLOAT4>> threadAccum(numThreads);
+    std::vector<std::vector<uint32_t>> threadRowVoxels(numThreads);
+
+    ParallelFor((int)rowTriangles.size(), numThreads, [&](int rowID, int threadIndex)
+    {
+        if (rowTriangles[rowID].empty())
+            return;
+
+        int rowY = (rowID % numRowsPerAxis) * kVoxelBrickSize;
+        int rowZ = (rowID / numRowsPerAxis) * kVoxelBrickSize;
+        const int numRowLines = kVoxelBrickSize * kVoxelBrickSize;
+
+        std::vector<XMFLOAT4>& accum = threadAccum[threadIndex];
+        std::vector<uint32_t>& rowVoxels = threadRowVoxels[threadIndex];
+        if (accum.empty())
+        {
+            accum.resize(numRowLines * size, XMFLOAT4(0.0f, 0.0f, 0.0f, 0.0f));
+            rowVoxels.resize(numRowLines * size, 0);
+        }
+
+        int x0 = size, x1 = -1;
+        for (int triangleID : rowTriangles[rowID])
+        {
+            VoxelizerTriangleSetup setup;
+            VoxelizerSetupTriangle(triangles[triangleID], grid, &setup);
+            VoxelizerRasterizeTriangle(triangles[triangleID], setup, size, rowY, rowZ, accum.data());
+
+            x0 = std::min(x0, setup.MinVoxel[0]);
+            x1 = std::max(x1, setup.MaxVoxel[0]);
+        }
+
+        for (int line = 0; line < numRowLines; line++)
+        {
+            for (int x = x0; x <= x1; x++)
+            {
+                XMFLOAT4& voxelAccum = accum[line * size + x];
+                if (voxelAccum.w != 0.0f)
+                {
+                    rowVoxels[line * size + x] = VoxelizerEncodeAlbedo(voxelAccum);
+                    voxelAccum = XMFLOAT4(0.0f, 0.0f, 0.0f, 0.0f);
+                }
+            }
+        }
+
+        rowCallback(rowY, rowZ, rowVoxels.data());
+
+        for (int line = 0; line < numRowLines; line++)
+        {
+            std::fill(&rowVoxels[line * size + x0], &rowVoxels[line * size + x1] + 1, 0);
+        }
+    });
+}
+
+uint64_t VoxelizeTriangles(
+    const std::vector<VoxelizerTriangle>& triangles,
+    const VoxelGridDesc& grid,
+    uint32_t* pVoxels)
+{
+    const int size = grid.Size;
+
+    // rows without triangles aren't reported
+    std::fill(pVoxels, pVoxels + (uint64_t)size * size * size, 0);
+
+    std::atomic<uint64_t> numOccupied(0);
+
+    VoxelizeTrianglesByRow(triangles, grid, [&](int rowY, int rowZ, const uint32_t* pRowVoxels)
+    {
+        uint64_t rowNumOccupied = 0;
+
+        for (int z = 0; z < kVoxelBrickSize; z++)
+        {
+            for (int y = 0; y < kVoxelBrickSize; y++)
+            {
+                const uint32_t* pSrc = &pRowVoxels[(z * kVoxelBrickSize + y) * size];
+                uint32_t* pDst = &pVoxels[((uint64_t)(rowZ + z) * size + (rowY + y)) * size];
+
+                for (int x = 0; x < size; x++)
+                {
+                    pDst[x] = pSrc[x];
+                    if (pSrc[x] != 0)
+                        rowNumOccupied++;
+                }
+            }
+        }
+
+        numOccupied += rowNumOccupied;
+    });
+
+    return numOccupied;
+}
\ No newline at end of file
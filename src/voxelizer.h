@@ -0,0 +1,57 @@
+#pragma once
+
+#include <DirectXMath.h>
+
+#include <vector>
+#include <cstdint>
+#include <functional>
+
+// Low resolution linear-space copy of a texture, sampled for voxel albedo.
+struct VoxelizerTexture
+{
+    int Width;
+    int Height;
+    std::vector<DirectX::XMFLOAT3> Texels;
+};
+
+struct VoxelizerTriangle
+{
+    DirectX::XMFLOAT3 Positions[3]; // world space
+    DirectX::XMFLOAT2 TexCoords[3];
+    DirectX::XMFLOAT3 Albedo; // linear, multiplied with the texture if there is one
+    const VoxelizerTexture* pAlbedoTexture;
+};
+
+struct VoxelGridDesc
+{
+    DirectX::XMFLOAT3 Origin; // world-space corner of voxel (0,0,0)
+    float VoxelSize;
+    int Size; // voxels along each axis, must be a multiple of kVoxelBrickSize
+};
+
+static const int kVoxelBrickSize = 8;
+
+void VoxelizerCreateTexture(
+    const uint8_t* srgbRGBA, int width, int height,
+    int maxSize, VoxelizerTexture* pTexture);
+
+// Called once for every row of bricks along x with the voxels of that row,
+// stored as kVoxelBrickSize * kVoxelBrickSize lines of Size voxels (z-major, then y).
+// Rows that no triangle touches are skipped, since all their voxels are empty.
+// Calls for different rows can happen concurrently from several threads.
+typedef std::function<void(int rowY, int rowZ, const uint32_t* pRowVoxels)> VoxelizerRowCallback;
+
+// Conservatively voxelizes the triangles: a voxel is occupied if any triangle touches its box.
+// Voxels are RGBA8. RGB is the sRGB-encoded average albedo of the triangles touching the voxel,
+// and A is 255 for occupied voxels. Empty voxels are 0.
+void VoxelizeTrianglesByRow(
+    const std::vector<VoxelizerTriangle>& triangles,
+    const VoxelGridDesc& grid,
+    const VoxelizerRowCallback& rowCallback,
+    int numThreads = 0); // 0 uses every hardware thread
+
+// Voxelizes into Size^3 voxels in x-major order. Returns the number of occupied voxels.
+uint64_t VoxelizeTriangles(
+    const std::vector<VoxelizerTriangle>& triangles,
+    const VoxelGridDesc& grid,
+    uint32_t* pVoxels);
\ No newline at end of file
@@ -0,0 +1,174 @@
+#include "voxelmip.h"
+
+#include "parallel.h"
+
+#include <emmintrin.h>
+
+#include <algorithm>
+#include <cmath>
+
+static const int kVoxelMipTileSize = 8;
+
+// Same gamma as the voxelizer's albedo encoding
+static const float kVoxelMipGamma = 2.2f;
+static const int kVoxelMipEncodeTableSize = 4096;
+
+struct VoxelMipTables
+{
+    float Linear[256];
+    uint8_t Encode[kVoxelMipEncodeTableSize]; // indexed by linear value * (kVoxelMipEncodeTableSize - 1)
+
+    VoxelMipTables()
+    {
+        for (int i = 0; i < 256; i++)
+        {
+            Linear[i] = std::pow(i / 255.0f, kVoxelMipGamma);
+        }
+
+        for (int i = 0; i < kVoxelMipEncodeTableSize; i++)
+        {
+            float srgb = std::pow(i / (float)(kVoxelMipEncodeTableSize - 1), 1.0f / kVoxelMipGamma);
+            Encode[i] = (uint8_t)(srgb * 255.0f + 0.5f);
+        }
+    }
+};
+
+static const VoxelMipTables& VoxelMipGetTables()
+{
+    static const VoxelMipTables tables;
+    return tables;
+}
+
+int VoxelMipGetNumLevels(int size)
+{
+    int numLevels = 1;
+    while (size > 1)
+    {
+        size /= 2;
+        numLevels++;
+    }
+    return numLevels;
+}
+
+// Calls downsampleSpan(srcLines, pDst, count) for spans of up to kVoxelMipTileSize destination voxels,
+// where srcLines are the 4 source lines (y, z), (y+1, z), (y, z+1), (y+1, z+1) starting at the span's first child.
+template<class Voxel, class DownsampleSpan>
+static void VoxelMipDownsample(
+    const Voxel* pSrc, int srcSize, Voxel* pDst,
+    int numThreads, const DownsampleSpan& downsampleSpan)
+{
+    const int dstSize = std::max(srcSize / 2, 1);
+    const int tileSize = std::min(kVoxelMipTileSize, dstSize);
+    const int numTilesPerAxis = dstSize / tileSize;
+
+    ParallelFor(numTilesPerAxis, numThreads, [&](int tz, int)
+    {
+        for (int ty = 0; ty < numTilesPerAxis; ty++)
+        {
+            for (int tx = 0; tx < numTilesPerAxis; tx++)
+            {
+                for (int z = tz * tileSize; z < (tz + 1) * tileSize; z++)
+                {
+                    for (int y = ty * tileSize; y < (ty + 1) * tileSize; y++)
+                    {
+                        const Voxel* srcLines[4];
+                        for (int i = 0; i < 4; i++)
+                        {
+                            size_t sy = y * 2 + (i & 1);
+                            size_t sz = z * 2 + (i >> 1);
+                            srcLines[i] = &pSrc[(sz * srcSize + sy) * srcSize + tx * tileSize * 2];
+                        }
+
+                        Voxel* pDstSpan = &pDst[((size_t)z * dstSize + y) * dstSize + tx * tileSize];
+                        downsampleSpan(srcLines, pDstSpan, tileSize);
+                    }
+                }
+            }
+        }
+    });
+}
+
+void VoxelMipDownsampleOccupancy(
+    const uint8_t* pSrc, int srcSize, uint8_t* pDst,
+    int numThreads)
+{
+    VoxelMipDownsample(pSrc, srcSize, pDst, numThreads, [](const uint8_t* const srcLines[4], uint8_t* pDstSpan, int count)
+    {
+        if (count == kVoxelMipTileSize)
+        {
+            // 16 children along x per line: max the 4 lines, then max neighboring bytes and pack them down
+            __m128i m = _mm_max_epu8(
+                _mm_max_epu8(_mm_loadu_si128((const __m128i*)srcLines[0]), _mm_loadu_si128((const __m128i*)srcLines[1])),
+                _mm_max_epu8(_mm_loadu_si128((const __m128i*)srcLines[2]), _mm_loadu_si128((const __m128i*)srcLines[3])));
+            m = _mm_max_epu8(m, _mm_srli_epi16(m, 8));
+            m = _mm_and_si128(m, _mm_set1_epi16(0xFF));
+            _mm_storel_epi64((__m128i*)pDstSpan, _mm_packus_epi16(m, m));
+            return;
+        }
+
+        for (int x = 0; x < count; x++)
+        {
+            uint8_t m = 0;
+            for (int i = 0; i < 4; i++)
+            {
+                const uint8_t* pChildren = &srcLines[i][x * 2];
+                m = std::max(m, std::max(pChildren[0], pChildren[1]));
+            }
+            pDstSpan[x] = m;
+        }
+    });
+}
+
+void VoxelMipDownsampleAlbedo(
+    const uint32_t* pSrc, int srcSize, uint32_t* pDst,
+    int numThreads)
+{
+    const VoxelMipTables& tables = VoxelMipGetTables();
+
+    VoxelMipDownsample(pSrc, srcSize, pDst, numThreads, [&tables](const uint32_t* const srcLines[4], uint32_t* pDstSpan, int count)
+    {
+        const __m128 kInv255 = _mm_set1_ps(1.0f / 255.0f);
+
+        for (int x = 0; x < count; x++)
+        {
+            // (r * a, g * a, b * a, a) summed over the children
+            __m128 sum = _mm_setzero_ps();
+            for (int i = 0; i < 8; i++)
+            {
+                uint32_t child = srcLines[i >> 1][x * 2 + (i & 1)];
+                uint32_t alpha = child >> 24;
+                if (alpha == 0)
+                    continue;
+
+                __m128 linear = _mm_setr_ps(
+                    tables.Linear[child & 0xFF],
+                    tables.Linear[(child >> 8) & 0xFF],
+                    tables.Linear[(child >> 16) & 0xFF],
+                    1.0f);
+                sum = _mm_add_ps(sum, _mm_mul_ps(linear, _mm_mul_ps(_mm_set1_ps((float)alpha), kInv255)));
+            }
+
+            float rgba[4];
+            _mm_storeu_ps(rgba, sum);
+            if (rgba[3] == 0.0f)
+            {
+                pDstSpan[x] = 0;
+                continue;
+            }
+
+            __m128 color = _mm_div_ps(sum, _mm_set1_ps(rgba[3]));
+            color = _mm_min_ps(_mm_max_ps(color, _mm_setzero_ps()), _mm_set1_ps(1.0f));
+            __m128i indices = _mm_cvtps_epi32(_mm_mul_ps(color, _mm_set1_ps((float)(kVoxelMipEncodeTableSize - 1))));
+
+            int index[4];
+            _mm_storeu_si128((__m128i*)index, indices);
+            uint32_t alpha = (uint32_t)(rgba[3] * (255.0f / 8.0f) + 0.5f);
+
+            pDstSpan[x] =
+                (uint32_t)tables.Encode[index[0]] |
+                ((uint32_t)tables.Encode[index[1]] << 8) |
+                ((uint32_t)tables.Encode[index[2]] << 16) |
+                (alpha << 24);
+        }
+    });
+}
\ No newline at end of file
@@ -0,0 +1,22 @@
+#pragma once
+
+#include <cstdint>
+
+// CPU mip chain construction for dense voxel volumes.
+// Volumes are Size^3 voxels in x-major order, and Size must be a power of two.
+// Each level is built from the one above it in 8^3 tiles of destination voxels,
+// with slabs of tiles spread across threads.
+
+int VoxelMipGetNumLevels(int size);
+
+// Every voxel is the max of its 8 children, so a voxel is occupied if any of its children is.
+// The result is exact, so it matches a plain scalar max bit for bit.
+void VoxelMipDownsampleOccupancy(
+    const uint8_t* pSrc, int srcSize, uint8_t* pDst,
+    int numThreads = 0); // 0 uses every hardware thread
+
+// RGBA8 voxels with sRGB-encoded color.
+// RGB is the opacity-weighted average of the children in linear space, and A is their average opacity.
+void VoxelMipDownsampleAlbedo(
+    const uint32_t* pSrc, int srcSize, uint32_t* pDst,
+    int numThreads = 0);
\ No newline at end of file
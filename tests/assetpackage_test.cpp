@@ -0,0 +1,392 @@
+#include "testing.h"
+
+#include "assetpackage.h"
+
+#include <fstream>
+#include <random>
+#include <sstream>
+#include <string>
+#include <vector>
+#include <cstdint>
+#include <cstring>
+
+#ifdef SILVERWINNER_HAVE_ZLIB
+#include <zlib.h>
+#endif
+
+// The layout of the file in assetpackage.cpp: a 24 byte header, then 32 byte entries.
+static const size_t kAssetPackageTestNumEntriesOffset = 8;
+static const size_t kAssetPackageTestNamesSizeOffset = 12;
+static const size_t kAssetPackageTestHeaderSize = 24;
+static const size_t kAssetPackageTestEntrySize = 32;
+static const size_t kAssetPackageTestEntryStoredSizeOffset = 8;
+static const size_t kAssetPackageTestEntrySizeOffset = 16;
+static const size_t kAssetPackageTestEntryNameOffsetOffset = 24;
+
+static void AssetPackageTestWriteFile(const std::string& path, const std::vector<uint8_t>& bytes)
+{
+    std::ofstream file(path, std::ios::binary | std::ios::trunc);
+    file.write((const char*)bytes.data(), bytes.size());
+}
+
+static std::vector<uint8_t> AssetPackageTestReadFile(const std::string& path)
+{
+    std::ifstream file(path, std::ios::binary);
+    std::ostringstream contents;
+    contents << file.rdbuf();
+    std::string bytes = contents.str();
+    return std::vector<uint8_t>(bytes.begin(), bytes.end());
+}
+
+// Text-like bytes that zlib compresses well, with repeats both near and as far back as the window reaches.
+static std::vector<uint8_t> AssetPackageTestMakeCompressible(size_t size, unsigned seed)
+{
+    std::mt19937 rng(seed);
+    const char* words[] = { "v ", "vt ", "vn ", "f ", "0.5 ", "-1.25 ", "usemtl sponza_arch\n", "\n", "1/2/3 " };
+    std::vector<uint8_t> bytes;
+    while (bytes.size() < size)
+    {
+        const char* word = words[rng() % (sizeof(words) / sizeof(words[0]))];
+        bytes.insert(bytes.end(), word, word + strlen(word));
+        if (bytes.size() > 40000 && rng() % 64 == 0)
+        {
+            size_t distance = 32768 - rng() % 64;
+            size_t length = 300 + rng() % 300;
+            for (size_t i = 0; i < length; i++)
+            {
+                bytes.push_back(bytes[bytes.size() - distance]);
+            }
+        }
+    }
+    bytes.resize(size);
+    return bytes;
+}
+
+static std::vector<uint8_t> AssetPackageTestMakeRandom(size_t size, unsigned seed)
+{
+    std::mt19937 rng(seed);
+    std::vector<uint8_t> bytes(size);
+    for (uint8_t& byte : bytes)
+    {
+        byte = (uint8_t)rng();
+    }
+    return bytes;
+}
+
+struct AssetPackageTestFile
+{
+    const char* Name;
+    std::vector<uint8_t> Bytes;
+    bool Compress;
+    bool ExpectCompressed;
+};
+
+// Sizes around the alignment, an empty file, and files that do and don't compress, given in no particular order.
+static std::vector<AssetPackageTestFile> AssetPackageTestMakeFiles()
+{
+    std::vector<AssetPackageTestFile> files;
+    files.push_back({ "assets/sponza/sponza.obj", AssetPackageTestMakeCompressible(200000, 1), true, true });
+    files.push_back({ "assets/empty.txt", std::vector<uint8_t>(), true, false });
+    files.push_back({ "assets/sponza/textures/noise.png", AssetPackageTestMakeRandom(50000, 2), true, false });
+    files.push_back({ "assets/one.bin", std::vector<uint8_t>(1, 0x5A), false, false });
+    files.push_back({ "assets/page_minus_one.bin", AssetPackageTestMakeRandom(4095, 3), false, false });
+    files.push_back({ "assets/page.bin", AssetPackageTestMakeRandom(4096, 4), false, false });
+    files.push_back({ "assets/page_plus_one.bin", AssetPackageTestMakeRandom(4097, 5), false, false });
+    files.push_back({ "assets/sponza/sponza.mtl", AssetPackageTestMakeCompressible(5000, 6), false, false });
+    files.push_back({ "assets/sponza/small.mtl", AssetPackageTestMakeCompressible(300, 7), true, true });
+    return files;
+}
+
+static std::string AssetPackageTestWritePackage(const std::string& directory, const std::vector<AssetPackageTestFile>& files, AssetPackageWriteStats* pStats)
+{
+    std::vector<AssetPackageInput> inputs;
+    for (size_t fileIndex = 0; fileIndex < files.size(); fileIndex++)
+    {
+        AssetPackageInput input;
+        input.Name = files[fileIndex].Name;
+        input.Path = directory + "/input" + std::to_string(fileIndex);
+        input.Compress = files[fileIndex].Compress;
+        AssetPackageTestWriteFile(input.Path, files[fileIndex].Bytes);
+        inputs.push_back(input);
+    }
+
+    std::string path = directory + "/test.pak";
+    TEST_CHECK(AssetPackageWrite(path.c_str(), inputs, pStats));
+    return path;
+}
+
+// Every entry reads back as its file, the stored ones in place from a page-aligned spot of the mapping.
+static void AssetPackageTestRoundTrip(const std::string& directory)
+{
+    std::vector<AssetPackageTestFile> files = AssetPackageTestMakeFiles();
+    AssetPackageWriteStats stats;
+    std::string path = AssetPackageTestWritePackage(directory, files, &stats);
+
+    std::vector<uint8_t> fileBytes = AssetPackageTestReadFile(path);
+    TEST_CHECK(stats.FileBytes == fileBytes.size());
+    TEST_CHECK(stats.FileBytes % kAssetPackageAlignment == 0);
+
+    AssetPackage* pPackage = AssetPackageOpen(path.c_str());
+    TEST_CHECK(pPackage != NULL);
+    if (!pPackage)
+        return;
+
+    TEST_CHECK(AssetPackageGetNumEntries(pPackage) == (int)files.size());
+    for (int entryID = 1; entryID < AssetPackageGetNumEntries(pPackage); entryID++)
+    {
+        TEST_CHECK(strcmp(AssetPackageGetEntryName(pPackage, entryID - 1), AssetPackageGetEntryName(pPackage, entryID)) < 0);
+    }
+
+    int numCompressed = 0;
+    uint64_t inputBytes = 0;
+    std::vector<uint8_t> inflated;
+    for (const AssetPackageTestFile& file : files)
+    {
+        int entryID = AssetPackageFind(pPackage, file.Name);
+        TEST_CHECK(entryID != -1);
+        if (entryID == -1)
+            continue;
+
+        TEST_CHECK(strcmp(AssetPackageGetEntryName(pPackage, entryID), file.Name) == 0);
+        TEST_CHECK(AssetPackageGetEntrySize(pPackage, entryID) == file.Bytes.size());
+        TEST_CHECK(AssetPackageIsEntryCompressed(pPackage, entryID) == file.ExpectCompressed);
+
+        const uint8_t* pBytes = AssetPackageReadEntry(pPackage, entryID, &inflated);
+        TEST_CHECK(pBytes != NULL);
+        if (pBytes && !file.Bytes.empty())
+            TEST_CHECK(memcmp(pBytes, file.Bytes.data(), file.Bytes.size()) == 0);
+
+        // the mapping starts on a page, so an entry on a 4KB boundary of the file is on one in memory
+        if (pBytes && !file.ExpectCompressed)
+            TEST_CHECK((uintptr_t)pBytes % kAssetPackageAlignment == 0);
+
+        numCompressed += file.ExpectCompressed ? 1 : 0;
+        inputBytes += file.Bytes.size();
+    }
+    TEST_CHECK(stats.NumCompressed == numCompressed);
+    TEST_CHECK(stats.InputBytes == inputBytes);
+
+    AssetPackageClose(pPackage);
+}
+
+// Names match exactly, with backslashes taken as forward slashes, and anything else isn't found.
+static void AssetPackageTestFind(const std::string& directory)
+{
+    std::vector<AssetPackageTestFile> files = AssetPackageTestMakeFiles();
+    AssetPackage* pPackage = AssetPackageOpen(AssetPackageTestWritePackage(directory, files, NULL).c_str());
+    TEST_CHECK(pPackage != NULL);
+    if (!pPackage)
+        return;
+
+    TEST_CHECK(AssetPackageFind(pPackage, "assets\\sponza\\sponza.obj") == AssetPackageFind(pPackage, "assets/sponza/sponza.obj"));
+    TEST_CHECK(AssetPackageFind(pPackage, "assets/sponza/sponza.obj") != -1);
+
+    const char* missingNames[] = {
+        "", "assets", "assets/", "assets/sponza/sponza.ob", "assets/sponza/sponza.objx", "Assets/one.bin",
+        "./assets/one.bin", "/assets/one.bin", "a", "zzz", "assets/sponza/textures"
+    };
+    for (const char* name : missingNames)
+    {
+        TEST_CHECK(AssetPackageFind(pPackage, name) == -1);
+    }
+
+    AssetPackageClose(pPackage);
+
+    // an empty package finds nothing
+    std::string emptyPath = directory + "/empty.pak";
+    TEST_CHECK(AssetPackageWrite(emptyPath.c_str(), std::vector<AssetPackageInput>()));
+    pPackage = AssetPackageOpen(emptyPath.c_str());
+    TEST_CHECK(pPackage != NULL && AssetPackageGetNumEntries(pPackage) == 0);
+    if (pPackage)
+        TEST_CHECK(AssetPackageFind(pPackage, "assets/one.bin") == -1);
+    AssetPackageClose(pPackage);
+}
+
+// Names that are the same once their slashes are, and inputs that can't be read, fail the write.
+static void AssetPackageTestWriteFailures(const std::string& directory)
+{
+    std::string inputPath = directory + "/input";
+    AssetPackageTestWriteFile(inputPath, std::vector<uint8_t>(10, 1));
+
+    std::vector<AssetPackageInput> inputs(2);
+    inputs[0].Name = "assets/a.txt";
+    inputs[0].Path = inputPath;
+    inputs[0].Compress = false;
+    inputs[1] = inputs[0];
+    inputs[1].Name = "assets\\a.txt";
+    std::string path = directory + "/failed.pak";
+    TEST_CHECK(!AssetPackageWrite(path.c_str(), inputs));
+
+    inputs[1].Name = "assets/b.txt";
+    inputs[1].Path = directory + "/missing";
+    TEST_CHECK(!AssetPackageWrite(path.c_str(), inputs));
+}
+
+static void AssetPackageTestPatch(std::vector<uint8_t>* pBytes, size_t offset, uint64_t value, size_t size)
+{
+    memcpy(pBytes->data() + offset, &value, size);
+}
+
+static uint64_t AssetPackageTestReadValue(const std::vector<uint8_t>& bytes, size_t offset, size_t size)
+{
+    uint64_t value = 0;
+    memcpy(&value, bytes.data() + offset, size);
+    return value;
+}
+
+static bool AssetPackageTestOpens(const std::string& directory, const std::vector<uint8_t>& bytes)
+{
+    std::string path = directory + "/corrupt.pak";
+    AssetPackageTestWriteFile(path, bytes);
+    AssetPackage* pPackage = AssetPackageOpen(path.c_str());
+    AssetPackageClose(pPackage);
+    return pPackage != NULL;
+}
+
+// Truncated files and headers or tables of contents that point outside the file are rejected when the package is
+// opened, and a compressed entry that doesn't inflate to its size fails its read.
+static void AssetPackageTestCorruptFiles(const std::string& directory)
+{
+    std::vector<AssetPackageTestFile> files = AssetPackageTestMakeFiles();
+    std::vector<uint8_t> good = AssetPackageTestReadFile(AssetPackageTestWritePackage(directory, files, NULL));
+    TEST_CHECK(AssetPackageTestOpens(directory, good));
+
+    TEST_CHECK(AssetPackageOpen((directory + "/nothing.pak").c_str()) == NULL);
+
+    size_t truncatedSizes[] = {
+        0, 1, kAssetPackageTestHeaderSize - 1, kAssetPackageTestHeaderSize, kAssetPackageTestHeaderSize + kAssetPackageTestEntrySize,
+        kAssetPackageAlignment, good.size() / 2, good.size() - kAssetPackageAlignment, good.size() - 1
+    };
+    for (size_t size : truncatedSizes)
+    {
+        TEST_CHECK(!AssetPackageTestOpens(directory, std::vector<uint8_t>(good.begin(), good.begin() + size)));
+    }
+
+    // one byte more than the header says
+    std::vector<uint8_t> longer = good;
+    longer.push_back(0);
+    TEST_CHECK(!AssetPackageTestOpens(directory, longer));
+
+    uint64_t numEntries = AssetPackageTestReadValue(good, kAssetPackageTestNumEntriesOffset, 4);
+    uint64_t namesSize = AssetPackageTestReadValue(good, kAssetPackageTestNamesSizeOffset, 4);
+    size_t namesOffset = kAssetPackageTestHeaderSize + (size_t)numEntries * kAssetPackageTestEntrySize;
+    // the entries are sorted, so the first two are assets/empty.txt and assets/one.bin
+    size_t firstEntry = kAssetPackageTestHeaderSize;
+    size_t secondEntry = firstEntry + kAssetPackageTestEntrySize;
+
+    struct Patch
+    {
+        size_t Offset;
+        uint64_t Value;
+        size_t Size;
+    };
+    const Patch patches[] = {
+        { 0, 0x4B505754, 4 }, // magic
+        { 4, 2, 4 }, // version
+        { kAssetPackageTestNumEntriesOffset, 0xFFFFFFFF, 4 },
+        { kAssetPackageTestNumEntriesOffset, numEntries + 200, 4 }, // a table of contents past the end
+        { kAssetPackageTestNamesSizeOffset, 0xFFFFFFFF, 4 },
+        { kAssetPackageTestNamesSizeOffset, namesSize - 1, 4 }, // the last name isn't terminated
+        { 16, 0, 8 }, // file size
+        { firstEntry, 100, 8 }, // offset not on a page
+        { secondEntry, good.size(), 8 }, // its byte is past the end, where the empty first entry could be
+        { firstEntry, 0xFFFFFFFFFFFFF000ull, 8 },
+        { firstEntry + kAssetPackageTestEntryStoredSizeOffset, good.size(), 8 },
+        { firstEntry + kAssetPackageTestEntryStoredSizeOffset, 0xFFFFFFFFFFFFFFFFull, 8 },
+        { firstEntry + kAssetPackageTestEntrySizeOffset, 0x100000000ull, 8 },
+        { firstEntry + kAssetPackageTestEntryNameOffsetOffset, namesSize, 4 },
+        { secondEntry + kAssetPackageTestEntryNameOffsetOffset, 0, 4 }, // two entries with the first name, so not sorted
+        { namesOffset, 'z', 1 }, // the first name sorts after the second
+    };
+    for (const Patch& patch : patches)
+    {
+        std::vector<uint8_t> corrupt = good;
+        AssetPackageTestPatch(&corrupt, patch.Offset, patch.Value, patch.Size);
+        TEST_CHECK(!AssetPackageTestOpens(directory, corrupt));
+    }
+
+    // the compressed entries, with sizes that they don't inflate to
+    AssetPackage* pPackage = AssetPackageOpen((directory + "/test.pak").c_str());
+    TEST_CHECK(pPackage != NULL);
+    if (!pPackage)
+        return;
+
+    std::vector<int> compressedEntryIDs;
+    for (int entryID = 0; entryID < AssetPackageGetNumEntries(pPackage); entryID++)
+    {
+        if (AssetPackageIsEntryCompressed(pPackage, entryID))
+            compressedEntryIDs.push_back(entryID);
+    }
+    AssetPackageClose(pPackage);
+    TEST_CHECK(!compressedEntryIDs.empty());
+
+    for (int entryID : compressedEntryIDs)
+    {
+        size_t entry = kAssetPackageTestHeaderSize + entryID * kAssetPackageTestEntrySize;
+        uint64_t storedSize = AssetPackageTestReadValue(good, entry + kAssetPackageTestEntryStoredSizeOffset, 8);
+        uint64_t size = AssetPackageTestReadValue(good, entry + kAssetPackageTestEntrySizeOffset, 8);
+
+        const Patch readPatches[] = {
+            { entry + kAssetPackageTestEntrySizeOffset, size + 1, 8 },
+            { entry + kAssetPackageTestEntrySizeOffset, size - 1, 8 },
+            { entry + kAssetPackageTestEntryStoredSizeOffset, storedSize / 2, 8 },
+        };
+        for (const Patch& patch : readPatches)
+        {
+            std::vector<uint8_t> corrupt = good;
+            AssetPackageTestPatch(&corrupt, patch.Offset, patch.Value, patch.Size);
+
+            std::string path = directory + "/corrupt.pak";
+            AssetPackageTestWriteFile(path, corrupt);
+            pPackage = AssetPackageOpen(path.c_str());
+            TEST_CHECK(pPackage != NULL);
+            if (!pPackage)
+                continue;
+
+            std::vector<uint8_t> inflated;
+            TEST_CHECK(AssetPackageReadEntry(pPackage, entryID, &inflated) == NULL);
+            AssetPackageClose(pPackage);
+        }
+    }
+}
+
+#ifdef SILVERWINNER_HAVE_ZLIB
+// The compressor's streams inflate with zlib itself, checksum included, and the repeats are found.
+static void AssetPackageTestZlibCompress()
+{
+    std::vector<std::vector<uint8_t>> inputs;
+    inputs.push_back(std::vector<uint8_t>());
+    inputs.push_back(std::vector<uint8_t>(1, 7));
+    inputs.push_back(std::vector<uint8_t>(100000, 0));
+    inputs.push_back(AssetPackageTestMakeCompressible(300000, 8));
+    inputs.push_back(AssetPackageTestMakeRandom(70000, 9));
+
+    for (const std::vector<uint8_t>& input : inputs)
+    {
+        std::vector<uint8_t> compressed;
+        AssetPackageZlibCompress(input.data(), input.size(), &compressed);
+
+        std::vector<uint8_t> inflated(input.size() + 1);
+        uLongf inflatedSize = (uLongf)inflated.size();
+        TEST_CHECK(uncompress(inflated.data(), &inflatedSize, compressed.data(), (uLong)compressed.size()) == Z_OK);
+        TEST_CHECK(inflatedSize == input.size());
+        TEST_CHECK(std::equal(input.begin(), input.end(), inflated.begin()));
+
+        if (input.size() == 100000)
+            TEST_CHECK(compressed.size() < 1000);
+    }
+}
+#endif
+
+int main()
+{
+    std::string directory = TestCreateTempDirectory("assetpackage_test");
+    AssetPackageTestRoundTrip(directory);
+    AssetPackageTestFind(directory);
+    AssetPackageTestWriteFailures(directory);
+    AssetPackageTestCorruptFiles(directory);
+#ifdef SILVERWINNER_HAVE_ZLIB
+    AssetPackageTestZlibCompress();
+#endif
+    return TestReport("assetpackage_test");
+}
\ No newline at end of file
@@ -0,0 +1,233 @@
+#include "testing.h"
+
+#include "camerapath.h"
+
+#include <fstream>
+#include <limits>
+#include <string>
+#include <vector>
+#include <cmath>
+#include <cstdint>
+#include <cstring>
+
+static bool CameraPathTestNear(const float a[3], float x, float y, float z)
+{
+    return std::fabs(a[0] - x) < 1e-5f && std::fabs(a[1] - y) < 1e-5f && std::fabs(a[2] - z) < 1e-5f;
+}
+
+// A file with the given header fields followed by the keys as they are in memory.
+static void CameraPathTestWriteFile(const std::string& path, uint32_t magic, uint32_t version, uint32_t numKeys, const std::vector<CameraPathKey>& keys)
+{
+    uint32_t header[4] = { magic, version, numKeys, 0 };
+    std::ofstream file(path, std::ios::binary | std::ios::trunc);
+    file.write((const char*)header, sizeof(header));
+    if (!keys.empty())
+        file.write((const char*)keys.data(), keys.size() * sizeof(CameraPathKey));
+}
+
+// Two keys a second apart from t = 1, moving along (2, 4, 6) and turning from +x to +y.
+static CameraPath CameraPathTestMakePath()
+{
+    CameraPath path;
+    float position0[3] = { 0.0f, 0.0f, 0.0f };
+    float look0[3] = { 2.0f, 0.0f, 0.0f };
+    float position1[3] = { 2.0f, 4.0f, 6.0f };
+    float look1[3] = { 0.0f, 0.5f, 0.0f };
+    CameraPathAddKey(&path, 1.0f, position0, look0);
+    CameraPathAddKey(&path, 3.0f, position1, look1);
+    return path;
+}
+
+// Looks are stored normalized, and one that can't be normalized keeps the previous key's.
+static void CameraPathTestAddKey()
+{
+    CameraPath path;
+    float position[3] = { 1.0f, 2.0f, 3.0f };
+    float zero[3] = { 0.0f, 0.0f, 0.0f };
+    float look[3] = { 0.0f, 3.0f, 4.0f };
+    float nan[3] = { std::numeric_limits<float>::quiet_NaN(), 0.0f, 0.0f };
+
+    CameraPathAddKey(&path, 0.0f, position, zero);
+    CameraPathAddKey(&path, 1.0f, position, look);
+    CameraPathAddKey(&path, 2.0f, position, zero);
+    CameraPathAddKey(&path, 3.0f, position, nan);
+
+    TEST_CHECK(path.Keys.size() == 4);
+    TEST_CHECK(CameraPathTestNear(path.Keys[0].Position, 1.0f, 2.0f, 3.0f));
+    TEST_CHECK(CameraPathTestNear(path.Keys[0].Look, 0.0f, 0.0f, 1.0f));
+    TEST_CHECK(CameraPathTestNear(path.Keys[1].Look, 0.0f, 0.6f, 0.8f));
+    TEST_CHECK(CameraPathTestNear(path.Keys[2].Look, 0.0f, 0.6f, 0.8f));
+    TEST_CHECK(CameraPathTestNear(path.Keys[3].Look, 0.0f, 0.6f, 0.8f));
+}
+
+// Between keys the position is linear in time and the look is renormalized. Times are from the first key.
+static void CameraPathTestSample()
+{
+    CameraPath path = CameraPathTestMakePath();
+    float position[3], look[3];
+
+    CameraPathSample(path, 0.0f, position, look);
+    TEST_CHECK(CameraPathTestNear(position, 0.0f, 0.0f, 0.0f));
+    TEST_CHECK(CameraPathTestNear(look, 1.0f, 0.0f, 0.0f));
+
+    CameraPathSample(path, 1.0f, position, look);
+    TEST_CHECK(CameraPathTestNear(position, 1.0f, 2.0f, 3.0f));
+    TEST_CHECK(CameraPathTestNear(look, std::sqrt(0.5f), std::sqrt(0.5f), 0.0f));
+
+    CameraPathSample(path, 0.5f, position, look);
+    TEST_CHECK(CameraPathTestNear(position, 0.5f, 1.0f, 1.5f));
+    float length = std::sqrt(0.75f * 0.75f + 0.25f * 0.25f);
+    TEST_CHECK(CameraPathTestNear(look, 0.75f / length, 0.25f / length, 0.0f));
+
+    CameraPathSample(path, 2.0f, position, look);
+    TEST_CHECK(CameraPathTestNear(position, 2.0f, 4.0f, 6.0f));
+    TEST_CHECK(CameraPathTestNear(look, 0.0f, 1.0f, 0.0f));
+
+    // clamped to both ends
+    CameraPathSample(path, -5.0f, position, look);
+    TEST_CHECK(CameraPathTestNear(position, 0.0f, 0.0f, 0.0f));
+    TEST_CHECK(CameraPathTestNear(look, 1.0f, 0.0f, 0.0f));
+    CameraPathSample(path, 100.0f, position, look);
+    TEST_CHECK(CameraPathTestNear(position, 2.0f, 4.0f, 6.0f));
+    TEST_CHECK(CameraPathTestNear(look, 0.0f, 1.0f, 0.0f));
+
+    // a path of one key is that key at any time
+    CameraPath single;
+    single.Keys.push_back(path.Keys.back());
+    CameraPathSample(single, 0.5f, position, look);
+    TEST_CHECK(CameraPathTestNear(position, 2.0f, 4.0f, 6.0f));
+
+    // opposite looks cancel out halfway, where the earlier one is kept
+    CameraPath opposite;
+    float origin[3] = { 0.0f, 0.0f, 0.0f };
+    float forward[3] = { 0.0f, 0.0f, 1.0f };
+    float backward[3] = { 0.0f, 0.0f, -1.0f };
+    CameraPathAddKey(&opposite, 0.0f, origin, forward);
+    CameraPathAddKey(&opposite, 1.0f, origin, backward);
+    CameraPathSample(opposite, 0.5f, position, look);
+    TEST_CHECK(CameraPathTestNear(look, 0.0f, 0.0f, 1.0f));
+}
+
+// A replay has a frame at both ends, so a duration of n whole steps has n + 1 frames.
+static void CameraPathTestNumFrames()
+{
+    CameraPath path = CameraPathTestMakePath();
+    TEST_CHECK(CameraPathGetDuration(path) == 2.0f);
+    TEST_CHECK(CameraPathGetNumFrames(path, 0.5f) == 5);
+    TEST_CHECK(CameraPathGetNumFrames(path, 2.0f) == 2);
+    TEST_CHECK(CameraPathGetNumFrames(path, 0.3f) == 7);
+    TEST_CHECK(CameraPathGetNumFrames(path, 1.0f / 60.0f) == 121);
+    TEST_CHECK(CameraPathGetNumFrames(path, 1.0f / 30.0f) == 61);
+
+    // 0.1 isn't exact in floating point
+    CameraPath tenths;
+    float position[3] = { 0.0f, 0.0f, 0.0f };
+    float look[3] = { 0.0f, 0.0f, 1.0f };
+    CameraPathAddKey(&tenths, 0.0f, position, look);
+    CameraPathAddKey(&tenths, 0.7f, position, look);
+    TEST_CHECK(CameraPathGetNumFrames(tenths, 0.1f) == 8);
+
+    CameraPath single;
+    single.Keys.push_back(path.Keys[0]);
+    TEST_CHECK(CameraPathGetDuration(single) == 0.0f);
+    TEST_CHECK(CameraPathGetNumFrames(single, 1.0f / 60.0f) == 1);
+
+    TEST_CHECK(CameraPathGetDuration(CameraPath()) == 0.0f);
+    TEST_CHECK(CameraPathGetNumFrames(CameraPath(), 1.0f / 60.0f) == 0);
+}
+
+static void CameraPathTestRoundTrip(const std::string& directory)
+{
+    CameraPath path = CameraPathTestMakePath();
+    std::string filePath = directory + "/round_trip.path";
+    TEST_CHECK(CameraPathSave(filePath.c_str(), path));
+
+    // loading replaces what was in the path
+    CameraPath loaded = CameraPathTestMakePath();
+    loaded.Keys.resize(5);
+    TEST_CHECK(CameraPathLoad(filePath.c_str(), &loaded));
+    TEST_CHECK(loaded.Keys.size() == path.Keys.size());
+    TEST_CHECK(loaded.Keys.size() == path.Keys.size() &&
+        memcmp(loaded.Keys.data(), path.Keys.data(), path.Keys.size() * sizeof(CameraPathKey)) == 0);
+
+    std::string emptyPath = directory + "/empty.path";
+    TEST_CHECK(CameraPathSave(emptyPath.c_str(), CameraPath()));
+    TEST_CHECK(CameraPathLoad(emptyPath.c_str(), &loaded));
+    TEST_CHECK(loaded.Keys.empty());
+
+    TEST_CHECK(!CameraPathSave((directory + "/missing/round_trip.path").c_str(), path));
+}
+
+// Files that aren't camera paths, or whose keys couldn't be replayed, are rejected and leave the path as it was.
+static void CameraPathTestRejects(const std::string& directory)
+{
+    const uint32_t magic = 0x48544150;
+    const uint32_t version = 1;
+    std::string filePath = directory + "/reject.path";
+    CameraPath path = CameraPathTestMakePath();
+    const std::vector<CameraPathKey> keys = path.Keys;
+
+    auto rejects = [&](uint32_t fileMagic, uint32_t fileVersion, uint32_t numKeys, const std::vector<CameraPathKey>& fileKeys)
+    {
+        CameraPathTestWriteFile(filePath, fileMagic, fileVersion, numKeys, fileKeys);
+        CameraPath loaded = CameraPathTestMakePath();
+        bool rejected = !CameraPathLoad(filePath.c_str(), &loaded);
+        TEST_CHECK(loaded.Keys.size() == keys.size());
+        return rejected;
+    };
+
+    // the file written by hand is a valid path
+    CameraPathTestWriteFile(filePath, magic, version, 2, keys);
+    CameraPath loaded;
+    TEST_CHECK(CameraPathLoad(filePath.c_str(), &loaded) && loaded.Keys.size() == 2);
+
+    TEST_CHECK(!CameraPathLoad((directory + "/missing.path").c_str(), &loaded));
+    TEST_CHECK(rejects(magic + 1, version, 2, keys));
+    TEST_CHECK(rejects(magic, version + 1, 2, keys));
+    TEST_CHECK(rejects(magic, version, 3, keys));
+    TEST_CHECK(rejects(magic, version, 1, keys));
+    TEST_CHECK(rejects(magic, version, 0xFFFFFFFF, keys));
+
+    // shorter than a header
+    {
+        std::ofstream file(filePath, std::ios::binary | std::ios::trunc);
+        file.write((const char*)&magic, sizeof(magic));
+    }
+    TEST_CHECK(!CameraPathLoad(filePath.c_str(), &loaded));
+
+    std::vector<CameraPathKey> reversed = { keys[1], keys[0] };
+    TEST_CHECK(rejects(magic, version, 2, reversed));
+
+    // keys at the same time are in order
+    std::vector<CameraPathKey> sameTime = keys;
+    sameTime[1].Seconds = sameTime[0].Seconds;
+    TEST_CHECK(!rejects(magic, version, 2, sameTime));
+
+    const float nan = std::numeric_limits<float>::quiet_NaN();
+    const float infinity = std::numeric_limits<float>::infinity();
+    for (int field = 0; field < 7; field++)
+    {
+        for (float value : { nan, infinity, -infinity })
+        {
+            std::vector<CameraPathKey> bad = keys;
+            float* values[7] = { &bad[1].Seconds, &bad[1].Position[0], &bad[1].Position[1], &bad[1].Position[2], &bad[1].Look[0], &bad[1].Look[1], &bad[1].Look[2] };
+            *values[field] = value;
+            TEST_CHECK(rejects(magic, version, 2, bad));
+        }
+    }
+
+    std::vector<CameraPathKey> zeroLook = keys;
+    zeroLook[0].Look[0] = zeroLook[0].Look[1] = zeroLook[0].Look[2] = 0.0f;
+    TEST_CHECK(rejects(magic, version, 2, zeroLook));
+}
+
+int main()
+{
+    std::string directory = TestCreateTempDirectory("camerapath_test");
+    CameraPathTestAddKey();
+    CameraPathTestSample();
+    CameraPathTestNumFrames();
+    CameraPathTestRoundTrip(directory);
+    CameraPathTestRejects(directory);
+    return TestReport("camerapath_test");
+}
\ No newline at end of file
@@ -0,0 +1,161 @@
+#include "testing.h"
+
+#include "filewatcher.h"
+
+#include <algorithm>
+#include <chrono>
+#include <fstream>
+#include <thread>
+
+#ifndef _WIN32
+#include <sys/stat.h>
+#endif
+
+// inotify queues its events before the write returns, but ReadDirectoryChangesW completes asynchronously,
+// so changes are polled for until some arrive, and then a little longer in case more are on their way.
+static std::vector<int> FileWatcherTestPoll(FileWatcher* pWatcher, int timeoutMilliseconds = 2000)
+{
+    std::vector<int> changedEntries;
+    auto start = std::chrono::steady_clock::now();
+    for (;;)
+    {
+        FileWatcherPoll(pWatcher, &changedEntries);
+
+        auto elapsed = std::chrono::steady_clock::now() - start;
+        if (!changedEntries.empty() || elapsed > std::chrono::milliseconds(timeoutMilliseconds))
+            break;
+        std::this_thread::sleep_for(std::chrono::milliseconds(10));
+    }
+
+    std::this_thread::sleep_for(std::chrono::milliseconds(50));
+    FileWatcherPoll(pWatcher, &changedEntries);
+
+    std::sort(changedEntries.begin(), changedEntries.end());
+    return changedEntries;
+}
+
+// For checks that nothing changed, where waiting for the full timeout would only slow the test down.
+static std::vector<int> FileWatcherTestPollNothing(FileWatcher* pWatcher)
+{
+    return FileWatcherTestPoll(pWatcher, 100);
+}
+
+static void FileWatcherTestWriteFile(const std::string& path, const std::string& contents)
+{
+    std::ofstream file(path, std::ios::binary | std::ios::trunc);
+    file << contents;
+    TEST_CHECK((bool)file.flush());
+}
+
+static bool FileWatcherTestDependsOn(const FileWatcher* pWatcher, int entry, const std::string& file)
+{
+    const std::vector<std::string>& files = FileWatcherGetEntryFiles(pWatcher, entry);
+    return std::find(files.begin(), files.end(), file) != files.end();
+}
+
+static void FileWatcherTestIncludes(const std::string& directory)
+{
+    std::string shaders = directory + "/shaders/";
+    std::string common = shaders + "common.hlsl";
+    std::string lighting = shaders + "lighting.hlsl";
+
+    FileWatcherTestWriteFile(common, "static const float kPi = 3.14159265;\n");
+    FileWatcherTestWriteFile(lighting, "#include \"common.hlsl\"\n");
+    FileWatcherTestWriteFile(shaders + "scene.hlsl", "#include \"lighting.hlsl\"\n");
+    FileWatcherTestWriteFile(shaders + "sky.hlsl", "#include \"common.hlsl\"\n");
+    FileWatcherTestWriteFile(shaders + "post.hlsl", "float4 PSmain() : SV_Target { return 0; }\n");
+    FileWatcherTestWriteFile(shaders + "unrelated.hlsl", "");
+
+    FileWatcher* pWatcher = FileWatcherCreate();
+    int scene = FileWatcherAddEntry(pWatcher, shaders + "scene.hlsl");
+    int sky = FileWatcherAddEntry(pWatcher, shaders + "sky.hlsl");
+    int post = FileWatcherAddEntry(pWatcher, shaders + "post.hlsl");
+
+    TEST_CHECK(FileWatcherTestDependsOn(pWatcher, scene, common));
+    TEST_CHECK(FileWatcherTestDependsOn(pWatcher, scene, lighting));
+    TEST_CHECK(FileWatcherGetEntryFiles(pWatcher, post).size() == 1);
+
+    TEST_CHECK(FileWatcherTestPollNothing(pWatcher).empty());
+
+    // a shared header invalidates exactly the shaders that include it, directly or not, and each of them once
+    FileWatcherTestWriteFile(common, "static const float kPi = 3.14159;\n");
+    FileWatcherTestWriteFile(common, "static const float kPi = 3.1416;\n");
+    TEST_CHECK(FileWatcherTestPoll(pWatcher) == std::vector<int>({ scene, sky }));
+    TEST_CHECK(FileWatcherTestPollNothing(pWatcher).empty());
+
+    FileWatcherTestWriteFile(lighting, "#include \"common.hlsl\"\nfloat3 Lambert() { return 1; }\n");
+    TEST_CHECK(FileWatcherTestPoll(pWatcher) == std::vector<int>({ scene }));
+
+    FileWatcherTestWriteFile(shaders + "post.hlsl", "float4 PSmain() : SV_Target { return 1; }\n");
+    TEST_CHECK(FileWatcherTestPoll(pWatcher) == std::vector<int>({ post }));
+
+    // files that nothing includes, in a watched directory, don't invalidate anything
+    FileWatcherTestWriteFile(shaders + "unrelated.hlsl", "float4 kUnrelated;\n");
+    TEST_CHECK(FileWatcherTestPollNothing(pWatcher).empty());
+
+    // the includes of a changed shader are scanned again, so a removed include stops invalidating it
+    FileWatcherTestWriteFile(shaders + "sky.hlsl", "float4 PSmain() : SV_Target { return 0; }\n");
+    TEST_CHECK(FileWatcherTestPoll(pWatcher) == std::vector<int>({ sky }));
+    TEST_CHECK(!FileWatcherTestDependsOn(pWatcher, sky, common));
+
+    FileWatcherTestWriteFile(common, "static const float kPi = 3.14;\n");
+    TEST_CHECK(FileWatcherTestPoll(pWatcher) == std::vector<int>({ scene }));
+
+    // and an added include in a new directory starts invalidating it
+    FileWatcherTestWriteFile(directory + "/shared/fog.hlsl", "float Fog() { return 0; }\n");
+    FileWatcherTestWriteFile(shaders + "post.hlsl", "#include \"../shared/fog.hlsl\"\n");
+    TEST_CHECK(FileWatcherTestPoll(pWatcher) == std::vector<int>({ post }));
+
+    FileWatcherTestWriteFile(directory + "/shared/fog.hlsl", "float Fog() { return 1; }\n");
+    TEST_CHECK(FileWatcherTestPoll(pWatcher) == std::vector<int>({ post }));
+
+    FileWatcherDestroy(pWatcher);
+}
+
+// An include that doesn't exist yet is still watched, so creating it invalidates the shader.
+static void FileWatcherTestMissingInclude(const std::string& directory)
+{
+    std::string shaders = directory + "/missing/";
+    FileWatcherTestWriteFile(shaders + "shader.hlsl", "#include \"generated.hlsl\"\n");
+
+    FileWatcher* pWatcher = FileWatcherCreate();
+    int shader = FileWatcherAddEntry(pWatcher, shaders + "shader.hlsl");
+    TEST_CHECK(FileWatcherTestDependsOn(pWatcher, shader, shaders + "generated.hlsl"));
+
+    FileWatcherTestWriteFile(shaders + "generated.hlsl", "float4 kGenerated;\n");
+    TEST_CHECK(FileWatcherTestPoll(pWatcher) == std::vector<int>({ shader }));
+
+    FileWatcherDestroy(pWatcher);
+}
+
+// A watcher without any entries has nothing to report and can be destroyed.
+static void FileWatcherTestEmpty()
+{
+    FileWatcher* pWatcher = FileWatcherCreate();
+    std::vector<int> changedEntries;
+    FileWatcherPoll(pWatcher, &changedEntries);
+    TEST_CHECK(changedEntries.empty());
+    FileWatcherDestroy(pWatcher);
+}
+
+static void FileWatcherTestCreateDirectory(const std::string& path)
+{
+#ifdef _WIN32
+    CreateDirectoryA(path.c_str(), NULL);
+#else
+    mkdir(path.c_str(), 0755);
+#endif
+}
+
+int main()
+{
+    std::string directory = TestCreateTempDirectory("filewatcher_test");
+    FileWatcherTestCreateDirectory(directory + "/shaders");
+    FileWatcherTestCreateDirectory(directory + "/shared");
+    FileWatcherTestCreateDirectory(directory + "/missing");
+
+    FileWatcherTestEmpty();
+    FileWatcherTestIncludes(directory);
+    FileWatcherTestMissingInclude(directory);
+    return TestReport("filewatcher_test");
+}
\ No newline at end of file
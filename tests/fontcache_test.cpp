@@ -0,0 +1,251 @@
+#include "testing.h"
+
+#include "fontcache.h"
+#include "imgui_internal.h"
+
+#include <fstream>
+#include <sstream>
+#include <string>
+#include <cstring>
+
+// Two fonts from the embedded default font with different baking settings, and a third input merged into the second.
+static void FontCacheTestAddFonts(ImFontAtlas* pAtlas, int oversampleH)
+{
+    pAtlas->AddFontDefault();
+
+    ImFontConfig fontConfig;
+    fontConfig.OversampleH = oversampleH;
+    fontConfig.GlyphExtraSpacing = ImVec2(1.0f, 0.0f);
+    ImFont* pFont = pAtlas->AddFontDefault(&fontConfig);
+
+    ImFontConfig mergeConfig;
+    mergeConfig.MergeMode = true;
+    mergeConfig.DstFont = pFont;
+    pAtlas->AddFontDefault(&mergeConfig);
+}
+
+static std::string FontCacheTestReadFile(const std::string& path)
+{
+    std::ifstream file(path, std::ios::binary);
+    std::ostringstream contents;
+    contents << file.rdbuf();
+    return contents.str();
+}
+
+static void FontCacheTestWriteFile(const std::string& path, const std::string& contents)
+{
+    std::ofstream file(path, std::ios::binary | std::ios::trunc);
+    file << contents;
+}
+
+static bool FontCacheTestGlyphsEqual(const ImFont::Glyph& a, const ImFont::Glyph& b)
+{
+    return a.Codepoint == b.Codepoint && a.XAdvance == b.XAdvance &&
+        a.X0 == b.X0 && a.Y0 == b.Y0 && a.X1 == b.X1 && a.Y1 == b.Y1 &&
+        a.U0 == b.U0 && a.V0 == b.V0 && a.U1 == b.U1 && a.V1 == b.V1;
+}
+
+template<class T>
+static bool FontCacheTestVectorsEqual(const ImVector<T>& a, const ImVector<T>& b)
+{
+    return a.Size == b.Size && (a.Size == 0 || memcmp(a.Data, b.Data, a.Size * sizeof(T)) == 0);
+}
+
+// Everything that text layout and rendering read from the atlas
+static void FontCacheTestCheckAtlasesEqual(ImFontAtlas& loaded, ImFontAtlas& baked)
+{
+    TEST_CHECK(loaded.TexWidth == baked.TexWidth && loaded.TexHeight == baked.TexHeight);
+    TEST_CHECK(loaded.TexPixelsAlpha8 && memcmp(loaded.TexPixelsAlpha8, baked.TexPixelsAlpha8, (size_t)baked.TexWidth * baked.TexHeight) == 0);
+    TEST_CHECK(loaded.TexUvWhitePixel.x == baked.TexUvWhitePixel.x && loaded.TexUvWhitePixel.y == baked.TexUvWhitePixel.y);
+
+    TEST_CHECK(loaded.Fonts.Size == baked.Fonts.Size);
+    for (int fontIndex = 0; fontIndex < loaded.Fonts.Size && fontIndex < baked.Fonts.Size; fontIndex++)
+    {
+        const ImFont* pLoaded = loaded.Fonts[fontIndex];
+        const ImFont* pBaked = baked.Fonts[fontIndex];
+        TEST_CHECK(pLoaded->IsLoaded());
+        TEST_CHECK(pLoaded->FontSize == pBaked->FontSize && pLoaded->Ascent == pBaked->Ascent && pLoaded->Descent == pBaked->Descent);
+        TEST_CHECK(pLoaded->ConfigDataCount == pBaked->ConfigDataCount);
+        TEST_CHECK(pLoaded->FallbackXAdvance == pBaked->FallbackXAdvance);
+        TEST_CHECK(pLoaded->FallbackGlyph && pBaked->FallbackGlyph && FontCacheTestGlyphsEqual(*pLoaded->FallbackGlyph, *pBaked->FallbackGlyph));
+        TEST_CHECK(FontCacheTestVectorsEqual(pLoaded->IndexLookup, pBaked->IndexLookup));
+        TEST_CHECK(FontCacheTestVectorsEqual(pLoaded->IndexXAdvance, pBaked->IndexXAdvance));
+
+        TEST_CHECK(pLoaded->Glyphs.Size == pBaked->Glyphs.Size && pLoaded->Glyphs.Size > 0);
+        int numDifferentGlyphs = 0;
+        for (int glyphIndex = 0; glyphIndex < pLoaded->Glyphs.Size && glyphIndex < pBaked->Glyphs.Size; glyphIndex++)
+        {
+            if (!FontCacheTestGlyphsEqual(pLoaded->Glyphs[glyphIndex], pBaked->Glyphs[glyphIndex]))
+                numDifferentGlyphs++;
+        }
+        TEST_CHECK(numDifferentGlyphs == 0);
+    }
+}
+
+// A baked atlas saved and loaded into a new atlas with the same fonts is the same atlas.
+static void FontCacheTestRoundTrip(const std::string& directory)
+{
+    std::string path = directory + "/roundtrip.fontcache";
+
+    ImFontAtlas baked;
+    FontCacheTestAddFonts(&baked, 2);
+    TEST_CHECK(baked.Build());
+    TEST_CHECK(FontCacheSave(path.c_str(), baked));
+
+    ImFontAtlas loaded;
+    FontCacheTestAddFonts(&loaded, 2);
+    TEST_CHECK(FontCacheComputeKey(loaded) == FontCacheComputeKey(baked));
+    TEST_CHECK(FontCacheLoad(path.c_str(), &loaded));
+    FontCacheTestCheckAtlasesEqual(loaded, baked);
+}
+
+// FontCacheBuild bakes and saves on a miss, and loads on a hit. The hit is told apart by a pixel that was changed in
+// the file, which only a load can see.
+static void FontCacheTestBuild(const std::string& directory)
+{
+    std::string path = directory + "/build.fontcache";
+
+    ImFontAtlas first;
+    TEST_CHECK(FontCacheBuild(path.c_str(), &first));
+    TEST_CHECK(first.Fonts.Size == 1 && first.TexPixelsAlpha8);
+
+    std::string contents = FontCacheTestReadFile(path);
+    TEST_CHECK(!contents.empty());
+    if (contents.empty())
+        return;
+
+    contents.back() ^= 0x5A;
+    FontCacheTestWriteFile(path, contents);
+
+    ImFontAtlas second;
+    TEST_CHECK(FontCacheBuild(path.c_str(), &second));
+    TEST_CHECK(second.TexPixelsAlpha8 && second.TexWidth == first.TexWidth && second.TexHeight == first.TexHeight);
+    if (second.TexPixelsAlpha8)
+    {
+        size_t lastPixel = (size_t)second.TexWidth * second.TexHeight - 1;
+        TEST_CHECK(second.TexPixelsAlpha8[lastPixel] == (first.TexPixelsAlpha8[lastPixel] ^ 0x5A));
+    }
+
+    // atlases that rasterize on demand have nothing to save
+    ImFontAtlas onDemand;
+    onDemand.RasterizeOnDemand = true;
+    onDemand.AddFontDefault();
+    TEST_CHECK(onDemand.Build());
+    TEST_CHECK(!FontCacheSave((directory + "/ondemand.fontcache").c_str(), onDemand));
+}
+
+// A file saved with different baking settings, or one that was damaged, is a miss that leaves the atlas unbuilt.
+// FontCacheBuild then bakes and replaces it.
+static void FontCacheTestRejectsStaleFiles(const std::string& directory)
+{
+    std::string path = directory + "/stale.fontcache";
+
+    ImFontAtlas baked;
+    FontCacheTestAddFonts(&baked, 2);
+    TEST_CHECK(baked.Build());
+    TEST_CHECK(FontCacheSave(path.c_str(), baked));
+    std::string contents = FontCacheTestReadFile(path);
+
+    auto isMiss = [&path](int oversampleH, int texDesiredWidth)
+    {
+        ImFontAtlas atlas;
+        FontCacheTestAddFonts(&atlas, oversampleH);
+        atlas.TexDesiredWidth = texDesiredWidth;
+        return !FontCacheLoad(path.c_str(), &atlas) && !atlas.TexPixelsAlpha8 && !atlas.Fonts[0]->IsLoaded();
+    };
+
+    TEST_CHECK(!isMiss(2, 0));
+    TEST_CHECK(isMiss(3, 0));
+    TEST_CHECK(isMiss(2, 2048));
+
+    {
+        // different glyph ranges
+        ImFontAtlas atlas;
+        FontCacheTestAddFonts(&atlas, 2);
+        static const ImWchar ranges[] = { 0x0020, 0x007F, 0 };
+        atlas.ConfigData[0].GlyphRanges = ranges;
+        TEST_CHECK(!FontCacheLoad(path.c_str(), &atlas) && !atlas.TexPixelsAlpha8);
+    }
+
+    // the version is the second field of the header
+    std::string otherVersion = contents;
+    otherVersion[4] ^= 0x01;
+    FontCacheTestWriteFile(path, otherVersion);
+    TEST_CHECK(isMiss(2, 0));
+
+    std::string otherMagic = contents;
+    otherMagic[0] ^= 0x01;
+    FontCacheTestWriteFile(path, otherMagic);
+    TEST_CHECK(isMiss(2, 0));
+
+    FontCacheTestWriteFile(path, contents.substr(0, contents.size() - 1));
+    TEST_CHECK(isMiss(2, 0));
+
+    FontCacheTestWriteFile(path, contents.substr(0, 16));
+    TEST_CHECK(isMiss(2, 0));
+
+    FontCacheTestWriteFile(path, contents + '\0');
+    TEST_CHECK(isMiss(2, 0));
+
+    FontCacheTestWriteFile(path, "");
+    TEST_CHECK(isMiss(2, 0));
+
+    std::remove(path.c_str());
+    TEST_CHECK(isMiss(2, 0));
+
+    // the atlas with the other settings replaces the file with its own
+    FontCacheTestWriteFile(path, contents);
+    ImFontAtlas rebuilt;
+    FontCacheTestAddFonts(&rebuilt, 3);
+    TEST_CHECK(FontCacheBuild(path.c_str(), &rebuilt));
+    TEST_CHECK(isMiss(2, 0));
+    TEST_CHECK(!isMiss(3, 0));
+}
+
+// A password field draws with a font of its own that only has the '*' fallback glyph. That font shares the atlas but
+// none of its inputs, so it must never reach the on-demand rasterizer, which would give it lookup tables.
+static void FontCacheTestPasswordOnDemand()
+{
+    ImGuiIO& io = ImGui::GetIO();
+    io.DisplaySize = ImVec2(1280.0f, 720.0f);
+    io.DeltaTime = 1.0f / 60.0f;
+    io.IniFilename = NULL;
+    io.Fonts->Clear();
+    io.Fonts->RasterizeOnDemand = true;
+    io.Fonts->AddFontDefault();
+
+    unsigned char* pixels;
+    int width, height;
+    io.Fonts->GetTexDataAsAlpha8(&pixels, &width, &height);
+    io.Fonts->TexID = (ImTextureID)1;
+
+    char password[32] = "hunter2";
+    const ImFont& passwordFont = GImGui->InputTextPasswordFont;
+    for (int frame = 0; frame < 3; frame++)
+    {
+        ImGui::NewFrame();
+        ImGui::SetNextWindowPos(ImVec2(0.0f, 0.0f), ImGuiSetCond_Always);
+        ImGui::Begin("Password", NULL, ImGuiWindowFlags_NoSavedSettings);
+        ImGui::InputText("Password", password, sizeof(password), ImGuiInputTextFlags_Password);
+        ImGui::End();
+        ImGui::Render();
+
+        TEST_CHECK(passwordFont.Glyphs.empty() && passwordFont.IndexLookup.empty() && passwordFont.IndexXAdvance.empty());
+    }
+
+    // the field is drawn with '*', which the real font rasterized
+    TEST_CHECK(passwordFont.FallbackGlyph && passwordFont.FallbackGlyph->Codepoint == '*');
+    TEST_CHECK(io.Fonts->Fonts[0]->FindGlyph('*') == passwordFont.FallbackGlyph);
+
+    ImGui::Shutdown();
+}
+
+int main()
+{
+    std::string directory = TestCreateTempDirectory("fontcache_test");
+    FontCacheTestRoundTrip(directory);
+    FontCacheTestBuild(directory);
+    FontCacheTestRejectsStaleFiles(directory);
+    FontCacheTestPasswordOnDemand();
+    return TestReport("fontcache_test");
+}
\ No newline at end of file
@@ -0,0 +1,144 @@
+#include "testing.h"
+
+#include "materialtable.h"
+
+#include <vector>
+#include <cstring>
+
+// Colors that halves hold exactly, with one texture of each kind of presence and slice.
+static MaterialTableMaterial MaterialTableTestMakeMaterial()
+{
+    MaterialTableMaterial material;
+    material.Ambient[0] = 0.5f; material.Ambient[1] = 0.25f; material.Ambient[2] = 0.125f;
+    material.Diffuse[0] = 1.0f; material.Diffuse[1] = 0.75f; material.Diffuse[2] = 0.0f;
+    material.Specular[0] = 2.0f; material.Specular[1] = -1.0f; material.Specular[2] = 0.5f;
+    material.Shininess = 64.0f;
+    material.Opacity = 1.0f;
+
+    const int slices[kMaterialTableNumTextures] = { 7, 0, kMaterialTableMaxTextureSlice };
+    const bool present[kMaterialTableNumTextures] = { true, false, true };
+    for (int textureIndex = 0; textureIndex < kMaterialTableNumTextures; textureIndex++)
+    {
+        MaterialTableTexture& texture = material.Textures[textureIndex];
+        texture.Present = present[textureIndex];
+        texture.Slice = slices[textureIndex];
+        texture.UVTransform[0] = 0.25f + textureIndex;
+        texture.UVTransform[1] = 0.5f;
+        texture.UVTransform[2] = 0.5f / 1024.0f;
+        texture.UVTransform[3] = 640.5f / 1024.0f;
+    }
+    return material;
+}
+
+static void MaterialTableTestWriteUint(uint8_t* pBytes, int offset, uint32_t value)
+{
+    memcpy(pBytes + offset, &value, sizeof(value));
+}
+
+// The entry's bytes at the offsets that shaders/material.hlsl gives them, with the halves of the colors written out.
+static void MaterialTableTestPackBytes()
+{
+    MaterialTableMaterial material = MaterialTableTestMakeMaterial();
+    PackedMaterial packed;
+    TEST_CHECK(MaterialTablePack(material, &packed));
+
+    uint8_t expected[PACKED_MATERIAL_SIZE];
+    memset(expected, 0xCD, sizeof(expected));
+    MaterialTableTestWriteUint(expected, 0, 0x3800 | (0x3400u << 16)); // ambient 0.5, 0.25
+    MaterialTableTestWriteUint(expected, 4, 0x3000 | (0x3C00u << 16)); // ambient 0.125, opacity 1
+    MaterialTableTestWriteUint(expected, 8, 0x3C00 | (0x3A00u << 16)); // diffuse 1, 0.75
+    MaterialTableTestWriteUint(expected, 12, 0x0000 | (0x5400u << 16)); // diffuse 0, shininess 64
+    MaterialTableTestWriteUint(expected, 16, 0x4000 | (0xBC00u << 16)); // specular 2, -1
+    MaterialTableTestWriteUint(expected, 20, 0x3800); // specular 0.5
+    MaterialTableTestWriteUint(expected, PACKED_MATERIAL_FLAGS_OFFSET, MATERIAL_FLAG_HAS_DIFFUSE_TEXTURE | MATERIAL_FLAG_HAS_BUMP_TEXTURE);
+    MaterialTableTestWriteUint(expected, PACKED_MATERIAL_FLAGS_OFFSET + 4, 7 | (0u << MATERIAL_TEXTURE_SLICE_BITS) | (1023u << (2 * MATERIAL_TEXTURE_SLICE_BITS)));
+    for (int textureIndex = 0; textureIndex < kMaterialTableNumTextures; textureIndex++)
+    {
+        // the transforms of textures that aren't present are kept as well
+        memcpy(expected + PACKED_MATERIAL_UVTRANSFORMS_OFFSET + textureIndex * 16, material.Textures[textureIndex].UVTransform, 16);
+    }
+
+    TEST_CHECK(memcmp(&packed, expected, sizeof(expected)) == 0);
+
+    MaterialTableMaterial unpacked;
+    MaterialTableUnpack(packed, &unpacked);
+    TEST_CHECK(memcmp(unpacked.Ambient, material.Ambient, sizeof(material.Ambient)) == 0);
+    TEST_CHECK(memcmp(unpacked.Diffuse, material.Diffuse, sizeof(material.Diffuse)) == 0);
+    TEST_CHECK(memcmp(unpacked.Specular, material.Specular, sizeof(material.Specular)) == 0);
+    TEST_CHECK(unpacked.Shininess == material.Shininess && unpacked.Opacity == material.Opacity);
+    for (int textureIndex = 0; textureIndex < kMaterialTableNumTextures; textureIndex++)
+    {
+        const MaterialTableTexture& texture = unpacked.Textures[textureIndex];
+        TEST_CHECK(texture.Present == material.Textures[textureIndex].Present);
+        TEST_CHECK(texture.Slice == material.Textures[textureIndex].Slice);
+        TEST_CHECK(memcmp(texture.UVTransform, material.Textures[textureIndex].UVTransform, sizeof(texture.UVTransform)) == 0);
+    }
+}
+
+// Materials share an entry when their bytes are the same, which includes materials whose colors only differ by less
+// than a half can tell, and doesn't include materials that only differ by the UV transform of a missing texture.
+static void MaterialTableTestBuildDeduplicates()
+{
+    MaterialTableMaterial base = MaterialTableTestMakeMaterial();
+
+    MaterialTableMaterial otherSlice = base;
+    otherSlice.Textures[0].Slice = 8;
+
+    MaterialTableMaterial closeColor = base;
+    closeColor.Ambient[0] = 0.50001f;
+
+    MaterialTableMaterial otherColor = base;
+    otherColor.Diffuse[1] = 0.5f;
+
+    MaterialTableMaterial otherMissingTransform = base;
+    otherMissingTransform.Textures[1].UVTransform[2] = 0.0f;
+
+    std::vector<MaterialTableMaterial> materials = { base, otherSlice, base, closeColor, otherColor, otherSlice, otherMissingTransform };
+    MaterialTable table;
+    TEST_CHECK(MaterialTableBuild(materials, &table));
+
+    const int expectedEntries[] = { 0, 1, 0, 0, 2, 1, 3 };
+    TEST_CHECK(table.Entries.size() == 4);
+    TEST_CHECK(table.MaterialEntries.size() == materials.size());
+    for (size_t materialID = 0; materialID < materials.size() && materialID < table.MaterialEntries.size(); materialID++)
+    {
+        TEST_CHECK(table.MaterialEntries[materialID] == expectedEntries[materialID]);
+    }
+
+    // each entry is the first of its materials, packed on its own
+    const int firstMaterials[] = { 0, 1, 4, 6 };
+    for (size_t entry = 0; entry < table.Entries.size() && entry < 4; entry++)
+    {
+        PackedMaterial packed;
+        TEST_CHECK(MaterialTablePack(materials[firstMaterials[entry]], &packed));
+        TEST_CHECK(memcmp(&packed, &table.Entries[entry], sizeof(packed)) == 0);
+    }
+
+    TEST_CHECK(MaterialTableBuild(std::vector<MaterialTableMaterial>(), &table));
+    TEST_CHECK(table.Entries.empty() && table.MaterialEntries.empty());
+}
+
+// A slice that doesn't fit in its bits fails the build, and tells which material it was.
+static void MaterialTableTestBuildRejectsSlice()
+{
+    MaterialTableMaterial base = MaterialTableTestMakeMaterial();
+    MaterialTableMaterial tooFar = base;
+    tooFar.Textures[2].Slice = kMaterialTableMaxTextureSlice + 1;
+
+    // unless the texture isn't there
+    MaterialTableMaterial missing = tooFar;
+    missing.Textures[2].Present = false;
+
+    std::vector<MaterialTableMaterial> materials = { base, missing, tooFar, base };
+    MaterialTable table;
+    TEST_CHECK(!MaterialTableBuild(materials, &table));
+    TEST_CHECK(table.MaterialEntries.size() == 2);
+}
+
+int main()
+{
+    MaterialTableTestPackBytes();
+    MaterialTableTestBuildDeduplicates();
+    MaterialTableTestBuildRejectsSlice();
+    return TestReport("materialtable_test");
+}
\ No newline at end of file
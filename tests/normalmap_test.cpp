@@ -0,0 +1,172 @@
+#include "testing.h"
+
+#include "normalmap.h"
+
+#include <algorithm>
+#include <cmath>
+#include <random>
+
+// The scene's bump scale, which stands in for the shader's 3000 / depth at a depth of 1000.
+static const float kNormalMapTestScale = 3.0f;
+
+// A wave with noise on top, so there are gentle and steep slopes, and slopes in every direction.
+static std::vector<uint8_t> NormalMapTestMakeHeights(int width, int height, uint32_t seed)
+{
+    std::mt19937 rng(seed);
+    std::uniform_int_distribution<int> noise(-24, 24);
+
+    std::vector<uint8_t> heights((size_t)width * height);
+    for (int y = 0; y < height; y++)
+    {
+        for (int x = 0; x < width; x++)
+        {
+            float wave = std::sin(x * 0.05f) * std::cos(y * 0.03f);
+            heights[(size_t)y * width + x] = (uint8_t)std::min(std::max(128 + (int)(wave * 80.0f) + noise(rng), 0), 255);
+        }
+    }
+    return heights;
+}
+
+// Texels are encoded one at a time with wrapped neighbors, and rounded to nearest even like cvtss2si.
+static std::vector<int8_t> NormalMapTestEncodeScalar(const std::vector<uint8_t>& heights, int width, int height, float scale)
+{
+    float k = scale / 255.0f * 0.5f;
+
+    std::vector<int8_t> normals((size_t)width * height * 2);
+    for (int y = 0; y < height; y++)
+    {
+        for (int x = 0; x < width; x++)
+        {
+            auto h = [&](int hx, int hy)
+            {
+                return (int)heights[(size_t)((hy + height) % height) * width + (hx + width) % width];
+            };
+
+            float nx = -(float)(h(x + 1, y) - h(x - 1, y)) * k;
+            float ny = -(float)(h(x, y + 1) - h(x, y - 1)) * k;
+            float invLength = 1.0f / std::sqrt(nx * nx + ny * ny + 1.0f);
+            normals[((size_t)y * width + x) * 2 + 0] = (int8_t)std::nearbyint(nx * invLength * 127.0f);
+            normals[((size_t)y * width + x) * 2 + 1] = (int8_t)std::nearbyint(ny * invLength * 127.0f);
+        }
+    }
+    return normals;
+}
+
+// The SIMD interior of each row and its scalar ends agree with encoding every texel on its own, at widths that
+// leave every possible remainder after the groups of 4, and at widths with no SIMD groups at all.
+static void NormalMapTestMatchesScalar()
+{
+    const int sizes[][2] = { { 1, 1 }, { 2, 3 }, { 5, 4 }, { 6, 7 }, { 7, 2 }, { 8, 8 }, { 37, 20 }, { 256, 64 } };
+    for (const auto& size : sizes)
+    {
+        int width = size[0], height = size[1];
+        std::vector<uint8_t> heights = NormalMapTestMakeHeights(width, height, width * 100 + height);
+        std::vector<int8_t> expected = NormalMapTestEncodeScalar(heights, width, height, kNormalMapTestScale);
+
+        for (int numThreads : { 1, 3 })
+        {
+            std::vector<int8_t> normals((size_t)width * height * 2, 99);
+            NormalMapFromHeightMap(heights.data(), width, height, kNormalMapTestScale, normals.data(), numThreads);
+            TEST_CHECK(normals == expected);
+        }
+    }
+}
+
+// The quantized normals, reconstructed like the shader does, are within SNORM8 precision of the formula that the
+// shader used to evaluate per pixel.
+static void NormalMapTestMatchesReference()
+{
+    const int size = 512;
+    std::vector<uint8_t> heights = NormalMapTestMakeHeights(size, size, 1234);
+
+    std::vector<int8_t> normals((size_t)size * size * 2);
+    NormalMapFromHeightMap(heights.data(), size, size, kNormalMapTestScale, normals.data());
+
+    float minCosine = 1.0f;
+    for (int y = 0; y < size; y++)
+    {
+        for (int x = 0; x < size; x++)
+        {
+            auto h = [&](int hx, int hy)
+            {
+                return heights[(size_t)((hy + size) % size) * size + (hx + size) % size] / 255.0f;
+            };
+
+            float reference[3];
+            NormalMapFromHeightsReference(h(x - 1, y), h(x + 1, y), h(x, y - 1), h(x, y + 1), kNormalMapTestScale, reference);
+
+            size_t i = (size_t)y * size + x;
+            float nx = normals[i * 2] / 127.0f;
+            float ny = normals[i * 2 + 1] / 127.0f;
+            float nz = std::sqrt(std::max(0.0f, 1.0f - nx * nx - ny * ny));
+
+            float cosine = (nx * reference[0] + ny * reference[1] + nz * reference[2]) / std::sqrt(nx * nx + ny * ny + nz * nz);
+            minCosine = std::min(minCosine, cosine);
+        }
+    }
+
+    float maxErrorDegrees = std::acos(std::min(minCosine, 1.0f)) * 180.0f / 3.14159265f;
+    TEST_CHECK(maxErrorDegrees < 0.5f);
+}
+
+static void NormalMapTestFlat()
+{
+    std::vector<uint8_t> heights(16 * 16, 77);
+    std::vector<int8_t> normals(heights.size() * 2, 99);
+    NormalMapFromHeightMap(heights.data(), 16, 16, kNormalMapTestScale, normals.data());
+    TEST_CHECK(std::count(normals.begin(), normals.end(), 0) == (std::ptrdiff_t)normals.size());
+}
+
+static void NormalMapTestNumLevels()
+{
+    TEST_CHECK(NormalMapGetNumLevels(1, 1) == 1);
+    TEST_CHECK(NormalMapGetNumLevels(2, 1) == 2);
+    TEST_CHECK(NormalMapGetNumLevels(256, 64) == 9);
+    TEST_CHECK(NormalMapGetNumLevels(37, 20) == 6);
+}
+
+// Every level is the normal map of the box filtered heights at its resolution.
+static void NormalMapTestMipChain()
+{
+    int width = 37, height = 20;
+    std::vector<uint8_t> heights = NormalMapTestMakeHeights(width, height, 5);
+
+    std::vector<NormalMapLevel> levels;
+    NormalMapBuildMipChain(heights.data(), width, height, kNormalMapTestScale, &levels);
+    TEST_CHECK((int)levels.size() == NormalMapGetNumLevels(width, height));
+
+    for (const NormalMapLevel& level : levels)
+    {
+        TEST_CHECK(level.Width == width && level.Height == height);
+        TEST_CHECK(level.TexelsXY == NormalMapTestEncodeScalar(heights, width, height, kNormalMapTestScale));
+
+        // 2x2 box filter, where an odd last row or column is folded into its neighbor
+        int nextWidth = std::max(width / 2, 1);
+        int nextHeight = std::max(height / 2, 1);
+        std::vector<uint8_t> nextHeights((size_t)nextWidth * nextHeight);
+        for (int y = 0; y < nextHeight; y++)
+        {
+            for (int x = 0; x < nextWidth; x++)
+            {
+                int x0 = std::min(x * 2, width - 1), x1 = std::min(x * 2 + 1, width - 1);
+                int y0 = std::min(y * 2, height - 1), y1 = std::min(y * 2 + 1, height - 1);
+                int sum = heights[(size_t)y0 * width + x0] + heights[(size_t)y0 * width + x1] + heights[(size_t)y1 * width + x0] + heights[(size_t)y1 * width + x1];
+                nextHeights[(size_t)y * nextWidth + x] = (uint8_t)((sum + 2) / 4);
+            }
+        }
+
+        heights.swap(nextHeights);
+        width = nextWidth;
+        height = nextHeight;
+    }
+}
+
+int main()
+{
+    NormalMapTestMatchesScalar();
+    NormalMapTestMatchesReference();
+    NormalMapTestFlat();
+    NormalMapTestNumLevels();
+    NormalMapTestMipChain();
+    return TestReport("normalmap_test");
+}
\ No newline at end of file
@@ -0,0 +1,95 @@
+#include "testing.h"
+
+#include "occlusion.h"
+
+#include <vector>
+
+using namespace DirectX;
+
+// A camera at the origin looking down +z with a 90 degree vertical field of view, so the view is 20 units tall and 40
+// units wide at z = 10.
+static XMMATRIX OcclusionTestGetViewProjection()
+{
+    return XMMatrixPerspectiveFovLH(XM_PIDIV2, 2.0f, 1.0f, 1000.0f);
+}
+
+// Two triangles of the square [-5,5]x[-5,5] at z = 10, wound either way.
+static std::vector<XMFLOAT3> OcclusionTestMakeQuad(bool reversed)
+{
+    XMFLOAT3 a(-5.0f, -5.0f, 10.0f), b(-5.0f, 5.0f, 10.0f), c(5.0f, 5.0f, 10.0f), d(5.0f, -5.0f, 10.0f);
+    if (reversed)
+        return { a, c, b, a, d, c };
+    return { a, b, c, a, c, d };
+}
+
+static void OcclusionTestRasterize(const std::vector<XMFLOAT3>& positions)
+{
+    OcclusionBeginFrame(OcclusionTestGetViewProjection());
+    OcclusionRasterizeTriangles(positions.data(), (int)positions.size() / 3);
+    OcclusionEndFrame();
+}
+
+static bool OcclusionTestIsVisible(float minX, float minY, float minZ, float maxX, float maxY, float maxZ)
+{
+    return OcclusionIsBoxVisible(XMFLOAT3(minX, minY, minZ), XMFLOAT3(maxX, maxY, maxZ), XMMatrixIdentity());
+}
+
+// Only a box that the quad covers entirely and that is behind it is culled.
+static void OcclusionTestQuad(bool reversed)
+{
+    OcclusionTestRasterize(OcclusionTestMakeQuad(reversed));
+
+    // behind the quad, and behind it after being moved there
+    TEST_CHECK(!OcclusionTestIsVisible(-1.0f, -1.0f, 20.0f, 1.0f, 1.0f, 22.0f));
+    TEST_CHECK(!OcclusionIsBoxVisible(XMFLOAT3(-1.0f, -1.0f, -1.0f), XMFLOAT3(1.0f, 1.0f, 1.0f), XMMatrixTranslation(2.0f, 0.0f, 30.0f)));
+
+    // in front of the quad
+    TEST_CHECK(OcclusionTestIsVisible(-1.0f, -1.0f, 5.0f, 1.0f, 1.0f, 6.0f));
+
+    // beside the quad, and partly beside it
+    TEST_CHECK(OcclusionTestIsVisible(12.0f, -1.0f, 20.0f, 14.0f, 1.0f, 22.0f));
+    TEST_CHECK(OcclusionTestIsVisible(4.0f, -1.0f, 20.0f, 14.0f, 1.0f, 22.0f));
+
+    // peeking out past the quad's edge by a pixel or two, which only the finest levels of the pyramid can tell
+    TEST_CHECK(OcclusionTestIsVisible(0.0f, -1.0f, 20.0f, 10.5f, 1.0f, 22.0f));
+
+    // through the quad
+    TEST_CHECK(OcclusionTestIsVisible(-1.0f, -1.0f, 9.0f, 1.0f, 1.0f, 11.0f));
+
+    // straddling the near plane, and straddling the camera
+    TEST_CHECK(OcclusionTestIsVisible(-1.0f, -1.0f, 0.5f, 1.0f, 1.0f, 3.0f));
+    TEST_CHECK(OcclusionTestIsVisible(-1.0f, -1.0f, -1.0f, 1.0f, 1.0f, 3.0f));
+
+    // entirely behind the camera, and outside the frustum
+    TEST_CHECK(!OcclusionTestIsVisible(-1.0f, -1.0f, -10.0f, 1.0f, 1.0f, -5.0f));
+    TEST_CHECK(!OcclusionTestIsVisible(100.0f, -1.0f, 20.0f, 102.0f, 1.0f, 22.0f));
+}
+
+// Without occluders, or with occluders that were dropped because they cross the near plane, nothing in the frustum is
+// culled.
+static void OcclusionTestNoOccluders()
+{
+    OcclusionTestRasterize(std::vector<XMFLOAT3>());
+    TEST_CHECK(OcclusionTestIsVisible(-1.0f, -1.0f, 20.0f, 1.0f, 1.0f, 22.0f));
+
+    std::vector<XMFLOAT3> crossing = OcclusionTestMakeQuad(false);
+    crossing[0].z = -1.0f;
+    crossing[3].z = -1.0f;
+    OcclusionTestRasterize(crossing);
+    TEST_CHECK(OcclusionTestIsVisible(-1.0f, -1.0f, 20.0f, 1.0f, 1.0f, 22.0f));
+}
+
+int main()
+{
+    // At 256x128 the quad's diagonal runs through pixel centers, which one of its two triangles has to cover. 250 is
+    // rounded up to 252, so the quad's edges fall inside the texels of the pyramid's coarse levels.
+    const int kSizes[][2] = { { 256, 128 }, { 250, 125 } };
+    for (const int* size : kSizes)
+    {
+        OcclusionInit(size[0], size[1]);
+        OcclusionTestQuad(false);
+        OcclusionTestQuad(true);
+    }
+    OcclusionTestNoOccluders();
+    return TestReport("occlusion_test");
+}
\ No newline at end of file
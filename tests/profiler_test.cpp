@@ -0,0 +1,187 @@
+#include "testing.h"
+
+#include "profiler.h"
+
+#include <atomic>
+#include <thread>
+#include <vector>
+#include <fstream>
+#include <sstream>
+#include <string>
+#include <cstring>
+
+// Long enough that ProfilerCollect never forgets a zone during the test.
+static const double kProfilerTestHistorySeconds = 1e9;
+
+static const char* const kProfilerTestZoneNames[] = { "Outer", "Middle", "Inner" };
+
+// One outer zone holding two middle zones that each hold an inner zone, so 5 zones per call.
+static void ProfilerTestWriteNestedZones()
+{
+    PROFILE_ZONE(kProfilerTestZoneNames[0]);
+    for (int i = 0; i < 2; i++)
+    {
+        PROFILE_ZONE(kProfilerTestZoneNames[1]);
+        PROFILE_ZONE(kProfilerTestZoneNames[2]);
+    }
+}
+
+static uint64_t ProfilerTestCountEvents()
+{
+    uint64_t numEvents = 0;
+    for (int threadIndex = 0; threadIndex < ProfilerGetNumThreads(); threadIndex++)
+    {
+        numEvents += ProfilerGetThreadEvents(threadIndex).size();
+    }
+    return numEvents;
+}
+
+// A zone that was overwritten while it was being collected would likely mix the fields of two zones.
+static bool ProfilerTestIsConsistent(const ProfilerEvent& event)
+{
+    return event.Depth < 3 && event.Name == kProfilerTestZoneNames[event.Depth] && event.BeginTicks <= event.EndTicks;
+}
+
+// On one thread with nothing dropped, every zone is followed by the zones that enclose it, in the order they end.
+static void ProfilerTestNesting()
+{
+    std::thread thread([]
+    {
+        ProfilerSetThreadName("Nesting");
+        ProfilerTestWriteNestedZones();
+    });
+    thread.join();
+
+    uint64_t numDroppedBefore = ProfilerGetNumDroppedEvents();
+    ProfilerCollect(kProfilerTestHistorySeconds);
+    TEST_CHECK(ProfilerGetNumDroppedEvents() == numDroppedBefore);
+
+    int nestingThread = -1;
+    for (int threadIndex = 0; threadIndex < ProfilerGetNumThreads(); threadIndex++)
+    {
+        if (strcmp(ProfilerGetThreadName(threadIndex), "Nesting") == 0)
+            nestingThread = threadIndex;
+    }
+    TEST_CHECK(nestingThread != -1);
+    if (nestingThread == -1)
+        return;
+
+    const std::deque<ProfilerEvent>& events = ProfilerGetThreadEvents(nestingThread);
+    TEST_CHECK(events.size() == 5);
+    if (events.size() != 5)
+        return;
+
+    const uint32_t expectedDepths[] = { 2, 1, 2, 1, 0 };
+    for (size_t i = 0; i < events.size(); i++)
+    {
+        TEST_CHECK(events[i].Depth == expectedDepths[i]);
+        TEST_CHECK(ProfilerTestIsConsistent(events[i]));
+        if (i > 0)
+            TEST_CHECK(events[i - 1].EndTicks <= events[i].EndTicks);
+    }
+
+    // the inner zones are inside their middle zones, and everything is inside the outer zone
+    TEST_CHECK(events[1].BeginTicks <= events[0].BeginTicks && events[0].EndTicks <= events[1].EndTicks);
+    TEST_CHECK(events[3].BeginTicks <= events[2].BeginTicks && events[2].EndTicks <= events[3].EndTicks);
+    TEST_CHECK(events[1].EndTicks <= events[2].BeginTicks);
+    TEST_CHECK(events[4].BeginTicks <= events[1].BeginTicks && events[3].EndTicks <= events[4].EndTicks);
+}
+
+// Many threads write nested zones while the collector drains them, in two waves so that the second wave reuses the
+// buffers of the first. Every zone is either collected whole or counted as dropped, and the buffers are reused.
+static void ProfilerTestStress()
+{
+    const int kNumThreads = 16;
+    const int kNumIterations = 20000;
+
+    ProfilerCollect(kProfilerTestHistorySeconds);
+    int numThreadsBefore = ProfilerGetNumThreads();
+    uint64_t numEventsBefore = ProfilerTestCountEvents();
+    uint64_t numDroppedBefore = ProfilerGetNumDroppedEvents();
+
+    for (int wave = 0; wave < 2; wave++)
+    {
+        std::atomic<int> numRunningThreads(kNumThreads);
+        std::vector<std::thread> threads;
+        for (int threadIndex = 0; threadIndex < kNumThreads; threadIndex++)
+        {
+            threads.emplace_back([&numRunningThreads, kNumIterations]
+            {
+                for (int iteration = 0; iteration < kNumIterations; iteration++)
+                {
+                    ProfilerTestWriteNestedZones();
+                }
+                numRunningThreads--;
+            });
+        }
+
+        while (numRunningThreads > 0)
+        {
+            ProfilerCollect(kProfilerTestHistorySeconds);
+            std::this_thread::yield();
+        }
+
+        for (std::thread& thread : threads)
+        {
+            thread.join();
+        }
+
+        // picks up the last zones and lets the exited threads' buffers go
+        ProfilerCollect(kProfilerTestHistorySeconds);
+    }
+
+    TEST_CHECK(ProfilerGetNumThreads() <= numThreadsBefore + kNumThreads);
+
+    uint64_t numEvents = ProfilerTestCountEvents() - numEventsBefore;
+    uint64_t numDropped = ProfilerGetNumDroppedEvents() - numDroppedBefore;
+    TEST_CHECK(numEvents + numDropped == 2ull * kNumThreads * kNumIterations * 5);
+
+    uint64_t numInconsistent = 0;
+    for (int threadIndex = 0; threadIndex < ProfilerGetNumThreads(); threadIndex++)
+    {
+        const std::deque<ProfilerEvent>& events = ProfilerGetThreadEvents(threadIndex);
+        for (size_t i = 0; i < events.size(); i++)
+        {
+            if (!ProfilerTestIsConsistent(events[i]))
+                numInconsistent++;
+        }
+    }
+    TEST_CHECK(numInconsistent == 0);
+}
+
+// The trace has a name for every thread and an entry for every collected zone. Runs before the stress test, which
+// reuses the buffer and so the name of the thread that wrote the nested zones.
+static void ProfilerTestExportChromeTrace()
+{
+    std::string path = TestCreateTempDirectory("profiler_test") + "/trace.json";
+    TEST_CHECK(ProfilerExportChromeTrace(path.c_str()));
+
+    std::ifstream file(path);
+    std::stringstream contents;
+    contents << file.rdbuf();
+    std::string trace = contents.str();
+
+    auto count = [&trace](const char* s)
+    {
+        uint64_t n = 0;
+        for (size_t position = trace.find(s); position != std::string::npos; position = trace.find(s, position + 1))
+        {
+            n++;
+        }
+        return n;
+    };
+
+    TEST_CHECK(trace.compare(0, 16, "{\"traceEvents\":[") == 0);
+    TEST_CHECK(count("\"ph\":\"M\"") == (uint64_t)ProfilerGetNumThreads());
+    TEST_CHECK(count("\"ph\":\"X\"") == ProfilerTestCountEvents());
+    TEST_CHECK(count("\"name\":\"Nesting\"") == 1);
+}
+
+int main()
+{
+    ProfilerInit();
+    ProfilerTestNesting();
+    ProfilerTestExportChromeTrace();
+    ProfilerTestStress();
+    return TestReport("profiler_test");
+}
\ No newline at end of file
@@ -0,0 +1,191 @@
+#include "testing.h"
+
+#include "renderstats.h"
+
+#include <algorithm>
+#include <fstream>
+#include <random>
+#include <sstream>
+#include <vector>
+
+static std::string RenderStatsTestReadFile(const std::string& path)
+{
+    std::ifstream file(path, std::ios::binary);
+    std::ostringstream contents;
+    contents << file.rdbuf();
+    return contents.str();
+}
+
+// Frame i draws i + 1 times, with 10 times as many indices, and takes 1.5 + i milliseconds.
+static void RenderStatsTestEndFrames(int numFrames)
+{
+    for (int i = 0; i < numFrames; i++)
+    {
+        RenderStatsAdd(RENDER_COUNTER_DRAWS, i + 1);
+        RenderStatsAdd(RENDER_COUNTER_INDICES, 10 * (i + 1));
+        RenderStatsEndFrame(1.5f + i);
+    }
+}
+
+// Once the window is full, each frame replaces the oldest one, and the averages are over the frames in the window.
+static void RenderStatsTestWrapAround()
+{
+    RenderStatsReset(4);
+    TEST_CHECK(RenderStatsGetNumFrames() == 0);
+    TEST_CHECK(RenderStatsGetLastFrameCounter(RENDER_COUNTER_DRAWS) == 0);
+    TEST_CHECK(RenderStatsGetAverageCounter(RENDER_COUNTER_DRAWS) == 0.0);
+    TEST_CHECK(RenderStatsGetAverageFrameMilliseconds() == 0.0f);
+    TEST_CHECK(RenderStatsGetFrameMillisecondsPercentile(50.0f) == 0.0f);
+
+    RenderStatsTestEndFrames(3);
+    TEST_CHECK(RenderStatsGetNumFrames() == 3);
+    TEST_CHECK(RenderStatsGetLastFrameCounter(RENDER_COUNTER_DRAWS) == 3);
+    TEST_CHECK(RenderStatsGetAverageCounter(RENDER_COUNTER_DRAWS) == 2.0);
+    TEST_CHECK(RenderStatsGetAverageFrameMilliseconds() == 2.5f);
+
+    // frames 3 to 6 of 7, which go round the ring
+    RenderStatsAdd(RENDER_COUNTER_DRAWS, 4);
+    RenderStatsEndFrame(4.5f);
+    RenderStatsAdd(RENDER_COUNTER_DRAWS, 5);
+    RenderStatsAdd(RENDER_COUNTER_DRAWS, 1);
+    RenderStatsEndFrame(5.5f);
+    RenderStatsEndFrame(10.0f);
+    RenderStatsAdd(RENDER_COUNTER_DRAWS, 2);
+    RenderStatsEndFrame(2.0f);
+
+    TEST_CHECK(RenderStatsGetNumFrames() == 4);
+    TEST_CHECK(RenderStatsGetLastFrameCounter(RENDER_COUNTER_DRAWS) == 2);
+    TEST_CHECK(RenderStatsGetAverageCounter(RENDER_COUNTER_DRAWS) == (4 + 6 + 0 + 2) / 4.0);
+    TEST_CHECK(RenderStatsGetAverageCounter(RENDER_COUNTER_INDICES) == 0.0);
+    TEST_CHECK(RenderStatsGetAverageFrameMilliseconds() == (4.5f + 5.5f + 10.0f + 2.0f) / 4.0f);
+    TEST_CHECK(RenderStatsGetFrameMillisecondsPercentile(0.0f) == 2.0f);
+    TEST_CHECK(RenderStatsGetFrameMillisecondsPercentile(100.0f) == 10.0f);
+}
+
+// The nearest rank of a percentile p of n frames is ceil(p / 100 * n).
+static void RenderStatsTestPercentiles()
+{
+    std::vector<float> milliseconds;
+    for (int i = 1; i <= 200; i++)
+    {
+        milliseconds.push_back((float)i);
+    }
+    std::shuffle(milliseconds.begin(), milliseconds.end(), std::mt19937(5));
+
+    RenderStatsReset(200);
+    for (float frameMilliseconds : milliseconds)
+    {
+        RenderStatsEndFrame(frameMilliseconds);
+    }
+    TEST_CHECK(RenderStatsGetFrameMillisecondsPercentile(50.0f) == 100.0f);
+    TEST_CHECK(RenderStatsGetFrameMillisecondsPercentile(95.0f) == 190.0f);
+    TEST_CHECK(RenderStatsGetFrameMillisecondsPercentile(99.0f) == 198.0f);
+    TEST_CHECK(RenderStatsGetFrameMillisecondsPercentile(99.9f) == 200.0f);
+    TEST_CHECK(RenderStatsGetFrameMillisecondsPercentile(0.0f) == 1.0f);
+    TEST_CHECK(RenderStatsGetFrameMillisecondsPercentile(-5.0f) == 1.0f);
+    TEST_CHECK(RenderStatsGetFrameMillisecondsPercentile(150.0f) == 200.0f);
+
+    // 7 frames: p50 is the 4th, p95 and p99 are the 7th
+    RenderStatsReset(7);
+    for (float frameMilliseconds : { 9.0f, 3.0f, 7.0f, 1.0f, 5.0f, 13.0f, 11.0f })
+    {
+        RenderStatsEndFrame(frameMilliseconds);
+    }
+    TEST_CHECK(RenderStatsGetFrameMillisecondsPercentile(50.0f) == 7.0f);
+    TEST_CHECK(RenderStatsGetFrameMillisecondsPercentile(95.0f) == 13.0f);
+    TEST_CHECK(RenderStatsGetFrameMillisecondsPercentile(99.0f) == 13.0f);
+    TEST_CHECK(RenderStatsGetFrameMillisecondsPercentile(42.0f) == 5.0f);
+    TEST_CHECK(RenderStatsGetFrameMillisecondsPercentile(30.0f) == 5.0f);
+}
+
+// Reset forgets the frames and the counters of the frame in progress, and the new window has the new size.
+static void RenderStatsTestReset()
+{
+    RenderStatsReset(2);
+    RenderStatsTestEndFrames(5);
+    TEST_CHECK(RenderStatsGetNumFrames() == 2);
+
+    RenderStatsAdd(RENDER_COUNTER_DRAWS, 100);
+    RenderStatsReset(6);
+    TEST_CHECK(RenderStatsGetNumFrames() == 0);
+    TEST_CHECK(RenderStatsGetLastFrameCounter(RENDER_COUNTER_DRAWS) == 0);
+
+    RenderStatsEndFrame(1.0f);
+    TEST_CHECK(RenderStatsGetLastFrameCounter(RENDER_COUNTER_DRAWS) == 0);
+
+    RenderStatsTestEndFrames(8);
+    TEST_CHECK(RenderStatsGetNumFrames() == 6);
+
+    RenderStatsReset(3);
+    RenderStatsTestEndFrames(8);
+    TEST_CHECK(RenderStatsGetNumFrames() == 3);
+    TEST_CHECK(RenderStatsGetAverageCounter(RENDER_COUNTER_DRAWS) == 7.0);
+
+    // a window has at least one frame
+    RenderStatsReset(0);
+    RenderStatsTestEndFrames(2);
+    TEST_CHECK(RenderStatsGetNumFrames() == 1);
+    TEST_CHECK(RenderStatsGetLastFrameCounter(RENDER_COUNTER_DRAWS) == 2);
+}
+
+// The CSV has a row for each frame of the window, oldest first, and the JSON summarizes the same frames.
+static void RenderStatsTestOutput(const std::string& directory)
+{
+    RenderStatsReset(3);
+    RenderStatsTestEndFrames(5);
+
+    std::string header = "frame,milliseconds";
+    std::string zeroCounters;
+    std::string lastFrame;
+    std::string average;
+    for (int counter = 0; counter < kNumRenderCounters; counter++)
+    {
+        std::string name = RenderStatsGetCounterName((RenderCounter)counter);
+        header += "," + name;
+        if (counter >= 2)
+            zeroCounters += ",0";
+
+        std::string separator = counter == 0 ? "" : ",";
+        std::string lastValue = counter == RENDER_COUNTER_DRAWS ? "5" : counter == RENDER_COUNTER_INDICES ? "50" : "0";
+        std::string averageValue = counter == RENDER_COUNTER_DRAWS ? "4.000" : counter == RENDER_COUNTER_INDICES ? "40.000" : "0.000";
+        lastFrame += separator + "\"" + name + "\":" + lastValue;
+        average += separator + "\"" + name + "\":" + averageValue;
+    }
+    TEST_CHECK(std::string(RenderStatsGetCounterName(RENDER_COUNTER_DRAWS)) == "draws");
+    TEST_CHECK(std::string(RenderStatsGetCounterName(RENDER_COUNTER_CULLING_MICROSECONDS)) == "culling_microseconds");
+
+    std::string csvPath = directory + "/stats.csv";
+    TEST_CHECK(RenderStatsWriteCSV(csvPath.c_str()));
+    TEST_CHECK(RenderStatsTestReadFile(csvPath) ==
+        header + "\n" +
+        "2,3.500,3,30" + zeroCounters + "\n" +
+        "3,4.500,4,40" + zeroCounters + "\n" +
+        "4,5.500,5,50" + zeroCounters + "\n");
+
+    std::string jsonPath = directory + "/stats.json";
+    TEST_CHECK(RenderStatsWriteJSON(jsonPath.c_str()));
+    TEST_CHECK(RenderStatsTestReadFile(jsonPath) ==
+        "{\n"
+        "\"frames\":3,\n"
+        "\"milliseconds\":{\"average\":4.500,\"p50\":4.500,\"p95\":5.500,\"p99\":5.500},\n"
+        "\"last_frame\":{" + lastFrame + "},\n"
+        "\"average\":{" + average + "}\n"
+        "}\n");
+
+    // writing again replaces the file
+    RenderStatsReset(3);
+    TEST_CHECK(RenderStatsWriteCSV(csvPath.c_str()));
+    TEST_CHECK(RenderStatsTestReadFile(csvPath) == header + "\n");
+
+    TEST_CHECK(!RenderStatsWriteCSV((directory + "/missing/stats.csv").c_str()));
+    TEST_CHECK(!RenderStatsWriteJSON((directory + "/missing/stats.json").c_str()));
+}
+
+int main()
+{
+    RenderStatsTestWrapAround();
+    RenderStatsTestPercentiles();
+    RenderStatsTestReset();
+    RenderStatsTestOutput(TestCreateTempDirectory("renderstats_test"));
+    return TestReport("renderstats_test");
+}
\ No newline at end of file
@@ -0,0 +1,149 @@
+#include "testing.h"
+
+#include "resourcememory.h"
+
+// Block info as DXGIFormatGetBlockInfo gives it, which lives with the D3D utilities and can't be called here.
+static const int kRGBA8BlockSize = 1, kRGBA8BytesPerBlock = 4;
+static const int kBC1BlockSize = 4, kBC1BytesPerBlock = 8;
+static const int kBC7BlockSize = 4, kBC7BytesPerBlock = 16;
+
+// Each level halves every dimension and rounds down, but never below 1.
+static void ResourceMemoryTestTextureSize()
+{
+    // 5x3, 2x1, 1x1
+    TEST_CHECK(ResourceMemoryGetTextureSize(kRGBA8BlockSize, kRGBA8BytesPerBlock, 5, 3, 1, 0, 1) == (15 + 2 + 1) * 4);
+    TEST_CHECK(ResourceMemoryGetTextureSize(kRGBA8BlockSize, kRGBA8BytesPerBlock, 5, 3, 1, 2, 1) == (15 + 2) * 4);
+    TEST_CHECK(ResourceMemoryGetTextureSize(kRGBA8BlockSize, kRGBA8BytesPerBlock, 1, 1, 1, 0, 1) == 4);
+
+    // every slice of an array has the whole chain
+    TEST_CHECK(ResourceMemoryGetTextureSize(kRGBA8BlockSize, kRGBA8BytesPerBlock, 4, 4, 1, 0, 6) == (16 + 4 + 1) * 4 * 6);
+
+    // 4x4x2, 2x2x1, 1x1x1
+    TEST_CHECK(ResourceMemoryGetTextureSize(kRGBA8BlockSize, kRGBA8BytesPerBlock, 4, 4, 2, 0, 1) == (32 + 4 + 1) * 4);
+    // the chain is as long as the largest dimension needs, depth included
+    TEST_CHECK(ResourceMemoryGetTextureSize(kRGBA8BlockSize, kRGBA8BytesPerBlock, 1, 1, 4, 0, 1) == (4 + 2 + 1) * 4);
+}
+
+// Every level of a block-compressed texture is rounded up to whole blocks, down to the 1x1 levels.
+static void ResourceMemoryTestBlockCompressedSize()
+{
+    TEST_CHECK(ResourceMemoryGetTextureSize(kBC1BlockSize, kBC1BytesPerBlock, 5, 5, 1, 1, 1) == 2 * 2 * 8);
+    // 5x5, 2x2 and 1x1 are 2x2, 1x1 and 1x1 blocks
+    TEST_CHECK(ResourceMemoryGetTextureSize(kBC1BlockSize, kBC1BytesPerBlock, 5, 5, 1, 0, 1) == (4 + 1 + 1) * 8);
+    TEST_CHECK(ResourceMemoryGetTextureSize(kBC7BlockSize, kBC7BytesPerBlock, 256, 256, 1, 0, 1) ==
+        (4096 + 1024 + 256 + 64 + 16 + 4 + 1 + 1 + 1) * 16);
+    TEST_CHECK(ResourceMemoryGetTextureSize(kBC7BlockSize, kBC7BytesPerBlock, 12, 4, 1, 1, 3) == 3 * 1 * 16 * 3);
+}
+
+// Live bytes follow what is tracked now and peaks keep the most there has been, for each category and in total.
+static void ResourceMemoryTestTrack()
+{
+    int a, b, c;
+
+    TEST_CHECK(!ResourceMemoryTrack(&a, RESOURCE_CATEGORY_TEXTURE, 100));
+    TEST_CHECK(!ResourceMemoryTrack(&b, RESOURCE_CATEGORY_TEXTURE, 50));
+    TEST_CHECK(!ResourceMemoryTrack(&c, RESOURCE_CATEGORY_MESH, 30));
+    TEST_CHECK(ResourceMemoryGetNumResources(RESOURCE_CATEGORY_TEXTURE) == 2);
+    TEST_CHECK(ResourceMemoryGetNumResources(RESOURCE_CATEGORY_MESH) == 1);
+    TEST_CHECK(ResourceMemoryGetNumResources(RESOURCE_CATEGORY_VOXEL) == 0);
+    TEST_CHECK(ResourceMemoryGetLiveBytes(RESOURCE_CATEGORY_TEXTURE) == 150);
+    TEST_CHECK(ResourceMemoryGetLiveBytes(RESOURCE_CATEGORY_MESH) == 30);
+    TEST_CHECK(ResourceMemoryGetTotalLiveBytes() == 180);
+    TEST_CHECK(ResourceMemoryGetTotalPeakBytes() == 180);
+
+    ResourceMemoryUntrack(&a);
+    TEST_CHECK(ResourceMemoryGetNumResources(RESOURCE_CATEGORY_TEXTURE) == 1);
+    TEST_CHECK(ResourceMemoryGetLiveBytes(RESOURCE_CATEGORY_TEXTURE) == 50);
+    TEST_CHECK(ResourceMemoryGetPeakBytes(RESOURCE_CATEGORY_TEXTURE) == 150);
+    TEST_CHECK(ResourceMemoryGetTotalLiveBytes() == 80);
+    TEST_CHECK(ResourceMemoryGetTotalPeakBytes() == 180);
+
+    // tracking again replaces the size, and can move the resource to another category
+    TEST_CHECK(!ResourceMemoryTrack(&b, RESOURCE_CATEGORY_TEXTURE, 70));
+    TEST_CHECK(!ResourceMemoryTrack(&b, RESOURCE_CATEGORY_TEXTURE, 70));
+    TEST_CHECK(ResourceMemoryGetNumResources(RESOURCE_CATEGORY_TEXTURE) == 1);
+    TEST_CHECK(ResourceMemoryGetLiveBytes(RESOURCE_CATEGORY_TEXTURE) == 70);
+    TEST_CHECK(ResourceMemoryGetPeakBytes(RESOURCE_CATEGORY_TEXTURE) == 150);
+    TEST_CHECK(!ResourceMemoryTrack(&b, RESOURCE_CATEGORY_RENDER_TARGET, 20));
+    TEST_CHECK(ResourceMemoryGetNumResources(RESOURCE_CATEGORY_TEXTURE) == 0);
+    TEST_CHECK(ResourceMemoryGetLiveBytes(RESOURCE_CATEGORY_TEXTURE) == 0);
+    TEST_CHECK(ResourceMemoryGetNumResources(RESOURCE_CATEGORY_RENDER_TARGET) == 1);
+    TEST_CHECK(ResourceMemoryGetLiveBytes(RESOURCE_CATEGORY_RENDER_TARGET) == 20);
+    TEST_CHECK(ResourceMemoryGetTotalLiveBytes() == 50);
+
+    // untracking something that isn't tracked, or twice, changes nothing
+    int unknown;
+    ResourceMemoryUntrack(&unknown);
+    ResourceMemoryUntrack(&a);
+    TEST_CHECK(ResourceMemoryGetTotalLiveBytes() == 50);
+    TEST_CHECK(ResourceMemoryGetNumResources(RESOURCE_CATEGORY_TEXTURE) == 0);
+
+    ResourceMemoryUntrack(&b);
+    ResourceMemoryUntrack(&c);
+    TEST_CHECK(ResourceMemoryGetTotalLiveBytes() == 0);
+    TEST_CHECK(ResourceMemoryGetTotalPeakBytes() == 180);
+    TEST_CHECK(ResourceMemoryGetPeakBytes(RESOURCE_CATEGORY_MESH) == 30);
+    TEST_CHECK(ResourceMemoryGetPeakBytes(RESOURCE_CATEGORY_RENDER_TARGET) == 20);
+}
+
+// Only the resource that takes the live total over the budget reports it.
+static void ResourceMemoryTestBudget()
+{
+    int a, b, c;
+
+    ResourceMemorySetBudget(1000);
+    TEST_CHECK(ResourceMemoryGetBudget() == 1000);
+
+    TEST_CHECK(!ResourceMemoryTrack(&a, RESOURCE_CATEGORY_VOXEL, 600));
+    // reaching the budget isn't going over it
+    TEST_CHECK(!ResourceMemoryTrack(&b, RESOURCE_CATEGORY_VOXEL, 400));
+    TEST_CHECK(ResourceMemoryTrack(&c, RESOURCE_CATEGORY_VOXEL, 1));
+    // already over
+    TEST_CHECK(!ResourceMemoryTrack(&c, RESOURCE_CATEGORY_VOXEL, 2));
+
+    // back under, then over again
+    ResourceMemoryUntrack(&a);
+    TEST_CHECK(ResourceMemoryTrack(&a, RESOURCE_CATEGORY_VOXEL, 700));
+
+    // no budget never reports
+    ResourceMemorySetBudget(0);
+    TEST_CHECK(!ResourceMemoryTrack(&a, RESOURCE_CATEGORY_VOXEL, 1ull << 40));
+
+    ResourceMemoryUntrack(&a);
+    ResourceMemoryUntrack(&b);
+    ResourceMemoryUntrack(&c);
+    TEST_CHECK(ResourceMemoryGetTotalLiveBytes() == 0);
+}
+
+// Resources of unknown size are counted while they live, but add no bytes.
+static void ResourceMemoryTestUnknownSize()
+{
+    int a, b;
+
+    TEST_CHECK(ResourceMemoryGetNumUnknownSizeResources() == 0);
+    ResourceMemoryTrackUnknownSize(&a, RESOURCE_CATEGORY_TEXTURE);
+    ResourceMemoryTrackUnknownSize(&a, RESOURCE_CATEGORY_TEXTURE);
+    ResourceMemoryTrackUnknownSize(&b, RESOURCE_CATEGORY_RENDER_TARGET);
+    TEST_CHECK(ResourceMemoryGetNumUnknownSizeResources() == 2);
+    TEST_CHECK(ResourceMemoryGetNumResources(RESOURCE_CATEGORY_TEXTURE) == 1);
+    TEST_CHECK(ResourceMemoryGetTotalLiveBytes() == 0);
+
+    // once its size is known it is an ordinary resource
+    ResourceMemoryTrack(&a, RESOURCE_CATEGORY_TEXTURE, 64);
+    TEST_CHECK(ResourceMemoryGetNumUnknownSizeResources() == 1);
+    TEST_CHECK(ResourceMemoryGetTotalLiveBytes() == 64);
+
+    ResourceMemoryUntrack(&b);
+    TEST_CHECK(ResourceMemoryGetNumUnknownSizeResources() == 0);
+    ResourceMemoryUntrack(&a);
+}
+
+int main()
+{
+    ResourceMemoryTestTextureSize();
+    ResourceMemoryTestBlockCompressedSize();
+    ResourceMemoryTestTrack();
+    ResourceMemoryTestBudget();
+    ResourceMemoryTestUnknownSize();
+    return TestReport("resourcememory_test");
+}
\ No newline at end of file
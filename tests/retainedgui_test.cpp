@@ -0,0 +1,182 @@
+#include "testing.h"
+
+#include "retainedgui.h"
+
+#include <vector>
+#include <cstring>
+
+// What one frame of the test GUI shows
+struct RetainedGUITestContents
+{
+    float Value;
+    ImVec2 WindowPos;
+    float ItemSpacingY;
+};
+
+// How many region contents were submitted in the frame, rather than replayed
+static int g_RetainedGUITestNumBuilt;
+
+static void RetainedGUITestInit()
+{
+    ImGuiIO& io = ImGui::GetIO();
+    io.DisplaySize = ImVec2(1280.0f, 720.0f);
+    io.DeltaTime = 1.0f / 60.0f;
+    io.IniFilename = NULL;
+
+    unsigned char* pixels;
+    int width, height;
+    io.Fonts->GetTexDataAsAlpha8(&pixels, &width, &height);
+    io.Fonts->TexID = (ImTextureID)1;
+}
+
+template<class T>
+static void RetainedGUITestAppend(std::vector<unsigned char>* pBytes, const T* data, size_t count)
+{
+    const unsigned char* bytes = (const unsigned char*)data;
+    pBytes->insert(pBytes->end(), bytes, bytes + sizeof(T) * count);
+}
+
+// The draw data of the frame, field by field so that padding doesn't take part in the comparison.
+static std::vector<unsigned char> RetainedGUITestGetDrawBytes()
+{
+    std::vector<unsigned char> bytes;
+
+    const ImDrawData* pDrawData = ImGui::GetDrawData();
+    for (int listIndex = 0; listIndex < pDrawData->CmdListsCount; listIndex++)
+    {
+        const ImDrawList* pList = pDrawData->CmdLists[listIndex];
+        RetainedGUITestAppend(&bytes, &pList->VtxBuffer.Size, 1);
+        RetainedGUITestAppend(&bytes, pList->VtxBuffer.Data, pList->VtxBuffer.Size);
+        RetainedGUITestAppend(&bytes, &pList->IdxBuffer.Size, 1);
+        RetainedGUITestAppend(&bytes, pList->IdxBuffer.Data, pList->IdxBuffer.Size);
+        RetainedGUITestAppend(&bytes, &pList->CmdBuffer.Size, 1);
+        for (const ImDrawCmd& cmd : pList->CmdBuffer)
+        {
+            RetainedGUITestAppend(&bytes, &cmd.ElemCount, 1);
+            RetainedGUITestAppend(&bytes, &cmd.ClipRect, 1);
+            RetainedGUITestAppend(&bytes, &cmd.TextureId, 1);
+        }
+    }
+
+    return bytes;
+}
+
+// A window whose region starts and ends in the middle of a draw command and has a clip rect of its own inside, and a
+// second window with a region that never changes. Both have a fixed size, so every frame after the first is settled.
+static std::vector<unsigned char> RetainedGUITestFrame(const RetainedGUITestContents& contents)
+{
+    ImGui::GetStyle().ItemSpacing.y = contents.ItemSpacingY;
+    g_RetainedGUITestNumBuilt = 0;
+
+    ImGui::NewFrame();
+
+    ImGui::SetNextWindowPos(contents.WindowPos, ImGuiSetCond_Always);
+    ImGui::SetNextWindowSize(ImVec2(400.0f, 300.0f), ImGuiSetCond_Always);
+    ImGui::Begin("Changing", NULL, ImGuiWindowFlags_NoMove | ImGuiWindowFlags_NoResize | ImGuiWindowFlags_NoSavedSettings);
+    ImGui::Text("Before the region");
+    if (RetainedGUIBegin("value", RetainedGUIHash(&contents.Value, sizeof(contents.Value))))
+    {
+        g_RetainedGUITestNumBuilt++;
+        ImGui::Text("Value: %.3f", contents.Value);
+        ImGui::BulletText("Twice: %.3f", contents.Value * 2.0f);
+        ImGui::ProgressBar(contents.Value);
+
+        ImVec2 clipMin = ImGui::GetCursorScreenPos();
+        ImGui::GetWindowDrawList()->PushClipRect(ImVec4(clipMin.x, clipMin.y, clipMin.x + 60.0f, clipMin.y + 100.0f));
+        ImGui::Text("Clipped to 60 pixels: %.3f", contents.Value);
+        ImGui::GetWindowDrawList()->PopClipRect();
+
+        ImGui::Text("Last line of the region");
+    }
+    RetainedGUIEnd();
+    ImGui::SameLine();
+    ImGui::Text("on the region's last line");
+    ImGui::Separator();
+    ImGui::Text("After the region");
+    ImGui::End();
+
+    ImGui::SetNextWindowPos(ImVec2(600.0f, 100.0f), ImGuiSetCond_Always);
+    ImGui::SetNextWindowSize(ImVec2(300.0f, 300.0f), ImGuiSetCond_Always);
+    ImGui::Begin("Static", NULL, ImGuiWindowFlags_NoMove | ImGuiWindowFlags_NoResize | ImGuiWindowFlags_NoSavedSettings);
+    if (RetainedGUIBegin("static", 0))
+    {
+        g_RetainedGUITestNumBuilt++;
+        for (int line = 0; line < 10; line++)
+        {
+            ImGui::Text("Static line %d", line);
+        }
+    }
+    RetainedGUIEnd();
+    ImGui::End();
+
+    ImGui::Render();
+    return RetainedGUITestGetDrawBytes();
+}
+
+// A sequence of frames that changes the value, the window position and the style, and goes back to the start. Each is
+// drawn twice in immediate mode for reference, then twice retained, where the first builds the changed regions and the
+// second replays all of them. Both are byte-identical to immediate mode.
+static void RetainedGUITestMatchesImmediate()
+{
+    const RetainedGUITestContents sequence[] =
+    {
+        { 0.25f, ImVec2(20.0f, 20.0f), 4.0f },
+        { 0.75f, ImVec2(20.0f, 20.0f), 4.0f },
+        { 0.75f, ImVec2(35.5f, 60.0f), 4.0f },
+        { 0.75f, ImVec2(35.5f, 60.0f), 7.0f },
+        { 0.25f, ImVec2(20.0f, 20.0f), 4.0f },
+    };
+    const int kNumSteps = sizeof(sequence) / sizeof(sequence[0]);
+
+    RetainedGUISetEnabled(false);
+    std::vector<unsigned char> immediate[kNumSteps];
+    for (int step = 0; step < kNumSteps; step++)
+    {
+        // the first frame of a new window isn't settled yet
+        RetainedGUITestFrame(sequence[step]);
+        immediate[step] = RetainedGUITestFrame(sequence[step]);
+        TEST_CHECK(RetainedGUITestFrame(sequence[step]) == immediate[step]);
+    }
+
+    RetainedGUISetEnabled(true);
+    for (int step = 0; step < kNumSteps; step++)
+    {
+        std::vector<unsigned char> built = RetainedGUITestFrame(sequence[step]);
+        TEST_CHECK(g_RetainedGUITestNumBuilt > 0);
+        TEST_CHECK(built == immediate[step]);
+
+        std::vector<unsigned char> replayed = RetainedGUITestFrame(sequence[step]);
+        TEST_CHECK(g_RetainedGUITestNumBuilt == 0);
+        TEST_CHECK(replayed == immediate[step]);
+    }
+
+    // the static window's region is only built again when the style changes
+    RetainedGUITestFrame(sequence[0]);
+    RetainedGUITestFrame(sequence[1]);
+    TEST_CHECK(g_RetainedGUITestNumBuilt == 1);
+}
+
+static void RetainedGUITestDisabled()
+{
+    RetainedGUITestContents contents = { 0.5f, ImVec2(20.0f, 20.0f), 4.0f };
+
+    RetainedGUISetEnabled(false);
+    TEST_CHECK(!RetainedGUIIsEnabled());
+    for (int frame = 0; frame < 3; frame++)
+    {
+        RetainedGUITestFrame(contents);
+        TEST_CHECK(g_RetainedGUITestNumBuilt == 2);
+    }
+
+    RetainedGUISetEnabled(true);
+    TEST_CHECK(RetainedGUIIsEnabled());
+}
+
+int main()
+{
+    RetainedGUITestInit();
+    RetainedGUITestMatchesImmediate();
+    RetainedGUITestDisabled();
+    ImGui::Shutdown();
+    return TestReport("retainedgui_test");
+}
\ No newline at end of file
@@ -0,0 +1,364 @@
+#include "testing.h"
+
+#include "shadercache.h"
+
+#include <algorithm>
+#include <fstream>
+#include <map>
+#include <random>
+
+// Shader sources that live in memory, so the include tests don't need files.
+struct ShaderCacheTestFiles
+{
+    std::map<std::string, std::string> Sources;
+
+    ShaderCacheReadFileFunc GetReadFile() const
+    {
+        return [this](const std::string& path, std::string* pContents)
+        {
+            auto found = Sources.find(path);
+            if (found == Sources.end())
+                return false;
+
+            *pContents = found->second;
+            return true;
+        };
+    }
+};
+
+static bool ShaderCacheTestContains(const std::vector<std::string>& files, const char* file)
+{
+    return std::count(files.begin(), files.end(), std::string(file)) == 1;
+}
+
+static void ShaderCacheTestIncludes()
+{
+    ShaderCacheTestFiles files;
+    files.Sources["shaders/scene.hlsl"] =
+        "#include \"common.hlsl\"\n"
+        "  #  include \"lighting/brdf.hlsl\"\n"
+        "#include <system.hlsl>\n"
+        "#if 0\n"
+        "#include \"disabled.hlsl\"\n"
+        "#endif\n"
+        "float4 PSmain() : SV_Target { return 0; } // #include \"comment.hlsl\"\n";
+    files.Sources["shaders/common.hlsl"] = "#include \"lighting/brdf.hlsl\"\n";
+    files.Sources["shaders/lighting/brdf.hlsl"] = "#include \"fresnel.hlsl\"\n";
+    files.Sources["shaders/lighting/fresnel.hlsl"] = "";
+    files.Sources["shaders/disabled.hlsl"] = "";
+
+    std::vector<std::string> closure;
+    ShaderCacheCollectIncludes("shaders/scene.hlsl", files.GetReadFile(), &closure);
+
+    // the shader is first, includes are relative to the including file, and a file included twice is listed once
+    TEST_CHECK(!closure.empty() && closure[0] == "shaders/scene.hlsl");
+    TEST_CHECK(ShaderCacheTestContains(closure, "shaders/common.hlsl"));
+    TEST_CHECK(ShaderCacheTestContains(closure, "shaders/lighting/brdf.hlsl"));
+    TEST_CHECK(ShaderCacheTestContains(closure, "shaders/lighting/fresnel.hlsl"));
+
+    // #if isn't evaluated, so a disabled include is still a dependency, but only quoted includes are followed
+    TEST_CHECK(ShaderCacheTestContains(closure, "shaders/disabled.hlsl"));
+    TEST_CHECK(closure.size() == 5);
+}
+
+static void ShaderCacheTestIncludeCycle()
+{
+    ShaderCacheTestFiles files;
+    files.Sources["a.hlsl"] = "#include \"b.hlsl\"\n";
+    files.Sources["b.hlsl"] = "#include \"c.hlsl\"\n";
+    files.Sources["c.hlsl"] = "#include \"a.hlsl\"\n#include \"c.hlsl\"\n";
+
+    std::vector<std::string> closure;
+    ShaderCacheCollectIncludes("b.hlsl", files.GetReadFile(), &closure);
+
+    TEST_CHECK(closure.size() == 3);
+    TEST_CHECK(!closure.empty() && closure[0] == "b.hlsl");
+    TEST_CHECK(ShaderCacheTestContains(closure, "a.hlsl"));
+    TEST_CHECK(ShaderCacheTestContains(closure, "c.hlsl"));
+}
+
+static void ShaderCacheTestMissingInclude()
+{
+    ShaderCacheTestFiles files;
+    files.Sources["a.hlsl"] = "#include \"missing.hlsl\"\n#include \"b.hlsl\"\n";
+    files.Sources["b.hlsl"] = "";
+
+    // a missing file is listed, so creating it later invalidates the shader, and doesn't stop the others
+    std::vector<std::string> closure;
+    ShaderCacheCollectIncludes("a.hlsl", files.GetReadFile(), &closure);
+    TEST_CHECK(closure.size() == 3);
+    TEST_CHECK(ShaderCacheTestContains(closure, "missing.hlsl"));
+    TEST_CHECK(ShaderCacheTestContains(closure, "b.hlsl"));
+
+    // so is a missing shader
+    ShaderCacheCollectIncludes("nothing.hlsl", files.GetReadFile(), &closure);
+    TEST_CHECK(closure.size() == 1 && closure[0] == "nothing.hlsl");
+}
+
+static void ShaderCacheTestKey()
+{
+    ShaderCacheTestFiles files;
+    files.Sources["scene.hlsl"] = "#include \"common.hlsl\"\nfloat4 PSmain() : SV_Target { return kColor; }\n";
+    files.Sources["common.hlsl"] = "static const float4 kColor = 1;\n";
+    files.Sources["unrelated.hlsl"] = "";
+
+    ShaderCacheKeyDesc desc;
+    desc.Path = "scene.hlsl";
+    desc.EntryPoint = "PSmain";
+    desc.Target = "ps_5_0";
+    desc.Defines.push_back(ShaderDefine{ "DIFFUSE_TEXTURE", "1" });
+    desc.Defines.push_back(ShaderDefine{ "BUMP_TEXTURE", "0" });
+    desc.Flags = 1 << 15;
+
+    std::vector<std::string> includedFiles;
+    uint64_t key = ShaderCacheComputeKey(desc, files.GetReadFile(), &includedFiles);
+    TEST_CHECK(ShaderCacheComputeKey(desc, files.GetReadFile()) == key);
+    TEST_CHECK(includedFiles.size() == 2);
+
+    // everything the compiler sees changes the key
+    ShaderCacheKeyDesc changed = desc;
+    changed.EntryPoint = "VSmain";
+    TEST_CHECK(ShaderCacheComputeKey(changed, files.GetReadFile()) != key);
+
+    changed = desc;
+    changed.Target = "ps_5_1";
+    TEST_CHECK(ShaderCacheComputeKey(changed, files.GetReadFile()) != key);
+
+    changed = desc;
+    changed.Flags |= 1;
+    TEST_CHECK(ShaderCacheComputeKey(changed, files.GetReadFile()) != key);
+
+    changed = desc;
+    changed.Defines[1].Value = "1";
+    TEST_CHECK(ShaderCacheComputeKey(changed, files.GetReadFile()) != key);
+
+    changed = desc;
+    changed.Defines[1].Name = "SPECULAR_TEXTURE";
+    TEST_CHECK(ShaderCacheComputeKey(changed, files.GetReadFile()) != key);
+
+    changed = desc;
+    changed.Defines.push_back(ShaderDefine{ "EXTRA", "" });
+    TEST_CHECK(ShaderCacheComputeKey(changed, files.GetReadFile()) != key);
+
+    changed = desc;
+    std::swap(changed.Defines[0], changed.Defines[1]);
+    TEST_CHECK(ShaderCacheComputeKey(changed, files.GetReadFile()) != key);
+
+    // strings are hashed with their lengths, so moving characters between them changes the key
+    changed = desc;
+    changed.Defines[0].Name = "DIFFUSE_TEXTURE1";
+    changed.Defines[0].Value = "";
+    TEST_CHECK(ShaderCacheComputeKey(changed, files.GetReadFile()) != key);
+
+    ShaderCacheTestFiles editedFiles = files;
+    editedFiles.Sources["common.hlsl"] = "static const float4 kColor = 0.5;\n";
+    TEST_CHECK(ShaderCacheComputeKey(desc, editedFiles.GetReadFile()) != key);
+
+    editedFiles = files;
+    editedFiles.Sources["scene.hlsl"] += "\n";
+    TEST_CHECK(ShaderCacheComputeKey(desc, editedFiles.GetReadFile()) != key);
+
+    // a missing include isn't the same as an empty one
+    editedFiles = files;
+    editedFiles.Sources.erase("common.hlsl");
+    uint64_t missingKey = ShaderCacheComputeKey(desc, editedFiles.GetReadFile());
+    editedFiles.Sources["common.hlsl"] = "";
+    TEST_CHECK(missingKey != key);
+    TEST_CHECK(ShaderCacheComputeKey(desc, editedFiles.GetReadFile()) != missingKey);
+
+    // files outside of the include closure don't matter
+    editedFiles = files;
+    editedFiles.Sources["unrelated.hlsl"] = "float4 kUnrelated;\n";
+    TEST_CHECK(ShaderCacheComputeKey(desc, editedFiles.GetReadFile()) == key);
+}
+
+static std::vector<uint8_t> ShaderCacheTestBlob(size_t size, uint8_t seed)
+{
+    std::vector<uint8_t> blob(size);
+    for (size_t i = 0; i < size; i++)
+    {
+        blob[i] = (uint8_t)(seed + i * 7);
+    }
+    return blob;
+}
+
+static bool ShaderCacheTestFind(ShaderCache* pCache, uint64_t key, const std::vector<uint8_t>& expected)
+{
+    const std::vector<uint8_t>* pBlob = ShaderCacheFind(pCache, key);
+    return pBlob && *pBlob == expected;
+}
+
+static bool ShaderCacheTestWriteFile(const std::string& path, const std::string& contents)
+{
+    std::ofstream file(path, std::ios::binary | std::ios::trunc);
+    file.write(contents.data(), contents.size());
+    return (bool)file.flush();
+}
+
+static void ShaderCacheTestRoundTrip(const std::string& directory)
+{
+    std::string path = directory + "/roundtrip.bin";
+
+    std::vector<uint8_t> blobA = ShaderCacheTestBlob(1000, 1);
+    std::vector<uint8_t> blobB = ShaderCacheTestBlob(0, 2);
+    std::vector<uint8_t> blobC = ShaderCacheTestBlob(70000, 3);
+
+    ShaderCache cache;
+    ShaderCacheOpen(path.c_str(), &cache);
+    TEST_CHECK(cache.Entries.empty());
+    TEST_CHECK(!cache.Dirty);
+
+    ShaderCacheInsert(&cache, 0xA, blobA.data(), blobA.size());
+    ShaderCacheInsert(&cache, 0xB, blobB.data(), blobB.size());
+    ShaderCacheInsert(&cache, 0xC, blobC.data(), blobC.size());
+    TEST_CHECK(cache.Dirty);
+    TEST_CHECK(ShaderCacheSave(&cache));
+    TEST_CHECK(!cache.Dirty);
+
+    std::string unused;
+    TEST_CHECK(!ShaderCacheReadFile(path + ".tmp", &unused));
+
+    ShaderCache reopened;
+    ShaderCacheOpen(path.c_str(), &reopened);
+    TEST_CHECK(reopened.Entries.size() == 3);
+    TEST_CHECK(!reopened.Dirty);
+    TEST_CHECK(ShaderCacheTestFind(&reopened, 0xA, blobA));
+    TEST_CHECK(ShaderCacheTestFind(&reopened, 0xB, blobB));
+    TEST_CHECK(ShaderCacheTestFind(&reopened, 0xC, blobC));
+    TEST_CHECK(ShaderCacheFind(&reopened, 0xD) == NULL);
+
+    // the same entries always make the same file
+    std::string before, after;
+    TEST_CHECK(ShaderCacheReadFile(path, &before));
+    TEST_CHECK(ShaderCacheSave(&reopened));
+    TEST_CHECK(ShaderCacheReadFile(path, &after));
+    TEST_CHECK(before == after);
+}
+
+static void ShaderCacheTestPrune(const std::string& directory)
+{
+    std::string path = directory + "/prune.bin";
+
+    std::vector<uint8_t> blob = ShaderCacheTestBlob(100, 4);
+
+    ShaderCache cache;
+    ShaderCacheOpen(path.c_str(), &cache);
+    for (uint64_t key = 1; key <= 4; key++)
+    {
+        ShaderCacheInsert(&cache, key, blob.data(), blob.size());
+    }
+    TEST_CHECK(ShaderCacheSave(&cache));
+
+    // the next launch only uses two of them, and compiles a new one
+    ShaderCacheOpen(path.c_str(), &cache);
+    TEST_CHECK(cache.Entries.size() == 4);
+    TEST_CHECK(ShaderCacheTestFind(&cache, 2, blob));
+    TEST_CHECK(ShaderCacheTestFind(&cache, 3, blob));
+    ShaderCacheInsert(&cache, 5, blob.data(), blob.size());
+    TEST_CHECK(ShaderCacheSave(&cache));
+
+    ShaderCacheOpen(path.c_str(), &cache);
+    TEST_CHECK(cache.Entries.size() == 3);
+    TEST_CHECK(cache.Entries.count(1) == 0);
+    TEST_CHECK(cache.Entries.count(4) == 0);
+    TEST_CHECK(ShaderCacheTestFind(&cache, 2, blob));
+    TEST_CHECK(ShaderCacheTestFind(&cache, 3, blob));
+    TEST_CHECK(ShaderCacheTestFind(&cache, 5, blob));
+}
+
+// Every truncation and a range of corruptions open as an empty cache, or with the blobs they had, and the next
+// save writes a valid file again.
+static void ShaderCacheTestDamagedFile(const std::string& directory)
+{
+    std::string path = directory + "/damaged.bin";
+
+    std::vector<uint8_t> blobA = ShaderCacheTestBlob(300, 5);
+    std::vector<uint8_t> blobB = ShaderCacheTestBlob(500, 6);
+
+    ShaderCache cache;
+    ShaderCacheOpen(path.c_str(), &cache);
+    ShaderCacheInsert(&cache, 0xA, blobA.data(), blobA.size());
+    ShaderCacheInsert(&cache, 0xB, blobB.data(), blobB.size());
+    TEST_CHECK(ShaderCacheSave(&cache));
+
+    std::string contents;
+    TEST_CHECK(ShaderCacheReadFile(path, &contents));
+
+    for (size_t size = 0; size < contents.size(); size++)
+    {
+        TEST_CHECK(ShaderCacheTestWriteFile(path, contents.substr(0, size)));
+        ShaderCacheOpen(path.c_str(), &cache);
+        TEST_CHECK(cache.Entries.empty());
+    }
+
+    // the header is 4 words, followed by an index entry of key, offset and size per blob
+    const size_t kHeaderSize = 16;
+    const size_t kIndexEntrySize = 24;
+    struct Corruption
+    {
+        size_t Offset;
+        uint64_t Value;
+        int NumBytes;
+    };
+    const Corruption corruptions[] = {
+        { 0, 0x12345678, 4 }, // magic
+        { 4, 99, 4 }, // version
+        { 8, 0xFFFFFFFF, 4 }, // number of entries
+        { kHeaderSize + 8, 0, 8 }, // an offset inside the index
+        { kHeaderSize + 8, ~0ull - 100, 8 }, // an offset past the end
+        { kHeaderSize + 16, ~0ull - 100, 8 }, // a size that wraps around with the offset
+        { kHeaderSize + kIndexEntrySize + 16, 1 << 20, 8 }, // a size past the end
+    };
+
+    for (const Corruption& corruption : corruptions)
+    {
+        std::string corrupt = contents;
+        for (int i = 0; i < corruption.NumBytes; i++)
+        {
+            corrupt[corruption.Offset + i] = (char)(corruption.Value >> (i * 8));
+        }
+        TEST_CHECK(ShaderCacheTestWriteFile(path, corrupt));
+        ShaderCacheOpen(path.c_str(), &cache);
+        TEST_CHECK(cache.Entries.empty());
+    }
+
+    // random bytes anywhere never crash, and whatever is loaded lies within the file
+    std::mt19937 rng(8);
+    for (int iteration = 0; iteration < 1000; iteration++)
+    {
+        std::string corrupt = contents;
+        std::uniform_int_distribution<size_t> offset(0, corrupt.size() - 1);
+        corrupt[offset(rng)] = (char)rng();
+        TEST_CHECK(ShaderCacheTestWriteFile(path, corrupt));
+
+        ShaderCacheOpen(path.c_str(), &cache);
+        TEST_CHECK(cache.Entries.size() <= 2);
+        for (const auto& keyEntry : cache.Entries)
+        {
+            TEST_CHECK(keyEntry.second.Blob.size() < corrupt.size());
+        }
+    }
+
+    // the cache recovers by being rewritten
+    TEST_CHECK(ShaderCacheTestWriteFile(path, "not a shader cache"));
+    ShaderCacheOpen(path.c_str(), &cache);
+    TEST_CHECK(cache.Entries.empty());
+    ShaderCacheInsert(&cache, 0xA, blobA.data(), blobA.size());
+    TEST_CHECK(ShaderCacheSave(&cache));
+    ShaderCacheOpen(path.c_str(), &cache);
+    TEST_CHECK(ShaderCacheTestFind(&cache, 0xA, blobA));
+}
+
+int main()
+{
+    ShaderCacheTestIncludes();
+    ShaderCacheTestIncludeCycle();
+    ShaderCacheTestMissingInclude();
+    ShaderCacheTestKey();
+
+    std::string directory = TestCreateTempDirectory("shadercache_test");
+    ShaderCacheTestRoundTrip(directory);
+    ShaderCacheTestPrune(directory);
+    ShaderCacheTestDamagedFile(directory);
+    return TestReport("shadercache_test");
+}
\ No newline at end of file
@@ -0,0 +1,307 @@
+#include "testing.h"
+
+#include "shadercompilequeue.h"
+
+#include <atomic>
+#include <chrono>
+#include <future>
+#include <random>
+#include <thread>
+
+// Stands in for CompiledShader: the objects of every stage, made by the same compile.
+// Each stage is written separately, with sleeps in between, so a shader that was published before its compile
+// finished would show up as stages of different generations.
+struct StubCompiledShader
+{
+    int Entry;
+    int VS;
+    int PS;
+    int Blob;
+};
+
+// Stands in for Shader, whose pointers the render thread swaps between frames.
+struct StubShader
+{
+    int VS;
+    int PS;
+    int Blob;
+    std::shared_ptr<StubCompiledShader> Compiled;
+};
+
+static ShaderCompileFunc ShaderCompileQueueTestStub(int entry, int generation, int sleepMicroseconds, bool succeeds = true)
+{
+    return [=]
+    {
+        std::shared_ptr<StubCompiledShader> compiled = std::make_shared<StubCompiledShader>();
+        compiled->Entry = entry;
+        compiled->VS = generation;
+        std::this_thread::sleep_for(std::chrono::microseconds(sleepMicroseconds / 2));
+        compiled->PS = generation;
+        std::this_thread::sleep_for(std::chrono::microseconds(sleepMicroseconds - sleepMicroseconds / 2));
+        compiled->Blob = generation;
+        return succeeds ? std::static_pointer_cast<void>(compiled) : std::shared_ptr<void>();
+    };
+}
+
+// Blocks until released, so a test can tell when the compile is running and decide when it finishes.
+struct ShaderCompileQueueTestGate
+{
+    std::promise<void> Started;
+    std::promise<void> Release;
+};
+
+static ShaderCompileFunc ShaderCompileQueueTestGatedStub(int entry, int generation, const std::shared_ptr<ShaderCompileQueueTestGate>& pGate)
+{
+    std::shared_future<void> release = pGate->Release.get_future().share();
+    return [=]
+    {
+        pGate->Started.set_value();
+        release.wait();
+        return ShaderCompileQueueTestStub(entry, generation, 0)();
+    };
+}
+
+static int ShaderCompileQueueTestGetGeneration(const ShaderCompileResult& result)
+{
+    return std::static_pointer_cast<StubCompiledShader>(result.Shader)->Blob;
+}
+
+// Collects until a result arrives, or gives up after a while.
+static std::vector<ShaderCompileResult> ShaderCompileQueueTestCollectOne(ShaderCompileQueue* pQueue)
+{
+    std::vector<ShaderCompileResult> results;
+    for (int attempt = 0; attempt < 2000 && results.empty(); attempt++)
+    {
+        ShaderCompileQueueCollect(pQueue, &results);
+        std::this_thread::sleep_for(std::chrono::milliseconds(1));
+    }
+    return results;
+}
+
+// A compile that was overtaken while it ran is dropped, even though it finishes last.
+static void ShaderCompileQueueTestOvertakenWhileRunning()
+{
+    ShaderCompileQueue* pQueue = ShaderCompileQueueCreate(2);
+
+    std::shared_ptr<ShaderCompileQueueTestGate> pGate = std::make_shared<ShaderCompileQueueTestGate>();
+    std::future<void> started = pGate->Started.get_future();
+    ShaderCompileQueueSubmit(pQueue, 0, ShaderCompileQueueTestGatedStub(0, 1, pGate));
+    started.wait();
+
+    ShaderCompileQueueSubmit(pQueue, 0, ShaderCompileQueueTestStub(0, 2, 0));
+    std::vector<ShaderCompileResult> results = ShaderCompileQueueTestCollectOne(pQueue);
+    TEST_CHECK(results.size() == 1);
+    TEST_CHECK(!results.empty() && results[0].Entry == 0 && ShaderCompileQueueTestGetGeneration(results[0]) == 2);
+
+    pGate->Release.set_value();
+    ShaderCompileQueueWaitIdle(pQueue);
+    TEST_CHECK(ShaderCompileQueueGetNumPending(pQueue) == 0);
+
+    results.clear();
+    ShaderCompileQueueCollect(pQueue, &results);
+    TEST_CHECK(results.empty());
+
+    ShaderCompileQueueDestroy(pQueue);
+}
+
+// A compile that finished but wasn't collected yet is dropped when the entry is submitted again.
+static void ShaderCompileQueueTestOvertakenBeforeCollect()
+{
+    ShaderCompileQueue* pQueue = ShaderCompileQueueCreate(1);
+
+    ShaderCompileQueueSubmit(pQueue, 0, ShaderCompileQueueTestStub(0, 1, 0));
+    ShaderCompileQueueWaitIdle(pQueue);
+
+    std::shared_ptr<ShaderCompileQueueTestGate> pGate = std::make_shared<ShaderCompileQueueTestGate>();
+    std::future<void> started = pGate->Started.get_future();
+    ShaderCompileQueueSubmit(pQueue, 0, ShaderCompileQueueTestGatedStub(0, 2, pGate));
+    started.wait();
+
+    std::vector<ShaderCompileResult> results;
+    ShaderCompileQueueCollect(pQueue, &results);
+    TEST_CHECK(results.empty());
+
+    pGate->Release.set_value();
+    ShaderCompileQueueWaitIdle(pQueue);
+    ShaderCompileQueueCollect(pQueue, &results);
+    TEST_CHECK(results.size() == 1);
+    TEST_CHECK(!results.empty() && ShaderCompileQueueTestGetGeneration(results[0]) == 2);
+
+    ShaderCompileQueueDestroy(pQueue);
+}
+
+// A submission replaces the queued one for its entry, which then never runs, and keeps its place in line.
+static void ShaderCompileQueueTestReplaceQueued()
+{
+    ShaderCompileQueue* pQueue = ShaderCompileQueueCreate(1);
+
+    // the only worker is busy, so everything after this waits in the queue
+    std::shared_ptr<ShaderCompileQueueTestGate> pGate = std::make_shared<ShaderCompileQueueTestGate>();
+    std::future<void> started = pGate->Started.get_future();
+    ShaderCompileQueueSubmit(pQueue, 0, ShaderCompileQueueTestGatedStub(0, 1, pGate));
+    started.wait();
+
+    std::atomic<int> numReplacedRuns(0);
+    ShaderCompileQueueSubmit(pQueue, 1, [&numReplacedRuns]
+    {
+        numReplacedRuns++;
+        return ShaderCompileQueueTestStub(1, 1, 0)();
+    });
+    ShaderCompileQueueSubmit(pQueue, 2, ShaderCompileQueueTestStub(2, 1, 0));
+    ShaderCompileQueueSubmit(pQueue, 1, ShaderCompileQueueTestStub(1, 2, 0));
+    TEST_CHECK(ShaderCompileQueueGetNumPending(pQueue) == 3);
+
+    pGate->Release.set_value();
+    ShaderCompileQueueWaitIdle(pQueue);
+    TEST_CHECK(numReplacedRuns == 0);
+
+    std::vector<ShaderCompileResult> results;
+    ShaderCompileQueueCollect(pQueue, &results);
+    TEST_CHECK(results.size() == 3);
+    if (results.size() == 3)
+    {
+        // one worker runs the jobs in the order they were first queued
+        TEST_CHECK(results[0].Entry == 0 && ShaderCompileQueueTestGetGeneration(results[0]) == 1);
+        TEST_CHECK(results[1].Entry == 1 && ShaderCompileQueueTestGetGeneration(results[1]) == 2);
+        TEST_CHECK(results[2].Entry == 2 && ShaderCompileQueueTestGetGeneration(results[2]) == 1);
+    }
+
+    ShaderCompileQueueDestroy(pQueue);
+}
+
+// A failed compile publishes nothing, so the previous shader stays.
+static void ShaderCompileQueueTestFailure()
+{
+    ShaderCompileQueue* pQueue = ShaderCompileQueueCreate(1);
+
+    ShaderCompileQueueSubmit(pQueue, 0, ShaderCompileQueueTestStub(0, 1, 0, false));
+    ShaderCompileQueueWaitIdle(pQueue);
+
+    std::vector<ShaderCompileResult> results;
+    ShaderCompileQueueCollect(pQueue, &results);
+    TEST_CHECK(results.empty());
+
+    ShaderCompileQueueDestroy(pQueue);
+}
+
+// Frames submit reloads of random shaders with compiles that take a random time, some of which fail, and swap the
+// collected results in between frames like RendererPublishCompiledShaders. Every frame draws with every shader and
+// checks that each one's stages come from one compile, and that no shader ever goes back to an older compile.
+static void ShaderCompileQueueTestFrames(int numThreads, uint32_t seed)
+{
+    const int numEntries = 8;
+    const int numFrames = 300;
+
+    std::mt19937 rng(seed);
+    std::uniform_int_distribution<int> randomEntry(0, numEntries - 1);
+    std::uniform_int_distribution<int> sleepMicroseconds(0, 3000);
+    std::uniform_int_distribution<int> percent(0, 99);
+
+    ShaderCompileQueue* pQueue = ShaderCompileQueueCreate(numThreads);
+
+    // the initial compiles, waited for like RendererWaitForShaders
+    std::vector<int> numSubmissions(numEntries, 1);
+    for (int entry = 0; entry < numEntries; entry++)
+    {
+        ShaderCompileQueueSubmit(pQueue, entry, ShaderCompileQueueTestStub(entry, 1, sleepMicroseconds(rng)));
+    }
+    ShaderCompileQueueWaitIdle(pQueue);
+
+    std::vector<StubShader> shaders(numEntries);
+    int numResults = 0;
+    int numMixedShaders = 0;
+    int numOlderShaders = 0;
+    int numDuplicateResults = 0;
+
+    auto publish = [&]
+    {
+        std::vector<ShaderCompileResult> results;
+        ShaderCompileQueueCollect(pQueue, &results);
+
+        std::vector<int> entryResults(numEntries, 0);
+        for (const ShaderCompileResult& result : results)
+        {
+            std::shared_ptr<StubCompiledShader> compiled = std::static_pointer_cast<StubCompiledShader>(result.Shader);
+            if (compiled->Entry != result.Entry)
+                numMixedShaders++;
+            if (++entryResults[result.Entry] > 1)
+                numDuplicateResults++;
+            if (shaders[result.Entry].Compiled && compiled->Blob <= shaders[result.Entry].Blob)
+                numOlderShaders++;
+
+            StubShader& shader = shaders[result.Entry];
+            shader.VS = compiled->VS;
+            shader.PS = compiled->PS;
+            shader.Blob = compiled->Blob;
+            shader.Compiled = compiled;
+            numResults++;
+        }
+    };
+
+    publish();
+    for (int entry = 0; entry < numEntries; entry++)
+    {
+        TEST_CHECK(shaders[entry].Compiled && shaders[entry].Blob == 1);
+    }
+
+    for (int frame = 0; frame < numFrames; frame++)
+    {
+        // a burst of saves, which can hit the same shader several times in a row
+        int numReloads = percent(rng) < 30 ? 1 + percent(rng) % 4 : 0;
+        for (int reload = 0; reload < numReloads; reload++)
+        {
+            int entry = randomEntry(rng);
+            int generation = ++numSubmissions[entry];
+            bool succeeds = percent(rng) >= 10;
+            ShaderCompileQueueSubmit(pQueue, entry, ShaderCompileQueueTestStub(entry, generation, sleepMicroseconds(rng), succeeds));
+        }
+
+        // the frame's draws
+        for (const StubShader& shader : shaders)
+        {
+            if (shader.VS != shader.PS || shader.PS != shader.Blob || shader.Compiled->Blob != shader.Blob)
+                numMixedShaders++;
+        }
+        std::this_thread::sleep_for(std::chrono::microseconds(500));
+
+        publish();
+    }
+
+    // one last reload of everything that succeeds, which every shader has to end up with
+    for (int entry = 0; entry < numEntries; entry++)
+    {
+        int generation = ++numSubmissions[entry];
+        ShaderCompileQueueSubmit(pQueue, entry, ShaderCompileQueueTestStub(entry, generation, sleepMicroseconds(rng)));
+    }
+    ShaderCompileQueueWaitIdle(pQueue);
+    TEST_CHECK(ShaderCompileQueueGetNumPending(pQueue) == 0);
+    publish();
+
+    int totalSubmissions = 0;
+    for (int entry = 0; entry < numEntries; entry++)
+    {
+        TEST_CHECK(shaders[entry].Blob == numSubmissions[entry]);
+        totalSubmissions += numSubmissions[entry];
+    }
+
+    TEST_CHECK(numMixedShaders == 0);
+    TEST_CHECK(numOlderShaders == 0);
+    TEST_CHECK(numDuplicateResults == 0);
+
+    // overtaken and failed compiles were dropped rather than published late
+    TEST_CHECK(numResults < totalSubmissions);
+
+    ShaderCompileQueueDestroy(pQueue);
+}
+
+int main()
+{
+    ShaderCompileQueueTestOvertakenWhileRunning();
+    ShaderCompileQueueTestOvertakenBeforeCollect();
+    ShaderCompileQueueTestReplaceQueued();
+    ShaderCompileQueueTestFailure();
+    ShaderCompileQueueTestFrames(1, 1);
+    ShaderCompileQueueTestFrames(3, 2);
+    ShaderCompileQueueTestFrames(8, 3);
+    return TestReport("shadercompilequeue_test");
+}
\ No newline at end of file
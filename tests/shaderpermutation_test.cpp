@@ -0,0 +1,89 @@
+#include "testing.h"
+
+#include "shaderpermutation.h"
+
+#include <algorithm>
+
+// Every feature has a define, in feature order, with the value of its bit.
+static void ShaderPermutationTestDefines()
+{
+    for (uint32_t permutation = 0; permutation < kNumMaterialPermutations; permutation++)
+    {
+        std::vector<ShaderDefine> defines(5);
+        ShaderPermutationGetDefines(kMaterialFeatureDefines, kNumMaterialFeatures, permutation, &defines);
+
+        TEST_CHECK(defines.size() == kNumMaterialFeatures);
+        for (int feature = 0; feature < kNumMaterialFeatures && feature < (int)defines.size(); feature++)
+        {
+            TEST_CHECK(defines[feature].Name == kMaterialFeatureDefines[feature]);
+            TEST_CHECK(defines[feature].Value == ((permutation >> feature) & 1 ? "1" : "0"));
+        }
+    }
+}
+
+static void ShaderPermutationTestSelectMaterial()
+{
+    for (uint32_t permutation = 0; permutation < kNumMaterialPermutations; permutation++)
+    {
+        // any texture ID that isn't -1 is a texture, including 0
+        int diffuse = (permutation & MATERIAL_FEATURE_DIFFUSE_TEXTURE) ? 0 : -1;
+        int specular = (permutation & MATERIAL_FEATURE_SPECULAR_TEXTURE) ? 7 : -1;
+        int bump = (permutation & MATERIAL_FEATURE_BUMP_TEXTURE) ? 12 : -1;
+        TEST_CHECK(ShaderPermutationSelectMaterial(diffuse, specular, bump) == permutation);
+    }
+}
+
+static void ShaderPermutationTestCollectUsed()
+{
+    std::vector<uint32_t> used(3, 99);
+    ShaderPermutationCollectUsed({ 5, 0, 5, 7, 0, 2, 5 }, &used);
+    TEST_CHECK(used == std::vector<uint32_t>({ 0, 2, 5, 7 }));
+
+    ShaderPermutationCollectUsed(std::vector<uint32_t>(), &used);
+    TEST_CHECK(used.empty());
+}
+
+// Each permutation compiles into a blob of its own, and its key doesn't change between runs.
+static void ShaderPermutationTestCacheKeys()
+{
+    ShaderCacheReadFileFunc readFile = [](const std::string& path, std::string* pContents)
+    {
+        if (path != "shaders/scene.hlsl")
+            return false;
+
+        *pContents = "#if HAS_DIFFUSE_TEXTURE\nTexture2D DiffuseTexture;\n#endif\n";
+        return true;
+    };
+
+    ShaderCacheKeyDesc desc;
+    desc.Path = "shaders/scene.hlsl";
+    desc.EntryPoint = "PSmain";
+    desc.Target = "ps_5_0";
+    desc.Flags = 0;
+
+    std::vector<uint64_t> keys;
+    for (uint32_t permutation = 0; permutation < kNumMaterialPermutations; permutation++)
+    {
+        ShaderPermutationGetDefines(kMaterialFeatureDefines, kNumMaterialFeatures, permutation, &desc.Defines);
+        uint64_t key = ShaderCacheComputeKey(desc, readFile);
+        TEST_CHECK(ShaderCacheComputeKey(desc, readFile) == key);
+        keys.push_back(key);
+    }
+
+    // the same defines written out by hand give the same key
+    ShaderCacheKeyDesc handWritten = desc;
+    handWritten.Defines = { { "HAS_DIFFUSE_TEXTURE", "1" }, { "HAS_SPECULAR_TEXTURE", "0" }, { "HAS_BUMP_TEXTURE", "1" } };
+    TEST_CHECK(ShaderCacheComputeKey(handWritten, readFile) == keys[MATERIAL_FEATURE_DIFFUSE_TEXTURE | MATERIAL_FEATURE_BUMP_TEXTURE]);
+
+    std::sort(keys.begin(), keys.end());
+    TEST_CHECK(std::unique(keys.begin(), keys.end()) == keys.end());
+}
+
+int main()
+{
+    ShaderPermutationTestDefines();
+    ShaderPermutationTestSelectMaterial();
+    ShaderPermutationTestCollectUsed();
+    ShaderPermutationTestCacheKeys();
+    return TestReport("shaderpermutation_test");
+}
\ No newline at end of file
@@ -0,0 +1,247 @@
+#include "testing.h"
+
+#include "telemetry.h"
+
+#include <algorithm>
+#include <atomic>
+#include <chrono>
+#include <thread>
+#include <fstream>
+#include <sstream>
+#include <string>
+#include <vector>
+#include <cstring>
+
+// Long enough that the sampler waits until the interval is changed again.
+static const double kTelemetryTestIdleInterval = 1000.0;
+
+// The adapter fields of a snapshot, which the test's adapter callback derives from its sample index.
+static uint64_t TelemetryTestAdapterValue(uint64_t sampleIndex, int field)
+{
+    return sampleIndex * 3 + field + 1;
+}
+
+// Fills the adapter fields one at a time with yields between them, so a reader that looked at a snapshot while it
+// was written would see fields of two different samples.
+static void TelemetryTestSampleAdapter(TelemetrySnapshot* pSnapshot, std::atomic<uint64_t>* pLastSampleIndex)
+{
+    uint64_t* fields[] = { &pSnapshot->AdapterLocalUsageBytes, &pSnapshot->AdapterNonLocalUsageBytes, &pSnapshot->AdapterLocalBudgetBytes };
+    for (int field = 0; field < 3; field++)
+    {
+        *fields[field] = TelemetryTestAdapterValue(pSnapshot->SampleIndex, field);
+        std::this_thread::yield();
+    }
+
+    pLastSampleIndex->store(pSnapshot->SampleIndex);
+}
+
+// The adapter callback runs before its sample is published, so once it has run for sample n, every sample before n
+// has been published, and logged.
+static void TelemetryTestWaitForSample(const std::atomic<uint64_t>& lastSampleIndex, uint64_t sampleIndex)
+{
+    while (lastSampleIndex.load() < sampleIndex)
+    {
+        std::this_thread::yield();
+    }
+}
+
+// Waits until the sampler stops starting new samples, which it does once it waits for the idle interval.
+static void TelemetryTestWaitUntilIdle(const std::atomic<uint64_t>& lastSampleIndex)
+{
+    for (;;)
+    {
+        uint64_t sampleIndex = lastSampleIndex.load();
+        std::this_thread::sleep_for(std::chrono::milliseconds(20));
+        if (lastSampleIndex.load() == sampleIndex)
+            return;
+    }
+}
+
+static bool TelemetryTestIsWhole(const TelemetrySnapshot& snapshot)
+{
+    return snapshot.AdapterLocalUsageBytes == TelemetryTestAdapterValue(snapshot.SampleIndex, 0) &&
+        snapshot.AdapterNonLocalUsageBytes == TelemetryTestAdapterValue(snapshot.SampleIndex, 1) &&
+        snapshot.AdapterLocalBudgetBytes == TelemetryTestAdapterValue(snapshot.SampleIndex, 2);
+}
+
+// With no interval the sampler publishes far more often than the reader looks. Every snapshot the reader gets is
+// whole, stays untouched until the reader asks again, and is the latest one published.
+static void TelemetryTestOutpacedReader()
+{
+    std::atomic<uint64_t> lastSampleIndex(0);
+    Telemetry* pTelemetry = TelemetryCreate(0.0, [&lastSampleIndex](TelemetrySnapshot* pSnapshot)
+    {
+        TelemetryTestSampleAdapter(pSnapshot, &lastSampleIndex);
+    });
+
+    // all zeroes until the first sample is published
+    while (TelemetryGetSnapshot(pTelemetry)->SampleIndex == 0 && TelemetryGetSnapshot(pTelemetry)->Seconds == 0.0)
+    {
+        std::this_thread::yield();
+    }
+
+    int numReads = 0, numTorn = 0, numChanged = 0, numNotLatest = 0;
+    uint64_t previousSampleIndex = 0;
+    std::chrono::steady_clock::time_point end = std::chrono::steady_clock::now() + std::chrono::milliseconds(300);
+    while (std::chrono::steady_clock::now() < end)
+    {
+        // at least two samples are published after the one read last, so the reader has to skip one to be up to date
+        if (numReads > 0)
+            TelemetryTestWaitForSample(lastSampleIndex, previousSampleIndex + 3);
+
+        const TelemetrySnapshot* pSnapshot = TelemetryGetSnapshot(pTelemetry);
+
+        TelemetrySnapshot copy;
+        memcpy(&copy, pSnapshot, sizeof(copy));
+        if (!TelemetryTestIsWhole(copy))
+            numTorn++;
+
+        // the sampler keeps publishing meanwhile, but never into the reader's slot
+        std::this_thread::sleep_for(std::chrono::milliseconds(1));
+        if (memcmp(&copy, pSnapshot, sizeof(copy)) != 0)
+            numChanged++;
+
+        if (numReads > 0 && copy.SampleIndex < previousSampleIndex + 2)
+            numNotLatest++;
+
+        previousSampleIndex = copy.SampleIndex;
+        numReads++;
+    }
+
+    TEST_CHECK(numReads > 0);
+    TEST_CHECK(numTorn == 0);
+    TEST_CHECK(numChanged == 0);
+    // the reader jumps to the latest sample instead of going through every one in order
+    TEST_CHECK(numNotLatest == 0);
+
+    TelemetryDestroy(pTelemetry);
+}
+
+// Whenever the sampler goes idle, the next read returns the sample it published last, and reading again without a
+// new sample returns the same snapshot.
+static void TelemetryTestLatest()
+{
+    std::atomic<uint64_t> lastSampleIndex(0);
+    Telemetry* pTelemetry = TelemetryCreate(0.0, [&lastSampleIndex](TelemetrySnapshot* pSnapshot)
+    {
+        TelemetryTestSampleAdapter(pSnapshot, &lastSampleIndex);
+    });
+
+    for (int round = 0; round < 10; round++)
+    {
+        // a burst of samples, which the reader only looks at now and then
+        for (int i = 0; i < round; i++)
+        {
+            TelemetryGetSnapshot(pTelemetry);
+            std::this_thread::sleep_for(std::chrono::milliseconds(1));
+        }
+
+        TelemetrySetInterval(pTelemetry, kTelemetryTestIdleInterval);
+        TelemetryTestWaitUntilIdle(lastSampleIndex);
+
+        const TelemetrySnapshot* pSnapshot = TelemetryGetSnapshot(pTelemetry);
+        TEST_CHECK(pSnapshot->SampleIndex == lastSampleIndex.load());
+        TEST_CHECK(TelemetryTestIsWhole(*pSnapshot));
+        TEST_CHECK(TelemetryGetSnapshot(pTelemetry) == pSnapshot);
+
+        TelemetrySetInterval(pTelemetry, 0.0);
+        std::this_thread::sleep_for(std::chrono::milliseconds(5));
+    }
+
+    TelemetryDestroy(pTelemetry);
+}
+
+static std::vector<std::string> TelemetryTestReadLines(const std::string& path)
+{
+    std::ifstream file(path);
+    std::vector<std::string> lines;
+    std::string line;
+    while (std::getline(file, line))
+    {
+        lines.push_back(line);
+    }
+    return lines;
+}
+
+static uint64_t TelemetryTestGetLogSampleIndex(const std::string& line)
+{
+    return strtoull(line.c_str(), NULL, 10);
+}
+
+// A new log gets the header, and logging to it again appends samples without another header.
+static void TelemetryTestLog(const std::string& directory)
+{
+    std::atomic<uint64_t> lastSampleIndex(0);
+    Telemetry* pTelemetry = TelemetryCreate(0.0, [&lastSampleIndex](TelemetrySnapshot* pSnapshot)
+    {
+        TelemetryTestSampleAdapter(pSnapshot, &lastSampleIndex);
+    });
+
+    std::string path = directory + "/telemetry.csv";
+    std::vector<size_t> numLines;
+    for (int run = 0; run < 2; run++)
+    {
+        TEST_CHECK(TelemetrySetLogPath(pTelemetry, path.c_str()));
+        TEST_CHECK(TelemetryIsLogging(pTelemetry));
+        TelemetryTestWaitForSample(lastSampleIndex, lastSampleIndex.load() + 3);
+        TEST_CHECK(TelemetrySetLogPath(pTelemetry, NULL));
+        TEST_CHECK(!TelemetryIsLogging(pTelemetry));
+        numLines.push_back(TelemetryTestReadLines(path).size());
+    }
+
+    std::vector<std::string> lines = TelemetryTestReadLines(path);
+    TEST_CHECK(numLines[0] >= 3);
+    TEST_CHECK(numLines[1] >= numLines[0] + 2);
+    TEST_CHECK(lines.size() == numLines[1]);
+    TEST_CHECK(!lines.empty() && lines[0].compare(0, 7, "sample,") == 0);
+
+    // every line after the header is a whole sample, and the samples of each run are consecutive
+    for (size_t i = 1; i < lines.size(); i++)
+    {
+        TEST_CHECK(lines[i].compare(0, 7, "sample,") != 0);
+        TEST_CHECK(std::count(lines[i].begin(), lines[i].end(), ',') == 8);
+        if (i > 1 && i != numLines[0])
+            TEST_CHECK(TelemetryTestGetLogSampleIndex(lines[i]) == TelemetryTestGetLogSampleIndex(lines[i - 1]) + 1);
+    }
+    if (numLines[1] > numLines[0] && numLines[0] >= 2)
+        TEST_CHECK(TelemetryTestGetLogSampleIndex(lines[numLines[0]]) > TelemetryTestGetLogSampleIndex(lines[numLines[0] - 1]));
+
+    TEST_CHECK(!TelemetrySetLogPath(pTelemetry, (directory + "/missing/telemetry.csv").c_str()));
+    TEST_CHECK(!TelemetryIsLogging(pTelemetry));
+
+    TelemetryDestroy(pTelemetry);
+}
+
+// The process's CPU time only grows, and it always has some memory resident.
+static void TelemetryTestQueryProcess()
+{
+    double cpuSeconds = -1.0;
+    uint64_t residentBytes = 0;
+    TEST_CHECK(TelemetryQueryProcess(&cpuSeconds, &residentBytes));
+    TEST_CHECK(cpuSeconds >= 0.0);
+    TEST_CHECK(residentBytes > 0);
+
+    // enough work for the CPU time to move on by at least a clock tick
+    volatile uint64_t sum = 0;
+    std::chrono::steady_clock::time_point end = std::chrono::steady_clock::now() + std::chrono::milliseconds(50);
+    while (std::chrono::steady_clock::now() < end)
+    {
+        for (int i = 0; i < 1000; i++)
+        {
+            sum = sum + i;
+        }
+    }
+
+    double laterCPUSeconds = -1.0;
+    TEST_CHECK(TelemetryQueryProcess(&laterCPUSeconds, &residentBytes));
+    TEST_CHECK(laterCPUSeconds > cpuSeconds);
+}
+
+int main()
+{
+    TelemetryTestOutpacedReader();
+    TelemetryTestLatest();
+    TelemetryTestLog(TestCreateTempDirectory("telemetry_test"));
+    TelemetryTestQueryProcess();
+    return TestReport("telemetry_test");
+}
\ No newline at end of file
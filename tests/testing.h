@@ -0,0 +1,67 @@
+#pragma once
+
+#include <string>
+#include <cstdio>
+#include <cstdlib>
+
+#ifdef _WIN32
+#define NOMINMAX
+#define WIN32_LEAN_AND_MEAN
+#include <Windows.h>
+#else
+#include <unistd.h>
+#endif
+
+// Checks for the tests of the modules that don't depend on D3D. Every test is its own executable, which runs its test
+// functions from main and returns TestReport(), so a failed check fails the test without stopping the others.
+
+inline int& TestGetNumFailures()
+{
+    static int numFailures = 0;
+    return numFailures;
+}
+
+#define TEST_CHECK(condition) \
+    do \
+    { \
+        if (!(condition)) \
+        { \
+            fprintf(stderr, "%s(%d): check failed: %s\n", __FILE__, __LINE__, #condition); \
+            TestGetNumFailures()++; \
+        } \
+    } while (0)
+
+inline int TestReport(const char* testName)
+{
+    int numFailures = TestGetNumFailures();
+    if (numFailures != 0)
+        printf("%s: %d checks failed\n", testName, numFailures);
+    else
+        printf("%s: passed\n", testName);
+    return numFailures != 0 ? 1 : 0;
+}
+
+// A new empty directory under the system's temporary directory, without a trailing slash.
+// The tests leave their files behind, so a failure can be looked at.
+inline std::string TestCreateTempDirectory(const char* prefix)
+{
+#ifdef _WIN32
+    char tempPath[MAX_PATH];
+    GetTempPathA(MAX_PATH, tempPath);
+    for (unsigned attempt = GetTickCount(); ; attempt++)
+    {
+        std::string path = std::string(tempPath) + prefix + "-" + std::to_string(attempt);
+        if (CreateDirectoryA(path.c_str(), NULL))
+            return path;
+    }
+#else
+    const char* tempDir = getenv("TMPDIR");
+    std::string pattern = std::string(tempDir ? tempDir : "/tmp") + "/" + prefix + "-XXXXXX";
+    if (!mkdtemp(&pattern[0]))
+    {
+        perror("mkdtemp");
+        exit(1);
+    }
+    return pattern;
+#endif
+}
\ No newline at end of file
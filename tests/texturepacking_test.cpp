@@ -0,0 +1,267 @@
+#include "testing.h"
+
+#include "texturepacking.h"
+
+#include <algorithm>
+#include <random>
+#include <tuple>
+#include <vector>
+#include <cmath>
+#include <cstdint>
+
+// The scene's settings.
+static TexturePackingDesc TexturePackingTestGetDesc()
+{
+    TexturePackingDesc desc;
+    desc.AtlasSize = 1024;
+    desc.MaxAtlasedSize = 512;
+    desc.Alignment = 64;
+    return desc;
+}
+
+// Textures of three formats: mostly small ones of any size, some of which can't be atlased because their UVs wrap, and
+// a few large ones. There are enough small ones to need several pages.
+static std::vector<TexturePackingInput> TexturePackingTestMakeInputs(unsigned seed)
+{
+    std::mt19937 rng(seed);
+    std::uniform_int_distribution<int> format(0, 2);
+    std::uniform_int_distribution<int> smallSide(1, 512);
+    std::uniform_int_distribution<int> percent(0, 99);
+
+    std::vector<TexturePackingInput> inputs;
+    for (int i = 0; i < 120; i++)
+    {
+        TexturePackingInput input;
+        input.Format = format(rng);
+        input.Width = smallSide(rng);
+        input.Height = smallSide(rng);
+        input.CanAtlas = percent(rng) < 80;
+        if (percent(rng) < 10)
+        {
+            input.Width = 1024 << (i % 2);
+            input.Height = input.Width;
+        }
+        inputs.push_back(input);
+    }
+    return inputs;
+}
+
+// Every input is in exactly the slice that its placement names, in an array of its format. Atlased inputs are on the
+// alignment grid inside their page, and their grid cells don't overlap, so their mips don't either.
+static void TexturePackingTestLayout(unsigned seed)
+{
+    TexturePackingDesc desc = TexturePackingTestGetDesc();
+    std::vector<TexturePackingInput> inputs = TexturePackingTestMakeInputs(seed);
+    TexturePacking packing;
+    TexturePackingPack(desc, inputs, &packing);
+
+    TEST_CHECK(packing.Placements.size() == inputs.size());
+
+    std::vector<int> numTimesPlaced(inputs.size(), 0);
+    int numMultiTexturePages = 0;
+    for (int arrayID = 0; arrayID < (int)packing.Arrays.size(); arrayID++)
+    {
+        const TexturePackingArray& array = packing.Arrays[arrayID];
+        if (arrayID > 0)
+        {
+            const TexturePackingArray& previous = packing.Arrays[arrayID - 1];
+            TEST_CHECK(std::make_tuple(previous.Format, previous.Width, previous.Height) < std::make_tuple(array.Format, array.Width, array.Height));
+        }
+
+        for (int slice = 0; slice < (int)array.SliceInputs.size(); slice++)
+        {
+            const std::vector<int>& sliceInputs = array.SliceInputs[slice];
+            TEST_CHECK(!sliceInputs.empty());
+            if (sliceInputs.size() > 1)
+                numMultiTexturePages++;
+
+            for (size_t i = 0; i < sliceInputs.size(); i++)
+            {
+                int inputIndex = sliceInputs[i];
+                const TexturePackingInput& input = inputs[inputIndex];
+                const TexturePackingPlacement& placement = packing.Placements[inputIndex];
+                numTimesPlaced[inputIndex]++;
+
+                TEST_CHECK(placement.ArrayID == arrayID && placement.Slice == slice);
+                TEST_CHECK(array.Format == input.Format);
+                TEST_CHECK(placement.Atlased == (sliceInputs.size() > 1));
+
+                if (!placement.Atlased)
+                {
+                    TEST_CHECK(array.Width == input.Width && array.Height == input.Height);
+                    TEST_CHECK(placement.X == 0 && placement.Y == 0);
+                    continue;
+                }
+
+                TEST_CHECK(input.CanAtlas && std::max(input.Width, input.Height) <= desc.MaxAtlasedSize);
+                TEST_CHECK(array.Width == desc.AtlasSize && array.Height == desc.AtlasSize);
+                TEST_CHECK(placement.X % desc.Alignment == 0 && placement.Y % desc.Alignment == 0);
+                TEST_CHECK(placement.X >= 0 && placement.X + input.Width <= array.Width);
+                TEST_CHECK(placement.Y >= 0 && placement.Y + input.Height <= array.Height);
+
+                // the cells of the grid that each texture starts in, rounded up to whole cells
+                for (size_t j = 0; j < i; j++)
+                {
+                    const TexturePackingInput& other = inputs[sliceInputs[j]];
+                    const TexturePackingPlacement& otherPlacement = packing.Placements[sliceInputs[j]];
+                    int right = placement.X + (input.Width + desc.Alignment - 1) / desc.Alignment * desc.Alignment;
+                    int bottom = placement.Y + (input.Height + desc.Alignment - 1) / desc.Alignment * desc.Alignment;
+                    int otherRight = otherPlacement.X + (other.Width + desc.Alignment - 1) / desc.Alignment * desc.Alignment;
+                    int otherBottom = otherPlacement.Y + (other.Height + desc.Alignment - 1) / desc.Alignment * desc.Alignment;
+                    bool overlap =
+                        placement.X < otherRight && otherPlacement.X < right &&
+                        placement.Y < otherBottom && otherPlacement.Y < bottom;
+                    TEST_CHECK(!overlap);
+                }
+            }
+        }
+    }
+
+    for (int count : numTimesPlaced)
+    {
+        TEST_CHECK(count == 1);
+    }
+
+    // more than one page of a format
+    TEST_CHECK(numMultiTexturePages > 3);
+}
+
+// A small texture that is alone in its format keeps a slice of its own.
+static void TexturePackingTestSingleSmallTexture()
+{
+    std::vector<TexturePackingInput> inputs(3);
+    for (TexturePackingInput& input : inputs)
+    {
+        input.Width = 128;
+        input.Height = 64;
+        input.CanAtlas = true;
+    }
+    inputs[0].Format = 0;
+    inputs[1].Format = 0;
+    inputs[2].Format = 1;
+
+    TexturePacking packing;
+    TexturePackingPack(TexturePackingTestGetDesc(), inputs, &packing);
+
+    TEST_CHECK(packing.Placements[0].Atlased && packing.Placements[1].Atlased);
+    TEST_CHECK(packing.Placements[0].ArrayID == packing.Placements[1].ArrayID);
+    TEST_CHECK(!packing.Placements[2].Atlased);
+    TEST_CHECK(packing.Arrays[packing.Placements[2].ArrayID].Width == 128);
+}
+
+// Each texel holds its input and its position, so a sampled texel tells where it came from.
+static uint32_t TexturePackingTestTexel(int inputIndex, int x, int y)
+{
+    return ((uint32_t)inputIndex << 20) | ((uint32_t)y << 10) | (uint32_t)x;
+}
+
+// Copies mip 0 and mip 1 of every texture into its slice, then samples the slices at the remapped UV of each texel.
+// The UV lands in the same texel of the slice, and at mip 0 on its center, so bilinear filtering doesn't reach the
+// neighbours. The texture's UVs go from the center of its first texel to the center of its last when it is atlased,
+// and cover the whole slice otherwise.
+static void TexturePackingTestRemapUV(unsigned seed)
+{
+    TexturePackingDesc desc = TexturePackingTestGetDesc();
+    std::vector<TexturePackingInput> inputs = TexturePackingTestMakeInputs(seed);
+    for (TexturePackingInput& input : inputs)
+    {
+        // keeps the slices small, and the positions fit in the texels
+        input.Width = std::min(input.Width, 512);
+        input.Height = std::min(input.Height, 512);
+    }
+
+    TexturePacking packing;
+    TexturePackingPack(desc, inputs, &packing);
+
+    for (int mip = 0; mip < 2; mip++)
+    {
+        std::vector<std::vector<std::vector<uint32_t>>> slices(packing.Arrays.size());
+        for (size_t arrayID = 0; arrayID < packing.Arrays.size(); arrayID++)
+        {
+            const TexturePackingArray& array = packing.Arrays[arrayID];
+            slices[arrayID].assign(array.SliceInputs.size(), std::vector<uint32_t>((size_t)std::max(array.Width >> mip, 1) * std::max(array.Height >> mip, 1), 0xFFFFFFFF));
+        }
+
+        for (int inputIndex = 0; inputIndex < (int)inputs.size(); inputIndex++)
+        {
+            const TexturePackingPlacement& placement = packing.Placements[inputIndex];
+            const TexturePackingArray& array = packing.Arrays[placement.ArrayID];
+            int width = std::max(inputs[inputIndex].Width >> mip, 1);
+            int height = std::max(inputs[inputIndex].Height >> mip, 1);
+
+            std::vector<uint32_t> texels((size_t)width * height);
+            for (int y = 0; y < height; y++)
+            {
+                for (int x = 0; x < width; x++)
+                {
+                    texels[(size_t)y * width + x] = TexturePackingTestTexel(inputIndex, x, y);
+                }
+            }
+
+            TexturePackingCopyMip(
+                placement, mip, (const uint8_t*)texels.data(), width, height, 4,
+                (uint8_t*)slices[placement.ArrayID][placement.Slice].data(), std::max(array.Width >> mip, 1), std::max(array.Height >> mip, 1));
+        }
+
+        int numWrongTexels = 0;
+        int numOffCenter = 0;
+        for (int inputIndex = 0; inputIndex < (int)inputs.size(); inputIndex++)
+        {
+            const TexturePackingPlacement& placement = packing.Placements[inputIndex];
+            const TexturePackingArray& array = packing.Arrays[placement.ArrayID];
+            const std::vector<uint32_t>& slice = slices[placement.ArrayID][placement.Slice];
+            int sliceWidth = std::max(array.Width >> mip, 1);
+            int sliceHeight = std::max(array.Height >> mip, 1);
+
+            int width0 = inputs[inputIndex].Width;
+            int height0 = inputs[inputIndex].Height;
+            int width = std::max(inputs[inputIndex].Width >> mip, 1);
+            int height = std::max(inputs[inputIndex].Height >> mip, 1);
+            for (int y = 0; y < height; y++)
+            {
+                for (int x = 0; x < width; x++)
+                {
+                    float uv[2];
+                    if (placement.Atlased)
+                    {
+                        // the UV of the mip 0 texel that the texel starts at
+                        uv[0] = width0 > 1 ? (x << mip) / (float)(width0 - 1) : 0.0f;
+                        uv[1] = height0 > 1 ? (y << mip) / (float)(height0 - 1) : 0.0f;
+                    }
+                    else
+                    {
+                        uv[0] = (x + 0.5f) / width;
+                        uv[1] = (y + 0.5f) / height;
+                    }
+
+                    float remapped[2];
+                    TexturePackingRemapUV(placement, uv, remapped);
+                    float sliceX = remapped[0] * sliceWidth;
+                    float sliceY = remapped[1] * sliceHeight;
+                    // an atlased texture has one UV transform for every mip, which is centered on the texels of mip 0
+                    bool centered = std::abs(sliceX - std::floor(sliceX) - 0.5f) < 1e-2f && std::abs(sliceY - std::floor(sliceY) - 0.5f) < 1e-2f;
+                    if (!centered && (mip == 0 || !placement.Atlased))
+                        numOffCenter++;
+
+                    int texelX = std::min((int)sliceX, sliceWidth - 1);
+                    int texelY = std::min((int)sliceY, sliceHeight - 1);
+                    if (slice[(size_t)texelY * sliceWidth + texelX] != TexturePackingTestTexel(inputIndex, x, y))
+                        numWrongTexels++;
+                }
+            }
+        }
+        TEST_CHECK(numWrongTexels == 0);
+        TEST_CHECK(numOffCenter == 0);
+    }
+}
+
+int main()
+{
+    for (unsigned seed = 1; seed <= 3; seed++)
+    {
+        TexturePackingTestLayout(seed);
+        TexturePackingTestRemapUV(seed);
+    }
+    TexturePackingTestSingleSmallTexture();
+    return TestReport("texturepacking_test");
+}
\ No newline at end of file
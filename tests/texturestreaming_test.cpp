@@ -0,0 +1,332 @@
+#include "testing.h"
+
+#include "texturestreaming.h"
+#include "camerapath.h"
+
+#include <algorithm>
+#include <vector>
+#include <cmath>
+#include <cstdint>
+
+// The app's streaming settings, a 1080p viewport with its 90 degree vertical field of view, and its replay step.
+static const uint64_t kTextureStreamingTestBudgetBytes = 64ull << 20;
+static const int kTextureStreamingTestMinResidentSize = 64;
+static const float kTextureStreamingTestAspectWbyH = 16.0f / 9.0f;
+static const float kTextureStreamingTestPixelsPerUnitAtUnitDistance = 1080.0f / (2.0f * 1.0f); // tan(45 degrees) is 1
+static const float kTextureStreamingTestStepSeconds = 1.0f / 60.0f;
+
+// A walk through the courtyard of TextureStreamingTestBuildScene: down the middle, along the arcade on one side close
+// enough to need the finest mips, across to the other arcade and back along it, then a look up at the upper walls.
+static const char* kTextureStreamingTestCameraPath = SILVERWINNER_TEST_DATA_DIR "/courtyard.path";
+
+struct TextureStreamingTestMesh
+{
+    float BoundsMin[3];
+    float BoundsMax[3];
+    float UVDensity;
+    int TextureIDs[3]; // diffuse, specular, bump, or -1
+};
+
+struct TextureStreamingTestScene
+{
+    std::vector<TextureStreamingTestMesh> Meshes;
+};
+
+static void TextureStreamingTestAddMesh(
+    TextureStreamingTestScene* pScene,
+    float minX, float minY, float minZ, float maxX, float maxY, float maxZ,
+    float uvDensity, const int textureIDs[3])
+{
+    TextureStreamingTestMesh mesh;
+    mesh.BoundsMin[0] = minX; mesh.BoundsMin[1] = minY; mesh.BoundsMin[2] = minZ;
+    mesh.BoundsMax[0] = maxX; mesh.BoundsMax[1] = maxY; mesh.BoundsMax[2] = maxZ;
+    mesh.UVDensity = uvDensity;
+    std::copy(textureIDs, textureIDs + 3, mesh.TextureIDs);
+    pScene->Meshes.push_back(mesh);
+}
+
+// A courtyard shaped like the scene's, with its texture sizes: a floor, two arcades of ten bays that cycle through five
+// materials, upper walls with three more, columns and banners. Every texture is a slice of its own array.
+static void TextureStreamingTestBuildScene(TextureStreaming* pStreaming, TextureStreamingTestScene* pScene)
+{
+    struct MaterialTextures
+    {
+        int IDs[3];
+    };
+
+    auto addMaterial = [pStreaming](int size, bool hasSpecular)
+    {
+        MaterialTextures material;
+        material.IDs[0] = TextureStreamingAddTexture(pStreaming, size, size, 4);
+        material.IDs[1] = hasSpecular ? TextureStreamingAddTexture(pStreaming, size, size, 1) : -1;
+        material.IDs[2] = TextureStreamingAddTexture(pStreaming, size, size, 2);
+        return material;
+    };
+
+    MaterialTextures floor = addMaterial(2048, true);
+    MaterialTextures arcades[5];
+    for (MaterialTextures& arcade : arcades)
+    {
+        arcade = addMaterial(1024, true);
+    }
+    MaterialTextures upperWalls[3];
+    for (MaterialTextures& upperWall : upperWalls)
+    {
+        upperWall = addMaterial(1024, true);
+    }
+    MaterialTextures column = addMaterial(512, true);
+    MaterialTextures banners[2] = { addMaterial(1024, false), addMaterial(1024, false) };
+
+    TextureStreamingTestAddMesh(pScene, -1500.0f, -10.0f, -500.0f, 1500.0f, 0.0f, 500.0f, 1.0f / 300.0f, floor.IDs);
+
+    for (float side = -1.0f; side <= 1.0f; side += 2.0f)
+    {
+        float wallZ0 = side > 0.0f ? 400.0f : -500.0f;
+        float wallZ1 = wallZ0 + 100.0f;
+
+        for (int bay = 0; bay < 10; bay++)
+        {
+            float x0 = -1500.0f + 300.0f * bay;
+            TextureStreamingTestAddMesh(pScene, x0, 0.0f, wallZ0, x0 + 300.0f, 800.0f, wallZ1, 1.0f / 200.0f, arcades[bay % 5].IDs);
+        }
+
+        for (int wall = 0; wall < 5; wall++)
+        {
+            float x0 = -1500.0f + 600.0f * wall;
+            TextureStreamingTestAddMesh(pScene, x0, 800.0f, wallZ0, x0 + 600.0f, 1400.0f, wallZ1, 1.0f / 200.0f, upperWalls[wall % 3].IDs);
+        }
+
+        for (int columnIndex = 0; columnIndex <= 10; columnIndex++)
+        {
+            float x = -1500.0f + 300.0f * columnIndex;
+            float z = side * 400.0f;
+            TextureStreamingTestAddMesh(pScene, x - 20.0f, 0.0f, z - 20.0f, x + 20.0f, 800.0f, z + 20.0f, 1.0f / 100.0f, column.IDs);
+        }
+
+        for (int banner = 0; banner < 2; banner++)
+        {
+            float x0 = -1500.0f + 300.0f * (banner * 5 + 2) + 50.0f;
+            float z = side * 385.0f;
+            TextureStreamingTestAddMesh(pScene, x0, 300.0f, z - 2.0f, x0 + 200.0f, 750.0f, z + 2.0f, 1.0f / 200.0f, banners[banner].IDs);
+        }
+    }
+}
+
+static void TextureStreamingTestCross(const float a[3], const float b[3], float pResult[3])
+{
+    pResult[0] = a[1] * b[2] - a[2] * b[1];
+    pResult[1] = a[2] * b[0] - a[0] * b[2];
+    pResult[2] = a[0] * b[1] - a[1] * b[0];
+}
+
+static void TextureStreamingTestNormalize(float v[3])
+{
+    float length = std::sqrt(v[0] * v[0] + v[1] * v[1] + v[2] * v[2]);
+    for (int i = 0; i < 3; i++)
+    {
+        v[i] /= length;
+    }
+}
+
+// Frustum culls the bounds against the side planes of the view, and requests the mips that the textures of the
+// visible meshes need at the distance to their bounds, like the scene does.
+static void TextureStreamingTestRequestMips(
+    TextureStreaming* pStreaming, const TextureStreamingTestScene& scene,
+    const float cameraPos[3], const float cameraLook[3])
+{
+    float worldUp[3] = { 0.0f, 1.0f, 0.0f };
+    float forward[3] = { cameraLook[0], cameraLook[1], cameraLook[2] };
+    TextureStreamingTestNormalize(forward);
+    float right[3];
+    TextureStreamingTestCross(worldUp, forward, right);
+    TextureStreamingTestNormalize(right);
+    float up[3];
+    TextureStreamingTestCross(forward, right, up);
+
+    // inward normals of the right, left, top and bottom planes, which go through the camera
+    float tanHalfFovY = 1.0f;
+    float tanHalfFovX = tanHalfFovY * kTextureStreamingTestAspectWbyH;
+    float planes[4][3];
+    for (int i = 0; i < 3; i++)
+    {
+        planes[0][i] = forward[i] * tanHalfFovX - right[i];
+        planes[1][i] = forward[i] * tanHalfFovX + right[i];
+        planes[2][i] = forward[i] * tanHalfFovY - up[i];
+        planes[3][i] = forward[i] * tanHalfFovY + up[i];
+    }
+
+    for (const TextureStreamingTestMesh& mesh : scene.Meshes)
+    {
+        bool visible = true;
+        for (const float* plane : planes)
+        {
+            // the corner furthest along the normal
+            float dot = 0.0f;
+            for (int i = 0; i < 3; i++)
+            {
+                float corner = plane[i] >= 0.0f ? mesh.BoundsMax[i] : mesh.BoundsMin[i];
+                dot += plane[i] * (corner - cameraPos[i]);
+            }
+            visible = visible && dot >= 0.0f;
+        }
+        if (!visible)
+            continue;
+
+        float outside[3];
+        for (int i = 0; i < 3; i++)
+        {
+            outside[i] = std::max(std::max(mesh.BoundsMin[i] - cameraPos[i], cameraPos[i] - mesh.BoundsMax[i]), 0.0f);
+        }
+        float distance = std::sqrt(outside[0] * outside[0] + outside[1] * outside[1] + outside[2] * outside[2]);
+
+        for (int textureID : mesh.TextureIDs)
+        {
+            if (textureID == -1)
+                continue;
+
+            int mip = TextureStreamingEstimateMip(pStreaming->Textures[textureID], mesh.UVDensity, distance, kTextureStreamingTestPixelsPerUnitAtUnitDistance);
+            TextureStreamingRequestMip(pStreaming, textureID, mip);
+        }
+    }
+}
+
+// One frame of the app's streaming: the loads started by the previous frame finish, then the textures that are seen
+// from the camera request their mips and the budget policy runs.
+static void TextureStreamingTestStepFrame(
+    TextureStreaming* pStreaming, const TextureStreamingTestScene& scene,
+    const float cameraPos[3], const float cameraLook[3],
+    std::vector<TextureStreamingMipChange>* pEvictions, std::vector<TextureStreamingMipChange>* pLoads)
+{
+    for (const TextureStreamingMipChange& load : *pLoads)
+    {
+        TextureStreamingFinishLoad(pStreaming, load.TextureID, true);
+    }
+
+    TextureStreamingBeginFrame(pStreaming);
+    TextureStreamingTestRequestMips(pStreaming, scene, cameraPos, cameraLook);
+
+    pEvictions->clear();
+    pLoads->clear();
+    TextureStreamingUpdate(pStreaming, pEvictions, pLoads);
+}
+
+// The bytes that the mips requested this frame take, with the textures that weren't used at their resident minimum.
+static uint64_t TextureStreamingTestGetRequiredSize(const TextureStreaming& streaming)
+{
+    uint64_t bytes = 0;
+    for (const TextureStreamingTexture& texture : streaming.Textures)
+    {
+        bytes += TextureStreamingGetMipChainSize(texture, std::min(texture.RequiredMip, texture.MinResidentMip));
+    }
+    return bytes;
+}
+
+// Returns the peak resident size over the path.
+static uint64_t TextureStreamingTestReplay(const CameraPath& path, uint64_t budgetBytes)
+{
+    TextureStreaming streaming;
+    TextureStreamingInit(&streaming, budgetBytes, kTextureStreamingTestMinResidentSize);
+    TextureStreamingTestScene scene;
+    TextureStreamingTestBuildScene(&streaming, &scene);
+
+    std::vector<TextureStreamingMipChange> evictions;
+    std::vector<TextureStreamingMipChange> loads;
+    uint64_t peakResidentBytes = 0;
+    int numFramesOverBudget = 0;
+
+    int numFrames = CameraPathGetNumFrames(path, kTextureStreamingTestStepSeconds);
+    for (int frame = 0; frame < numFrames; frame++)
+    {
+        float cameraPos[3], cameraLook[3];
+        CameraPathSample(path, frame * kTextureStreamingTestStepSeconds, cameraPos, cameraLook);
+        TextureStreamingTestStepFrame(&streaming, scene, cameraPos, cameraLook, &evictions, &loads);
+
+        uint64_t residentBytes = TextureStreamingGetResidentSize(streaming);
+        peakResidentBytes = std::max(peakResidentBytes, residentBytes);
+        if (residentBytes > budgetBytes)
+            numFramesOverBudget++;
+    }
+
+    TEST_CHECK(numFramesOverBudget == 0);
+    TEST_CHECK(streaming.NumLoads != 0);
+    return peakResidentBytes;
+}
+
+// The resident mips, including the ones still loading, stay within the budget on every frame of the path, and the
+// budget is what keeps them there: without it the same path peaks above it.
+static void TextureStreamingTestBudgetOnPath(const CameraPath& path)
+{
+    TEST_CHECK(TextureStreamingTestReplay(path, UINT64_MAX) > kTextureStreamingTestBudgetBytes);
+    TEST_CHECK(TextureStreamingTestReplay(path, kTextureStreamingTestBudgetBytes) <= kTextureStreamingTestBudgetBytes);
+}
+
+// Stopping the camera anywhere on the path settles the streaming within a couple of frames: nothing more is loaded or
+// evicted, and if the requested mips fit in the budget, every used texture has its requested mip resident.
+static void TextureStreamingTestConvergesOnPath(const CameraPath& path)
+{
+    TextureStreaming streaming;
+    TextureStreamingInit(&streaming, kTextureStreamingTestBudgetBytes, kTextureStreamingTestMinResidentSize);
+    TextureStreamingTestScene scene;
+    TextureStreamingTestBuildScene(&streaming, &scene);
+
+    std::vector<TextureStreamingMipChange> evictions;
+    std::vector<TextureStreamingMipChange> loads;
+    const int kNumHoldFrames = 30;
+    const float kStopIntervalSeconds = 2.5f;
+    int numStopsWithinBudget = 0;
+    int numStops = 0;
+
+    float nextStopSeconds = 0.0f;
+    int numFrames = CameraPathGetNumFrames(path, kTextureStreamingTestStepSeconds);
+    for (int frame = 0; frame < numFrames; frame++)
+    {
+        float seconds = frame * kTextureStreamingTestStepSeconds;
+        float cameraPos[3], cameraLook[3];
+        CameraPathSample(path, seconds, cameraPos, cameraLook);
+        TextureStreamingTestStepFrame(&streaming, scene, cameraPos, cameraLook, &evictions, &loads);
+
+        if (seconds < nextStopSeconds && frame != numFrames - 1)
+            continue;
+        nextStopSeconds += kStopIntervalSeconds;
+        numStops++;
+
+        for (int holdFrame = 0; holdFrame < kNumHoldFrames; holdFrame++)
+        {
+            TextureStreamingTestStepFrame(&streaming, scene, cameraPos, cameraLook, &evictions, &loads);
+        }
+
+        uint64_t numLoads = streaming.NumLoads;
+        uint64_t numEvictions = streaming.NumEvictions;
+        TextureStreamingTestStepFrame(&streaming, scene, cameraPos, cameraLook, &evictions, &loads);
+        TEST_CHECK(streaming.NumLoads == numLoads);
+        TEST_CHECK(streaming.NumEvictions == numEvictions);
+        TEST_CHECK(TextureStreamingGetResidentSize(streaming) <= kTextureStreamingTestBudgetBytes);
+
+        if (TextureStreamingTestGetRequiredSize(streaming) > kTextureStreamingTestBudgetBytes)
+            continue;
+        numStopsWithinBudget++;
+
+        int numUnresolved = 0;
+        for (const TextureStreamingTexture& texture : streaming.Textures)
+        {
+            if (texture.LastUsedFrame == streaming.Frame && (texture.PendingMip != -1 || texture.ResidentMip > texture.RequiredMip))
+                numUnresolved++;
+        }
+        TEST_CHECK(numUnresolved == 0);
+    }
+
+    TEST_CHECK(numStops >= 10);
+    TEST_CHECK(numStopsWithinBudget >= numStops / 2);
+}
+
+int main()
+{
+    CameraPath path;
+    TEST_CHECK(CameraPathLoad(kTextureStreamingTestCameraPath, &path) && !path.Keys.empty());
+    if (path.Keys.empty())
+        return TestReport("texturestreaming_test");
+
+    TextureStreamingTestBudgetOnPath(path);
+    TextureStreamingTestConvergesOnPath(path);
+    return TestReport("texturestreaming_test");
+}
\ No newline at end of file
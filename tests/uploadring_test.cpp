@@ -0,0 +1,201 @@
+#include "testing.h"
+
+#include "uploadring.h"
+
+#include <random>
+#include <vector>
+
+static void UploadRingTestAppend()
+{
+    UploadRing ring;
+    UploadRingReset(&ring, 100);
+    TEST_CHECK(UploadRingGetFreeSize(ring) == 100);
+
+    uint64_t offset = 99;
+    TEST_CHECK(UploadRingAllocate(&ring, 30, &offset) && offset == 0);
+    TEST_CHECK(UploadRingAllocate(&ring, 30, &offset) && offset == 30);
+    TEST_CHECK(UploadRingAllocate(&ring, 0, &offset) && offset == 60);
+    TEST_CHECK(UploadRingGetFreeSize(ring) == 40);
+}
+
+// An allocation that doesn't fit before the end of the ring starts over at 0, and the space it skipped stays in use
+// until the frame that skipped it is retired.
+static void UploadRingTestWrapAround()
+{
+    UploadRing ring;
+    UploadRingReset(&ring, 100);
+
+    uint64_t offset;
+    TEST_CHECK(UploadRingAllocate(&ring, 60, &offset) && offset == 0);
+    UploadRingEndFrame(&ring, 0);
+    TEST_CHECK(UploadRingAllocate(&ring, 30, &offset) && offset == 60);
+    UploadRingEndFrame(&ring, 1);
+    UploadRingRetireFrames(&ring, 1);
+    TEST_CHECK(UploadRingGetFreeSize(ring) == 70);
+
+    // 10 are left at the end, so 20 go to the start and the 10 are skipped
+    TEST_CHECK(UploadRingAllocate(&ring, 20, &offset) && offset == 0);
+    TEST_CHECK(UploadRingGetFreeSize(ring) == 40);
+    UploadRingEndFrame(&ring, 2);
+
+    // the frame at the end is retired, but the skipped space belongs to the frame that wrapped
+    UploadRingRetireFrames(&ring, 2);
+    TEST_CHECK(UploadRingGetFreeSize(ring) == 70);
+    TEST_CHECK(!UploadRingAllocate(&ring, 71, &offset));
+    TEST_CHECK(UploadRingAllocate(&ring, 70, &offset) && offset == 20);
+    TEST_CHECK(UploadRingGetFreeSize(ring) == 0);
+
+    // an allocation that exactly reaches the end doesn't skip anything
+    UploadRingReset(&ring, 100);
+    TEST_CHECK(UploadRingAllocate(&ring, 40, &offset) && offset == 0);
+    TEST_CHECK(UploadRingAllocate(&ring, 60, &offset) && offset == 40);
+    TEST_CHECK(UploadRingGetFreeSize(ring) == 0);
+}
+
+// Sizes and offsets are in elements, so allocations are always element aligned. They are also contiguous, so one
+// never wraps around the end, even when the free space in total would be enough.
+static void UploadRingTestContiguous()
+{
+    UploadRing ring;
+    UploadRingReset(&ring, 100);
+
+    uint64_t offset;
+    TEST_CHECK(UploadRingAllocate(&ring, 60, &offset) && offset == 0);
+    UploadRingEndFrame(&ring, 0);
+    TEST_CHECK(UploadRingAllocate(&ring, 30, &offset) && offset == 60);
+    UploadRingEndFrame(&ring, 1);
+    UploadRingRetireFrames(&ring, 1);
+
+    // 70 are free, 10 at the end and 60 at the start
+    TEST_CHECK(UploadRingGetFreeSize(ring) == 70);
+    offset = 99;
+    TEST_CHECK(!UploadRingAllocate(&ring, 65, &offset) && offset == 99);
+    TEST_CHECK(UploadRingGetFreeSize(ring) == 70);
+    TEST_CHECK(UploadRingAllocate(&ring, 60, &offset) && offset == 0);
+}
+
+// Space that a frame in flight may still be reading is never handed out, and a failed allocation changes nothing.
+static void UploadRingTestInFlight()
+{
+    UploadRing ring;
+    UploadRingReset(&ring, 100);
+
+    uint64_t offset;
+    for (uint64_t frameIndex = 0; frameIndex < 4; frameIndex++)
+    {
+        TEST_CHECK(UploadRingAllocate(&ring, 25, &offset) && offset == frameIndex * 25);
+        UploadRingEndFrame(&ring, frameIndex);
+    }
+
+    TEST_CHECK(!UploadRingAllocate(&ring, 1, &offset));
+
+    // retiring nothing, or only frames that were never ended, frees nothing
+    UploadRingRetireFrames(&ring, 0);
+    TEST_CHECK(!UploadRingAllocate(&ring, 1, &offset));
+
+    UploadRingRetireFrames(&ring, 1);
+    TEST_CHECK(UploadRingGetFreeSize(ring) == 25);
+    TEST_CHECK(!UploadRingAllocate(&ring, 26, &offset));
+    TEST_CHECK(UploadRingAllocate(&ring, 25, &offset) && offset == 0);
+    TEST_CHECK(!UploadRingAllocate(&ring, 1, &offset));
+    UploadRingEndFrame(&ring, 4);
+
+    UploadRingRetireFrames(&ring, 100);
+    TEST_CHECK(ring.Frames.empty());
+    TEST_CHECK(UploadRingGetFreeSize(ring) == 100);
+}
+
+// Allocations larger than the ring always fail, which is what makes the caller grow it.
+static void UploadRingTestTooLarge()
+{
+    UploadRing ring;
+    UploadRingReset(&ring, 0);
+
+    uint64_t offset;
+    TEST_CHECK(!UploadRingAllocate(&ring, 1, &offset));
+
+    UploadRingReset(&ring, 100);
+    TEST_CHECK(!UploadRingAllocate(&ring, 101, &offset));
+    TEST_CHECK(UploadRingGetFreeSize(ring) == 100);
+    TEST_CHECK(UploadRingAllocate(&ring, 100, &offset) && offset == 0);
+
+    TEST_CHECK(UploadRingGetGrownSize(0, 5) == 8);
+    TEST_CHECK(UploadRingGetGrownSize(100, 101) == 200);
+    TEST_CHECK(UploadRingGetGrownSize(100, 50) == 200);
+    TEST_CHECK(UploadRingGetGrownSize(100, 450) == 800);
+}
+
+// Frames of random sizes with the GPU a random number of frames behind. Every element remembers the frame that
+// allocated it, and no allocation may take an element whose frame the GPU hasn't finished.
+static void UploadRingTestRandomFrames()
+{
+    const uint64_t kRingSize = 1000;
+    const uint64_t kNoFrame = ~0ull;
+
+    std::mt19937 rng(1234);
+    std::uniform_int_distribution<int> allocationSize(0, 120);
+    std::uniform_int_distribution<int> numAllocations(0, 6);
+    std::uniform_int_distribution<int> framesInFlight(0, 3);
+
+    UploadRing ring;
+    UploadRingReset(&ring, kRingSize);
+    std::vector<uint64_t> elementFrames(kRingSize, kNoFrame);
+
+    int numOverwrites = 0, numOutOfBounds = 0, numAllocated = 0, numRefused = 0;
+    uint64_t numFramesCompleted = 0;
+    for (uint64_t frameIndex = 0; frameIndex < 10000; frameIndex++)
+    {
+        // the GPU finished every frame up to a few behind this one
+        uint64_t lag = (uint64_t)framesInFlight(rng);
+        if (frameIndex > lag && frameIndex - lag > numFramesCompleted)
+            numFramesCompleted = frameIndex - lag;
+        UploadRingRetireFrames(&ring, numFramesCompleted);
+
+        for (int allocation = numAllocations(rng); allocation > 0; allocation--)
+        {
+            uint64_t size = (uint64_t)allocationSize(rng);
+            uint64_t freeSize = UploadRingGetFreeSize(ring);
+
+            uint64_t offset;
+            if (!UploadRingAllocate(&ring, size, &offset))
+            {
+                TEST_CHECK(UploadRingGetFreeSize(ring) == freeSize);
+                numRefused++;
+                continue;
+            }
+            numAllocated++;
+
+            if (offset + size > kRingSize)
+            {
+                numOutOfBounds++;
+                continue;
+            }
+
+            for (uint64_t element = offset; element < offset + size; element++)
+            {
+                if (elementFrames[element] != kNoFrame && elementFrames[element] >= numFramesCompleted && elementFrames[element] != frameIndex)
+                    numOverwrites++;
+                elementFrames[element] = frameIndex;
+            }
+        }
+
+        UploadRingEndFrame(&ring, frameIndex);
+    }
+
+    TEST_CHECK(numOverwrites == 0);
+    TEST_CHECK(numOutOfBounds == 0);
+
+    // the sizes are picked so that the ring fills up now and then
+    TEST_CHECK(numAllocated > 0 && numRefused > 0);
+}
+
+int main()
+{
+    UploadRingTestAppend();
+    UploadRingTestWrapAround();
+    UploadRingTestContiguous();
+    UploadRingTestInFlight();
+    UploadRingTestTooLarge();
+    UploadRingTestRandomFrames();
+    return TestReport("uploadring_test");
+}
\ No newline at end of file
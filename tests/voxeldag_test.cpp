@@ -0,0 +1,309 @@
+#include "testing.h"
+
+#include "voxeldag.h"
+
+#include <algorithm>
+#include <cmath>
+#include <cstring>
+#include <random>
+#include <vector>
+
+using namespace DirectX;
+
+static VoxelizerTriangle VoxelDAGTestMakeTriangle(const XMFLOAT3& p0, const XMFLOAT3& p1, const XMFLOAT3& p2)
+{
+    VoxelizerTriangle triangle = {};
+    triangle.Positions[0] = p0;
+    triangle.Positions[1] = p1;
+    triangle.Positions[2] = p2;
+    triangle.Albedo = XMFLOAT3(1.0f, 1.0f, 1.0f);
+    triangle.pAlbedoTexture = NULL;
+    return triangle;
+}
+
+// The same small triangle in every other leaf along a line, so identical subtrees get merged, and a few large random
+// triangles that stick out of the grid.
+static void VoxelDAGTestMakeScene(int gridSize, uint32_t seed, std::vector<VoxelizerTriangle>* pTriangles, VoxelGridDesc* pGrid)
+{
+    pGrid->Origin = XMFLOAT3(-2.0f, 0.5f, 3.0f);
+    pGrid->VoxelSize = 0.5f;
+    pGrid->Size = gridSize;
+
+    pTriangles->clear();
+    for (int leaf = 0; leaf < gridSize / kVoxelDAGLeafSize; leaf += 2)
+    {
+        float x = pGrid->Origin.x + (leaf * kVoxelDAGLeafSize + 0.6f) * pGrid->VoxelSize;
+        float y = pGrid->Origin.y + 4.6f * pGrid->VoxelSize;
+        float z = pGrid->Origin.z + 8.6f * pGrid->VoxelSize;
+        pTriangles->push_back(VoxelDAGTestMakeTriangle(XMFLOAT3(x, y, z), XMFLOAT3(x + 1.0f, y, z + 0.3f), XMFLOAT3(x, y + 1.2f, z + 0.9f)));
+    }
+
+    std::mt19937 rng(seed);
+    float extent = gridSize * pGrid->VoxelSize;
+    std::uniform_real_distribution<float> coordinate(-0.1f * extent, 1.1f * extent);
+    for (int i = 0; i < 12; i++)
+    {
+        XMFLOAT3 p[3];
+        for (XMFLOAT3& point : p)
+            point = XMFLOAT3(pGrid->Origin.x + coordinate(rng), pGrid->Origin.y + coordinate(rng), pGrid->Origin.z + coordinate(rng));
+        pTriangles->push_back(VoxelDAGTestMakeTriangle(p[0], p[1], p[2]));
+    }
+}
+
+// Every voxel of the DAG is occupied exactly when the dense voxelizer's is, and the repeated triangles are merged.
+static void VoxelDAGTestMatchesVoxelizer(int gridSize)
+{
+    std::vector<VoxelizerTriangle> triangles;
+    VoxelGridDesc grid;
+    VoxelDAGTestMakeScene(gridSize, 1, &triangles, &grid);
+
+    std::vector<uint32_t> voxels((size_t)gridSize * gridSize * gridSize);
+    uint64_t numOccupied = VoxelizeTriangles(triangles, grid, voxels.data());
+
+    VoxelDAG dag;
+    VoxelDAGStats stats;
+    VoxelDAGBuild(triangles, grid, 2, &dag, &stats);
+
+    TEST_CHECK(stats.NumOccupiedVoxels == numOccupied);
+    TEST_CHECK(stats.NumDAGNodes < stats.NumOctreeNodes);
+
+    uint64_t numMismatches = 0;
+    for (int z = 0; z < gridSize; z++)
+    {
+        for (int y = 0; y < gridSize; y++)
+        {
+            for (int x = 0; x < gridSize; x++)
+            {
+                bool occupied = voxels[((size_t)z * gridSize + y) * gridSize + x] != 0;
+                if (VoxelDAGIsOccupied(dag, x, y, z) != occupied)
+                    numMismatches++;
+            }
+        }
+    }
+    TEST_CHECK(numMismatches == 0);
+
+    TEST_CHECK(!VoxelDAGIsOccupied(dag, -1, 0, 0));
+    TEST_CHECK(!VoxelDAGIsOccupied(dag, 0, gridSize, 0));
+}
+
+// Rays from outside the volume towards points inside it hit the same voxel as the nearest occupied voxel of the
+// dense volume whose box the ray enters within maxT.
+static void VoxelDAGTestRaycast(int gridSize)
+{
+    std::vector<VoxelizerTriangle> triangles;
+    VoxelGridDesc grid;
+    VoxelDAGTestMakeScene(gridSize, 2, &triangles, &grid);
+
+    std::vector<uint32_t> voxels((size_t)gridSize * gridSize * gridSize);
+    VoxelizeTriangles(triangles, grid, voxels.data());
+
+    std::vector<XMINT3> occupied;
+    for (int z = 0; z < gridSize; z++)
+    {
+        for (int y = 0; y < gridSize; y++)
+        {
+            for (int x = 0; x < gridSize; x++)
+            {
+                if (voxels[((size_t)z * gridSize + y) * gridSize + x] != 0)
+                    occupied.push_back(XMINT3(x, y, z));
+            }
+        }
+    }
+
+    VoxelDAG dag;
+    VoxelDAGBuild(triangles, grid, 1, &dag);
+
+    std::mt19937 rng(3);
+    std::uniform_real_distribution<float> outside(-0.5f * gridSize, 1.5f * gridSize);
+    std::uniform_real_distribution<float> inside(0.0f, (float)gridSize);
+
+    int numHits = 0;
+    int numMisses = 0;
+    int numMismatches = 0;
+    for (int ray = 0; ray < 300; ray++)
+    {
+        float origin[3] = { outside(rng), outside(rng), outside(rng) };
+        float target[3] = { inside(rng), inside(rng), inside(rng) };
+        float direction[3];
+        float length = 0.0f;
+        for (int c = 0; c < 3; c++)
+        {
+            direction[c] = target[c] - origin[c];
+            length += direction[c] * direction[c];
+        }
+        length = std::sqrt(length);
+        for (float& d : direction)
+            d /= length;
+
+        // half of the rays stop before they get through the volume
+        float maxT = (ray % 2) ? 1e30f : length;
+
+        bool referenceHit = false;
+        float referenceT = maxT;
+        for (const XMINT3& voxel : occupied)
+        {
+            const int* voxelMin = &voxel.x;
+            float tEnter = 0.0f, tExit = maxT;
+            for (int c = 0; c < 3; c++)
+            {
+                float t0 = (voxelMin[c] - origin[c]) / direction[c];
+                float t1 = (voxelMin[c] + 1 - origin[c]) / direction[c];
+                tEnter = std::max(tEnter, std::min(t0, t1));
+                tExit = std::min(tExit, std::max(t0, t1));
+            }
+            if (tEnter <= tExit && (!referenceHit || tEnter < referenceT))
+            {
+                referenceHit = true;
+                referenceT = tEnter;
+            }
+        }
+
+        float hitT = -1.0f;
+        bool hit = VoxelDAGRaycast(dag, XMFLOAT3(origin[0], origin[1], origin[2]), XMFLOAT3(direction[0], direction[1], direction[2]), maxT, &hitT);
+        if (hit != referenceHit || (hit && std::abs(hitT - referenceT) > 1e-3f * std::max(referenceT, 1.0f)))
+            numMismatches++;
+
+        if (referenceHit)
+            numHits++;
+        else
+            numMisses++;
+    }
+    TEST_CHECK(numMismatches == 0);
+    TEST_CHECK(numHits > 10 && numMisses > 10);
+}
+
+static bool VoxelDAGTestEqual(const VoxelDAG& a, const VoxelDAG& b)
+{
+    return a.Size == b.Size && a.NumLevels == b.NumLevels && a.Root == b.Root && a.Nodes == b.Nodes && a.Leaves == b.Leaves;
+}
+
+static void VoxelDAGTestSerializeRoundTrip()
+{
+    std::vector<VoxelizerTriangle> triangles;
+    VoxelGridDesc grid;
+    VoxelDAGTestMakeScene(32, 4, &triangles, &grid);
+
+    VoxelDAG dag;
+    VoxelDAGBuild(triangles, grid, 1, &dag);
+
+    std::vector<uint8_t> bytes;
+    VoxelDAGSerialize(dag, &bytes);
+    VoxelDAG loaded;
+    TEST_CHECK(VoxelDAGDeserialize(bytes.data(), bytes.size(), &loaded));
+    TEST_CHECK(VoxelDAGTestEqual(dag, loaded));
+
+    // nothing occupied
+    VoxelDAG empty;
+    VoxelDAGBuild(std::vector<VoxelizerTriangle>(), grid, 1, &empty);
+    TEST_CHECK(empty.Root == kVoxelDAGEmpty);
+    VoxelDAGSerialize(empty, &bytes);
+    TEST_CHECK(VoxelDAGDeserialize(bytes.data(), bytes.size(), &loaded));
+    TEST_CHECK(VoxelDAGTestEqual(empty, loaded));
+    TEST_CHECK(!VoxelDAGIsOccupied(loaded, 0, 0, 0));
+}
+
+// Offsets of the header's words, which are followed by the nodes.
+enum
+{
+    VOXELDAG_TEST_MAGIC = 0,
+    VOXELDAG_TEST_VERSION = 4,
+    VOXELDAG_TEST_SIZE = 8,
+    VOXELDAG_TEST_NUM_LEVELS = 12,
+    VOXELDAG_TEST_ROOT = 16,
+    VOXELDAG_TEST_NUM_NODE_WORDS = 20,
+    VOXELDAG_TEST_NUM_LEAVES = 24,
+    VOXELDAG_TEST_NODES = 28
+};
+
+static uint32_t VoxelDAGTestReadWord(const std::vector<uint8_t>& bytes, size_t offset)
+{
+    uint32_t word;
+    memcpy(&word, &bytes[offset], sizeof(word));
+    return word;
+}
+
+// Returns whether the bytes with one word replaced still load.
+static bool VoxelDAGTestLoadsWith(std::vector<uint8_t> bytes, size_t offset, uint32_t word)
+{
+    memcpy(&bytes[offset], &word, sizeof(word));
+    VoxelDAG dag;
+    return VoxelDAGDeserialize(bytes.data(), bytes.size(), &dag);
+}
+
+static void VoxelDAGTestDeserializeRejects()
+{
+    std::vector<VoxelizerTriangle> triangles;
+    VoxelGridDesc grid;
+    VoxelDAGTestMakeScene(32, 5, &triangles, &grid);
+
+    VoxelDAG dag;
+    VoxelDAGBuild(triangles, grid, 1, &dag);
+    TEST_CHECK(dag.NumLevels == 3);
+
+    std::vector<uint8_t> bytes;
+    VoxelDAGSerialize(dag, &bytes);
+    VoxelDAG loaded;
+
+    // the header's words, which the test's offsets must agree with
+    TEST_CHECK(VoxelDAGTestReadWord(bytes, VOXELDAG_TEST_SIZE) == 32);
+    TEST_CHECK(VoxelDAGTestReadWord(bytes, VOXELDAG_TEST_NUM_NODE_WORDS) == dag.Nodes.size());
+    TEST_CHECK(VoxelDAGTestLoadsWith(bytes, VOXELDAG_TEST_ROOT, dag.Root));
+
+    TEST_CHECK(!VoxelDAGTestLoadsWith(bytes, VOXELDAG_TEST_MAGIC, 0x12345678));
+    TEST_CHECK(!VoxelDAGTestLoadsWith(bytes, VOXELDAG_TEST_VERSION, 2));
+
+    // truncated, too long, or with arrays that don't add up to the size
+    TEST_CHECK(!VoxelDAGDeserialize(bytes.data(), 10, &loaded));
+    TEST_CHECK(!VoxelDAGDeserialize(bytes.data(), bytes.size() - 1, &loaded));
+    std::vector<uint8_t> longer = bytes;
+    longer.push_back(0);
+    TEST_CHECK(!VoxelDAGDeserialize(longer.data(), longer.size(), &loaded));
+    TEST_CHECK(!VoxelDAGTestLoadsWith(bytes, VOXELDAG_TEST_NUM_LEAVES, (uint32_t)dag.Leaves.size() + 1));
+
+    // a number of levels that doesn't fit the size, and sizes that aren't powers of two of at least a brick
+    TEST_CHECK(!VoxelDAGTestLoadsWith(bytes, VOXELDAG_TEST_NUM_LEVELS, 4));
+    TEST_CHECK(!VoxelDAGTestLoadsWith(bytes, VOXELDAG_TEST_NUM_LEVELS, 2));
+    TEST_CHECK(!VoxelDAGTestLoadsWith(bytes, VOXELDAG_TEST_SIZE, 64));
+    TEST_CHECK(!VoxelDAGTestLoadsWith(bytes, VOXELDAG_TEST_SIZE, 48));
+    TEST_CHECK(!VoxelDAGTestLoadsWith(bytes, VOXELDAG_TEST_SIZE, 4));
+
+    // a root past the nodes, and a child of the root past the nodes
+    size_t rootOffset = VOXELDAG_TEST_NODES + dag.Root * sizeof(uint32_t);
+    TEST_CHECK(!VoxelDAGTestLoadsWith(bytes, VOXELDAG_TEST_ROOT, (uint32_t)dag.Nodes.size()));
+    TEST_CHECK(!VoxelDAGTestLoadsWith(bytes, rootOffset + sizeof(uint32_t), (uint32_t)dag.Nodes.size()));
+
+    // a child mask with bits past the 8 octants
+    TEST_CHECK(!VoxelDAGTestLoadsWith(bytes, rootOffset, 0x100));
+
+    // with a single level, the root's children are leaves, and one past the leaves is rejected
+    VoxelGridDesc smallGrid = grid;
+    smallGrid.Size = 8;
+    auto gridPoint = [&](float x, float y, float z)
+    {
+        return XMFLOAT3(grid.Origin.x + x * grid.VoxelSize, grid.Origin.y + y * grid.VoxelSize, grid.Origin.z + z * grid.VoxelSize);
+    };
+    std::vector<VoxelizerTriangle> smallTriangles(1, VoxelDAGTestMakeTriangle(gridPoint(1.2f, 1.3f, 1.4f), gridPoint(5.5f, 2.1f, 3.3f), gridPoint(2.2f, 6.4f, 5.1f)));
+    VoxelDAG small;
+    VoxelDAGBuild(smallTriangles, smallGrid, 1, &small);
+    TEST_CHECK(small.NumLevels == 1 && small.Root != kVoxelDAGEmpty);
+
+    VoxelDAGSerialize(small, &bytes);
+    TEST_CHECK(VoxelDAGDeserialize(bytes.data(), bytes.size(), &loaded));
+    size_t smallRootOffset = VOXELDAG_TEST_NODES + small.Root * sizeof(uint32_t);
+    TEST_CHECK(!VoxelDAGTestLoadsWith(bytes, smallRootOffset + sizeof(uint32_t), (uint32_t)small.Leaves.size()));
+
+    // the root is the only node, so a root with every child has more children than there are words left
+    TEST_CHECK(small.Nodes.size() < 9);
+    TEST_CHECK(!VoxelDAGTestLoadsWith(bytes, smallRootOffset, 0xFF));
+}
+
+int main()
+{
+    VoxelDAGTestMatchesVoxelizer(32);
+    VoxelDAGTestMatchesVoxelizer(64);
+    VoxelDAGTestRaycast(32);
+    VoxelDAGTestRaycast(64);
+    VoxelDAGTestSerializeRoundTrip();
+    VoxelDAGTestDeserializeRejects();
+    return TestReport("voxeldag_test");
+}
\ No newline at end of file
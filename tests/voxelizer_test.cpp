@@ -0,0 +1,363 @@
+#include "testing.h"
+
+#include "voxelizer.h"
+
+#include <algorithm>
+#include <cmath>
+#include <random>
+#include <vector>
+
+using namespace DirectX;
+
+// Tolerance of the reference, in voxels. The voxelizer's separating axis tests run in float on grid coordinates of up
+// to a few hundred, so a triangle that only just touches a voxel can come out either way.
+static const double kVoxelizerTestTolerance = 1e-3;
+
+// Clips a convex polygon against the half-space sign * (p[axis] - bound) <= 0. Points on the plane are kept.
+static int VoxelizerTestClip(const double (*pPoints)[3], int numPoints, int axis, double bound, double sign, double (*pClipped)[3])
+{
+    int numClipped = 0;
+    for (int i = 0; i < numPoints; i++)
+    {
+        const double* p = pPoints[i];
+        const double* q = pPoints[(i + 1) % numPoints];
+        double dp = sign * (p[axis] - bound);
+        double dq = sign * (q[axis] - bound);
+
+        if (dp <= 0.0)
+        {
+            for (int c = 0; c < 3; c++)
+                pClipped[numClipped][c] = p[c];
+            numClipped++;
+        }
+
+        if ((dp < 0.0 && dq > 0.0) || (dp > 0.0 && dq < 0.0))
+        {
+            double t = dp / (dp - dq);
+            for (int c = 0; c < 3; c++)
+                pClipped[numClipped][c] = p[c] + (q[c] - p[c]) * t;
+            pClipped[numClipped][axis] = bound;
+            numClipped++;
+        }
+    }
+    return numClipped;
+}
+
+// Whether the triangle has a point in the box [lo, hi]^3 around the voxel's corner, by clipping it against the box's
+// six planes. Degenerate triangles are clipped like the segments they are.
+static bool VoxelizerTestOverlaps(const double (*v)[3], const int* voxel, double lo, double hi)
+{
+    // a triangle clipped by 6 planes has at most 9 vertices
+    double polygon[2][12][3];
+    int numPoints = 3;
+    for (int i = 0; i < 3; i++)
+    {
+        for (int c = 0; c < 3; c++)
+            polygon[0][i][c] = v[i][c];
+    }
+
+    int current = 0;
+    for (int axis = 0; axis < 3 && numPoints > 0; axis++)
+    {
+        numPoints = VoxelizerTestClip(polygon[current], numPoints, axis, voxel[axis] + lo, -1.0, polygon[1 - current]);
+        current = 1 - current;
+        numPoints = VoxelizerTestClip(polygon[current], numPoints, axis, voxel[axis] + hi, 1.0, polygon[1 - current]);
+        current = 1 - current;
+    }
+    return numPoints > 0;
+}
+
+// Clips every triangle against the box of every voxel near it in double precision, which shares nothing with the
+// voxelizer's binning, bounds or separating axes. Voxels that the triangle overlaps by more than the tolerance must be
+// occupied, and voxels it doesn't come within the tolerance of must be empty. The ones in between may be either.
+static void VoxelizerTestReference(const std::vector<VoxelizerTriangle>& triangles, const VoxelGridDesc& grid, std::vector<uint8_t>* pMustOccupy, std::vector<uint8_t>* pMayOccupy)
+{
+    const int size = grid.Size;
+    pMustOccupy->assign((size_t)size * size * size, 0);
+    pMayOccupy->assign((size_t)size * size * size, 0);
+
+    const float* origin = &grid.Origin.x;
+    const double kBoxRadius = 0.5 * std::sqrt(3.0) + kVoxelizerTestTolerance;
+
+    for (const VoxelizerTriangle& triangle : triangles)
+    {
+        double v[3][3];
+        for (int i = 0; i < 3; i++)
+        {
+            const float* p = &triangle.Positions[i].x;
+            for (int c = 0; c < 3; c++)
+                v[i][c] = ((double)p[c] - origin[c]) / grid.VoxelSize;
+        }
+
+        int voxelMin[3], voxelMax[3];
+        for (int c = 0; c < 3; c++)
+        {
+            double lo = std::min(v[0][c], std::min(v[1][c], v[2][c])) - kVoxelizerTestTolerance;
+            double hi = std::max(v[0][c], std::max(v[1][c], v[2][c])) + kVoxelizerTestTolerance;
+            voxelMin[c] = std::max((int)std::floor(lo), 0);
+            voxelMax[c] = std::min((int)std::floor(hi), size - 1);
+        }
+
+        // voxels whose centers are far from the triangle's plane are skipped before clipping
+        double normal[3] = {
+            (v[1][1] - v[0][1]) * (v[2][2] - v[0][2]) - (v[1][2] - v[0][2]) * (v[2][1] - v[0][1]),
+            (v[1][2] - v[0][2]) * (v[2][0] - v[0][0]) - (v[1][0] - v[0][0]) * (v[2][2] - v[0][2]),
+            (v[1][0] - v[0][0]) * (v[2][1] - v[0][1]) - (v[1][1] - v[0][1]) * (v[2][0] - v[0][0])
+        };
+        double normalLength = std::sqrt(normal[0] * normal[0] + normal[1] * normal[1] + normal[2] * normal[2]);
+
+        for (int z = voxelMin[2]; z <= voxelMax[2]; z++)
+        {
+            for (int y = voxelMin[1]; y <= voxelMax[1]; y++)
+            {
+                for (int x = voxelMin[0]; x <= voxelMax[0]; x++)
+                {
+                    if (normalLength > 1e-9)
+                    {
+                        double distance = 0.0;
+                        double center[3] = { x + 0.5, y + 0.5, z + 0.5 };
+                        for (int c = 0; c < 3; c++)
+                            distance += (center[c] - v[0][c]) * normal[c];
+                        if (std::abs(distance) > kBoxRadius * normalLength)
+                            continue;
+                    }
+
+                    int voxel[3] = { x, y, z };
+                    size_t index = ((size_t)z * size + y) * size + x;
+                    if (VoxelizerTestOverlaps(v, voxel, -kVoxelizerTestTolerance, 1.0 + kVoxelizerTestTolerance))
+                    {
+                        (*pMayOccupy)[index] = 1;
+                        if (VoxelizerTestOverlaps(v, voxel, kVoxelizerTestTolerance, 1.0 - kVoxelizerTestTolerance))
+                            (*pMustOccupy)[index] = 1;
+                    }
+                }
+            }
+        }
+    }
+}
+
+static VoxelizerTriangle VoxelizerTestMakeTriangle(const XMFLOAT3& p0, const XMFLOAT3& p1, const XMFLOAT3& p2)
+{
+    VoxelizerTriangle triangle;
+    triangle.Positions[0] = p0;
+    triangle.Positions[1] = p1;
+    triangle.Positions[2] = p2;
+    for (XMFLOAT2& texCoord : triangle.TexCoords)
+    {
+        texCoord = XMFLOAT2(0.0f, 0.0f);
+    }
+    triangle.Albedo = XMFLOAT3(0.5f, 0.25f, 1.0f);
+    triangle.pAlbedoTexture = NULL;
+    return triangle;
+}
+
+// Small and large triangles, slivers, degenerate ones, triangles that stick out of the grid,
+// and axis-aligned ones whose vertices are on voxel boundaries.
+static void VoxelizerTestMakeRandomTriangles(const VoxelGridDesc& grid, int count, uint32_t seed, std::vector<VoxelizerTriangle>* pTriangles)
+{
+    std::mt19937 rng(seed);
+    float extent = grid.Size * grid.VoxelSize;
+    std::uniform_real_distribution<float> inside(-0.1f * extent, 1.1f * extent);
+    std::uniform_real_distribution<float> offset(-3.0f * grid.VoxelSize, 3.0f * grid.VoxelSize);
+    std::uniform_int_distribution<int> voxel(0, grid.Size);
+
+    auto gridPoint = [&](float x, float y, float z)
+    {
+        return XMFLOAT3(grid.Origin.x + x, grid.Origin.y + y, grid.Origin.z + z);
+    };
+
+    for (int i = 0; i < count; i++)
+    {
+        XMFLOAT3 p[3];
+        switch (i % 5)
+        {
+        case 0: // anywhere, mostly large
+            for (XMFLOAT3& point : p)
+                point = gridPoint(inside(rng), inside(rng), inside(rng));
+            break;
+        case 1: // a few voxels across
+        {
+            XMFLOAT3 center = gridPoint(inside(rng), inside(rng), inside(rng));
+            for (XMFLOAT3& point : p)
+                point = XMFLOAT3(center.x + offset(rng), center.y + offset(rng), center.z + offset(rng));
+            break;
+        }
+        case 2: // a sliver
+        {
+            p[0] = gridPoint(inside(rng), inside(rng), inside(rng));
+            p[1] = gridPoint(inside(rng), inside(rng), inside(rng));
+            float t = 0.37f;
+            p[2] = XMFLOAT3(
+                p[0].x + (p[1].x - p[0].x) * t + offset(rng) * 0.01f,
+                p[0].y + (p[1].y - p[0].y) * t,
+                p[0].z + (p[1].z - p[0].z) * t);
+            break;
+        }
+        case 3: // degenerate, with two equal vertices
+            p[0] = gridPoint(inside(rng), inside(rng), inside(rng));
+            p[1] = p[0];
+            p[2] = gridPoint(inside(rng), inside(rng), inside(rng));
+            break;
+        default: // in a plane of voxel faces, with its vertices on voxel corners
+        {
+            int axis = i % 3;
+            float plane = voxel(rng) * grid.VoxelSize;
+            for (XMFLOAT3& point : p)
+            {
+                float c[3] = { voxel(rng) * grid.VoxelSize, voxel(rng) * grid.VoxelSize, voxel(rng) * grid.VoxelSize };
+                c[axis] = plane;
+                point = gridPoint(c[0], c[1], c[2]);
+            }
+            break;
+        }
+        }
+
+        pTriangles->push_back(VoxelizerTestMakeTriangle(p[0], p[1], p[2]));
+    }
+}
+
+static void VoxelizerTestCompareWithReference(int gridSize, int numTriangles, uint32_t seed)
+{
+    VoxelGridDesc grid;
+    grid.Origin = XMFLOAT3(-3.25f, 1.5f, 10.0f);
+    grid.VoxelSize = 0.375f;
+    grid.Size = gridSize;
+
+    std::vector<VoxelizerTriangle> triangles;
+    VoxelizerTestMakeRandomTriangles(grid, numTriangles, seed, &triangles);
+
+    std::vector<uint8_t> mustOccupy, mayOccupy;
+    VoxelizerTestReference(triangles, grid, &mustOccupy, &mayOccupy);
+
+    std::vector<uint32_t> voxels(mustOccupy.size());
+    uint64_t numOccupied = VoxelizeTriangles(triangles, grid, voxels.data());
+    TEST_CHECK(numOccupied != 0);
+
+    uint64_t numCountedOccupied = 0;
+    uint64_t numMissed = 0;
+    uint64_t numExtra = 0;
+    std::vector<uint8_t> occupied(voxels.size());
+    for (size_t i = 0; i < voxels.size(); i++)
+    {
+        occupied[i] = voxels[i] != 0;
+        numCountedOccupied += occupied[i];
+        if (mustOccupy[i] && !occupied[i])
+            numMissed++;
+        if (!mayOccupy[i] && occupied[i])
+            numExtra++;
+    }
+    TEST_CHECK(numCountedOccupied == numOccupied);
+    TEST_CHECK(numMissed == 0);
+    TEST_CHECK(numExtra == 0);
+
+    // the rows don't depend on how they are spread over threads
+    for (int numThreads : { 1, 3, 8 })
+    {
+        std::vector<uint8_t> rowOccupied(occupied.size(), 0);
+        std::vector<int> rowCalls((size_t)(gridSize / kVoxelBrickSize) * (gridSize / kVoxelBrickSize), 0);
+
+        VoxelizeTrianglesByRow(triangles, grid, [&](int rowY, int rowZ, const uint32_t* pRowVoxels)
+        {
+            // each row is only reported once, so no two threads write the same voxels
+            rowCalls[(rowZ / kVoxelBrickSize) * (gridSize / kVoxelBrickSize) + rowY / kVoxelBrickSize]++;
+
+            for (int z = 0; z < kVoxelBrickSize; z++)
+            {
+                for (int y = 0; y < kVoxelBrickSize; y++)
+                {
+                    for (int x = 0; x < gridSize; x++)
+                    {
+                        if (pRowVoxels[(z * kVoxelBrickSize + y) * gridSize + x] != 0)
+                            rowOccupied[((size_t)(rowZ + z) * gridSize + rowY + y) * gridSize + x] = 1;
+                    }
+                }
+            }
+        }, numThreads);
+
+        TEST_CHECK(rowOccupied == occupied);
+        TEST_CHECK(*std::max_element(rowCalls.begin(), rowCalls.end()) <= 1);
+    }
+}
+
+// One untextured triangle gives every voxel it touches its albedo, encoded to sRGB with alpha 255.
+static void VoxelizerTestConstantAlbedo()
+{
+    VoxelGridDesc grid;
+    grid.Origin = XMFLOAT3(0.0f, 0.0f, 0.0f);
+    grid.VoxelSize = 1.0f;
+    grid.Size = 16;
+
+    std::vector<VoxelizerTriangle> triangles;
+    triangles.push_back(VoxelizerTestMakeTriangle(XMFLOAT3(1.2f, 2.7f, 3.1f), XMFLOAT3(14.3f, 5.5f, 9.9f), XMFLOAT3(4.4f, 13.8f, 12.0f)));
+
+    std::vector<uint32_t> voxels((size_t)grid.Size * grid.Size * grid.Size);
+    uint64_t numOccupied = VoxelizeTriangles(triangles, grid, voxels.data());
+    TEST_CHECK(numOccupied > 0);
+
+    uint32_t expected = 0xFF000000;
+    const float* albedo = &triangles[0].Albedo.x;
+    for (int i = 0; i < 3; i++)
+    {
+        expected |= (uint32_t)(std::pow(albedo[i], 1.0f / 2.2f) * 255.0f + 0.5f) << (i * 8);
+    }
+
+    for (uint32_t voxel : voxels)
+    {
+        TEST_CHECK(voxel == 0 || voxel == expected);
+    }
+}
+
+// A triangle in a plane of voxel faces touches the voxels on both sides of it, which the reference leaves undecided.
+static void VoxelizerTestTouchingFaces()
+{
+    VoxelGridDesc grid;
+    grid.Origin = XMFLOAT3(0.0f, 0.0f, 0.0f);
+    grid.VoxelSize = 1.0f;
+    grid.Size = 16;
+
+    // covers the voxel columns x = 2..5 and y = 2..5, and not the triangle's far corner
+    std::vector<VoxelizerTriangle> triangles;
+    triangles.push_back(VoxelizerTestMakeTriangle(XMFLOAT3(2.5f, 2.5f, 4.0f), XMFLOAT3(13.5f, 2.5f, 4.0f), XMFLOAT3(2.5f, 13.5f, 4.0f)));
+
+    std::vector<uint32_t> voxels((size_t)grid.Size * grid.Size * grid.Size);
+    VoxelizeTriangles(triangles, grid, voxels.data());
+
+    for (int z = 0; z < grid.Size; z++)
+    {
+        for (int y = 2; y <= 5; y++)
+        {
+            for (int x = 2; x <= 5; x++)
+            {
+                bool occupied = voxels[((size_t)z * grid.Size + y) * grid.Size + x] != 0;
+                TEST_CHECK(occupied == (z == 3 || z == 4));
+            }
+        }
+    }
+    TEST_CHECK(voxels[((size_t)4 * grid.Size + 13) * grid.Size + 13] == 0);
+}
+
+static void VoxelizerTestEmpty()
+{
+    VoxelGridDesc grid;
+    grid.Origin = XMFLOAT3(0.0f, 0.0f, 0.0f);
+    grid.VoxelSize = 1.0f;
+    grid.Size = 8;
+
+    // entirely outside the grid
+    std::vector<VoxelizerTriangle> triangles;
+    triangles.push_back(VoxelizerTestMakeTriangle(XMFLOAT3(20.0f, 0.0f, 0.0f), XMFLOAT3(30.0f, 1.0f, 0.0f), XMFLOAT3(25.0f, 5.0f, 5.0f)));
+
+    std::vector<uint32_t> voxels((size_t)grid.Size * grid.Size * grid.Size, 0xDEADBEEF);
+    TEST_CHECK(VoxelizeTriangles(triangles, grid, voxels.data()) == 0);
+    TEST_CHECK(std::count(voxels.begin(), voxels.end(), 0u) == (std::ptrdiff_t)voxels.size());
+}
+
+int main()
+{
+    VoxelizerTestCompareWithReference(32, 400, 1);
+    VoxelizerTestCompareWithReference(64, 150, 2);
+    VoxelizerTestConstantAlbedo();
+    VoxelizerTestTouchingFaces();
+    VoxelizerTestEmpty();
+    return TestReport("voxelizer_test");
+}
\ No newline at end of file
@@ -0,0 +1,157 @@
+#include "testing.h"
+
+#include "voxelmip.h"
+
+#include <algorithm>
+#include <random>
+#include <vector>
+
+// Every voxel of every level is the max of its 8 children, one voxel at a time.
+static void VoxelMipTestReferenceOccupancy(const std::vector<uint8_t>& src, int srcSize, std::vector<uint8_t>* pDst)
+{
+    int dstSize = srcSize / 2;
+    pDst->assign((size_t)dstSize * dstSize * dstSize, 0);
+
+    for (int z = 0; z < dstSize; z++)
+    {
+        for (int y = 0; y < dstSize; y++)
+        {
+            for (int x = 0; x < dstSize; x++)
+            {
+                uint8_t expected = 0;
+                for (int i = 0; i < 8; i++)
+                {
+                    size_t sx = x * 2 + (i & 1), sy = y * 2 + ((i >> 1) & 1), sz = z * 2 + (i >> 2);
+                    expected = std::max(expected, src[(sz * srcSize + sy) * srcSize + sx]);
+                }
+                (*pDst)[((size_t)z * dstSize + y) * dstSize + x] = expected;
+            }
+        }
+    }
+}
+
+// The whole chain is compared with the scalar max, from volumes below the tile size to several tiles per axis, and
+// from nearly empty to nearly full, since the SIMD path only runs on whole tiles.
+static void VoxelMipTestOccupancyExact(int size, float density, uint32_t seed)
+{
+    std::mt19937 rng(seed);
+    std::uniform_real_distribution<float> unorm(0.0f, 1.0f);
+    std::uniform_int_distribution<int> value(1, 255);
+
+    std::vector<uint8_t> level0((size_t)size * size * size);
+    for (uint8_t& voxel : level0)
+    {
+        voxel = unorm(rng) < density ? (uint8_t)value(rng) : 0;
+    }
+
+    for (int numThreads : { 1, 3 })
+    {
+        std::vector<uint8_t> src = level0;
+        for (int srcSize = size; srcSize > 1; srcSize /= 2)
+        {
+            std::vector<uint8_t> reference;
+            VoxelMipTestReferenceOccupancy(src, srcSize, &reference);
+
+            std::vector<uint8_t> dst(reference.size(), 0xCD);
+            VoxelMipDownsampleOccupancy(src.data(), srcSize, dst.data(), numThreads);
+            TEST_CHECK(dst == reference);
+
+            src.swap(reference);
+        }
+    }
+}
+
+static void VoxelMipTestNumLevels()
+{
+    TEST_CHECK(VoxelMipGetNumLevels(1) == 1);
+    TEST_CHECK(VoxelMipGetNumLevels(2) == 2);
+    TEST_CHECK(VoxelMipGetNumLevels(64) == 7);
+    TEST_CHECK(VoxelMipGetNumLevels(512) == 10);
+}
+
+static uint32_t VoxelMipTestRGBA(int r, int g, int b, int a)
+{
+    return (uint32_t)r | ((uint32_t)g << 8) | ((uint32_t)b << 16) | ((uint32_t)a << 24);
+}
+
+static bool VoxelMipTestNearlyEqual(uint32_t a, uint32_t b)
+{
+    for (int shift = 0; shift < 32; shift += 8)
+    {
+        int difference = (int)((a >> shift) & 0xFF) - (int)((b >> shift) & 0xFF);
+        if (difference < -1 || difference > 1)
+            return false;
+    }
+    return true;
+}
+
+// Empty children don't darken the parent, a parent of empty children is empty, and the opacity is the average.
+static void VoxelMipTestAlbedo()
+{
+    const int size = 32;
+    const uint32_t color = VoxelMipTestRGBA(200, 120, 40, 255);
+
+    std::vector<uint32_t> src((size_t)size * size * size, 0);
+    std::vector<uint32_t> dst((size_t)(size / 2) * (size / 2) * (size / 2), 0xCDCDCDCD);
+
+    // parent (0,0,0): all 8 children opaque, parent (1,0,0): one child, parent (2,0,0): none
+    for (int i = 0; i < 8; i++)
+    {
+        src[(size_t)((i >> 2) * size + ((i >> 1) & 1)) * size + (i & 1)] = color;
+    }
+    src[2] = color;
+
+    VoxelMipDownsampleAlbedo(src.data(), size, dst.data());
+
+    TEST_CHECK(VoxelMipTestNearlyEqual(dst[0], color));
+    TEST_CHECK((dst[0] >> 24) == 255);
+    TEST_CHECK(VoxelMipTestNearlyEqual(dst[1] & 0xFFFFFF, color & 0xFFFFFF));
+    TEST_CHECK((dst[1] >> 24) == 32);
+    TEST_CHECK(dst[2] == 0);
+
+    // two opaque children of different colors average in linear space, so the result is brighter than the sRGB average
+    std::fill(src.begin(), src.end(), 0);
+    src[0] = VoxelMipTestRGBA(255, 255, 255, 255);
+    src[1] = VoxelMipTestRGBA(0, 0, 0, 255);
+    VoxelMipDownsampleAlbedo(src.data(), size, dst.data());
+    TEST_CHECK((dst[0] & 0xFF) > 128);
+    TEST_CHECK((dst[0] >> 24) == 64);
+}
+
+// The albedo chain doesn't depend on how the tiles are spread over threads.
+static void VoxelMipTestAlbedoThreads()
+{
+    const int size = 64;
+
+    std::mt19937 rng(7);
+    std::uniform_int_distribution<uint32_t> value;
+    std::vector<uint32_t> src((size_t)size * size * size);
+    for (uint32_t& voxel : src)
+    {
+        voxel = value(rng);
+        if ((voxel >> 24) < 128)
+            voxel = 0;
+    }
+
+    std::vector<uint32_t> reference((size_t)(size / 2) * (size / 2) * (size / 2));
+    VoxelMipDownsampleAlbedo(src.data(), size, reference.data(), 1);
+
+    for (int numThreads : { 2, 3, 8 })
+    {
+        std::vector<uint32_t> dst(reference.size(), 0xCDCDCDCD);
+        VoxelMipDownsampleAlbedo(src.data(), size, dst.data(), numThreads);
+        TEST_CHECK(dst == reference);
+    }
+}
+
+int main()
+{
+    VoxelMipTestNumLevels();
+    VoxelMipTestOccupancyExact(8, 0.5f, 1);
+    VoxelMipTestOccupancyExact(32, 0.01f, 2);
+    VoxelMipTestOccupancyExact(64, 0.3f, 3);
+    VoxelMipTestOccupancyExact(128, 0.95f, 4);
+    VoxelMipTestAlbedo();
+    VoxelMipTestAlbedoThreads();
+    return TestReport("voxelmip_test");
+}
\ No newline at end of file
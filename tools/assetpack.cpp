@@ -0,0 +1,289 @@
+// Packs asset files into the package that the scene reads with assetpackage, and benchmarks loading from it.
+//
+//   assetpack [-z] <package> <file or directory>...
+//       Packs the files, and every file under the directories. The names are the paths as they are given, so run it
+//       from the directory the app runs in, like: assetpack -z assets.pak assets
+//       With -z, entries are compressed with zlib when that saves a quarter of their size.
+//
+//   assetpack -bench <package> [iterations]
+//       Reads every entry as a loose file and from the package, cold and warm, and prints the times.
+//       Cold reads drop the files from the page cache first, which needs posix_fadvise, so they are only run on Linux.
+//
+// Not part of the app's project. It is the assetpack target of the CMake project at the root, and also builds on its own
+// with the reader and stb_image, like:
+//   g++ -std=c++14 -O2 -Isrc tools/assetpack.cpp src/assetpackage.cpp src/stb_image.c -o assetpack
+
+#include "assetpackage.h"
+
+#include <algorithm>
+#include <chrono>
+#include <string>
+#include <vector>
+#include <cstdio>
+#include <cstdlib>
+#include <cstring>
+
+#ifdef _WIN32
+#define NOMINMAX
+#define WIN32_LEAN_AND_MEAN
+#include <Windows.h>
+#else
+#include <sys/stat.h>
+#include <dirent.h>
+#include <fcntl.h>
+#include <unistd.h>
+#endif
+
+// Appends the file, or every file under the directory.
+static bool AssetPackCollectFiles(const std::string& path, std::vector<std::string>* pFiles)
+{
+#ifdef _WIN32
+    DWORD attributes = GetFileAttributesA(path.c_str());
+    if (attributes == INVALID_FILE_ATTRIBUTES)
+        return false;
+
+    if (!(attributes & FILE_ATTRIBUTE_DIRECTORY))
+    {
+        pFiles->push_back(path);
+        return true;
+    }
+
+    WIN32_FIND_DATAA findData;
+    HANDLE hFind = FindFirstFileA((path + "/*").c_str(), &findData);
+    if (hFind == INVALID_HANDLE_VALUE)
+        return true;
+
+    bool succeeded = true;
+    do
+    {
+        if (strcmp(findData.cFileName, ".") != 0 && strcmp(findData.cFileName, "..") != 0)
+            succeeded = AssetPackCollectFiles(path + "/" + findData.cFileName, pFiles) && succeeded;
+    } while (FindNextFileA(hFind, &findData));
+    FindClose(hFind);
+    return succeeded;
+#else
+    struct stat pathStat;
+    if (stat(path.c_str(), &pathStat) != 0)
+        return false;
+
+    if (!S_ISDIR(pathStat.st_mode))
+    {
+        pFiles->push_back(path);
+        return true;
+    }
+
+    DIR* pDir = opendir(path.c_str());
+    if (!pDir)
+        return false;
+
+    bool succeeded = true;
+    while (dirent* pEntry = readdir(pDir))
+    {
+        if (strcmp(pEntry->d_name, ".") != 0 && strcmp(pEntry->d_name, "..") != 0)
+            succeeded = AssetPackCollectFiles(path + "/" + pEntry->d_name, pFiles) && succeeded;
+    }
+    closedir(pDir);
+    return succeeded;
+#endif
+}
+
+static int AssetPackPack(const char* packagePath, const std::vector<std::string>& paths, bool compress)
+{
+    std::vector<std::string> files;
+    for (const std::string& path : paths)
+    {
+        if (!AssetPackCollectFiles(path, &files))
+        {
+            fprintf(stderr, "Couldn't read %s\n", path.c_str());
+            return 1;
+        }
+    }
+
+    std::vector<AssetPackageInput> inputs;
+    for (const std::string& file : files)
+    {
+        // the package itself could be under one of the directories
+        if (file == packagePath || file == std::string(packagePath) + ".tmp")
+            continue;
+
+        AssetPackageInput input;
+        input.Name = file;
+        input.Path = file;
+        input.Compress = compress;
+        inputs.push_back(input);
+    }
+
+    AssetPackageWriteStats stats;
+    if (!AssetPackageWrite(packagePath, inputs, &stats))
+    {
+        fprintf(stderr, "Couldn't write %s\n", packagePath);
+        return 1;
+    }
+
+    printf("%d entries, %d compressed\n", (int)inputs.size(), stats.NumCompressed);
+    printf("%.2f MB of files, %.2f MB package\n", stats.InputBytes / 1048576.0, stats.FileBytes / 1048576.0);
+    return 0;
+}
+
+// Drops the file's pages from the page cache, so the next read comes from the disk.
+static void AssetPackDropFromCache(const char* path)
+{
+#ifdef __linux__
+    int fd = open(path, O_RDONLY);
+    if (fd == -1)
+        return;
+    fdatasync(fd);
+    posix_fadvise(fd, 0, 0, POSIX_FADV_DONTNEED);
+    close(fd);
+#else
+    (void)path;
+#endif
+}
+
+// Every byte is summed, so each read touches all of its pages.
+static uint32_t AssetPackChecksum(const uint8_t* pBytes, uint64_t size)
+{
+    uint32_t sum = 0;
+    for (uint64_t i = 0; i < size; i++)
+    {
+        sum += pBytes[i];
+    }
+    return sum;
+}
+
+static double AssetPackReadLooseFiles(const std::vector<std::string>& names, uint32_t* pChecksum)
+{
+    auto start = std::chrono::steady_clock::now();
+
+    std::vector<uint8_t> bytes;
+    for (const std::string& name : names)
+    {
+        FILE* fp = fopen(name.c_str(), "rb");
+        if (!fp)
+            continue;
+
+        fseek(fp, 0, SEEK_END);
+        long size = ftell(fp);
+        fseek(fp, 0, SEEK_SET);
+        bytes.resize(size);
+        if (size > 0 && fread(bytes.data(), 1, size, fp) == (size_t)size)
+            *pChecksum += AssetPackChecksum(bytes.data(), size);
+        fclose(fp);
+    }
+
+    return std::chrono::duration<double, std::milli>(std::chrono::steady_clock::now() - start).count();
+}
+
+// Includes opening the package, since that is part of loading the scene from it.
+static double AssetPackReadPackage(const char* packagePath, const std::vector<std::string>& names, uint32_t* pChecksum)
+{
+    auto start = std::chrono::steady_clock::now();
+
+    AssetPackage* pPackage = AssetPackageOpen(packagePath);
+    if (!pPackage)
+        return 0.0;
+
+    std::vector<uint8_t> inflated;
+    for (const std::string& name : names)
+    {
+        int entryID = AssetPackageFind(pPackage, name.c_str());
+        const uint8_t* pBytes = AssetPackageReadEntry(pPackage, entryID, &inflated);
+        if (pBytes)
+            *pChecksum += AssetPackChecksum(pBytes, AssetPackageGetEntrySize(pPackage, entryID));
+    }
+
+    AssetPackageClose(pPackage);
+
+    return std::chrono::duration<double, std::milli>(std::chrono::steady_clock::now() - start).count();
+}
+
+static int AssetPackBench(const char* packagePath, int numIterations)
+{
+    AssetPackage* pPackage = AssetPackageOpen(packagePath);
+    if (!pPackage)
+    {
+        fprintf(stderr, "Couldn't open %s\n", packagePath);
+        return 1;
+    }
+
+    std::vector<std::string> names;
+    int numCompressed = 0;
+    uint64_t totalBytes = 0;
+    for (int entryID = 0; entryID < AssetPackageGetNumEntries(pPackage); entryID++)
+    {
+        names.push_back(AssetPackageGetEntryName(pPackage, entryID));
+        numCompressed += AssetPackageIsEntryCompressed(pPackage, entryID) ? 1 : 0;
+        totalBytes += AssetPackageGetEntrySize(pPackage, entryID);
+    }
+    AssetPackageClose(pPackage);
+
+    printf("%d entries, %d compressed, %.2f MB\n", (int)names.size(), numCompressed, totalBytes / 1048576.0);
+
+    // the best of the iterations, since anything else running can only make a read slower
+    bool canDropFromCache = false;
+#ifdef __linux__
+    canDropFromCache = true;
+#endif
+
+    for (int cold = canDropFromCache ? 1 : 0; cold >= 0; cold--)
+    {
+        double bestLooseMilliseconds = 1e30;
+        double bestPackageMilliseconds = 1e30;
+        uint32_t looseChecksum = 0;
+        uint32_t packageChecksum = 0;
+
+        for (int iteration = 0; iteration < numIterations; iteration++)
+        {
+            if (cold)
+            {
+                for (const std::string& name : names)
+                {
+                    AssetPackDropFromCache(name.c_str());
+                }
+            }
+            looseChecksum = 0;
+            double looseMilliseconds = AssetPackReadLooseFiles(names, &looseChecksum);
+
+            if (cold)
+                AssetPackDropFromCache(packagePath);
+            packageChecksum = 0;
+            double packageMilliseconds = AssetPackReadPackage(packagePath, names, &packageChecksum);
+
+            bestLooseMilliseconds = std::min(bestLooseMilliseconds, looseMilliseconds);
+            bestPackageMilliseconds = std::min(bestPackageMilliseconds, packageMilliseconds);
+        }
+
+        printf("%s: loose files %.2f ms, package %.2f ms%s\n",
+            cold ? "cold" : "warm", bestLooseMilliseconds, bestPackageMilliseconds,
+            looseChecksum == packageChecksum ? "" : " (the package doesn't match the files)");
+    }
+
+    return 0;
+}
+
+int main(int argc, char** argv)
+{
+    if (argc >= 3 && strcmp(argv[1], "-bench") == 0)
+    {
+        int numIterations = argc >= 4 ? atoi(argv[3]) : 5;
+        return AssetPackBench(argv[2], std::max(numIterations, 1));
+    }
+
+    int firstArg = 1;
+    bool compress = false;
+    if (argc >= 2 && strcmp(argv[1], "-z") == 0)
+    {
+        compress = true;
+        firstArg++;
+    }
+
+    if (argc - firstArg < 2)
+    {
+        fprintf(stderr, "usage: assetpack [-z] <package> <file or directory>...\n");
+        fprintf(stderr, "       assetpack -bench <package> [iterations]\n");
+        return 1;
+    }
+
+    std::vector<std::string> paths(argv + firstArg + 1, argv + argc);
+    return AssetPackPack(argv[firstArg], paths, compress);
+}
\ No newline at end of file